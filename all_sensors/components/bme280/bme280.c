@@ -9,21 +9,22 @@ struct {
     int32_t t_fine;
 } cal;
 
-esp_err_t bme280_init(i2c_port_t port, uint8_t addr) {
-    uint8_t calib[26], calib2[7], cmd;
+esp_err_t bme280_init(i2c_bus_device_handle_t dev) {
+    uint8_t calib[26];
     // Czytanie parametrów kalibracji
-    cmd = 0x88;
-    i2c_master_write_read_device(port, addr, &cmd, 1, calib, 26, 1000/portTICK_PERIOD_MS);
+    esp_err_t ret = i2c_bus_read_bytes(dev, 0x88, sizeof(calib), calib);
+    if (ret != ESP_OK) return ret;
     cal.dig_T1 = (calib[1] << 8) | calib[0]; cal.dig_T2 = (calib[3] << 8) | calib[2]; cal.dig_T3 = (calib[5] << 8) | calib[4];
     
     // Ustawienie trybu pracy (Normal mode)
-    uint8_t config[2] = {0xF4, 0x27}; // Osamp x1, Mode Normal
-    return i2c_master_write_to_device(port, addr, config, 2, 1000/portTICK_PERIOD_MS);
+    return i2c_bus_write_byte(dev, 0xF4, 0x27); // Osamp x1, Mode Normal
 }
 
-esp_err_t bme280_read_float_data(i2c_port_t port, uint8_t addr, float *temp, float *press, float *hum) {
-    uint8_t cmd = 0xF7, d[8];
-    i2c_master_write_read_device(port, addr, &cmd, 1, d, 8, 1000/portTICK_PERIOD_MS);
+esp_err_t bme280_read_float_data(i2c_bus_device_handle_t dev, float *temp, float *press, float *hum) {
+    uint8_t d[8];
+    // Przy błędzie nie ruszamy wyników - wywołujący zostaje przy ostatnich poprawnych wartościach
+    esp_err_t ret = i2c_bus_read_bytes(dev, 0xF7, sizeof(d), d);
+    if (ret != ESP_OK) return ret;
     
     int32_t adc_T = (d[3] << 12) | (d[4] << 4) | (d[5] >> 4);
     int32_t var1 = ((((adc_T>>3) - ((int32_t)cal.dig_T1<<1))) * ((int32_t)cal.dig_T2)) >> 11;
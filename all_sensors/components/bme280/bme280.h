@@ -1,9 +1,9 @@
 #ifndef BME280_H
 #define BME280_H
 
-#include "driver/i2c.h"
+#include "i2c_bus.h"
 
-esp_err_t bme280_init(i2c_port_t port, uint8_t addr);
-esp_err_t bme280_read_float_data(i2c_port_t port, uint8_t addr, float *temp, float *press, float *hum);
+esp_err_t bme280_init(i2c_bus_device_handle_t dev);
+esp_err_t bme280_read_float_data(i2c_bus_device_handle_t dev, float *temp, float *press, float *hum);
 
-#endif
\ No newline at end of file
+#endif
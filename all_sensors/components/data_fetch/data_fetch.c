@@ -0,0 +1,594 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "esp_log.h"
+#include "data_fetch.h"
+
+#define TAG "FETCH"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Plain TCP, BSD sockets of lwIP on the chip and of the OS on the host */
+
+typedef struct {
+    int fd;
+} tcp_conn_t;
+
+static esp_err_t tcp_connect(void **conn, const char *host, uint16_t port, uint32_t timeout_ms)
+{
+    char service[6];
+    snprintf(service, sizeof(service), "%u", port);
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, service, &hints, &res) != 0 || !res) {
+        ESP_LOGW(TAG, "%s: no address", host);
+        return ESP_FAIL;
+    }
+    int fd = socket(res->ai_family, res->ai_socktype, 0);
+    if (fd < 0) {
+        freeaddrinfo(res);
+        return ESP_FAIL;
+    }
+
+    // Connect without blocking, to bound the wait by timeout_ms
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0 && errno == EINPROGRESS) {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(fd, &wfds);
+        struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        int err = 0;
+        socklen_t len = sizeof(err);
+        rc = select(fd + 1, NULL, &wfds, NULL, &tv) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 &&
+             err == 0 ? 0 : -1;
+    }
+    if (rc != 0) {
+        ESP_LOGW(TAG, "%s:%u: connect failed", host, port);
+        close(fd);
+        return ESP_ERR_TIMEOUT;
+    }
+    fcntl(fd, F_SETFL, flags);
+    struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    tcp_conn_t *c = malloc(sizeof(tcp_conn_t));
+    if (!c) {
+        close(fd);
+        return ESP_ERR_NO_MEM;
+    }
+    c->fd = fd;
+    *conn = c;
+    return ESP_OK;
+}
+
+static int tcp_send(void *conn, const void *data, size_t len)
+{
+    return send(((tcp_conn_t *)conn)->fd, data, len, MSG_NOSIGNAL);
+}
+
+static int tcp_recv(void *conn, void *buf, size_t len)
+{
+    int n = recv(((tcp_conn_t *)conn)->fd, buf, len, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return DATA_FETCH_RECV_TIMEOUT;
+    }
+    return n;
+}
+
+static void tcp_close(void *conn)
+{
+    close(((tcp_conn_t *)conn)->fd);
+    free(conn);
+}
+
+const data_fetch_transport_t data_fetch_transport_tcp = {
+    .connect = tcp_connect,
+    .send = tcp_send,
+    .recv = tcp_recv,
+    .close = tcp_close,
+};
+
+/* Connection */
+
+static void conn_close(data_fetch_t *client)
+{
+    if (client->conn) {
+        client->config.transport->close(client->conn);
+        client->conn = NULL;
+    }
+    client->rx_len = client->rx_pos = 0;
+}
+
+static esp_err_t conn_open(data_fetch_t *client)
+{
+    esp_err_t ret = client->config.transport->connect(&client->conn, client->config.host, client->config.port,
+                                                      client->config.timeout_ms);
+    if (ret != ESP_OK) {
+        client->conn = NULL;
+        return ret;
+    }
+    client->stats.connects++;
+    client->conn_requests = 0;
+    client->rx_len = client->rx_pos = 0;
+    return ESP_OK;
+}
+
+// At least one byte in rx; ESP_ERR_INVALID_STATE when the server has closed the connection
+static esp_err_t fill(data_fetch_t *client)
+{
+    if (client->rx_pos < client->rx_len) {
+        return ESP_OK;
+    }
+    int n = client->config.transport->recv(client->conn, client->rx, sizeof(client->rx));
+    if (n > 0) {
+        client->rx_len = n;
+        client->rx_pos = 0;
+        return ESP_OK;
+    }
+    client->rx_len = client->rx_pos = 0;
+    return n == 0 ? ESP_ERR_INVALID_STATE : n == DATA_FETCH_RECV_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+}
+
+// A line without its CR LF; the rest of a longer line is dropped
+static esp_err_t read_line(data_fetch_t *client, char *line, size_t size)
+{
+    size_t len = 0;
+    while (true) {
+        esp_err_t ret = fill(client);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        char c = client->rx[client->rx_pos++];
+        if (c == '\n') {
+            break;
+        }
+        if (len + 1 < size) {
+            line[len++] = c;
+        }
+    }
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = '\0';
+    return ESP_OK;
+}
+
+static esp_err_t send_all(data_fetch_t *client, const char *data, size_t len)
+{
+    while (len > 0) {
+        int n = client->config.transport->send(client->conn, data, len);
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+/* HTTP/1.1 */
+
+typedef struct {
+    const char *path;
+    const char *accept;
+    const char *etag;                                                                                       /* "" or NULL: none */
+    const char *last_modified;
+    uint64_t offset;                                                                                        /* Range from here, 0: none */
+} request_t;
+
+typedef struct {
+    int status;
+    bool close;                                                                                             /* Server closes after this answer */
+    bool chunked;
+    bool has_length;
+    uint64_t length;
+    bool has_range;                                                                                         /* Content-Range, a 206 answer */
+    uint64_t range_start;
+    uint64_t total;                                                                                         /* Of the whole file, from Content-Range */
+    char etag[DATA_FETCH_ETAG_LEN];
+    char last_modified[DATA_FETCH_DATE_LEN];
+} response_t;
+
+static esp_err_t send_request(data_fetch_t *client, const request_t *r)
+{
+    // The receive buffer is empty between answers, the request is put together in it
+    char *req = client->rx;
+    size_t size = sizeof(client->rx);
+    bool default_port = client->config.port == 80 || client->config.port == 443;
+    int len = snprintf(req, size, "GET %s HTTP/1.1\r\nHost: %s", r->path, client->config.host);
+    if (!default_port && len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, ":%u", client->config.port);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, "\r\nAccept: %s\r\nConnection: keep-alive\r\n", r->accept);
+    }
+    if (r->etag && r->etag[0] && len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, "If-None-Match: %s\r\n", r->etag);
+    }
+    if (r->last_modified && r->last_modified[0] && len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, "If-Modified-Since: %s\r\n", r->last_modified);
+    }
+    if (r->offset && len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, "Range: bytes=%" PRIu64 "-\r\n", r->offset);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        len += snprintf(req + len, size - len, "\r\n");
+    }
+    client->rx_len = client->rx_pos = 0;
+    if (len < 0 || (size_t)len >= size) {
+        ESP_LOGE(TAG, "Request for %s too long", r->path);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return send_all(client, req, len);
+}
+
+static const char *header_value(const char *line, const char *name)
+{
+    size_t len = strlen(name);
+    if (strncasecmp(line, name, len) != 0 || line[len] != ':') {
+        return NULL;
+    }
+    line += len + 1;
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    return line;
+}
+
+static bool contains_token(const char *value, const char *token)
+{
+    size_t len = strlen(token);
+    for (const char *p = value; *p; p++) {
+        if (strncasecmp(p, token, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t read_status(data_fetch_t *client, response_t *resp)
+{
+    char line[DATA_FETCH_LINE_LEN];
+    int minor;
+    do {
+        esp_err_t ret = read_line(client, line, sizeof(line));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (sscanf(line, "HTTP/1.%d %d", &minor, &resp->status) != 2) {
+            ESP_LOGW(TAG, "Bad status line");
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (resp->status / 100 == 1) {
+            // Interim answer: its headers, then the real one
+            do {
+                ret = read_line(client, line, sizeof(line));
+            } while (ret == ESP_OK && line[0]);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+    } while (resp->status / 100 == 1);
+    resp->close = minor == 0;
+    return ESP_OK;
+}
+
+static esp_err_t read_headers(data_fetch_t *client, response_t *resp)
+{
+    char line[DATA_FETCH_LINE_LEN];
+    while (true) {
+        esp_err_t ret = read_line(client, line, sizeof(line));
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (line[0] == '\0') {
+            return ESP_OK;
+        }
+        const char *v;
+        if ((v = header_value(line, "Content-Length")) != NULL) {
+            resp->length = strtoull(v, NULL, 10);
+            resp->has_length = true;
+        } else if ((v = header_value(line, "Transfer-Encoding")) != NULL) {
+            resp->chunked = contains_token(v, "chunked");
+        } else if ((v = header_value(line, "Connection")) != NULL) {
+            if (contains_token(v, "close")) {
+                resp->close = true;
+            } else if (contains_token(v, "keep-alive")) {
+                resp->close = false;
+            }
+        } else if ((v = header_value(line, "ETag")) != NULL) {
+            if (strlen(v) < sizeof(resp->etag)) {
+                strcpy(resp->etag, v);
+            }
+        } else if ((v = header_value(line, "Last-Modified")) != NULL) {
+            if (strlen(v) < sizeof(resp->last_modified)) {
+                strcpy(resp->last_modified, v);
+            }
+        } else if ((v = header_value(line, "Content-Range")) != NULL) {
+            // "bytes 1000-1999/5000", the total may be "*"
+            uint64_t first, last;
+            char total[21];
+            if (sscanf(v, "bytes %" SCNu64 "-%" SCNu64 "/%20s", &first, &last, total) == 3) {
+                resp->has_range = true;
+                resp->range_start = first;
+                resp->total = strtoull(total, NULL, 10);
+            }
+        }
+    }
+}
+
+// Up to max body bytes from rx into the sink (NULL: dropped)
+static esp_err_t body_take(data_fetch_t *client, uint64_t max, data_fetch_sink_t sink, void *ctx, size_t *took)
+{
+    esp_err_t ret = fill(client);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t n = client->rx_len - client->rx_pos;
+    if (n > max) {
+        n = max;
+    }
+    if (sink && (ret = sink(ctx, (const uint8_t *)client->rx + client->rx_pos, n)) != ESP_OK) {
+        return ret;
+    }
+    client->rx_pos += n;
+    client->stats.body_bytes += n;
+    *took = n;
+    return ESP_OK;
+}
+
+static esp_err_t read_body(data_fetch_t *client, response_t *resp, data_fetch_sink_t sink, void *ctx)
+{
+    size_t took;
+    esp_err_t ret = ESP_OK;
+    if (resp->chunked) {
+        char line[DATA_FETCH_LINE_LEN];
+        while (true) {
+            if ((ret = read_line(client, line, sizeof(line))) != ESP_OK) {
+                return ret;
+            }
+            char *end;
+            uint64_t size = strtoull(line, &end, 16);
+            if (end == line) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            if (size == 0) {
+                // Trailer, up to an empty line
+                do {
+                    ret = read_line(client, line, sizeof(line));
+                } while (ret == ESP_OK && line[0]);
+                return ret;
+            }
+            while (size > 0) {
+                if ((ret = body_take(client, size, sink, ctx, &took)) != ESP_OK) {
+                    return ret;
+                }
+                size -= took;
+            }
+            if ((ret = read_line(client, line, sizeof(line))) != ESP_OK) {
+                return ret;
+            }
+            if (line[0]) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+        }
+    }
+    if (resp->has_length) {
+        uint64_t left = resp->length;
+        while (left > 0) {
+            if ((ret = body_take(client, left, sink, ctx, &took)) != ESP_OK) {
+                return ret;
+            }
+            left -= took;
+        }
+        return ESP_OK;
+    }
+    // Neither: the body ends with the connection
+    resp->close = true;
+    while ((ret = body_take(client, UINT64_MAX, sink, ctx, &took)) == ESP_OK) {
+    }
+    return ret == ESP_ERR_INVALID_STATE ? ESP_OK : ret;
+}
+
+// Request sent and the answer read up to its body
+static esp_err_t exchange(data_fetch_t *client, const request_t *req, response_t *resp)
+{
+    esp_err_t ret;
+    for (int attempt = 0;; attempt++) {
+        memset(resp, 0, sizeof(*resp));
+        bool kept = client->conn != NULL;
+        if (!kept && (ret = conn_open(client)) != ESP_OK) {
+            return ret;
+        }
+        ret = send_request(client, req);
+        if (ret == ESP_OK) {
+            ret = read_status(client, resp);
+        }
+        if (ret == ESP_OK) {
+            break;
+        }
+        conn_close(client);
+        // A kept connection the server closed while idle fails before any answer: once more over a new one
+        if (!kept || attempt > 0 || ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_INVALID_SIZE) {
+            return ret;
+        }
+        client->stats.stale_retries++;
+        ESP_LOGD(TAG, "Kept connection closed by the server, reconnecting");
+    }
+    client->conn_requests++;
+    if ((ret = read_headers(client, resp)) != ESP_OK) {
+        conn_close(client);
+    }
+    return ret;
+}
+
+static esp_err_t feed_json(void *ctx, const uint8_t *data, size_t len)
+{
+    json_stream_feed(ctx, (const char *)data, len); // An error sticks in the parser, the body is read on
+    return ESP_OK;
+}
+
+static esp_err_t get_json(data_fetch_t *client, data_fetch_resource_t *res)
+{
+    request_t req = {
+        .path = res->path,
+        .accept = "application/json",
+        .etag = res->etag,
+        .last_modified = res->last_modified,
+    };
+    response_t resp;
+    esp_err_t ret = exchange(client, &req, &resp);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    res->status = resp.status;
+
+    json_stream_t parser;
+    json_stream_t *p = NULL;
+    void *into = res->scratch ? res->scratch : res->target;
+    if (resp.status == 200) {
+        if (res->scratch) {
+            memcpy(res->scratch, res->target, res->size);
+        }
+        json_stream_init(&parser, res->schema, into);
+        p = &parser;
+    }
+    bool no_body = resp.status == 304 || resp.status == 204;
+    if (!no_body && (ret = read_body(client, &resp, p ? feed_json : NULL, p)) != ESP_OK) {
+        conn_close(client);
+        return ret;
+    }
+    if (resp.close) {
+        conn_close(client);
+    }
+
+    if (resp.status == 304) {
+        client->stats.not_modified++;
+        return ESP_OK;
+    }
+    if (resp.status != 200) {
+        ESP_LOGW(TAG, "%s: HTTP %d", res->path, resp.status);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if ((ret = json_stream_finish(p)) != ESP_OK) {
+        ESP_LOGW(TAG, "%s: bad JSON (%s)", res->path, esp_err_to_name(ret));
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (res->scratch) {
+        memcpy(res->target, res->scratch, res->size);
+    }
+    strcpy(res->etag, resp.etag);
+    strcpy(res->last_modified, resp.last_modified);
+    return ESP_OK;
+}
+
+typedef struct {
+    data_fetch_download_t *dl;
+    uint64_t skip;                                                                                          /*!< Bytes before offset in a whole-file answer */
+} download_sink_t;
+
+static esp_err_t feed_download(void *ctx, const uint8_t *data, size_t len)
+{
+    download_sink_t *ds = ctx;
+    if (ds->skip >= len) {
+        ds->skip -= len;
+        return ESP_OK;
+    }
+    data += ds->skip;
+    len -= ds->skip;
+    ds->skip = 0;
+    return ds->dl->sink(ds->dl->ctx, data, len);
+}
+
+static esp_err_t download(data_fetch_t *client, data_fetch_download_t *dl)
+{
+    request_t req = { .path = dl->path, .accept = "*/*", .offset = dl->offset };
+    response_t resp;
+    esp_err_t ret = exchange(client, &req, &resp);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    dl->status = resp.status;
+    download_sink_t ds = { .dl = dl };
+    bool ok = resp.status == 206 ? resp.has_range && resp.range_start == dl->offset : resp.status == 200;
+    if (ok) {
+        // A server without ranges sends the whole file: the part already there is read and dropped
+        ds.skip = resp.status == 200 ? dl->offset : 0;
+        dl->total = resp.has_range ? resp.total : resp.has_length ? resp.length : 0;
+    }
+    if ((ret = read_body(client, &resp, ok ? feed_download : NULL, &ds)) != ESP_OK) {
+        conn_close(client);
+        return ret;
+    }
+    if (resp.close) {
+        conn_close(client);
+    }
+    if (!ok) {
+        ESP_LOGW(TAG, "%s: HTTP %d", dl->path, resp.status);
+        return resp.status == 404 ? ESP_ERR_NOT_FOUND : ESP_ERR_INVALID_RESPONSE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t data_fetch_init(data_fetch_t *client, const data_fetch_config_t *config)
+{
+    if (!config->host) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(client, 0, sizeof(*client));
+    client->config = *config;
+    if (!client->config.transport) {
+        client->config.transport = &data_fetch_transport_tcp;
+    }
+    if (client->config.timeout_ms == 0) {
+        client->config.timeout_ms = 5000;
+    }
+    return ESP_OK;
+}
+
+esp_err_t data_fetch_get(data_fetch_t *client, data_fetch_resource_t *resource)
+{
+    client->stats.requests++;
+    resource->status = 0;
+    esp_err_t ret = get_json(client, resource);
+    if (ret != ESP_OK) {
+        client->stats.errors++;
+    }
+    return ret;
+}
+
+esp_err_t data_fetch_download(data_fetch_t *client, data_fetch_download_t *dl)
+{
+    client->stats.requests++;
+    dl->status = 0;
+    esp_err_t ret = download(client, dl);
+    if (ret != ESP_OK) {
+        client->stats.errors++;
+    }
+    return ret;
+}
+
+void data_fetch_close(data_fetch_t *client)
+{
+    conn_close(client);
+}
+
+void data_fetch_get_stats(const data_fetch_t *client, data_fetch_stats_t *stats)
+{
+    *stats = client->stats;
+}
@@ -0,0 +1,141 @@
+#ifndef DATA_FETCH_H
+#define DATA_FETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "json_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DATA_FETCH_RX_LEN 512                                                                               /*!< Receive buffer, the only place a response passes through */
+#define DATA_FETCH_LINE_LEN 160                                                                             /*!< Longer header lines are cut, they are not among those read */
+#define DATA_FETCH_ETAG_LEN 64
+#define DATA_FETCH_DATE_LEN 32                                                                              /*!< "Wed, 21 Oct 2015 07:28:00 GMT" */
+
+#define DATA_FETCH_RECV_TIMEOUT (-2)                                                                        /*!< From data_fetch_transport_t recv: nothing within timeout_ms */
+
+/**
+ * @brief Byte stream to a server
+ */
+typedef struct {
+    esp_err_t (*connect)(void **conn, const char *host, uint16_t port, uint32_t timeout_ms);
+    int (*send)(void *conn, const void *data, size_t len);                                                  /*!< Bytes sent, < 0 on an error */
+    int (*recv)(void *conn, void *buf, size_t len);                                                         /*!< Bytes received, 0 when closed by the server, < 0 on an error or DATA_FETCH_RECV_TIMEOUT */
+    void (*close)(void *conn);
+} data_fetch_transport_t;
+
+extern const data_fetch_transport_t data_fetch_transport_tcp;
+extern const data_fetch_transport_t data_fetch_transport_tls;                                               /*!< esp_tls with the certificate bundle, firmware only */
+
+/**
+ * @brief One server
+ */
+typedef struct {
+    const char *host;
+    uint16_t port;
+    const data_fetch_transport_t *transport;                                                                /*!< NULL: data_fetch_transport_tcp */
+    uint32_t timeout_ms;                                                                                    /*!< Connect and each receive */
+} data_fetch_config_t;
+
+/**
+ * @brief Client counters, since data_fetch_init
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t connects;                                                                                      /*!< Connections opened: requests - connects went over a kept one */
+    uint32_t stale_retries;                                                                                 /*!< Requests sent again because the server had closed a kept connection */
+    uint32_t not_modified;                                                                                  /*!< 304 answers, no body */
+    uint32_t errors;
+    uint64_t body_bytes;
+} data_fetch_stats_t;
+
+/**
+ * @brief Client of one server. The connection is kept open between requests (HTTP/1.1 keep-alive).
+ */
+typedef struct {
+    data_fetch_config_t config;
+    void *conn;                                                                                             /*!< NULL when closed */
+    uint32_t conn_requests;                                                                                 /*!< Requests over the open connection */
+    char rx[DATA_FETCH_RX_LEN];
+    size_t rx_len;
+    size_t rx_pos;
+    data_fetch_stats_t stats;
+} data_fetch_t;
+
+/**
+ * @brief A JSON document on the server and the struct its fields go to
+ *
+ * The validators of the last 200 answer are sent with the next request, so an unchanged document costs a 304
+ * without a body.
+ */
+typedef struct {
+    const char *path;                                                                                       /*!< "/v1/forecast?latitude=..." */
+    const json_schema_t *schema;
+    void *target;                                                                                           /*!< Replaced by a complete 200 answer only */
+    void *scratch;                                                                                          /*!< Parsed into first, same size */
+    size_t size;
+    char etag[DATA_FETCH_ETAG_LEN];
+    char last_modified[DATA_FETCH_DATE_LEN];
+    int status;                                                                                             /*!< Of the last answer, 0 if there was none */
+} data_fetch_resource_t;
+
+/**
+ * @brief Takes the body of a download as it arrives
+ *
+ * @return Anything but ESP_OK stops the download, data_fetch_download returns it
+ */
+typedef esp_err_t (*data_fetch_sink_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief A file on the server, passed on in pieces of up to DATA_FETCH_RX_LEN bytes
+ */
+typedef struct {
+    const char *path;
+    uint64_t offset;                                                                                        /*!< Resume here (Range), 0: from the start */
+    data_fetch_sink_t sink;
+    void *ctx;
+    int status;                                                                                             /*!< Of the last answer, 0 if there was none */
+    uint64_t total;                                                                                         /*!< Length of the whole file if the server told, else 0 */
+} data_fetch_download_t;
+
+esp_err_t data_fetch_init(data_fetch_t *client, const data_fetch_config_t *config);
+
+/**
+ * @brief GET a resource and parse its body while it arrives
+ *
+ * @return ESP_OK with status 200 (target replaced) or 304 (target as it was); ESP_ERR_INVALID_RESPONSE for other
+ * statuses, a malformed answer or body; ESP_ERR_TIMEOUT or ESP_FAIL if the server could not be reached
+ */
+esp_err_t data_fetch_get(data_fetch_t *client, data_fetch_resource_t *resource);
+
+/**
+ * @brief GET a file from offset on and hand its bytes to the sink
+ *
+ * A server that ignores the range answers with the whole file; the bytes before offset are then received and
+ * dropped, the sink gets the same bytes either way.
+ *
+ * @return ESP_OK once the body is complete; the sink's error; ESP_ERR_NOT_FOUND for 404, ESP_ERR_INVALID_RESPONSE for
+ * other statuses or a malformed answer; ESP_ERR_TIMEOUT, ESP_ERR_INVALID_STATE (closed early) or ESP_FAIL if the
+ * connection failed, the download can be resumed from where the sink got to
+ */
+esp_err_t data_fetch_download(data_fetch_t *client, data_fetch_download_t *dl);
+
+/**
+ * @brief Close the kept connection, e.g. before a long sleep. The next request opens a new one.
+ */
+void data_fetch_close(data_fetch_t *client);
+
+/**
+ * @brief Copy of the counters
+ */
+void data_fetch_get_stats(const data_fetch_t *client, data_fetch_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,56 @@
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "esp_crt_bundle.h"
+#include "esp_tls.h"
+#include "data_fetch.h"
+
+static esp_err_t tls_connect(void **conn, const char *host, uint16_t port, uint32_t timeout_ms)
+{
+    esp_tls_cfg_t cfg = {
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .timeout_ms = timeout_ms,
+    };
+    esp_tls_t *tls = esp_tls_init();
+    if (!tls) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (esp_tls_conn_new_sync(host, strlen(host), port, &cfg, tls) != 1) {
+        esp_tls_conn_destroy(tls);
+        return ESP_FAIL;
+    }
+    // Reads give up after timeout_ms like those of plain TCP
+    int fd;
+    if (esp_tls_get_conn_sockfd(tls, &fd) == ESP_OK) {
+        struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    *conn = tls;
+    return ESP_OK;
+}
+
+static int tls_send(void *conn, const void *data, size_t len)
+{
+    return esp_tls_conn_write(conn, data, len);
+}
+
+static int tls_recv(void *conn, void *buf, size_t len)
+{
+    int n = esp_tls_conn_read(conn, buf, len);
+    if (n == ESP_TLS_ERR_SSL_WANT_READ || n == ESP_TLS_ERR_SSL_WANT_WRITE) {
+        return DATA_FETCH_RECV_TIMEOUT;
+    }
+    return n;
+}
+
+static void tls_close(void *conn)
+{
+    esp_tls_conn_destroy(conn);
+}
+
+const data_fetch_transport_t data_fetch_transport_tls = {
+    .connect = tls_connect,
+    .send = tls_send,
+    .recv = tls_recv,
+    .close = tls_close,
+};
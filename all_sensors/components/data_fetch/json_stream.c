@@ -0,0 +1,385 @@
+#include <stdlib.h>
+#include <string.h>
+#include "json_stream.h"
+
+enum {
+    S_VALUE,
+    S_FIRST_VALUE,                                                                                          /* After '[': a value or ']' */
+    S_FIRST_KEY,                                                                                            /* After '{': a key or '}' */
+    S_KEY,
+    S_COLON,
+    S_AFTER_VALUE,
+    S_STRING,
+    S_ESCAPE,
+    S_UNICODE,
+    S_TOKEN,
+    S_DONE,
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static void fail(json_stream_t *p, esp_err_t error)
+{
+    if (p->error == ESP_OK) {
+        p->error = error;
+    }
+}
+
+static bool path_append(json_stream_t *p, const char *s, size_t len)
+{
+    if (p->path_at + len >= JSON_STREAM_PATH_LEN) {
+        fail(p, ESP_ERR_INVALID_SIZE);
+        return false;
+    }
+    memcpy(p->path + p->path_at, s, len);
+    p->path_at += len;
+    p->path[p->path_at] = '\0';
+    return true;
+}
+
+// Where the value at the current path goes, NULL if nowhere
+static uint8_t *field_dest(json_stream_t *p, uint8_t type, const json_field_t **field)
+{
+    const json_schema_t *s = p->schema;
+    for (int i = 0; i < s->field_count; i++) {
+        const json_field_t *f = &s->fields[i];
+        bool same_kind = f->type == type || (type == JSON_FIELD_FLOAT && f->type == JSON_FIELD_INT);
+        if (!same_kind || strcmp(f->path, p->path) != 0) {
+            continue;
+        }
+        *field = f;
+        if (!strstr(f->path, "[]")) {
+            return p->target + f->offset;
+        }
+        // Item field: the outermost array picks the item
+        for (int level = 0; level < p->depth; level++) {
+            if (p->kind[level] != '[') {
+                continue;
+            }
+            uint16_t item = p->index[level];
+            if (item >= s->max_items) {
+                return NULL;
+            }
+            uint8_t *count = p->target + s->count_offset;
+            if (*count < item + 1) {
+                *count = item + 1;
+            }
+            return p->target + s->items_offset + item * s->item_size + f->offset;
+        }
+        return NULL;
+    }
+    return NULL;
+}
+
+static void value_done(json_stream_t *p)
+{
+    p->state = p->depth == 0 ? S_DONE : S_AFTER_VALUE;
+}
+
+static void push(json_stream_t *p, char kind)
+{
+    if (p->depth == JSON_STREAM_MAX_DEPTH) {
+        fail(p, ESP_ERR_INVALID_SIZE);
+        return;
+    }
+    p->kind[p->depth] = kind;
+    p->index[p->depth] = 0;
+    p->path_len[p->depth] = p->path_at;
+    p->depth++;
+    if (kind == '[') {
+        path_append(p, "[]", 2);
+        p->state = S_FIRST_VALUE;
+    } else {
+        p->state = S_FIRST_KEY;
+    }
+}
+
+static void pop(json_stream_t *p, char kind)
+{
+    if (p->depth == 0 || p->kind[p->depth - 1] != kind) {
+        fail(p, ESP_ERR_INVALID_RESPONSE);
+        return;
+    }
+    p->depth--;
+    p->path_at = p->path_len[p->depth];
+    p->path[p->path_at] = '\0';
+    value_done(p);
+}
+
+static void begin_key(json_stream_t *p)
+{
+    p->path_at = p->path_len[p->depth - 1];
+    p->path[p->path_at] = '\0';
+    if (p->path_at > 0) {
+        path_append(p, ".", 1);
+    }
+    p->in_key = true;
+    p->state = S_STRING;
+}
+
+static void begin_string_value(json_stream_t *p)
+{
+    const json_field_t *f = NULL;
+    p->str_out = (char *)field_dest(p, JSON_FIELD_STRING, &f);
+    p->str_size = p->str_out ? f->size : 0;
+    p->str_len = 0;
+    if (p->str_out && p->str_size == 0) {
+        p->str_out = NULL;
+    }
+    p->in_key = false;
+    p->state = S_STRING;
+}
+
+// One byte of a decoded string: of a key into the path, of a value into its field. A value that does not fit is cut
+// before the first character that does not fit whole.
+static void string_byte(json_stream_t *p, uint8_t c, uint8_t need)
+{
+    if (p->in_key) {
+        path_append(p, (const char *)&c, 1);
+        return;
+    }
+    if (!p->str_out) {
+        return;
+    }
+    bool continuation = (c & 0xC0) == 0x80;
+    if (!continuation && p->str_len + need >= p->str_size) {
+        p->str_size = p->str_len + 1; // full: nothing more goes in
+        return;
+    }
+    if (p->str_len + 1 < p->str_size) {
+        p->str_out[p->str_len++] = c;
+    }
+}
+
+static uint8_t utf8_length(uint8_t lead)
+{
+    return lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+}
+
+static void string_code_point(json_stream_t *p, uint16_t code)
+{
+    if (code >= 0xD800 && code <= 0xDFFF) {
+        string_byte(p, '?', 1); // UTF-16 surrogate halves: beyond the display font anyway
+    } else if (code < 0x80) {
+        string_byte(p, code, 1);
+    } else if (code < 0x800) {
+        string_byte(p, 0xC0 | code >> 6, 2);
+        string_byte(p, 0x80 | (code & 0x3F), 2);
+    } else {
+        string_byte(p, 0xE0 | code >> 12, 3);
+        string_byte(p, 0x80 | ((code >> 6) & 0x3F), 3);
+        string_byte(p, 0x80 | (code & 0x3F), 3);
+    }
+}
+
+static void end_string(json_stream_t *p)
+{
+    if (p->in_key) {
+        p->in_key = false;
+        p->state = S_COLON;
+        return;
+    }
+    if (p->str_out) {
+        p->str_out[p->str_len] = '\0';
+        p->values_set++;
+        p->str_out = NULL;
+    }
+    value_done(p);
+}
+
+static void end_token(json_stream_t *p)
+{
+    p->token[p->token_len] = '\0';
+    const json_field_t *f = NULL;
+    uint8_t *dest;
+    if (strcmp(p->token, "true") == 0 || strcmp(p->token, "false") == 0) {
+        if ((dest = field_dest(p, JSON_FIELD_BOOL, &f)) != NULL) {
+            bool v = p->token[0] == 't';
+            memcpy(dest, &v, sizeof(v));
+            p->values_set++;
+        }
+    } else if (strcmp(p->token, "null") != 0) {
+        char *end;
+        double v = strtod(p->token, &end);
+        if (*end != '\0' || !(p->token[0] == '-' || (p->token[0] >= '0' && p->token[0] <= '9'))) {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+            return;
+        }
+        if ((dest = field_dest(p, JSON_FIELD_FLOAT, &f)) != NULL) {
+            if (f->type == JSON_FIELD_INT) {
+                int32_t i = v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+                memcpy(dest, &i, sizeof(i));
+            } else {
+                float fv = v;
+                memcpy(dest, &fv, sizeof(fv));
+            }
+            p->values_set++;
+        }
+    }
+    value_done(p);
+}
+
+// One character; false to see it again in the new state
+static bool step(json_stream_t *p, char c)
+{
+    switch (p->state) {
+    case S_FIRST_VALUE:
+        if (is_space(c)) return true;
+        if (c == ']') {
+            pop(p, '[');
+            return true;
+        }
+        p->state = S_VALUE;
+        return false;
+
+    case S_VALUE:
+        if (is_space(c)) return true;
+        if (c == '{' || c == '[') {
+            push(p, c);
+        } else if (c == '"') {
+            begin_string_value(p);
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+            p->token[0] = c;
+            p->token_len = 1;
+            p->state = S_TOKEN;
+        } else {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+
+    case S_FIRST_KEY:
+    case S_KEY:
+        if (is_space(c)) return true;
+        if (c == '"') {
+            begin_key(p);
+        } else if (c == '}' && p->state == S_FIRST_KEY) {
+            pop(p, '{');
+        } else {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+
+    case S_COLON:
+        if (is_space(c)) return true;
+        if (c == ':') {
+            p->state = S_VALUE;
+        } else {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+
+    case S_AFTER_VALUE:
+        if (is_space(c)) return true;
+        if (c == ',') {
+            if (p->kind[p->depth - 1] == '{') {
+                p->state = S_KEY;
+            } else {
+                p->index[p->depth - 1]++;
+                p->state = S_VALUE;
+            }
+        } else if (c == '}' || c == ']') {
+            pop(p, c == '}' ? '{' : '[');
+        } else {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+
+    case S_STRING:
+        if (c == '"') {
+            end_string(p);
+        } else if (c == '\\') {
+            p->state = S_ESCAPE;
+        } else if ((uint8_t)c < 0x20) {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        } else {
+            string_byte(p, c, utf8_length(c));
+        }
+        return true;
+
+    case S_ESCAPE: {
+        static const char from[] = "\"\\/bfnrt";
+        static const char to[] = "\"\\/\b\f\n\r\t";
+        const char *at = c ? strchr(from, c) : NULL;
+        if (c == 'u') {
+            p->hex = 0;
+            p->hex_digits = 0;
+            p->state = S_UNICODE;
+        } else if (at) {
+            string_byte(p, to[at - from], 1);
+            p->state = S_STRING;
+        } else {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+    }
+
+    case S_UNICODE: {
+        int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+        if (digit < 0) {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+            return true;
+        }
+        p->hex = p->hex << 4 | digit;
+        if (++p->hex_digits == 4) {
+            string_code_point(p, p->hex);
+            p->state = S_STRING;
+        }
+        return true;
+    }
+
+    case S_TOKEN:
+        if (is_space(c) || c == ',' || c == '}' || c == ']') {
+            end_token(p);
+            return false;
+        }
+        if (p->token_len + 1 >= JSON_STREAM_TOKEN_LEN) {
+            fail(p, ESP_ERR_INVALID_SIZE);
+            return true;
+        }
+        p->token[p->token_len++] = c;
+        return true;
+
+    case S_DONE:
+        if (!is_space(c)) {
+            fail(p, ESP_ERR_INVALID_RESPONSE);
+        }
+        return true;
+    }
+    return true;
+}
+
+void json_stream_init(json_stream_t *parser, const json_schema_t *schema, void *target)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->schema = schema;
+    parser->target = target;
+    parser->state = S_VALUE;
+    if (schema->max_items) {
+        parser->target[schema->count_offset] = 0;
+    }
+}
+
+esp_err_t json_stream_feed(json_stream_t *parser, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && parser->error == ESP_OK) {
+        if (step(parser, data[i])) {
+            i++;
+        }
+    }
+    return parser->error;
+}
+
+esp_err_t json_stream_finish(json_stream_t *parser)
+{
+    if (parser->state == S_TOKEN && parser->depth == 0) {
+        end_token(parser);
+    }
+    if (parser->error == ESP_OK && parser->state != S_DONE) {
+        fail(parser, ESP_ERR_INVALID_RESPONSE);
+    }
+    return parser->error;
+}
@@ -0,0 +1,107 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_STREAM_MAX_DEPTH 8                                                                             /*!< Nested objects and arrays */
+#define JSON_STREAM_PATH_LEN 96                                                                             /*!< Longest path, "daily.temperature_2m_max[]" */
+#define JSON_STREAM_TOKEN_LEN 32                                                                            /*!< Longest number or literal */
+
+typedef enum {
+    JSON_FIELD_FLOAT,                                                                                       /*!< float */
+    JSON_FIELD_INT,                                                                                         /*!< int32_t */
+    JSON_FIELD_BOOL,                                                                                        /*!< bool */
+    JSON_FIELD_STRING,                                                                                      /*!< char[size], UTF-8, cut at a character boundary */
+} json_field_type_t;
+
+/**
+ * @brief Where one value of the document goes
+ *
+ * Paths name object members with dots from the root and array elements with "[]": "current.temperature_2m",
+ * "items[].start.dateTime". A path with "[]" is an item field: the index of the outermost array on the path picks
+ * the item, offset is within the item. null and values of another type leave the field as it was.
+ */
+typedef struct {
+    const char *path;
+    uint8_t type;                                                                                           /*!< json_field_type_t */
+    uint16_t offset;                                                                                        /*!< In the target, or in the item */
+    uint16_t size;                                                                                          /*!< Of the field, the terminator of a string included */
+} json_field_t;
+
+#define JSON_FIELD(type_, path_, struct_, member_)                                                          \
+    { (path_), (type_), offsetof(struct_, member_), sizeof(((struct_ *)0)->member_) }
+
+/** Item field: member_ of the elements of the array items_ in struct_ */
+#define JSON_ITEM_FIELD(type_, path_, struct_, items_, member_)                                             \
+    { (path_), (type_), offsetof(struct_, items_[0].member_) - offsetof(struct_, items_),                   \
+      sizeof(((struct_ *)0)->items_[0].member_) }
+
+/**
+ * @brief Fields to extract and the struct they go to
+ */
+typedef struct {
+    const json_field_t *fields;
+    uint8_t field_count;
+    uint16_t items_offset;                                                                                  /*!< Array of items in the target */
+    uint16_t item_size;
+    uint8_t max_items;                                                                                      /*!< 0: no item fields; later elements are skipped */
+    uint16_t count_offset;                                                                                  /*!< uint8_t in the target: items filled, at most max_items */
+} json_schema_t;
+
+/**
+ * @brief Parser state: a byte at a time, nothing of the document kept but the current path and a number being read
+ */
+typedef struct {
+    const json_schema_t *schema;
+    uint8_t *target;
+    uint8_t state;
+    uint8_t depth;
+    char kind[JSON_STREAM_MAX_DEPTH];                                                                       /*!< '{' or '[' per level */
+    uint16_t index[JSON_STREAM_MAX_DEPTH];                                                                  /*!< Element of each array level */
+    uint8_t path_len[JSON_STREAM_MAX_DEPTH];                                                                /*!< Path of the container at each level */
+    char path[JSON_STREAM_PATH_LEN];
+    uint8_t path_at;                                                                                        /*!< Length of path */
+    char token[JSON_STREAM_TOKEN_LEN];
+    uint8_t token_len;
+    bool in_key;
+    char *str_out;                                                                                          /*!< String field being filled, NULL when skipped */
+    uint16_t str_size;
+    uint16_t str_len;
+    uint8_t hex_digits;                                                                                     /*!< Of a \u escape */
+    uint16_t hex;
+    uint32_t values_set;                                                                                    /*!< Fields written */
+    esp_err_t error;
+} json_stream_t;
+
+/**
+ * @brief Start a document. Only the item count of the target is reset, fields not in the document keep their values.
+ */
+void json_stream_init(json_stream_t *parser, const json_schema_t *schema, void *target);
+
+/**
+ * @brief Parse the next bytes of the document, in pieces of any size
+ *
+ * @return ESP_ERR_INVALID_RESPONSE on malformed JSON, ESP_ERR_INVALID_SIZE beyond the depth, path or token limits;
+ * the error sticks until the next json_stream_init
+ */
+esp_err_t json_stream_feed(json_stream_t *parser, const char *data, size_t len);
+
+/**
+ * @brief End of the input
+ *
+ * @return ESP_ERR_INVALID_RESPONSE if the document is not complete
+ */
+esp_err_t json_stream_finish(json_stream_t *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,401 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dfplayer.h"
+
+#define TAG "DFPLAYER"
+
+#define DFPLAYER_START 0x7E
+#define DFPLAYER_VERSION 0xFF
+#define DFPLAYER_LEN 0x06
+#define DFPLAYER_END 0xEF
+#define DFPLAYER_BAUD 9600
+#define DFPLAYER_RX_BUFFER 256
+#define DFPLAYER_POLL_MS 20 // Driver task: longest wait for data, and so the latency of a queued command
+#define DFPLAYER_FINISHED_REPEAT_US 500000 // The module reports a finished track twice, back to back
+
+typedef struct {
+    uint8_t cmd;
+    uint16_t param;
+} dfplayer_cmd_t;
+
+struct dfplayer {
+    dfplayer_config_t config;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    volatile bool stop;
+    uint8_t rx[DFPLAYER_FRAME_LEN];
+    size_t rx_len;
+    bool pending;                                                                                           /*!< current sent, waiting for its ACK */
+    dfplayer_cmd_t current;
+    uint8_t attempts;
+    int64_t deadline_us;                                                                                    /*!< ACK of current due by */
+    int64_t next_send_us;                                                                                   /*!< End of the gap after the last command */
+    uint16_t finished_track;
+    int64_t finished_us;
+    bool busy;
+    portMUX_TYPE lock;                                                                                      /*!< busy and stats */
+    dfplayer_stats_t stats;
+};
+
+#define STAT_INC(h, field) do {                                                                             \
+        portENTER_CRITICAL(&(h)->lock);                                                                     \
+        (h)->stats.field++;                                                                                 \
+        portEXIT_CRITICAL(&(h)->lock);                                                                      \
+    } while (0)
+
+static uint16_t dfplayer_checksum(const uint8_t *frame)
+{
+    uint16_t sum = 0;
+    for (int i = 1; i < 7; i++) {
+        sum += frame[i];
+    }
+    return (uint16_t)-sum;
+}
+
+static bool dfplayer_frame_valid(const uint8_t *frame)
+{
+    return frame[0] == DFPLAYER_START && frame[1] == DFPLAYER_VERSION && frame[2] == DFPLAYER_LEN &&
+           frame[9] == DFPLAYER_END && ((frame[7] << 8) | frame[8]) == dfplayer_checksum(frame);
+}
+
+static void dfplayer_set_busy(dfplayer_handle_t h, bool busy)
+{
+    portENTER_CRITICAL(&h->lock);
+    h->busy = busy;
+    portEXIT_CRITICAL(&h->lock);
+}
+
+static void dfplayer_emit(dfplayer_handle_t h, dfplayer_event_type_t type, uint8_t cmd, uint16_t param)
+{
+    if (h->config.event_cb) {
+        dfplayer_event_t event = { .type = type, .cmd = cmd, .param = param };
+        h->config.event_cb(&event, h->config.event_ctx);
+    }
+}
+
+static void dfplayer_send(dfplayer_handle_t h)
+{
+    uint8_t frame[DFPLAYER_FRAME_LEN] = {
+        DFPLAYER_START, DFPLAYER_VERSION, DFPLAYER_LEN, h->current.cmd, 0x01,
+        h->current.param >> 8, h->current.param & 0xFF, 0, 0, DFPLAYER_END,
+    };
+    uint16_t checksum = dfplayer_checksum(frame);
+    frame[7] = checksum >> 8;
+    frame[8] = checksum & 0xFF;
+    uart_write_bytes(h->config.uart_port, frame, sizeof(frame));
+    STAT_INC(h, sent);
+    h->pending = true;
+    h->deadline_us = esp_timer_get_time() + h->config.ack_timeout_ms * 1000;
+}
+
+static void dfplayer_complete(dfplayer_handle_t h)
+{
+    h->pending = false;
+    h->next_send_us = esp_timer_get_time() + h->config.command_gap_ms * 1000;
+}
+
+// No ACK in time, or the module got the frame corrupted: send it again or give up
+static void dfplayer_retry(dfplayer_handle_t h)
+{
+    if (h->attempts < h->config.retries) {
+        h->attempts++;
+        STAT_INC(h, retries);
+        dfplayer_send(h);
+        return;
+    }
+    ESP_LOGW(TAG, "Command 0x%02x not acknowledged", h->current.cmd);
+    STAT_INC(h, timeouts);
+    dfplayer_complete(h);
+    dfplayer_emit(h, DFPLAYER_EVENT_TIMEOUT, h->current.cmd, h->current.param);
+}
+
+static bool dfplayer_starts_playback(uint8_t cmd)
+{
+    return cmd == DFPLAYER_CMD_PLAY || cmd == DFPLAYER_CMD_PLAY_MP3 || cmd == DFPLAYER_CMD_PLAY_FOLDER ||
+           cmd == DFPLAYER_CMD_RESUME;
+}
+
+static void dfplayer_handle_frame(dfplayer_handle_t h, uint8_t cmd, uint16_t param)
+{
+    switch (cmd) {
+    case DFPLAYER_MSG_ACK:
+        if (!h->pending) {
+            break;
+        }
+        STAT_INC(h, acked);
+        if (dfplayer_starts_playback(h->current.cmd)) {
+            dfplayer_set_busy(h, true);
+        } else if (h->current.cmd == DFPLAYER_CMD_PAUSE || h->current.cmd == DFPLAYER_CMD_STOP) {
+            dfplayer_set_busy(h, false);
+        }
+        dfplayer_complete(h);
+        break;
+    case DFPLAYER_MSG_ERROR:
+        STAT_INC(h, errors);
+        if (h->pending && param == DFPLAYER_ERR_CHECKSUM) {
+            dfplayer_retry(h);
+            break;
+        }
+        ESP_LOGW(TAG, "Error %d", param);
+        uint8_t failed = 0;
+        if (h->pending) {
+            failed = h->current.cmd;
+            dfplayer_complete(h);
+        }
+        if (failed == 0 || dfplayer_starts_playback(failed)) {
+            dfplayer_set_busy(h, false);
+        }
+        dfplayer_emit(h, DFPLAYER_EVENT_ERROR, failed, param);
+        break;
+    case DFPLAYER_MSG_FINISHED: {
+        int64_t now = esp_timer_get_time();
+        bool repeat = h->finished_us != 0 && param == h->finished_track &&
+                      now - h->finished_us < DFPLAYER_FINISHED_REPEAT_US;
+        h->finished_track = param;
+        h->finished_us = now;
+        if (repeat) {
+            break;
+        }
+        STAT_INC(h, finished);
+        dfplayer_set_busy(h, false);
+        dfplayer_emit(h, DFPLAYER_EVENT_FINISHED, 0, param);
+        break;
+    }
+    case DFPLAYER_MSG_ONLINE:
+        dfplayer_set_busy(h, false);
+        dfplayer_emit(h, DFPLAYER_EVENT_ONLINE, 0, param);
+        break;
+    case DFPLAYER_MSG_CARD_IN:
+        dfplayer_emit(h, DFPLAYER_EVENT_CARD_IN, 0, param);
+        break;
+    case DFPLAYER_MSG_CARD_OUT:
+        dfplayer_set_busy(h, false);
+        dfplayer_emit(h, DFPLAYER_EVENT_CARD_OUT, 0, param);
+        break;
+    default:
+        // Answers to queries, 0x42 to 0x4F. Without feedback the module answers instead of acknowledging.
+        if (cmd < DFPLAYER_CMD_QUERY_STATUS || cmd > 0x4F) {
+            break;
+        }
+        if (cmd == DFPLAYER_CMD_QUERY_STATUS) {
+            dfplayer_set_busy(h, (param & 0xFF) == 1);
+        }
+        if (h->pending && h->current.cmd == cmd) {
+            dfplayer_complete(h);
+        }
+        dfplayer_emit(h, DFPLAYER_EVENT_REPLY, cmd, param);
+        break;
+    }
+}
+
+// Frames are collected from their start byte; a bad one is dropped and the search goes on from the next start byte in it
+static void dfplayer_rx_byte(dfplayer_handle_t h, uint8_t b)
+{
+    if (h->rx_len == 0 && b != DFPLAYER_START) {
+        return;
+    }
+    h->rx[h->rx_len++] = b;
+    if (h->rx_len < DFPLAYER_FRAME_LEN) {
+        return;
+    }
+    h->rx_len = 0;
+    if (!dfplayer_frame_valid(h->rx)) {
+        STAT_INC(h, bad_frames);
+        for (int i = 1; i < DFPLAYER_FRAME_LEN; i++) {
+            if (h->rx[i] == DFPLAYER_START) {
+                h->rx_len = DFPLAYER_FRAME_LEN - i;
+                memmove(h->rx, &h->rx[i], h->rx_len);
+                break;
+            }
+        }
+        return;
+    }
+    dfplayer_handle_frame(h, h->rx[3], (h->rx[5] << 8) | h->rx[6]);
+}
+
+void dfplayer_process(dfplayer_handle_t h, uint32_t wait_ms)
+{
+    int64_t now = esp_timer_get_time();
+    if (h->pending && now >= h->deadline_us) {
+        dfplayer_retry(h);
+    }
+    if (!h->pending && now >= h->next_send_us && xQueueReceive(h->queue, &h->current, 0) == pdTRUE) {
+        h->attempts = 0;
+        dfplayer_send(h);
+    }
+
+    // Wait for data, but not past the ACK deadline or the end of the gap before a queued command
+    int64_t until = now + (int64_t)wait_ms * 1000;
+    if (h->pending && h->deadline_us < until) {
+        until = h->deadline_us;
+    } else if (!h->pending && uxQueueMessagesWaiting(h->queue) > 0 && h->next_send_us < until) {
+        until = h->next_send_us;
+    }
+    now = esp_timer_get_time();
+    int64_t tick_us = portTICK_PERIOD_MS * 1000;
+    TickType_t ticks = until > now ? (until - now + tick_us - 1) / tick_us : 0;
+
+    uint8_t buf[DFPLAYER_FRAME_LEN * 4];
+    int len = uart_read_bytes(h->config.uart_port, buf, 1, ticks);
+    if (len > 0) {
+        size_t more = 0;
+        uart_get_buffered_data_len(h->config.uart_port, &more);
+        if (more > sizeof(buf) - 1) {
+            more = sizeof(buf) - 1;
+        }
+        if (more > 0) {
+            len += uart_read_bytes(h->config.uart_port, &buf[1], more, 0);
+        }
+    }
+    for (int i = 0; i < len; i++) {
+        dfplayer_rx_byte(h, buf[i]);
+    }
+
+    if (h->pending && esp_timer_get_time() >= h->deadline_us) {
+        dfplayer_retry(h);
+    }
+}
+
+static void dfplayer_task(void *arg)
+{
+    dfplayer_handle_t h = arg;
+    while (!h->stop) {
+        dfplayer_process(h, DFPLAYER_POLL_MS);
+    }
+    h->task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t dfplayer_create(const dfplayer_config_t *config, dfplayer_handle_t *ret_handle)
+{
+    ESP_RETURN_ON_FALSE(config && ret_handle && config->queue_len > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    esp_err_t ret = ESP_OK;
+    dfplayer_handle_t h = calloc(1, sizeof(struct dfplayer));
+    ESP_RETURN_ON_FALSE(h, ESP_ERR_NO_MEM, TAG, "No memory for the driver");
+    h->config = *config;
+    h->lock = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+    h->queue = xQueueCreate(config->queue_len, sizeof(dfplayer_cmd_t));
+    ESP_GOTO_ON_FALSE(h->queue, ESP_ERR_NO_MEM, err, TAG, "No memory for the queue");
+
+    uart_config_t uart_config = {
+        .baud_rate = DFPLAYER_BAUD,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    ESP_GOTO_ON_ERROR(uart_param_config(config->uart_port, &uart_config), err, TAG, "UART config failed");
+    ESP_GOTO_ON_ERROR(uart_set_pin(config->uart_port, config->tx_io, config->rx_io, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE),
+                      err, TAG, "UART pins failed");
+    ESP_GOTO_ON_ERROR(uart_driver_install(config->uart_port, DFPLAYER_RX_BUFFER, 0, 0, NULL, 0), err, TAG, "UART driver install failed");
+
+    if (config->busy_io >= 0) {
+        gpio_config_t io_conf = {
+            .pin_bit_mask = 1ULL << config->busy_io,
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_ENABLE,
+        };
+        gpio_config(&io_conf);
+    }
+
+    if (config->task_stack > 0 &&
+        xTaskCreate(dfplayer_task, "dfplayer", config->task_stack, h, config->task_priority, &h->task) != pdPASS) {
+        ESP_LOGW(TAG, "No driver task, run dfplayer_process");
+        h->task = NULL;
+    }
+    *ret_handle = h;
+    return ESP_OK;
+
+err:
+    if (h->queue) {
+        vQueueDelete(h->queue);
+    }
+    free(h);
+    return ret;
+}
+
+esp_err_t dfplayer_delete(dfplayer_handle_t h)
+{
+    ESP_RETURN_ON_FALSE(h, ESP_ERR_INVALID_ARG, TAG, "Invalid handle");
+    h->stop = true;
+    while (h->task) {
+        vTaskDelay(1);
+    }
+    uart_driver_delete(h->config.uart_port);
+    vQueueDelete(h->queue);
+    free(h);
+    return ESP_OK;
+}
+
+esp_err_t dfplayer_command(dfplayer_handle_t h, uint8_t cmd, uint16_t param)
+{
+    ESP_RETURN_ON_FALSE(h, ESP_ERR_INVALID_ARG, TAG, "Invalid handle");
+    dfplayer_cmd_t c = { .cmd = cmd, .param = param };
+    if (xQueueSend(h->queue, &c, 0) != pdPASS) {
+        STAT_INC(h, dropped);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t dfplayer_play(dfplayer_handle_t h, uint16_t track)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_PLAY, track);
+}
+
+esp_err_t dfplayer_play_mp3(dfplayer_handle_t h, uint16_t track)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_PLAY_MP3, track);
+}
+
+esp_err_t dfplayer_pause(dfplayer_handle_t h)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_PAUSE, 0);
+}
+
+esp_err_t dfplayer_resume(dfplayer_handle_t h)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_RESUME, 0);
+}
+
+esp_err_t dfplayer_stop(dfplayer_handle_t h)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_STOP, 0);
+}
+
+esp_err_t dfplayer_set_volume(dfplayer_handle_t h, uint8_t volume)
+{
+    ESP_RETURN_ON_FALSE(volume <= DFPLAYER_VOLUME_MAX, ESP_ERR_INVALID_ARG, TAG, "Volume above %d", DFPLAYER_VOLUME_MAX);
+    return dfplayer_command(h, DFPLAYER_CMD_VOLUME, volume);
+}
+
+esp_err_t dfplayer_query_status(dfplayer_handle_t h)
+{
+    return dfplayer_command(h, DFPLAYER_CMD_QUERY_STATUS, 0);
+}
+
+bool dfplayer_is_busy(dfplayer_handle_t h)
+{
+    if (h->config.busy_io >= 0) {
+        return gpio_get_level(h->config.busy_io) == 0;
+    }
+    portENTER_CRITICAL(&h->lock);
+    bool busy = h->busy;
+    portEXIT_CRITICAL(&h->lock);
+    return busy;
+}
+
+void dfplayer_get_stats(dfplayer_handle_t h, dfplayer_stats_t *stats)
+{
+    portENTER_CRITICAL(&h->lock);
+    *stats = h->stats;
+    portEXIT_CRITICAL(&h->lock);
+}
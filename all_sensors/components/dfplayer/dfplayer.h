@@ -0,0 +1,178 @@
+#ifndef DFPLAYER_H
+#define DFPLAYER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DFPLAYER_FRAME_LEN 10                                                                               /*!< 7E FF 06 cmd feedback param(2) checksum(2) EF */
+#define DFPLAYER_VOLUME_MAX 30
+
+/**
+ * @brief Commands and messages of the module (DFPlayer Mini and its YX5200 clones)
+ */
+enum {
+    DFPLAYER_CMD_PLAY = 0x03,                                                                               /*!< Track by its index on the card */
+    DFPLAYER_CMD_VOLUME = 0x06,                                                                             /*!< 0..30 */
+    DFPLAYER_CMD_RESUME = 0x0D,
+    DFPLAYER_CMD_PAUSE = 0x0E,
+    DFPLAYER_CMD_PLAY_FOLDER = 0x0F,                                                                        /*!< Folder in the high byte, track in the low byte */
+    DFPLAYER_CMD_PLAY_MP3 = 0x12,                                                                           /*!< /mp3/NNNN*.mp3 */
+    DFPLAYER_CMD_STOP = 0x16,
+    DFPLAYER_MSG_CARD_IN = 0x3A,
+    DFPLAYER_MSG_CARD_OUT = 0x3B,
+    DFPLAYER_MSG_FINISHED = 0x3D,                                                                           /*!< Track played to the end, parameter is its index */
+    DFPLAYER_MSG_ONLINE = 0x3F,                                                                             /*!< Sent after power up or reset, parameter is the storage mask */
+    DFPLAYER_MSG_ERROR = 0x40,
+    DFPLAYER_MSG_ACK = 0x41,
+    DFPLAYER_CMD_QUERY_STATUS = 0x42,                                                                       /*!< Reply low byte: 0 stopped, 1 playing, 2 paused */
+};
+
+/**
+ * @brief Error codes of DFPLAYER_MSG_ERROR
+ */
+enum {
+    DFPLAYER_ERR_BUSY = 0x01,                                                                               /*!< Still initialising the card */
+    DFPLAYER_ERR_SLEEPING = 0x02,
+    DFPLAYER_ERR_RX = 0x03,                                                                                 /*!< Frame not received in full */
+    DFPLAYER_ERR_CHECKSUM = 0x04,                                                                           /*!< Frame corrupted on the line, the command is sent again */
+    DFPLAYER_ERR_TRACK_RANGE = 0x05,
+    DFPLAYER_ERR_NOT_FOUND = 0x06,                                                                          /*!< No such track */
+};
+
+/**
+ * @brief What happened, passed to the event callback
+ */
+typedef enum {
+    DFPLAYER_EVENT_ONLINE,                                                                                  /*!< Module ready, param is the storage mask */
+    DFPLAYER_EVENT_FINISHED,                                                                                /*!< Track param played to the end (reported once) */
+    DFPLAYER_EVENT_ERROR,                                                                                   /*!< Module refused cmd, param is the error code */
+    DFPLAYER_EVENT_TIMEOUT,                                                                                 /*!< cmd not acknowledged after all retries */
+    DFPLAYER_EVENT_REPLY,                                                                                   /*!< Answer to query cmd, param is the value */
+    DFPLAYER_EVENT_CARD_IN,
+    DFPLAYER_EVENT_CARD_OUT,
+} dfplayer_event_type_t;
+
+typedef struct {
+    dfplayer_event_type_t type;
+    uint8_t cmd;                                                                                            /*!< Command the event is about, 0 for unsolicited messages */
+    uint16_t param;
+} dfplayer_event_t;
+
+/**
+ * @brief Event callback. Runs in the driver task (or in dfplayer_process): keep it short and do not wait on the
+ * driver from it.
+ */
+typedef void (*dfplayer_event_cb_t)(const dfplayer_event_t *event, void *ctx);
+
+/**
+ * @brief Driver configuration
+ */
+typedef struct {
+    uart_port_t uart_port;
+    int tx_io;
+    int rx_io;
+    int busy_io;                                                                                            /*!< BUSY pin of the module (low while playing), -1 to track the state from the replies */
+    uint16_t ack_timeout_ms;                                                                                /*!< Wait for the ACK of a command before sending it again */
+    uint8_t retries;                                                                                        /*!< Sends after the first before DFPLAYER_EVENT_TIMEOUT */
+    uint16_t command_gap_ms;                                                                                /*!< Quiet time between commands, the module drops frames that come too fast */
+    uint8_t queue_len;                                                                                      /*!< Commands waiting to be sent */
+    uint32_t task_stack;                                                                                    /*!< Stack of the driver task, 0: no task, the caller runs dfplayer_process */
+    uint8_t task_priority;
+    dfplayer_event_cb_t event_cb;                                                                           /*!< NULL for none */
+    void *event_ctx;
+} dfplayer_config_t;
+
+#define DFPLAYER_DEFAULT_CONFIG() {                                                                         \
+    .uart_port = UART_NUM_2,                                                                                \
+    .tx_io = 17,                                                                                            \
+    .rx_io = 16,                                                                                            \
+    .busy_io = -1,                                                                                          \
+    .ack_timeout_ms = 200,                                                                                  \
+    .retries = 2,                                                                                           \
+    .command_gap_ms = 30,                                                                                   \
+    .queue_len = 8,                                                                                         \
+    .task_stack = 3072,                                                                                     \
+    .task_priority = 4,                                                                                     \
+}
+
+/**
+ * @brief Driver counters, since dfplayer_create
+ */
+typedef struct {
+    uint32_t sent;                                                                                          /*!< Frames written, retries included */
+    uint32_t acked;
+    uint32_t retries;
+    uint32_t timeouts;                                                                                      /*!< Commands given up on */
+    uint32_t errors;                                                                                        /*!< DFPLAYER_MSG_ERROR received */
+    uint32_t bad_frames;                                                                                    /*!< Received frames with a bad checksum or framing */
+    uint32_t dropped;                                                                                       /*!< Commands not queued, the queue was full */
+    uint32_t finished;                                                                                      /*!< Tracks played to the end */
+} dfplayer_stats_t;
+
+typedef struct dfplayer *dfplayer_handle_t;
+
+/**
+ * @brief Install the UART driver and start the driver task
+ *
+ * Without a task (task_stack 0, or when it cannot be created) nothing happens until the caller runs dfplayer_process.
+ */
+esp_err_t dfplayer_create(const dfplayer_config_t *config, dfplayer_handle_t *ret_handle);
+
+/**
+ * @brief Stop the task, drop the queued commands and remove the UART driver
+ */
+esp_err_t dfplayer_delete(dfplayer_handle_t handle);
+
+/**
+ * @brief Queue a command, never blocks. Commands go out in order, one at a time, each once the previous one is
+ * acknowledged (or given up on) and command_gap_ms has passed.
+ *
+ * @return ESP_ERR_TIMEOUT if the queue is full
+ */
+esp_err_t dfplayer_command(dfplayer_handle_t handle, uint8_t cmd, uint16_t param);
+
+esp_err_t dfplayer_play(dfplayer_handle_t handle, uint16_t track);
+esp_err_t dfplayer_play_mp3(dfplayer_handle_t handle, uint16_t track);
+esp_err_t dfplayer_pause(dfplayer_handle_t handle);
+esp_err_t dfplayer_resume(dfplayer_handle_t handle);
+esp_err_t dfplayer_stop(dfplayer_handle_t handle);
+
+/**
+ * @brief Queue a volume change, 0..DFPLAYER_VOLUME_MAX
+ *
+ * @return ESP_ERR_INVALID_ARG above DFPLAYER_VOLUME_MAX
+ */
+esp_err_t dfplayer_set_volume(dfplayer_handle_t handle, uint8_t volume);
+
+/**
+ * @brief Ask for the play state, the answer comes as DFPLAYER_EVENT_REPLY and updates dfplayer_is_busy
+ */
+esp_err_t dfplayer_query_status(dfplayer_handle_t handle);
+
+/**
+ * @brief Whether a track is playing: the BUSY pin if there is one, else the state from the replies
+ */
+bool dfplayer_is_busy(dfplayer_handle_t handle);
+
+/**
+ * @brief One turn of the driver loop: send the next command when due, read and handle what the module sent, give up
+ * on or repeat an unacknowledged command. Waits at most wait_ms for data. Only without a driver task.
+ */
+void dfplayer_process(dfplayer_handle_t handle, uint32_t wait_ms);
+
+/**
+ * @brief Copy of the counters
+ */
+void dfplayer_get_stats(dfplayer_handle_t handle, dfplayer_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "display_pacer.h"
+
+#define TAG "PACER"
+
+#define TICK_US (portTICK_PERIOD_MS * 1000)
+#define AVERAGE_SHIFT 3 // Moving averages over about 8 frames
+#define NEVER INT64_MAX
+
+static void average(uint32_t *avg, uint32_t sample)
+{
+    if (*avg == 0) {
+        *avg = sample;
+    } else {
+        *avg = (uint32_t)((int32_t)*avg + (((int32_t)sample - (int32_t)*avg) >> AVERAGE_SHIFT));
+    }
+}
+
+// Columns from the first to the last byte that differs, the whole width if the panel contents are not known
+static void changed_columns(const display_pacer_t *pacer, int page, display_pacer_region_t *region)
+{
+    const uint8_t *now = pacer->dev->_page[page]._segs;
+    const uint8_t *shown = pacer->shown[page];
+    int first = 0;
+    int end = pacer->dev->_width;
+    if (pacer->synced) {
+        while (now[first] == shown[first]) first++;
+        while (now[end - 1] == shown[end - 1]) end--;
+    }
+    region->page = page;
+    region->col = first;
+    region->len = end - first;
+}
+
+esp_err_t display_pacer_init(display_pacer_t *pacer, SSD1306_t *dev, const display_pacer_config_t *config)
+{
+    if (config->target_fps == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->config = *config;
+    if (pacer->config.max_divisor == 0) {
+        pacer->config.max_divisor = 1;
+    }
+    pacer->dev = dev;
+    pacer->period_us = 1000000 / config->target_fps;
+    pacer->next_us = esp_timer_get_time();
+    pacer->changed_us = pacer->next_us;
+    pacer->stats.divisor = 1;
+    return ESP_OK;
+}
+
+void display_pacer_wait(display_pacer_t *pacer)
+{
+    pacer->waiter = xTaskGetCurrentTaskHandle();
+    int64_t now = esp_timer_get_time();
+
+    // Late by whole slots: drop them and stay on the grid
+    if (!pacer->stats.idle && now >= pacer->next_us + pacer->period_us) {
+        int64_t missed = (now - pacer->next_us) / pacer->period_us;
+        pacer->next_us += missed * pacer->period_us;
+        pacer->stats.frames_skipped += missed;
+    }
+
+    while (now < pacer->next_us) {
+        TickType_t ticks = portMAX_DELAY;
+        if (pacer->next_us != NEVER) {
+            ticks = (pacer->next_us - now + TICK_US - 1) / TICK_US;
+        }
+        if (ulTaskNotifyTake(pdTRUE, ticks) > 0 || ticks == portMAX_DELAY) {
+            // Kicked: render now, the grid starts again from here
+            now = esp_timer_get_time();
+            pacer->stats.idle = false;
+            pacer->changed_us = now;
+            pacer->next_us = now;
+            break;
+        }
+        now = esp_timer_get_time();
+    }
+    pacer->render_start_us = esp_timer_get_time();
+}
+
+void display_pacer_present(display_pacer_t *pacer)
+{
+    SSD1306_t *dev = pacer->dev;
+    display_pacer_stats_t *st = &pacer->stats;
+    int64_t start = esp_timer_get_time();
+    uint32_t render = start - pacer->render_start_us;
+
+    st->frames_rendered++;
+    average(&st->render_us, render);
+    if (render > st->render_max_us) st->render_max_us = render;
+
+    uint32_t dirty = 0;
+    for (int page = 0; page < dev->_pages; page++) {
+        if (!pacer->synced || memcmp(dev->_page[page]._segs, pacer->shown[page], dev->_width) != 0) {
+            dirty |= 1 << page;
+        }
+    }
+
+    uint32_t transfer = 0;
+    if (dirty == 0) {
+        st->frames_clean++;
+        if (pacer->config.idle_after_ms && !st->idle && start - pacer->changed_us >= (int64_t)pacer->config.idle_after_ms * 1000) {
+            ESP_LOGD(TAG, "Idle after %" PRIu32 " ms without changes", pacer->config.idle_after_ms);
+            st->idle = true;
+        }
+    } else {
+        // Runs of changed pages, each in the panel's fastest write pattern
+        display_pacer_region_t regions[8];
+        int region_count = 0;
+        int page = 0;
+        while (page < dev->_pages) {
+            if ((dirty & (1 << page)) == 0) {
+                page++;
+                continue;
+            }
+            int pages = 1;
+            while (page + pages < dev->_pages && (dirty & (1 << (page + pages)))) pages++;
+            ssd1306_show_pages(dev, page, pages, 0, dev->_width);
+            for (int i = page; i < page + pages; i++) {
+                if (pacer->observer) {
+                    changed_columns(pacer, i, &regions[region_count++]);
+                }
+                memcpy(pacer->shown[i], dev->_page[i]._segs, dev->_width);
+            }
+            st->bytes_sent += pages * dev->_width;
+            page += pages;
+        }
+        ssd1306_flush(dev);
+        pacer->synced = true;
+        if (pacer->observer) {
+            pacer->observer(pacer->observer_ctx, (const uint8_t (*)[128])pacer->shown, regions, region_count);
+        }
+        pacer->changed_us = start;
+        st->idle = false;
+
+        transfer = esp_timer_get_time() - start;
+        st->frames_sent++;
+        average(&st->transfer_us, transfer);
+        if (transfer > st->transfer_max_us) st->transfer_max_us = transfer;
+    }
+    if (render + transfer > pacer->period_us) {
+        st->overruns++;
+    }
+
+    // Use every divisor-th slot, so that rendering and sending a frame fit in the slots it has. Going back up to
+    // a faster rate waits until the frame would fit with a fifth to spare, so the rate does not flap.
+    uint32_t cost = st->render_us + st->transfer_us;
+    uint32_t needed = (cost + pacer->period_us - 1) / pacer->period_us;
+    if (needed < 1) needed = 1;
+    if (needed > pacer->config.max_divisor) needed = pacer->config.max_divisor;
+    if (needed > st->divisor || (needed < st->divisor && cost * 5 < (st->divisor - 1) * pacer->period_us * 4)) {
+        if (needed != st->divisor) {
+            ESP_LOGD(TAG, "Frame costs %" PRIu32 " us, every %" PRIu32 ". slot", cost, needed);
+        }
+        st->divisor = needed;
+    }
+
+    if (st->idle) {
+        pacer->next_us = pacer->config.idle_fps ? pacer->next_us + 1000000 / pacer->config.idle_fps : NEVER;
+    } else {
+        pacer->next_us += st->divisor * pacer->period_us;
+        st->frames_skipped += st->divisor - 1;
+    }
+}
+
+void display_pacer_kick(display_pacer_t *pacer)
+{
+    TaskHandle_t waiter = pacer->waiter;
+    if (waiter) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+void display_pacer_align(display_pacer_t *pacer, int64_t boundary_us)
+{
+    if (pacer->next_us == NEVER) {
+        return;
+    }
+    int64_t unit = pacer->stats.idle ? 1000000 / pacer->config.idle_fps : pacer->stats.divisor * pacer->period_us;
+    int64_t phase = ((pacer->next_us - boundary_us) % unit + unit) % unit;
+    if (phase) {
+        pacer->next_us += unit - phase;
+    }
+}
+
+void display_pacer_invalidate(display_pacer_t *pacer)
+{
+    pacer->synced = false;
+}
+
+void display_pacer_restore(display_pacer_t *pacer, const uint8_t shown[][128])
+{
+    SSD1306_t *dev = pacer->dev;
+    display_pacer_region_t regions[8];
+    for (int page = 0; page < dev->_pages; page++) {
+        memcpy(pacer->shown[page], shown[page], dev->_width);
+        memcpy(dev->_page[page]._segs, shown[page], dev->_width);
+        regions[page] = (display_pacer_region_t){ .page = page, .col = 0, .len = dev->_width };
+    }
+    pacer->synced = true;
+    if (pacer->observer) {
+        pacer->observer(pacer->observer_ctx, (const uint8_t (*)[128])pacer->shown, regions, dev->_pages);
+    }
+}
+
+void display_pacer_set_observer(display_pacer_t *pacer, display_pacer_observer_t observer, void *ctx)
+{
+    pacer->observer = observer;
+    pacer->observer_ctx = ctx;
+}
+
+void display_pacer_get_stats(const display_pacer_t *pacer, display_pacer_stats_t *stats)
+{
+    *stats = pacer->stats;
+}
@@ -0,0 +1,148 @@
+#ifndef DISPLAY_PACER_H
+#define DISPLAY_PACER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ssd1306.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Pacer configuration
+ */
+typedef struct {
+    uint16_t target_fps;                                                                                    /*!< Frame slots per second */
+    uint16_t idle_fps;                                                                                      /*!< Slots per second while idle, 0: only display_pacer_kick wakes the caller */
+    uint32_t idle_after_ms;                                                                                 /*!< Idle once nothing changed for this long, 0 never idles */
+    uint8_t max_divisor;                                                                                    /*!< Adaptive skipping renders at least every max_divisor-th slot */
+} display_pacer_config_t;
+
+#define DISPLAY_PACER_DEFAULT_CONFIG() {                                                                    \
+    .target_fps = 10,                                                                                       \
+    .idle_fps = 1,                                                                                          \
+    .idle_after_ms = 3000,                                                                                  \
+    .max_divisor = 4,                                                                                       \
+}
+
+/**
+ * @brief Pacer counters, since display_pacer_init
+ */
+typedef struct {
+    uint32_t frames_rendered;                                                                               /*!< Slots the caller rendered in */
+    uint32_t frames_sent;                                                                                   /*!< Rendered frames with at least one page sent */
+    uint32_t frames_clean;                                                                                  /*!< Rendered frames equal to the panel, nothing sent */
+    uint32_t frames_skipped;                                                                                /*!< Slots dropped: missed while late or left out by adaptive skipping */
+    uint64_t bytes_sent;                                                                                    /*!< Display data sent, positioning commands not counted */
+    uint32_t render_us;                                                                                     /*!< Render time, moving average */
+    uint32_t transfer_us;                                                                                   /*!< Transfer time of the frames sent, moving average */
+    uint32_t render_max_us;
+    uint32_t transfer_max_us;
+    uint32_t overruns;                                                                                      /*!< Frames whose render and transfer did not fit in one slot */
+    uint8_t divisor;                                                                                        /*!< Slots per rendered frame now, 1 at full rate */
+    bool idle;                                                                                              /*!< Nothing changed for idle_after_ms */
+} display_pacer_stats_t;
+
+/**
+ * @brief Columns of one page that changed in a frame
+ */
+typedef struct {
+    uint8_t page;
+    uint8_t col;
+    uint8_t len;
+} display_pacer_region_t;
+
+/**
+ * @brief Told about every frame that sent something, with the changed columns of each page sent; shown holds the
+ * pages as they are now on the panel. Called from display_pacer_present in the rendering task, must not block.
+ */
+typedef void (*display_pacer_observer_t)(void *ctx, const uint8_t shown[][128], const display_pacer_region_t *regions,
+                                         int count);
+
+/**
+ * @brief Pacer state, one per panel. Owned by the task that renders; display_pacer_kick may come from any task.
+ */
+typedef struct {
+    display_pacer_config_t config;
+    SSD1306_t *dev;
+    uint8_t shown[8][128];                                                                                  /*!< Pages as last sent to the panel */
+    bool synced;                                                                                            /*!< shown matches the panel */
+    int64_t period_us;                                                                                      /*!< One slot at target_fps */
+    int64_t next_us;                                                                                        /*!< Start of the slot display_pacer_wait waits for */
+    int64_t render_start_us;
+    int64_t changed_us;                                                                                     /*!< Last frame that sent something */
+    TaskHandle_t waiter;
+    display_pacer_observer_t observer;
+    void *observer_ctx;
+    display_pacer_stats_t stats;
+} display_pacer_t;
+
+/**
+ * @brief Set up pacing for a panel initialised with ssd1306_init. The first frame is sent in full.
+ *
+ * @return ESP_ERR_INVALID_ARG if target_fps is 0
+ */
+esp_err_t display_pacer_init(display_pacer_t *pacer, SSD1306_t *dev, const display_pacer_config_t *config);
+
+/**
+ * @brief Block until the next slot to render in
+ *
+ * Slots are on a fixed grid of 1 / target_fps, like a vsync. Slots the caller was too late for are dropped rather
+ * than caught up, and when rendering and sending a frame takes longer than a slot only every n-th slot is used.
+ * While idle the grid is 1 / idle_fps; display_pacer_kick ends the wait at once.
+ */
+void display_pacer_wait(display_pacer_t *pacer);
+
+/**
+ * @brief Send the pages of the buffer that differ from the panel and account the frame
+ *
+ * Draw into the buffer only in between (_ssd1306_text, _ssd1306_pixel, ...). Returns when the frame is on the
+ * panel. With nothing changed nothing is sent.
+ */
+void display_pacer_present(display_pacer_t *pacer);
+
+/**
+ * @brief Leave idle and wake display_pacer_wait now, e.g. on motion. Task context.
+ */
+void display_pacer_kick(display_pacer_t *pacer);
+
+/**
+ * @brief Move the grid, later by less than one slot, so that a slot starts at boundary_us (esp_timer time)
+ *
+ * For content that changes at known instants, e.g. a clock that ticks on the second: with a slot starting there
+ * the new value is shown right after it changes instead of up to a slot later. Call from the rendering task.
+ */
+void display_pacer_align(display_pacer_t *pacer, int64_t boundary_us);
+
+/**
+ * @brief Forget what the panel shows, the next frame is sent in full. For writes that bypass the pacer.
+ */
+void display_pacer_invalidate(display_pacer_t *pacer);
+
+/**
+ * @brief The panel still shows shown, e.g. kept in RTC memory through deep sleep while its RAM held it: take it as
+ * sent and as the frame buffer, so the next frame sends only what changed. The observer is told of all of it.
+ */
+void display_pacer_restore(display_pacer_t *pacer, const uint8_t shown[][128]);
+
+/**
+ * @brief Have the changes of each frame sent reported to observer, NULL to stop. Call from the rendering task.
+ *
+ * The changed columns are only looked for while an observer is set, and a frame with nothing changed calls nothing.
+ */
+void display_pacer_set_observer(display_pacer_t *pacer, display_pacer_observer_t observer, void *ctx);
+
+/**
+ * @brief Copy of the counters
+ */
+void display_pacer_get_stats(const display_pacer_t *pacer, display_pacer_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -12,7 +12,12 @@
 #include "freertos/semphr.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "i2c_bus.h"
+#include "i2c_bus_health.h"
+#if CONFIG_I2C_BUS_TRACE
+#include "i2c_bus_trace.h"
+#endif
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
 #include "i2c_bus_soft.h"
 #endif
@@ -31,6 +36,7 @@ typedef struct {
     i2c_config_t conf_active;                      /*!< I2C active configuration */
     SemaphoreHandle_t mutex;                       /*!< mutex to achieve thread-safe */
     int32_t ref_counter;                           /*!< reference count */
+    uint32_t recoveries;                           /*!< number of bus recoveries */
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     i2c_master_soft_bus_handle_t soft_bus_handle;  /*!< I2C master soft bus handle */
 #endif
@@ -40,6 +46,7 @@ typedef struct {
     uint8_t dev_addr;                              /*!< device address */
     i2c_config_t conf;                             /*!< I2C active configuration */
     i2c_bus_t *i2c_bus;                            /*!< I2C bus */
+    i2c_bus_health_t health;                       /*!< transfer statistics */
 } i2c_bus_device_t;
 
 static const char *TAG = "i2c_bus";
@@ -80,11 +87,27 @@ static i2c_bus_t s_i2c_bus[I2C_NUM_MAX];
         return (ret); \
     }
 
+#if CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+#define I2C_BUS_MEM_ADDR_LEN(mem_address, null_address, len) (len)
+#else
+#define I2C_BUS_MEM_ADDR_LEN(mem_address, null_address, len) ((mem_address) != (null_address) ? (len) : 0)
+#endif
+
+#if CONFIG_I2C_BUS_TRACE
+#define I2C_BUS_TRACE_TRANSFER(dev, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len) \
+        i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS, (dev)->i2c_bus->i2c_port, (dev)->dev_addr, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len)
+#else
+#define I2C_BUS_TRACE_TRANSFER(dev, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len)
+#endif
+
 static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf);
 static esp_err_t i2c_driver_deinit(i2c_port_t port);
 static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, const uint8_t *data);
 static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, uint8_t *data);
 inline static bool i2c_config_compare(i2c_port_t port, const i2c_config_t *conf);
+static void i2c_bus_transfer_done(i2c_bus_device_t *i2c_device, esp_err_t ret, int64_t start_us);
+static esp_err_t i2c_bus_recover_locked(i2c_bus_t *i2c_bus);
+static esp_err_t i2c_bus_probe_locked(i2c_bus_t *i2c_bus, uint8_t dev_addr);
 /**************************************** Public Functions (Application level)*********************************************/
 
 i2c_bus_handle_t i2c_bus_create(i2c_port_t port, const i2c_config_t *conf)
@@ -147,18 +170,7 @@ uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num)
     I2C_BUS_MUTEX_TAKE_MAX_DELAY(i2c_bus->mutex, 0);
 
     for (uint8_t dev_address = 1; dev_address < 127; dev_address++) {
-#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
-        if (i2c_bus->i2c_port > I2C_NUM_MAX) {
-            ret  = i2c_master_soft_bus_probe(i2c_bus->soft_bus_handle, dev_address);
-        } else
-#endif
-        {
-            i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-            i2c_master_start(cmd);
-            i2c_master_write_byte(cmd, (dev_address << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
-            i2c_master_stop(cmd);
-            ret = i2c_master_cmd_begin(i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT);
-        }
+        ret = i2c_bus_probe_locked(i2c_bus, dev_address);
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "found i2c device address = 0x%02x", dev_address);
             if (buf != NULL && device_count < num) {
@@ -171,6 +183,17 @@ uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num)
     return device_count;
 }
 
+esp_err_t i2c_bus_probe(i2c_bus_handle_t bus_handle, uint8_t dev_addr)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Handle error", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    I2C_BUS_MUTEX_TAKE(i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    esp_err_t ret = i2c_bus_probe_locked(i2c_bus, dev_addr);
+    I2C_BUS_MUTEX_GIVE(i2c_bus->mutex, ESP_FAIL);
+    return ret;
+}
+
 uint32_t i2c_bus_get_current_clk_speed(i2c_bus_handle_t bus_handle)
 {
     I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", 0);
@@ -343,7 +366,13 @@ esp_err_t i2c_bus_cmd_begin(i2c_bus_device_handle_t dev_handle, i2c_cmd_handle_t
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
     esp_err_t ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
+#if CONFIG_I2C_BUS_TRACE
+    i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS | I2C_BUS_TRACE_FLAG_OPAQUE, i2c_device->i2c_bus->i2c_port, i2c_device->dev_addr, start_us, ret,
+                         NULL, 0, NULL, 0, NULL, 0);
+#endif
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -356,6 +385,7 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
     esp_err_t ret = ESP_FAIL;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     if (i2c_device->i2c_bus->i2c_port > I2C_NUM_MAX) {
@@ -384,6 +414,8 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
         ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
         i2c_cmd_link_delete(cmd);
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, &mem_address, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_ADDR, 1), NULL, 0, data, data_len);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -399,6 +431,7 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     if (i2c_device->i2c_bus->i2c_port > I2C_NUM_MAX) {
@@ -426,6 +459,8 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
         ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
         i2c_cmd_link_delete(cmd);
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, memAddress8, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_16BIT_ADDR, 2), NULL, 0, data, data_len);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -438,6 +473,7 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
     esp_err_t ret = ESP_OK;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     if (i2c_device->i2c_bus->i2c_port > I2C_NUM_MAX) {
@@ -463,6 +499,8 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
         ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
         i2c_cmd_link_delete(cmd);
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, &mem_address, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_ADDR, 1), data, data_len, NULL, 0);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -478,6 +516,7 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     if (i2c_device->i2c_bus->i2c_port > I2C_NUM_MAX) {
@@ -505,10 +544,45 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
         ret = i2c_master_cmd_begin_with_conf(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, &i2c_device->conf);
         i2c_cmd_link_delete(cmd);
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, memAddress8, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_16BIT_ADDR, 2), data, data_len, NULL, 0);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
 
+/**************************************** Public Functions (Health)*********************************************/
+
+esp_err_t i2c_bus_device_get_stats(i2c_bus_device_handle_t dev_handle, i2c_bus_device_stats_t *stats)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(stats != NULL, "stats pointer error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    i2c_bus_health_get_stats(&i2c_device->health, i2c_device->i2c_bus->recoveries, stats);
+    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_device_reset_stats(i2c_bus_device_handle_t dev_handle)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    memset(&i2c_device->health, 0, sizeof(i2c_device->health));
+    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_recover(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    esp_err_t ret = i2c_bus_recover_locked(i2c_bus);
+    I2C_BUS_MUTEX_GIVE(i2c_bus->mutex, ESP_FAIL);
+    return ret;
+}
+
 /**************************************** Private Functions*********************************************/
 static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf)
 {
@@ -593,3 +667,67 @@ inline static bool i2c_config_compare(i2c_port_t port, const i2c_config_t *conf)
 
     return false;
 }
+
+/**
+ * @brief Account a finished transfer in the device statistics and recover the bus if it looks stuck.
+ *        Must be called with the bus mutex held.
+ *
+ * @param i2c_device device the transfer was addressed to
+ * @param ret result of the transfer
+ * @param start_us esp_timer time the transfer was started at
+ */
+static void i2c_bus_transfer_done(i2c_bus_device_t *i2c_device, esp_err_t ret, int64_t start_us)
+{
+    i2c_bus_t *i2c_bus = i2c_device->i2c_bus;
+    i2c_bus_health_class_t cls = i2c_bus_health_classify(ret, i2c_bus->conf_active.sda_io_num);
+    i2c_bus_health_record(&i2c_device->health, cls, ret, (uint32_t)(esp_timer_get_time() - start_us));
+    if (i2c_bus_health_should_recover(&i2c_device->health, cls)) {
+        ESP_LOGW(TAG, "i2c%d: %s talking to 0x%02x, %"PRIu32" consecutive errors, recovering bus", i2c_bus->i2c_port, esp_err_to_name(ret),
+                 i2c_device->dev_addr, i2c_device->health.consecutive_errors);
+        i2c_bus_recover_locked(i2c_bus);
+    }
+}
+
+/**
+ * @brief Free SDA if a device holds it and re-install the driver. Must be called with the bus mutex held.
+ */
+static esp_err_t i2c_bus_recover_locked(i2c_bus_t *i2c_bus)
+{
+    i2c_port_t port = i2c_bus->i2c_port;
+    i2c_config_t conf = i2c_bus->conf_active;
+    if (i2c_bus->is_init) {
+        i2c_driver_deinit(port);
+    }
+    esp_err_t ret = i2c_bus_health_line_recover(conf.sda_io_num, conf.scl_io_num, conf.master.clk_speed);
+    esp_err_t reinit = i2c_driver_reinit(port, &conf);
+    i2c_bus->recoveries++;
+    ESP_LOGW(TAG, "i2c%d bus recovery %s, recoveries=%"PRIu32"", port, esp_err_to_name(ret), i2c_bus->recoveries);
+    return reinit != ESP_OK ? reinit : ret;
+}
+
+/**
+ * @brief Address the device with an empty write. Must be called with the bus mutex held.
+ */
+static esp_err_t i2c_bus_probe_locked(i2c_bus_t *i2c_bus, uint8_t dev_addr)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret;
+#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
+    if (i2c_bus->i2c_port > I2C_NUM_MAX) {
+        ret = i2c_master_soft_bus_probe(i2c_bus->soft_bus_handle, dev_addr);
+    } else
+#endif
+    {
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
+        i2c_master_stop(cmd);
+        ret = i2c_master_cmd_begin(i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT);
+        i2c_cmd_link_delete(cmd);
+    }
+#if CONFIG_I2C_BUS_TRACE
+    i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS, i2c_bus->i2c_port, dev_addr, start_us, ret, NULL, 0, NULL, 0, NULL, 0);
+#endif
+    (void)start_us;
+    return ret;
+}
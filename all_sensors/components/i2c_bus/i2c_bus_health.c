@@ -0,0 +1,187 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "driver/gpio.h"
+#include "i2c_bus_health.h"
+
+#define I2C_BUS_RECOVERY_CLOCKS 9
+#define I2C_BUS_RECOVERY_MAX_HZ 100000
+
+static const char *TAG = "i2c_bus_health";
+
+i2c_bus_health_class_t i2c_bus_health_classify(esp_err_t err, int sda_io)
+{
+    switch (err) {
+    case ESP_OK:
+        return I2C_BUS_HEALTH_OK;
+    case ESP_FAIL:
+    case ESP_ERR_NOT_FOUND:
+    case ESP_ERR_INVALID_RESPONSE:
+        return I2C_BUS_HEALTH_NACK;
+    default:
+        break;
+    }
+
+    if (sda_io >= 0 && gpio_get_level(sda_io) == 0) {
+        return I2C_BUS_HEALTH_BUS_STUCK;
+    }
+    switch (err) {
+    case ESP_ERR_TIMEOUT:
+        return I2C_BUS_HEALTH_TIMEOUT;
+    case ESP_ERR_INVALID_STATE:
+        return I2C_BUS_HEALTH_ARB_LOST;
+    default:
+        return I2C_BUS_HEALTH_OTHER;
+    }
+}
+
+void i2c_bus_health_record(i2c_bus_health_t *health, i2c_bus_health_class_t cls, esp_err_t err, uint32_t latency_us)
+{
+    health->transfers++;
+    if (latency_us > health->latency_max_us) {
+        health->latency_max_us = latency_us;
+    }
+    int bucket = 0;
+    while (bucket < I2C_BUS_HEALTH_LATENCY_BUCKETS - 1 && latency_us >= (32U << bucket)) {
+        bucket++;
+    }
+    health->latency_hist[bucket]++;
+
+    switch (cls) {
+    case I2C_BUS_HEALTH_OK:
+        health->consecutive_errors = 0;
+        health->last_ok_time_us = esp_timer_get_time();
+        return;
+    case I2C_BUS_HEALTH_NACK:
+        health->nack++;
+        break;
+    case I2C_BUS_HEALTH_TIMEOUT:
+        health->timeout++;
+        break;
+    case I2C_BUS_HEALTH_ARB_LOST:
+        health->arb_lost++;
+        break;
+    case I2C_BUS_HEALTH_BUS_STUCK:
+        health->bus_stuck++;
+        break;
+    default:
+        health->other++;
+        break;
+    }
+    health->consecutive_errors++;
+    health->last_error = err;
+}
+
+bool i2c_bus_health_should_recover(const i2c_bus_health_t *health, i2c_bus_health_class_t cls)
+{
+#if CONFIG_I2C_BUS_AUTO_RECOVERY
+    if (cls == I2C_BUS_HEALTH_OK) {
+        return false;
+    }
+    if (cls == I2C_BUS_HEALTH_BUS_STUCK) {
+        return true;
+    }
+    uint32_t n = health->consecutive_errors;
+    if (n < CONFIG_I2C_BUS_AUTO_RECOVERY_THRESHOLD || n % CONFIG_I2C_BUS_AUTO_RECOVERY_THRESHOLD) {
+        return false;
+    }
+    n /= CONFIG_I2C_BUS_AUTO_RECOVERY_THRESHOLD;
+    return (n & (n - 1)) == 0;                                                                               /*!< threshold, 2x, 4x, 8x ... */
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Latency below which `permille` of the transfers completed, as the upper bound of the histogram bucket
+ */
+static uint32_t i2c_bus_health_percentile(const i2c_bus_health_t *health, uint32_t permille)
+{
+    if (health->transfers == 0) {
+        return 0;
+    }
+    uint64_t target = ((uint64_t)health->transfers * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (int i = 0; i < I2C_BUS_HEALTH_LATENCY_BUCKETS; i++) {
+        seen += health->latency_hist[i];
+        if (seen >= target) {
+            uint32_t bound = (i == I2C_BUS_HEALTH_LATENCY_BUCKETS - 1) ? health->latency_max_us : (32U << i);
+            return bound < health->latency_max_us ? bound : health->latency_max_us;
+        }
+    }
+    return health->latency_max_us;
+}
+
+void i2c_bus_health_get_stats(const i2c_bus_health_t *health, uint32_t bus_recoveries, i2c_bus_device_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->transfers = health->transfers;
+    stats->nack = health->nack;
+    stats->timeout = health->timeout;
+    stats->arb_lost = health->arb_lost;
+    stats->bus_stuck = health->bus_stuck;
+    stats->other = health->other;
+    stats->consecutive_errors = health->consecutive_errors;
+    stats->bus_recoveries = bus_recoveries;
+    stats->last_error = health->last_error;
+    stats->last_ok_time_us = health->last_ok_time_us;
+    stats->latency_p50_us = i2c_bus_health_percentile(health, 500);
+    stats->latency_p90_us = i2c_bus_health_percentile(health, 900);
+    stats->latency_p99_us = i2c_bus_health_percentile(health, 990);
+    stats->latency_max_us = health->latency_max_us;
+}
+
+esp_err_t i2c_bus_health_line_recover(int sda_io, int scl_io, uint32_t clk_speed)
+{
+    if (clk_speed == 0 || clk_speed > I2C_BUS_RECOVERY_MAX_HZ) {
+        clk_speed = I2C_BUS_RECOVERY_MAX_HZ;
+    }
+    uint32_t half_period_us = (500000 + clk_speed - 1) / clk_speed;
+
+    gpio_config_t io_conf = {
+        .intr_type = GPIO_INTR_DISABLE,
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pin_bit_mask = (1ULL << sda_io) | (1ULL << scl_io),
+        .pull_down_en = 0,
+        .pull_up_en = 1,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    gpio_set_level(sda_io, 1);
+    gpio_set_level(scl_io, 1);
+    esp_rom_delay_us(half_period_us);
+
+    int clocks = 0;
+    while (gpio_get_level(sda_io) == 0 && clocks < I2C_BUS_RECOVERY_CLOCKS) {
+        gpio_set_level(scl_io, 0);
+        esp_rom_delay_us(half_period_us);
+        gpio_set_level(scl_io, 1);
+        esp_rom_delay_us(half_period_us);
+        clocks++;
+    }
+
+    /* STOP: SDA low to high while SCL is high, resets the state machine of every slave */
+    gpio_set_level(scl_io, 0);
+    esp_rom_delay_us(half_period_us);
+    gpio_set_level(sda_io, 0);
+    esp_rom_delay_us(half_period_us);
+    gpio_set_level(scl_io, 1);
+    esp_rom_delay_us(half_period_us);
+    gpio_set_level(sda_io, 1);
+    esp_rom_delay_us(half_period_us);
+
+    if (gpio_get_level(sda_io) == 0) {
+        ESP_LOGE(TAG, "SDA(%d) still held low after %d clocks", sda_io, clocks);
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_LOGW(TAG, "bus released after %d clocks", clocks);
+    return ESP_OK;
+}
@@ -0,0 +1,342 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include "esp_err.h"
+#include "esp_check.h"
+#include "i2c_bus_soft.h"
+#include "i2c_bus_soft_ll.h"
+#include "driver/gpio.h"
+
+static const char*TAG = "i2c_bus_soft";
+
+/**
+ * Timing model
+ *
+ * Every line change is scheduled relative to the previous one on the CPU cycle counter instead of sleeping a fixed
+ * number of microseconds after it. The cost of the register writes themselves is therefore absorbed into the
+ * phase, and the SCL period is exact to a few cycles at any frequency the CPU can keep up with. The period is split
+ * 52/48 between low and high phase, which satisfies tLOW/tHIGH of standard, fast and fast-plus mode at their
+ * nominal frequencies (e.g. 1.3us/1.2us at 400kHz).
+ */
+#define I2C_SOFT_LOW_PHASE_NUM 13
+#define I2C_SOFT_LOW_PHASE_DEN 25
+
+/**
+ * @brief Wait until `cycles` after the previous scheduled edge. If the CPU is already late, the next phase is
+ *        measured from now so that it is never shortened.
+ */
+static inline void i2c_soft_hold(i2c_master_soft_bus_handle_t bus, uint32_t cycles)
+{
+    uint32_t deadline = bus->edge + cycles;
+    uint32_t now = i2c_soft_ll_get_cycles();
+    if ((int32_t)(deadline - now) <= 0) {
+        bus->edge = now;
+        return;
+    }
+    while ((int32_t)(deadline - i2c_soft_ll_get_cycles()) > 0) {
+    }
+    bus->edge = deadline;
+}
+
+/**
+ * @brief Release SCL and wait for it to actually go high, honouring clock stretching by the slave
+ */
+static inline esp_err_t i2c_soft_scl_release(i2c_master_soft_bus_handle_t bus)
+{
+    i2c_soft_ll_set(bus->scl_io, 1);
+    if (i2c_soft_ll_get(bus->scl_io)) {
+        return ESP_OK;
+    }
+
+    uint32_t start = i2c_soft_ll_get_cycles();
+    while (!i2c_soft_ll_get(bus->scl_io)) {
+        if (i2c_soft_ll_get_cycles() - start > bus->stretch_timeout_cycles) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    /* The slave released the clock, the high phase starts now */
+    bus->edge = i2c_soft_ll_get_cycles();
+    return ESP_OK;
+}
+
+/**
+ * @brief Clock one bit out (sda_level != 0 releases SDA) and return the level sampled in the middle of the SCL
+ *        high phase. Sampling inside the phase keeps the cost of the read out of the following low phase.
+ */
+static inline esp_err_t i2c_soft_clock_bit(i2c_master_soft_bus_handle_t bus, uint32_t sda_level, uint32_t *sampled)
+{
+    i2c_soft_ll_set(bus->sda_io, sda_level);
+    i2c_soft_hold(bus, bus->low_cycles);
+    esp_err_t ret = i2c_soft_scl_release(bus);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    i2c_soft_hold(bus, bus->high_cycles / 2);
+    *sampled = i2c_soft_ll_get(bus->sda_io);
+    i2c_soft_hold(bus, bus->high_cycles - bus->high_cycles / 2);
+    i2c_soft_ll_set(bus->scl_io, 0);
+    return ESP_OK;
+}
+
+static esp_err_t i2c_soft_start(i2c_master_soft_bus_handle_t bus)
+{
+    i2c_soft_ll_set(bus->sda_io, 1);
+    esp_err_t ret = i2c_soft_scl_release(bus);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (!i2c_soft_ll_get(bus->sda_io)) {
+        return ESP_ERR_INVALID_STATE;                                                                             /*!< SDA held low by a device, bus is not free */
+    }
+    i2c_soft_ll_set(bus->sda_io, 0);
+    i2c_soft_hold(bus, bus->high_cycles);                                                                         /*!< tHD;STA */
+    i2c_soft_ll_set(bus->scl_io, 0);
+    return ESP_OK;
+}
+
+static esp_err_t i2c_soft_restart(i2c_master_soft_bus_handle_t bus)
+{
+    i2c_soft_ll_set(bus->sda_io, 1);
+    i2c_soft_hold(bus, bus->low_cycles);
+    esp_err_t ret = i2c_soft_scl_release(bus);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    i2c_soft_hold(bus, bus->high_cycles);                                                                         /*!< tSU;STA */
+    i2c_soft_ll_set(bus->sda_io, 0);
+    i2c_soft_hold(bus, bus->high_cycles);                                                                         /*!< tHD;STA */
+    i2c_soft_ll_set(bus->scl_io, 0);
+    return ESP_OK;
+}
+
+static esp_err_t i2c_soft_stop(i2c_master_soft_bus_handle_t bus)
+{
+    i2c_soft_ll_set(bus->sda_io, 0);
+    i2c_soft_hold(bus, bus->low_cycles);
+    esp_err_t ret = i2c_soft_scl_release(bus);
+    i2c_soft_hold(bus, bus->high_cycles);                                                                         /*!< tSU;STO */
+    i2c_soft_ll_set(bus->sda_io, 1);
+    i2c_soft_hold(bus, bus->low_cycles);                                                                          /*!< tBUF before the next START */
+    return ret;
+}
+
+static esp_err_t i2c_soft_write_byte(i2c_master_soft_bus_handle_t bus, uint8_t byte)
+{
+    uint32_t sampled;
+    esp_err_t ret;
+    for (int i = 0; i < 8; i++) {
+        ret = i2c_soft_clock_bit(bus, byte & 0x80, &sampled);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if ((byte & 0x80) && !sampled) {
+            return ESP_ERR_INVALID_STATE;                                                                         /*!< SDA released but seen low, arbitration lost */
+        }
+        byte <<= 1;
+    }
+
+    ret = i2c_soft_clock_bit(bus, 1, &sampled);                                                                   /*!< Release SDA, slave pulls it low for ACK */
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return sampled ? ESP_ERR_NOT_FOUND : ESP_OK;
+}
+
+static esp_err_t i2c_soft_read_byte(i2c_master_soft_bus_handle_t bus, uint8_t *byte, bool ack)
+{
+    uint32_t sampled;
+    uint8_t value = 0;
+    esp_err_t ret;
+    for (int i = 0; i < 8; i++) {
+        ret = i2c_soft_clock_bit(bus, 1, &sampled);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        value = (value << 1) | (sampled ? 1 : 0);
+    }
+    *byte = value;
+    return i2c_soft_clock_bit(bus, ack ? 0 : 1, &sampled);
+}
+
+static esp_err_t i2c_soft_write_buf(i2c_master_soft_bus_handle_t bus, const uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        esp_err_t ret = i2c_soft_write_byte(bus, buf[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_soft_bus_transfer(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, const uint8_t *head, size_t head_len,
+                                       const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len)
+{
+    ESP_RETURN_ON_FALSE(bus_handle, ESP_ERR_INVALID_ARG, TAG, "Invalid I2C bus handle");
+    ESP_RETURN_ON_FALSE((head || !head_len) && (tx || !tx_len) && (rx || !rx_len), ESP_ERR_INVALID_ARG, TAG, "Invalid buffer");
+
+    esp_err_t ret = ESP_OK;
+    bool started = false;
+    bus_handle->edge = i2c_soft_ll_get_cycles();
+
+    if (head_len + tx_len > 0 || rx_len == 0) {
+        ret = i2c_soft_start(bus_handle);
+        if (ret == ESP_ERR_INVALID_STATE) {
+            ESP_LOGD(TAG, "SDA is held low, can not generate start");
+            return ret;
+        }
+        started = true;
+        if (ret == ESP_OK) {
+            ret = i2c_soft_write_byte(bus_handle, (dev_addr << 1) | 0);
+        }
+        if (ret == ESP_OK) {
+            ret = i2c_soft_write_buf(bus_handle, head, head_len);
+        }
+        if (ret == ESP_OK) {
+            ret = i2c_soft_write_buf(bus_handle, tx, tx_len);
+        }
+    }
+
+    if (ret == ESP_OK && rx_len > 0) {
+        ret = started ? i2c_soft_restart(bus_handle) : i2c_soft_start(bus_handle);
+        if (ret == ESP_ERR_INVALID_STATE) {
+            ESP_LOGD(TAG, "SDA is held low, can not generate start");
+            return ret;
+        }
+        if (ret == ESP_OK) {
+            ret = i2c_soft_write_byte(bus_handle, (dev_addr << 1) | 1);
+        }
+        for (size_t i = 0; ret == ESP_OK && i < rx_len; i++) {
+            ret = i2c_soft_read_byte(bus_handle, &rx[i], i != rx_len - 1);                                       /*!< ACK all but the last byte */
+        }
+    }
+
+    esp_err_t stop_ret = i2c_soft_stop(bus_handle);
+    if (ret == ESP_OK) {
+        ret = stop_ret;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "transfer to 0x%02x failed: %s", dev_addr, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t i2c_master_soft_bus_write_reg8(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, uint8_t mem_address, size_t data_len, const uint8_t *data)
+{
+    size_t head_len = 1;
+#if !CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+    if (mem_address == NULL_I2C_MEM_ADDR) {
+        head_len = 0;
+    }
+#endif
+    return i2c_master_soft_bus_transfer(bus_handle, dev_addr, &mem_address, head_len, data, data_len, NULL, 0);
+}
+
+esp_err_t i2c_master_soft_bus_write_reg16(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, uint16_t mem_address, size_t data_len, const uint8_t *data)
+{
+    uint8_t head[2] = {(uint8_t)((mem_address >> 8) & 0x00FF), (uint8_t)(mem_address & 0x00FF)};
+    size_t head_len = 2;
+#if !CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+    if (mem_address == NULL_I2C_MEM_16BIT_ADDR) {
+        head_len = 0;
+    }
+#endif
+    return i2c_master_soft_bus_transfer(bus_handle, dev_addr, head, head_len, data, data_len, NULL, 0);
+}
+
+esp_err_t i2c_master_soft_bus_read_reg8(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, uint8_t mem_address, size_t data_len, uint8_t *data)
+{
+    size_t head_len = 1;
+#if !CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+    if (mem_address == NULL_I2C_MEM_ADDR) {
+        head_len = 0;
+    }
+#endif
+    ESP_RETURN_ON_FALSE(data_len > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid read length");
+    return i2c_master_soft_bus_transfer(bus_handle, dev_addr, &mem_address, head_len, NULL, 0, data, data_len);
+}
+
+esp_err_t i2c_master_soft_bus_read_reg16(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, uint16_t mem_address, size_t data_len, uint8_t *data)
+{
+    uint8_t head[2] = {(uint8_t)((mem_address >> 8) & 0x00FF), (uint8_t)(mem_address & 0x00FF)};
+    size_t head_len = 2;
+#if !CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+    if (mem_address == NULL_I2C_MEM_16BIT_ADDR) {
+        head_len = 0;
+    }
+#endif
+    ESP_RETURN_ON_FALSE(data_len > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid read length");
+    return i2c_master_soft_bus_transfer(bus_handle, dev_addr, head, head_len, NULL, 0, data, data_len);
+}
+
+esp_err_t i2c_master_soft_bus_probe(i2c_master_soft_bus_handle_t bus_handle, uint8_t address)
+{
+    return i2c_master_soft_bus_transfer(bus_handle, address, NULL, 0, NULL, 0, NULL, 0);
+}
+
+esp_err_t i2c_new_master_soft_bus(const i2c_config_t *conf, i2c_master_soft_bus_handle_t *ret_soft_bus_handle)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(GPIO_IS_VALID_GPIO(conf->scl_io_num) && GPIO_IS_VALID_GPIO(conf->sda_io_num), ESP_ERR_INVALID_ARG, TAG, "Invalid SDA/SCL pin number");
+    ESP_RETURN_ON_FALSE(conf->master.clk_speed > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid scl frequency");
+
+    gpio_config_t scl_io_conf = {
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,                                                                      /*!< SCL is read back to detect clock stretching */
+        .pull_up_en = conf->scl_pullup_en,
+        .intr_type = GPIO_INTR_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .pin_bit_mask = (1ULL << conf->scl_io_num),
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&scl_io_conf), TAG, "Failed to configure scl gpio");
+
+    gpio_config_t sda_io_conf = {
+        .mode = GPIO_MODE_INPUT_OUTPUT_OD,
+        .pull_up_en = conf->sda_pullup_en,
+        .intr_type = GPIO_INTR_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .pin_bit_mask = (1ULL << conf->sda_io_num),
+    };
+    ESP_RETURN_ON_ERROR(gpio_config(&sda_io_conf), TAG, "Failed to configure sda gpio");
+
+    i2c_master_soft_bus_handle_t soft_bus_handle = calloc(1, sizeof(struct i2c_master_soft_bus_t));
+    if (soft_bus_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate soft bus handle");
+        return ESP_ERR_NO_MEM;
+    }
+
+    soft_bus_handle->scl_io = conf->scl_io_num;
+    soft_bus_handle->sda_io = conf->sda_io_num;
+    soft_bus_handle->stretch_timeout_cycles = CONFIG_I2C_BUS_SOFTWARE_STRETCH_TIMEOUT_US * i2c_soft_ll_cycles_per_us();
+    i2c_master_soft_bus_change_frequency(soft_bus_handle, conf->master.clk_speed);
+
+    /* Release both lines, the output latch of an open-drain pad defaults to low */
+    i2c_soft_ll_set(soft_bus_handle->sda_io, 1);
+    i2c_soft_ll_set(soft_bus_handle->scl_io, 1);
+    *ret_soft_bus_handle = soft_bus_handle;
+
+    return ret;
+}
+
+esp_err_t i2c_master_soft_bus_change_frequency(i2c_master_soft_bus_handle_t bus_handle, uint32_t frequency)
+{
+    ESP_RETURN_ON_FALSE(bus_handle, ESP_ERR_INVALID_ARG, TAG, "Invalid I2C bus handle");
+    ESP_RETURN_ON_FALSE(frequency > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid scl frequency");
+    if (bus_handle->clk_speed == frequency) {
+        return ESP_OK;                                                                                          /*!< Called before every transfer, skip the division */
+    }
+    uint32_t period_cycles = (uint32_t)((uint64_t)i2c_soft_ll_cycles_per_us() * 1000000ULL / frequency);
+    bus_handle->low_cycles = period_cycles * I2C_SOFT_LOW_PHASE_NUM / I2C_SOFT_LOW_PHASE_DEN;
+    bus_handle->high_cycles = period_cycles - bus_handle->low_cycles;
+    bus_handle->clk_speed = frequency;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_soft_bus(i2c_master_soft_bus_handle_t bus_handle)
+{
+    ESP_RETURN_ON_FALSE(bus_handle, ESP_ERR_INVALID_ARG, TAG, "no memory for i2c master soft bus");
+    free(bus_handle);
+    return ESP_OK;
+}
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <inttypes.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "i2c_bus_trace.h"
+
+#define I2C_BUS_TRACE_RECORDS CONFIG_I2C_BUS_TRACE_RECORDS
+
+static i2c_bus_trace_record_t s_ring[I2C_BUS_TRACE_RECORDS];
+static uint32_t s_written;                                                                                  /*!< Records written since the last clear */
+static volatile bool s_enabled = true;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(sizeof(i2c_bus_trace_record_t) == 28, "the dump format depends on the record layout");
+
+void i2c_bus_trace_record(uint8_t flags, int port, uint8_t addr, int64_t start_us, esp_err_t err,
+                          const uint8_t *prefix, size_t prefix_len, const uint8_t *write, size_t write_len,
+                          const uint8_t *read, size_t read_len)
+{
+    if (!s_enabled) {
+        return;
+    }
+    int64_t duration = esp_timer_get_time() - start_us;
+    size_t total = prefix_len + write_len;
+    i2c_bus_trace_record_t rec = {
+        .t_us = (uint32_t)start_us,
+        .duration_us = duration > UINT16_MAX ? UINT16_MAX : (uint16_t)duration,
+        .port = (uint8_t)port,
+        .addr = addr,
+        .write_len = total > UINT16_MAX ? UINT16_MAX : (uint16_t)total,
+        .read_len = read_len > UINT16_MAX ? UINT16_MAX : (uint16_t)read_len,
+        .err = err > INT16_MAX || err < INT16_MIN ? INT16_MIN : (int16_t)err,
+        .flags = flags,
+    };
+
+    size_t room = I2C_BUS_TRACE_DATA_BYTES;
+    size_t n = prefix_len < room ? prefix_len : room;
+    if (prefix) {
+        memcpy(rec.data, prefix, n);
+    }
+    room -= n;
+    size_t m = write_len < room ? write_len : room;
+    if (write) {
+        memcpy(rec.data + n, write, m);
+    }
+    room -= m;
+    rec.write_stored = n + m;
+    if (read && err == ESP_OK) {
+        memcpy(rec.data + rec.write_stored, read, read_len < room ? read_len : room);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_enabled) {
+        s_ring[s_written % I2C_BUS_TRACE_RECORDS] = rec;
+        s_written++;
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void i2c_bus_trace_enable(bool enable)
+{
+    s_enabled = enable;
+}
+
+bool i2c_bus_trace_is_enabled(void)
+{
+    return s_enabled;
+}
+
+void i2c_bus_trace_clear(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_written = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+size_t i2c_bus_trace_snapshot(i2c_bus_trace_record_t *out, size_t max, uint32_t *dropped)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t written = s_written;
+    uint32_t count = written < I2C_BUS_TRACE_RECORDS ? written : I2C_BUS_TRACE_RECORDS;
+    uint32_t first = written - count;
+    if (count > max) {
+        first += count - max;
+        count = max;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = s_ring[(first + i) % I2C_BUS_TRACE_RECORDS];
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (dropped) {
+        *dropped = written > I2C_BUS_TRACE_RECORDS ? written - I2C_BUS_TRACE_RECORDS : 0;
+    }
+    return count;
+}
+
+void i2c_bus_trace_dump(FILE *out)
+{
+    bool was_enabled = s_enabled;
+    s_enabled = false;
+
+    /* Writers check s_enabled again under the lock, so the ring no longer moves once this section is passed */
+    portENTER_CRITICAL(&s_lock);
+    uint32_t written = s_written;
+    portEXIT_CRITICAL(&s_lock);
+    uint32_t count = written < I2C_BUS_TRACE_RECORDS ? written : I2C_BUS_TRACE_RECORDS;
+
+    fprintf(out, I2C_BUS_TRACE_DUMP_TAG " BEGIN v%d records=%" PRIu32 " dropped=%" PRIu32 " size=%u now_us=%" PRId64 "\n",
+            I2C_BUS_TRACE_VERSION, count, written - count, (unsigned)sizeof(i2c_bus_trace_record_t), esp_timer_get_time());
+    char line[sizeof(I2C_BUS_TRACE_DUMP_TAG) + 1 + 2 * sizeof(i2c_bus_trace_record_t) + 2];
+    for (uint32_t i = written - count; i != written; i++) {
+        const uint8_t *b = (const uint8_t *)&s_ring[i % I2C_BUS_TRACE_RECORDS];
+        char *p = line + sprintf(line, I2C_BUS_TRACE_DUMP_TAG " ");
+        for (size_t k = 0; k < sizeof(i2c_bus_trace_record_t); k++) {
+            *p++ = "0123456789abcdef"[b[k] >> 4];
+            *p++ = "0123456789abcdef"[b[k] & 0x0F];
+        }
+        *p++ = '\n';
+        *p = '\0';
+        fputs(line, out);
+    }
+    fprintf(out, I2C_BUS_TRACE_DUMP_TAG " END\n");
+    fflush(out);
+
+    s_enabled = was_enabled;
+}
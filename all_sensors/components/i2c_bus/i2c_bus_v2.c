@@ -12,7 +12,12 @@
 #include "freertos/semphr.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "i2c_bus.h"
+#include "i2c_bus_health.h"
+#if CONFIG_I2C_BUS_TRACE
+#include "i2c_bus_trace.h"
+#endif
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
 #include "i2c_bus_soft.h"
 #endif
@@ -36,6 +41,7 @@ typedef struct {
     i2c_config_t conf_activate;                                                                         /*!< I2C active configuration */
     SemaphoreHandle_t mutex;                                                                            /*!< mutex to achieve thread-safe */
     int32_t ref_counter;                                                                                /*!< reference count */
+    uint32_t recoveries;                                                                                /*!< number of bus recoveries */
 } i2c_bus_t;
 
 typedef struct {
@@ -43,6 +49,7 @@ typedef struct {
     i2c_master_dev_handle_t dev_handle;                                                                 /*!< I2C master bus device handle */
     i2c_device_config_t conf;                                                                           /*!< I2C active configuration */
     i2c_bus_t *i2c_bus;                                                                                 /*!< I2C bus */
+    i2c_bus_health_t health;                                                                            /*!< transfer statistics */
 } i2c_bus_device_t;
 
 static const char *TAG = "i2c_bus";
@@ -83,11 +90,27 @@ static i2c_bus_t s_i2c_bus[I2C_NUM_MAX];
         return (ret); \
     }
 
+#if CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR
+#define I2C_BUS_MEM_ADDR_LEN(mem_address, null_address, len) (len)
+#else
+#define I2C_BUS_MEM_ADDR_LEN(mem_address, null_address, len) ((mem_address) != (null_address) ? (len) : 0)
+#endif
+
+#if CONFIG_I2C_BUS_TRACE
+#define I2C_BUS_TRACE_TRANSFER(dev, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len) \
+        i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS, (dev)->i2c_bus->bus_config.i2c_port, (dev)->device_config.device_address, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len)
+#else
+#define I2C_BUS_TRACE_TRANSFER(dev, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len)
+#endif
+
 static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf);
 static esp_err_t i2c_driver_deinit(i2c_port_t port);
 static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, const uint8_t *data);
 static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, uint8_t *data);
 inline static bool i2c_config_compare(i2c_port_t port, const i2c_config_t *conf);
+static void i2c_bus_transfer_done(i2c_bus_device_t *i2c_device, esp_err_t ret, int64_t start_us);
+static esp_err_t i2c_bus_recover_locked(i2c_bus_t *i2c_bus);
+static esp_err_t i2c_bus_probe_locked(i2c_bus_t *i2c_bus, uint8_t dev_addr);
 /**************************************** Public Functions (Application level)*********************************************/
 
 i2c_bus_handle_t i2c_bus_create(i2c_port_t port, const i2c_config_t *conf)
@@ -239,14 +262,7 @@ uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num)
     I2C_BUS_MUTEX_TAKE_MAX_DELAY(i2c_bus->mutex, 0);
 
     for (uint8_t dev_address = 1; dev_address < 127; dev_address++) {
-#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
-        if (i2c_bus->bus_config.i2c_port > I2C_NUM_MAX) {
-            ret  = i2c_master_soft_bus_probe(i2c_bus->soft_bus_handle, dev_address);
-        } else
-#endif
-        {
-            ret = i2c_master_probe(i2c_bus->bus_handle, dev_address, I2C_BUS_TICKS_TO_WAIT);
-        }
+        ret = i2c_bus_probe_locked(i2c_bus, dev_address);
         if (ret == ESP_OK) {
             ESP_LOGI(TAG, "found i2c device address = 0x%02x", dev_address);
             if (buf != NULL && device_count < num) {
@@ -259,6 +275,17 @@ uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num)
     return device_count;
 }
 
+esp_err_t i2c_bus_probe(i2c_bus_handle_t bus_handle, uint8_t dev_addr)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Handle error", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    I2C_BUS_MUTEX_TAKE(i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    esp_err_t ret = i2c_bus_probe_locked(i2c_bus, dev_addr);
+    I2C_BUS_MUTEX_GIVE(i2c_bus->mutex, ESP_FAIL);
+    return ret;
+}
+
 uint8_t i2c_bus_device_get_address(i2c_bus_device_handle_t dev_handle)
 {
     I2C_BUS_CHECK(dev_handle != NULL, "device handle error", NULL_I2C_DEV_ADDR);
@@ -350,6 +377,7 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
     esp_err_t ret = ESP_FAIL;
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
@@ -371,6 +399,8 @@ static esp_err_t i2c_bus_read_reg8(i2c_bus_device_handle_t dev_handle, uint8_t m
         }
 #endif
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, &mem_address, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_ADDR, 1), NULL, 0, data, data_len);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -386,6 +416,7 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
     // Need to distinguish between hardware I2C and software I2C via port
@@ -406,6 +437,8 @@ esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_ad
         }
 #endif
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, memAddress8, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_16BIT_ADDR, 2), NULL, 0, data, data_len);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -417,6 +450,7 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
     i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
     I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
     esp_err_t ret = ESP_FAIL;
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
@@ -449,6 +483,8 @@ static esp_err_t i2c_bus_write_reg8(i2c_bus_device_handle_t dev_handle, uint8_t
         }
 #endif
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, &mem_address, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_ADDR, 1), data, data_len, NULL, 0);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
@@ -463,6 +499,7 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
     memAddress8[0] = (uint8_t)((mem_address >> 8) & 0x00FF);
     memAddress8[1] = (uint8_t)(mem_address & 0x00FF);
     I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    int64_t start_us = esp_timer_get_time();
     esp_err_t ret = ESP_FAIL;
 
 #if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
@@ -495,7 +532,42 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
         }
 #endif
     }
+    I2C_BUS_TRACE_TRANSFER(i2c_device, start_us, ret, memAddress8, I2C_BUS_MEM_ADDR_LEN(mem_address, NULL_I2C_MEM_16BIT_ADDR, 2), data, data_len, NULL, 0);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
+    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    return ret;
+}
+
+/**************************************** Public Functions (Health)*********************************************/
+
+esp_err_t i2c_bus_device_get_stats(i2c_bus_device_handle_t dev_handle, i2c_bus_device_stats_t *stats)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(stats != NULL, "stats pointer error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    i2c_bus_health_get_stats(&i2c_device->health, i2c_device->i2c_bus->recoveries, stats);
+    I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_device_reset_stats(i2c_bus_device_handle_t dev_handle)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_device->i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    memset(&i2c_device->health, 0, sizeof(i2c_device->health));
     I2C_BUS_MUTEX_GIVE(i2c_device->i2c_bus->mutex, ESP_FAIL);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_recover(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_MUTEX_TAKE(i2c_bus->mutex, ESP_ERR_TIMEOUT);
+    esp_err_t ret = i2c_bus_recover_locked(i2c_bus);
+    I2C_BUS_MUTEX_GIVE(i2c_bus->mutex, ESP_FAIL);
     return ret;
 }
 
@@ -606,3 +678,72 @@ inline static bool i2c_config_compare(i2c_port_t port, const i2c_config_t *conf)
     }
     return false;
 }
+
+/**
+ * @brief Account a finished transfer in the device statistics and recover the bus if it looks stuck.
+ *        Must be called with the bus mutex held.
+ *
+ * @param i2c_device device the transfer was addressed to
+ * @param ret result of the transfer
+ * @param start_us esp_timer time the transfer was started at
+ */
+static void i2c_bus_transfer_done(i2c_bus_device_t *i2c_device, esp_err_t ret, int64_t start_us)
+{
+    i2c_bus_t *i2c_bus = i2c_device->i2c_bus;
+    i2c_bus_health_class_t cls = i2c_bus_health_classify(ret, i2c_bus->conf_activate.sda_io_num);
+    i2c_bus_health_record(&i2c_device->health, cls, ret, (uint32_t)(esp_timer_get_time() - start_us));
+    if (i2c_bus_health_should_recover(&i2c_device->health, cls)) {
+        ESP_LOGW(TAG, "i2c%d: %s talking to 0x%02x, %"PRIu32" consecutive errors, recovering bus", i2c_bus->bus_config.i2c_port, esp_err_to_name(ret),
+                 i2c_device->device_config.device_address, i2c_device->health.consecutive_errors);
+        i2c_bus_recover_locked(i2c_bus);
+    }
+}
+
+/**
+ * @brief Free SDA if a device holds it and re-install the driver. Must be called with the bus mutex held.
+ */
+static esp_err_t i2c_bus_recover_locked(i2c_bus_t *i2c_bus)
+{
+    i2c_port_t port = i2c_bus->bus_config.i2c_port;
+    esp_err_t ret = ESP_OK;
+#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
+    if (port > I2C_NUM_MAX) {
+        i2c_config_t conf = i2c_bus->conf_activate;
+        if (i2c_bus->is_init) {
+            i2c_driver_deinit(port);
+        }
+        ret = i2c_bus_health_line_recover(conf.sda_io_num, conf.scl_io_num, conf.master.clk_speed);
+        esp_err_t reinit = i2c_driver_reinit(port, &conf);
+        ret = reinit != ESP_OK ? reinit : ret;
+    } else
+#endif
+    {
+        /* The devices stay attached to the bus handle, so the controller's own 9-clock recovery is used instead of re-creating the bus */
+        ret = i2c_master_bus_reset(i2c_bus->bus_handle);
+    }
+    i2c_bus->recoveries++;
+    ESP_LOGW(TAG, "i2c%d bus recovery %s, recoveries=%"PRIu32"", port, esp_err_to_name(ret), i2c_bus->recoveries);
+    return ret;
+}
+
+/**
+ * @brief Address the device with an empty write. Must be called with the bus mutex held.
+ */
+static esp_err_t i2c_bus_probe_locked(i2c_bus_t *i2c_bus, uint8_t dev_addr)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret;
+#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
+    if (i2c_bus->bus_config.i2c_port > I2C_NUM_MAX) {
+        ret = i2c_master_soft_bus_probe(i2c_bus->soft_bus_handle, dev_addr);
+    } else
+#endif
+    {
+        ret = i2c_master_probe(i2c_bus->bus_handle, dev_addr, I2C_BUS_TICKS_TO_WAIT);
+    }
+#if CONFIG_I2C_BUS_TRACE
+    i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS, i2c_bus->bus_config.i2c_port, dev_addr, start_us, ret, NULL, 0, NULL, 0, NULL, 0);
+#endif
+    (void)start_us;
+    return ret;
+}
@@ -121,6 +121,19 @@ i2c_master_bus_handle_t i2c_bus_get_internal_bus_handle(i2c_bus_handle_t bus_han
  */
 uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num);
 
+/**
+ * @brief Check whether a device acknowledges its address, without touching any of its registers
+ *
+ * @param bus_handle I2C bus handle
+ * @param dev_addr 7-bit device address
+ * @return esp_err_t
+ *     - ESP_OK The device acknowledged
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_TIMEOUT Operation timeout because the bus is busy.
+ *     - Others No device at this address (the exact code depends on the driver in use)
+ */
+esp_err_t i2c_bus_probe(i2c_bus_handle_t bus_handle, uint8_t dev_addr);
+
 /**
  * @brief Get current active clock speed.
  *
@@ -351,6 +364,65 @@ esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_a
  */
 esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_address, size_t data_len, uint8_t *data);
 
+/**************************************** Public Functions (Health)*********************************************/
+
+/**
+ * @brief Transfer statistics of an I2C device
+ */
+typedef struct {
+    uint32_t transfers;                 /*!< Number of transfers attempted */
+    uint32_t nack;                      /*!< Transfers failed because the slave did not acknowledge */
+    uint32_t timeout;                   /*!< Transfers failed with timeout */
+    uint32_t arb_lost;                  /*!< Transfers failed because SDA did not follow the master (software I2C only) */
+    uint32_t bus_stuck;                 /*!< Transfers failed because SDA was held low */
+    uint32_t other;                     /*!< Transfers failed for any other reason */
+    uint32_t consecutive_errors;        /*!< Failed transfers since the last successful one */
+    uint32_t bus_recoveries;            /*!< Recoveries performed on the bus of this device */
+    esp_err_t last_error;               /*!< Error code of the last failed transfer */
+    int64_t last_ok_time_us;            /*!< esp_timer time of the last successful transfer, 0 if none */
+    uint32_t latency_p50_us;            /*!< Median transfer latency */
+    uint32_t latency_p90_us;            /*!< 90th percentile transfer latency */
+    uint32_t latency_p99_us;            /*!< 99th percentile transfer latency */
+    uint32_t latency_max_us;            /*!< Longest transfer seen */
+} i2c_bus_device_stats_t;
+
+/**
+ * @brief Get the transfer statistics of an I2C device.
+ *        Percentiles are taken from a log2 histogram and are accurate to a factor of two.
+ *
+ * @param dev_handle I2C device handle
+ * @param stats Pointer to the structure to fill
+ * @return esp_err_t
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ */
+esp_err_t i2c_bus_device_get_stats(i2c_bus_device_handle_t dev_handle, i2c_bus_device_stats_t *stats);
+
+/**
+ * @brief Clear the transfer statistics of an I2C device
+ *
+ * @param dev_handle I2C device handle
+ * @return esp_err_t
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ */
+esp_err_t i2c_bus_device_reset_stats(i2c_bus_device_handle_t dev_handle);
+
+/**
+ * @brief Recover the I2C bus: release the driver, clock SCL up to 9 times until SDA is released, send a STOP and
+ *        install the driver again with the active configuration.
+ *        With I2C_BUS_AUTO_RECOVERY enabled this is done automatically when a transfer leaves SDA held low or after
+ *        repeated failures of a device.
+ *
+ * @param bus_handle I2C bus handle
+ * @return esp_err_t
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_INVALID_STATE SDA is still held low, the driver is installed again anyway
+ *     - ESP_ERR_TIMEOUT Could not take the bus mutex
+ */
+esp_err_t i2c_bus_recover(i2c_bus_handle_t bus_handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_BUS_TRACE_DATA_BYTES 12                                                                         /*!< Payload bytes kept per transfer, enough for an 8 pixel OLED glyph with its control byte */
+#define I2C_BUS_TRACE_VERSION 1                                                                             /*!< Version of the record layout and the dump format */
+#define I2C_BUS_TRACE_DUMP_TAG "I2CT"                                                                       /*!< Prefix of every dump line */
+
+#define I2C_BUS_TRACE_SRC_BUS 0x00                                                                          /*!< Transfer issued through i2c_bus */
+#define I2C_BUS_TRACE_SRC_DRIVER 0x01                                                                       /*!< Transfer issued on the I2C driver directly (ssd1306) */
+#define I2C_BUS_TRACE_SRC_MASK 0x03
+#define I2C_BUS_TRACE_FLAG_OPAQUE 0x04                                                                      /*!< Payload not visible (i2c_bus_cmd_begin), lengths are 0 */
+
+/**
+ * @brief One transfer, as stored in the ring buffer and dumped
+ *
+ * A transfer is everything between START and STOP: an optional write phase (register address and data) followed by an
+ * optional read phase. data[] holds the first write_stored bytes written, then as many bytes read as fit.
+ * Little-endian, 28 bytes.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t t_us;                                                                                          /*!< esp_timer time at START, low 32 bits */
+    uint16_t duration_us;                                                                                   /*!< Time until the driver returned, saturated at 65535 */
+    uint8_t port;                                                                                           /*!< I2C port */
+    uint8_t addr;                                                                                           /*!< 7-bit device address */
+    uint16_t write_len;                                                                                     /*!< Bytes written after the address, register address included */
+    uint16_t read_len;                                                                                      /*!< Bytes read */
+    int16_t err;                                                                                            /*!< esp_err_t returned by the driver */
+    uint8_t flags;                                                                                          /*!< I2C_BUS_TRACE_SRC_x | I2C_BUS_TRACE_FLAG_x */
+    uint8_t write_stored;                                                                                   /*!< Bytes of data[] taken from the write phase */
+    uint8_t data[I2C_BUS_TRACE_DATA_BYTES];                                                                 /*!< First bytes written, then first bytes read */
+} i2c_bus_trace_record_t;
+
+/**
+ * @brief Record a finished transfer. Cheap enough for every transfer: a copy of the first bytes into the ring under a
+ *        spinlock. Does nothing while tracing is disabled.
+ *
+ * The write phase is passed in two parts, prefix (register address or control byte) and payload, so callers do not
+ * have to build a contiguous buffer. Any pointer may be NULL if its length is 0.
+ *
+ * @param flags I2C_BUS_TRACE_SRC_x | I2C_BUS_TRACE_FLAG_x
+ * @param port I2C port
+ * @param addr 7-bit device address
+ * @param start_us esp_timer time the transfer was started at
+ * @param err Result returned by the driver
+ * @param prefix First bytes written
+ * @param prefix_len Length of prefix
+ * @param write Bytes written after prefix
+ * @param write_len Length of write
+ * @param read Bytes read
+ * @param read_len Length of read
+ */
+void i2c_bus_trace_record(uint8_t flags, int port, uint8_t addr, int64_t start_us, esp_err_t err,
+                          const uint8_t *prefix, size_t prefix_len, const uint8_t *write, size_t write_len,
+                          const uint8_t *read, size_t read_len);
+
+/**
+ * @brief Start or stop recording. Recording is on from boot.
+ */
+void i2c_bus_trace_enable(bool enable);
+
+/**
+ * @brief Whether transfers are being recorded
+ */
+bool i2c_bus_trace_is_enabled(void);
+
+/**
+ * @brief Drop all records
+ */
+void i2c_bus_trace_clear(void);
+
+/**
+ * @brief Copy the records in the ring, oldest first
+ *
+ * @param out Destination
+ * @param max Capacity of out, in records
+ * @param dropped Set to the number of records overwritten since the last clear, may be NULL
+ * @return Number of records copied
+ */
+size_t i2c_bus_trace_snapshot(i2c_bus_trace_record_t *out, size_t max, uint32_t *dropped);
+
+/**
+ * @brief Print the ring buffer as text, one hex encoded record per line, for capture from the console UART
+ *
+ *     I2CT BEGIN v1 records=<n> dropped=<n> size=28 now_us=<esp_timer>
+ *     I2CT <56 hex digits>
+ *     ...
+ *     I2CT END
+ *
+ * Other output may be interleaved, a decoder only looks at lines containing "I2CT ". Recording is paused while the
+ * dump runs. Decode with host/i2c_trace.
+ *
+ * @param out Stream, stdout for the console
+ */
+void i2c_bus_trace_dump(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,111 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "i2c_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_BUS_HEALTH_LATENCY_BUCKETS 16                                                                   /*!< Bucket i counts latencies below 2^(i + 5) us, the last one everything above */
+
+/**
+ * @brief Outcome of a single transfer as seen by the health layer
+ */
+typedef enum {
+    I2C_BUS_HEALTH_OK = 0,                                                                                  /*!< Transfer succeeded */
+    I2C_BUS_HEALTH_NACK,                                                                                    /*!< Address or data byte not acknowledged */
+    I2C_BUS_HEALTH_TIMEOUT,                                                                                 /*!< Transfer did not complete in time, SCL held low for too long */
+    I2C_BUS_HEALTH_ARB_LOST,                                                                                /*!< SDA did not follow the level driven by the master */
+    I2C_BUS_HEALTH_BUS_STUCK,                                                                               /*!< SDA is held low by a device outside of a transfer */
+    I2C_BUS_HEALTH_OTHER,                                                                                   /*!< Any other error (driver state, memory) */
+} i2c_bus_health_class_t;
+
+/**
+ * @brief Per-device transfer statistics, embedded in the device object of the active backend
+ */
+typedef struct {
+    uint32_t transfers;                                                                                     /*!< Number of transfers attempted */
+    uint32_t nack;                                                                                          /*!< Transfers failed with NACK */
+    uint32_t timeout;                                                                                       /*!< Transfers failed with timeout */
+    uint32_t arb_lost;                                                                                      /*!< Transfers failed with arbitration loss */
+    uint32_t bus_stuck;                                                                                     /*!< Transfers failed because SDA was held low */
+    uint32_t other;                                                                                         /*!< Transfers failed for any other reason */
+    uint32_t consecutive_errors;                                                                            /*!< Failed transfers since the last successful one */
+    esp_err_t last_error;                                                                                   /*!< Error code of the last failed transfer */
+    int64_t last_ok_time_us;                                                                                /*!< esp_timer time of the last successful transfer, 0 if none */
+    uint32_t latency_max_us;                                                                                /*!< Longest transfer seen */
+    uint32_t latency_hist[I2C_BUS_HEALTH_LATENCY_BUCKETS];                                                  /*!< Log2 latency histogram */
+} i2c_bus_health_t;
+
+/**
+ * @brief Map an error returned by a backend to a health class
+ *
+ * NACK is reported as ESP_FAIL by driver/i2c, ESP_ERR_INVALID_RESPONSE by esp_driver_i2c and ESP_ERR_NOT_FOUND by the
+ * software master. Errors other than NACK are refined by sampling SDA: if it is still low after the transfer ended,
+ * a device is holding the bus. driver/i2c reports arbitration loss as timeout, so it can only be told apart on the
+ * software master, which returns ESP_ERR_INVALID_STATE when SDA does not follow the driven level.
+ *
+ * @param err Error code returned by the transfer
+ * @param sda_io SDA GPIO number of the bus
+ * @return i2c_bus_health_class_t
+ */
+i2c_bus_health_class_t i2c_bus_health_classify(esp_err_t err, int sda_io);
+
+/**
+ * @brief Account a finished transfer
+ *
+ * @param health Device statistics
+ * @param cls Outcome of the transfer, see i2c_bus_health_classify
+ * @param err Error code returned by the transfer
+ * @param latency_us Duration of the transfer
+ */
+void i2c_bus_health_record(i2c_bus_health_t *health, i2c_bus_health_class_t cls, esp_err_t err, uint32_t latency_us);
+
+/**
+ * @brief Whether the bus should be recovered after the transfer just recorded
+ *
+ * A stuck SDA is recovered immediately. Otherwise recovery is attempted after CONFIG_I2C_BUS_AUTO_RECOVERY_THRESHOLD
+ * consecutive failures and then again each time the count doubles, so a device that is simply unplugged does not
+ * cause a driver reset on every poll.
+ *
+ * @param health Device statistics
+ * @param cls Outcome of the transfer just recorded
+ * @return true if the bus should be recovered
+ */
+bool i2c_bus_health_should_recover(const i2c_bus_health_t *health, i2c_bus_health_class_t cls);
+
+/**
+ * @brief Fill the public statistics structure
+ *
+ * @param health Device statistics
+ * @param bus_recoveries Number of recoveries performed on the bus of the device
+ * @param stats Output
+ */
+void i2c_bus_health_get_stats(const i2c_bus_health_t *health, uint32_t bus_recoveries, i2c_bus_device_stats_t *stats);
+
+/**
+ * @brief Free a bus whose SDA is held low by a device stuck in the middle of a byte
+ *
+ * The lines must be detached from the I2C driver. SCL is clocked up to 9 times until the device releases SDA, then
+ * a STOP condition is generated. Both lines are left released.
+ *
+ * @param sda_io SDA GPIO number
+ * @param scl_io SCL GPIO number
+ * @param clk_speed Bus frequency, the recovery clock never runs faster than 100kHz
+ * @return
+ *     - ESP_OK SDA is released
+ *     - ESP_ERR_INVALID_STATE SDA is still held low after 9 clocks
+ */
+esp_err_t i2c_bus_health_line_recover(int sda_io, int scl_io, uint32_t clk_speed);
+
+#ifdef __cplusplus
+}
+#endif
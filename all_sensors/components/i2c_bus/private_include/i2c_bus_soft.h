@@ -8,9 +8,13 @@
 #include "i2c_bus.h"
 
 struct i2c_master_soft_bus_t {
-    gpio_num_t scl_io;      /*!< SCL GPIO PIN */
-    gpio_num_t sda_io;      /*!< SDA GPIO PIN */
-    uint32_t time_delay_us; /*!< Interval between SCL GPIO toggles in microseconds, determining the SCL frequency */
+    gpio_num_t scl_io;               /*!< SCL GPIO PIN */
+    gpio_num_t sda_io;               /*!< SDA GPIO PIN */
+    uint32_t clk_speed;              /*!< Current SCL frequency in Hz */
+    uint32_t low_cycles;             /*!< CPU cycles SCL is held low for each bit, determining the SCL frequency together with high_cycles */
+    uint32_t high_cycles;            /*!< CPU cycles SCL is held high for each bit */
+    uint32_t stretch_timeout_cycles; /*!< Maximum CPU cycles a slave may hold SCL low (clock stretching) */
+    uint32_t edge;                   /*!< CPU cycle count of the last scheduled line edge */
 };
 
 typedef struct i2c_master_soft_bus_t *i2c_master_soft_bus_handle_t;
@@ -60,6 +64,33 @@ esp_err_t i2c_master_soft_bus_change_frequency(i2c_master_soft_bus_handle_t bus_
  */
 esp_err_t i2c_master_soft_bus_probe(i2c_master_soft_bus_handle_t bus_handle, uint8_t address);
 
+/**
+ * @brief Run a complete burst transaction: START, address+W, head and tx bytes, repeated START, address+R,
+ *        rx bytes (ACK on all but the last one), STOP.
+ *
+ * The write phase is skipped when head_len and tx_len are both 0 and rx_len is not, the read phase is skipped when
+ * rx_len is 0. With all lengths 0 only the address is sent, which is how a probe is done. Two write buffers are taken
+ * so that a register address can be prepended to a payload without copying it. A STOP is always generated, also
+ * after a NACK or a clock stretching timeout, so the bus is released for the next transaction.
+ *
+ * @param bus_handle I2C soft bus handle
+ * @param dev_addr I2C device address
+ * @param head First bytes of the write phase (usually the register address), may be NULL if head_len is 0
+ * @param head_len Number of bytes in head
+ * @param tx Payload of the write phase, may be NULL if tx_len is 0
+ * @param tx_len Number of bytes in tx
+ * @param rx Buffer for the read phase, may be NULL if rx_len is 0
+ * @param rx_len Number of bytes to read
+ * @return
+ *      - ESP_OK: Transaction completed
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ *      - ESP_ERR_NOT_FOUND: The device did not ACK a byte
+ *      - ESP_ERR_TIMEOUT: SCL was held low by a slave longer than CONFIG_I2C_BUS_SOFTWARE_STRETCH_TIMEOUT_US
+ *      - ESP_ERR_INVALID_STATE: SDA is held low, the bus can not be started
+ */
+esp_err_t i2c_master_soft_bus_transfer(i2c_master_soft_bus_handle_t bus_handle, uint8_t dev_addr, const uint8_t *head, size_t head_len,
+                                       const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len);
+
 /**
  * @brief Write multiple byte to i2c device with 8-bit internal register/memory address
  *
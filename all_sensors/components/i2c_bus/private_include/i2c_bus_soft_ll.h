@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+/**
+ * Line level primitives of the software I2C master.
+ *
+ * The protocol engine in i2c_bus_soft.c only talks to the bus through the inline functions below, so that the
+ * whole bit-banging path compiles down to plain register accesses without any error-checked driver call per edge.
+ * Both lines are open-drain: writing 1 releases the line (pulled up externally), writing 0 drives it low.
+ *
+ * When I2C_BUS_SOFT_HOST_SIM is defined the primitives are provided by the host protocol simulator instead,
+ * see host/soft_i2c_sim.
+ */
+
+#include <stdint.h>
+
+#if I2C_BUS_SOFT_HOST_SIM
+#include "soft_i2c_sim_port.h"
+#else
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "hal/gpio_ll.h"
+
+#define I2C_SOFT_LL_HW GPIO_LL_GET_HW(GPIO_PORT_0)
+
+/**
+ * @brief Current CPU cycle counter, used as the time base for SCL pacing
+ */
+static inline uint32_t i2c_soft_ll_get_cycles(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+/**
+ * @brief Number of CPU cycles per microsecond at the current CPU frequency
+ */
+static inline uint32_t i2c_soft_ll_cycles_per_us(void)
+{
+    return esp_rom_get_cpu_ticks_per_us();
+}
+
+/**
+ * @brief Drive a line low (level = 0) or release it to the pull-up (level = 1)
+ */
+static inline void i2c_soft_ll_set(gpio_num_t io, uint32_t level)
+{
+    gpio_ll_set_level(I2C_SOFT_LL_HW, io, level);
+}
+
+/**
+ * @brief Sample the actual line level seen on the pad
+ */
+static inline uint32_t i2c_soft_ll_get(gpio_num_t io)
+{
+    return (uint32_t)gpio_ll_get_level(I2C_SOFT_LL_HW, io);
+}
+#endif
@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "i2c_discovery.h"
+
+#define TAG "I2C_DISCOVERY"
+
+#define NVS_NAMESPACE "i2c_disc"
+#define NVS_KEY "result"
+#define CACHE_MAGIC 0x44433249 // "I2CD"
+#define CACHE_VERSION 1
+
+#define SCAN_FIRST_ADDR 0x08
+#define SCAN_LAST_ADDR 0x77
+#define SCAN_TASK_STACK 3072
+
+#define BMX280_REG_CHIP_ID 0xD0
+#define BH1750_CMD_POWER_ON 0x01
+#define SH1106_STATUS_ID 0x08 // SH1106 reports 1000b in the low nibble of its status byte, SSD1306 does not
+
+typedef i2c_chip_t (*identify_fn_t)(i2c_bus_handle_t bus, uint8_t addr);
+
+typedef struct {
+    uint8_t addr;
+    identify_fn_t identify;
+} candidate_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t bus_num;
+    uint8_t count;
+    uint32_t layout_id;
+    i2c_discovery_entry_t entries[I2C_DISCOVERY_MAX_DEVICES];
+} cache_blob_t;
+
+typedef struct {
+    const i2c_discovery_config_t *config;
+    uint8_t bus_index;
+    EventGroupHandle_t done;
+    size_t count;
+    i2c_discovery_entry_t entries[I2C_DISCOVERY_MAX_DEVICES];
+} scan_job_t;
+
+static i2c_chip_t identify_bmx280(i2c_bus_handle_t bus, uint8_t addr);
+static i2c_chip_t identify_bh1750(i2c_bus_handle_t bus, uint8_t addr);
+static i2c_chip_t identify_oled(i2c_bus_handle_t bus, uint8_t addr);
+
+// Addresses of the chips this board may carry, probed in this order
+static const candidate_t s_candidates[] = {
+    { 0x23, identify_bh1750 },
+    { 0x3C, identify_oled },
+    { 0x3D, identify_oled },
+    { 0x5C, identify_bh1750 },
+    { 0x76, identify_bmx280 },
+    { 0x77, identify_bmx280 },
+};
+
+static const char *s_chip_names[I2C_CHIP_MAX] = {
+    [I2C_CHIP_UNKNOWN] = "unknown",
+    [I2C_CHIP_BME280] = "BME280",
+    [I2C_CHIP_BMP280] = "BMP280",
+    [I2C_CHIP_BH1750] = "BH1750",
+    [I2C_CHIP_SSD1306] = "SSD1306",
+    [I2C_CHIP_SH1106] = "SH1106",
+};
+
+const char *i2c_discovery_chip_name(i2c_chip_t chip)
+{
+    return (chip < I2C_CHIP_MAX) ? s_chip_names[chip] : "invalid";
+}
+
+static esp_err_t read_reg(i2c_bus_handle_t bus, uint8_t addr, uint8_t reg, uint8_t *value)
+{
+    i2c_bus_device_handle_t dev = i2c_bus_device_create(bus, addr, 0);
+    if (dev == NULL) return ESP_ERR_NO_MEM;
+    esp_err_t ret = i2c_bus_read_byte(dev, reg, value);
+    i2c_bus_device_delete(&dev);
+    return ret;
+}
+
+static i2c_chip_t identify_bmx280(i2c_bus_handle_t bus, uint8_t addr)
+{
+    uint8_t id;
+    if (read_reg(bus, addr, BMX280_REG_CHIP_ID, &id) != ESP_OK) return I2C_CHIP_UNKNOWN;
+    switch (id) {
+    case 0x60:
+        return I2C_CHIP_BME280;
+    case 0x56:
+    case 0x57:
+    case 0x58:
+        return I2C_CHIP_BMP280;
+    default:
+        ESP_LOGW(TAG, "0x%02x: unexpected chip-id 0x%02x", addr, id);
+        return I2C_CHIP_UNKNOWN;
+    }
+}
+
+static i2c_chip_t identify_bh1750(i2c_bus_handle_t bus, uint8_t addr)
+{
+    // No id register: a device at this address that accepts the power-on opcode is taken as BH1750
+    i2c_bus_device_handle_t dev = i2c_bus_device_create(bus, addr, 0);
+    if (dev == NULL) return I2C_CHIP_UNKNOWN;
+    esp_err_t ret = i2c_bus_write_byte(dev, NULL_I2C_MEM_ADDR, BH1750_CMD_POWER_ON);
+    i2c_bus_device_delete(&dev);
+    return ret == ESP_OK ? I2C_CHIP_BH1750 : I2C_CHIP_UNKNOWN;
+}
+
+static i2c_chip_t identify_oled(i2c_bus_handle_t bus, uint8_t addr)
+{
+    // A read without control byte returns the status register of the controller
+    uint8_t status;
+    if (read_reg(bus, addr, NULL_I2C_MEM_ADDR, &status) != ESP_OK) return I2C_CHIP_UNKNOWN;
+    ESP_LOGD(TAG, "0x%02x: OLED status 0x%02x", addr, status);
+    return (status & 0x0F) == SH1106_STATUS_ID ? I2C_CHIP_SH1106 : I2C_CHIP_SSD1306;
+}
+
+static const candidate_t *find_candidate(uint8_t addr)
+{
+    for (size_t i = 0; i < sizeof(s_candidates) / sizeof(s_candidates[0]); i++) {
+        if (s_candidates[i].addr == addr) return &s_candidates[i];
+    }
+    return NULL;
+}
+
+static void scan_add(scan_job_t *job, uint8_t addr, i2c_chip_t chip)
+{
+    if (job->count >= I2C_DISCOVERY_MAX_DEVICES) {
+        ESP_LOGW(TAG, "bus %d: too many devices, 0x%02x dropped", job->bus_index, addr);
+        return;
+    }
+    ESP_LOGI(TAG, "bus %d: 0x%02x %s", job->bus_index, addr, i2c_discovery_chip_name(chip));
+    job->entries[job->count++] = (i2c_discovery_entry_t) {
+        .bus_index = job->bus_index,
+        .addr = addr,
+        .chip = chip,
+    };
+}
+
+static void scan_bus(scan_job_t *job)
+{
+    i2c_bus_handle_t bus = job->config->buses[job->bus_index];
+    if (job->config->full_scan) {
+        for (uint8_t addr = SCAN_FIRST_ADDR; addr <= SCAN_LAST_ADDR; addr++) {
+            if (i2c_bus_probe(bus, addr) != ESP_OK) continue;
+            const candidate_t *c = find_candidate(addr);
+            scan_add(job, addr, c ? c->identify(bus, addr) : I2C_CHIP_UNKNOWN);
+        }
+        return;
+    }
+    // Only the addresses of known chips: 6 probes instead of 112
+    for (size_t i = 0; i < sizeof(s_candidates) / sizeof(s_candidates[0]); i++) {
+        const candidate_t *c = &s_candidates[i];
+        if (i2c_bus_probe(bus, c->addr) != ESP_OK) continue;
+        i2c_chip_t chip = c->identify(bus, c->addr);
+        if (chip != I2C_CHIP_UNKNOWN) scan_add(job, c->addr, chip);
+    }
+}
+
+static void scan_task(void *arg)
+{
+    scan_job_t *job = arg;
+    scan_bus(job);
+    xEventGroupSetBits(job->done, (EventBits_t)1 << job->bus_index);
+    vTaskDelete(NULL);
+}
+
+// Every bus is scanned by its own task, so probes on different controllers overlap
+static esp_err_t scan_all(const i2c_discovery_config_t *config, i2c_discovery_result_t *result)
+{
+    scan_job_t *jobs = calloc(config->bus_num, sizeof(scan_job_t));
+    EventGroupHandle_t done = xEventGroupCreate();
+    if (jobs == NULL || done == NULL) {
+        free(jobs);
+        if (done) vEventGroupDelete(done);
+        return ESP_ERR_NO_MEM;
+    }
+
+    EventBits_t started = 0;
+    for (size_t i = 0; i < config->bus_num; i++) {
+        jobs[i].config = config;
+        jobs[i].bus_index = i;
+        jobs[i].done = done;
+        if (xTaskCreate(scan_task, "i2c_scan", SCAN_TASK_STACK, &jobs[i], uxTaskPriorityGet(NULL), NULL) == pdPASS) {
+            started |= (EventBits_t)1 << i;
+        } else {
+            ESP_LOGW(TAG, "bus %d: no memory for a scan task, scanning inline", (int)i);
+            scan_bus(&jobs[i]);
+        }
+    }
+    // Every probe is bounded by the i2c_bus timeout, so the tasks always finish
+    if (started) xEventGroupWaitBits(done, started, pdFALSE, pdTRUE, portMAX_DELAY);
+
+    result->count = 0;
+    for (size_t i = 0; i < config->bus_num; i++) {
+        for (size_t j = 0; j < jobs[i].count && result->count < I2C_DISCOVERY_MAX_DEVICES; j++) {
+            result->entries[result->count++] = jobs[i].entries[j];
+        }
+    }
+    vEventGroupDelete(done);
+    free(jobs);
+    return ESP_OK;
+}
+
+static bool cache_load(const i2c_discovery_config_t *config, i2c_discovery_result_t *result)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+    cache_blob_t blob;
+    size_t len = sizeof(blob);
+    esp_err_t ret = nvs_get_blob(nvs, NVS_KEY, &blob, &len);
+    nvs_close(nvs);
+    if (ret != ESP_OK || len != sizeof(blob) || blob.magic != CACHE_MAGIC || blob.version != CACHE_VERSION) return false;
+    if (blob.layout_id != config->layout_id || blob.bus_num != config->bus_num || blob.count > I2C_DISCOVERY_MAX_DEVICES) return false;
+
+    result->count = blob.count;
+    for (size_t i = 0; i < blob.count; i++) {
+        result->entries[i] = blob.entries[i];
+        result->entries[i].bound = 0;
+        if (result->entries[i].bus_index >= config->bus_num) return false;
+    }
+    return true;
+}
+
+static void cache_store(const i2c_discovery_config_t *config, const i2c_discovery_result_t *result)
+{
+    cache_blob_t blob = {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .bus_num = config->bus_num,
+        .count = result->count,
+        .layout_id = config->layout_id,
+    };
+    memcpy(blob.entries, result->entries, result->count * sizeof(i2c_discovery_entry_t));
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, NVS_KEY, &blob, sizeof(blob));
+        if (ret == ESP_OK) ret = nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) ESP_LOGW(TAG, "could not store discovery cache: %s", esp_err_to_name(ret));
+}
+
+esp_err_t i2c_discovery_invalidate_cache(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) return ret;
+    ret = nvs_erase_key(nvs, NVS_KEY);
+    if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) ret = nvs_commit(nvs);
+    nvs_close(nvs);
+    return ret;
+}
+
+// Cached devices are only addressed, never identified again: one empty write each
+static bool cache_still_valid(const i2c_discovery_config_t *config, const i2c_discovery_result_t *result)
+{
+    for (size_t i = 0; i < result->count; i++) {
+        const i2c_discovery_entry_t *e = &result->entries[i];
+        if (i2c_bus_probe(config->buses[e->bus_index], e->addr) != ESP_OK) {
+            ESP_LOGW(TAG, "cached %s at 0x%02x does not answer, rescanning", i2c_discovery_chip_name(e->chip), e->addr);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bind_all(const i2c_discovery_config_t *config, i2c_discovery_result_t *result)
+{
+    bool all_ok = true;
+    for (size_t i = 0; i < result->count; i++) {
+        i2c_discovery_entry_t *e = &result->entries[i];
+        i2c_discovery_bind_cb_t bind = (e->chip < I2C_CHIP_MAX) ? config->bind[e->chip] : NULL;
+        if (bind == NULL || e->bound) continue;
+        esp_err_t ret = bind(config->buses[e->bus_index], e, config->user_ctx);
+        e->bound = (ret == ESP_OK);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "binding %s at 0x%02x failed: %s", i2c_discovery_chip_name(e->chip), e->addr, esp_err_to_name(ret));
+            all_ok = false;
+        }
+    }
+    return all_ok;
+}
+
+// A driver bound from the cache owns its device already, bind_all must not call it twice
+static void keep_bound(const i2c_discovery_result_t *cached, i2c_discovery_result_t *result)
+{
+    for (size_t i = 0; i < cached->count; i++) {
+        const i2c_discovery_entry_t *c = &cached->entries[i];
+        if (!c->bound) continue;
+        for (size_t j = 0; j < result->count; j++) {
+            i2c_discovery_entry_t *e = &result->entries[j];
+            if (e->bus_index == c->bus_index && e->addr == c->addr && e->chip == c->chip) e->bound = 1;
+        }
+    }
+}
+
+esp_err_t i2c_discovery_run(const i2c_discovery_config_t *config, i2c_discovery_result_t *result)
+{
+    if (config == NULL || result == NULL || config->bus_num == 0 || config->bus_num > I2C_DISCOVERY_MAX_BUSES) return ESP_ERR_INVALID_ARG;
+    for (size_t i = 0; i < config->bus_num; i++) {
+        if (config->buses[i] == NULL) return ESP_ERR_INVALID_ARG;
+    }
+    memset(result, 0, sizeof(*result));
+
+    i2c_discovery_result_t cached = { 0 };
+    if (config->use_cache && cache_load(config, result) && cache_still_valid(config, result)) {
+        ESP_LOGI(TAG, "%d device(s) from cache, scan skipped", (int)result->count);
+        if (bind_all(config, result)) {
+            result->from_cache = true;
+            return ESP_OK;
+        }
+        // A device answers but is not what the cache says: scan now, keep the drivers that did bind
+        ESP_LOGW(TAG, "cached result does not match the buses, rescanning");
+        i2c_discovery_invalidate_cache();
+        cached = *result;
+    }
+
+    memset(result, 0, sizeof(*result));
+    esp_err_t ret = scan_all(config, result);
+    if (ret != ESP_OK) return ret;
+    ESP_LOGI(TAG, "%d device(s) found on %d bus(es)", (int)result->count, (int)config->bus_num);
+    if (config->use_cache) cache_store(config, result);
+    keep_bound(&cached, result);
+    bind_all(config, result);
+    return ESP_OK;
+}
+
+const i2c_discovery_entry_t *i2c_discovery_find(const i2c_discovery_result_t *result, i2c_chip_t chip)
+{
+    for (size_t i = 0; i < result->count; i++) {
+        if (result->entries[i].chip == chip) return &result->entries[i];
+    }
+    return NULL;
+}
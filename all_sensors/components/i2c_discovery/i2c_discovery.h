@@ -0,0 +1,109 @@
+#ifndef I2C_DISCOVERY_H
+#define I2C_DISCOVERY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "i2c_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_DISCOVERY_MAX_BUSES 4                                                                           /*!< Hardware plus software ports scanned in one run */
+#define I2C_DISCOVERY_MAX_DEVICES 16                                                                        /*!< Devices remembered across all buses */
+
+/**
+ * @brief Chips the discovery can tell apart
+ */
+typedef enum {
+    I2C_CHIP_UNKNOWN = 0,                                                                                   /*!< Acknowledged its address, not identified (full scan only) */
+    I2C_CHIP_BME280,                                                                                        /*!< Bosch BME280, chip-id 0x60 */
+    I2C_CHIP_BMP280,                                                                                        /*!< Bosch BMP280, chip-id 0x58 (0x56/0x57 on samples) */
+    I2C_CHIP_BH1750,                                                                                        /*!< ROHM BH1750 ambient light sensor, no id register */
+    I2C_CHIP_SSD1306,                                                                                       /*!< SSD1306 OLED controller */
+    I2C_CHIP_SH1106,                                                                                        /*!< SH1106 OLED controller */
+    I2C_CHIP_MAX,
+} i2c_chip_t;
+
+/**
+ * @brief One discovered device
+ */
+typedef struct {
+    uint8_t bus_index;                                                                                      /*!< Index into i2c_discovery_config_t::buses */
+    uint8_t addr;                                                                                           /*!< 7-bit address */
+    uint8_t chip;                                                                                           /*!< i2c_chip_t */
+    uint8_t bound;                                                                                          /*!< 1 if a driver was bound successfully */
+} i2c_discovery_entry_t;
+
+/**
+ * @brief Driver binding callback, called once per discovered device of the chip it is registered for
+ *
+ * @param bus Bus the device was found on
+ * @param entry Discovered device
+ * @param user_ctx i2c_discovery_config_t::user_ctx
+ * @return ESP_OK if the driver took the device. Any error on a cached entry invalidates the cache and rescans the
+ *         buses in the same run; a device bound from the cache is not bound again.
+ */
+typedef esp_err_t (*i2c_discovery_bind_cb_t)(i2c_bus_handle_t bus, const i2c_discovery_entry_t *entry, void *user_ctx);
+
+/**
+ * @brief Discovery configuration
+ */
+typedef struct {
+    i2c_bus_handle_t buses[I2C_DISCOVERY_MAX_BUSES];                                                        /*!< Buses to scan, each one in its own task */
+    size_t bus_num;                                                                                         /*!< Number of valid entries in buses */
+    bool full_scan;                                                                                         /*!< Probe every address 0x08-0x77, not only those of known chips */
+    bool use_cache;                                                                                         /*!< Load the result from NVS and skip the scan when possible */
+    uint32_t layout_id;                                                                                     /*!< Stored with the cache, a different value invalidates it (e.g. board revision) */
+    i2c_discovery_bind_cb_t bind[I2C_CHIP_MAX];                                                             /*!< Driver per chip, NULL leaves the device unbound */
+    void *user_ctx;                                                                                         /*!< Passed to every bind callback */
+} i2c_discovery_config_t;
+
+/**
+ * @brief Discovery result
+ */
+typedef struct {
+    i2c_discovery_entry_t entries[I2C_DISCOVERY_MAX_DEVICES];                                               /*!< Devices sorted by bus and address */
+    size_t count;                                                                                           /*!< Number of valid entries */
+    bool from_cache;                                                                                        /*!< true if the scan was skipped */
+} i2c_discovery_result_t;
+
+/**
+ * @brief Find the devices on all configured buses, identify them and bind their drivers
+ *
+ * With use_cache set, a result stored by a previous run is used as is. If binding a cached device fails, the cache
+ * is dropped and the buses are scanned in the same call; the devices still unbound are bound from the scan result.
+ * After a scan the result is written back to NVS (nvs_flash_init must have been called).
+ *
+ * @param config Discovery configuration
+ * @param result Filled with the discovered devices
+ * @return
+ *     - ESP_OK Success, even if nothing was found
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_NO_MEM Scan tasks could not be created
+ */
+esp_err_t i2c_discovery_run(const i2c_discovery_config_t *config, i2c_discovery_result_t *result);
+
+/**
+ * @brief Drop the cached result, the next run scans the buses again
+ */
+esp_err_t i2c_discovery_invalidate_cache(void);
+
+/**
+ * @brief Find the first discovered device of a chip
+ *
+ * @return Entry or NULL
+ */
+const i2c_discovery_entry_t *i2c_discovery_find(const i2c_discovery_result_t *result, i2c_chip_t chip);
+
+/**
+ * @brief Human readable chip name
+ */
+const char *i2c_discovery_chip_name(i2c_chip_t chip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
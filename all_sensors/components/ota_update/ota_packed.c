@@ -0,0 +1,83 @@
+#include <string.h>
+#include "esp_rom_crc.h"
+#include "ota_packed.h"
+
+#define IMAGE_MAGIC 0xE9                                                                                    /*!< esp_image_header_t.magic */
+#define APP_DESC_OFFSET 32                                                                                  /*!< After the image and segment headers */
+#define APP_DESC_MAGIC 0xABCD5432
+#define APP_DESC_VERSION 16                                                                                 /*!< Offsets in esp_app_desc_t */
+#define APP_DESC_PROJECT_NAME 48
+#define HEADER_V1_LEN 80
+#define HEADER_V2_LEN 88
+#define HEADER_V3_LEN 40
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void copy_string(char *dst, const uint8_t *src, size_t size)
+{
+    memcpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+esp_err_t ota_packed_parse(const uint8_t *data, size_t len, ota_packed_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    if (len == 0) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    size_t pos = 0;
+    if (data[0] == IMAGE_MAGIC) {
+        if (len < OTA_PACKED_APP_HEADER_LEN) {
+            return ESP_ERR_NOT_FINISHED;
+        }
+        const uint8_t *desc = data + APP_DESC_OFFSET;
+        if (le32(desc) != APP_DESC_MAGIC) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        info->has_app_header = true;
+        copy_string(info->app_version, desc + APP_DESC_VERSION, sizeof(info->app_version));
+        copy_string(info->project_name, desc + APP_DESC_PROJECT_NAME, sizeof(info->project_name));
+        pos = OTA_PACKED_APP_HEADER_LEN;
+    }
+
+    const uint8_t *h = data + pos;
+    if (len < pos + 5) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    if (memcmp(h, "ESP", 4) != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    info->version = h[4];
+    size_t header_len = info->version == 1 ? HEADER_V1_LEN : info->version == 2 ? HEADER_V2_LEN
+                      : info->version == 3 ? HEADER_V3_LEN : 0;
+    if (header_len == 0) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (len < pos + header_len) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    if (esp_rom_crc32_le(0, h, header_len - 4) != le32(h + header_len - 4)) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    info->compress = h[5] & 0x0f;
+    info->delta = h[5] >> 4;
+    if (info->version < 3) {
+        // Encryption type (deprecated), reserved, firmware version[32], length, MD5 in 32 bytes
+        info->length = le32(h + 40);
+        memcpy(info->md5, h + 44, sizeof(info->md5));
+        if (info->version == 2) {
+            info->base_len = le32(h + 76);
+            info->base_crc = le32(h + 80);
+        }
+    } else {
+        // Reserved[10], length, MD5
+        info->length = le32(h + 16);
+        memcpy(info->md5, h + 20, sizeof(info->md5));
+    }
+    info->header_len = pos + header_len;
+    return ESP_OK;
+}
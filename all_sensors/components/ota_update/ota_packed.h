@@ -0,0 +1,55 @@
+#ifndef OTA_PACKED_H
+#define OTA_PACKED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_PACKED_APP_HEADER_LEN 288                                                                       /*!< Image header, first segment header and esp_app_desc_t */
+#define OTA_PACKED_HEADER_MAX 88                                                                            /*!< Of the v2 header, the longest */
+#define OTA_PACKED_PREFIX_MAX (OTA_PACKED_APP_HEADER_LEN + OTA_PACKED_HEADER_MAX)
+
+typedef enum {
+    OTA_PACKED_COMPRESS_NONE = 0,
+    OTA_PACKED_COMPRESS_XZ = 1,
+} ota_packed_compress_t;
+
+/**
+ * @brief What the header of a packed image says
+ */
+typedef struct {
+    uint8_t version;                                                                                        /*!< Header version, 1..3 */
+    uint8_t compress;                                                                                       /*!< ota_packed_compress_t */
+    uint8_t delta;                                                                                          /*!< Non-zero: a patch against the running app */
+    uint32_t length;                                                                                        /*!< Of the compressed data */
+    uint8_t md5[16];                                                                                        /*!< Of the compressed data */
+    uint32_t base_len;                                                                                      /*!< v2: bytes of the running app its base_crc covers */
+    uint32_t base_crc;
+    bool has_app_header;                                                                                    /*!< The new app's header came first (--add_app_header) */
+    char app_version[33];                                                                                   /*!< From its esp_app_desc_t, "" without the app header */
+    char project_name[33];
+    size_t header_len;                                                                                      /*!< Bytes before the compressed data */
+} ota_packed_info_t;
+
+/**
+ * @brief Parse the start of a file made by gen_custom_ota.py (cmake_utilities, "idf.py gen_compressed_ota")
+ *
+ * Layout: optionally the first OTA_PACKED_APP_HEADER_LEN bytes of the new app, then "ESP\0", the header version
+ * and the v1 (80 bytes), v2 (88) or v3 (40) header ending in a CRC-32 of itself, then the compressed data.
+ *
+ * @param len Bytes of the file at data so far
+ * @return ESP_ERR_NOT_FINISHED if more bytes are needed; ESP_ERR_INVALID_RESPONSE if it is not such a file;
+ * ESP_ERR_INVALID_VERSION for an unknown header version; ESP_ERR_INVALID_CRC if the header is damaged
+ */
+esp_err_t ota_packed_parse(const uint8_t *data, size_t len, ota_packed_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,249 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "ota_stream.h"
+
+#define TAG "OTA"
+
+static esp_err_t fail(ota_stream_t *s, esp_err_t err)
+{
+    if (s->error == ESP_OK) {
+        s->error = err;
+    }
+    return s->error;
+}
+
+static esp_err_t flush_out(ota_stream_t *s)
+{
+    if (s->out_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t ret = s->config.target.write(s->config.target.ctx, s->out, s->out_len);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Write at %" PRIu32 " failed (%s)", s->stats.written, esp_err_to_name(ret));
+        return ret;
+    }
+    s->stats.written += s->out_len;
+    s->out_len = 0;
+    return ESP_OK;
+}
+
+static esp_err_t start(ota_stream_t *s)
+{
+    const ota_packed_info_t *info = &s->info;
+    if (info->delta) {
+        // Patches against the running app are not produced by gen_custom_ota.py, there is nothing to apply them with
+        ESP_LOGE(TAG, "Delta image, not supported");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (info->compress == OTA_PACKED_COMPRESS_XZ && !s->config.xz) {
+        ESP_LOGE(TAG, "xz image, no decoder");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (info->compress != OTA_PACKED_COMPRESS_NONE && info->compress != OTA_PACKED_COMPRESS_XZ) {
+        ESP_LOGE(TAG, "Unknown compression %u", info->compress);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    esp_err_t ret;
+    if (s->config.accept && (ret = s->config.accept(s->config.ctx, info)) != ESP_OK) {
+        return ret;
+    }
+    ESP_LOGI(TAG, "Image %s%s%" PRIu32 " bytes, %s, header v%u", info->app_version, info->has_app_header ? ", " : "",
+             info->length, info->compress == OTA_PACKED_COMPRESS_XZ ? "xz" : "uncompressed", info->version);
+    if (info->compress == OTA_PACKED_COMPRESS_XZ && (ret = s->config.xz->begin(&s->decoder)) != ESP_OK) {
+        s->decoder = NULL;
+        return ret;
+    }
+    if ((ret = s->config.target.begin(s->config.target.ctx)) != ESP_OK) {
+        return ret;
+    }
+    s->target_open = true;
+    return ESP_OK;
+}
+
+static esp_err_t take_data(ota_stream_t *s, const uint8_t *data, size_t len)
+{
+    if (len > s->info.length - s->data_received) {
+        ESP_LOGE(TAG, "More data than the %" PRIu32 " bytes in the header", s->info.length);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_rom_md5_update(&s->md5, data, len);
+    s->data_received += len;
+
+    esp_err_t ret;
+    while (len > 0) {
+        size_t used, made;
+        if (s->info.compress == OTA_PACKED_COMPRESS_NONE) {
+            used = made = len < OTA_STREAM_OUT_LEN - s->out_len ? len : OTA_STREAM_OUT_LEN - s->out_len;
+            memcpy(s->out + s->out_len, data, made);
+        } else {
+            if (s->decoded) {
+                ESP_LOGE(TAG, "Data after the end of the xz stream");
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            ret = s->config.xz->run(s->decoder, data, len, &used, s->out + s->out_len, OTA_STREAM_OUT_LEN - s->out_len,
+                                    &made, &s->decoded);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Decompression failed at %" PRIu32 " (%s)", s->data_received - (uint32_t)len,
+                         esp_err_to_name(ret));
+                return ret;
+            }
+        }
+        data += used;
+        len -= used;
+        s->out_len += made;
+        if (s->out_len == OTA_STREAM_OUT_LEN && (ret = flush_out(s)) != ESP_OK) {
+            return ret;
+        }
+        if (used == 0 && made == 0 && !s->decoded) {
+            return ESP_ERR_INVALID_RESPONSE; // Stuck with room for output: cannot happen with a working decoder
+        }
+    }
+    // The decoder may hold output back while its buffer is full; the last of it comes without input
+    while (s->decoder && !s->decoded && s->data_received == s->info.length) {
+        size_t used, made;
+        ret = s->config.xz->run(s->decoder, NULL, 0, &used, s->out + s->out_len, OTA_STREAM_OUT_LEN - s->out_len,
+                                &made, &s->decoded);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        s->out_len += made;
+        if (s->out_len == OTA_STREAM_OUT_LEN && (ret = flush_out(s)) != ESP_OK) {
+            return ret;
+        }
+        if (made == 0 && !s->decoded) {
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_init(ota_stream_t *s, const ota_stream_config_t *config)
+{
+    if (!config->target.begin || !config->target.write || !config->target.finish || !config->target.abort) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s, 0, sizeof(*s));
+    s->config = *config;
+    if (s->config.attempts == 0) {
+        s->config.attempts = 1;
+    }
+    esp_rom_md5_init(&s->md5);
+    return ESP_OK;
+}
+
+esp_err_t ota_stream_feed(void *ctx, const uint8_t *data, size_t len)
+{
+    ota_stream_t *s = ctx;
+    if (s->error != ESP_OK) {
+        return s->error;
+    }
+    s->stats.received += len;
+    if (!s->have_info) {
+        // The header is gathered first; what came with it is the start of the data
+        size_t take = sizeof(s->head) - s->head_len < len ? sizeof(s->head) - s->head_len : len;
+        memcpy(s->head + s->head_len, data, take);
+        s->head_len += take;
+        esp_err_t ret = ota_packed_parse(s->head, s->head_len, &s->info);
+        if (ret == ESP_ERR_NOT_FINISHED) {
+            return ESP_OK;
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Not a packed image (%s)", esp_err_to_name(ret));
+            return fail(s, ret);
+        }
+        s->have_info = true;
+        if ((ret = start(s)) != ESP_OK) {
+            return fail(s, ret);
+        }
+        size_t extra = s->head_len - s->info.header_len;
+        if (extra && (ret = take_data(s, s->head + s->info.header_len, extra)) != ESP_OK) {
+            return fail(s, ret);
+        }
+        data += take;
+        len -= take;
+    }
+    esp_err_t ret = len ? take_data(s, data, len) : ESP_OK;
+    return ret == ESP_OK ? ESP_OK : fail(s, ret);
+}
+
+esp_err_t ota_stream_finish(ota_stream_t *s)
+{
+    if (s->error != ESP_OK) {
+        return s->error;
+    }
+    if (!s->have_info || s->data_received != s->info.length ||
+        (s->info.compress == OTA_PACKED_COMPRESS_XZ && !s->decoded)) {
+        ESP_LOGE(TAG, "Image incomplete, %" PRIu32 " of %" PRIu32 " bytes", s->data_received, s->info.length);
+        return fail(s, ESP_ERR_INVALID_SIZE);
+    }
+    uint8_t md5[ESP_ROM_MD5_DIGEST_LEN];
+    esp_rom_md5_final(md5, &s->md5);
+    if (memcmp(md5, s->info.md5, sizeof(md5)) != 0) {
+        ESP_LOGE(TAG, "MD5 of the data does not match the header");
+        return fail(s, ESP_ERR_INVALID_CRC);
+    }
+    esp_err_t ret = flush_out(s);
+    if (ret == ESP_OK) {
+        ret = s->config.target.finish(s->config.target.ctx);
+    }
+    if (ret != ESP_OK) {
+        return fail(s, ret);
+    }
+    s->target_open = false;
+    if (s->decoder) {
+        s->config.xz->end(s->decoder);
+        s->decoder = NULL;
+    }
+    ESP_LOGI(TAG, "Image of %" PRIu32 " bytes from %" PRIu32 " received", s->stats.written, s->stats.received);
+    return ESP_OK;
+}
+
+void ota_stream_abort(ota_stream_t *s)
+{
+    if (s->target_open) {
+        s->config.target.abort(s->config.target.ctx);
+        s->target_open = false;
+    }
+    if (s->decoder) {
+        s->config.xz->end(s->decoder);
+        s->decoder = NULL;
+    }
+    fail(s, ESP_ERR_INVALID_STATE);
+}
+
+esp_err_t ota_stream_download(ota_stream_t *s, data_fetch_t *client, const char *path)
+{
+    esp_err_t ret = ESP_FAIL;
+    uint32_t wait_ms = s->config.retry_ms;
+    for (int attempt = 0; attempt < s->config.attempts; attempt++) {
+        if (attempt > 0) {
+            ESP_LOGW(TAG, "Download broken at %" PRIu32 " (%s), resuming", s->stats.received, esp_err_to_name(ret));
+            vTaskDelay(pdMS_TO_TICKS(wait_ms));
+            wait_ms *= 2;
+            s->stats.resumes++;
+        }
+        data_fetch_download_t dl = { .path = path, .offset = s->stats.received, .sink = ota_stream_feed, .ctx = s };
+        s->stats.requests++;
+        ret = data_fetch_download(client, &dl);
+        if (s->error != ESP_OK) {
+            ret = s->error; // The image itself is bad, fetching it again will not help
+            break;
+        }
+        if (ret == ESP_OK) {
+            ret = ota_stream_finish(s);
+            break;
+        }
+        // Statuses are the server's answer, only a broken connection is worth another try
+        if (ret != ESP_ERR_TIMEOUT && ret != ESP_ERR_INVALID_STATE && ret != ESP_FAIL) {
+            break;
+        }
+        data_fetch_close(client);
+    }
+    if (ret != ESP_OK) {
+        ota_stream_abort(s);
+    }
+    return ret;
+}
@@ -0,0 +1,124 @@
+#ifndef OTA_STREAM_H
+#define OTA_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_rom_md5.h"
+#include "data_fetch.h"
+#include "ota_packed.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_STREAM_OUT_LEN 4096                                                                             /*!< Decompressed bytes are written in pieces of a flash sector */
+
+/**
+ * @brief Streaming decompressor
+ */
+typedef struct {
+    esp_err_t (*begin)(void **state);
+    /**
+     * Take input, make output, as much of either as fits; end once the stream is complete and its check matched.
+     * ESP_ERR_INVALID_RESPONSE for corrupt data.
+     */
+    esp_err_t (*run)(void *state, const uint8_t *in, size_t in_len, size_t *in_used, uint8_t *out, size_t out_len,
+                     size_t *out_made, bool *end);
+    void (*end)(void *state);
+} ota_decoder_t;
+
+/**
+ * @brief Where the image goes, written from its first byte to its last
+ */
+typedef struct {
+    esp_err_t (*begin)(void *ctx);
+    esp_err_t (*write)(void *ctx, const void *data, size_t len);
+    esp_err_t (*finish)(void *ctx);                                                                         /*!< Image complete and checked: make it the one to boot */
+    void (*abort)(void *ctx);
+    void *ctx;
+} ota_target_t;
+
+typedef struct {
+    const ota_decoder_t *xz;                                                                                /*!< NULL: uncompressed images only */
+    ota_target_t target;
+    /**
+     * Called once the header is in, before anything is written: anything but ESP_OK gives the image up, e.g.
+     * ESP_ERR_INVALID_VERSION for the version that is running. NULL: any image.
+     */
+    esp_err_t (*accept)(void *ctx, const ota_packed_info_t *info);
+    void *ctx;
+    uint8_t attempts;                                                                                       /*!< Requests per ota_stream_download, resuming where the last stopped */
+    uint32_t retry_ms;                                                                                      /*!< Wait before resuming, doubled each time */
+} ota_stream_config_t;
+
+/**
+ * @brief Download counters
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t resumes;                                                                                       /*!< Requests from an offset after a broken one */
+    uint32_t received;                                                                                      /*!< Bytes of the file taken, where a resume starts */
+    uint32_t written;                                                                                       /*!< Decompressed bytes written to the target */
+} ota_stream_stats_t;
+
+/**
+ * @brief A packed image (ota_packed_parse) on its way from the network to the target
+ *
+ * The compressed data is decompressed as it arrives and written out in OTA_STREAM_OUT_LEN pieces; the MD5 of the
+ * header is checked over the compressed data, the xz stream checks its own CRC-32, and the target checks the app
+ * image before it is made bootable. Nothing but this state is held, so a broken download resumes from the byte it
+ * stopped at, as long as the state is kept.
+ */
+typedef struct {
+    ota_stream_config_t config;
+    ota_packed_info_t info;
+    uint8_t head[OTA_PACKED_PREFIX_MAX];
+    size_t head_len;
+    bool have_info;
+    bool target_open;
+    void *decoder;
+    bool decoded;                                                                                           /*!< The decoder saw the end of its stream */
+    md5_context_t md5;
+    uint32_t data_received;                                                                                 /*!< Of the compressed data */
+    uint8_t out[OTA_STREAM_OUT_LEN];
+    size_t out_len;
+    esp_err_t error;                                                                                        /*!< The first error, it sticks */
+    ota_stream_stats_t stats;
+} ota_stream_t;
+
+esp_err_t ota_stream_init(ota_stream_t *s, const ota_stream_config_t *config);
+
+/**
+ * @brief The next bytes of the file. Has the signature of data_fetch_sink_t, ctx is the stream.
+ *
+ * @return The error of the header check, the accept callback, the decoder or the target; it sticks
+ */
+esp_err_t ota_stream_feed(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief All of the file is in: check it and have the target make it bootable
+ *
+ * @return ESP_ERR_INVALID_SIZE if data is missing, ESP_ERR_INVALID_CRC if the MD5 does not match, the target's error
+ */
+esp_err_t ota_stream_finish(ota_stream_t *s);
+
+/**
+ * @brief Give the image up: the target is left as it was, not bootable
+ */
+void ota_stream_abort(ota_stream_t *s);
+
+/**
+ * @brief Download the file at path into the stream and finish it, resuming broken downloads up to config.attempts
+ * times; aborts the stream on failure
+ *
+ * @return ESP_OK once the target has taken the image; otherwise the stream's error, or the last download error
+ */
+esp_err_t ota_stream_download(ota_stream_t *s, data_fetch_t *client, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,217 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_app_desc.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "wifi_manager.h"
+#include "ota_update.h"
+
+#define TAG "OTA"
+
+#define NVS_NAMESPACE "ota"
+#define NVS_KEY_MD5 "md5"                                                                                   /*!< Of the last image installed, so it is not installed again */
+#define OFFLINE_RETRY_S 30
+
+static ota_update_config_t s_config;
+static data_fetch_t s_client; // Only the task touches it, and s_stream
+static ota_stream_t s_stream;
+static const esp_partition_t *s_part;
+static esp_ota_handle_t s_handle;
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock; // s_stats
+static ota_update_stats_t s_stats;
+
+static esp_err_t target_begin(void *ctx)
+{
+    s_part = esp_ota_get_next_update_partition(NULL);
+    ESP_RETURN_ON_FALSE(s_part, ESP_ERR_NOT_FOUND, TAG, "no OTA partition to write to");
+    // Sequential writes: each sector is erased as the image reaches it, not the whole partition up front
+    ESP_RETURN_ON_ERROR(esp_ota_begin(s_part, OTA_WITH_SEQUENTIAL_WRITES, &s_handle), TAG, "begin on \"%s\"",
+                        s_part->label);
+    ESP_LOGI(TAG, "Writing to \"%s\" at 0x%" PRIx32, s_part->label, s_part->address);
+    return ESP_OK;
+}
+
+static esp_err_t target_write(void *ctx, const void *data, size_t len)
+{
+    return esp_ota_write(s_handle, data, len);
+}
+
+static esp_err_t target_finish(void *ctx)
+{
+    // esp_ota_end checks the app image itself: segments, checksum and SHA-256
+    ESP_RETURN_ON_ERROR(esp_ota_end(s_handle), TAG, "image check");
+    return esp_ota_set_boot_partition(s_part);
+}
+
+static void target_abort(void *ctx)
+{
+    esp_ota_abort(s_handle);
+}
+
+static bool md5_installed(const uint8_t *md5)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    uint8_t last[ESP_ROM_MD5_DIGEST_LEN];
+    size_t len = sizeof(last);
+    esp_err_t ret = nvs_get_blob(nvs, NVS_KEY_MD5, last, &len);
+    nvs_close(nvs);
+    return ret == ESP_OK && len == sizeof(last) && memcmp(last, md5, sizeof(last)) == 0;
+}
+
+static void md5_save(const uint8_t *md5)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_set_blob(nvs, NVS_KEY_MD5, md5, ESP_ROM_MD5_DIGEST_LEN);
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "MD5 not saved (%s), the image may be fetched again", esp_err_to_name(ret));
+    }
+}
+
+static esp_err_t image_accept(void *ctx, const ota_packed_info_t *info)
+{
+    const esp_app_desc_t *app = esp_app_get_description();
+    if (info->has_app_header) {
+        if (strncmp(info->project_name, app->project_name, sizeof(app->project_name)) != 0) {
+            ESP_LOGE(TAG, "Image of \"%s\", not of \"%s\"", info->project_name, app->project_name);
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (strncmp(info->app_version, app->version, sizeof(app->version)) == 0) {
+            ESP_LOGI(TAG, "Version %s is running", app->version);
+            return ESP_ERR_INVALID_VERSION;
+        }
+    }
+    // Without the app header, or with the version unchanged between builds, the MD5 tells images apart
+    if (md5_installed(info->md5)) {
+        ESP_LOGI(TAG, "Image installed before");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t check(void)
+{
+    const ota_stream_config_t conf = {
+        .xz = &ota_decoder_xz,
+        .target = {
+            .begin = target_begin,
+            .write = target_write,
+            .finish = target_finish,
+            .abort = target_abort,
+        },
+        .accept = image_accept,
+        .attempts = s_config.attempts,
+        .retry_ms = s_config.retry_ms,
+    };
+    ESP_RETURN_ON_ERROR(ota_stream_init(&s_stream, &conf), TAG, "stream");
+    esp_err_t ret = ota_stream_download(&s_stream, &s_client, s_config.path);
+    data_fetch_close(&s_client); // Hours until the next check, the server will not keep it that long
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.checks++;
+    s_stats.last = s_stream.stats;
+    s_stats.last_error = ret;
+    if (ret == ESP_ERR_INVALID_VERSION) {
+        s_stats.up_to_date++;
+    } else if (ret != ESP_OK) {
+        s_stats.failures++;
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+static void ota_task(void *arg)
+{
+    TickType_t wait = pdMS_TO_TICKS(s_config.first_check_s * 1000);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!wifi_manager_is_connected()) {
+            wait = pdMS_TO_TICKS(OFFLINE_RETRY_S * 1000);
+            continue;
+        }
+        wait = pdMS_TO_TICKS(s_config.check_interval_s * 1000);
+        esp_err_t ret = check();
+        if (ret == ESP_OK) {
+            md5_save(s_stream.info.md5);
+            ESP_LOGW(TAG, "Version %s installed, restarting", s_stream.info.app_version);
+            vTaskDelay(pdMS_TO_TICKS(500)); // Let the log out
+            esp_restart();
+        } else if (ret != ESP_ERR_INVALID_VERSION) {
+            ESP_LOGW(TAG, "Update failed (%s)", esp_err_to_name(ret));
+        }
+    }
+}
+
+esp_err_t ota_update_start(const ota_update_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->host && config->path && config->check_interval_s, ESP_ERR_INVALID_ARG, TAG,
+                        "bad config");
+    ESP_RETURN_ON_FALSE(!s_task, ESP_ERR_INVALID_STATE, TAG, "already started");
+    s_config = *config;
+    const data_fetch_config_t fetch_conf = {
+        .host = config->host,
+        .port = config->port,
+        .transport = config->transport,
+        .timeout_ms = config->timeout_ms,
+    };
+    ESP_RETURN_ON_ERROR(data_fetch_init(&s_client, &fetch_conf), TAG, "client");
+
+    s_lock = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_lock, ESP_ERR_NO_MEM, TAG, "no memory for the lock");
+    // Core 0 with Wi-Fi and lwIP; flash writes stall both cores anyway, decompression at least does not
+    ESP_RETURN_ON_FALSE(xTaskCreatePinnedToCore(ota_task, "ota", config->task_stack, NULL, tskIDLE_PRIORITY + 1,
+                                                &s_task, 0) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "no memory for the task");
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    ESP_LOGI(TAG, "Running %s from \"%s\", checking http://%s:%u%s", esp_app_get_description()->version,
+             running->label, config->host, config->port, config->path);
+    return ESP_OK;
+}
+
+void ota_update_check_now(void)
+{
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void ota_update_confirm(void)
+{
+    esp_ota_img_states_t state;
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    if (esp_ota_get_state_partition(running, &state) == ESP_OK && state == ESP_OTA_IMG_PENDING_VERIFY) {
+        esp_err_t ret = esp_ota_mark_app_valid_cancel_rollback();
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "Version %s confirmed", esp_app_get_description()->version);
+        } else {
+            ESP_LOGE(TAG, "Confirm failed (%s)", esp_err_to_name(ret));
+        }
+    }
+}
+
+void ota_update_get_stats(ota_update_stats_t *stats)
+{
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
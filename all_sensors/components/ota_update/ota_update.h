@@ -0,0 +1,86 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "data_fetch.h"
+#include "ota_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Update configuration. The strings are kept by pointer and must stay valid.
+ */
+typedef struct {
+    const char *host;                                                                                       /*!< HTTP file server, e.g. "python3 -m http.server" in the build directory */
+    uint16_t port;
+    const char *path;                                                                                       /*!< "/custom_ota_binaries/<project>.bin.xz.packed" */
+    const data_fetch_transport_t *transport;                                                                /*!< NULL: plain TCP */
+    uint32_t timeout_ms;
+    uint32_t first_check_s;                                                                                 /*!< After ota_update_start */
+    uint32_t check_interval_s;
+    uint8_t attempts;                                                                                       /*!< Requests per update, resuming where the last stopped */
+    uint32_t retry_ms;
+    uint32_t task_stack;
+} ota_update_config_t;
+
+#define OTA_UPDATE_DEFAULT_CONFIG() {                                                                       \
+    .port = 8000,                                                                                           \
+    .timeout_ms = 10000,                                                                                    \
+    .first_check_s = 120,                                                                                   \
+    .check_interval_s = 6 * 3600,                                                                           \
+    .attempts = 6,                                                                                          \
+    .retry_ms = 2000,                                                                                       \
+    .task_stack = 6144,                                                                                     \
+}
+
+/**
+ * @brief Update counters, since ota_update_start
+ */
+typedef struct {
+    uint32_t checks;
+    uint32_t up_to_date;                                                                                    /*!< Checks that found the running version, given up after the header */
+    uint32_t failures;
+    ota_stream_stats_t last;                                                                                /*!< Of the last download */
+    esp_err_t last_error;
+} ota_update_stats_t;
+
+/**
+ * @brief xz decompression (xz-embedded of the espressif/xz component), dictionaries up to 64 KB as
+ * gen_custom_ota.py makes them
+ */
+extern const ota_decoder_t ota_decoder_xz;
+
+/**
+ * @brief Check the server for a new image now and then, and install it into the other OTA partition
+ *
+ * The image is decompressed while it downloads, the app keeps running throughout; only the restart into the new
+ * app interrupts it. An image whose app header carries the running version is given up after its first bytes.
+ * The task runs on core 0 with the network stack and only while Wi-Fi is connected.
+ */
+esp_err_t ota_update_start(const ota_update_config_t *config);
+
+/**
+ * @brief Check now instead of at the next interval
+ */
+void ota_update_check_now(void);
+
+/**
+ * @brief The running app works: keep it. Until this is called after an update, a reset rolls back to the previous
+ * app (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE).
+ */
+void ota_update_confirm(void);
+
+/**
+ * @brief Copy of the counters
+ */
+void ota_update_get_stats(ota_update_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+#include "xz.h"
+#include "ota_update.h"
+
+#define DICT_MAX (64 * 1024)                                                                                /*!< gen_custom_ota.py: LZMA2 preset 6 with dict_size 64 KB */
+
+static esp_err_t xz_begin(void **state)
+{
+    xz_crc32_init();
+    // Allocated as the stream header asks, up to DICT_MAX; a larger dictionary is XZ_MEMLIMIT_ERROR, not an abort
+    *state = xz_dec_init(XZ_DYNALLOC, DICT_MAX);
+    return *state ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+static esp_err_t xz_run(void *state, const uint8_t *in, size_t in_len, size_t *in_used, uint8_t *out,
+                        size_t out_len, size_t *out_made, bool *end)
+{
+    struct xz_buf b = { .in = in, .in_size = in_len, .out = out, .out_size = out_len };
+    enum xz_ret ret = xz_dec_run(state, &b);
+    *in_used = b.in_pos;
+    *out_made = b.out_pos;
+    *end = ret == XZ_STREAM_END;
+    switch (ret) {
+    case XZ_OK:
+    case XZ_STREAM_END:
+    case XZ_BUF_ERROR: // No progress possible yet: more input or more room is needed
+        return ESP_OK;
+    case XZ_MEM_ERROR:
+        return ESP_ERR_NO_MEM;
+    default:
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
+static void xz_end(void *state)
+{
+    xz_dec_end(state);
+}
+
+const ota_decoder_t ota_decoder_xz = {
+    .begin = xz_begin,
+    .run = xz_run,
+    .end = xz_end,
+};
@@ -0,0 +1,159 @@
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "driver/rtc_io.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "power_cycle.h"
+
+#define TAG "POWER"
+
+static power_cycle_config_t s_config;
+static power_cycle_record_t s_current; // This wake, logged when it ends in deep sleep
+static int64_t s_activity_us;
+
+// Kept in RTC slow memory through deep sleep, loaded from the image again on power on and reset
+RTC_DATA_ATTR static power_cycle_log_t s_log;
+RTC_DATA_ATTR static int64_t s_base_us; // Since power on, up to the start of this wake
+RTC_DATA_ATTR static int64_t s_sleep_wall_us; // Wall clock when the last sleep began, 0: none
+
+static int64_t wall_us(void)
+{
+    // The system time runs on the RTC timer through deep sleep, whether or not it has been set
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static power_cycle_wake_t wake_cause(void)
+{
+    switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_UNDEFINED:
+        return POWER_CYCLE_WAKE_POWER_ON;
+    case ESP_SLEEP_WAKEUP_TIMER:
+        return POWER_CYCLE_WAKE_TIMER;
+    case ESP_SLEEP_WAKEUP_EXT0:
+        return POWER_CYCLE_WAKE_MOTION;
+    default:
+        return POWER_CYCLE_WAKE_OTHER;
+    }
+}
+
+static esp_err_t light_sleep_start(void)
+{
+#if CONFIG_PM_ENABLE
+    // The CPU sleeps whenever every task waits, the next frame or a Wi-Fi beacon wakes it. PIR is read each frame,
+    // a GPIO wake on its level would keep waking the chip for as long as the output stays high.
+    esp_pm_config_t pm = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = s_config.min_freq_mhz,
+        .light_sleep_enable = true,
+    };
+    return esp_pm_configure(&pm);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t power_cycle_init(const power_cycle_config_t *config, power_cycle_wake_t *wake)
+{
+    s_config = *config;
+    memset(&s_current, 0, sizeof(s_current));
+    s_current.cause = wake_cause();
+    if (s_current.cause == POWER_CYCLE_WAKE_POWER_ON) {
+        memset(&s_log, 0, sizeof(s_log));
+        s_base_us = 0;
+        s_sleep_wall_us = 0;
+    } else if (s_sleep_wall_us) {
+        int64_t slept_us = wall_us() - s_sleep_wall_us;
+        if (slept_us > 0) {
+            s_current.slept_ms = slept_us / 1000;
+            s_base_us += slept_us;
+        }
+    }
+    if (s_config.wake_gpio >= 0 && s_current.cause != POWER_CYCLE_WAKE_POWER_ON) {
+        rtc_gpio_deinit((gpio_num_t)s_config.wake_gpio); // Back to a plain GPIO for the app to read
+    }
+    *wake = s_current.cause;
+
+    esp_err_t ret = ESP_OK;
+    if (s_config.mode == POWER_CYCLE_MODE_LIGHT_SLEEP && (ret = light_sleep_start()) != ESP_OK) {
+        ESP_LOGE(TAG, "No light sleep (%s), staying awake", esp_err_to_name(ret));
+        s_config.mode = POWER_CYCLE_MODE_ALWAYS_ON;
+    }
+    if (s_config.mode == POWER_CYCLE_MODE_DEEP_SLEEP && s_config.sample_period_s == 0) {
+        s_config.mode = POWER_CYCLE_MODE_ALWAYS_ON;
+        ret = ESP_ERR_INVALID_ARG;
+    }
+    return ret;
+}
+
+power_cycle_mode_t power_cycle_mode(void)
+{
+    return s_config.mode;
+}
+
+void power_cycle_set_on(uint8_t on)
+{
+    s_current.on = on;
+}
+
+void power_cycle_ready(void)
+{
+    if (s_current.ready_us == 0) {
+        s_current.ready_us = esp_timer_get_time();
+    }
+}
+
+void power_cycle_activity(void)
+{
+    s_activity_us = esp_timer_get_time();
+}
+
+bool power_cycle_idle(void)
+{
+    return s_config.mode == POWER_CYCLE_MODE_DEEP_SLEEP &&
+           esp_timer_get_time() - s_activity_us >= (int64_t)s_config.idle_s * 1000000;
+}
+
+void power_cycle_sleep(void)
+{
+    int64_t awake_us = esp_timer_get_time();
+    s_current.awake_ms = awake_us / 1000;
+    power_cycle_log_add(&s_log, &s_current);
+    s_base_us += awake_us;
+    s_sleep_wall_us = wall_us();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)s_config.sample_period_s * 1000000);
+    if (s_config.wake_gpio >= 0) {
+        gpio_num_t pin = s_config.wake_gpio;
+        // ext0 keeps the RTC peripherals powered, so the pull-down holds the pin if the PIR is unplugged
+        rtc_gpio_init(pin);
+        rtc_gpio_set_direction(pin, RTC_GPIO_MODE_INPUT_ONLY);
+        rtc_gpio_pullup_dis(pin);
+        rtc_gpio_pulldown_en(pin);
+        esp_sleep_enable_ext0_wakeup(pin, s_config.wake_level);
+    }
+    ESP_LOGI(TAG, "Deep sleep for %" PRIu32 " s after %" PRId64 " ms awake", s_config.sample_period_s,
+             awake_us / 1000);
+    esp_deep_sleep_start();
+}
+
+int64_t power_cycle_now_us(void)
+{
+    return s_base_us + esp_timer_get_time();
+}
+
+void power_cycle_get_summary(power_cycle_log_t *log, power_cycle_summary_t *summary)
+{
+    *log = s_log;
+    power_cycle_log_summary(&s_log, &s_config.profile, summary);
+}
+
+const power_cycle_profile_t *power_cycle_profile(void)
+{
+    return &s_config.profile;
+}
@@ -0,0 +1,100 @@
+#ifndef POWER_CYCLE_H
+#define POWER_CYCLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "power_cycle_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Power mode configuration
+ */
+typedef struct {
+    power_cycle_mode_t mode;
+    int wake_gpio;                                                                                          /*!< RTC-capable pin that wakes from deep sleep (ext0), -1: timer only */
+    uint8_t wake_level;                                                                                     /*!< Level that wakes, 1 for a PIR output */
+    uint32_t sample_period_s;                                                                               /*!< Deep sleep: timer wakes for a sample */
+    uint32_t idle_s;                                                                                        /*!< Deep sleep: awake this long after power on or the last activity */
+    uint32_t min_freq_mhz;                                                                                  /*!< Light sleep: CPU clock between frames (DFS) */
+    power_cycle_profile_t profile;
+} power_cycle_config_t;
+
+#define POWER_CYCLE_DEFAULT_CONFIG() {                                                                      \
+    .mode = POWER_CYCLE_MODE_ALWAYS_ON,                                                                     \
+    .wake_gpio = -1,                                                                                        \
+    .wake_level = 1,                                                                                        \
+    .sample_period_s = 300,                                                                                 \
+    .idle_s = 120,                                                                                          \
+    .min_freq_mhz = 80,                                                                                     \
+    .profile = POWER_CYCLE_DEFAULT_PROFILE(),                                                               \
+}
+
+/**
+ * @brief Find out why the chip is running and close the record of the sleep before; set up automatic light sleep
+ * for POWER_CYCLE_MODE_LIGHT_SLEEP. Call first thing in app_main.
+ *
+ * The log, the time base and whatever the app keeps in RTC_DATA_ATTR survive deep sleep only; a power on or a reset
+ * starts them over.
+ *
+ * @param[out] wake Why the chip is running
+ * @return ESP_ERR_NOT_SUPPORTED if light sleep is asked for without CONFIG_PM_ENABLE; the mode is always-on then
+ */
+esp_err_t power_cycle_init(const power_cycle_config_t *config, power_cycle_wake_t *wake);
+
+/**
+ * @brief The mode in effect
+ */
+power_cycle_mode_t power_cycle_mode(void);
+
+/**
+ * @brief What is powered in this wake, POWER_CYCLE_ON_*; for the record and the estimate
+ */
+void power_cycle_set_on(uint8_t on);
+
+/**
+ * @brief The app is up: the wake time is measured to here. Later calls do nothing.
+ */
+void power_cycle_ready(void);
+
+/**
+ * @brief Something happened that should keep the chip awake for another idle_s
+ */
+void power_cycle_activity(void);
+
+/**
+ * @brief In deep sleep mode, idle_s have passed without activity
+ */
+bool power_cycle_idle(void);
+
+/**
+ * @brief Log this wake and go to deep sleep until the next sample or the wake pin. Does not return.
+ *
+ * The wake pin must be at rest: at its wake level the chip wakes again at once.
+ */
+void power_cycle_sleep(void);
+
+/**
+ * @brief Microseconds since power on, deep sleep included; unlike esp_timer it does not restart at each wake, unlike
+ * the wall clock it does not jump when the time is set
+ */
+int64_t power_cycle_now_us(void);
+
+/**
+ * @brief The last wakes, this one not yet among them, and what they add up to with the configured profile
+ */
+void power_cycle_get_summary(power_cycle_log_t *log, power_cycle_summary_t *summary);
+
+/**
+ * @brief The configured current profile, for power_cycle_estimate
+ */
+const power_cycle_profile_t *power_cycle_profile(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+#include <string.h>
+#include "power_cycle_stats.h"
+
+#define HOUR_MS 3600000ULL
+
+void power_cycle_log_add(power_cycle_log_t *log, const power_cycle_record_t *record)
+{
+    if (log->count < POWER_CYCLE_LOG_LEN) {
+        log->record[(log->first + log->count) % POWER_CYCLE_LOG_LEN] = *record;
+        log->count++;
+    } else {
+        log->record[log->first] = *record;
+        log->first = (log->first + 1) % POWER_CYCLE_LOG_LEN;
+    }
+    log->total++;
+}
+
+const power_cycle_record_t *power_cycle_log_get(const power_cycle_log_t *log, int i)
+{
+    if (i < 0 || i >= log->count) {
+        return NULL;
+    }
+    return &log->record[(log->first + i) % POWER_CYCLE_LOG_LEN];
+}
+
+// uA times ms of one wake, the sleep before it included
+static uint64_t record_charge(const power_cycle_profile_t *p, const power_cycle_record_t *r)
+{
+    uint64_t awake_ua = (r->on & POWER_CYCLE_ON_WIFI ? p->wifi_ua : p->active_ua) +
+                        (r->on & POWER_CYCLE_ON_DISPLAY ? p->display_ua : 0);
+    return (uint64_t)r->slept_ms * p->deep_sleep_ua + (uint64_t)p->boot_ms * p->active_ua + r->awake_ms * awake_ua;
+}
+
+void power_cycle_log_summary(const power_cycle_log_t *log, const power_cycle_profile_t *profile,
+                             power_cycle_summary_t *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    uint64_t ready_sum[POWER_CYCLE_WAKE_COUNT] = { 0 };
+    uint64_t awake_sum[POWER_CYCLE_WAKE_COUNT] = { 0 };
+    uint64_t awake_ms = 0;
+    uint64_t charge = 0;
+    for (int i = 0; i < log->count; i++) {
+        const power_cycle_record_t *r = power_cycle_log_get(log, i);
+        int cause = r->cause < POWER_CYCLE_WAKE_COUNT ? r->cause : POWER_CYCLE_WAKE_OTHER;
+        summary->wakes[cause]++;
+        ready_sum[cause] += r->ready_us;
+        awake_sum[cause] += r->awake_ms;
+        summary->slept_ms += r->slept_ms;
+        awake_ms += profile->boot_ms + r->awake_ms;
+        charge += record_charge(profile, r);
+    }
+    for (int c = 0; c < POWER_CYCLE_WAKE_COUNT; c++) {
+        if (summary->wakes[c]) {
+            summary->ready_us[c] = ready_sum[c] / summary->wakes[c];
+            summary->awake_ms[c] = awake_sum[c] / summary->wakes[c];
+        }
+    }
+    summary->span_ms = summary->slept_ms + awake_ms;
+    if (summary->span_ms) {
+        summary->awake_permille = awake_ms * 1000 / summary->span_ms;
+        summary->average_ua = charge / summary->span_ms + profile->board_ua;
+    }
+}
+
+uint32_t power_cycle_estimate(const power_cycle_profile_t *profile, const power_cycle_scenario_t *scenario)
+{
+    const power_cycle_profile_t *p = profile;
+    switch (scenario->mode) {
+    case POWER_CYCLE_MODE_ALWAYS_ON:
+        return p->board_ua + p->wifi_ua + p->display_ua;
+    case POWER_CYCLE_MODE_LIGHT_SLEEP: {
+        uint32_t cpu = scenario->cpu_permille < 1000 ? scenario->cpu_permille : 1000;
+        uint64_t cpu_ua = ((uint64_t)cpu * p->wifi_ua + (uint64_t)(1000 - cpu) * p->light_sleep_ua) / 1000;
+        return p->board_ua + p->display_ua + cpu_ua;
+    }
+    case POWER_CYCLE_MODE_DEEP_SLEEP: {
+        // One hour: the timer wakes, the motion wakes, deep sleep in between
+        uint64_t samples = scenario->sample_period_s ? 3600 / scenario->sample_period_s : 0;
+        uint64_t sample_ms = p->boot_ms + scenario->sample_awake_ms;
+        uint64_t motion_ms = p->boot_ms + scenario->motion_awake_s * 1000ULL;
+        uint64_t awake_ms = samples * sample_ms + scenario->motion_per_hour * motion_ms;
+        uint64_t motion_charge = p->boot_ms * (uint64_t)p->active_ua +
+                                 scenario->motion_awake_s * 1000ULL * (p->wifi_ua + p->display_ua);
+        uint64_t charge = samples * sample_ms * p->active_ua + scenario->motion_per_hour * motion_charge;
+        if (awake_ms >= HOUR_MS) {
+            return p->board_ua + charge / awake_ms; // Never asleep: as busy as the wakes are
+        }
+        charge += (HOUR_MS - awake_ms) * p->deep_sleep_ua;
+        return p->board_ua + charge / HOUR_MS;
+    }
+    default:
+        return 0;
+    }
+}
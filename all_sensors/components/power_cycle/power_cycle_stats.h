@@ -0,0 +1,126 @@
+#ifndef POWER_CYCLE_STATS_H
+#define POWER_CYCLE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POWER_CYCLE_LOG_LEN 24                                                                              /*!< Wake cycles kept, ~300 B of RTC memory */
+
+typedef enum {
+    POWER_CYCLE_WAKE_POWER_ON,                                                                              /*!< Power on or a reset: nothing retained */
+    POWER_CYCLE_WAKE_TIMER,
+    POWER_CYCLE_WAKE_MOTION,
+    POWER_CYCLE_WAKE_OTHER,
+    POWER_CYCLE_WAKE_COUNT,
+} power_cycle_wake_t;
+
+#define POWER_CYCLE_ON_WIFI    0x01                                                                         /*!< power_cycle_record_t.on: Wi-Fi was started */
+#define POWER_CYCLE_ON_DISPLAY 0x02                                                                         /*!< The panel was lit */
+
+/**
+ * @brief One wake: the sleep before it, and how long it took and lasted
+ */
+typedef struct {
+    uint8_t cause;                                                                                          /*!< power_cycle_wake_t */
+    uint8_t on;                                                                                             /*!< POWER_CYCLE_ON_* */
+    uint32_t slept_ms;                                                                                      /*!< Deep sleep before the wake, 0 after power on */
+    uint32_t ready_us;                                                                                      /*!< App start to the first sample or frame */
+    uint32_t awake_ms;                                                                                      /*!< App start to the next sleep */
+} power_cycle_record_t;
+
+/**
+ * @brief The last POWER_CYCLE_LOG_LEN wakes, oldest first from first; lives in RTC memory across deep sleep
+ */
+typedef struct {
+    power_cycle_record_t record[POWER_CYCLE_LOG_LEN];
+    uint8_t first;
+    uint8_t count;
+    uint32_t total;                                                                                         /*!< Wakes since power on, also those dropped */
+} power_cycle_log_t;
+
+/**
+ * @brief Supply current of the board in each state, in uA. Datasheet-level defaults: measure the board and replace
+ * them, the estimates are only as good as these.
+ */
+typedef struct {
+    uint32_t active_ua;                                                                                     /*!< CPUs running, radio off */
+    uint32_t wifi_ua;                                                                                       /*!< CPUs running, Wi-Fi associated in modem sleep, on average */
+    uint32_t light_sleep_ua;                                                                                /*!< Automatic light sleep, Wi-Fi beacons included */
+    uint32_t deep_sleep_ua;                                                                                 /*!< RTC timer, RTC memory and the ext0 wake pin */
+    uint32_t display_ua;                                                                                    /*!< Added while the panel is lit, about half its pixels */
+    uint32_t board_ua;                                                                                      /*!< Always: PIR module, regulator, sensors in standby */
+    uint32_t boot_ms;                                                                                       /*!< ROM and bootloader before the app starts, at active_ua */
+} power_cycle_profile_t;
+
+#define POWER_CYCLE_DEFAULT_PROFILE() {                                                                     \
+    .active_ua = 40000,                                                                                     \
+    .wifi_ua = 60000,                                                                                       \
+    .light_sleep_ua = 3000,                                                                                 \
+    .deep_sleep_ua = 150,                                                                                   \
+    .display_ua = 12000,                                                                                    \
+    .board_ua = 300,                                                                                        \
+    .boot_ms = 180,                                                                                         \
+}
+
+/**
+ * @brief What the log says
+ */
+typedef struct {
+    uint32_t wakes[POWER_CYCLE_WAKE_COUNT];                                                                 /*!< Of the records kept, by cause */
+    uint32_t ready_us[POWER_CYCLE_WAKE_COUNT];                                                              /*!< Mean, by cause */
+    uint32_t awake_ms[POWER_CYCLE_WAKE_COUNT];                                                              /*!< Mean, by cause */
+    uint64_t slept_ms;                                                                                      /*!< Of the records kept */
+    uint64_t span_ms;                                                                                       /*!< Sleeps, boots and wakes of the records kept */
+    uint32_t awake_permille;                                                                                /*!< Share of span_ms awake */
+    uint32_t average_ua;                                                                                    /*!< Estimated over span_ms, 0 with nothing kept */
+} power_cycle_summary_t;
+
+typedef enum {
+    POWER_CYCLE_MODE_ALWAYS_ON,                                                                             /*!< As before: CPU and Wi-Fi on, the panel lit */
+    POWER_CYCLE_MODE_LIGHT_SLEEP,                                                                           /*!< Automatic light sleep between frames, Wi-Fi stays associated */
+    POWER_CYCLE_MODE_DEEP_SLEEP,                                                                            /*!< Deep sleep between samples, awake with Wi-Fi and the panel on motion */
+    POWER_CYCLE_MODE_COUNT,
+} power_cycle_mode_t;
+
+/**
+ * @brief A configuration to estimate, instead of the cycles logged
+ */
+typedef struct {
+    power_cycle_mode_t mode;
+    uint32_t cpu_permille;                                                                                  /*!< Light sleep: share of time the CPU is not asleep */
+    uint32_t sample_period_s;                                                                               /*!< Deep sleep: timer wakes */
+    uint32_t sample_awake_ms;                                                                               /*!< Deep sleep: one timer wake, app start to sleep */
+    uint32_t motion_per_hour;                                                                               /*!< Deep sleep: PIR wakes */
+    uint32_t motion_awake_s;                                                                                /*!< Deep sleep: one PIR wake, with Wi-Fi and the panel */
+} power_cycle_scenario_t;
+
+void power_cycle_log_add(power_cycle_log_t *log, const power_cycle_record_t *record);
+
+/**
+ * @brief The i-th record kept, 0 the oldest; NULL past count
+ */
+const power_cycle_record_t *power_cycle_log_get(const power_cycle_log_t *log, int i);
+
+/**
+ * @brief Means by cause and the average current over the records kept
+ *
+ * Each record costs slept_ms at deep_sleep_ua, boot_ms at active_ua and awake_ms at wifi_ua or active_ua, with
+ * display_ua on top where the panel was lit; board_ua throughout.
+ */
+void power_cycle_log_summary(const power_cycle_log_t *log, const power_cycle_profile_t *profile,
+                             power_cycle_summary_t *summary);
+
+/**
+ * @brief Estimated average current of a configuration, in uA
+ */
+uint32_t power_cycle_estimate(const power_cycle_profile_t *profile, const power_cycle_scenario_t *scenario);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,390 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rules.h"
+
+#define TAG "RULES"
+
+#define LINE_MAX_LEN 128
+
+static bool condition(const rules_rule_t *rule, float value, bool valid, bool active)
+{
+    if (!valid) {
+        return false;
+    }
+    if (rule->op == RULES_OP_ABOVE) {
+        return value > (active ? rule->threshold - rule->hysteresis : rule->threshold);
+    }
+    return value < (active ? rule->threshold + rule->hysteresis : rule->threshold);
+}
+
+static void update_next_due(rules_engine_t *engine)
+{
+    engine->next_due_us = INT64_MAX;
+    for (int i = 0; i < engine->rule_count; i++) {
+        if ((engine->pending & (1u << i)) && engine->state[i].due_us < engine->next_due_us) {
+            engine->next_due_us = engine->state[i].due_us;
+        }
+    }
+}
+
+static void evaluate(rules_engine_t *engine, int i, int64_t now)
+{
+    const rules_rule_t *rule = &engine->rules[i];
+    rules_rule_state_t *st = &engine->state[i];
+    uint16_t bit = 1u << i;
+
+    engine->stats.evaluations++;
+    bool cond = condition(rule, engine->value[rule->input], engine->valid & (1u << rule->input), st->active);
+    if (cond != st->cond) {
+        st->cond = cond;
+        st->cond_us = now;
+        if (cond && !st->active && st->fired && now < st->fired_us + rule->cooldown_ms * 1000LL) {
+            engine->stats.cooldown_waits++;
+        }
+    }
+
+    if (cond == st->active) {
+        engine->pending &= ~bit;
+        return;
+    }
+    if (!cond) {
+        st->active = false;
+        engine->pending &= ~bit;
+        engine->action_cb(&rule->action, false, engine->action_ctx);
+        return;
+    }
+
+    st->due_us = st->cond_us + rule->hold_ms * 1000LL;
+    if (st->fired && st->fired_us + rule->cooldown_ms * 1000LL > st->due_us) {
+        st->due_us = st->fired_us + rule->cooldown_ms * 1000LL;
+    }
+    if (now < st->due_us) {
+        engine->pending |= bit;
+        return;
+    }
+    st->active = true;
+    st->fired = true;
+    st->fired_us = now;
+    engine->pending &= ~bit;
+    engine->stats.activations++;
+    engine->action_cb(&rule->action, true, engine->action_ctx);
+}
+
+static void evaluate_mask(rules_engine_t *engine, uint16_t mask)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < engine->rule_count; i++) {
+        if (mask & (1u << i)) {
+            evaluate(engine, i, now);
+        }
+    }
+    update_next_due(engine);
+}
+
+esp_err_t rules_init(rules_engine_t *engine, const char *const *input_names, size_t input_count,
+                     rules_action_cb_t action_cb, void *action_ctx)
+{
+    if (input_count > RULES_MAX_INPUTS || !action_cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(engine, 0, sizeof(*engine));
+    engine->input_names = input_names;
+    engine->input_count = input_count;
+    engine->action_cb = action_cb;
+    engine->action_ctx = action_ctx;
+    engine->next_due_us = INT64_MAX;
+    return ESP_OK;
+}
+
+void rules_set_input(rules_engine_t *engine, uint8_t input, float value, bool valid)
+{
+    if (input >= engine->input_count) {
+        return;
+    }
+    engine->stats.updates++;
+    uint8_t bit = 1u << input;
+    if (engine->value[input] == value && !!(engine->valid & bit) == valid) {
+        return;
+    }
+    engine->value[input] = value;
+    engine->valid = valid ? engine->valid | bit : engine->valid & ~bit;
+    evaluate_mask(engine, engine->by_input[input]);
+}
+
+void rules_tick(rules_engine_t *engine)
+{
+    if (engine->pending && esp_timer_get_time() >= engine->next_due_us) {
+        evaluate_mask(engine, engine->pending);
+    }
+}
+
+bool rules_is_active(const rules_engine_t *engine, int index)
+{
+    return index >= 0 && index < engine->rule_count && engine->state[index].active;
+}
+
+void rules_get_stats(const rules_engine_t *engine, rules_stats_t *stats)
+{
+    *stats = engine->stats;
+}
+
+/* Compiler */
+
+static char *next_word(char **cursor)
+{
+    char *p = *cursor;
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p == '\0') {
+        return NULL;
+    }
+    char *word = p;
+    while (*p && !isspace((unsigned char)*p)) {
+        p++;
+    }
+    if (*p) {
+        *p++ = '\0';
+    }
+    *cursor = p;
+    return word;
+}
+
+static bool parse_float(const char *word, float *value)
+{
+    char *end;
+    if (!word) {
+        return false;
+    }
+    *value = strtof(word, &end);
+    return end != word && *end == '\0';
+}
+
+static bool parse_uint(const char *word, uint32_t max, uint32_t *value)
+{
+    char *end;
+    if (!word || !isdigit((unsigned char)*word)) {
+        return false;
+    }
+    unsigned long v = strtoul(word, &end, 10);
+    *value = v;
+    return *end == '\0' && v <= max;
+}
+
+// "250", "250ms" or "2s"
+static bool parse_time(const char *word, uint32_t *ms)
+{
+    char *end;
+    if (!word || !isdigit((unsigned char)*word)) {
+        return false;
+    }
+    unsigned long v = strtoul(word, &end, 10);
+    if (strcmp(end, "s") == 0) {
+        v *= 1000;
+    } else if (*end != '\0' && strcmp(end, "ms") != 0) {
+        return false;
+    }
+    *ms = v;
+    return true;
+}
+
+static bool parse_action(char *text, rules_action_t *action)
+{
+    char *cursor = text;
+    char *word = next_word(&cursor);
+    uint32_t v;
+    if (!word) {
+        return false;
+    }
+    if (strcmp(word, "play") == 0) {
+        action->type = RULES_ACTION_PLAY;
+        if (!parse_uint(next_word(&cursor), UINT16_MAX, &v) || v == 0) {
+            return false;
+        }
+    } else if (strcmp(word, "dim") == 0) {
+        action->type = RULES_ACTION_DIM;
+        if (!parse_uint(next_word(&cursor), 255, &v)) {
+            return false;
+        }
+    } else if (strcmp(word, "banner") == 0) {
+        action->type = RULES_ACTION_BANNER;
+        if (!parse_uint(next_word(&cursor), 7, &v)) {
+            return false;
+        }
+        while (isspace((unsigned char)*cursor)) {
+            cursor++;
+        }
+        size_t len = strlen(cursor);
+        while (len > 0 && isspace((unsigned char)cursor[len - 1])) {
+            len--;
+        }
+        if (len == 0 || len >= RULES_TEXT_LEN) {
+            return false;
+        }
+        // The 8x8 font has only ASCII glyphs
+        for (size_t i = 0; i < len; i++) {
+            if ((unsigned char)cursor[i] >= 0x80) {
+                return false;
+            }
+        }
+        memcpy(action->text, cursor, len);
+        action->text[len] = '\0';
+        action->arg = v;
+        return true;
+    } else {
+        return false;
+    }
+    action->arg = v;
+    return next_word(&cursor) == NULL;
+}
+
+static bool parse_rule(const rules_engine_t *engine, char *line, rules_rule_t *rule)
+{
+    char *colon = strchr(line, ':');
+    if (!colon) {
+        return false;
+    }
+    *colon = '\0';
+    memset(rule, 0, sizeof(*rule));
+
+    char *cursor = line;
+    char *word = next_word(&cursor);
+    int input = -1;
+    for (int i = 0; word && i < engine->input_count; i++) {
+        if (strcmp(word, engine->input_names[i]) == 0) {
+            input = i;
+        }
+    }
+    if (input < 0) {
+        return false;
+    }
+    rule->input = input;
+
+    word = next_word(&cursor);
+    if (word && strcmp(word, ">") == 0) {
+        rule->op = RULES_OP_ABOVE;
+    } else if (word && strcmp(word, "<") == 0) {
+        rule->op = RULES_OP_BELOW;
+    } else {
+        return false;
+    }
+    if (!parse_float(next_word(&cursor), &rule->threshold)) {
+        return false;
+    }
+
+    while ((word = next_word(&cursor)) != NULL) {
+        char *arg = next_word(&cursor);
+        bool ok;
+        if (strcmp(word, "hyst") == 0) {
+            ok = parse_float(arg, &rule->hysteresis) && rule->hysteresis >= 0;
+        } else if (strcmp(word, "hold") == 0) {
+            ok = parse_time(arg, &rule->hold_ms);
+        } else if (strcmp(word, "cooldown") == 0) {
+            ok = parse_time(arg, &rule->cooldown_ms);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return parse_action(colon + 1, &rule->action);
+}
+
+esp_err_t rules_compile(rules_engine_t *engine, const char *text, int *err_line)
+{
+    rules_rule_t *table = calloc(RULES_MAX, sizeof(rules_rule_t));
+    if (!table) {
+        return ESP_ERR_NO_MEM;
+    }
+    int count = 0;
+    int line_no = 0;
+    esp_err_t ret = ESP_OK;
+    const char *p = text;
+    while (*p) {
+        const char *end = strchr(p, '\n');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        line_no++;
+
+        char line[LINE_MAX_LEN];
+        if (len >= sizeof(line)) {
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p += end ? len + 1 : len;
+
+        char *first = line;
+        while (isspace((unsigned char)*first)) {
+            first++;
+        }
+        if (*first == '\0' || *first == '#') {
+            continue;
+        }
+        if (count == RULES_MAX) {
+            ret = ESP_ERR_NO_MEM;
+            break;
+        }
+        if (!parse_rule(engine, first, &table[count])) {
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+        }
+        count++;
+    }
+
+    if (err_line) {
+        *err_line = ret == ESP_OK ? 0 : line_no;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Line %d: %s", line_no, ret == ESP_ERR_NO_MEM ? "too many rules" : "syntax error");
+        free(table);
+        return ret;
+    }
+
+    for (int i = 0; i < engine->rule_count; i++) {
+        if (engine->state[i].active) {
+            engine->action_cb(&engine->rules[i].action, false, engine->action_ctx);
+        }
+    }
+    memcpy(engine->rules, table, count * sizeof(rules_rule_t));
+    free(table);
+    engine->rule_count = count;
+    memset(engine->state, 0, sizeof(engine->state));
+    memset(engine->by_input, 0, sizeof(engine->by_input));
+    engine->pending = 0;
+    for (int i = 0; i < count; i++) {
+        engine->by_input[engine->rules[i].input] |= 1u << i;
+    }
+    ESP_LOGI(TAG, "%d rules", count);
+
+    // Inputs already set count from now on
+    evaluate_mask(engine, (1u << count) - 1);
+    return ESP_OK;
+}
+
+esp_err_t rules_load_file(rules_engine_t *engine, const char *path, int *err_line)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    char *text = malloc(RULES_SOURCE_MAX + 1);
+    if (!text) {
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = fread(text, 1, RULES_SOURCE_MAX + 1, f);
+    fclose(f);
+    esp_err_t ret = ESP_ERR_INVALID_SIZE;
+    if (len <= RULES_SOURCE_MAX) {
+        text[len] = '\0';
+        ret = rules_compile(engine, text, err_line);
+    }
+    free(text);
+    return ret;
+}
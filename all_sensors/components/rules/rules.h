@@ -0,0 +1,175 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RULES_MAX 16                                                                                        /*!< Rules in one table */
+#define RULES_MAX_INPUTS 8
+#define RULES_TEXT_LEN 17                                                                                   /*!< Banner text, 16 characters of the 8x8 font and the terminator */
+#define RULES_SOURCE_MAX 2048                                                                               /*!< Longest rule text read from NVS or a file */
+
+/*
+ * Rule text, one rule per line; blank lines and lines starting with '#' are skipped:
+ *
+ *   <input> > <threshold> [hyst <h>] [hold <time>] [cooldown <time>] : <action>
+ *   <input> < <threshold> ...
+ *
+ * A rule becomes active once its condition has held for hold and at least cooldown after it last became active, and
+ * stays active until the condition fails by more than the hysteresis. Times are in ms, or with an "s" suffix in
+ * seconds. Actions:
+ *
+ *   play <track>           start a track when the rule becomes active, stop it when the rule ends
+ *   banner <line> <text>   show ASCII text on a display line while active
+ *   dim <contrast>         set the panel contrast while active
+ *
+ * For example:
+ *
+ *   lux > 600 hyst 50 hold 1s cooldown 30s : play 1
+ *   pir > 0 : banner 6 WIDZE CIE!
+ */
+
+typedef enum {
+    RULES_OP_ABOVE,
+    RULES_OP_BELOW,
+} rules_op_t;
+
+typedef enum {
+    RULES_ACTION_PLAY,                                                                                      /*!< arg: track */
+    RULES_ACTION_BANNER,                                                                                    /*!< arg: display line, text */
+    RULES_ACTION_DIM,                                                                                       /*!< arg: contrast 0..255 */
+} rules_action_type_t;
+
+typedef struct {
+    uint8_t type;                                                                                           /*!< rules_action_type_t */
+    uint16_t arg;
+    char text[RULES_TEXT_LEN];
+} rules_action_t;
+
+/**
+ * @brief One compiled rule
+ */
+typedef struct {
+    uint8_t input;                                                                                          /*!< Index into the input names */
+    uint8_t op;                                                                                             /*!< rules_op_t */
+    float threshold;
+    float hysteresis;                                                                                       /*!< An active rule ends only this far on the other side of threshold */
+    uint32_t hold_ms;                                                                                       /*!< Condition must hold this long before the rule becomes active */
+    uint32_t cooldown_ms;                                                                                   /*!< Shortest time between two activations */
+    rules_action_t action;
+} rules_rule_t;
+
+/**
+ * @brief Called when a rule becomes active (active true) and when it ends. Runs in the caller of rules_set_input,
+ * rules_tick or rules_compile.
+ */
+typedef void (*rules_action_cb_t)(const rules_action_t *action, bool active, void *ctx);
+
+/**
+ * @brief Engine counters, since rules_init
+ */
+typedef struct {
+    uint32_t updates;                                                                                       /*!< rules_set_input calls */
+    uint32_t evaluations;                                                                                   /*!< Rule conditions evaluated */
+    uint32_t activations;
+    uint32_t cooldown_waits;                                                                                /*!< Conditions met while their rule was cooling down */
+} rules_stats_t;
+
+typedef struct {
+    bool active;
+    bool cond;                                                                                              /*!< Condition at the last evaluation */
+    bool fired;                                                                                             /*!< Became active at least once */
+    int64_t cond_us;                                                                                        /*!< When cond last changed */
+    int64_t fired_us;                                                                                       /*!< When the rule last became active */
+    int64_t due_us;                                                                                         /*!< Pending: when hold and cooldown are over */
+} rules_rule_state_t;
+
+/**
+ * @brief Engine state, owned by one task
+ *
+ * Rules are only evaluated when one of their inputs changes, and, while a rule waits out its hold or cooldown, by
+ * rules_tick once it is due.
+ */
+typedef struct {
+    const char *const *input_names;
+    uint8_t input_count;
+    rules_action_cb_t action_cb;
+    void *action_ctx;
+    rules_rule_t rules[RULES_MAX];
+    uint8_t rule_count;
+    uint16_t by_input[RULES_MAX_INPUTS];                                                                    /*!< Rules that read each input, a bit per rule */
+    float value[RULES_MAX_INPUTS];
+    uint8_t valid;                                                                                          /*!< A bit per input with a usable value */
+    rules_rule_state_t state[RULES_MAX];
+    uint16_t pending;                                                                                       /*!< Rules waiting to become active */
+    int64_t next_due_us;                                                                                    /*!< Earliest due_us of the pending rules */
+    rules_stats_t stats;
+} rules_engine_t;
+
+/**
+ * @brief Set up an engine without rules
+ *
+ * @param input_names Names used in the rule text, index is the input number; kept, not copied
+ * @return ESP_ERR_INVALID_ARG with more than RULES_MAX_INPUTS inputs
+ */
+esp_err_t rules_init(rules_engine_t *engine, const char *const *input_names, size_t input_count,
+                     rules_action_cb_t action_cb, void *action_ctx);
+
+/**
+ * @brief Compile rule text and replace the table with it. Active rules of the old table are ended first.
+ *
+ * On an error the old table stays.
+ *
+ * @param err_line Set to the line of the error, may be NULL
+ * @return ESP_ERR_INVALID_ARG on a syntax error, ESP_ERR_NO_MEM with more than RULES_MAX rules
+ */
+esp_err_t rules_compile(rules_engine_t *engine, const char *text, int *err_line);
+
+/**
+ * @brief rules_compile on the contents of a file, e.g. on a mounted SPIFFS or SD card
+ *
+ * @return ESP_ERR_NOT_FOUND if the file cannot be read
+ */
+esp_err_t rules_load_file(rules_engine_t *engine, const char *path, int *err_line);
+
+/**
+ * @brief rules_compile on a string stored in NVS
+ *
+ * @return ESP_ERR_NVS_NOT_FOUND if there is no such entry
+ */
+esp_err_t rules_load_nvs(rules_engine_t *engine, const char *nvs_namespace, const char *key, int *err_line);
+
+/**
+ * @brief New value of an input. Only the rules reading it are evaluated, and only if it changed.
+ *
+ * @param valid false for a value that must not trigger anything (no reading, or a stale one): conditions on it are
+ * false
+ */
+void rules_set_input(rules_engine_t *engine, uint8_t input, float value, bool valid);
+
+/**
+ * @brief Activate the rules whose hold or cooldown is over. Cheap when nothing is due, call it every loop.
+ */
+void rules_tick(rules_engine_t *engine);
+
+/**
+ * @brief Whether rule index (in the order of the text) is active
+ */
+bool rules_is_active(const rules_engine_t *engine, int index);
+
+/**
+ * @brief Copy of the counters
+ */
+void rules_get_stats(const rules_engine_t *engine, rules_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
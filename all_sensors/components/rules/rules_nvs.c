@@ -0,0 +1,28 @@
+#include <stdlib.h>
+#include "nvs.h"
+#include "rules.h"
+
+esp_err_t rules_load_nvs(rules_engine_t *engine, const char *nvs_namespace, const char *key, int *err_line)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(nvs_namespace, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t len = 0;
+    ret = nvs_get_str(nvs, key, NULL, &len);
+    if (ret == ESP_OK && len > RULES_SOURCE_MAX + 1) {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    char *text = NULL;
+    if (ret == ESP_OK) {
+        text = malloc(len);
+        ret = text ? nvs_get_str(nvs, key, text, &len) : ESP_ERR_NO_MEM;
+    }
+    nvs_close(nvs);
+    if (ret == ESP_OK) {
+        ret = rules_compile(engine, text, err_line);
+    }
+    free(text);
+    return ret;
+}
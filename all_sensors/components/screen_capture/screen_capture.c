@@ -0,0 +1,217 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "status_server.h"
+#include "screen_capture.h"
+
+#define TAG "SCREEN"
+
+#define RX_MAX 64 // Messages from clients are read and ignored
+
+_Static_assert(SCREEN_CAPTURE_PNG_MAX >= SCREEN_CAPTURE_PBM_MAX, "one image buffer for both formats");
+
+static SemaphoreHandle_t s_lock; // Everything below except the buffers; held for a copy, never while sending
+static screen_capture_frame_t s_frame;
+static screen_capture_dirty_t s_dirty;
+static bool s_key_due;
+static bool s_work_queued;
+static uint16_t s_seq;
+static httpd_handle_t s_server;
+static int s_clients[SCREEN_CAPTURE_MAX_CLIENTS];
+static int s_client_count;
+static screen_capture_stats_t s_stats;
+
+// Only handlers and queued work use these, all of them run in the one server task
+static screen_capture_frame_t s_snapshot;
+static uint8_t s_image[SCREEN_CAPTURE_PNG_MAX];
+static uint8_t s_message[SCREEN_CAPTURE_DELTA_MAX];
+
+static void drop_client(int idx)
+{
+    s_clients[idx] = s_clients[--s_client_count];
+    s_stats.clients_dropped++;
+}
+
+static void send_stream(void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_work_queued = false;
+    bool key = s_key_due;
+    size_t len = 0;
+    if (key || screen_capture_is_dirty(&s_dirty)) {
+        len = screen_capture_delta(&s_frame, &s_dirty, s_seq++, key, s_message, sizeof(s_message));
+        screen_capture_clear(&s_dirty);
+        s_key_due = false;
+    }
+    int clients[SCREEN_CAPTURE_MAX_CLIENTS];
+    int count = s_client_count;
+    memcpy(clients, s_clients, sizeof(clients));
+    xSemaphoreGive(s_lock);
+    if (len == 0) {
+        return;
+    }
+
+    httpd_ws_frame_t frame = { .type = HTTPD_WS_TYPE_BINARY, .payload = s_message, .len = len, .final = true };
+    bool failed[SCREEN_CAPTURE_MAX_CLIENTS] = { false };
+    for (int i = 0; i < count; i++) {
+        failed[i] = httpd_ws_get_fd_info(s_server, clients[i]) != HTTPD_WS_CLIENT_WEBSOCKET ||
+                    httpd_ws_send_frame_async(s_server, clients[i], &frame) != ESP_OK;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_stats.messages++;
+    s_stats.keys += key;
+    s_stats.stream_bytes += len;
+    for (int i = 0; i < count; i++) {
+        for (int j = 0; failed[i] && j < s_client_count; j++) {
+            if (s_clients[j] == clients[i]) {
+                drop_client(j);
+                break;
+            }
+        }
+    }
+    s_stats.clients = s_client_count;
+    xSemaphoreGive(s_lock);
+}
+
+// Taken with the lock held; the work is queued once until it has run, the changes in between go out together
+static bool stream_due(void)
+{
+    if (s_client_count == 0 || s_work_queued) {
+        return false;
+    }
+    s_work_queued = true;
+    return true;
+}
+
+static void queue_stream(void)
+{
+    if (httpd_queue_work(s_server, send_stream, NULL) != ESP_OK) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_work_queued = false;
+        xSemaphoreGive(s_lock);
+    }
+}
+
+static void on_frame(void *ctx, const uint8_t shown[][128], const display_pacer_region_t *regions, int count)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < count; i++) {
+        const display_pacer_region_t *r = &regions[i];
+        memcpy(&s_frame.pages[r->page][r->col], &shown[r->page][r->col], r->len);
+        screen_capture_mark(&s_dirty, r->page, r->col, r->len);
+    }
+    s_stats.frames++;
+    bool due = stream_due();
+    xSemaphoreGive(s_lock);
+    if (due) {
+        queue_stream();
+    }
+}
+
+static esp_err_t send_image(httpd_req_t *req, bool png)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_snapshot = s_frame;
+    s_stats.snapshots++;
+    xSemaphoreGive(s_lock);
+
+    size_t len = png ? screen_capture_png(&s_snapshot, s_image, sizeof(s_image))
+                     : screen_capture_pbm(&s_snapshot, s_image, sizeof(s_image));
+    httpd_resp_set_type(req, png ? "image/png" : "image/x-portable-bitmap");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, (const char *)s_image, len);
+}
+
+static esp_err_t get_png(httpd_req_t *req)
+{
+    return send_image(req, true);
+}
+
+static esp_err_t get_pbm(httpd_req_t *req)
+{
+    return send_image(req, false);
+}
+
+static esp_err_t stream_ws(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // Handshake done: the new client starts from a key, which the others get too
+        int fd = httpd_req_to_sockfd(req);
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        // A closed client is otherwise only dropped by a failed send, which never comes while the screen is idle;
+        // its descriptor may already be reused by this one
+        for (int i = s_client_count - 1; i >= 0; i--) {
+            if (s_clients[i] == fd || httpd_ws_get_fd_info(req->handle, s_clients[i]) != HTTPD_WS_CLIENT_WEBSOCKET) {
+                drop_client(i);
+            }
+        }
+        s_stats.clients = s_client_count;
+        bool room = s_client_count < SCREEN_CAPTURE_MAX_CLIENTS;
+        if (room) {
+            s_server = req->handle;
+            s_clients[s_client_count++] = fd;
+            s_stats.clients = s_client_count;
+            s_key_due = true;
+        }
+        bool due = room && stream_due();
+        xSemaphoreGive(s_lock);
+        if (!room) {
+            ESP_LOGW(TAG, "already %d stream clients", SCREEN_CAPTURE_MAX_CLIENTS);
+            httpd_sess_trigger_close(req->handle, fd);
+            return ESP_OK;
+        }
+        ESP_LOGI(TAG, "stream client on socket %d", fd);
+        if (due) {
+            queue_stream();
+        }
+        return ESP_OK;
+    }
+
+    uint8_t rx[RX_MAX];
+    httpd_ws_frame_t frame = { .payload = rx };
+    ESP_RETURN_ON_ERROR(httpd_ws_recv_frame(req, &frame, 0), TAG, "frame length");
+    // The stream only goes one way; anything long is not a client of it, an error closes the connection
+    ESP_RETURN_ON_FALSE(frame.len <= sizeof(rx), ESP_ERR_INVALID_SIZE, TAG, "%u B from a stream client",
+                        (unsigned)frame.len);
+    return frame.len ? httpd_ws_recv_frame(req, &frame, sizeof(rx)) : ESP_OK;
+}
+
+esp_err_t screen_capture_start(display_pacer_t *pacer)
+{
+    ESP_RETURN_ON_FALSE(pacer, ESP_ERR_INVALID_ARG, TAG, "no pacer");
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(s_lock, ESP_ERR_NO_MEM, TAG, "no memory for the lock");
+    }
+    ESP_RETURN_ON_ERROR(screen_capture_frame_init(&s_frame, pacer->dev->_width, pacer->dev->_height), TAG,
+                        "panel %dx%d", pacer->dev->_width, pacer->dev->_height);
+
+    static const httpd_uri_t png_uri = { .uri = "/screen.png", .method = HTTP_GET, .handler = get_png };
+    static const httpd_uri_t pbm_uri = { .uri = "/screen.pbm", .method = HTTP_GET, .handler = get_pbm };
+    static const httpd_uri_t ws_uri = {
+        .uri = "/screen", .method = HTTP_GET, .handler = stream_ws, .is_websocket = true,
+    };
+    ESP_RETURN_ON_ERROR(status_server_register(&png_uri), TAG, "/screen.png");
+    ESP_RETURN_ON_ERROR(status_server_register(&pbm_uri), TAG, "/screen.pbm");
+    ESP_RETURN_ON_ERROR(status_server_register(&ws_uri), TAG, "/screen");
+
+    display_pacer_set_observer(pacer, on_frame, NULL);
+    display_pacer_invalidate(pacer);
+    ESP_LOGI(TAG, "/screen.png, /screen.pbm and ws://<address>/screen on the status port");
+    return ESP_OK;
+}
+
+void screen_capture_get_stats(screen_capture_stats_t *stats)
+{
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
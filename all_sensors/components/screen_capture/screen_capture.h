@@ -0,0 +1,52 @@
+#ifndef SCREEN_CAPTURE_H
+#define SCREEN_CAPTURE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "display_pacer.h"
+#include "screen_capture_codec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCREEN_CAPTURE_MAX_CLIENTS 2
+
+/**
+ * @brief Capture counters, since screen_capture_start
+ */
+typedef struct {
+    uint32_t frames;                                                                                        /*!< Frames the pacer sent to the panel */
+    uint32_t snapshots;                                                                                     /*!< Images served */
+    uint32_t messages;                                                                                      /*!< Stream messages sent, each to all clients */
+    uint32_t keys;
+    uint64_t stream_bytes;                                                                                  /*!< Per client */
+    uint32_t clients_dropped;                                                                               /*!< Closed or failed to take a message */
+    uint8_t clients;
+} screen_capture_stats_t;
+
+/**
+ * @brief Serve what the panel shows on the status server: GET /screen.png and /screen.pbm, and a live stream on the
+ * WebSocket /screen
+ *
+ * The copy of the panel is updated from the changed columns the pacer reports, so a screen that does not change
+ * costs nothing. Stream messages (screen_capture_delta) are binary, a key to each new client and then the columns
+ * changed since the previous message; while a client is slow the changes add up into fewer, larger messages.
+ * The next frame goes to the panel in full, so that the copy starts complete.
+ *
+ * Call from the rendering task, after status_server_start.
+ *
+ * @return ESP_ERR_INVALID_STATE without the status server
+ */
+esp_err_t screen_capture_start(display_pacer_t *pacer);
+
+/**
+ * @brief Copy of the counters
+ */
+void screen_capture_get_stats(screen_capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <string.h>
+#include "screen_capture_codec.h"
+
+#define PNG_HEADER_LEN 8
+#define CHUNK_OVERHEAD 12                                                                                   /*!< Length, type and CRC */
+#define IHDR_LEN 13
+#define STORED_BLOCK_MAX 65535
+
+esp_err_t screen_capture_frame_init(screen_capture_frame_t *frame, int width, int height)
+{
+    if (width < 1 || width > 128 || height < 8 || height > 64 || height % 8) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(frame, 0, sizeof(*frame));
+    frame->width = width;
+    frame->height = height;
+    return ESP_OK;
+}
+
+bool screen_capture_pixel(const screen_capture_frame_t *frame, int x, int y)
+{
+    return frame->pages[y / 8][x] & (1 << (y % 8));
+}
+
+void screen_capture_mark(screen_capture_dirty_t *dirty, int page, int col, int len)
+{
+    if (len <= 0) {
+        return;
+    }
+    if (dirty->end[page] == 0) {
+        dirty->first[page] = col;
+        dirty->end[page] = col + len;
+        return;
+    }
+    if (col < dirty->first[page]) dirty->first[page] = col;
+    if (col + len > dirty->end[page]) dirty->end[page] = col + len;
+}
+
+void screen_capture_clear(screen_capture_dirty_t *dirty)
+{
+    memset(dirty, 0, sizeof(*dirty));
+}
+
+bool screen_capture_is_dirty(const screen_capture_dirty_t *dirty)
+{
+    for (int page = 0; page < 8; page++) {
+        if (dirty->end[page]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t screen_capture_delta(const screen_capture_frame_t *frame, const screen_capture_dirty_t *dirty, uint16_t seq,
+                            bool key, uint8_t *out, size_t cap)
+{
+    if (cap < SCREEN_CAPTURE_HEADER_LEN) {
+        return 0;
+    }
+    out[0] = SCREEN_CAPTURE_MAGIC;
+    out[1] = key ? SCREEN_CAPTURE_KEY : 0;
+    out[2] = seq & 0xff;
+    out[3] = seq >> 8;
+    out[4] = frame->width;
+    out[5] = frame->height;
+    size_t len = SCREEN_CAPTURE_HEADER_LEN;
+    for (int page = 0; page < frame->height / 8; page++) {
+        int first = key ? 0 : dirty->first[page];
+        int end = key ? frame->width : dirty->end[page];
+        if (end > frame->width) end = frame->width;
+        if (end <= first) {
+            continue;
+        }
+        if (len + SCREEN_CAPTURE_REGION_HEADER_LEN + (end - first) > cap) {
+            return 0;
+        }
+        out[len++] = page;
+        out[len++] = first;
+        out[len++] = end - first;
+        memcpy(out + len, &frame->pages[page][first], end - first);
+        len += end - first;
+    }
+    return len;
+}
+
+esp_err_t screen_capture_apply(screen_capture_frame_t *frame, const uint8_t *msg, size_t len, uint16_t *seq,
+                               bool *key)
+{
+    if (len < SCREEN_CAPTURE_HEADER_LEN || msg[0] != SCREEN_CAPTURE_MAGIC) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    bool is_key = msg[1] & SCREEN_CAPTURE_KEY;
+    int width = msg[4];
+    int height = msg[5];
+    if (width < 1 || width > 128 || height < 8 || height > 64 || height % 8) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (!is_key && (width != frame->width || height != frame->height)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Whole message checked before the frame is touched
+    for (size_t pos = SCREEN_CAPTURE_HEADER_LEN; pos < len;) {
+        if (len - pos < SCREEN_CAPTURE_REGION_HEADER_LEN) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        int page = msg[pos], col = msg[pos + 1], count = msg[pos + 2];
+        if (page >= height / 8 || count == 0 || col + count > width ||
+            len - pos - SCREEN_CAPTURE_REGION_HEADER_LEN < (size_t)count) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        pos += SCREEN_CAPTURE_REGION_HEADER_LEN + count;
+    }
+
+    if (is_key) {
+        screen_capture_frame_init(frame, width, height);
+    }
+    for (size_t pos = SCREEN_CAPTURE_HEADER_LEN; pos < len;) {
+        int page = msg[pos], col = msg[pos + 1], count = msg[pos + 2];
+        memcpy(&frame->pages[page][col], msg + pos + SCREEN_CAPTURE_REGION_HEADER_LEN, count);
+        pos += SCREEN_CAPTURE_REGION_HEADER_LEN + count;
+    }
+    *seq = msg[2] | msg[3] << 8;
+    *key = is_key;
+    return ESP_OK;
+}
+
+// Row y, 8 pixels per byte, leftmost in the top bit; set bits are the lit pixels, or the dark ones if invert
+static void pack_row(const screen_capture_frame_t *frame, int y, bool invert, uint8_t *out)
+{
+    int bytes = (frame->width + 7) / 8;
+    memset(out, 0, bytes);
+    for (int x = 0; x < frame->width; x++) {
+        if (screen_capture_pixel(frame, x, y) != invert) {
+            out[x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
+
+size_t screen_capture_pbm(const screen_capture_frame_t *frame, uint8_t *out, size_t cap)
+{
+    char header[16];
+    int header_len = snprintf(header, sizeof(header), "P4\n%u %u\n", frame->width, frame->height);
+    int row_len = (frame->width + 7) / 8;
+    size_t len = header_len + (size_t)row_len * frame->height;
+    if (len > cap) {
+        return 0;
+    }
+    memcpy(out, header, header_len);
+    for (int y = 0; y < frame->height; y++) {
+        pack_row(frame, y, true, out + header_len + y * row_len); // PBM: 1 is black
+    }
+    return len;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void put_be32(uint8_t *out, uint32_t value)
+{
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+// Length and type in front of data_len bytes already at out + 8, CRC behind them
+static size_t close_chunk(uint8_t *out, const char *type, size_t data_len)
+{
+    put_be32(out, data_len);
+    memcpy(out + 4, type, 4);
+    put_be32(out + 8 + data_len, crc32_update(0, out + 4, 4 + data_len));
+    return CHUNK_OVERHEAD + data_len;
+}
+
+size_t screen_capture_png(const screen_capture_frame_t *frame, uint8_t *out, size_t cap)
+{
+    static const uint8_t signature[PNG_HEADER_LEN] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    size_t row_len = 1 + (frame->width + 7) / 8;
+    size_t raw_len = row_len * frame->height;
+    size_t zlib_len = 2 + 5 + raw_len + 4; // Header, one stored block, Adler-32
+    size_t len = PNG_HEADER_LEN + CHUNK_OVERHEAD + IHDR_LEN + CHUNK_OVERHEAD + zlib_len + CHUNK_OVERHEAD;
+    if (len > cap || raw_len > STORED_BLOCK_MAX) {
+        return 0;
+    }
+    uint8_t *p = out;
+    memcpy(p, signature, PNG_HEADER_LEN);
+    p += PNG_HEADER_LEN;
+
+    uint8_t *ihdr = p + 8;
+    put_be32(ihdr, frame->width);
+    put_be32(ihdr + 4, frame->height);
+    ihdr[8] = 1;  // Bit depth
+    ihdr[9] = 0;  // Grayscale
+    ihdr[10] = 0; // Deflate
+    ihdr[11] = 0; // Adaptive filtering, every row with filter 0
+    ihdr[12] = 0; // Not interlaced
+    p += close_chunk(p, "IHDR", IHDR_LEN);
+
+    uint8_t *z = p + 8;
+    z[0] = 0x78; // Deflate, 32 KB window
+    z[1] = 0x01; // Check bits for the above, fastest level
+    z[2] = 0x01; // Last block, stored
+    z[3] = raw_len & 0xff;
+    z[4] = raw_len >> 8;
+    z[5] = ~raw_len & 0xff;
+    z[6] = (~raw_len >> 8) & 0xff;
+    uint8_t *raw = z + 7;
+    for (int y = 0; y < frame->height; y++) {
+        raw[y * row_len] = 0; // Filter: none
+        pack_row(frame, y, false, raw + y * row_len + 1);
+    }
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw_len; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_be32(raw + raw_len, b << 16 | a);
+    p += close_chunk(p, "IDAT", zlib_len);
+
+    p += close_chunk(p, "IEND", 0);
+    return p - out;
+}
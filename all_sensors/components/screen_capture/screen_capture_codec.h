@@ -0,0 +1,102 @@
+#ifndef SCREEN_CAPTURE_CODEC_H
+#define SCREEN_CAPTURE_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCREEN_CAPTURE_MAGIC 0xD5                                                                           /*!< First byte of every stream message */
+#define SCREEN_CAPTURE_KEY 0x01                                                                             /*!< Flag: all pages in full, the receiver starts over */
+#define SCREEN_CAPTURE_HEADER_LEN 6
+#define SCREEN_CAPTURE_REGION_HEADER_LEN 3
+#define SCREEN_CAPTURE_DELTA_MAX (SCREEN_CAPTURE_HEADER_LEN + 8 * (SCREEN_CAPTURE_REGION_HEADER_LEN + 128))
+#define SCREEN_CAPTURE_PBM_MAX (16 + 128 * 64 / 8)
+#define SCREEN_CAPTURE_PNG_MAX (68 + 64 * (1 + 128 / 8))                                                    /*!< Chunks, zlib framing and a filter byte per row */
+
+/**
+ * @brief Copy of the panel: pages of 8 vertical pixels per column byte, bit 0 on top, as in SSD1306_t
+ */
+typedef struct {
+    uint8_t width;                                                                                          /*!< 1..128 */
+    uint8_t height;                                                                                         /*!< 8..64, whole pages */
+    uint8_t pages[8][128];
+} screen_capture_frame_t;
+
+/**
+ * @brief Columns changed since the last message, one span per page
+ */
+typedef struct {
+    uint8_t first[8];
+    uint8_t end[8];                                                                                         /*!< 0: the page has not changed */
+} screen_capture_dirty_t;
+
+/**
+ * @brief Empty frame of a panel size
+ *
+ * @return ESP_ERR_INVALID_ARG unless 1..128 columns and 1..8 whole pages
+ */
+esp_err_t screen_capture_frame_init(screen_capture_frame_t *frame, int width, int height);
+
+/**
+ * @brief Pixel at x, y: true if lit
+ */
+bool screen_capture_pixel(const screen_capture_frame_t *frame, int x, int y);
+
+/**
+ * @brief Add columns col..col+len-1 of a page to what the next message carries
+ */
+void screen_capture_mark(screen_capture_dirty_t *dirty, int page, int col, int len);
+
+void screen_capture_clear(screen_capture_dirty_t *dirty);
+
+bool screen_capture_is_dirty(const screen_capture_dirty_t *dirty);
+
+/**
+ * @brief Stream message with the marked columns of a frame, or with all of it as a key
+ *
+ * Header: SCREEN_CAPTURE_MAGIC, flags, seq (2 bytes, little endian), width, height. Then per changed page: page,
+ * first column, column count, and the column bytes as in the frame. A receiver applies the messages in seq order,
+ * starting from a key; after a gap it waits for the next key.
+ *
+ * @return Length of the message, 0 if it does not fit in cap (SCREEN_CAPTURE_DELTA_MAX always does)
+ */
+size_t screen_capture_delta(const screen_capture_frame_t *frame, const screen_capture_dirty_t *dirty, uint16_t seq,
+                            bool key, uint8_t *out, size_t cap);
+
+/**
+ * @brief Apply a stream message to a receiver's frame; a key also sets the size
+ *
+ * @param[out] seq seq of the message
+ * @param[out] key It was a key
+ * @return ESP_ERR_INVALID_RESPONSE if malformed, ESP_ERR_INVALID_STATE for a delta of another panel size; the frame
+ * is left as it was
+ */
+esp_err_t screen_capture_apply(screen_capture_frame_t *frame, const uint8_t *msg, size_t len, uint16_t *seq,
+                               bool *key);
+
+/**
+ * @brief Binary PBM (P4), lit pixels white as on the glass
+ *
+ * @return Length of the image, 0 if it does not fit in cap (SCREEN_CAPTURE_PBM_MAX always does)
+ */
+size_t screen_capture_pbm(const screen_capture_frame_t *frame, uint8_t *out, size_t cap);
+
+/**
+ * @brief PNG, 1 bit grayscale in stored (uncompressed) deflate blocks, lit pixels white
+ *
+ * Snapshots are taken now and then and are 1.2 KB at most, not worth a deflate compressor on the chip.
+ *
+ * @return Length of the image, 0 if it does not fit in cap (SCREEN_CAPTURE_PNG_MAX always does)
+ */
+size_t screen_capture_png(const screen_capture_frame_t *frame, uint8_t *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,7 @@
 #include "freertos/task.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "ssd1306.h"
 #include "font8x8_basic.h"
@@ -15,12 +16,36 @@ typedef union out_column_t {
 	uint8_t  u8[4];
 } PACK8 out_column_t;
 
+// SSD1306 panel of the given size, see ssd1306_init_profile for other controllers
 void ssd1306_init(SSD1306_t * dev, int width, int height)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_init(dev, width, height);
+	const ssd1306_profile_t * profile = ssd1306_profile_for(width, height);
+	if (profile == NULL) {
+		ESP_LOGE(__FUNCTION__, "No SSD1306 panel profile for %dx%d", width, height);
+		return;
+	}
+	ssd1306_init_profile(dev, profile);
+}
+
+// Initialise a panel described by a profile (SH1106, 72x40, ...), picked by detection or from NVS
+void ssd1306_init_profile(SSD1306_t * dev, const ssd1306_profile_t * profile)
+{
+	if (dev->_ops == NULL) {
+		ESP_LOGE(__FUNCTION__, "No transport, call i2c_master_init, i2c_device_add, spi_master_init or spi_device_add first");
+		return;
+	}
+	dev->_profile = profile;
+	dev->_startLine = 0;
+	dev->_width = profile->width;
+	dev->_height = profile->height;
+	dev->_pages = (profile->height + 7) / 8;
+
+	uint8_t cmds[OLED_INIT_SEQUENCE_MAX];
+	int n = profile->init_sequence(dev, cmds);
+	if (dev->_ops->write_cmds(dev, cmds, n)) {
+		ESP_LOGI(__FUNCTION__, "OLED configured successfully (%s, %s)", profile->name, dev->_ops->name);
 	} else {
-		i2c_init(dev, width, height);
+		ESP_LOGE(__FUNCTION__, "OLED configuration failed (%s, %s)", profile->name, dev->_ops->name);
 	}
 	// Initialize internal buffer
 	for (int i=0;i<dev->_pages;i++) {
@@ -28,6 +53,83 @@ void ssd1306_init(SSD1306_t * dev, int width, int height)
 	}
 }
 
+// Initialisation sequence of the SSD1306 profiles, the same for every transport and sent as one command stream.
+// Returns the number of bytes written to cmds, at most OLED_INIT_SEQUENCE_MAX.
+int ssd1306_init_sequence(SSD1306_t * dev, uint8_t * cmds)
+{
+	int n = 0;
+	cmds[n++] = OLED_CMD_DISPLAY_OFF;				// AE
+	cmds[n++] = OLED_CMD_SET_MUX_RATIO;			// A8
+	cmds[n++] = dev->_height - 1;					// 3F, 1F or 27
+	cmds[n++] = OLED_CMD_SET_DISPLAY_OFFSET;		// D3
+	cmds[n++] = 0x00;
+	cmds[n++] = OLED_CMD_SET_DISPLAY_START_LINE;	// 40
+	if (dev->_flip) {
+		cmds[n++] = OLED_CMD_SET_SEGMENT_REMAP_0;	// A0
+	} else {
+		cmds[n++] = OLED_CMD_SET_SEGMENT_REMAP_1;	// A1
+	}
+	cmds[n++] = OLED_CMD_SET_COM_SCAN_MODE;		// C8
+	cmds[n++] = OLED_CMD_SET_DISPLAY_CLK_DIV;		// D5
+	cmds[n++] = 0x80;
+	cmds[n++] = OLED_CMD_SET_COM_PIN_MAP;			// DA
+	cmds[n++] = dev->_profile->com_pins;			// 12 or 02
+	cmds[n++] = OLED_CMD_SET_CONTRAST;			// 81
+	cmds[n++] = 0xFF;
+	cmds[n++] = OLED_CMD_DISPLAY_RAM;				// A4
+	cmds[n++] = OLED_CMD_SET_VCOMH_DESELCT;		// DB
+	cmds[n++] = 0x40;
+	cmds[n++] = OLED_CMD_SET_MEMORY_ADDR_MODE;	// 20
+	cmds[n++] = OLED_CMD_SET_PAGE_ADDR_MODE;		// 02
+	// Set Lower Column Start Address for Page Addressing Mode
+	cmds[n++] = 0x00;
+	// Set Higher Column Start Address for Page Addressing Mode
+	cmds[n++] = 0x10;
+	cmds[n++] = OLED_CMD_SET_CHARGE_PUMP;			// 8D
+	cmds[n++] = 0x14;
+	cmds[n++] = OLED_CMD_DEACTIVE_SCROLL;			// 2E
+	cmds[n++] = OLED_CMD_DISPLAY_NORMAL;			// A6
+	cmds[n++] = OLED_CMD_DISPLAY_ON;				// AF
+	return n;
+}
+
+// Command stream of a hardware scroll, the same for every transport.
+// Returns the number of bytes written to cmds, at most OLED_SCROLL_SEQUENCE_MAX.
+int ssd1306_scroll_sequence(SSD1306_t * dev, ssd1306_scroll_type_t scroll, uint8_t * cmds)
+{
+	int n = 0;
+
+	if (scroll == SCROLL_RIGHT || scroll == SCROLL_LEFT) {
+		cmds[n++] = scroll == SCROLL_RIGHT ? OLED_CMD_HORIZONTAL_RIGHT : OLED_CMD_HORIZONTAL_LEFT; // 26 / 27
+		cmds[n++] = 0x00; // Dummy byte
+		cmds[n++] = 0x00; // Define start page address
+		cmds[n++] = 0x07; // Frame frequency
+		cmds[n++] = dev->_pages - 1; // Define end page address
+		cmds[n++] = 0x00; //
+		cmds[n++] = 0xFF; //
+		cmds[n++] = OLED_CMD_ACTIVE_SCROLL; // 2F
+	}
+
+	if (scroll == SCROLL_DOWN || scroll == SCROLL_UP) {
+		cmds[n++] = OLED_CMD_CONTINUOUS_SCROLL; // 29
+		cmds[n++] = 0x00; // Dummy byte
+		cmds[n++] = 0x00; // Define start page address
+		cmds[n++] = 0x07; // Frame frequency
+		cmds[n++] = 0x00; // Define end page address
+		cmds[n++] = scroll == SCROLL_DOWN ? dev->_height - 1 : 0x01; // Vertical scrolling offset
+
+		cmds[n++] = OLED_CMD_VERTICAL; // A3
+		cmds[n++] = 0x00;
+		cmds[n++] = dev->_height; // 40, 20 or 28
+		cmds[n++] = OLED_CMD_ACTIVE_SCROLL; // 2F
+	}
+
+	if (scroll == SCROLL_STOP) {
+		cmds[n++] = OLED_CMD_DEACTIVE_SCROLL; // 2E
+	}
+	return n;
+}
+
 int ssd1306_get_width(SSD1306_t * dev)
 {
 	return dev->_width;
@@ -43,17 +145,59 @@ int ssd1306_get_pages(SSD1306_t * dev)
 	return dev->_pages;
 }
 
+// Controller RAM page that shows a page of the buffer, after flip and the ticker's start line
+static int ssd1306_ram_page(SSD1306_t * dev, int page)
+{
+	int _page = page;
+	if (dev->_flip) {
+		_page = (dev->_pages - page) - 1;
+	}
+	return (_page + dev->_startLine / 8) % 8;
+}
+
 void ssd1306_show_buffer(SSD1306_t * dev)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		for (int page=0; page<dev->_pages;page++) {
-			spi_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
-		}
-	} else {
-		for (int page=0; page<dev->_pages;page++) {
-			i2c_display_image(dev, page, 0, dev->_page[page]._segs, dev->_width);
+	ssd1306_show_pages(dev, 0, dev->_pages, 0, dev->_width);
+}
+
+// Send a region of the internal buffer in the fewest transactions the panel allows: a page addressing
+// controller (SH1106) needs a position before every page, one with horizontal addressing takes the
+// whole region after a single column and page range.
+void ssd1306_show_pages(SSD1306_t * dev, int page, int pages, int seg, int width)
+{
+	if (page < 0 || page >= dev->_pages || seg < 0 || seg >= dev->_width) return;
+	if (page + pages > dev->_pages) pages = dev->_pages - page;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+	if (pages <= 0 || width <= 0) return;
+
+	// RAM pages of the region, a run unless the ticker has moved it across the end of the RAM
+	int first = ssd1306_ram_page(dev, dev->_flip ? page + pages - 1 : page);
+	int last = ssd1306_ram_page(dev, dev->_flip ? page : page + pages - 1);
+	if (pages == 1 || last - first != pages - 1 || (dev->_profile->caps & SSD1306_PANEL_HORIZONTAL) == 0 || dev->_ops->write_data == NULL) {
+		for (int _page=page; _page<page+pages; _page++) {
+			ssd1306_send_image(dev, _page, seg, &dev->_page[_page]._segs[seg], width);
 		}
+		return;
 	}
+
+	int col = seg + dev->_profile->col_offset + CONFIG_OFFSETX;
+	uint8_t cmds[] = {
+		OLED_CMD_SET_MEMORY_ADDR_MODE, OLED_CMD_SET_HORI_ADDR_MODE,	// 20 00
+		OLED_CMD_SET_COLUMN_RANGE, col, col + width - 1,			// 21
+		OLED_CMD_SET_PAGE_RANGE, first, last,						// 22
+	};
+	if (!dev->_ops->write_cmds(dev, cmds, sizeof(cmds))) return;
+	for (int _page=first; _page<=last; _page++) {
+		int src = dev->_flip ? page + (last - _page) : page + (_page - first);
+		dev->_ops->write_data(dev, &dev->_page[src]._segs[seg], width);
+	}
+	// Back to page addressing for write_window
+	uint8_t restore[] = {
+		OLED_CMD_SET_MEMORY_ADDR_MODE, OLED_CMD_SET_PAGE_ADDR_MODE,	// 20 02
+		OLED_CMD_SET_COLUMN_RANGE, 0x00, dev->_profile->ram_width - 1,	// 21
+		OLED_CMD_SET_PAGE_RANGE, 0x00, 0x07,							// 22
+	};
+	dev->_ops->write_cmds(dev, restore, sizeof(restore));
 }
 
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer)
@@ -84,13 +228,19 @@ void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer)
 	memcpy(buffer, &dev->_page[page]._segs, 128);
 }
 
+// Write to the panel only, the internal buffer is not changed
+void ssd1306_send_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+{
+	if (page >= dev->_pages) return;
+	if (seg >= dev->_width) return;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+
+	dev->_ops->write_window(dev, ssd1306_ram_page(dev, page), seg + dev->_profile->col_offset + CONFIG_OFFSETX, images, width);
+}
+
 void ssd1306_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_display_image(dev, page, seg, images, width);
-	} else {
-		i2c_display_image(dev, page, seg, images, width);
-	}
+	ssd1306_send_image(dev, page, seg, images, width);
 	// Set to internal buffer
 	memcpy(&dev->_page[page]._segs[seg], images, width);
 }
@@ -112,6 +262,29 @@ void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text
 	}
 }
 
+// Set text to internal buffer. Not show it.
+void _ssd1306_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert)
+{
+	if (page >= dev->_pages) return;
+	int _text_len = text_len;
+	if (_text_len > dev->_width / 8) _text_len = dev->_width / 8;
+
+	for (int i = 0; i < _text_len; i++) {
+		uint8_t * image = &dev->_page[page]._segs[i*8];
+		memcpy(image, font8x8_basic_tr[(uint8_t)text[i]], 8);
+		if (invert) ssd1306_invert(image, 8);
+		if (dev->_flip) ssd1306_flip(image, 8);
+	}
+}
+
+// Clear internal buffer. Not show it.
+void _ssd1306_clear_screen(SSD1306_t * dev, bool invert)
+{
+	for (int page = 0; page < dev->_pages; page++) {
+		memset(dev->_page[page]._segs, invert ? 0xFF : 0x00, 128);
+	}
+}
+
 void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay)
 {
 	if (page >= dev->_pages) return;
@@ -242,11 +415,7 @@ ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int text_l
 			}
 			if (invert) ssd1306_invert(image, 24);
 			if (dev->_flip) ssd1306_flip(image, 24);
-			if (dev->_address == SPI_ADDRESS) {
-				spi_display_image(dev, page+yy, seg, image, 24);
-			} else {
-				i2c_display_image(dev, page+yy, seg, image, 24);
-			}
+			ssd1306_send_image(dev, page+yy, seg, image, 24);
 			memcpy(&dev->_page[page+yy]._segs[seg], image, 24);
 		}
 		seg = seg + 24;
@@ -271,11 +440,19 @@ void ssd1306_clear_line(SSD1306_t * dev, int page, bool invert)
 
 void ssd1306_contrast(SSD1306_t * dev, int contrast)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_contrast(dev, contrast);
-	} else {
-		i2c_contrast(dev, contrast);
-	}
+	int _contrast = contrast;
+	if (contrast < 0x0) _contrast = 0;
+	if (contrast > 0xFF) _contrast = 0xFF;
+
+	uint8_t cmds[] = { OLED_CMD_SET_CONTRAST, _contrast }; // 81
+	dev->_ops->write_cmds(dev, cmds, sizeof(cmds));
+}
+
+// Display off is the panel's sleep mode: the charge pump stops, the RAM keeps what it shows
+void ssd1306_display_power(SSD1306_t * dev, bool on)
+{
+	uint8_t cmd = on ? OLED_CMD_DISPLAY_ON : OLED_CMD_DISPLAY_OFF; // AF / AE
+	dev->_ops->write_cmds(dev, &cmd, 1);
 }
 
 void ssd1306_software_scroll(SSD1306_t * dev, int start, int end)
@@ -300,13 +477,6 @@ void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool
 	ESP_LOGD(__FUNCTION__, "dev->_scEnable=%d", dev->_scEnable);
 	if (dev->_scEnable == false) return;
 
-	void (*func)(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
-	if (dev->_address == SPI_ADDRESS) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
 	int srcIndex = dev->_scEnd - dev->_scDirection;
 	while(1) {
 		int dstIndex = srcIndex + dev->_scDirection;
@@ -314,7 +484,7 @@ void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool
 		for(int seg = 0; seg < dev->_width; seg++) {
 			dev->_page[dstIndex]._segs[seg] = dev->_page[srcIndex]._segs[seg];
 		}
-		(*func)(dev, dstIndex, 0, dev->_page[dstIndex]._segs, sizeof(dev->_page[dstIndex]._segs));
+		ssd1306_send_image(dev, dstIndex, 0, dev->_page[dstIndex]._segs, sizeof(dev->_page[dstIndex]._segs));
 		if (srcIndex == dev->_scStart) break;
 		srcIndex = srcIndex - dev->_scDirection;
 	}
@@ -340,14 +510,61 @@ void ssd1306_scroll_clear(SSD1306_t * dev)
 	}
 }
 
+// Ticker over the whole panel: every line moves the display start line by 8 rows, so the lines
+// already shown stay where they are in RAM and only the new bottom line is written, one page per
+// line whatever the panel height. The buffer is moved too and keeps the screen in display order.
+// With delay >= 0 the line rolls in a row at a time, delay ticks apart; that needs RAM rows below
+// the window, so a panel 64 rows high always jumps.
+void ssd1306_ticker_line(SSD1306_t * dev, const char * text, int text_len, bool invert, int delay)
+{
+	for (int page=0; page<dev->_pages-1; page++) {
+		memcpy(dev->_page[page]._segs, dev->_page[page+1]._segs, 128);
+	}
+	int last = dev->_pages - 1;
+	memset(dev->_page[last]._segs, invert ? 0xFF : 0x00, 128);
+	_ssd1306_text(dev, last, text, text_len, invert);
+
+	// Flipped, the screen runs the other way through the RAM
+	int step = dev->_flip ? -1 : 1;
+	int from = dev->_startLine;
+	dev->_startLine = (from + step * 8 + 64) % 64;
+	if (delay >= 0 && dev->_pages < 8) {
+		// The new line is still below the window
+		ssd1306_send_image(dev, last, 0, dev->_page[last]._segs, dev->_width);
+		for (int row=1; row<=8; row++) {
+			uint8_t cmd = OLED_CMD_SET_DISPLAY_START_LINE | ((from + step * row + 64) % 64); // 40-7F
+			dev->_ops->write_cmds(dev, &cmd, 1);
+			if (delay) vTaskDelay(delay);
+		}
+	} else {
+		// The page for the new line is the one that leaves the top, show its old content at the bottom briefly
+		// rather than the new line at the top
+		uint8_t cmd = OLED_CMD_SET_DISPLAY_START_LINE | dev->_startLine; // 40-7F
+		dev->_ops->write_cmds(dev, &cmd, 1);
+		ssd1306_send_image(dev, last, 0, dev->_page[last]._segs, dev->_width);
+	}
+}
+
+// Start line back to 0 and the screen rewritten from the buffer
+void ssd1306_ticker_stop(SSD1306_t * dev)
+{
+	if (dev->_startLine == 0) return;
+	dev->_startLine = 0;
+	uint8_t cmd = OLED_CMD_SET_DISPLAY_START_LINE; // 40
+	dev->_ops->write_cmds(dev, &cmd, 1);
+	ssd1306_show_buffer(dev);
+}
 
 void ssd1306_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
 {
-	if (dev->_address == SPI_ADDRESS) {
-		spi_hardware_scroll(dev, scroll);
-	} else {
-		i2c_hardware_scroll(dev, scroll);
+	if ((dev->_profile->caps & SSD1306_PANEL_SCROLL) == 0) {
+		ESP_LOGW(__FUNCTION__, "%s has no hardware scroll", dev->_profile->name);
+		return;
 	}
+	uint8_t cmds[OLED_SCROLL_SEQUENCE_MAX];
+	int n = ssd1306_scroll_sequence(dev, scroll, cmds);
+	if (n == 0) return;
+	dev->_ops->write_cmds(dev, cmds, n);
 }
 
 // delay = 0 : display with no wait
@@ -520,11 +737,7 @@ void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int sta
 
 	if (delay >= 0) {
 		for (int page=0;page<dev->_pages;page++) {
-			if (dev->_address == SPI_ADDRESS) {
-				spi_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			} else {
-				i2c_display_image(dev, page, 0, dev->_page[page]._segs, 128);
-			}
+			ssd1306_send_image(dev, page, 0, dev->_page[page]._segs, 128);
 			if (delay) vTaskDelay(delay);
 		}
 	}
@@ -796,13 +1009,6 @@ uint8_t ssd1306_rotate_byte(uint8_t ch1) {
 
 void ssd1306_fadeout(SSD1306_t * dev)
 {
-	void (*func)(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
-	if (dev->_address == SPI_ADDRESS) {
-		func = spi_display_image;
-	} else {
-		func = i2c_display_image;
-	}
-
 	uint8_t image[1];
 	for(int page=0; page<dev->_pages; page++) {
 		image[0] = 0xFF;
@@ -813,7 +1019,7 @@ void ssd1306_fadeout(SSD1306_t * dev)
 				image[0] = image[0] << 1;
 			}
 			for(int seg=0; seg<128; seg++) {
-				(*func)(dev, page, seg, image, 1);
+				ssd1306_send_image(dev, page, seg, image, 1);
 				dev->_page[page]._segs[seg] = image[0];
 			}
 		}
@@ -879,3 +1085,63 @@ void ssd1306_dump_page(SSD1306_t * dev, int page, int seg)
 	ESP_LOGI(__FUNCTION__, "dev->_page[%d]._segs[%d]=%02x", page, seg, dev->_page[page]._segs[seg]);
 }
 
+
+// Redraw the whole screen frames times with ssd1306_show_buffer and return the frame rate.
+// The content is moved by one column per frame; the internal buffer is restored afterwards.
+float ssd1306_fps_benchmark(SSD1306_t * dev, int frames)
+{
+	uint8_t saved[8][128];
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(saved[page], dev->_page[page]._segs, 128);
+	}
+
+	int64_t start = esp_timer_get_time();
+	for (int frame=0; frame<frames; frame++) {
+		for (int page=0; page<dev->_pages; page++) {
+			for (int seg=0; seg<128; seg++) {
+				dev->_page[page]._segs[seg] = saved[page][(seg + frame) % 128];
+			}
+		}
+		ssd1306_show_buffer(dev);
+	}
+	ssd1306_flush(dev);
+	int64_t elapsed = esp_timer_get_time() - start;
+
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(dev->_page[page]._segs, saved[page], 128);
+	}
+	float fps = elapsed > 0 ? frames * 1000000.0f / elapsed : 0.0f;
+	ESP_LOGI(__FUNCTION__, "%d frames in %d ms, %.1f fps", frames, (int)(elapsed / 1000), fps);
+	return fps;
+}
+
+// 8 columns of a character of the 8x8 font, for drawing outside SSD1306_t
+const uint8_t * ssd1306_glyph(char ch)
+{
+	return font8x8_basic_tr[(uint8_t)ch & 0x7F];
+}
+
+// Wait until everything written to the panel is on the bus
+void ssd1306_flush(SSD1306_t * dev)
+{
+	if (dev->_ops->flush) dev->_ops->flush(dev);
+}
+
+// The functions below are kept for existing callers, they are the same as the ssd1306_ ones on a device added with
+// i2c_master_init / i2c_device_add, whichever i2c driver is used.
+
+void i2c_init(SSD1306_t * dev, int width, int height) {
+	ssd1306_init(dev, width, height);
+}
+
+void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width) {
+	ssd1306_send_image(dev, page, seg, images, width);
+}
+
+void i2c_contrast(SSD1306_t * dev, int contrast) {
+	ssd1306_contrast(dev, contrast);
+}
+
+void i2c_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll) {
+	ssd1306_hardware_scroll(dev, scroll);
+}
@@ -73,6 +73,9 @@ Usage:
 #define OLED_CMD_ACTIVE_SCROLL          0x2F
 #define OLED_CMD_VERTICAL               0xA3
 
+#define OLED_INIT_SEQUENCE_MAX   32 // Longest ssd1306_init_sequence
+#define OLED_SCROLL_SEQUENCE_MAX 16 // Longest ssd1306_scroll_sequence
+
 #define I2C_ADDRESS 0x3C
 #define SPI_ADDRESS 0xFF
 
@@ -95,9 +98,12 @@ typedef enum {
 typedef struct {
 	bool _valid; // Not using it anymore
 	int _segLen; // Not using it anymore
-	uint8_t _segs[128];
+	uint8_t _segs[128]; // Visible columns, panels up to 128 wide
 } PAGE_t;
 
+typedef struct ssd1306_transport ssd1306_transport_t;
+typedef struct ssd1306_profile ssd1306_profile_t;
+
 typedef struct {
 	int _address;
 	int _width;
@@ -108,30 +114,88 @@ typedef struct {
 	int _scStart;
 	int _scEnd;
 	int _scDirection;
+	int _startLine; // Display start line, moved a text line at a time by the ticker
 	PAGE_t _page[8];
 	bool _flip;
 	i2c_port_t _i2c_num;
 	spi_device_handle_t _spi_device_handle;
+	struct ssd1306_spi_queue * _spi_queue; // Transactions in flight on SPI
+	const ssd1306_transport_t * _ops; // Set by i2c_master_init / i2c_device_add / spi_master_init / spi_device_add
+	const ssd1306_profile_t * _profile; // Set by ssd1306_init / ssd1306_init_profile
 #if (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0))
 	i2c_master_bus_handle_t _i2c_bus_handle;
 	i2c_master_dev_handle_t _i2c_dev_handle;
+	struct ssd1306_i2c_queue * _i2c_queue; // Transactions in flight with the new i2c driver, NULL if synchronous
 #endif
 } SSD1306_t;
 
+#define SSD1306_CAP_WINDOW 0x01 // write_window can start at any page and column
+#define SSD1306_CAP_ASYNC  0x02 // Writes may still be on the bus when they return, wait with flush
+
+// Operations of a bus backend. The drawing functions only go through these,
+// so a new bus needs no changes to ssd1306.c.
+struct ssd1306_transport {
+	const char * name;
+	// Command bytes, in one transaction if the bus allows it
+	bool (*write_cmds)(SSD1306_t * dev, const uint8_t * cmds, size_t len);
+	// Position at page/col (col already includes the panel offset), then write len data bytes
+	void (*write_window)(SSD1306_t * dev, int page, int col, const uint8_t * data, int len);
+	// Data bytes at the current RAM position, as set up with write_cmds
+	void (*write_data)(SSD1306_t * dev, const uint8_t * data, int len);
+	// Wait until all writes are done, NULL if writes are synchronous
+	void (*flush)(SSD1306_t * dev);
+	size_t max_burst; // Largest write in one bus transaction, 0 if unlimited
+	uint32_t caps; // SSD1306_CAP_*
+};
+
+extern const ssd1306_transport_t ssd1306_i2c_legacy_transport;
+extern const ssd1306_transport_t ssd1306_i2c_master_transport;
+extern const ssd1306_transport_t ssd1306_spi_transport;
+
+#define SSD1306_PANEL_HORIZONTAL 0x01 // Horizontal addressing with column and page range (20h, 21h, 22h)
+#define SSD1306_PANEL_SCROLL     0x02 // Continuous hardware scroll (26h-2Fh, A3h)
+
+// Controller and glass of a panel. The buffer holds the visible window only;
+// col_offset places it in the controller RAM.
+struct ssd1306_profile {
+	const char * name; // Also the value looked up by ssd1306_profile_find
+	int ram_width; // Columns of the controller RAM, 128 or 132 (SH1106)
+	int width; // Visible window
+	int height;
+	int col_offset; // RAM column of visible column 0, CONFIG_OFFSETX is added on top
+	uint8_t com_pins; // Argument of OLED_CMD_SET_COM_PIN_MAP
+	uint32_t caps; // SSD1306_PANEL_*
+	// Init sequence, at most OLED_INIT_SEQUENCE_MAX bytes. Returns the length.
+	int (*init_sequence)(SSD1306_t * dev, uint8_t * cmds);
+};
+
+extern const ssd1306_profile_t ssd1306_profile_128x64;
+extern const ssd1306_profile_t ssd1306_profile_128x32;
+extern const ssd1306_profile_t ssd1306_profile_72x40;
+extern const ssd1306_profile_t sh1106_profile_128x64;
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
 void ssd1306_init(SSD1306_t * dev, int width, int height);
+void ssd1306_init_profile(SSD1306_t * dev, const ssd1306_profile_t * profile);
+const ssd1306_profile_t * ssd1306_profile_find(const char * name);
+const ssd1306_profile_t * ssd1306_profile_for(int width, int height);
+int ssd1306_init_sequence(SSD1306_t * dev, uint8_t * cmds);
+int sh1106_init_sequence(SSD1306_t * dev, uint8_t * cmds);
+int ssd1306_scroll_sequence(SSD1306_t * dev, ssd1306_scroll_type_t scroll, uint8_t * cmds);
 int ssd1306_get_width(SSD1306_t * dev);
 int ssd1306_get_height(SSD1306_t * dev);
 int ssd1306_get_pages(SSD1306_t * dev);
 void ssd1306_show_buffer(SSD1306_t * dev);
+void ssd1306_show_pages(SSD1306_t * dev, int page, int pages, int seg, int width);
 void ssd1306_set_buffer(SSD1306_t * dev, const uint8_t * buffer);
 void ssd1306_get_buffer(SSD1306_t * dev, uint8_t * buffer);
 void ssd1306_set_page(SSD1306_t * dev, int page, const uint8_t * buffer);
 void ssd1306_get_page(SSD1306_t * dev, int page, uint8_t * buffer);
+void ssd1306_send_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
 void ssd1306_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
 void ssd1306_display_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert);
 void ssd1306_display_text_box1(SSD1306_t * dev, int page, int seg, const char * text, int box_width, int text_len, bool invert, int delay);
@@ -140,14 +204,19 @@ void ssd1306_display_text_x3(SSD1306_t * dev, int page, const char * text, int t
 void ssd1306_clear_screen(SSD1306_t * dev, bool invert);
 void ssd1306_clear_line(SSD1306_t * dev, int page, bool invert);
 void ssd1306_contrast(SSD1306_t * dev, int contrast);
+void ssd1306_display_power(SSD1306_t * dev, bool on);
 void ssd1306_software_scroll(SSD1306_t * dev, int start, int end);
 void ssd1306_scroll_text(SSD1306_t * dev, const char * text, int text_len, bool invert);
 void ssd1306_scroll_clear(SSD1306_t * dev);
 void ssd1306_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
+void ssd1306_ticker_line(SSD1306_t * dev, const char * text, int text_len, bool invert, int delay);
+void ssd1306_ticker_stop(SSD1306_t * dev);
 void ssd1306_wrap_arround(SSD1306_t * dev, ssd1306_scroll_type_t scroll, int start, int end, int8_t delay);
 void _ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert);
 void ssd1306_bitmaps(SSD1306_t * dev, int xpos, int ypos, const uint8_t * bitmap, int width, int height, bool invert);
 void _ssd1306_pixel(SSD1306_t * dev, int xpos, int ypos, bool invert);
+void _ssd1306_text(SSD1306_t * dev, int page, const char * text, int text_len, bool invert);
+void _ssd1306_clear_screen(SSD1306_t * dev, bool invert);
 void _ssd1306_line(SSD1306_t * dev, int x1, int y1, int x2, int y2,  bool invert);
 void _ssd1306_circle(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, bool invert);
 void _ssd1306_disc(SSD1306_t * dev, int x0, int y0, int r, unsigned int opt, bool invert);
@@ -161,9 +230,13 @@ void ssd1306_rotate_image(uint8_t *image, bool flip);
 void ssd1306_display_rotate_text(SSD1306_t * dev, int seg, const char * text, int text_len, bool invert);
 void ssd1306_dump(SSD1306_t dev);
 void ssd1306_dump_page(SSD1306_t * dev, int page, int seg);
+float ssd1306_fps_benchmark(SSD1306_t * dev, int frames);
+void ssd1306_flush(SSD1306_t * dev);
+const uint8_t * ssd1306_glyph(char ch);
 
 void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset);
 void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address);
+void i2c_queue_depth(int depth); // New i2c driver only, before i2c_master_init
 void i2c_init(SSD1306_t * dev, int width, int height);
 void i2c_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
 void i2c_contrast(SSD1306_t * dev, int contrast);
@@ -180,6 +253,7 @@ void spi_init(SSD1306_t * dev, int width, int height);
 void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width);
 void spi_contrast(SSD1306_t * dev, int contrast);
 void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll);
+void spi_flush(SSD1306_t * dev);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,163 @@
+#include <limits.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "ssd1306.h"
+#include "ssd1306_asset.h"
+
+#define TAG "ASSET"
+
+typedef struct {
+	int page0, page1; // Changed pages, inclusive
+	int seg0, seg1; // Changed columns, inclusive
+} asset_dirty_t;
+
+static int asset_get16(const uint8_t * p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static int asset_size(const ssd1306_asset_t * asset)
+{
+	return (asset->height + 7) / 8 * asset->width;
+}
+
+esp_err_t ssd1306_asset_open(ssd1306_asset_t * asset, const uint8_t * data, size_t len, int page, int seg)
+{
+	if (len < SSD1306_ASSET_HEADER_LEN || data[0] != 'O' || data[1] != 'A') {
+		ESP_LOGE(TAG, "Not an asset");
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (data[2] != SSD1306_ASSET_VERSION) {
+		ESP_LOGE(TAG, "Asset version %d, expected %d", data[2], SSD1306_ASSET_VERSION);
+		return ESP_ERR_NOT_SUPPORTED;
+	}
+	memset(asset, 0, sizeof(*asset));
+	asset->data = data;
+	asset->len = len;
+	asset->width = data[3];
+	asset->height = data[4];
+	asset->frames = asset_get16(&data[5]);
+	asset->page = page;
+	asset->seg = seg;
+	asset->pos = SSD1306_ASSET_HEADER_LEN;
+	if (asset->width == 0 || asset->height == 0 || asset->frames == 0) return ESP_ERR_INVALID_SIZE;
+	return ESP_OK;
+}
+
+// Next frame is the first, a key frame
+void ssd1306_asset_rewind(ssd1306_asset_t * asset)
+{
+	asset->frame = 0;
+	asset->pos = SSD1306_ASSET_HEADER_LEN;
+}
+
+// Walk the ops without writing, so a corrupt frame leaves the buffer as it was
+static bool asset_ops_valid(const uint8_t * op, const uint8_t * end, int size)
+{
+	int i = 0;
+	while (op < end) {
+		int type = *op & 0xC0;
+		int n = (*op & 0x3F) + 1;
+		op++;
+		if (type == SSD1306_ASSET_OP_SKIP_LONG) n *= SSD1306_ASSET_OP_MAX;
+		if (type == SSD1306_ASSET_OP_LITERAL) op += n;
+		if (type == SSD1306_ASSET_OP_REPEAT) op++;
+		i += n;
+		if (i > size || op > end) return false;
+	}
+	return true;
+}
+
+// Byte i of the region into the buffer, if it is on the panel and differs
+static void asset_put(SSD1306_t * dev, ssd1306_asset_t * asset, int i, uint8_t b, asset_dirty_t * dirty)
+{
+	int page = asset->page + i / asset->width;
+	int seg = asset->seg + i % asset->width;
+	if (page < 0 || page >= dev->_pages || seg < 0 || seg >= dev->_width) return;
+	if (dev->_flip) b = ssd1306_rotate_byte(b);
+	if (dev->_page[page]._segs[seg] == b) return;
+	dev->_page[page]._segs[seg] = b;
+	asset->bytes_changed++;
+	if (page < dirty->page0) dirty->page0 = page;
+	if (page > dirty->page1) dirty->page1 = page;
+	if (seg < dirty->seg0) dirty->seg0 = seg;
+	if (seg > dirty->seg1) dirty->seg1 = seg;
+}
+
+// Decode the next frame into the internal buffer and, if show, send the rectangle
+// that changed. After the last frame the first comes again.
+// Returns the frame's delay in ms, -1 if the asset is corrupt.
+int ssd1306_asset_next(SSD1306_t * dev, ssd1306_asset_t * asset, bool show)
+{
+	if (asset->frame >= asset->frames) ssd1306_asset_rewind(asset);
+
+	const uint8_t * frame = &asset->data[asset->pos];
+	if (asset->pos + SSD1306_ASSET_FRAME_HEADER_LEN > asset->len) goto corrupt;
+	int delay = asset_get16(&frame[1]);
+	int length = asset_get16(&frame[3]);
+	const uint8_t * op = &frame[SSD1306_ASSET_FRAME_HEADER_LEN];
+	const uint8_t * end = op + length;
+	if (asset->pos + SSD1306_ASSET_FRAME_HEADER_LEN + length > asset->len) goto corrupt;
+	if (!asset_ops_valid(op, end, asset_size(asset))) goto corrupt;
+
+	asset_dirty_t dirty = { INT_MAX, -1, INT_MAX, -1 };
+	asset->bytes_changed = 0;
+	int i = 0;
+	while (op < end) {
+		int type = *op & 0xC0;
+		int n = (*op & 0x3F) + 1;
+		op++;
+		switch (type) {
+		case SSD1306_ASSET_OP_SKIP_LONG:
+			n *= SSD1306_ASSET_OP_MAX;
+			break;
+		case SSD1306_ASSET_OP_LITERAL:
+			for (int k=0; k<n; k++) asset_put(dev, asset, i + k, op[k], &dirty);
+			op += n;
+			break;
+		case SSD1306_ASSET_OP_REPEAT:
+			for (int k=0; k<n; k++) asset_put(dev, asset, i + k, *op, &dirty);
+			op++;
+			break;
+		}
+		i += n;
+	}
+	asset->pos += SSD1306_ASSET_FRAME_HEADER_LEN + length;
+	asset->frame++;
+
+	if (show && dirty.page1 >= 0) {
+		ssd1306_show_pages(dev, dirty.page0, dirty.page1 - dirty.page0 + 1, dirty.seg0, dirty.seg1 - dirty.seg0 + 1);
+	}
+	return delay;
+
+corrupt:
+	ESP_LOGE(TAG, "Frame %d of the asset is corrupt", asset->frame);
+	ssd1306_asset_rewind(asset);
+	return -1;
+}
+
+// First frame of an asset, e.g. an icon or a boot splash
+esp_err_t ssd1306_asset_image(SSD1306_t * dev, const uint8_t * data, size_t len, int page, int seg)
+{
+	ssd1306_asset_t asset;
+	esp_err_t ret = ssd1306_asset_open(&asset, data, len, page, seg);
+	if (ret != ESP_OK) return ret;
+	return ssd1306_asset_next(dev, &asset, true) < 0 ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+// All frames loops times, at their delays. Blocks the caller.
+void ssd1306_asset_play(SSD1306_t * dev, ssd1306_asset_t * asset, int loops)
+{
+	ssd1306_asset_rewind(asset);
+	for (int i=0; i<loops*asset->frames; i++) {
+		int delay = ssd1306_asset_next(dev, asset, true);
+		if (delay < 0) return;
+		ssd1306_flush(dev);
+		vTaskDelay(pdMS_TO_TICKS(delay));
+	}
+}
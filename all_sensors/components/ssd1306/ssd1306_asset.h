@@ -0,0 +1,63 @@
+#ifndef MAIN_SSD1306_ASSET_H_
+#define MAIN_SSD1306_ASSET_H_
+
+#include "ssd1306.h"
+
+// Compressed images and animations, packed on the host by host/oled_asset_pack and
+// read in place from flash (a const array or an EMBED_FILES blob). Frames are decoded
+// straight into the internal buffer at a page aligned position, and only the bytes
+// that changed are sent.
+//
+// Layout, little endian:
+//   header  'O' 'A' version width height frames(2)
+//   frame   flags delay_ms(2) length(2) ops[length]
+// A frame covers (height + 7) / 8 pages of width bytes, page by page, in the bit order
+// of the panel buffer. The ops walk it from the start:
+//   00nnnnnn           skip n + 1 bytes, they keep the previous frame
+//   01nnnnnn b...      n + 1 literal bytes
+//   10nnnnnn b         b repeated n + 1 times
+//   11nnnnnn           skip (n + 1) * 64 bytes
+// A key frame has no skips and draws the whole image; the first frame is always one.
+// Delta frames build on what the buffer holds, so after drawing over the region, go
+// back to a key frame with ssd1306_asset_rewind.
+
+#define SSD1306_ASSET_VERSION 1
+#define SSD1306_ASSET_HEADER_LEN 8
+#define SSD1306_ASSET_FRAME_HEADER_LEN 5
+#define SSD1306_ASSET_FRAME_KEY 0x01
+
+#define SSD1306_ASSET_OP_SKIP 0x00
+#define SSD1306_ASSET_OP_LITERAL 0x40
+#define SSD1306_ASSET_OP_REPEAT 0x80
+#define SSD1306_ASSET_OP_SKIP_LONG 0xC0
+#define SSD1306_ASSET_OP_MAX 64 // Count of one op
+
+typedef struct {
+	const uint8_t * data; // Whole asset, not copied
+	size_t len;
+	int width;
+	int height;
+	int frames;
+	int page; // Where it is drawn
+	int seg;
+	int frame; // Next frame to decode
+	size_t pos; // Offset of the next frame in data
+	uint32_t bytes_changed; // Buffer bytes the last frame changed
+} ssd1306_asset_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+esp_err_t ssd1306_asset_open(ssd1306_asset_t * asset, const uint8_t * data, size_t len, int page, int seg);
+void ssd1306_asset_rewind(ssd1306_asset_t * asset);
+int ssd1306_asset_next(SSD1306_t * dev, ssd1306_asset_t * asset, bool show);
+esp_err_t ssd1306_asset_image(SSD1306_t * dev, const uint8_t * data, size_t len, int page, int seg);
+void ssd1306_asset_play(SSD1306_t * dev, ssd1306_asset_t * asset, int loops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_ASSET_H_ */
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "ssd1306.h"
+#include "ssd1306_compositor.h"
+
+#define TAG "COMPOSITOR"
+
+#define COMPOSITOR_TASK_STACK 2048
+
+// Copy the panel's region of the canvas into the panel buffer and mark the pages that changed.
+// Nothing of the panel is in flight here: the previous flush waited for all of it, and the
+// i2c_master transport sends straight from the panel buffer.
+static void compositor_stage(ssd1306_panel_t * p)
+{
+	ssd1306_compositor_t * comp = p->owner;
+	SSD1306_t * dev = p->dev;
+	uint8_t row[128];
+
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(row, &comp->fb[(p->page + page) * comp->width + p->x], dev->_width);
+		if (dev->_flip) ssd1306_flip(row, dev->_width);
+		if (!p->synced || memcmp(row, dev->_page[page]._segs, dev->_width) != 0) {
+			memcpy(dev->_page[page]._segs, row, dev->_width);
+			p->dirty |= 1 << page;
+		}
+	}
+	p->synced = true;
+}
+
+// Runs of dirty pages go out as one region each, in the panel's fastest write pattern
+static void compositor_send(ssd1306_panel_t * p)
+{
+	SSD1306_t * dev = p->dev;
+	int page = 0;
+	while (page < dev->_pages) {
+		if ((p->dirty & (1 << page)) == 0) {
+			page++;
+			continue;
+		}
+		int pages = 1;
+		while (page + pages < dev->_pages && (p->dirty & (1 << (page + pages)))) pages++;
+		ssd1306_show_pages(dev, page, pages, 0, dev->_width);
+		p->pages_sent += pages;
+		page += pages;
+	}
+	p->dirty = 0;
+}
+
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+static void compositor_task(void * arg)
+{
+	ssd1306_panel_t * p = arg;
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		compositor_send(p);
+		xSemaphoreGive(p->owner->done);
+	}
+}
+#endif
+
+esp_err_t ssd1306_compositor_init(ssd1306_compositor_t * comp, int width, int height)
+{
+	if (width <= 0 || width > SSD1306_COMPOSITOR_MAX_WIDTH || height <= 0 || height > SSD1306_COMPOSITOR_MAX_HEIGHT || height % 8) {
+		ESP_LOGE(TAG, "Canvas %dx%d not supported", width, height);
+		return ESP_ERR_INVALID_ARG;
+	}
+	memset(comp, 0, sizeof(ssd1306_compositor_t));
+	comp->width = width;
+	comp->height = height;
+	comp->pages = height / 8;
+	comp->fb = calloc(comp->pages, width);
+	if (comp->fb == NULL) {
+		return ESP_ERR_NO_MEM;
+	}
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	comp->done = xSemaphoreCreateCounting(SSD1306_COMPOSITOR_MAX_PANELS, 0);
+	if (comp->done == NULL) {
+		free(comp->fb);
+		return ESP_ERR_NO_MEM;
+	}
+#endif
+	return ESP_OK;
+}
+
+// Place an initialised panel with its top left corner at x/y of the canvas. y must be a multiple of 8.
+esp_err_t ssd1306_compositor_add_panel(ssd1306_compositor_t * comp, SSD1306_t * dev, int x, int y)
+{
+	if (comp->panel_num == SSD1306_COMPOSITOR_MAX_PANELS) {
+		return ESP_ERR_NO_MEM;
+	}
+	if (dev->_ops == NULL || x < 0 || y < 0 || y % 8 || x + dev->_width > comp->width || y + dev->_height > comp->height) {
+		ESP_LOGE(TAG, "Panel %dx%d does not fit at %d,%d", dev->_width, dev->_height, x, y);
+		return ESP_ERR_INVALID_ARG;
+	}
+
+	ssd1306_panel_t * p = &comp->panels[comp->panel_num];
+	memset(p, 0, sizeof(ssd1306_panel_t));
+	p->dev = dev;
+	p->x = x;
+	p->page = y / 8;
+	p->owner = comp;
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	if ((dev->_ops->caps & SSD1306_CAP_ASYNC) == 0) {
+		char name[configMAX_TASK_NAME_LEN];
+		snprintf(name, sizeof(name), "oled%d", comp->panel_num);
+		if (xTaskCreate(compositor_task, name, COMPOSITOR_TASK_STACK, p, uxTaskPriorityGet(NULL), &p->task) != pdPASS) {
+			return ESP_ERR_NO_MEM;
+		}
+	}
+#endif
+	ESP_LOGI(TAG, "Panel %d: %dx%d at %d,%d over %s", comp->panel_num, dev->_width, dev->_height, x, y, dev->_ops->name);
+	comp->panel_num++;
+	return ESP_OK;
+}
+
+void ssd1306_compositor_deinit(ssd1306_compositor_t * comp)
+{
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	for (int i=0; i<comp->panel_num; i++) {
+		if (comp->panels[i].task) vTaskDelete(comp->panels[i].task);
+	}
+	vSemaphoreDelete(comp->done);
+#endif
+	free(comp->fb);
+	comp->fb = NULL;
+	comp->panel_num = 0;
+}
+
+// Show the canvas. Returns when every panel is up to date.
+void ssd1306_compositor_flush(ssd1306_compositor_t * comp)
+{
+	for (int i=0; i<comp->panel_num; i++) {
+		compositor_stage(&comp->panels[i]);
+	}
+
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	// Panels with a task first, so they run while the others are queued from here
+	int waiting = 0;
+	for (int i=0; i<comp->panel_num; i++) {
+		ssd1306_panel_t * p = &comp->panels[i];
+		if (p->task && p->dirty) {
+			xTaskNotifyGive(p->task);
+			waiting++;
+		}
+	}
+#endif
+	for (int i=0; i<comp->panel_num; i++) {
+		ssd1306_panel_t * p = &comp->panels[i];
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+		if (p->task) continue;
+#endif
+		if (p->dirty) compositor_send(p);
+	}
+	for (int i=0; i<comp->panel_num; i++) {
+		ssd1306_panel_t * p = &comp->panels[i];
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+		if (p->task) continue;
+#endif
+		ssd1306_flush(p->dev);
+	}
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	while (waiting--) {
+		xSemaphoreTake(comp->done, portMAX_DELAY);
+	}
+#endif
+}
+
+void ssd1306_compositor_clear(ssd1306_compositor_t * comp, bool invert)
+{
+	memset(comp->fb, invert ? 0xFF : 0x00, comp->pages * comp->width);
+}
+
+// Set (or, with invert, clear) one pixel of the canvas. Not shown until the next flush.
+void ssd1306_compositor_pixel(ssd1306_compositor_t * comp, int xpos, int ypos, bool invert)
+{
+	if (xpos < 0 || xpos >= comp->width || ypos < 0 || ypos >= comp->height) return;
+	uint8_t * seg = &comp->fb[(ypos / 8) * comp->width + xpos];
+	if (invert) {
+		*seg &= ~(1 << (ypos % 8));
+	} else {
+		*seg |= 1 << (ypos % 8);
+	}
+}
+
+// Page format image, as ssd1306_display_image. Clipped at the canvas edge.
+void ssd1306_compositor_image(ssd1306_compositor_t * comp, int page, int seg, const uint8_t * images, int width)
+{
+	if (page < 0 || page >= comp->pages || seg >= comp->width) return;
+	if (seg < 0) {
+		images -= seg;
+		width += seg;
+		seg = 0;
+	}
+	if (seg + width > comp->width) width = comp->width - seg;
+	if (width <= 0) return;
+	memcpy(&comp->fb[page * comp->width + seg], images, width);
+}
+
+void ssd1306_compositor_text(ssd1306_compositor_t * comp, int page, int seg, const char * text, bool invert)
+{
+	uint8_t image[8];
+	for (; *text; text++, seg += 8) {
+		memcpy(image, ssd1306_glyph(*text), 8);
+		if (invert) ssd1306_invert(image, 8);
+		ssd1306_compositor_image(comp, page, seg, image, 8);
+	}
+}
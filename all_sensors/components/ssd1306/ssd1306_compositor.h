@@ -0,0 +1,72 @@
+#ifndef MAIN_SSD1306_COMPOSITOR_H_
+#define MAIN_SSD1306_COMPOSITOR_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+#include "freertos/semphr.h"
+#endif
+
+#include "ssd1306.h"
+
+// One logical canvas tiled over several panels. Drawing goes to the canvas only;
+// ssd1306_compositor_flush copies the region of every panel into its buffer and
+// sends the pages that changed, all panels at the same time.
+//
+// Panels can be on one bus (0x3C and 0x3D), on several I2C ports or on SPI, in
+// any mix. Panels with a queued transport (SPI, i2c_master with a queue) are
+// flushed from the caller, since their writes return at once; with
+// CONFIG_SSD1306_COMPOSITOR_TASKS the others get a task each, so panels on
+// different buses are sent in parallel and panels on one bus take turns in the
+// driver.
+
+#define SSD1306_COMPOSITOR_MAX_PANELS 4
+#define SSD1306_COMPOSITOR_MAX_WIDTH  512
+#define SSD1306_COMPOSITOR_MAX_HEIGHT 128
+
+typedef struct ssd1306_compositor ssd1306_compositor_t;
+
+typedef struct {
+	SSD1306_t * dev; // Initialised with ssd1306_init
+	int x; // Canvas column of the panel's column 0
+	int page; // Canvas page of the panel's page 0
+	bool synced; // Panel buffer matches the panel
+	uint8_t dirty; // Pages to send, bit per page
+	uint32_t pages_sent; // Since the panel was added
+	ssd1306_compositor_t * owner;
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	TaskHandle_t task; // NULL if flushed from the caller
+#endif
+} ssd1306_panel_t;
+
+struct ssd1306_compositor {
+	int width;
+	int height;
+	int pages;
+	uint8_t * fb; // pages * width bytes, page by page, same bit order as the panels
+	ssd1306_panel_t panels[SSD1306_COMPOSITOR_MAX_PANELS];
+	int panel_num;
+#if CONFIG_SSD1306_COMPOSITOR_TASKS
+	SemaphoreHandle_t done; // Given by a panel task when its pages are sent
+#endif
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+esp_err_t ssd1306_compositor_init(ssd1306_compositor_t * comp, int width, int height);
+esp_err_t ssd1306_compositor_add_panel(ssd1306_compositor_t * comp, SSD1306_t * dev, int x, int y);
+void ssd1306_compositor_deinit(ssd1306_compositor_t * comp);
+void ssd1306_compositor_flush(ssd1306_compositor_t * comp);
+void ssd1306_compositor_clear(ssd1306_compositor_t * comp, bool invert);
+void ssd1306_compositor_pixel(ssd1306_compositor_t * comp, int xpos, int ypos, bool invert);
+void ssd1306_compositor_image(ssd1306_compositor_t * comp, int page, int seg, const uint8_t * images, int width);
+void ssd1306_compositor_text(ssd1306_compositor_t * comp, int page, int seg, const char * text, bool invert);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_COMPOSITOR_H_ */
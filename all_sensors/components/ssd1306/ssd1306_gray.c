@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+
+#include "ssd1306.h"
+#include "ssd1306_gray.h"
+
+#define TAG "GRAY"
+
+#define CLK_DIV_FASTEST 0xF0 // Highest oscillator frequency, divide by 1
+#define CLK_DIV_DEFAULT 0x80 // As set by the init sequences
+
+static uint8_t * gray_plane(ssd1306_gray_t * gray, int plane, int page)
+{
+	SSD1306_t * dev = gray->dev;
+	return &gray->planes[(plane * dev->_pages + page) * dev->_width];
+}
+
+static void gray_clock_div(SSD1306_t * dev, uint8_t div)
+{
+	uint8_t cmds[] = { OLED_CMD_SET_DISPLAY_CLK_DIV, div }; // D5
+	dev->_ops->write_cmds(dev, cmds, sizeof(cmds));
+}
+
+// Time the panel takes for one frame: DCLKs per row times the multiplex ratio
+int ssd1306_gray_scan_us(SSD1306_t * dev)
+{
+	return (int)((int64_t)SSD1306_GRAY_SCAN_DCLKS * dev->_height * 1000000 / SSD1306_GRAY_FOSC_HZ);
+}
+
+esp_err_t ssd1306_gray_init(ssd1306_gray_t * gray, SSD1306_t * dev, int bits)
+{
+	if (bits < 1 || bits > SSD1306_GRAY_MAX_BITS) return ESP_ERR_INVALID_ARG;
+	memset(gray, 0, sizeof(*gray));
+	gray->planes = calloc(bits * dev->_pages, dev->_width);
+	if (gray->planes == NULL) return ESP_ERR_NO_MEM;
+	gray->dev = dev;
+	gray->bits = bits;
+	gray->levels = 1 << bits;
+	gray->cycle = gray->levels - 1;
+	gray->subframe_us = ssd1306_gray_scan_us(dev);
+	gray_clock_div(dev, CLK_DIV_FASTEST);
+	ESP_LOGI(TAG, "%d levels, %d subframes of at least %d us per cycle", gray->levels, gray->cycle, (int)gray->subframe_us);
+	return ESP_OK;
+}
+
+// Back to the 1-bit panel: pixels from half the range up stay lit
+void ssd1306_gray_deinit(ssd1306_gray_t * gray)
+{
+	SSD1306_t * dev = gray->dev;
+	ssd1306_flush(dev);
+	gray_clock_div(dev, CLK_DIV_DEFAULT);
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(dev->_page[page]._segs, gray_plane(gray, gray->bits - 1, page), dev->_width);
+	}
+	ssd1306_show_buffer(dev);
+	ssd1306_flush(dev);
+	free(gray->planes);
+	gray->planes = NULL;
+}
+
+void ssd1306_gray_clear(ssd1306_gray_t * gray, int level)
+{
+	for (int plane=0; plane<gray->bits; plane++) {
+		memset(gray_plane(gray, plane, 0), (level >> plane) & 1 ? 0xFF : 0x00, gray->dev->_pages * gray->dev->_width);
+	}
+}
+
+void ssd1306_gray_pixel(ssd1306_gray_t * gray, int xpos, int ypos, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	if (xpos < 0 || xpos >= dev->_width || ypos < 0 || ypos >= dev->_height) return;
+	int _page = ypos / 8;
+	uint8_t mask = dev->_flip ? 0x80 >> (ypos % 8) : 0x01 << (ypos % 8);
+	for (int plane=0; plane<gray->bits; plane++) {
+		uint8_t * seg = &gray_plane(gray, plane, _page)[xpos];
+		if ((level >> plane) & 1) {
+			*seg |= mask;
+		} else {
+			*seg &= ~mask;
+		}
+	}
+}
+
+// Page aligned, like ssd1306_display_image. An image of another depth is scaled by
+// repeating its bits, so its white stays white.
+void ssd1306_gray_image(ssd1306_gray_t * gray, int page, int seg, const ssd1306_gray_image_t * image)
+{
+	SSD1306_t * dev = gray->dev;
+	int pages = (image->height + 7) / 8;
+	int width = image->width;
+	if (page < 0 || seg < 0 || page >= dev->_pages || seg >= dev->_width) return;
+	if (page + pages > dev->_pages) pages = dev->_pages - page;
+	if (seg + width > dev->_width) width = dev->_width - seg;
+
+	for (int plane=0; plane<gray->bits; plane++) {
+		int src = plane - (gray->bits - image->bits);
+		while (src < 0) src += image->bits;
+		for (int _page=0; _page<pages; _page++) {
+			const uint8_t * from = &image->planes[(src * ((image->height + 7) / 8) + _page) * image->width];
+			uint8_t * to = &gray_plane(gray, plane, page + _page)[seg];
+			memcpy(to, from, width);
+			if (dev->_flip) ssd1306_flip(to, width);
+		}
+	}
+}
+
+// The internal buffer as it is, lit pixels at level. Before the first step, which
+// overwrites the buffer with the planes.
+void ssd1306_gray_from_buffer(ssd1306_gray_t * gray, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	for (int plane=0; plane<gray->bits; plane++) {
+		for (int page=0; page<dev->_pages; page++) {
+			if ((level >> plane) & 1) {
+				memcpy(gray_plane(gray, plane, page), dev->_page[page]._segs, dev->_width);
+			} else {
+				memset(gray_plane(gray, plane, page), 0, dev->_width);
+			}
+		}
+	}
+}
+
+// Show the next subframe. With a queued transport this returns while the plane is
+// still going out; the next step waits for it. The rest of a panel scan is busy-waited,
+// the tick is too coarse for it, so gray mode is for effects of seconds, not a
+// background screen.
+void ssd1306_gray_step(ssd1306_gray_t * gray)
+{
+	SSD1306_t * dev = gray->dev;
+	gray->slot = gray->slot % gray->cycle + 1;
+	int plane = gray->bits - 1 - __builtin_ctz(gray->slot);
+
+	ssd1306_flush(dev);
+	int64_t wait = gray->last_us + gray->subframe_us - esp_timer_get_time();
+	if (wait > 0) esp_rom_delay_us(wait);
+	gray->last_us = esp_timer_get_time();
+
+	for (int page=0; page<dev->_pages; page++) {
+		memcpy(dev->_page[page]._segs, gray_plane(gray, plane, page), dev->_width);
+	}
+	ssd1306_show_pages(dev, 0, dev->_pages, 0, dev->_width);
+	gray->subframes++;
+}
+
+void ssd1306_gray_show(ssd1306_gray_t * gray, int ms)
+{
+	int64_t end = esp_timer_get_time() + (int64_t)ms * 1000;
+	while (esp_timer_get_time() < end) {
+		ssd1306_gray_step(gray);
+	}
+	ssd1306_flush(gray->dev);
+}
+
+// Cycles per second this panel and bus sustain, measured over cycles cycles
+float ssd1306_gray_cycle_hz(ssd1306_gray_t * gray, int cycles)
+{
+	int64_t start = esp_timer_get_time();
+	for (int i=0; i<cycles*gray->cycle; i++) {
+		ssd1306_gray_step(gray);
+	}
+	ssd1306_flush(gray->dev);
+	int64_t elapsed = esp_timer_get_time() - start;
+	float hz = elapsed > 0 ? cycles * 1000000.0f / elapsed : 0;
+	ESP_LOGI(TAG, "%d levels: %.1f cycles/s, %.1f subframes/s", gray->levels, hz, hz * gray->cycle);
+	return hz;
+}
+
+// Every lit pixel to level, whatever level it had
+static void gray_recolor(ssd1306_gray_t * gray, int level)
+{
+	SSD1306_t * dev = gray->dev;
+	int size = dev->_pages * dev->_width;
+	for (int i=0; i<size; i++) {
+		uint8_t lit = 0;
+		for (int plane=0; plane<gray->bits; plane++) lit |= gray->planes[plane * size + i];
+		for (int plane=0; plane<gray->bits; plane++) gray->planes[plane * size + i] = (level >> plane) & 1 ? lit : 0;
+	}
+}
+
+// The screen in the internal buffer dims through the gray levels and goes dark in
+// about ms. Leaves the buffer cleared, like ssd1306_fadeout.
+void ssd1306_gray_fadeout(SSD1306_t * dev, int bits, int ms)
+{
+	ssd1306_gray_t gray;
+	if (ssd1306_gray_init(&gray, dev, bits) != ESP_OK) {
+		ESP_LOGW(TAG, "No gray mode, plain fadeout");
+		ssd1306_fadeout(dev);
+		return;
+	}
+	ssd1306_gray_from_buffer(&gray, gray.levels - 1);
+	for (int level=gray.levels-1; level>0; level--) {
+		gray_recolor(&gray, level);
+		ssd1306_gray_show(&gray, ms / gray.cycle);
+	}
+	ssd1306_gray_clear(&gray, 0);
+	ssd1306_gray_deinit(&gray);
+}
@@ -0,0 +1,65 @@
+#ifndef MAIN_SSD1306_GRAY_H_
+#define MAIN_SSD1306_GRAY_H_
+
+#include "ssd1306.h"
+
+// Gray levels on the 1-bit panel by temporal PWM. The picture is kept as bitplanes,
+// plane b holding bit b of every pixel's level, and ssd1306_gray_step shows one
+// plane per subframe: over a cycle of (1 << bits) - 1 subframes plane b is on the
+// glass for 1 << b of them, so a pixel is lit for level subframes out of the cycle.
+// Planes are interleaved (2 1 2 0 2 1 2 for 3 bits) so that no level stays dark
+// for long, which is what makes the flicker visible.
+//
+// Every subframe is a full frame on the bus, so this wants a fast transport: SPI,
+// or I2C at 1 MHz for 4 levels. A subframe is also held for at least one scan of
+// the panel, otherwise the planes do not get their share of the glass; the panel
+// oscillator is set to its fastest while gray mode is on. host/oled_gray_bench
+// shows which bus and panel sustain which depth; ssd1306_gray_cycle_hz gives the
+// rate on the board. Images are converted offline by host/oled_gray_convert.
+
+#define SSD1306_GRAY_MAX_BITS 3
+#define SSD1306_GRAY_FOSC_HZ 540000 // Oscillator at D5 = F0, typical from the datasheet curve, parts vary by 15%
+#define SSD1306_GRAY_SCAN_DCLKS 54 // DCLKs per row: precharge phases 2 + 2 (D9 = 22) and 50 for the row
+
+// Precomputed image, as written by host/oled_gray_convert
+typedef struct {
+	int width;
+	int height;
+	int bits; // 1 .. SSD1306_GRAY_MAX_BITS
+	const uint8_t * planes; // bits planes of (height + 7) / 8 pages of width bytes, bit 0 at the top of a page
+} ssd1306_gray_image_t;
+
+typedef struct {
+	SSD1306_t * dev;
+	int bits;
+	int levels; // 1 << bits, level 0 is off
+	int cycle; // Subframes per cycle, levels - 1
+	uint8_t * planes; // bits * _pages * _width bytes, in the panel's orientation
+	int slot; // Last subframe shown, 1 .. cycle
+	int64_t subframe_us; // Shortest subframe: one scan of the panel. 0 sends as fast as the bus goes
+	int64_t last_us; // Start of the last subframe
+	uint32_t subframes; // Since ssd1306_gray_init
+} ssd1306_gray_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+esp_err_t ssd1306_gray_init(ssd1306_gray_t * gray, SSD1306_t * dev, int bits);
+void ssd1306_gray_deinit(ssd1306_gray_t * gray);
+int ssd1306_gray_scan_us(SSD1306_t * dev);
+float ssd1306_gray_cycle_hz(ssd1306_gray_t * gray, int cycles);
+void ssd1306_gray_clear(ssd1306_gray_t * gray, int level);
+void ssd1306_gray_pixel(ssd1306_gray_t * gray, int xpos, int ypos, int level);
+void ssd1306_gray_image(ssd1306_gray_t * gray, int page, int seg, const ssd1306_gray_image_t * image);
+void ssd1306_gray_from_buffer(ssd1306_gray_t * gray, int level);
+void ssd1306_gray_step(ssd1306_gray_t * gray);
+void ssd1306_gray_show(ssd1306_gray_t * gray, int ms);
+void ssd1306_gray_fadeout(SSD1306_t * dev, int bits, int ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAIN_SSD1306_GRAY_H_ */
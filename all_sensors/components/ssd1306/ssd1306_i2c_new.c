@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/i2c_master.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+#include "ssd1306.h"
+#if CONFIG_I2C_BUS_TRACE
+#include "esp_timer.h"
+#include "i2c_bus_trace.h"
+#endif
+
+#define TAG "SSD1306"
+
+#if CONFIG_I2C_PORT_0
+#define I2C_NUM I2C_NUM_0
+#elif CONFIG_I2C_PORT_1
+#define I2C_NUM I2C_NUM_1
+#else
+#define I2C_NUM I2C_NUM_0 // if spi is selected
+#endif
+
+#define I2C_MASTER_FREQ_HZ 400000 // I2C clock of SSD1306 can run at 400 kHz max.
+#define I2C_XFER_TIMEOUT_MS 1000 // Same as the 100 ticks of the legacy driver
+#define I2C_SLOT_BYTES 128 // One page
+
+static int queue_depth = CONFIG_SSD1306_I2C_QUEUE_DEPTH;
+
+static const uint8_t control_cmd_stream = OLED_CONTROL_BYTE_CMD_STREAM;
+static const uint8_t control_data_stream = OLED_CONTROL_BYTE_DATA_STREAM;
+
+// Copy of a write that is not in the frame buffer, kept until its transaction is done.
+typedef struct {
+	uint32_t seq; // Transaction that used the slot last
+	uint8_t buf[I2C_SLOT_BYTES];
+} i2c_slot_t;
+
+// The driver keeps at most depth transactions in flight: when its queue is full, queuing waits for the oldest one.
+// So with depth + 1 slots used in turn, a slot is free again by the time it comes round; seq/done only check it.
+struct ssd1306_i2c_queue {
+	int depth;
+	int next;
+	uint32_t submitted;
+	volatile uint32_t done; // Counted in the ISR, transactions complete in order
+	i2c_slot_t slot[];
+};
+
+static bool IRAM_ATTR i2c_trans_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+	struct ssd1306_i2c_queue * q = arg;
+	q->done++;
+	return false;
+}
+
+// Queue (or, without a queue, send) control byte + data as one transaction. The data is not copied.
+static esp_err_t i2c_transmit(SSD1306_t * dev, const uint8_t * control, const uint8_t * data, size_t len)
+{
+	i2c_master_transmit_multi_buffer_info_t bufs[2] = {
+		{ .write_buffer = (uint8_t *)control, .buffer_size = 1 },
+		{ .write_buffer = (uint8_t *)data, .buffer_size = len },
+	};
+#if CONFIG_I2C_BUS_TRACE
+	// Queued transactions are recorded when they are queued, their duration is the time queuing took
+	int64_t start = esp_timer_get_time();
+	esp_err_t res = i2c_master_multi_buffer_transmit(dev->_i2c_dev_handle, bufs, 2, I2C_XFER_TIMEOUT_MS);
+	i2c_bus_trace_record(I2C_BUS_TRACE_SRC_DRIVER, dev->_i2c_num, dev->_address, start, res, control, 1, data, len, NULL, 0);
+#else
+	esp_err_t res = i2c_master_multi_buffer_transmit(dev->_i2c_dev_handle, bufs, 2, I2C_XFER_TIMEOUT_MS);
+#endif
+	if (res == ESP_OK && dev->_i2c_queue) {
+		dev->_i2c_queue->submitted++;
+	}
+	return res;
+}
+
+// Slot for a copy of the next write
+static uint8_t * i2c_slot_get(SSD1306_t * dev)
+{
+	struct ssd1306_i2c_queue * q = dev->_i2c_queue;
+	i2c_slot_t * s = &q->slot[q->next];
+	q->next = (q->next + 1) % (q->depth + 1);
+	if ((int32_t)(q->done - s->seq) < 0) {
+		ESP_LOGW(TAG, "Slot still in flight, waiting for the bus");
+		i2c_master_bus_wait_all_done(dev->_i2c_bus_handle, -1);
+	}
+	s->seq = q->submitted + 1;
+	return s->buf;
+}
+
+// Write with one control byte. Data in the frame buffer is sent from there, anything else is copied to a slot when the
+// transaction is queued; without a queue nothing is copied.
+static bool i2c_write(SSD1306_t * dev, const uint8_t * control, const uint8_t * data, size_t len)
+{
+	const uint8_t * fb = (const uint8_t *)dev->_page;
+	bool in_place = dev->_i2c_queue == NULL || (data >= fb && data + len <= fb + sizeof(dev->_page));
+
+	while (len > 0) {
+		size_t n = len;
+		const uint8_t * p = data;
+		if (!in_place) {
+			if (n > I2C_SLOT_BYTES) n = I2C_SLOT_BYTES;
+			uint8_t * buf = i2c_slot_get(dev);
+			memcpy(buf, data, n);
+			p = buf;
+		}
+		esp_err_t res = i2c_transmit(dev, control, p, n);
+		if (res != ESP_OK) {
+			ESP_LOGE(TAG, "Write failed. code: 0x%.2X", res);
+			return false;
+		}
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+static bool i2c_write_commands(SSD1306_t * dev, const uint8_t * cmds, size_t len)
+{
+	return i2c_write(dev, &control_cmd_stream, cmds, len);
+}
+
+static void i2c_write_window(SSD1306_t * dev, int page, int col, const uint8_t * images, int width)
+{
+	uint8_t cmds[] = {
+		0x00 + (col & 0x0F),		// Set Lower Column Start Address for Page Addressing Mode
+		0x10 + ((col >> 4) & 0x0F),	// Set Higher Column Start Address for Page Addressing Mode
+		0xB0 | page,				// Set Page Start Address for Page Addressing Mode
+	};
+	if (!i2c_write_commands(dev, cmds, sizeof(cmds))) return;
+	i2c_write(dev, &control_data_stream, images, width);
+}
+
+static void i2c_write_data(SSD1306_t * dev, const uint8_t * images, int width)
+{
+	i2c_write(dev, &control_data_stream, images, width);
+}
+
+// Wait until every queued transaction has been sent
+static void i2c_flush(SSD1306_t * dev)
+{
+	i2c_master_bus_wait_all_done(dev->_i2c_bus_handle, -1);
+}
+
+const ssd1306_transport_t ssd1306_i2c_master_transport = {
+	.name = "i2c master",
+	.write_cmds = i2c_write_commands,
+	.write_window = i2c_write_window,
+	.write_data = i2c_write_data,
+	.flush = i2c_flush,
+	.max_burst = 0,
+	.caps = SSD1306_CAP_WINDOW | SSD1306_CAP_ASYNC,
+};
+
+// Device without a queue: every write is done when it returns
+static const ssd1306_transport_t ssd1306_i2c_master_sync_transport = {
+	.name = "i2c master, synchronous",
+	.write_cmds = i2c_write_commands,
+	.write_window = i2c_write_window,
+	.write_data = i2c_write_data,
+	.flush = NULL,
+	.max_burst = 0,
+	.caps = SSD1306_CAP_WINDOW,
+};
+
+static void i2c_reset(int16_t reset)
+{
+	if (reset >= 0) {
+		gpio_reset_pin(reset);
+		gpio_set_direction(reset, GPIO_MODE_OUTPUT);
+		gpio_set_level(reset, 0);
+		vTaskDelay(50 / portTICK_PERIOD_MS);
+		gpio_set_level(reset, 1);
+	}
+}
+
+static void i2c_attach(SSD1306_t * dev, i2c_master_bus_handle_t bus_handle, i2c_port_t i2c_num, uint16_t i2c_address, int depth)
+{
+	i2c_device_config_t dev_cfg = {
+		.dev_addr_length = I2C_ADDR_BIT_LEN_7,
+		.device_address = i2c_address,
+		.scl_speed_hz = I2C_MASTER_FREQ_HZ,
+	};
+	ESP_ERROR_CHECK(i2c_master_bus_add_device(bus_handle, &dev_cfg, &dev->_i2c_dev_handle));
+	dev->_i2c_bus_handle = bus_handle;
+	dev->_i2c_queue = NULL;
+
+	if (depth > 0) {
+		struct ssd1306_i2c_queue * q = calloc(1, sizeof(struct ssd1306_i2c_queue) + (depth + 1) * sizeof(i2c_slot_t));
+		if (q == NULL) {
+			ESP_LOGE(TAG, "No memory for the transaction queue, writes are synchronous");
+		} else {
+			q->depth = depth;
+			i2c_master_event_callbacks_t cbs = { .on_trans_done = i2c_trans_done };
+			ESP_ERROR_CHECK(i2c_master_register_event_callbacks(dev->_i2c_dev_handle, &cbs, q));
+			dev->_i2c_queue = q;
+		}
+	}
+
+	dev->_address = i2c_address;
+	dev->_flip = false;
+	dev->_i2c_num = i2c_num;
+	dev->_ops = dev->_i2c_queue ? &ssd1306_i2c_master_transport : &ssd1306_i2c_master_sync_transport;
+}
+
+void i2c_queue_depth(int depth) {
+	ESP_LOGI(TAG, "I2C queue depth=%d", depth);
+	queue_depth = depth;
+}
+
+void i2c_master_init(SSD1306_t * dev, int16_t sda, int16_t scl, int16_t reset)
+{
+	ESP_LOGI(TAG, "New i2c driver is used");
+	i2c_master_bus_config_t bus_config = {
+		.clk_source = I2C_CLK_SRC_DEFAULT,
+		.glitch_ignore_cnt = 7,
+		.i2c_port = I2C_NUM,
+		.scl_io_num = scl,
+		.sda_io_num = sda,
+		.trans_queue_depth = queue_depth,
+		.flags.enable_internal_pullup = true,
+	};
+	i2c_master_bus_handle_t bus_handle;
+	ESP_ERROR_CHECK(i2c_new_master_bus(&bus_config, &bus_handle));
+
+	i2c_reset(reset);
+	i2c_attach(dev, bus_handle, I2C_NUM, I2C_ADDRESS, queue_depth);
+}
+
+// The bus belongs to whoever created it (i2c_bus with the new driver, for example) and was set up without a
+// transaction queue for its synchronous users, so writes to this device are synchronous too.
+void i2c_device_add(SSD1306_t * dev, i2c_port_t i2c_num, int16_t reset, uint16_t i2c_address)
+{
+	ESP_LOGI(TAG, "New i2c driver is used");
+	ESP_LOGW(TAG, "Will not install i2c master driver");
+	i2c_master_bus_handle_t bus_handle;
+	ESP_ERROR_CHECK(i2c_master_get_bus_handle(i2c_num, &bus_handle));
+
+	i2c_reset(reset);
+	i2c_attach(dev, bus_handle, i2c_num, i2c_address, 0);
+}
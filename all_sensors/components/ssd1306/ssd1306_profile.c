@@ -0,0 +1,122 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "ssd1306.h"
+
+// SH1106: 132 column RAM, page addressing only, DC-DC instead of the charge pump, no scroll commands.
+// Returns the number of bytes written to cmds, at most OLED_INIT_SEQUENCE_MAX.
+int sh1106_init_sequence(SSD1306_t * dev, uint8_t * cmds)
+{
+	int n = 0;
+	cmds[n++] = OLED_CMD_DISPLAY_OFF;				// AE
+	cmds[n++] = OLED_CMD_SET_DISPLAY_CLK_DIV;		// D5
+	cmds[n++] = 0x80;
+	cmds[n++] = OLED_CMD_SET_MUX_RATIO;			// A8
+	cmds[n++] = dev->_height - 1;
+	cmds[n++] = OLED_CMD_SET_DISPLAY_OFFSET;		// D3
+	cmds[n++] = 0x00;
+	cmds[n++] = OLED_CMD_SET_DISPLAY_START_LINE;	// 40
+	cmds[n++] = 0xAD;								// DC-DC control
+	cmds[n++] = 0x8B;								// DC-DC on
+	cmds[n++] = 0x32;								// Pump voltage 8.0V
+	if (dev->_flip) {
+		cmds[n++] = OLED_CMD_SET_SEGMENT_REMAP_0;	// A0
+	} else {
+		cmds[n++] = OLED_CMD_SET_SEGMENT_REMAP_1;	// A1
+	}
+	cmds[n++] = OLED_CMD_SET_COM_SCAN_MODE;		// C8
+	cmds[n++] = OLED_CMD_SET_COM_PIN_MAP;			// DA
+	cmds[n++] = dev->_profile->com_pins;
+	cmds[n++] = OLED_CMD_SET_CONTRAST;			// 81
+	cmds[n++] = 0xFF;
+	cmds[n++] = OLED_CMD_SET_PRECHARGE;			// D9
+	cmds[n++] = 0x1F;
+	cmds[n++] = OLED_CMD_SET_VCOMH_DESELCT;		// DB
+	cmds[n++] = 0x40;
+	cmds[n++] = OLED_CMD_DISPLAY_RAM;				// A4
+	cmds[n++] = OLED_CMD_DISPLAY_NORMAL;			// A6
+	cmds[n++] = OLED_CMD_DISPLAY_ON;				// AF
+	return n;
+}
+
+// 72x40 glass sits on an SSD1306B, which needs the internal current reference switched on
+static int ssd1306_72x40_init_sequence(SSD1306_t * dev, uint8_t * cmds)
+{
+	int n = ssd1306_init_sequence(dev, cmds) - 1; // Without the final display on
+	cmds[n++] = 0xAD;								// Internal IREF setting
+	cmds[n++] = 0x30;								// Internal IREF on
+	cmds[n++] = OLED_CMD_DISPLAY_ON;				// AF
+	return n;
+}
+
+const ssd1306_profile_t ssd1306_profile_128x64 = {
+	.name = "ssd1306_128x64",
+	.ram_width = 128,
+	.width = 128,
+	.height = 64,
+	.col_offset = 0,
+	.com_pins = 0x12,
+	.caps = SSD1306_PANEL_HORIZONTAL | SSD1306_PANEL_SCROLL,
+	.init_sequence = ssd1306_init_sequence,
+};
+
+const ssd1306_profile_t ssd1306_profile_128x32 = {
+	.name = "ssd1306_128x32",
+	.ram_width = 128,
+	.width = 128,
+	.height = 32,
+	.col_offset = 0,
+	.com_pins = 0x02,
+	.caps = SSD1306_PANEL_HORIZONTAL | SSD1306_PANEL_SCROLL,
+	.init_sequence = ssd1306_init_sequence,
+};
+
+const ssd1306_profile_t ssd1306_profile_72x40 = {
+	.name = "ssd1306_72x40",
+	.ram_width = 128,
+	.width = 72,
+	.height = 40,
+	.col_offset = 28,
+	.com_pins = 0x12,
+	.caps = SSD1306_PANEL_HORIZONTAL | SSD1306_PANEL_SCROLL,
+	.init_sequence = ssd1306_72x40_init_sequence,
+};
+
+const ssd1306_profile_t sh1106_profile_128x64 = {
+	.name = "sh1106_128x64",
+	.ram_width = 132,
+	.width = 128,
+	.height = 64,
+	.col_offset = 2,
+	.com_pins = 0x12,
+	.caps = 0,
+	.init_sequence = sh1106_init_sequence,
+};
+
+static const ssd1306_profile_t * const profiles[] = {
+	&ssd1306_profile_128x64,
+	&ssd1306_profile_128x32,
+	&ssd1306_profile_72x40,
+	&sh1106_profile_128x64,
+};
+
+// Profile by name, e.g. as stored in NVS. NULL if unknown.
+const ssd1306_profile_t * ssd1306_profile_find(const char * name)
+{
+	for (int i=0; i<sizeof(profiles)/sizeof(profiles[0]); i++) {
+		if (strcmp(profiles[i]->name, name) == 0) return profiles[i];
+	}
+	ESP_LOGW(__FUNCTION__, "Unknown panel profile %s", name);
+	return NULL;
+}
+
+// SSD1306 profile of a panel size, for ssd1306_init. NULL if there is none.
+const ssd1306_profile_t * ssd1306_profile_for(int width, int height)
+{
+	for (int i=0; i<sizeof(profiles)/sizeof(profiles[0]); i++) {
+		if (profiles[i]->init_sequence == sh1106_init_sequence) continue;
+		if (profiles[i]->width == width && profiles[i]->height == height) return profiles[i];
+	}
+	return NULL;
+}
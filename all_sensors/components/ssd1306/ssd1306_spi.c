@@ -4,6 +4,8 @@
 #include "freertos/task.h"
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 
 #include "ssd1306.h"
@@ -21,9 +23,92 @@
 #define SPI_COMMAND_MODE 0
 #define SPI_DATA_MODE 1
 #define SPI_DEFAULT_FREQUENCY 1000000; // 1MHz
+#define SPI_QUEUE_SIZE 16 // Command and data transaction of each of the 8 pages: a whole frame is queued without waiting
+#define SPI_SLOT_BYTES 132 // One page row (132 columns on SH1106)
 
 int clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 
+// Queued transaction. The payload is copied into buf, so the caller's buffer can be reused at once and does not
+// have to be DMA capable; D/C is set from dc_gpio/dc_level by the pre-transfer callback when the transaction starts.
+typedef struct {
+	spi_transaction_t trans;
+	int dc_gpio;
+	uint32_t dc_level;
+	uint8_t buf[SPI_SLOT_BYTES] __attribute__((aligned(4)));
+} spi_slot_t;
+
+// Ring of slots, in DMA capable memory. Transactions complete in order, so the slot after the last one used is
+// always the oldest one in flight.
+struct ssd1306_spi_queue {
+	spi_slot_t slot[SPI_QUEUE_SIZE];
+	int head;
+	int in_flight;
+};
+
+static void IRAM_ATTR spi_pre_transfer_callback(spi_transaction_t *t)
+{
+	spi_slot_t *slot = (spi_slot_t *)t->user;
+	if (slot) {
+		gpio_set_level(slot->dc_gpio, slot->dc_level);
+	}
+}
+
+static void spi_queue_create(SSD1306_t * dev)
+{
+	dev->_spi_queue = heap_caps_calloc(1, sizeof(struct ssd1306_spi_queue), MALLOC_CAP_DMA);
+	assert(dev->_spi_queue != NULL);
+}
+
+// Wait for the oldest transaction
+static bool spi_queue_wait(SSD1306_t * dev)
+{
+	spi_transaction_t *done;
+	esp_err_t ret = spi_device_get_trans_result(dev->_spi_device_handle, &done, portMAX_DELAY);
+	if (ret != ESP_OK) {
+		ESP_LOGE(TAG, "spi_device_get_trans_result=%d", ret);
+		return false;
+	}
+	dev->_spi_queue->in_flight--;
+	return true;
+}
+
+// Queue a command or data write, split over several transactions if longer than a slot
+static bool spi_queue_write(SSD1306_t * dev, uint32_t dc_level, const uint8_t * data, size_t len)
+{
+	struct ssd1306_spi_queue *q = dev->_spi_queue;
+	while (len > 0) {
+		if (q->in_flight == SPI_QUEUE_SIZE && !spi_queue_wait(dev)) {
+			return false;
+		}
+		spi_slot_t *slot = &q->slot[q->head];
+		size_t n = len < SPI_SLOT_BYTES ? len : SPI_SLOT_BYTES;
+		memcpy(slot->buf, data, n);
+		slot->dc_gpio = dev->_dc;
+		slot->dc_level = dc_level;
+		memset(&slot->trans, 0, sizeof(spi_transaction_t));
+		slot->trans.length = n * 8;
+		slot->trans.tx_buffer = slot->buf;
+		slot->trans.user = slot;
+		esp_err_t ret = spi_device_queue_trans(dev->_spi_device_handle, &slot->trans, portMAX_DELAY);
+		if (ret != ESP_OK) {
+			ESP_LOGE(TAG, "spi_device_queue_trans=%d", ret);
+			return false;
+		}
+		q->head = (q->head + 1) % SPI_QUEUE_SIZE;
+		q->in_flight++;
+		data += n;
+		len -= n;
+	}
+	return true;
+}
+
+// Wait until every queued transaction has been sent
+void spi_flush(SSD1306_t * dev)
+{
+	while (dev->_spi_queue->in_flight > 0 && spi_queue_wait(dev)) {
+	}
+}
+
 void spi_clock_speed(int speed) {
 	ESP_LOGI(TAG, "SPI clock speed=%d MHz", speed/1000000);
 	clock_speed_hz = speed;
@@ -69,7 +154,8 @@ void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, in
 	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 	devcfg.clock_speed_hz = clock_speed_hz;
 	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
+	devcfg.queue_size = SPI_QUEUE_SIZE;
+	devcfg.pre_cb = spi_pre_transfer_callback;
 
 	spi_device_handle_t spi_device_handle;
 	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
@@ -80,6 +166,8 @@ void spi_master_init(SSD1306_t * dev, int16_t mosi, int16_t sclk, int16_t cs, in
 	dev->_address = SPI_ADDRESS;
 	dev->_flip = false;
 	dev->_spi_device_handle = spi_device_handle;
+	dev->_ops = &ssd1306_spi_transport;
+	spi_queue_create(dev);
 }
 
 void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
@@ -125,7 +213,8 @@ void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 	//devcfg.clock_speed_hz = SPI_DEFAULT_FREQUENCY;
 	devcfg.clock_speed_hz = clock_speed_hz;
 	devcfg.spics_io_num = cs;
-	devcfg.queue_size = 1;
+	devcfg.queue_size = SPI_QUEUE_SIZE;
+	devcfg.pre_cb = spi_pre_transfer_callback;
 
 	spi_device_handle_t spi_device_handle;
 	ret = spi_bus_add_device( HOST_ID, &devcfg, &spi_device_handle);
@@ -136,9 +225,13 @@ void spi_device_add(SSD1306_t * dev, int16_t cs, int16_t dc, int16_t reset)
 	dev->_address = SPI_ADDRESS;
 	dev->_flip = false;
 	dev->_spi_device_handle = spi_device_handle;
+	dev->_ops = &ssd1306_spi_transport;
+	spi_queue_create(dev);
 }
 
 
+// Blocking write on a bare handle, D/C is left as it is. Not to be mixed with the queued writes below on the same
+// device: call spi_flush first.
 bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* Data, size_t DataLength )
 {
 	spi_transaction_t SPITransaction;
@@ -155,163 +248,64 @@ bool spi_master_write_byte(const spi_device_handle_t SPIHandle, const uint8_t* D
 
 bool spi_master_write_commands(SSD1306_t * dev, const uint8_t * Commands, size_t DataLength )
 {
-	gpio_set_level( dev->_dc, SPI_COMMAND_MODE );
-	return spi_master_write_byte( dev->_spi_device_handle, Commands, DataLength );
+	return spi_queue_write( dev, SPI_COMMAND_MODE, Commands, DataLength );
 }
 
 bool spi_master_write_command(SSD1306_t * dev, uint8_t Command )
 {
-	static uint8_t CommandByte = 0;
-	CommandByte = Command;
-	return spi_master_write_commands( dev, &CommandByte, 1 );
+	return spi_queue_write( dev, SPI_COMMAND_MODE, &Command, 1 );
 }
 
 bool spi_master_write_data(SSD1306_t * dev, const uint8_t* Data, size_t DataLength )
 {
-	gpio_set_level( dev->_dc, SPI_DATA_MODE );
-	return spi_master_write_byte( dev->_spi_device_handle, Data, DataLength );
+	return spi_queue_write( dev, SPI_DATA_MODE, Data, DataLength );
 }
 
 
-void spi_init(SSD1306_t * dev, int width, int height)
+// Write data to the controller RAM at a page and column
+static void spi_write_window(SSD1306_t * dev, int page, int col, const uint8_t * images, int width)
 {
-	dev->_width = width;
-	dev->_height = height;
-	dev->_pages = 8;
-	if (dev->_height == 32) dev->_pages = 4;
-
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_OFF);			// AE
-	spi_master_write_command(dev, OLED_CMD_SET_MUX_RATIO);			// A8
-	if (dev->_height == 64) spi_master_write_command(dev, 0x3F);
-	if (dev->_height == 32) spi_master_write_command(dev, 0x1F);
-	spi_master_write_command(dev, OLED_CMD_SET_DISPLAY_OFFSET);		// D3
-	spi_master_write_command(dev, 0x00);
-	spi_master_write_command(dev, OLED_CONTROL_BYTE_DATA_STREAM);	// 40
-	if (dev->_flip) {
-		spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP_0);	// A0
-	} else {
-		spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP_1);	// A1
-	}
-	//spi_master_write_command(dev, OLED_CMD_SET_SEGMENT_REMAP);		// A1
-	spi_master_write_command(dev, OLED_CMD_SET_COM_SCAN_MODE);		// C8
-	spi_master_write_command(dev, OLED_CMD_SET_DISPLAY_CLK_DIV);	// D5
-	spi_master_write_command(dev, 0x80);
-	spi_master_write_command(dev, OLED_CMD_SET_COM_PIN_MAP);		// DA
-	if (dev->_height == 64) spi_master_write_command(dev, 0x12);
-	if (dev->_height == 32) spi_master_write_command(dev, 0x02);
-	spi_master_write_command(dev, OLED_CMD_SET_CONTRAST);			// 81
-	spi_master_write_command(dev, 0xFF);
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_RAM);			// A4
-	spi_master_write_command(dev, OLED_CMD_SET_VCOMH_DESELCT);		// DB
-	spi_master_write_command(dev, 0x40);
-	spi_master_write_command(dev, OLED_CMD_SET_MEMORY_ADDR_MODE);	// 20
-	//spi_master_write_command(dev, OLED_CMD_SET_HORI_ADDR_MODE);	// 00
-	spi_master_write_command(dev, OLED_CMD_SET_PAGE_ADDR_MODE);		// 02
-	// Set Lower Column Start Address for Page Addressing Mode
-	spi_master_write_command(dev, 0x00);
-	// Set Higher Column Start Address for Page Addressing Mode
-	spi_master_write_command(dev, 0x10);
-	spi_master_write_command(dev, OLED_CMD_SET_CHARGE_PUMP);		// 8D
-	spi_master_write_command(dev, 0x14);
-	spi_master_write_command(dev, OLED_CMD_DEACTIVE_SCROLL);		// 2E
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_NORMAL);			// A6
-	spi_master_write_command(dev, OLED_CMD_DISPLAY_ON);				// AF
-}
-
-
-void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
-{
-	if (page >= dev->_pages) return;
-	if (seg >= dev->_width) return;
-
-	int _seg = seg + CONFIG_OFFSETX;
-	uint8_t columLow = _seg & 0x0F;
-	uint8_t columHigh = (_seg >> 4) & 0x0F;
-
-	int _page = page;
-	if (dev->_flip) {
-		_page = (dev->_pages - page) - 1;
-	}
-
 	// Set Lower Column Start Address for Page Addressing Mode, Higher Column Start Address for Page Addressing Mode and Page Start Address for Page Addressing Mode
-	uint8_t commands[3] = { 0x00 + columLow, 0x10 + columHigh, 0xB0 | _page };
+	uint8_t commands[3] = { 0x00 + (col & 0x0F), 0x10 + ((col >> 4) & 0x0F), 0xB0 | page };
 	spi_master_write_commands(dev, commands, 3);
 
 	spi_master_write_data(dev, images, width);
+}
 
+static void spi_write_data(SSD1306_t * dev, const uint8_t * images, int width)
+{
+	spi_master_write_data(dev, images, width);
 }
 
-void spi_contrast(SSD1306_t * dev, int contrast) {
-	int _contrast = contrast;
-	if (contrast < 0x0) _contrast = 0;
-	if (contrast > 0xFF) _contrast = 0xFF;
+const ssd1306_transport_t ssd1306_spi_transport = {
+	.name = "spi",
+	.write_cmds = spi_master_write_commands,
+	.write_window = spi_write_window,
+	.write_data = spi_write_data,
+	.flush = spi_flush,
+	.max_burst = SPI_SLOT_BYTES,
+	.caps = SSD1306_CAP_WINDOW | SSD1306_CAP_ASYNC,
+};
 
-	spi_master_write_command(dev, OLED_CMD_SET_CONTRAST);			// 81
-	spi_master_write_command(dev, _contrast);
-}
+// The functions below are kept for existing callers, they are the same as the ssd1306_ ones on a device added with
+// spi_master_init / spi_device_add.
 
-void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
+void spi_init(SSD1306_t * dev, int width, int height)
 {
+	ssd1306_init(dev, width, height);
+}
 
-	if (scroll == SCROLL_RIGHT) {
-		spi_master_write_command(dev, OLED_CMD_HORIZONTAL_RIGHT);	// 26
-		spi_master_write_command(dev, 0x00); // Dummy byte
-		spi_master_write_command(dev, 0x00); // Define start page address
-		spi_master_write_command(dev, 0x07); // Frame frequency
-		spi_master_write_command(dev, 0x07); // Define end page address
-		spi_master_write_command(dev, 0x00); //
-		spi_master_write_command(dev, 0xFF); //
-		spi_master_write_command(dev, OLED_CMD_ACTIVE_SCROLL);		// 2F
-	} 
-
-	if (scroll == SCROLL_LEFT) {
-		spi_master_write_command(dev, OLED_CMD_HORIZONTAL_LEFT);	// 27
-		spi_master_write_command(dev, 0x00); // Dummy byte
-		spi_master_write_command(dev, 0x00); // Define start page address
-		spi_master_write_command(dev, 0x07); // Frame frequency
-		spi_master_write_command(dev, 0x07); // Define end page address
-		spi_master_write_command(dev, 0x00); //
-		spi_master_write_command(dev, 0xFF); //
-		spi_master_write_command(dev, OLED_CMD_ACTIVE_SCROLL);		// 2F
-	} 
-
-	if (scroll == SCROLL_DOWN) {
-		spi_master_write_command(dev, OLED_CMD_CONTINUOUS_SCROLL);	// 29
-		spi_master_write_command(dev, 0x00); // Dummy byte
-		spi_master_write_command(dev, 0x00); // Define start page address
-		spi_master_write_command(dev, 0x07); // Frame frequency
-		//spi_master_write_command(dev, 0x01); // Define end page address
-		spi_master_write_command(dev, 0x00); // Define end page address
-		spi_master_write_command(dev, 0x3F); // Vertical scrolling offset
-
-		spi_master_write_command(dev, OLED_CMD_VERTICAL);			// A3
-		spi_master_write_command(dev, 0x00);
-		if (dev->_height == 64)
-			spi_master_write_command(dev, 0x40);
-		if (dev->_height == 32)
-			spi_master_write_command(dev, 0x20);
-		spi_master_write_command(dev, OLED_CMD_ACTIVE_SCROLL);		// 2F
-	}
+void spi_display_image(SSD1306_t * dev, int page, int seg, const uint8_t * images, int width)
+{
+	ssd1306_send_image(dev, page, seg, images, width);
+}
 
-	if (scroll == SCROLL_UP) {
-		spi_master_write_command(dev, OLED_CMD_CONTINUOUS_SCROLL);	// 29
-		spi_master_write_command(dev, 0x00); // Dummy byte
-		spi_master_write_command(dev, 0x00); // Define start page address
-		spi_master_write_command(dev, 0x07); // Frame frequency
-		//spi_master_write_command(dev, 0x01); // Define end page address
-		spi_master_write_command(dev, 0x00); // Define end page address
-		spi_master_write_command(dev, 0x01); // Vertical scrolling offset
-
-		spi_master_write_command(dev, OLED_CMD_VERTICAL);			// A3
-		spi_master_write_command(dev, 0x00);
-		if (dev->_height == 64)
-			spi_master_write_command(dev, 0x40);
-		if (dev->_height == 32)
-			spi_master_write_command(dev, 0x20);
-		spi_master_write_command(dev, OLED_CMD_ACTIVE_SCROLL);		// 2F
-	}
+void spi_contrast(SSD1306_t * dev, int contrast)
+{
+	ssd1306_contrast(dev, contrast);
+}
 
-	if (scroll == SCROLL_STOP) {
-		spi_master_write_command(dev, OLED_CMD_DEACTIVE_SCROLL);	// 2E
-	}
+void spi_hardware_scroll(SSD1306_t * dev, ssd1306_scroll_type_t scroll)
+{
+	ssd1306_hardware_scroll(dev, scroll);
 }
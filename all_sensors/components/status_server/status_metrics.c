@@ -0,0 +1,316 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "status_metrics.h"
+
+static const struct {
+    const char *name;
+    uint32_t seconds;
+} s_windows[STATUS_WINDOW_COUNT] = {
+    [STATUS_WINDOW_5M] = { "5m", 5 * 60 },
+    [STATUS_WINDOW_1H] = { "1h", 60 * 60 },
+};
+
+void status_rollup_add(status_rollup_t *rollup, uint32_t now_s, float value)
+{
+    uint32_t minute = now_s / STATUS_ROLLUP_BUCKET_S;
+    status_rollup_bucket_t *b = &rollup->bucket[minute % STATUS_ROLLUP_BUCKETS];
+    if (b->minute != minute || b->count == 0) {
+        // A bucket an hour old is reused, its samples are out of every window by now
+        b->minute = minute;
+        b->count = 0;
+        b->min = value;
+        b->max = value;
+        b->sum = 0;
+    }
+    b->count++;
+    b->sum += value;
+    if (value < b->min) {
+        b->min = value;
+    }
+    if (value > b->max) {
+        b->max = value;
+    }
+}
+
+void status_rollup_window(const status_rollup_t *rollup, uint32_t now_s, uint32_t window_s, status_window_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    uint32_t minute = now_s / STATUS_ROLLUP_BUCKET_S;
+    uint32_t minutes = (window_s + STATUS_ROLLUP_BUCKET_S - 1) / STATUS_ROLLUP_BUCKET_S;
+    if (minutes > STATUS_ROLLUP_BUCKETS) {
+        minutes = STATUS_ROLLUP_BUCKETS;
+    }
+    float sum = 0;
+    for (uint32_t k = 0; k < minutes && k <= minute; k++) {
+        const status_rollup_bucket_t *b = &rollup->bucket[(minute - k) % STATUS_ROLLUP_BUCKETS];
+        if (b->minute != minute - k || b->count == 0) {
+            continue;
+        }
+        if (out->count == 0 || b->min < out->min) {
+            out->min = b->min;
+        }
+        if (out->count == 0 || b->max > out->max) {
+            out->max = b->max;
+        }
+        out->count += b->count;
+        sum += b->sum;
+    }
+    if (out->count) {
+        out->avg = sum / out->count;
+    }
+}
+
+void status_snapshot_reset(status_snapshot_t *snap, uint32_t uptime_s)
+{
+    snap->uptime_s = uptime_s;
+    snap->reading_count = 0;
+    snap->metric_count = 0;
+    snap->dropped = 0;
+}
+
+bool status_snapshot_reading(status_snapshot_t *snap, const char *name, const char *unit, float value, bool valid,
+                             bool stale, const status_rollup_t *rollup)
+{
+    if (snap->reading_count == STATUS_MAX_READINGS) {
+        snap->dropped++;
+        return false;
+    }
+    status_reading_t *r = &snap->readings[snap->reading_count++];
+    r->name = name;
+    r->unit = unit;
+    r->value = value;
+    r->valid = valid;
+    r->stale = stale;
+    for (int w = 0; w < STATUS_WINDOW_COUNT; w++) {
+        if (rollup) {
+            status_rollup_window(rollup, snap->uptime_s, s_windows[w].seconds, &r->window[w]);
+        } else {
+            memset(&r->window[w], 0, sizeof(r->window[w]));
+        }
+    }
+    return true;
+}
+
+bool status_snapshot_metric(status_snapshot_t *snap, const char *name, const char *help, status_metric_type_t type,
+                            const char *label_name, const char *label_value, double value)
+{
+    if (snap->metric_count == STATUS_MAX_METRICS) {
+        snap->dropped++;
+        return false;
+    }
+    status_metric_t *m = &snap->metrics[snap->metric_count++];
+    m->name = name;
+    m->help = help;
+    m->type = type;
+    m->label_name = label_name;
+    m->label_value[0] = '\0';
+    if (label_name && label_value) {
+        strncat(m->label_value, label_value, sizeof(m->label_value) - 1);
+    }
+    m->value = value;
+    return true;
+}
+
+/* Output into a fixed buffer, counting what did not fit */
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t at;                                                                                              /*!< Length of the whole output so far, may be past len */
+} out_t;
+
+static void put(out_t *o, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->at < o->len ? o->buf + o->at : NULL, o->at < o->len ? o->len - o->at : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        o->at += n;
+    }
+}
+
+// Quotes, backslashes and new lines are escaped the same way in JSON strings and Prometheus label values; other
+// control characters only JSON allows as \u escapes, Prometheus gets them as they are
+static void put_escaped(out_t *o, const char *s, bool json)
+{
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            put(o, "\\%c", *s);
+        } else if (*s == '\n') {
+            put(o, "\\n");
+        } else if (json && (unsigned char)*s < 0x20) {
+            put(o, "\\u%04x", *s);
+        } else {
+            put(o, "%c", *s);
+        }
+    }
+}
+
+static void put_json_number(out_t *o, double v, int digits)
+{
+    if (isfinite(v)) {
+        put(o, "%.*g", digits, v);
+    } else {
+        put(o, "null");
+    }
+}
+
+static void put_prometheus_number(out_t *o, double v, int digits)
+{
+    if (isnan(v)) {
+        put(o, "NaN");
+    } else if (isinf(v)) {
+        put(o, v > 0 ? "+Inf" : "-Inf");
+    } else {
+        put(o, "%.*g", digits, v);
+    }
+}
+
+size_t status_format_json(const status_snapshot_t *snap, char *buf, size_t len)
+{
+    out_t o = { .buf = buf, .len = len };
+    if (len) {
+        buf[0] = '\0';
+    }
+    put(&o, "{\"uptime_s\":%" PRIu32 ",\"readings\":{", snap->uptime_s);
+    for (int i = 0; i < snap->reading_count; i++) {
+        const status_reading_t *r = &snap->readings[i];
+        put(&o, "%s\"", i ? "," : "");
+        put_escaped(&o, r->name, true);
+        put(&o, "\":{\"unit\":\"");
+        put_escaped(&o, r->unit, true);
+        put(&o, "\",\"value\":");
+        if (r->valid) {
+            put_json_number(&o, r->value, 7);
+        } else {
+            put(&o, "null");
+        }
+        put(&o, ",\"valid\":%s,\"stale\":%s", r->valid ? "true" : "false", r->stale ? "true" : "false");
+        for (int w = 0; w < STATUS_WINDOW_COUNT; w++) {
+            const status_window_t *win = &r->window[w];
+            put(&o, ",\"%s\":", s_windows[w].name);
+            if (win->count == 0) {
+                put(&o, "null");
+                continue;
+            }
+            put(&o, "{\"min\":");
+            put_json_number(&o, win->min, 7);
+            put(&o, ",\"avg\":");
+            put_json_number(&o, win->avg, 7);
+            put(&o, ",\"max\":");
+            put_json_number(&o, win->max, 7);
+            put(&o, ",\"samples\":%" PRIu32 "}", win->count);
+        }
+        put(&o, "}");
+    }
+    put(&o, "},\"metrics\":[");
+    for (int i = 0; i < snap->metric_count; i++) {
+        const status_metric_t *m = &snap->metrics[i];
+        put(&o, "%s{\"name\":\"", i ? "," : "");
+        put_escaped(&o, m->name, true);
+        put(&o, "\"");
+        if (m->label_name) {
+            put(&o, ",\"");
+            put_escaped(&o, m->label_name, true);
+            put(&o, "\":\"");
+            put_escaped(&o, m->label_value, true);
+            put(&o, "\"");
+        }
+        put(&o, ",\"value\":");
+        put_json_number(&o, m->value, 15);
+        put(&o, "}");
+    }
+    put(&o, "],\"dropped\":%u}\n", snap->dropped);
+    return o.at;
+}
+
+static void put_family(out_t *o, const char *name, const char *help, const char *type)
+{
+    put(o, "# HELP mirror_%s %s\n# TYPE mirror_%s %s\n", name, help, name, type);
+}
+
+size_t status_format_prometheus(const status_snapshot_t *snap, char *buf, size_t len)
+{
+    static const struct {
+        const char *name;
+        const char *help;
+    } window_families[] = {
+        { "reading_min", "Lowest sample over the window" },
+        { "reading_avg", "Mean of the samples over the window" },
+        { "reading_max", "Highest sample over the window" },
+        { "reading_samples", "Samples over the window" },
+    };
+    out_t o = { .buf = buf, .len = len };
+    if (len) {
+        buf[0] = '\0';
+    }
+    put_family(&o, "uptime_seconds", "Time since boot", "gauge");
+    put(&o, "mirror_uptime_seconds %" PRIu32 "\n", snap->uptime_s);
+
+    // Readings never read are left out rather than reported as 0
+    put_family(&o, "reading", "Current sensor reading", "gauge");
+    for (int i = 0; i < snap->reading_count; i++) {
+        const status_reading_t *r = &snap->readings[i];
+        if (!r->valid) {
+            continue;
+        }
+        put(&o, "mirror_reading{sensor=\"");
+        put_escaped(&o, r->name, false);
+        put(&o, "\",unit=\"");
+        put_escaped(&o, r->unit, false);
+        put(&o, "\"} ");
+        put_prometheus_number(&o, r->value, 7);
+        put(&o, "\n");
+    }
+    put_family(&o, "reading_stale", "1 if the last read failed and the reading is older", "gauge");
+    for (int i = 0; i < snap->reading_count; i++) {
+        const status_reading_t *r = &snap->readings[i];
+        if (!r->valid) {
+            continue;
+        }
+        put(&o, "mirror_reading_stale{sensor=\"");
+        put_escaped(&o, r->name, false);
+        put(&o, "\"} %d\n", r->stale);
+    }
+    for (size_t f = 0; f < sizeof(window_families) / sizeof(window_families[0]); f++) {
+        put_family(&o, window_families[f].name, window_families[f].help, "gauge");
+        for (int i = 0; i < snap->reading_count; i++) {
+            const status_reading_t *r = &snap->readings[i];
+            for (int w = 0; w < STATUS_WINDOW_COUNT; w++) {
+                const status_window_t *win = &r->window[w];
+                if (win->count == 0) {
+                    continue;
+                }
+                double v = f == 0 ? win->min : f == 1 ? win->avg : f == 2 ? win->max : win->count;
+                put(&o, "mirror_%s{sensor=\"", window_families[f].name);
+                put_escaped(&o, r->name, false);
+                put(&o, "\",window=\"%s\"} ", s_windows[w].name);
+                put_prometheus_number(&o, v, 7);
+                put(&o, "\n");
+            }
+        }
+    }
+
+    for (int i = 0; i < snap->metric_count; i++) {
+        const status_metric_t *m = &snap->metrics[i];
+        if (i == 0 || strcmp(m->name, snap->metrics[i - 1].name) != 0) {
+            put_family(&o, m->name, m->help, m->type == STATUS_METRIC_COUNTER ? "counter" : "gauge");
+        }
+        put(&o, "mirror_%s", m->name);
+        if (m->label_name) {
+            put(&o, "{%s=\"", m->label_name);
+            put_escaped(&o, m->label_value, false);
+            put(&o, "\"}");
+        }
+        put(&o, " ");
+        put_prometheus_number(&o, m->value, 15);
+        put(&o, "\n");
+    }
+    put_family(&o, "status_dropped", "Readings and metrics that did not fit the snapshot", "gauge");
+    put(&o, "mirror_status_dropped %u\n", snap->dropped);
+    return o.at;
+}
@@ -0,0 +1,141 @@
+#ifndef STATUS_METRICS_H
+#define STATUS_METRICS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATUS_ROLLUP_BUCKETS 60                                                                            /*!< One hour of one-minute buckets */
+#define STATUS_ROLLUP_BUCKET_S 60
+#define STATUS_MAX_READINGS 8
+#define STATUS_MAX_METRICS 64
+#define STATUS_LABEL_LEN 16                                                                                 /*!< configMAX_TASK_NAME_LEN, the longest label value copied */
+
+/**
+ * @brief Minimum, mean and maximum of the samples of one minute
+ */
+typedef struct {
+    uint32_t minute;                                                                                        /*!< Since the time base of the samples; the bucket is empty unless it matches */
+    uint32_t count;
+    float min;
+    float max;
+    float sum;
+} status_rollup_bucket_t;
+
+/**
+ * @brief History of one reading: the last hour in one-minute buckets, a fixed 1.2 KB whatever the sample rate
+ */
+typedef struct {
+    status_rollup_bucket_t bucket[STATUS_ROLLUP_BUCKETS];
+} status_rollup_t;
+
+typedef enum {
+    STATUS_WINDOW_5M,
+    STATUS_WINDOW_1H,
+    STATUS_WINDOW_COUNT,
+} status_window_id_t;
+
+/**
+ * @brief Samples of the reading over a window ending now. count 0: no samples, the rest is undefined.
+ */
+typedef struct {
+    float min;
+    float avg;
+    float max;
+    uint32_t count;
+} status_window_t;
+
+/**
+ * @brief One sensor reading, as on the display, with its history
+ */
+typedef struct {
+    const char *name;                                                                                       /*!< "temperature", also the Prometheus label value */
+    const char *unit;                                                                                       /*!< "celsius" */
+    float value;
+    bool valid;                                                                                             /*!< There was a good reading */
+    bool stale;                                                                                             /*!< The last read failed, value is older */
+    status_window_t window[STATUS_WINDOW_COUNT];
+} status_reading_t;
+
+typedef enum {
+    STATUS_METRIC_GAUGE,
+    STATUS_METRIC_COUNTER,                                                                                  /*!< Name ends in _total */
+} status_metric_type_t;
+
+/**
+ * @brief One internal metric with at most one label, e.g. i2c_nack_total{device="bme280"}
+ *
+ * Metrics of the same name must be added one after another, the Prometheus text gives HELP and TYPE once per name.
+ */
+typedef struct {
+    const char *name;                                                                                       /*!< Without the "mirror_" prefix */
+    const char *help;
+    const char *label_name;                                                                                 /*!< NULL without a label */
+    char label_value[STATUS_LABEL_LEN];
+    uint8_t type;                                                                                           /*!< status_metric_type_t */
+    double value;
+} status_metric_t;
+
+/**
+ * @brief Everything the status endpoint shows, filled by the task that owns the readings
+ */
+typedef struct {
+    uint32_t uptime_s;
+    uint8_t reading_count;
+    uint8_t metric_count;
+    uint16_t dropped;                                                                                       /*!< Readings and metrics that did not fit */
+    status_reading_t readings[STATUS_MAX_READINGS];
+    status_metric_t metrics[STATUS_MAX_METRICS];
+} status_snapshot_t;
+
+/**
+ * @brief Add a sample taken at now_s (seconds on any monotonic time base)
+ */
+void status_rollup_add(status_rollup_t *rollup, uint32_t now_s, float value);
+
+/**
+ * @brief Samples of the last window_s seconds, the current minute included, in whole minutes
+ */
+void status_rollup_window(const status_rollup_t *rollup, uint32_t now_s, uint32_t window_s, status_window_t *out);
+
+void status_snapshot_reset(status_snapshot_t *snap, uint32_t uptime_s);
+
+/**
+ * @brief Add a reading; its windows come from rollup, which may be NULL
+ *
+ * @return false if the snapshot is full
+ */
+bool status_snapshot_reading(status_snapshot_t *snap, const char *name, const char *unit, float value, bool valid,
+                             bool stale, const status_rollup_t *rollup);
+
+/**
+ * @brief Add a metric. name, help and label_name must outlive the snapshot, label_value is copied (and cut).
+ *
+ * @return false if the snapshot is full
+ */
+bool status_snapshot_metric(status_snapshot_t *snap, const char *name, const char *help, status_metric_type_t type,
+                            const char *label_name, const char *label_value, double value);
+
+/**
+ * @brief The snapshot as a JSON document
+ *
+ * @return Length of the whole document, as snprintf: if it is not less than len, buf holds a cut (terminated) one
+ */
+size_t status_format_json(const status_snapshot_t *snap, char *buf, size_t len);
+
+/**
+ * @brief The snapshot in the Prometheus text exposition format (version 0.0.4)
+ *
+ * @return Length of the whole text, as snprintf
+ */
+size_t status_format_prometheus(const status_snapshot_t *snap, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "status_server.h"
+
+#define TAG "STATUS"
+
+#define MAX_TASKS 24
+
+/**
+ * @brief One formatted generation of both documents
+ */
+typedef struct {
+    char *json;
+    char *prometheus;
+    size_t json_used;
+    size_t prometheus_used;
+    uint8_t readers;                                                                                        /*!< Responses being sent from it */
+} status_buffers_t;
+
+static status_server_config_t s_config;
+static httpd_handle_t s_server;
+static SemaphoreHandle_t s_lock; // s_front, readers and s_stats; held for a few instructions, never while sending
+static status_buffers_t s_buffers[2];
+static int s_front = -1; // Served by requests, -1 before the first publish; the other one is formatted into
+static status_server_stats_t s_stats;
+
+static esp_err_t send_document(httpd_req_t *req, bool json)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int idx = s_front;
+    s_stats.requests++;
+    if (idx >= 0) {
+        s_buffers[idx].readers++;
+    }
+    xSemaphoreGive(s_lock);
+    if (idx < 0) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, "no snapshot yet\n", HTTPD_RESP_USE_STRLEN);
+    }
+
+    const status_buffers_t *b = &s_buffers[idx];
+    httpd_resp_set_type(req, json ? "application/json" : "text/plain; version=0.0.4; charset=utf-8");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t ret = json ? httpd_resp_send(req, b->json, b->json_used)
+                         : httpd_resp_send(req, b->prometheus, b->prometheus_used);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_buffers[idx].readers--;
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+static esp_err_t get_status(httpd_req_t *req)
+{
+    return send_document(req, true);
+}
+
+static esp_err_t get_metrics(httpd_req_t *req)
+{
+    return send_document(req, false);
+}
+
+esp_err_t status_server_start(const status_server_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->json_len && config->prometheus_len, ESP_ERR_INVALID_ARG, TAG, "bad config");
+    ESP_RETURN_ON_FALSE(!s_server, ESP_ERR_INVALID_STATE, TAG, "already started");
+    s_config = *config;
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(s_lock, ESP_ERR_NO_MEM, TAG, "no memory for the lock");
+    }
+    for (int i = 0; i < 2; i++) {
+        if (!s_buffers[i].json) {
+            s_buffers[i].json = malloc(config->json_len);
+            s_buffers[i].prometheus = malloc(config->prometheus_len);
+        }
+        ESP_RETURN_ON_FALSE(s_buffers[i].json && s_buffers[i].prometheus, ESP_ERR_NO_MEM, TAG, "no memory for buffers");
+    }
+
+    httpd_config_t httpd_conf = HTTPD_DEFAULT_CONFIG();
+    httpd_conf.server_port = config->port;
+    httpd_conf.ctrl_port = config->ctrl_port;
+    // One more than a scraper and a status page need, a screen stream (status_server_register) keeps its socket open
+    httpd_conf.max_open_sockets = 4;
+    // A scraper that never closes must not lock the next one out; core 0 with the network stack, away from rendering
+    httpd_conf.lru_purge_enable = true;
+    httpd_conf.core_id = 0;
+    ESP_RETURN_ON_ERROR(httpd_start(&s_server, &httpd_conf), TAG, "server on port %u", config->port);
+
+    static const httpd_uri_t status_uri = { .uri = "/status", .method = HTTP_GET, .handler = get_status };
+    static const httpd_uri_t metrics_uri = { .uri = "/metrics", .method = HTTP_GET, .handler = get_metrics };
+    httpd_register_uri_handler(s_server, &status_uri);
+    httpd_register_uri_handler(s_server, &metrics_uri);
+    ESP_LOGI(TAG, "http://<address>:%u/status and /metrics", config->port);
+    return ESP_OK;
+}
+
+esp_err_t status_server_register(const httpd_uri_t *uri)
+{
+    ESP_RETURN_ON_FALSE(s_server, ESP_ERR_INVALID_STATE, TAG, "not started");
+    return httpd_register_uri_handler(s_server, uri);
+}
+
+void status_server_add_system_metrics(status_snapshot_t *snap)
+{
+    status_snapshot_metric(snap, "heap_free_bytes", "Free heap", STATUS_METRIC_GAUGE, NULL, NULL,
+                           heap_caps_get_free_size(MALLOC_CAP_DEFAULT));
+    status_snapshot_metric(snap, "heap_min_free_bytes", "Least free heap since boot", STATUS_METRIC_GAUGE, NULL, NULL,
+                           heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+    status_snapshot_metric(snap, "heap_largest_free_block_bytes", "Largest block that can be allocated",
+                           STATUS_METRIC_GAUGE, NULL, NULL, heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // Only the publishing task gets here, the table need not be on its stack
+    static TaskStatus_t tasks[MAX_TASKS];
+    UBaseType_t count = uxTaskGetSystemState(tasks, MAX_TASKS, NULL);
+    for (UBaseType_t i = 0; i < count; i++) {
+        // The high water mark is in bytes on ESP-IDF, StackType_t is a byte
+        status_snapshot_metric(snap, "task_stack_free_bytes", "Least free stack of the task since it started",
+                               STATUS_METRIC_GAUGE, "task", tasks[i].pcTaskName, tasks[i].usStackHighWaterMark);
+    }
+#endif
+}
+
+esp_err_t status_server_publish(const status_snapshot_t *snap)
+{
+    if (!s_server) {
+        return ESP_ERR_INVALID_STATE; // Quietly: without Wi-Fi the snapshot is simply not served
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int back = s_front == 0 ? 1 : 0;
+    bool busy = s_buffers[back].readers > 0;
+    s_stats.publishes++;
+    if (busy) {
+        s_stats.publish_busy++;
+    }
+    xSemaphoreGive(s_lock);
+    if (busy) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // No request gets the back buffers until they are swapped in, formatting needs no lock
+    status_buffers_t *b = &s_buffers[back];
+    b->json_used = status_format_json(snap, b->json, s_config.json_len);
+    b->prometheus_used = status_format_prometheus(snap, b->prometheus, s_config.prometheus_len);
+    bool fits = b->json_used < s_config.json_len && b->prometheus_used < s_config.prometheus_len;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (fits) {
+        s_front = back;
+        s_stats.json_used = b->json_used;
+        s_stats.prometheus_used = b->prometheus_used;
+    } else {
+        s_stats.truncated++;
+    }
+    xSemaphoreGive(s_lock);
+    if (!fits) {
+        ESP_LOGW(TAG, "snapshot needs %u B of JSON and %u B of text, buffers are %u and %u", (unsigned)b->json_used,
+                 (unsigned)b->prometheus_used, (unsigned)s_config.json_len, (unsigned)s_config.prometheus_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+void status_server_get_stats(status_server_stats_t *stats)
+{
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,84 @@
+#ifndef STATUS_SERVER_H
+#define STATUS_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "status_metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Server configuration
+ */
+typedef struct {
+    uint16_t port;                                                                                          /*!< Not 80, the Wi-Fi provisioning form may be there */
+    uint16_t ctrl_port;                                                                                     /*!< Of esp_http_server, unique per server */
+    size_t json_len;                                                                                        /*!< Each of the two JSON buffers */
+    size_t prometheus_len;                                                                                  /*!< Each of the two Prometheus buffers */
+} status_server_config_t;
+
+#define STATUS_SERVER_DEFAULT_CONFIG() {                                                                    \
+    .port = 8080,                                                                                           \
+    .ctrl_port = 32770,                                                                                     \
+    .json_len = 6144,                                                                                       \
+    .prometheus_len = 10240,                                                                                \
+}
+
+/**
+ * @brief Server counters, since status_server_start
+ */
+typedef struct {
+    uint32_t requests;
+    uint32_t publishes;
+    uint32_t publish_busy;                                                                                  /*!< Snapshots not swapped in because a response was being sent */
+    uint32_t truncated;                                                                                     /*!< Snapshots that did not fit a buffer */
+    size_t json_used;                                                                                       /*!< Length of the documents served now */
+    size_t prometheus_used;
+} status_server_stats_t;
+
+/**
+ * @brief Start serving GET /status (JSON) and GET /metrics (Prometheus text)
+ *
+ * Responses come from buffers formatted by status_server_publish; a request never waits for the publishing task,
+ * and the publishing task never waits for a request.
+ */
+esp_err_t status_server_start(const status_server_config_t *config);
+
+/**
+ * @brief Serve one more URI on the status port, e.g. for debugging tools. Handlers run in the server task.
+ *
+ * @return ESP_ERR_INVALID_STATE before status_server_start
+ */
+esp_err_t status_server_register(const httpd_uri_t *uri);
+
+/**
+ * @brief Add heap and task stack metrics of this moment: free, least free and largest free block of the heap, free
+ * stack of each task at its worst (needs CONFIG_FREERTOS_USE_TRACE_FACILITY)
+ */
+void status_server_add_system_metrics(status_snapshot_t *snap);
+
+/**
+ * @brief Format a snapshot into the spare buffers and serve them from the next request on
+ *
+ * If a response is being sent from the current buffers, the new ones are not swapped in and the next publish formats
+ * them again.
+ *
+ * @return ESP_ERR_INVALID_STATE before status_server_start; ESP_ERR_INVALID_SIZE if a document did not fit, the
+ * previous one is served; ESP_ERR_TIMEOUT if busy
+ */
+esp_err_t status_server_publish(const status_snapshot_t *snap);
+
+/**
+ * @brief Copy of the counters
+ */
+void status_server_get_stats(status_server_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "wifi_manager.h"
+#include "telemetry.h"
+
+#define TAG "TELEMETRY"
+
+#define SERVICE_PERIOD_MS 1000
+
+static telemetry_publisher_t s_pub; // Only the task touches it
+static QueueHandle_t s_queue;
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_lock; // s_stats
+static telemetry_stats_t s_stats;
+
+static esp_err_t partition_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    return esp_partition_read(ctx, offset, buf, len);
+}
+
+static esp_err_t partition_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    return esp_partition_write(ctx, offset, buf, len);
+}
+
+static esp_err_t partition_erase(void *ctx, uint32_t offset, size_t len)
+{
+    return esp_partition_erase_range(ctx, offset, len);
+}
+
+static void telemetry_task(void *arg)
+{
+    for (;;) {
+        telemetry_sample_t sample;
+        if (xQueueReceive(s_queue, &sample, pdMS_TO_TICKS(SERVICE_PERIOD_MS)) == pdTRUE) {
+            do {
+                telemetry_publisher_add(&s_pub, &sample);
+            } while (xQueueReceive(s_queue, &sample, 0) == pdTRUE);
+        }
+        if (ulTaskNotifyTake(pdTRUE, 0)) {
+            telemetry_publisher_flush(&s_pub);
+        }
+        telemetry_publisher_service(&s_pub, esp_timer_get_time(), wifi_manager_is_connected());
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        telemetry_publisher_get_stats(&s_pub, &s_stats.publisher);
+        xSemaphoreGive(s_lock);
+    }
+}
+
+esp_err_t telemetry_start(const telemetry_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->queue_len && config->publisher.mqtt.host, ESP_ERR_INVALID_ARG, TAG,
+                        "bad config");
+    ESP_RETURN_ON_FALSE(!s_task, ESP_ERR_INVALID_STATE, TAG, "already started");
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           config->partition_label);
+    ESP_RETURN_ON_FALSE(part, ESP_ERR_NOT_FOUND, TAG, "no partition \"%s\"", config->partition_label);
+
+    const telemetry_flash_t flash = {
+        .read = partition_read,
+        .write = partition_write,
+        .erase = partition_erase,
+        .ctx = (void *)part,
+        .size = part->size - part->size % part->erase_size,
+        .sector_size = part->erase_size,
+    };
+    telemetry_publisher_config_t pub_conf = config->publisher;
+    pub_conf.random = esp_random;
+    ESP_RETURN_ON_ERROR(telemetry_publisher_init(&s_pub, &pub_conf, &flash), TAG, "ring in \"%s\"",
+                        config->partition_label);
+
+    s_lock = xSemaphoreCreateMutex();
+    s_queue = xQueueCreate(config->queue_len, sizeof(telemetry_sample_t));
+    ESP_RETURN_ON_FALSE(s_lock && s_queue, ESP_ERR_NO_MEM, TAG, "no memory for the queue");
+    telemetry_publisher_get_stats(&s_pub, &s_stats.publisher);
+    // Core 0 with Wi-Fi and lwIP; the waits for the broker never delay rendering on core 1
+    ESP_RETURN_ON_FALSE(xTaskCreatePinnedToCore(telemetry_task, "telemetry", config->task_stack, NULL,
+                                                tskIDLE_PRIORITY + 1, &s_task, 0) == pdPASS,
+                        ESP_ERR_NO_MEM, TAG, "no memory for the task");
+    ESP_LOGI(TAG, "%s:%u, ring of %u KB, %u batches pending", pub_conf.mqtt.host, pub_conf.mqtt.port,
+             (unsigned)(flash.size / 1024), (unsigned)s_stats.publisher.pending);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_submit(const telemetry_sample_t *sample)
+{
+    if (!s_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(s_queue, sample, 0) != pdTRUE) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        s_stats.queue_drops++;
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+void telemetry_flush(void)
+{
+    if (s_task) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+void telemetry_get_stats(telemetry_stats_t *stats)
+{
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,69 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "telemetry_publisher.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Telemetry configuration. The strings are kept by pointer and must stay valid.
+ */
+typedef struct {
+    const char *partition_label;                                                                            /*!< Data partition of the ring, subtype 0x40 */
+    telemetry_publisher_config_t publisher;
+    uint8_t queue_len;                                                                                      /*!< Samples waiting for the task */
+    uint32_t task_stack;
+} telemetry_config_t;
+
+#define TELEMETRY_DEFAULT_CONFIG() {                                                                        \
+    .partition_label = "telemetry",                                                                         \
+    .publisher = {                                                                                          \
+        .batch_interval_s = 300,                                                                            \
+        .window = TELEMETRY_WINDOW,                                                                         \
+        .retry_min_ms = 2000,                                                                               \
+        .retry_max_ms = 300000,                                                                             \
+        .mqtt = { .port = 1883, .timeout_ms = 5000, .keepalive_s = 120 },                                   \
+    },                                                                                                      \
+    .queue_len = 8,                                                                                         \
+    .task_stack = 6144,                                                                                     \
+}
+
+/**
+ * @brief Telemetry counters
+ */
+typedef struct {
+    telemetry_publisher_stats_t publisher;                                                                  /*!< As of the last pass of the task */
+    uint32_t queue_drops;                                                                                   /*!< Samples not taken because the task was behind */
+} telemetry_stats_t;
+
+/**
+ * @brief Open the ring in the partition and start the publishing task (core 0, with the network stack)
+ */
+esp_err_t telemetry_start(const telemetry_config_t *config);
+
+/**
+ * @brief Hand readings to the task. Never waits: the caller is the display loop.
+ *
+ * @return ESP_ERR_INVALID_STATE before telemetry_start; ESP_ERR_TIMEOUT if the queue is full, the sample is dropped
+ */
+esp_err_t telemetry_submit(const telemetry_sample_t *sample);
+
+/**
+ * @brief Have the task close the open batch and store it, e.g. before a sleep
+ */
+void telemetry_flush(void);
+
+/**
+ * @brief Copy of the counters
+ */
+void telemetry_get_stats(telemetry_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
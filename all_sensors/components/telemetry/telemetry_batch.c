@@ -0,0 +1,82 @@
+#include <math.h>
+#include "telemetry_batch.h"
+
+static const char *const s_keys[TELEMETRY_CHANNELS] = { "temp", "hum", "press", "lux" };
+static const uint16_t s_scale[TELEMETRY_CHANNELS] = { 100, 10, 10, 1 };
+
+void telemetry_batch_begin(telemetry_batch_t *batch, uint8_t *buf, size_t cap, const char *device_id, uint32_t t0)
+{
+    // One byte kept for the break that ends the rows
+    telemetry_cbor_init(&batch->cbor, buf, cap ? cap - 1 : 0);
+    batch->t0 = t0;
+    batch->last_time = t0;
+    batch->rows = 0;
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        batch->last[ch] = 0;
+    }
+
+    telemetry_cbor_t *c = &batch->cbor;
+    telemetry_cbor_map(c, 6);
+    telemetry_cbor_text(c, "v");
+    telemetry_cbor_uint(c, 1);
+    telemetry_cbor_text(c, "id");
+    telemetry_cbor_text(c, device_id);
+    telemetry_cbor_text(c, "t");
+    telemetry_cbor_uint(c, t0);
+    telemetry_cbor_text(c, "k");
+    telemetry_cbor_array(c, TELEMETRY_CHANNELS);
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        telemetry_cbor_text(c, s_keys[ch]);
+    }
+    telemetry_cbor_text(c, "q");
+    telemetry_cbor_array(c, TELEMETRY_CHANNELS);
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        telemetry_cbor_uint(c, s_scale[ch]);
+    }
+    telemetry_cbor_text(c, "r");
+    telemetry_cbor_array_open(c);
+}
+
+bool telemetry_batch_add(telemetry_batch_t *batch, const telemetry_sample_t *sample)
+{
+    telemetry_cbor_t *c = &batch->cbor;
+    if (c->overflow) {
+        return false;
+    }
+    size_t mark = c->len;
+    int32_t q[TELEMETRY_CHANNELS];
+    telemetry_cbor_array(c, 1 + TELEMETRY_CHANNELS);
+    telemetry_cbor_int(c, (int64_t)sample->time - batch->last_time);
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        float v = sample->value[ch];
+        if (!(sample->valid & 1 << ch) || !isfinite(v)) {
+            telemetry_cbor_null(c);
+            q[ch] = batch->last[ch];
+            continue;
+        }
+        q[ch] = lroundf(v * s_scale[ch]);
+        telemetry_cbor_int(c, (int64_t)q[ch] - batch->last[ch]);
+    }
+    if (c->overflow) {
+        c->len = mark;
+        c->overflow = false;
+        return false;
+    }
+    batch->last_time = sample->time;
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        batch->last[ch] = q[ch];
+    }
+    batch->rows++;
+    return true;
+}
+
+size_t telemetry_batch_finish(telemetry_batch_t *batch)
+{
+    telemetry_cbor_t *c = &batch->cbor;
+    if (c->overflow) {
+        return 0;
+    }
+    c->cap++;
+    telemetry_cbor_break(c);
+    return c->len;
+}
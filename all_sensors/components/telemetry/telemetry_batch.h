@@ -0,0 +1,67 @@
+#ifndef TELEMETRY_BATCH_H
+#define TELEMETRY_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "telemetry_cbor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    TELEMETRY_TEMP,                                                                                         /*!< °C, sent in 0.01 */
+    TELEMETRY_HUM,                                                                                          /*!< %, sent in 0.1 */
+    TELEMETRY_PRESS,                                                                                        /*!< hPa, sent in 0.1 */
+    TELEMETRY_LUX,                                                                                          /*!< lx, sent in 1 */
+    TELEMETRY_CHANNELS,
+} telemetry_channel_t;
+
+/**
+ * @brief Readings of one moment
+ */
+typedef struct {
+    uint32_t time;                                                                                          /*!< Unix time, s */
+    float value[TELEMETRY_CHANNELS];
+    uint8_t valid;                                                                                          /*!< Bit per telemetry_channel_t; the others are sent as null */
+} telemetry_sample_t;
+
+/**
+ * @brief Batch payload being built
+ *
+ * One CBOR map per batch:
+ *
+ *     { "v": 1, "id": "<device>", "t": <unix time of the first row>,
+ *       "k": ["temp", "hum", "press", "lux"], "q": [100, 10, 10, 1],
+ *       "r": [_ [dt, d0, d1, d2, d3], ... ] }
+ *
+ * Each row holds the change from the row before it. dt is in seconds, the first row's dt is from "t". Each d is the
+ * change of the reading multiplied by its "q", from the last row where that channel was not null; a channel's first
+ * value is taken from 0. A row of unchanged readings a minute after the last one is seven bytes.
+ */
+typedef struct {
+    telemetry_cbor_t cbor;
+    uint32_t t0;
+    uint32_t last_time;
+    int32_t last[TELEMETRY_CHANNELS];
+    uint16_t rows;
+} telemetry_batch_t;
+
+void telemetry_batch_begin(telemetry_batch_t *batch, uint8_t *buf, size_t cap, const char *device_id, uint32_t t0);
+
+/**
+ * @return false if the row did not fit: the batch is as it was, finish it and put the sample in the next one
+ */
+bool telemetry_batch_add(telemetry_batch_t *batch, const telemetry_sample_t *sample);
+
+/**
+ * @return Payload length, 0 if not even the header fitted
+ */
+size_t telemetry_batch_finish(telemetry_batch_t *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
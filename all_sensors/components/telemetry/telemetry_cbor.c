@@ -0,0 +1,111 @@
+#include <string.h>
+#include "telemetry_cbor.h"
+
+enum {
+    MAJOR_UINT = 0,
+    MAJOR_NINT = 1,
+    MAJOR_TEXT = 3,
+    MAJOR_ARRAY = 4,
+    MAJOR_MAP = 5,
+    MAJOR_SIMPLE = 7,
+};
+
+static void put(telemetry_cbor_t *c, const void *data, size_t len)
+{
+    if (c->overflow || c->len + len > c->cap) {
+        c->overflow = true;
+        return;
+    }
+    memcpy(c->buf + c->len, data, len);
+    c->len += len;
+}
+
+// Head of an item: major type and its argument in the shortest form
+static void head(telemetry_cbor_t *c, uint8_t major, uint64_t arg)
+{
+    uint8_t b[9];
+    size_t n;
+    if (arg < 24) {
+        b[0] = major << 5 | arg;
+        n = 1;
+    } else if (arg <= UINT8_MAX) {
+        b[0] = major << 5 | 24;
+        b[1] = arg;
+        n = 2;
+    } else if (arg <= UINT16_MAX) {
+        b[0] = major << 5 | 25;
+        b[1] = arg >> 8;
+        b[2] = arg;
+        n = 3;
+    } else if (arg <= UINT32_MAX) {
+        b[0] = major << 5 | 26;
+        for (int i = 0; i < 4; i++) {
+            b[1 + i] = arg >> (24 - 8 * i);
+        }
+        n = 5;
+    } else {
+        b[0] = major << 5 | 27;
+        for (int i = 0; i < 8; i++) {
+            b[1 + i] = arg >> (56 - 8 * i);
+        }
+        n = 9;
+    }
+    put(c, b, n);
+}
+
+void telemetry_cbor_init(telemetry_cbor_t *c, uint8_t *buf, size_t cap)
+{
+    c->buf = buf;
+    c->cap = cap;
+    c->len = 0;
+    c->overflow = false;
+}
+
+void telemetry_cbor_uint(telemetry_cbor_t *c, uint64_t v)
+{
+    head(c, MAJOR_UINT, v);
+}
+
+void telemetry_cbor_int(telemetry_cbor_t *c, int64_t v)
+{
+    if (v >= 0) {
+        head(c, MAJOR_UINT, v);
+    } else {
+        head(c, MAJOR_NINT, -1 - v);
+    }
+}
+
+void telemetry_cbor_text(telemetry_cbor_t *c, const char *s)
+{
+    size_t len = strlen(s);
+    head(c, MAJOR_TEXT, len);
+    put(c, s, len);
+}
+
+void telemetry_cbor_array(telemetry_cbor_t *c, uint32_t items)
+{
+    head(c, MAJOR_ARRAY, items);
+}
+
+void telemetry_cbor_map(telemetry_cbor_t *c, uint32_t pairs)
+{
+    head(c, MAJOR_MAP, pairs);
+}
+
+void telemetry_cbor_array_open(telemetry_cbor_t *c)
+{
+    uint8_t b = MAJOR_ARRAY << 5 | 31;
+    put(c, &b, 1);
+}
+
+void telemetry_cbor_break(telemetry_cbor_t *c)
+{
+    uint8_t b = 0xFF;
+    put(c, &b, 1);
+}
+
+void telemetry_cbor_null(telemetry_cbor_t *c)
+{
+    uint8_t b = MAJOR_SIMPLE << 5 | 22;
+    put(c, &b, 1);
+}
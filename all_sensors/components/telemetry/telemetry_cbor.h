@@ -0,0 +1,36 @@
+#ifndef TELEMETRY_CBOR_H
+#define TELEMETRY_CBOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief CBOR (RFC 8949) writer into a fixed buffer: the few item kinds telemetry payloads use
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;                                                                                          /*!< Something did not fit, buf is not a valid item */
+} telemetry_cbor_t;
+
+void telemetry_cbor_init(telemetry_cbor_t *c, uint8_t *buf, size_t cap);
+void telemetry_cbor_uint(telemetry_cbor_t *c, uint64_t v);
+void telemetry_cbor_int(telemetry_cbor_t *c, int64_t v);
+void telemetry_cbor_text(telemetry_cbor_t *c, const char *s);
+void telemetry_cbor_array(telemetry_cbor_t *c, uint32_t items);
+void telemetry_cbor_map(telemetry_cbor_t *c, uint32_t pairs);
+void telemetry_cbor_array_open(telemetry_cbor_t *c);                                                        /*!< Indefinite length, ended by telemetry_cbor_break */
+void telemetry_cbor_break(telemetry_cbor_t *c);
+void telemetry_cbor_null(telemetry_cbor_t *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
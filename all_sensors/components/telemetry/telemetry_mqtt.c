@@ -0,0 +1,261 @@
+#include <string.h>
+#include "esp_log.h"
+#include "telemetry_mqtt.h"
+
+#define TAG "MQTT"
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_DISCONNECT 0xE0
+
+#define FLAG_USERNAME 0x80
+#define FLAG_PASSWORD 0x40
+#define FLAG_WILL_RETAIN 0x20
+#define FLAG_WILL_QOS1 0x08
+#define FLAG_WILL 0x04
+#define FLAG_CLEAN_SESSION 0x02
+
+#define HEADER_MAX 5                                                                                        /*!< Type byte and up to four bytes of remaining length */
+#define CONNECT_MAX 320
+
+static const data_fetch_transport_t *transport(const telemetry_mqtt_t *mqtt)
+{
+    return mqtt->config.transport ? mqtt->config.transport : &data_fetch_transport_tcp;
+}
+
+static size_t put_header(uint8_t *p, uint8_t type, size_t remaining)
+{
+    size_t n = 0;
+    p[n++] = type;
+    do {
+        uint8_t byte = remaining & 0x7F;
+        remaining >>= 7;
+        p[n++] = byte | (remaining ? 0x80 : 0);
+    } while (remaining);
+    return n;
+}
+
+static size_t put_string(uint8_t *p, const char *s)
+{
+    size_t len = strlen(s);
+    p[0] = len >> 8;
+    p[1] = len & 0xFF;
+    memcpy(p + 2, s, len);
+    return 2 + len;
+}
+
+static esp_err_t send_all(telemetry_mqtt_t *mqtt, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len) {
+        int n = transport(mqtt)->send(mqtt->conn, p, len);
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t recv_all(telemetry_mqtt_t *mqtt, void *buf, size_t len, bool first)
+{
+    uint8_t *p = buf;
+    while (len) {
+        int n = transport(mqtt)->recv(mqtt->conn, p, len);
+        if (n == DATA_FETCH_RECV_TIMEOUT && first && p == buf) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        p += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+// Next packet: its type byte, and up to cap bytes of what follows, the rest is read and skipped
+static esp_err_t recv_packet(telemetry_mqtt_t *mqtt, uint8_t *type, uint8_t *body, size_t cap, size_t *len)
+{
+    esp_err_t ret = recv_all(mqtt, type, 1, true);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t remaining = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte;
+        if (shift > 21 || recv_all(mqtt, &byte, 1, false) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        remaining |= (size_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    *len = remaining < cap ? remaining : cap;
+    if (recv_all(mqtt, body, *len, false) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    for (remaining -= *len; remaining;) {
+        uint8_t skip[16];
+        size_t n = remaining < sizeof(skip) ? remaining : sizeof(skip);
+        if (recv_all(mqtt, skip, n, false) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        remaining -= n;
+    }
+    return ESP_OK;
+}
+
+void telemetry_mqtt_init(telemetry_mqtt_t *mqtt, const telemetry_mqtt_config_t *config)
+{
+    memset(mqtt, 0, sizeof(*mqtt));
+    mqtt->config = *config;
+    mqtt->next_id = 1;
+}
+
+esp_err_t telemetry_mqtt_connect(telemetry_mqtt_t *mqtt)
+{
+    const telemetry_mqtt_config_t *cfg = &mqtt->config;
+    uint8_t flags = FLAG_CLEAN_SESSION;
+    size_t remaining = 10 + 2 + strlen(cfg->client_id);
+    if (cfg->will_topic) {
+        flags |= FLAG_WILL | FLAG_WILL_QOS1 | FLAG_WILL_RETAIN;
+        remaining += 2 + strlen(cfg->will_topic) + 2 + strlen("offline");
+    }
+    if (cfg->username) {
+        flags |= FLAG_USERNAME;
+        remaining += 2 + strlen(cfg->username);
+    }
+    if (cfg->password) {
+        flags |= FLAG_PASSWORD;
+        remaining += 2 + strlen(cfg->password);
+    }
+    if (remaining + HEADER_MAX > CONNECT_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t pkt[CONNECT_MAX];
+    size_t n = put_header(pkt, MQTT_CONNECT, remaining);
+    n += put_string(pkt + n, "MQTT");
+    pkt[n++] = 4; // 3.1.1
+    pkt[n++] = flags;
+    pkt[n++] = cfg->keepalive_s >> 8;
+    pkt[n++] = cfg->keepalive_s & 0xFF;
+    n += put_string(pkt + n, cfg->client_id);
+    if (cfg->will_topic) {
+        n += put_string(pkt + n, cfg->will_topic);
+        n += put_string(pkt + n, "offline");
+    }
+    if (cfg->username) {
+        n += put_string(pkt + n, cfg->username);
+    }
+    if (cfg->password) {
+        n += put_string(pkt + n, cfg->password);
+    }
+
+    telemetry_mqtt_disconnect(mqtt, false);
+    esp_err_t ret = transport(mqtt)->connect(&mqtt->conn, cfg->host, cfg->port, cfg->timeout_ms);
+    if (ret != ESP_OK) {
+        mqtt->conn = NULL;
+        return ret;
+    }
+    ret = send_all(mqtt, pkt, n);
+    uint8_t type = 0, ack[2] = { 0 };
+    size_t len = 0;
+    if (ret == ESP_OK) {
+        ret = recv_packet(mqtt, &type, ack, sizeof(ack), &len);
+    }
+    if (ret == ESP_OK && (type != MQTT_CONNACK || len != 2 || ack[1] != 0)) {
+        ESP_LOGW(TAG, "%s:%u refused the connection (%02x, code %u)", cfg->host, cfg->port, type, ack[1]);
+        ret = ESP_ERR_INVALID_RESPONSE;
+    }
+    if (ret != ESP_OK) {
+        telemetry_mqtt_disconnect(mqtt, false);
+    }
+    return ret;
+}
+
+esp_err_t telemetry_mqtt_publish(telemetry_mqtt_t *mqtt, const char *topic, const void *payload, size_t len,
+                                 uint8_t qos, bool retain, uint16_t *id)
+{
+    if (!mqtt->conn) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t topic_len = strlen(topic);
+    if (topic_len > TELEMETRY_MQTT_TOPIC_MAX || len > TELEMETRY_MQTT_PAYLOAD_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // One write: a header sent apart would hold the payload back until it is acknowledged (Nagle)
+    uint8_t pkt[HEADER_MAX + 2 + TELEMETRY_MQTT_TOPIC_MAX + 2 + TELEMETRY_MQTT_PAYLOAD_MAX];
+    uint16_t packet_id = 0;
+    size_t remaining = 2 + topic_len + (qos ? 2 : 0) + len;
+    size_t n = put_header(pkt, MQTT_PUBLISH | (qos ? 0x02 : 0) | (retain ? 0x01 : 0), remaining);
+    n += put_string(pkt + n, topic);
+    if (qos) {
+        packet_id = mqtt->next_id;
+        mqtt->next_id = mqtt->next_id == 0xFFFF ? 1 : mqtt->next_id + 1;
+        pkt[n++] = packet_id >> 8;
+        pkt[n++] = packet_id & 0xFF;
+    }
+    memcpy(pkt + n, payload, len);
+    esp_err_t ret = send_all(mqtt, pkt, n + len);
+    if (ret != ESP_OK) {
+        telemetry_mqtt_disconnect(mqtt, false);
+        return ret;
+    }
+    if (id) {
+        *id = packet_id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t telemetry_mqtt_ping(telemetry_mqtt_t *mqtt)
+{
+    if (!mqtt->conn) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const uint8_t pkt[] = { MQTT_PINGREQ, 0 };
+    esp_err_t ret = send_all(mqtt, pkt, sizeof(pkt));
+    if (ret != ESP_OK) {
+        telemetry_mqtt_disconnect(mqtt, false);
+    }
+    return ret;
+}
+
+esp_err_t telemetry_mqtt_poll(telemetry_mqtt_t *mqtt, uint16_t *acked)
+{
+    if (!mqtt->conn) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t type, body[2];
+    size_t len;
+    esp_err_t ret = recv_packet(mqtt, &type, body, sizeof(body), &len);
+    if (ret == ESP_ERR_TIMEOUT) {
+        return ret;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Connection lost");
+        telemetry_mqtt_disconnect(mqtt, false);
+        return ESP_FAIL;
+    }
+    *acked = (type & 0xF0) == MQTT_PUBACK && len == 2 ? body[0] << 8 | body[1] : 0;
+    return ESP_OK;
+}
+
+void telemetry_mqtt_disconnect(telemetry_mqtt_t *mqtt, bool graceful)
+{
+    if (!mqtt->conn) {
+        return;
+    }
+    if (graceful) {
+        const uint8_t pkt[] = { MQTT_DISCONNECT, 0 };
+        send_all(mqtt, pkt, sizeof(pkt));
+    }
+    transport(mqtt)->close(mqtt->conn);
+    mqtt->conn = NULL;
+}
@@ -0,0 +1,76 @@
+#ifndef TELEMETRY_MQTT_H
+#define TELEMETRY_MQTT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "data_fetch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_MQTT_TOPIC_MAX 96
+#define TELEMETRY_MQTT_PAYLOAD_MAX 640                                                                      /*!< A publish is built on the stack, to go out in one write */
+
+/**
+ * @brief Broker and session
+ */
+typedef struct {
+    const char *host;
+    uint16_t port;                                                                                          /*!< 1883, or 8883 with data_fetch_transport_tls */
+    const data_fetch_transport_t *transport;                                                                /*!< NULL: data_fetch_transport_tcp */
+    uint32_t timeout_ms;                                                                                    /*!< Connect, and the wait for each answer */
+    const char *client_id;
+    const char *username;                                                                                   /*!< NULL: none */
+    const char *password;
+    const char *will_topic;                                                                                 /*!< Retained "offline" from the broker when the link is lost, NULL: none */
+    uint16_t keepalive_s;
+} telemetry_mqtt_config_t;
+
+/**
+ * @brief MQTT 3.1.1 client: publishes at QoS 0 or 1, subscribes to nothing
+ */
+typedef struct {
+    telemetry_mqtt_config_t config;
+    void *conn;                                                                                             /*!< NULL when disconnected */
+    uint16_t next_id;
+} telemetry_mqtt_t;
+
+void telemetry_mqtt_init(telemetry_mqtt_t *mqtt, const telemetry_mqtt_config_t *config);
+
+/**
+ * @brief Open a clean session and wait for the broker to accept it
+ *
+ * @return ESP_ERR_INVALID_RESPONSE if the broker refused (bad credentials, client id) or did not speak MQTT
+ */
+esp_err_t telemetry_mqtt_connect(telemetry_mqtt_t *mqtt);
+
+/**
+ * @param[out] id Packet id a QoS 1 publish is acknowledged with, may be NULL for QoS 0
+ * @return ESP_ERR_INVALID_SIZE if the topic or the payload is too long
+ */
+esp_err_t telemetry_mqtt_publish(telemetry_mqtt_t *mqtt, const char *topic, const void *payload, size_t len,
+                                 uint8_t qos, bool retain, uint16_t *id);
+
+esp_err_t telemetry_mqtt_ping(telemetry_mqtt_t *mqtt);
+
+/**
+ * @brief Wait up to timeout_ms for the next packet from the broker
+ *
+ * @param[out] acked Packet id of a PUBACK, 0 for any other packet
+ * @return ESP_ERR_TIMEOUT if none came; ESP_FAIL if the connection is lost (it is closed)
+ */
+esp_err_t telemetry_mqtt_poll(telemetry_mqtt_t *mqtt, uint16_t *acked);
+
+/**
+ * @param graceful Send DISCONNECT first, so the broker does not publish the will
+ */
+void telemetry_mqtt_disconnect(telemetry_mqtt_t *mqtt, bool graceful);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,229 @@
+#include <string.h>
+#include "esp_log.h"
+#include "telemetry_publisher.h"
+
+#define TAG "TELEMETRY"
+
+#define SERVICE_ACKS 32                                                                                     /*!< Most acknowledgements waited for in one call */
+
+_Static_assert(TELEMETRY_BATCH_LEN <= TELEMETRY_MQTT_PAYLOAD_MAX, "a batch goes in one publish");
+
+esp_err_t telemetry_publisher_init(telemetry_publisher_t *pub, const telemetry_publisher_config_t *config,
+                                   const telemetry_flash_t *flash)
+{
+    if (!config->device_id || !config->topic || !config->batch_interval_s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(pub, 0, sizeof(*pub));
+    pub->config = *config;
+    if (pub->config.window < 1 || pub->config.window > TELEMETRY_WINDOW) {
+        pub->config.window = TELEMETRY_WINDOW;
+    }
+    esp_err_t ret = telemetry_ring_open(&pub->ring, flash);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    pub->cursor = pub->ring.tail;
+
+    telemetry_mqtt_config_t mqtt = config->mqtt;
+    mqtt.client_id = config->device_id;
+    mqtt.will_topic = config->status_topic;
+    telemetry_mqtt_init(&pub->mqtt, &mqtt);
+    wifi_manager_backoff_init(&pub->backoff, config->retry_min_ms, config->retry_max_ms);
+    if (pub->ring.pending || pub->ring.stats.corrupt) {
+        ESP_LOGI(TAG, "%u batches left to send, %u broken", (unsigned)pub->ring.pending,
+                 (unsigned)pub->ring.stats.corrupt);
+    }
+    return ESP_OK;
+}
+
+// Publishing starts again from the oldest unsent batch; acknowledgements still on the way are ignored
+static void restart_from_tail(telemetry_publisher_t *pub)
+{
+    pub->inflight_count = 0;
+    pub->cursor = pub->ring.tail;
+}
+
+static void close_batch(telemetry_publisher_t *pub)
+{
+    pub->batch_open = false;
+    size_t len = telemetry_batch_finish(&pub->batch);
+    if (!len) {
+        return;
+    }
+    uint32_t dropped = pub->ring.stats.dropped;
+    esp_err_t ret = telemetry_ring_append(&pub->ring, pub->batch_buf, len);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Batch not stored: %s", esp_err_to_name(ret));
+        return;
+    }
+    pub->stats.batches++;
+    if (pub->ring.stats.dropped != dropped) {
+        ESP_LOGW(TAG, "Ring full, %u oldest batches dropped", (unsigned)(pub->ring.stats.dropped - dropped));
+        // The erased sector may have held what is in flight or where the cursor was
+        restart_from_tail(pub);
+    }
+}
+
+static void open_batch(telemetry_publisher_t *pub, uint32_t t0)
+{
+    telemetry_batch_begin(&pub->batch, pub->batch_buf, sizeof(pub->batch_buf), pub->config.device_id, t0);
+    pub->batch_open = true;
+}
+
+void telemetry_publisher_add(telemetry_publisher_t *pub, const telemetry_sample_t *sample)
+{
+    pub->stats.samples++;
+    if (pub->batch_open && sample->time - pub->batch.t0 >= pub->config.batch_interval_s) {
+        close_batch(pub);
+    }
+    if (!pub->batch_open) {
+        open_batch(pub, sample->time);
+    }
+    if (!telemetry_batch_add(&pub->batch, sample)) {
+        close_batch(pub);
+        open_batch(pub, sample->time);
+        telemetry_batch_add(&pub->batch, sample);
+    }
+}
+
+void telemetry_publisher_flush(telemetry_publisher_t *pub)
+{
+    if (pub->batch_open && pub->batch.rows) {
+        close_batch(pub);
+    }
+}
+
+static void drop_connection(telemetry_publisher_t *pub, int64_t now_us)
+{
+    telemetry_mqtt_disconnect(&pub->mqtt, false);
+    restart_from_tail(pub);
+    uint32_t random = pub->config.random ? pub->config.random() : 0;
+    pub->retry_at_us = now_us + (int64_t)wifi_manager_backoff_next(&pub->backoff, random) * 1000;
+}
+
+static bool start_session(telemetry_publisher_t *pub, int64_t now_us)
+{
+    esp_err_t ret = telemetry_mqtt_connect(&pub->mqtt);
+    if (ret != ESP_OK) {
+        pub->stats.connect_failures++;
+        drop_connection(pub, now_us);
+        return false;
+    }
+    pub->stats.connects++;
+    wifi_manager_backoff_reset(&pub->backoff);
+    restart_from_tail(pub);
+    pub->last_tx_us = now_us;
+    if (pub->config.status_topic &&
+        telemetry_mqtt_publish(&pub->mqtt, pub->config.status_topic, "online", 6, 1, true, NULL) != ESP_OK) {
+        drop_connection(pub, now_us);
+        return false;
+    }
+    ESP_LOGI(TAG, "Connected to %s:%u, %u batches to send", pub->config.mqtt.host, pub->config.mqtt.port,
+             (unsigned)pub->ring.pending);
+    return true;
+}
+
+static bool publish_next(telemetry_publisher_t *pub, int64_t now_us)
+{
+    uint32_t pos = pub->cursor, seq, next;
+    size_t len;
+    esp_err_t ret = telemetry_ring_read(&pub->ring, &pos, pub->tx_buf, sizeof(pub->tx_buf), &len, &seq, &next);
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        // Not from this build: nothing to do with it but to skip it
+        return telemetry_ring_mark_sent(&pub->ring, pos, seq) == ESP_OK;
+    }
+    if (ret != ESP_OK) {
+        return false;
+    }
+    uint16_t id;
+    if (telemetry_mqtt_publish(&pub->mqtt, pub->config.topic, pub->tx_buf, len, 1, false, &id) != ESP_OK) {
+        drop_connection(pub, now_us);
+        return false;
+    }
+    pub->inflight[pub->inflight_count++] = (telemetry_inflight_t){ .pos = pos, .seq = seq, .id = id };
+    pub->cursor = next;
+    pub->last_tx_us = now_us;
+    pub->stats.published++;
+    return true;
+}
+
+static void take_ack(telemetry_publisher_t *pub, uint16_t id)
+{
+    for (int i = 0; i < pub->inflight_count; i++) {
+        if (pub->inflight[i].id != id) {
+            continue;
+        }
+        if (telemetry_ring_mark_sent(&pub->ring, pub->inflight[i].pos, pub->inflight[i].seq) == ESP_OK) {
+            pub->stats.acked++;
+        }
+        memmove(&pub->inflight[i], &pub->inflight[i + 1], (pub->inflight_count - i - 1) * sizeof(pub->inflight[0]));
+        pub->inflight_count--;
+        break;
+    }
+    if (!pub->inflight_count) {
+        pub->cursor = pub->ring.tail;
+    }
+}
+
+void telemetry_publisher_service(telemetry_publisher_t *pub, int64_t now_us, bool link_up)
+{
+    if (!link_up) {
+        if (pub->mqtt.conn) {
+            telemetry_mqtt_disconnect(&pub->mqtt, false);
+            restart_from_tail(pub);
+        }
+        return;
+    }
+    if (!pub->mqtt.conn && (now_us < pub->retry_at_us || !start_session(pub, now_us))) {
+        return;
+    }
+
+    // Keep the window full, and wait for acknowledgements only while something is in flight. A long backlog is sent
+    // over several calls, so the caller gets to its queue in between.
+    for (int acks = 0; pub->mqtt.conn && acks < SERVICE_ACKS; acks++) {
+        while (pub->inflight_count < pub->config.window && publish_next(pub, now_us)) {
+        }
+        if (!pub->mqtt.conn) {
+            return;
+        }
+        if (!pub->inflight_count) {
+            break;
+        }
+        uint16_t acked = 0;
+        esp_err_t ret = telemetry_mqtt_poll(&pub->mqtt, &acked);
+        if (ret == ESP_ERR_TIMEOUT) {
+            ESP_LOGW(TAG, "No acknowledgement, reconnecting");
+            pub->stats.ack_timeouts++;
+        }
+        if (ret != ESP_OK) {
+            drop_connection(pub, now_us);
+            return;
+        }
+        take_ack(pub, acked);
+    }
+
+    uint32_t keepalive_s = pub->config.mqtt.keepalive_s;
+    if (pub->mqtt.conn && keepalive_s && now_us - pub->last_tx_us >= (int64_t)keepalive_s * 500000) {
+        uint16_t acked;
+        if (telemetry_mqtt_ping(&pub->mqtt) != ESP_OK || telemetry_mqtt_poll(&pub->mqtt, &acked) != ESP_OK) {
+            ESP_LOGW(TAG, "No answer to ping, reconnecting");
+            drop_connection(pub, now_us);
+            return;
+        }
+        pub->last_tx_us = now_us;
+    }
+}
+
+void telemetry_publisher_stop(telemetry_publisher_t *pub)
+{
+    telemetry_mqtt_disconnect(&pub->mqtt, true);
+    restart_from_tail(pub);
+}
+
+void telemetry_publisher_get_stats(const telemetry_publisher_t *pub, telemetry_publisher_stats_t *stats)
+{
+    *stats = pub->stats;
+    stats->pending = pub->ring.pending;
+    stats->ring = pub->ring.stats;
+}
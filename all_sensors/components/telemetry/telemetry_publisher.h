@@ -0,0 +1,116 @@
+#ifndef TELEMETRY_PUBLISHER_H
+#define TELEMETRY_PUBLISHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "telemetry_batch.h"
+#include "telemetry_mqtt.h"
+#include "telemetry_ring.h"
+#include "wifi_manager_backoff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEMETRY_BATCH_LEN 512                                                                             /*!< Largest payload: about 70 rows of unchanged readings */
+#define TELEMETRY_WINDOW 4                                                                                  /*!< Most batches published and not yet acknowledged */
+
+typedef struct {
+    const char *device_id;                                                                                  /*!< "id" of the payloads, MQTT client id */
+    const char *topic;                                                                                      /*!< Of the batches, "mirrors/<id>/telemetry" */
+    const char *status_topic;                                                                               /*!< Retained "online" / "offline" (will), NULL: none */
+    uint32_t batch_interval_s;                                                                              /*!< A batch is closed when its first sample is this old */
+    uint8_t window;                                                                                         /*!< 1..TELEMETRY_WINDOW */
+    uint32_t retry_min_ms;                                                                                  /*!< Reconnection backoff */
+    uint32_t retry_max_ms;
+    uint32_t (*random)(void);                                                                               /*!< For the backoff, NULL: none */
+    telemetry_mqtt_config_t mqtt;                                                                           /*!< client_id and will_topic are taken from above */
+} telemetry_publisher_config_t;
+
+/**
+ * @brief Publisher counters, since telemetry_publisher_init
+ */
+typedef struct {
+    uint32_t samples;
+    uint32_t batches;                                                                                       /*!< Closed and put in the ring */
+    uint32_t published;                                                                                     /*!< Including those published again after a lost connection */
+    uint32_t acked;
+    uint32_t connects;
+    uint32_t connect_failures;
+    uint32_t ack_timeouts;                                                                                  /*!< Connections dropped for an acknowledgement that did not come */
+    uint32_t pending;                                                                                       /*!< Batches in the ring not acknowledged yet */
+    telemetry_ring_stats_t ring;
+} telemetry_publisher_stats_t;
+
+typedef struct {
+    uint32_t pos;
+    uint32_t seq;
+    uint16_t id;
+} telemetry_inflight_t;
+
+/**
+ * @brief Batches readings and sends them to an MQTT broker, through a flash ring
+ *
+ * Every closed batch is appended to the ring first and published from there at QoS 1; it is marked sent when the
+ * broker acknowledges it. There is thus one path for all batches: while the broker is unreachable they only pile up
+ * in flash, and are sent oldest first once it is back, the RAM in use being the same. When the ring is full the
+ * oldest batches make room. A batch whose acknowledgement was lost with the connection is sent again, so the
+ * consumer may see one twice, it has the same "id" and "t".
+ *
+ * Plain logic over telemetry_flash_t and a data_fetch transport, one task calls everything.
+ */
+typedef struct {
+    telemetry_publisher_config_t config;
+    telemetry_ring_t ring;
+    telemetry_mqtt_t mqtt;
+    telemetry_batch_t batch;
+    bool batch_open;
+    uint8_t batch_buf[TELEMETRY_BATCH_LEN];
+    uint8_t tx_buf[TELEMETRY_BATCH_LEN];
+    telemetry_inflight_t inflight[TELEMETRY_WINDOW];
+    uint8_t inflight_count;
+    uint32_t cursor;                                                                                        /*!< Where the next batch to publish is looked for */
+    wifi_manager_backoff_t backoff;
+    int64_t retry_at_us;
+    int64_t last_tx_us;
+    telemetry_publisher_stats_t stats;
+} telemetry_publisher_t;
+
+/**
+ * @brief Open the ring: batches the last run did not get acknowledged are sent first
+ */
+esp_err_t telemetry_publisher_init(telemetry_publisher_t *pub, const telemetry_publisher_config_t *config,
+                                   const telemetry_flash_t *flash);
+
+/**
+ * @brief Add readings to the open batch, which is closed first if it is full or old enough
+ */
+void telemetry_publisher_add(telemetry_publisher_t *pub, const telemetry_sample_t *sample);
+
+/**
+ * @brief Close the open batch now, e.g. before a sleep
+ */
+void telemetry_publisher_flush(telemetry_publisher_t *pub);
+
+/**
+ * @brief Connect when due, publish from the ring and take acknowledgements. Call about once a second.
+ *
+ * Waits up to mqtt.timeout_ms only while an acknowledgement or a ping answer is due.
+ *
+ * @param link_up The network is usable; while it is not, nothing is tried
+ */
+void telemetry_publisher_service(telemetry_publisher_t *pub, int64_t now_us, bool link_up);
+
+/**
+ * @brief Close the connection, with DISCONNECT so the broker does not publish "offline"
+ */
+void telemetry_publisher_stop(telemetry_publisher_t *pub);
+
+void telemetry_publisher_get_stats(const telemetry_publisher_t *pub, telemetry_publisher_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+#include <stddef.h>
+#include <string.h>
+#include "telemetry_ring.h"
+
+#define RECORD_MAGIC 0x7E1E
+#define STATE_PENDING 0xFFFFFFFFu
+#define STATE_SENT 0u
+#define CHUNK 64
+
+typedef struct {
+    uint16_t magic;
+    uint16_t len;                                                                                           /*!< Of the payload */
+    uint32_t seq;
+    uint32_t crc;                                                                                           /*!< CRC-32 of len, seq and the payload */
+    uint32_t state;                                                                                         /*!< STATE_PENDING as written, cleared to STATE_SENT in place */
+} record_header_t;
+
+_Static_assert(sizeof(record_header_t) == TELEMETRY_RING_HEADER_LEN, "header layout");
+
+static uint32_t crc32(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = crc >> 1 ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t record_size(uint32_t len)
+{
+    return (TELEMETRY_RING_HEADER_LEN + len + 3) & ~3u;
+}
+
+static uint32_t next_sector(const telemetry_ring_t *ring, uint32_t pos)
+{
+    uint32_t ss = ring->flash.sector_size;
+    return (pos - pos % ss + ss) % ring->flash.size;
+}
+
+static uint32_t advance(const telemetry_ring_t *ring, uint32_t pos, const record_header_t *h)
+{
+    return (pos + record_size(h->len)) % ring->flash.size;
+}
+
+// A header that fits its sector, whatever its payload holds
+static bool read_header(const telemetry_ring_t *ring, uint32_t pos, record_header_t *h)
+{
+    uint32_t ss = ring->flash.sector_size;
+    uint32_t in_sector = pos % ss;
+    if (ss - in_sector < TELEMETRY_RING_HEADER_LEN ||
+        ring->flash.read(ring->flash.ctx, pos, h, sizeof(*h)) != ESP_OK) {
+        return false;
+    }
+    return h->magic == RECORD_MAGIC && h->len <= ss - TELEMETRY_RING_HEADER_LEN &&
+           in_sector + record_size(h->len) <= ss;
+}
+
+static bool payload_intact(const telemetry_ring_t *ring, uint32_t pos, const record_header_t *h)
+{
+    uint32_t crc = crc32(0, &h->len, sizeof(h->len));
+    crc = crc32(crc, &h->seq, sizeof(h->seq));
+    uint8_t chunk[CHUNK];
+    for (uint32_t at = 0; at < h->len; at += CHUNK) {
+        uint32_t n = h->len - at < CHUNK ? h->len - at : CHUNK;
+        if (ring->flash.read(ring->flash.ctx, pos + TELEMETRY_RING_HEADER_LEN + at, chunk, n) != ESP_OK) {
+            return false;
+        }
+        crc = crc32(crc, chunk, n);
+    }
+    return crc == h->crc;
+}
+
+static esp_err_t set_state(telemetry_ring_t *ring, uint32_t pos, uint32_t state)
+{
+    return ring->flash.write(ring->flash.ctx, pos + offsetof(record_header_t, state), &state, sizeof(state));
+}
+
+static bool erased_to_sector_end(const telemetry_ring_t *ring, uint32_t pos)
+{
+    uint32_t end = pos - pos % ring->flash.sector_size + ring->flash.sector_size;
+    uint8_t chunk[CHUNK];
+    for (uint32_t at = pos; at < end; at += CHUNK) {
+        uint32_t n = end - at < CHUNK ? end - at : CHUNK;
+        if (ring->flash.read(ring->flash.ctx, at, chunk, n) != ESP_OK) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (chunk[i] != 0xFF) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Move the tail over sent records to the oldest unsent one
+static void settle_tail(telemetry_ring_t *ring)
+{
+    record_header_t h;
+    for (uint32_t steps = 0; ring->pending > 0 && ring->tail != ring->head && steps < ring->flash.size / 4; steps++) {
+        if (!read_header(ring, ring->tail, &h)) {
+            ring->tail = next_sector(ring, ring->tail);
+        } else if (h.state == STATE_PENDING) {
+            return;
+        } else {
+            ring->tail = advance(ring, ring->tail, &h);
+        }
+    }
+    ring->pending = 0;
+    ring->tail = ring->head;
+}
+
+esp_err_t telemetry_ring_open(telemetry_ring_t *ring, const telemetry_flash_t *flash)
+{
+    if (!flash->sector_size || flash->size % flash->sector_size || flash->size / flash->sector_size < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->flash = *flash;
+
+    bool found = false, tail_found = false;
+    uint32_t newest_seq = 0, newest_end = 0, oldest_pending_seq = 0;
+    for (uint32_t sector = 0; sector < flash->size; sector += flash->sector_size) {
+        record_header_t h;
+        for (uint32_t pos = sector; pos < sector + flash->sector_size && read_header(ring, pos, &h);
+             pos += record_size(h.len)) {
+            if (!payload_intact(ring, pos, &h)) {
+                // Cut by a reset while written: out of the way for good
+                ring->stats.corrupt++;
+                if (h.state != STATE_SENT) {
+                    set_state(ring, pos, STATE_SENT);
+                }
+                continue;
+            }
+            if (!found || h.seq > newest_seq) {
+                newest_seq = h.seq;
+                newest_end = pos + record_size(h.len);
+                found = true;
+            }
+            if (h.state == STATE_PENDING) {
+                ring->pending++;
+                if (!tail_found || h.seq < oldest_pending_seq) {
+                    oldest_pending_seq = h.seq;
+                    ring->tail = pos;
+                    tail_found = true;
+                }
+            }
+        }
+    }
+
+    if (found) {
+        ring->next_seq = newest_seq + 1;
+        ring->head = newest_end % flash->size;
+        // Only erased flash can be written after the newest record, anything else starts the next sector
+        if (ring->head % flash->sector_size && !erased_to_sector_end(ring, ring->head)) {
+            ring->head = next_sector(ring, ring->head);
+        }
+    }
+    if (!tail_found) {
+        ring->tail = ring->head;
+    }
+    return ESP_OK;
+}
+
+// Before the sector at pos is erased: its unsent records are lost
+static void drop_sector(telemetry_ring_t *ring, uint32_t sector)
+{
+    record_header_t h;
+    for (uint32_t pos = sector; pos < sector + ring->flash.sector_size && read_header(ring, pos, &h);
+         pos += record_size(h.len)) {
+        if (h.state == STATE_PENDING && ring->pending > 0) {
+            ring->pending--;
+            ring->stats.dropped++;
+        }
+    }
+    // A full ring has its tail on the head, at the start of this sector
+    if (ring->tail - ring->tail % ring->flash.sector_size == sector) {
+        ring->tail = next_sector(ring, sector);
+        settle_tail(ring);
+    }
+}
+
+esp_err_t telemetry_ring_append(telemetry_ring_t *ring, const void *data, size_t len)
+{
+    uint32_t ss = ring->flash.sector_size;
+    if (TELEMETRY_RING_HEADER_LEN + len > ss) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint32_t size = record_size(len);
+    if (ring->head % ss + size > ss) {
+        ring->head = next_sector(ring, ring->head);
+    }
+    if (ring->head % ss == 0) {
+        drop_sector(ring, ring->head);
+        esp_err_t ret = ring->flash.erase(ring->flash.ctx, ring->head, ss);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        ring->stats.erases++;
+    }
+
+    record_header_t h = {
+        .magic = RECORD_MAGIC,
+        .len = len,
+        .seq = ring->next_seq,
+        .state = STATE_PENDING,
+    };
+    h.crc = crc32(crc32(0, &h.len, sizeof(h.len)), &h.seq, sizeof(h.seq));
+    h.crc = crc32(h.crc, data, len);
+    uint32_t pos = ring->head;
+    esp_err_t ret = ring->flash.write(ring->flash.ctx, pos + TELEMETRY_RING_HEADER_LEN, data, len);
+    if (ret == ESP_OK) {
+        // Header last: a reset in between leaves no header, the sector is skipped on the next open
+        ret = ring->flash.write(ring->flash.ctx, pos, &h, sizeof(h));
+    }
+    // Even a failed write may have cleared bits, the space is not written again
+    ring->head = (pos + size) % ring->flash.size;
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ring->next_seq++;
+    if (ring->pending++ == 0) {
+        ring->tail = pos;
+    }
+    ring->stats.appended++;
+    return ESP_OK;
+}
+
+esp_err_t telemetry_ring_read(telemetry_ring_t *ring, uint32_t *pos, void *buf, size_t cap, size_t *len,
+                              uint32_t *seq, uint32_t *next)
+{
+    record_header_t h;
+    uint32_t p = *pos;
+    // Bounded: a position a wrap made stale still reaches head, but never loops over the area
+    for (uint32_t steps = 0; p != ring->head && steps < ring->flash.size / 4; steps++) {
+        if (!read_header(ring, p, &h)) {
+            p = next_sector(ring, p);
+            continue;
+        }
+        if (h.state != STATE_PENDING) {
+            p = advance(ring, p, &h);
+            continue;
+        }
+        *pos = p;
+        *len = h.len;
+        *seq = h.seq;
+        *next = advance(ring, p, &h);
+        if (h.len > cap) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        return ring->flash.read(ring->flash.ctx, p + TELEMETRY_RING_HEADER_LEN, buf, h.len);
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t telemetry_ring_mark_sent(telemetry_ring_t *ring, uint32_t pos, uint32_t seq)
+{
+    record_header_t h;
+    if (!read_header(ring, pos, &h) || h.seq != seq || h.state != STATE_PENDING) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = set_state(ring, pos, STATE_SENT);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ring->pending--;
+    ring->stats.sent++;
+    if (pos == ring->tail) {
+        settle_tail(ring);
+    }
+    return ESP_OK;
+}
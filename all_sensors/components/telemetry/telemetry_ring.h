@@ -0,0 +1,89 @@
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief NOR flash area: erased bytes read 0xFF, writes only clear bits, erases are whole sectors
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+    esp_err_t (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+    esp_err_t (*erase)(void *ctx, uint32_t offset, size_t len);                                             /*!< Sector aligned */
+    void *ctx;
+    uint32_t size;                                                                                          /*!< At least two sectors */
+    uint32_t sector_size;
+} telemetry_flash_t;
+
+/**
+ * @brief Ring counters, since telemetry_ring_open
+ */
+typedef struct {
+    uint32_t appended;
+    uint32_t sent;
+    uint32_t dropped;                                                                                       /*!< Unsent records erased to make room: the ring was full */
+    uint32_t corrupt;                                                                                       /*!< Records found broken on open, e.g. cut by a reset while written */
+    uint32_t erases;                                                                                        /*!< Sectors erased */
+} telemetry_ring_stats_t;
+
+/**
+ * @brief Records (batch payloads) in a flash area, oldest unsent first
+ *
+ * Records are written one after another and never span sectors. A record is marked sent by clearing a word of its
+ * header, without an erase; a sector is erased only when the writing reaches it again, so each sector is erased once
+ * per pass over the area. With one 300 B batch a minute a 256 KB area is passed over about once a day. The state
+ * kept in RAM is a few positions, whatever the area holds; it is rebuilt from the headers by telemetry_ring_open.
+ */
+typedef struct {
+    telemetry_flash_t flash;
+    uint32_t head;                                                                                          /*!< Where the next record goes */
+    uint32_t tail;                                                                                          /*!< Oldest unsent record, head when there is none */
+    uint32_t next_seq;
+    uint32_t pending;                                                                                       /*!< Unsent records */
+    telemetry_ring_stats_t stats;
+} telemetry_ring_t;
+
+#define TELEMETRY_RING_HEADER_LEN 16
+
+/**
+ * @brief Find the records left by the last run, unsent ones stay to be sent
+ */
+esp_err_t telemetry_ring_open(telemetry_ring_t *ring, const telemetry_flash_t *flash);
+
+/**
+ * @brief Add a record. When the area is full the sector of the oldest records is erased, unsent ones with it.
+ *
+ * @return ESP_ERR_INVALID_SIZE if the record is longer than a sector less its header
+ */
+esp_err_t telemetry_ring_append(telemetry_ring_t *ring, const void *data, size_t len);
+
+/**
+ * @brief Read the first unsent record at or after *pos (start from ring->tail)
+ *
+ * @param[in,out] pos In: where to look from. Out: where the record is, for telemetry_ring_mark_sent.
+ * @param[out] next Where to look for the one after it
+ * @return ESP_ERR_NOT_FOUND if there is none up to head; ESP_ERR_INVALID_SIZE if cap is too small for it (pos, len
+ * and seq are set, e.g. to mark it sent and skip it)
+ */
+esp_err_t telemetry_ring_read(telemetry_ring_t *ring, uint32_t *pos, void *buf, size_t cap, size_t *len,
+                              uint32_t *seq, uint32_t *next);
+
+/**
+ * @brief The record at pos was delivered
+ *
+ * @return ESP_ERR_NOT_FOUND if the record there is no longer the one with seq (erased to make room) or is sent
+ */
+esp_err_t telemetry_ring_mark_sent(telemetry_ring_t *ring, uint32_t pos, uint32_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
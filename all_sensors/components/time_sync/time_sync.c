@@ -0,0 +1,153 @@
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_netif_sntp.h"
+#include "esp_sntp.h"
+#include "esp_timer.h"
+#include "time_sync.h"
+
+#define TAG "TIME"
+
+#define RTC_MAGIC 0x54494D45 // "TIME"
+#define VALID_AFTER 1700000000 // Nov 2023: an earlier clock was never set
+
+typedef struct {
+    uint32_t magic;
+    time_sync_drift_t drift;
+} time_sync_rtc_t;
+
+static RTC_DATA_ATTR time_sync_rtc_t s_rtc; // Survives deep sleep, not a power cycle
+static time_sync_config_t s_config;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_correct_timer;
+static bool s_sntp_started;
+
+static int64_t now_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void us_to_timeval(int64_t us, struct timeval *tv)
+{
+    tv->tv_sec = us / 1000000;
+    tv->tv_usec = us % 1000000;
+}
+
+// Replaces the weak default of lwIP's SNTP client, which sets the clock outright: small offsets are slewed, so the
+// seconds on the display never jump, and every sync feeds the drift estimate
+void sntp_sync_time(struct timeval *tv)
+{
+    int64_t server = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+    int64_t local = now_us();
+    portENTER_CRITICAL(&s_lock);
+    bool slew = time_sync_drift_update(&s_rtc.drift, server, local);
+    time_sync_drift_t drift = s_rtc.drift;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (slew) {
+        struct timeval delta;
+        us_to_timeval(server - local, &delta);
+        adjtime(&delta, NULL); // replaces what is left of earlier corrections: the offset covers them
+    } else {
+        settimeofday(tv, NULL);
+    }
+    sntp_set_sync_status(SNTP_SYNC_STATUS_COMPLETED);
+    ESP_LOGI(TAG, "Sync %" PRIu32 ": offset %" PRId64 " us (%s), drift %" PRId32 " ppb", drift.syncs, server - local,
+             slew ? "slewed" : "set", drift.drift_ppb);
+}
+
+// Between syncs: slew the clock against the estimated drift, on top of what is still pending
+static void correct_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_lock);
+    int64_t us = time_sync_drift_correction_us(&s_rtc.drift, (int64_t)s_config.correct_period_s * 1000000);
+    portEXIT_CRITICAL(&s_lock);
+    if (us == 0) {
+        return;
+    }
+    struct timeval left = { 0 };
+    adjtime(NULL, &left);
+    struct timeval delta;
+    us_to_timeval(us + (int64_t)left.tv_sec * 1000000 + left.tv_usec, &delta);
+    adjtime(&delta, NULL);
+}
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (s_sntp_started) {
+        sntp_restart();
+        return;
+    }
+    esp_sntp_config_t cfg = ESP_NETIF_SNTP_DEFAULT_CONFIG(s_config.servers[0]);
+    int servers = 0;
+    for (int i = 0; i < TIME_SYNC_MAX_SERVERS && i < CONFIG_LWIP_SNTP_MAX_SERVERS && s_config.servers[i]; i++) {
+        cfg.servers[servers++] = s_config.servers[i];
+    }
+    cfg.num_of_servers = servers;
+    sntp_set_sync_interval(s_config.sync_interval_s * 1000);
+    if (esp_netif_sntp_init(&cfg) == ESP_OK) {
+        s_sntp_started = true;
+        ESP_LOGI(TAG, "SNTP started, %d server(s)", servers);
+    }
+}
+
+esp_err_t time_sync_init(const time_sync_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->tz && config->servers[0] && config->correct_period_s > 0, ESP_ERR_INVALID_ARG,
+                        TAG, "Invalid config");
+    s_config = *config;
+    setenv("TZ", config->tz, 1);
+    tzset();
+
+    if (s_rtc.magic == RTC_MAGIC && time_sync_is_valid()) {
+        ESP_LOGI(TAG, "Clock kept through deep sleep, drift %" PRId32 " ppb", s_rtc.drift.drift_ppb);
+    } else {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = RTC_MAGIC;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = correct_cb,
+        .name = "time_correct",
+    };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &s_correct_timer), TAG, "Timer create failed");
+    ESP_RETURN_ON_ERROR(esp_timer_start_periodic(s_correct_timer, (uint64_t)config->correct_period_s * 1000000), TAG,
+                        "Timer start failed");
+    return esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL);
+}
+
+bool time_sync_is_valid(void)
+{
+    return time(NULL) > VALID_AFTER;
+}
+
+int64_t time_sync_us_to_next_second(void)
+{
+    return 1000000 - now_us() % 1000000;
+}
+
+esp_err_t time_sync_now(void)
+{
+    if (!s_sntp_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    sntp_restart();
+    return ESP_OK;
+}
+
+void time_sync_get_stats(time_sync_drift_t *stats)
+{
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_rtc.drift;
+    portEXIT_CRITICAL(&s_lock);
+}
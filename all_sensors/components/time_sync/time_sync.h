@@ -0,0 +1,66 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "time_sync_drift.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIME_SYNC_TZ_WARSAW "CET-1CEST,M3.5.0,M10.5.0/3"                                                    /*!< CET, CEST from the last Sunday of March 02:00 to the last Sunday of October 03:00 */
+#define TIME_SYNC_MAX_SERVERS 2
+
+/**
+ * @brief Time subsystem configuration
+ */
+typedef struct {
+    const char *tz;                                                                                         /*!< POSIX TZ rule for localtime */
+    const char *servers[TIME_SYNC_MAX_SERVERS];                                                             /*!< NTP servers, NULL for fewer (up to CONFIG_LWIP_SNTP_MAX_SERVERS are used) */
+    uint32_t sync_interval_s;                                                                               /*!< Between SNTP syncs */
+    uint32_t correct_period_s;                                                                              /*!< Between drift corrections of the clock */
+} time_sync_config_t;
+
+#define TIME_SYNC_DEFAULT_CONFIG() {                                                                        \
+    .tz = TIME_SYNC_TZ_WARSAW,                                                                              \
+    .servers = { "pool.ntp.org", "time.google.com" },                                                       \
+    .sync_interval_s = 3600,                                                                                \
+    .correct_period_s = 10,                                                                                 \
+}
+
+/**
+ * @brief Set the time zone and start correcting the clock. SNTP starts by itself once the station gets an address
+ * (IP_EVENT_STA_GOT_IP; needs the default event loop) and syncs again after every reconnection.
+ *
+ * The drift estimate and the time of the last sync are kept in RTC memory: after a wake from deep sleep the clock is
+ * valid at once. It ran on the RTC slow clock while asleep, so the next sync may still step it.
+ */
+esp_err_t time_sync_init(const time_sync_config_t *config);
+
+/**
+ * @brief Whether the clock holds a real time: synced since power up (possibly before a deep sleep)
+ */
+bool time_sync_is_valid(void);
+
+/**
+ * @brief Microseconds from now to the next full second of the wall clock, 1..1000000
+ */
+int64_t time_sync_us_to_next_second(void);
+
+/**
+ * @brief Sync now, e.g. after a wake from deep sleep. ESP_ERR_INVALID_STATE before SNTP has started.
+ */
+esp_err_t time_sync_now(void);
+
+/**
+ * @brief Copy of the sync and drift state
+ */
+void time_sync_get_stats(time_sync_drift_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+#include "time_sync_drift.h"
+
+bool time_sync_drift_update(time_sync_drift_t *drift, int64_t server_us, int64_t local_us)
+{
+    int64_t offset = server_us - local_us;
+    drift->syncs++;
+    drift->last_offset_us = offset;
+    drift->remainder_ns = 0;
+
+    if (drift->last_sync_us == 0 || llabs(offset) > TIME_SYNC_STEP_US) {
+        drift->last_sync_us = server_us;
+        drift->span_offset_us = 0;
+        return false;
+    }
+
+    // Over the span the clock ran at (true drift - estimate), which left total = -(true - estimate) * elapsed.
+    // Short spans are extended to the next sync: the network delay of the two syncs would swamp the drift.
+    int64_t elapsed = server_us - drift->last_sync_us;
+    int64_t total = drift->span_offset_us + offset;
+    if (elapsed < TIME_SYNC_MIN_INTERVAL_US) {
+        drift->span_offset_us = total;
+        return true;
+    }
+    int64_t measured = drift->drift_ppb - total * 1000000000LL / elapsed;
+    if (measured > TIME_SYNC_MAX_DRIFT_PPB) measured = TIME_SYNC_MAX_DRIFT_PPB;
+    if (measured < -TIME_SYNC_MAX_DRIFT_PPB) measured = -TIME_SYNC_MAX_DRIFT_PPB;
+    // Halfway towards each new measurement: follows temperature, smooths network jitter
+    drift->drift_ppb = drift->measurements == 0 ? measured : drift->drift_ppb + (measured - drift->drift_ppb) / 2;
+    drift->measurements++;
+    drift->last_sync_us = server_us;
+    drift->span_offset_us = 0;
+    return true;
+}
+
+int64_t time_sync_drift_correction_us(time_sync_drift_t *drift, int64_t interval_us)
+{
+    int64_t ns = drift->remainder_ns - (int64_t)drift->drift_ppb * interval_us / 1000000;
+    int64_t us = ns / 1000;
+    drift->remainder_ns = ns - us * 1000;
+    return us;
+}
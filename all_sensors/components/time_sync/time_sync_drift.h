@@ -0,0 +1,48 @@
+#ifndef TIME_SYNC_DRIFT_H
+#define TIME_SYNC_DRIFT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIME_SYNC_STEP_US 500000                                                                            /*!< Larger offsets are stepped, not slewed, and tell nothing about the drift */
+#define TIME_SYNC_MIN_INTERVAL_US (10 * 60 * 1000000LL)                                                     /*!< Shortest span between syncs that yields a drift measurement */
+#define TIME_SYNC_MAX_DRIFT_PPB 500000                                                                      /*!< 500 ppm, beyond any crystal: a measurement above is clamped */
+
+/**
+ * @brief Drift estimate of the local clock, updated at every sync and applied in between
+ *
+ * Plain arithmetic on microsecond timestamps, without any clock of its own, so it runs the same on the host.
+ */
+typedef struct {
+    int64_t last_sync_us;                                                                                   /*!< Server time at the start of the measured span, us since the epoch, 0 before the first sync */
+    int64_t span_offset_us;                                                                                 /*!< Offsets slewed away by syncs inside the span */
+    int64_t last_offset_us;                                                                                 /*!< Server minus local clock at the last sync */
+    int32_t drift_ppb;                                                                                      /*!< The local clock gains this many ns per second (negative: loses) */
+    uint32_t syncs;
+    uint32_t measurements;                                                                                  /*!< Syncs that updated drift_ppb */
+    int64_t remainder_ns;                                                                                   /*!< Correction below 1 us not applied yet */
+} time_sync_drift_t;
+
+/**
+ * @brief Account a sync
+ *
+ * @param server_us Time from the server
+ * @param local_us Local clock, with the corrections applied so far, at the same moment
+ * @return true if the offset is small: slew the clock by it. false: set the clock to server_us.
+ */
+bool time_sync_drift_update(time_sync_drift_t *drift, int64_t server_us, int64_t local_us);
+
+/**
+ * @brief Correction to apply to the local clock for interval_us of running at the estimated drift
+ */
+int64_t time_sync_drift_correction_us(time_sync_drift_t *drift, int64_t interval_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
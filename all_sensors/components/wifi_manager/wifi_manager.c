@@ -0,0 +1,343 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include "wifi_manager.h"
+#include "wifi_manager_prov.h"
+
+#define TAG "WIFI"
+
+#define CONNECTED_BIT BIT0
+#define NVS_KEY_SSID "ssid"
+#define NVS_KEY_PASS "pass"
+#define PROV_LINGER_US (5 * 1000000) // AP stays up this long after connecting, so the form's answer gets through
+
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_EVENT);
+
+static wifi_manager_config_t s_config;
+static SemaphoreHandle_t s_lock; // Everything below; taken by the event handlers, the timers and the API
+static EventGroupHandle_t s_bits;
+static esp_timer_handle_t s_retry_timer;
+static esp_timer_handle_t s_prov_stop_timer;
+static esp_netif_t *s_ap_netif;
+static wifi_manager_backoff_t s_backoff;
+static wifi_manager_stats_t s_stats;
+static uint8_t s_auth_failures;
+static bool s_configured;
+static bool s_reconnect; // Disconnected on purpose for new credentials: connect again at once
+
+static bool is_auth_failure(uint8_t reason)
+{
+    return reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT ||
+           reason == WIFI_REASON_HANDSHAKE_TIMEOUT;
+}
+
+static void schedule_retry_locked(uint8_t reason)
+{
+    uint32_t ms = wifi_manager_backoff_next(&s_backoff, esp_random());
+    s_stats.state = WIFI_MANAGER_STATE_WAITING;
+    s_stats.retry_ms = ms;
+    esp_timer_stop(s_retry_timer);
+    esp_timer_start_once(s_retry_timer, (uint64_t)ms * 1000);
+    ESP_LOGI(TAG, "Disconnected (reason %u), retry in %" PRIu32 " ms", reason, ms);
+
+    wifi_manager_event_disconnected_t event = { .reason = reason, .retry_ms = ms };
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_DISCONNECTED, &event, sizeof(event), 0);
+}
+
+static void connect_locked(void)
+{
+    s_stats.state = WIFI_MANAGER_STATE_CONNECTING;
+    s_stats.attempts++;
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        // No disconnection event follows a connect that did not start
+        ESP_LOGW(TAG, "Connect: %s", esp_err_to_name(ret));
+        schedule_retry_locked(0);
+    }
+}
+
+static void retry_cb(void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_stats.state == WIFI_MANAGER_STATE_WAITING && s_configured) {
+        connect_locked();
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static void start_provisioning_locked(void)
+{
+    if (s_stats.provisioning) {
+        return;
+    }
+    if (!s_ap_netif) {
+        s_ap_netif = esp_netif_create_default_wifi_ap();
+    }
+    uint8_t mac[6] = { 0 };
+    esp_read_mac(mac, ESP_MAC_WIFI_SOFTAP);
+    wifi_config_t ap = { 0 };
+    int len = snprintf((char *)ap.ap.ssid, sizeof(ap.ap.ssid), "%s-%02X%02X", s_config.ap_ssid_prefix, mac[4], mac[5]);
+    ap.ap.ssid_len = len < (int)sizeof(ap.ap.ssid) ? len : sizeof(ap.ap.ssid) - 1;
+    ap.ap.channel = s_config.ap_channel;
+    ap.ap.max_connection = 2;
+    ap.ap.authmode = WIFI_AUTH_OPEN;
+    if (s_config.ap_password && s_config.ap_password[0]) {
+        strlcpy((char *)ap.ap.password, s_config.ap_password, sizeof(ap.ap.password));
+        ap.ap.authmode = WIFI_AUTH_WPA2_PSK;
+    }
+
+    // The station keeps trying with the stored credentials, if there are any
+    esp_wifi_set_mode(WIFI_MODE_APSTA);
+    esp_wifi_set_config(WIFI_IF_AP, &ap);
+    // Clients of the AP need the radio awake
+    esp_wifi_set_ps(WIFI_PS_NONE);
+    if (wifi_manager_prov_start() != ESP_OK) {
+        return;
+    }
+    s_stats.provisioning = true;
+    ESP_LOGW(TAG, "Provisioning AP %s up, form at http://192.168.4.1/", (char *)ap.ap.ssid);
+
+    wifi_manager_event_provisioning_t event = { 0 };
+    memcpy(event.ssid, ap.ap.ssid, ap.ap.ssid_len);
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_PROVISIONING, &event, sizeof(event), 0);
+}
+
+// Connected after provisioning: the AP goes down, unless the link was lost again in the meantime
+static void prov_stop_cb(void *arg)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool stop = s_stats.provisioning && s_stats.state == WIFI_MANAGER_STATE_CONNECTED;
+    if (stop) {
+        esp_wifi_set_mode(WIFI_MODE_STA);
+        esp_wifi_set_ps(s_config.power_save);
+        s_stats.provisioning = false;
+    }
+    xSemaphoreGive(s_lock);
+    if (stop) {
+        wifi_manager_prov_stop();
+        ESP_LOGI(TAG, "Provisioning AP down");
+    }
+}
+
+static void on_wifi_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        if (s_configured) {
+            connect_locked();
+        }
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        const wifi_event_sta_disconnected_t *event = data;
+        xEventGroupClearBits(s_bits, CONNECTED_BIT);
+        if (s_stats.state == WIFI_MANAGER_STATE_CONNECTED) {
+            s_stats.disconnects++;
+        }
+        s_stats.last_reason = event->reason;
+        s_stats.rssi = 0;
+        if (!s_configured) {
+            s_stats.state = WIFI_MANAGER_STATE_UNCONFIGURED;
+        } else if (s_reconnect) {
+            s_reconnect = false;
+            connect_locked();
+        } else {
+            // A password that keeps being refused will not start working: let it be corrected
+            if (is_auth_failure(event->reason) && s_config.auth_failures_to_provision &&
+                ++s_auth_failures == s_config.auth_failures_to_provision) {
+                ESP_LOGW(TAG, "Password refused %u times", s_auth_failures);
+                start_provisioning_locked();
+            }
+            schedule_retry_locked(event->reason);
+        }
+    } else if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *event = data;
+        wifi_ap_record_t ap;
+        s_stats.rssi = esp_wifi_sta_get_ap_info(&ap) == ESP_OK ? ap.rssi : 0;
+        s_stats.state = WIFI_MANAGER_STATE_CONNECTED;
+        s_stats.connects++;
+        s_stats.retry_ms = 0;
+        s_auth_failures = 0;
+        wifi_manager_backoff_reset(&s_backoff);
+        xEventGroupSetBits(s_bits, CONNECTED_BIT);
+        ESP_LOGI(TAG, "Connected, " IPSTR ", %d dBm", IP2STR(&event->ip_info.ip), s_stats.rssi);
+        if (s_stats.provisioning) {
+            esp_timer_stop(s_prov_stop_timer);
+            esp_timer_start_once(s_prov_stop_timer, PROV_LINGER_US);
+        }
+
+        wifi_manager_event_connected_t connected = { .ip = event->ip_info.ip, .rssi = s_stats.rssi };
+        esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_CONNECTED, &connected, sizeof(connected), 0);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static void apply_credentials_locked(const char *ssid, const char *password)
+{
+    wifi_config_t sta = { 0 };
+    // Both fields may be used in full, without a terminator
+    memcpy(sta.sta.ssid, ssid, strnlen(ssid, sizeof(sta.sta.ssid)));
+    memcpy(sta.sta.password, password, strnlen(password, sizeof(sta.sta.password)));
+    sta.sta.listen_interval = s_config.listen_interval;
+    esp_wifi_set_config(WIFI_IF_STA, &sta);
+    s_configured = true;
+}
+
+static esp_err_t load_credentials(char *ssid, size_t ssid_len, char *password, size_t password_len)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(s_config.nvs_namespace, NVS_READONLY, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_get_str(nvs, NVS_KEY_SSID, ssid, &ssid_len);
+    if (ret == ESP_OK) {
+        ret = nvs_get_str(nvs, NVS_KEY_PASS, password, &password_len);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+esp_err_t wifi_manager_start(const wifi_manager_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->nvs_namespace && config->ap_ssid_prefix, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid config");
+    ESP_RETURN_ON_FALSE(!s_lock, ESP_ERR_INVALID_STATE, TAG, "Already started");
+    s_config = *config;
+    wifi_manager_backoff_init(&s_backoff, config->backoff_min_ms, config->backoff_max_ms);
+    s_lock = xSemaphoreCreateMutex();
+    s_bits = xEventGroupCreate();
+    ESP_RETURN_ON_FALSE(s_lock && s_bits, ESP_ERR_NO_MEM, TAG, "No memory");
+
+    const esp_timer_create_args_t retry_args = { .callback = retry_cb, .name = "wifi_retry" };
+    const esp_timer_create_args_t prov_args = { .callback = prov_stop_cb, .name = "wifi_prov" };
+    ESP_RETURN_ON_ERROR(esp_timer_create(&retry_args, &s_retry_timer), TAG, "Timer create failed");
+    ESP_RETURN_ON_ERROR(esp_timer_create(&prov_args, &s_prov_stop_timer), TAG, "Timer create failed");
+
+    ESP_RETURN_ON_ERROR(esp_netif_init(), TAG, "Netif init failed");
+    esp_netif_create_default_wifi_sta();
+    wifi_init_config_t init = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_RETURN_ON_ERROR(esp_wifi_init(&init), TAG, "Wi-Fi init failed");
+    // Credentials live in our own namespace, the driver keeps no copy of them
+    ESP_RETURN_ON_ERROR(esp_wifi_set_storage(WIFI_STORAGE_RAM), TAG, "Wi-Fi storage failed");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_START, on_wifi_event, NULL), TAG,
+                        "Handler register failed");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, on_wifi_event, NULL), TAG,
+                        "Handler register failed");
+    ESP_RETURN_ON_ERROR(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_wifi_event, NULL), TAG,
+                        "Handler register failed");
+
+    char ssid[WIFI_MANAGER_SSID_LEN + 1];
+    char password[WIFI_MANAGER_PASSWORD_LEN + 1];
+    bool stored = load_credentials(ssid, sizeof(ssid), password, sizeof(password)) == ESP_OK;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    if (stored) {
+        apply_credentials_locked(ssid, password);
+        s_stats.state = WIFI_MANAGER_STATE_CONNECTING;
+        ESP_LOGI(TAG, "Connecting to %s", ssid);
+    } else {
+        s_stats.state = WIFI_MANAGER_STATE_UNCONFIGURED;
+        start_provisioning_locked();
+    }
+    esp_err_t ret = esp_wifi_start();
+    if (ret == ESP_OK && !s_stats.provisioning) {
+        // Modem sleep between beacons: fewer wake ups of the radio, which shares the core and the bus arbitration
+        // with everything else
+        esp_wifi_set_ps(s_config.power_save);
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+esp_err_t wifi_manager_set_credentials(const char *ssid, const char *password)
+{
+    ESP_RETURN_ON_FALSE(s_lock, ESP_ERR_INVALID_STATE, TAG, "Not started");
+    ESP_RETURN_ON_FALSE(ssid && password && wifi_manager_credentials_valid(ssid, password), ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid credentials");
+    nvs_handle_t nvs;
+    ESP_RETURN_ON_ERROR(nvs_open(s_config.nvs_namespace, NVS_READWRITE, &nvs), TAG, "NVS open failed");
+    esp_err_t ret = nvs_set_str(nvs, NVS_KEY_SSID, ssid);
+    if (ret == ESP_OK) ret = nvs_set_str(nvs, NVS_KEY_PASS, password);
+    if (ret == ESP_OK) ret = nvs_commit(nvs);
+    nvs_close(nvs);
+    ESP_RETURN_ON_ERROR(ret, TAG, "NVS write failed");
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    apply_credentials_locked(ssid, password);
+    s_auth_failures = 0;
+    wifi_manager_backoff_reset(&s_backoff);
+    esp_timer_stop(s_retry_timer);
+    if (s_stats.state == WIFI_MANAGER_STATE_CONNECTED || s_stats.state == WIFI_MANAGER_STATE_CONNECTING) {
+        s_reconnect = true;
+        esp_wifi_disconnect();
+    } else {
+        connect_locked();
+    }
+    xSemaphoreGive(s_lock);
+    ESP_LOGI(TAG, "Credentials for %s stored", ssid);
+    esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_PROVISIONED, NULL, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t wifi_manager_forget(void)
+{
+    ESP_RETURN_ON_FALSE(s_lock, ESP_ERR_INVALID_STATE, TAG, "Not started");
+    nvs_handle_t nvs;
+    if (nvs_open(s_config.nvs_namespace, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, NVS_KEY_SSID);
+        nvs_erase_key(nvs, NVS_KEY_PASS);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_configured = false;
+    s_reconnect = false;
+    esp_timer_stop(s_retry_timer);
+    if (s_stats.state == WIFI_MANAGER_STATE_CONNECTED || s_stats.state == WIFI_MANAGER_STATE_CONNECTING) {
+        esp_wifi_disconnect();
+    }
+    s_stats.state = WIFI_MANAGER_STATE_UNCONFIGURED;
+    start_provisioning_locked();
+    xSemaphoreGive(s_lock);
+    return ESP_OK;
+}
+
+bool wifi_manager_is_connected(void)
+{
+    return s_bits && (xEventGroupGetBits(s_bits) & CONNECTED_BIT);
+}
+
+esp_err_t wifi_manager_wait_connected(TickType_t ticks)
+{
+    if (!s_bits) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_bits, CONNECTED_BIT, pdFALSE, pdTRUE, ticks);
+    return bits & CONNECTED_BIT ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void wifi_manager_get_stats(wifi_manager_stats_t *stats)
+{
+    if (!s_lock) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    wifi_ap_record_t ap;
+    if (s_stats.state == WIFI_MANAGER_STATE_CONNECTED && esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+        s_stats.rssi = ap.rssi;
+    }
+    *stats = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,131 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif_ip_addr.h"
+#include "esp_wifi_types.h"
+#include "freertos/FreeRTOS.h"
+#include "wifi_manager_backoff.h"
+#include "wifi_manager_form.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Link state, posted to the default event loop under WIFI_MANAGER_EVENT
+ */
+ESP_EVENT_DECLARE_BASE(WIFI_MANAGER_EVENT);
+
+typedef enum {
+    WIFI_MANAGER_EVENT_CONNECTED,                                                                           /*!< Station has an address, wifi_manager_event_connected_t */
+    WIFI_MANAGER_EVENT_DISCONNECTED,                                                                        /*!< Link lost or attempt failed, wifi_manager_event_disconnected_t */
+    WIFI_MANAGER_EVENT_PROVISIONING,                                                                        /*!< Provisioning AP up, wifi_manager_event_provisioning_t */
+    WIFI_MANAGER_EVENT_PROVISIONED,                                                                         /*!< New credentials stored, the station connects with them */
+} wifi_manager_event_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    int8_t rssi;
+} wifi_manager_event_connected_t;
+
+typedef struct {
+    uint8_t reason;                                                                                         /*!< wifi_err_reason_t */
+    uint32_t retry_ms;                                                                                      /*!< Next attempt in */
+} wifi_manager_event_disconnected_t;
+
+typedef struct {
+    char ssid[WIFI_MANAGER_SSID_LEN + 1];                                                                   /*!< Of the provisioning AP, the form is at http://192.168.4.1/ */
+} wifi_manager_event_provisioning_t;
+
+typedef enum {
+    WIFI_MANAGER_STATE_CONNECTING,
+    WIFI_MANAGER_STATE_CONNECTED,
+    WIFI_MANAGER_STATE_WAITING,                                                                             /*!< Backing off before the next attempt */
+    WIFI_MANAGER_STATE_UNCONFIGURED,                                                                        /*!< No credentials, only the provisioning AP runs */
+} wifi_manager_state_t;
+
+/**
+ * @brief Manager configuration
+ */
+typedef struct {
+    const char *nvs_namespace;                                                                              /*!< Credentials are kept here, keys "ssid" and "pass" */
+    const char *ap_ssid_prefix;                                                                             /*!< Provisioning AP is <prefix>-XXXX, from the last MAC bytes */
+    const char *ap_password;                                                                                /*!< 8..63 characters, NULL or "" for an open AP */
+    uint8_t ap_channel;
+    uint32_t backoff_min_ms;                                                                                /*!< First retry after a failure */
+    uint32_t backoff_max_ms;                                                                                /*!< Longest wait between attempts */
+    uint8_t auth_failures_to_provision;                                                                     /*!< Rejected passwords in a row that bring the provisioning AP up next to the station, 0 never */
+    wifi_ps_type_t power_save;                                                                              /*!< Modem sleep of the station */
+    uint8_t listen_interval;                                                                                /*!< Beacon intervals between wake ups with WIFI_PS_MAX_MODEM */
+} wifi_manager_config_t;
+
+#define WIFI_MANAGER_DEFAULT_CONFIG() {                                                                     \
+    .nvs_namespace = "wifi",                                                                                \
+    .ap_ssid_prefix = "smart-mirror",                                                                       \
+    .ap_password = NULL,                                                                                    \
+    .ap_channel = 1,                                                                                        \
+    .backoff_min_ms = 1000,                                                                                 \
+    .backoff_max_ms = 60000,                                                                                \
+    .auth_failures_to_provision = 5,                                                                        \
+    .power_save = WIFI_PS_MIN_MODEM,                                                                        \
+    .listen_interval = 3,                                                                                   \
+}
+
+/**
+ * @brief Manager counters, since wifi_manager_start
+ */
+typedef struct {
+    wifi_manager_state_t state;
+    uint32_t connects;                                                                                      /*!< Addresses obtained */
+    uint32_t disconnects;                                                                                   /*!< Links lost after they were up */
+    uint32_t attempts;                                                                                      /*!< Connection attempts, the first one included */
+    uint8_t last_reason;                                                                                    /*!< wifi_err_reason_t of the last disconnection */
+    uint32_t retry_ms;                                                                                      /*!< Delay of the pending retry */
+    int8_t rssi;                                                                                            /*!< Of the access point, 0 when not connected */
+    bool provisioning;                                                                                      /*!< Provisioning AP up */
+} wifi_manager_stats_t;
+
+/**
+ * @brief Start Wi-Fi: with stored credentials as a station, without them as the provisioning AP only
+ *
+ * Needs NVS and the default event loop. Lost links and failed attempts are retried with exponential backoff. The
+ * provisioning AP serves a form for the network name and password; once stored, the station connects with them and
+ * the AP goes down.
+ */
+esp_err_t wifi_manager_start(const wifi_manager_config_t *config);
+
+/**
+ * @brief Store new credentials and connect with them, e.g. from a console command
+ *
+ * @return ESP_ERR_INVALID_ARG if wifi_manager_credentials_valid refuses them
+ */
+esp_err_t wifi_manager_set_credentials(const char *ssid, const char *password);
+
+/**
+ * @brief Erase the stored credentials, disconnect and bring the provisioning AP up
+ */
+esp_err_t wifi_manager_forget(void);
+
+bool wifi_manager_is_connected(void);
+
+/**
+ * @brief Block until the station has an address
+ *
+ * @return ESP_ERR_TIMEOUT if it had none within ticks
+ */
+esp_err_t wifi_manager_wait_connected(TickType_t ticks);
+
+/**
+ * @brief Copy of the counters
+ */
+void wifi_manager_get_stats(wifi_manager_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,28 @@
+#include "wifi_manager_backoff.h"
+
+void wifi_manager_backoff_init(wifi_manager_backoff_t *backoff, uint32_t min_ms, uint32_t max_ms)
+{
+    backoff->min_ms = min_ms ? min_ms : 1;
+    backoff->max_ms = max_ms > backoff->min_ms ? max_ms : backoff->min_ms;
+    backoff->failures = 0;
+}
+
+uint32_t wifi_manager_backoff_next(wifi_manager_backoff_t *backoff, uint32_t random)
+{
+    uint64_t delay = backoff->min_ms;
+    for (uint32_t i = 0; i < backoff->failures && delay < backoff->max_ms; i++) {
+        delay *= 2;
+    }
+    if (delay > backoff->max_ms) {
+        delay = backoff->max_ms;
+    }
+    backoff->failures++;
+    // Half fixed, so a retry never comes right away, half random
+    uint32_t half = delay / 2;
+    return delay - half + random % (half + 1);
+}
+
+void wifi_manager_backoff_reset(wifi_manager_backoff_t *backoff)
+{
+    backoff->failures = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef WIFI_MANAGER_BACKOFF_H
+#define WIFI_MANAGER_BACKOFF_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Delay before each reconnection attempt: doubles from min_ms with every failure up to max_ms, and a random
+ * part so that devices that lost the same access point do not all come back at the same instant
+ *
+ * Plain arithmetic, the random number comes from the caller, so it runs the same on the host.
+ */
+typedef struct {
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t failures;                                                                                      /*!< Attempts since the last connection */
+} wifi_manager_backoff_t;
+
+void wifi_manager_backoff_init(wifi_manager_backoff_t *backoff, uint32_t min_ms, uint32_t max_ms);
+
+/**
+ * @brief Account a failed attempt and return the delay before the next one: between half and all of
+ * min_ms * 2^failures, at most max_ms
+ *
+ * @param random Any 32-bit random number, e.g. esp_random()
+ */
+uint32_t wifi_manager_backoff_next(wifi_manager_backoff_t *backoff, uint32_t random);
+
+/**
+ * @brief Connected: the next failure starts again from min_ms
+ */
+void wifi_manager_backoff_reset(wifi_manager_backoff_t *backoff);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
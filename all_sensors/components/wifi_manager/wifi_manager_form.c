@@ -0,0 +1,69 @@
+#include <ctype.h>
+#include <string.h>
+#include "wifi_manager_form.h"
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool wifi_manager_form_field(const char *body, const char *name, char *out, size_t out_len)
+{
+    size_t name_len = strlen(name);
+    const char *p = body;
+    while (p && *p) {
+        const char *end = strchr(p, '&');
+        if (!end) {
+            end = p + strlen(p);
+        }
+        if ((size_t)(end - p) > name_len && strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+            size_t n = 0;
+            for (const char *v = p + name_len + 1; v < end; v++) {
+                char c = *v;
+                if (c == '+') {
+                    c = ' ';
+                } else if (c == '%') {
+                    int hi = v + 2 < end ? hex_digit(v[1]) : -1;
+                    int lo = hi >= 0 ? hex_digit(v[2]) : -1;
+                    if (lo < 0) {
+                        return false;
+                    }
+                    c = (char)(hi << 4 | lo);
+                    v += 2;
+                }
+                if (n + 1 >= out_len) {
+                    return false;
+                }
+                out[n++] = c;
+            }
+            out[n] = '\0';
+            return true;
+        }
+        p = *end ? end + 1 : NULL;
+    }
+    return false;
+}
+
+bool wifi_manager_credentials_valid(const char *ssid, const char *password)
+{
+    size_t ssid_len = strlen(ssid);
+    size_t pass_len = strlen(password);
+    if (ssid_len == 0 || ssid_len > WIFI_MANAGER_SSID_LEN) {
+        return false;
+    }
+    if (pass_len == 0 || (pass_len >= 8 && pass_len < WIFI_MANAGER_PASSWORD_LEN)) {
+        return true;
+    }
+    if (pass_len != WIFI_MANAGER_PASSWORD_LEN) {
+        return false;
+    }
+    for (size_t i = 0; i < pass_len; i++) {
+        if (!isxdigit((unsigned char)password[i])) {
+            return false;
+        }
+    }
+    return true;
+}
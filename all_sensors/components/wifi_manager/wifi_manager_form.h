@@ -0,0 +1,37 @@
+#ifndef WIFI_MANAGER_FORM_H
+#define WIFI_MANAGER_FORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIFI_MANAGER_SSID_LEN 32                                                                            /*!< Longest SSID, as wifi_sta_config_t */
+#define WIFI_MANAGER_PASSWORD_LEN 64                                                                        /*!< Longest passphrase (63) or a 64 digit hex key */
+
+/**
+ * @brief Longest form body with the terminator: both names, '=' and '&', every byte of the longest SSID and password
+ * percent-encoded
+ */
+#define WIFI_MANAGER_FORM_MAX (sizeof("ssid=&pass=") + 3 * (WIFI_MANAGER_SSID_LEN + WIFI_MANAGER_PASSWORD_LEN))
+
+/**
+ * @brief Decoded value of a field of an application/x-www-form-urlencoded body ("ssid=Dom+2&pass=a%21b")
+ *
+ * @return false if the field is missing, its escapes are malformed or it does not fit in out_len with the terminator
+ */
+bool wifi_manager_form_field(const char *body, const char *name, char *out, size_t out_len);
+
+/**
+ * @brief Whether an access point can be configured with these: an SSID of 1..32 bytes and no password (open
+ * network), a WPA passphrase of 8..63 characters or a 64 digit hex key
+ */
+bool wifi_manager_credentials_valid(const char *ssid, const char *password);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "wifi_manager.h"
+#include "wifi_manager_prov.h"
+
+#define TAG "WIFI"
+
+static const char FORM_HTML[] =
+    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width\"><title>Wi-Fi</title></head>"
+    "<body><h3>Wi-Fi</h3><form method=\"post\" action=\"/\">"
+    "<p>Network<br><input name=\"ssid\" maxlength=\"32\"></p>"
+    "<p>Password<br><input name=\"pass\" type=\"password\" maxlength=\"64\"></p>"
+    "<p><input type=\"submit\" value=\"Save\"></p></form></body></html>";
+
+static const char SAVED_HTML[] =
+    "<!DOCTYPE html><html><body><p>Saved. The device connects now and this network goes down once it has.</p>"
+    "</body></html>";
+
+static httpd_handle_t s_server;
+
+static esp_err_t get_form(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, FORM_HTML, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t post_form(httpd_req_t *req)
+{
+    char body[WIFI_MANAGER_FORM_MAX];
+    if (req->content_len >= sizeof(body)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Form too long");
+    }
+    size_t got = 0;
+    while (got < req->content_len) {
+        int n = httpd_req_recv(req, body + got, req->content_len - got);
+        if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        got += n;
+    }
+    body[got] = '\0';
+
+    char ssid[WIFI_MANAGER_SSID_LEN + 1];
+    char pass[WIFI_MANAGER_PASSWORD_LEN + 1];
+    if (!wifi_manager_form_field(body, "ssid", ssid, sizeof(ssid)) ||
+        !wifi_manager_form_field(body, "pass", pass, sizeof(pass)) || !wifi_manager_credentials_valid(ssid, pass)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid network name or password");
+    }
+    if (wifi_manager_set_credentials(ssid, pass) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Could not store the credentials");
+    }
+    httpd_resp_set_type(req, "text/html");
+    return httpd_resp_send(req, SAVED_HTML, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t wifi_manager_prov_start(void)
+{
+    if (s_server) {
+        return ESP_OK;
+    }
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_open_sockets = 3;
+    esp_err_t ret = httpd_start(&s_server, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Provisioning server: %s", esp_err_to_name(ret));
+        s_server = NULL;
+        return ret;
+    }
+    static const httpd_uri_t get_uri = { .uri = "/", .method = HTTP_GET, .handler = get_form };
+    static const httpd_uri_t post_uri = { .uri = "/", .method = HTTP_POST, .handler = post_form };
+    httpd_register_uri_handler(s_server, &get_uri);
+    httpd_register_uri_handler(s_server, &post_uri);
+    return ESP_OK;
+}
+
+void wifi_manager_prov_stop(void)
+{
+    if (s_server) {
+        httpd_stop(s_server);
+        s_server = NULL;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef WIFI_MANAGER_PROV_H
+#define WIFI_MANAGER_PROV_H
+
+#include "esp_err.h"
+
+/*
+ * Provisioning web server of wifi_manager, internal
+ */
+
+/**
+ * @brief Serve the credentials form on port 80 of the provisioning AP
+ */
+esp_err_t wifi_manager_prov_start(void);
+
+/**
+ * @brief Stop the server. Blocks until its task is gone: not from a form handler, nor holding the manager's lock.
+ */
+void wifi_manager_prov_stop(void);
+
+#endif
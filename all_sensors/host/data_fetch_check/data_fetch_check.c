@@ -0,0 +1,413 @@
+/*
+ * Data fetching (components/data_fetch) against a stand-in HTTP server on 127.0.0.1, in a thread of this process:
+ *   - the streaming JSON parser fills fixed structs the same way whatever pieces the document comes in, skips what
+ *     is not asked for, cuts long strings at a character boundary and refuses malformed documents
+ *   - weather and calendar documents fetched over one kept connection, with Content-Length and chunked bodies
+ *     written a few bytes at a time
+ *   - unchanged documents answered 304 without a body, through ETag and Last-Modified
+ *   - a kept connection the server closed while idle is replaced without an error; error statuses and broken bodies
+ *     leave the target as it was and, where the answer was complete, the connection usable
+ * Exit status is non-zero if a check fails.
+ */
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "data_fetch.h"
+#include "json_stream.h"
+
+#define WEATHER_ETAG    "\"w1\""
+#define CALENDAR_DATE   "Sun, 19 Oct 2025 06:00:00 GMT"
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/* What the mirror wants of the documents */
+
+typedef struct {
+    float temp;
+    int32_t code;
+    bool is_day;
+    char time[17];
+    uint8_t days;
+    struct {
+        float max;
+        float min;
+        int32_t code;
+    } day[3];
+} weather_t;
+
+static const json_field_t s_weather_fields[] = {
+    JSON_FIELD(JSON_FIELD_FLOAT, "current.temperature_2m", weather_t, temp),
+    JSON_FIELD(JSON_FIELD_INT, "current.weather_code", weather_t, code),
+    JSON_FIELD(JSON_FIELD_BOOL, "current.is_day", weather_t, is_day),
+    JSON_FIELD(JSON_FIELD_STRING, "current.time", weather_t, time),
+    JSON_ITEM_FIELD(JSON_FIELD_FLOAT, "daily.temperature_2m_max[]", weather_t, day, max),
+    JSON_ITEM_FIELD(JSON_FIELD_FLOAT, "daily.temperature_2m_min[]", weather_t, day, min),
+    JSON_ITEM_FIELD(JSON_FIELD_INT, "daily.weather_code[]", weather_t, day, code),
+};
+
+static const json_schema_t s_weather_schema = {
+    .fields = s_weather_fields,
+    .field_count = sizeof(s_weather_fields) / sizeof(s_weather_fields[0]),
+    .items_offset = offsetof(weather_t, day),
+    .item_size = sizeof(((weather_t *)0)->day[0]),
+    .max_items = 3,
+    .count_offset = offsetof(weather_t, days),
+};
+
+typedef struct {
+    uint8_t count;
+    struct {
+        char summary[24];
+        char start[26];
+        char day[11];
+    } ev[4];
+} calendar_t;
+
+static const json_field_t s_calendar_fields[] = {
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].summary", calendar_t, ev, summary),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].start.dateTime", calendar_t, ev, start),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].start.date", calendar_t, ev, day),
+};
+
+static const json_schema_t s_calendar_schema = {
+    .fields = s_calendar_fields,
+    .field_count = sizeof(s_calendar_fields) / sizeof(s_calendar_fields[0]),
+    .items_offset = offsetof(calendar_t, ev),
+    .item_size = sizeof(((calendar_t *)0)->ev[0]),
+    .max_items = 4,
+    .count_offset = offsetof(calendar_t, count),
+};
+
+static const char s_weather_json[] =
+    "{\"latitude\":52.22,\"longitude\":21.0,\"generationtime_ms\":0.05,\n"
+    " \"current_units\":{\"time\":\"iso8601\",\"temperature_2m\":\"\\u00b0C\"},\n"
+    " \"current\":{\"time\":\"2025-10-19T12:00\",\"interval\":900,\"temperature_2m\":11.4,\"weather_code\":3,"
+    "\"is_day\":true,\"wind\":null},\n"
+    " \"daily\":{\"time\":[\"2025-10-19\",\"2025-10-20\",\"2025-10-21\",\"2025-10-22\"],\n"
+    "   \"temperature_2m_max\":[13.1,9.8,7.5,6.0],\"temperature_2m_min\":[4.2,3.0,-1.5e0,-2],\n"
+    "   \"weather_code\":[3,61,71,0]}}\n";
+
+static const char s_calendar_json[] =
+    "{\"kind\":\"calendar#events\",\"summary\":\"Dom\",\"items\":[\n"
+    "  {\"summary\":\"Dentysta \\u2013 wizyta\",\"location\":\"ul. D\xc5\x82uga 5\",\n"
+    "   \"start\":{\"dateTime\":\"2025-10-20T09:30:00+02:00\"},\"attendees\":[{\"email\":\"a@b.pl\",\"summary\":\"x\"}]},\n"
+    "  {\"summary\":\"Urodziny Ani\",\"start\":{\"date\":\"2025-10-22\"},\"reminders\":{\"useDefault\":true}},\n"
+    "  {\"summary\":\"Przegl\xc4\x85\x64 samochodu \xc5\xbc\xc3\xb3\xc5\x82tego\",\"start\":{\"dateTime\":\"2025-10-23T08:00:00+02:00\"}},\n"
+    "  {\"summary\":\"Escapes \\\"\\\\\\/\\n\\t\",\"start\":{}},\n"
+    "  {\"summary\":\"Past the fourth\",\"start\":{\"date\":\"2025-10-30\"}}\n"
+    "],\"nextPageToken\":\"abc\"}";
+
+/* Parser */
+
+static esp_err_t parse_in_pieces(const json_schema_t *schema, void *target, const char *doc, size_t piece)
+{
+    json_stream_t p;
+    json_stream_init(&p, schema, target);
+    size_t len = strlen(doc);
+    for (size_t at = 0; at < len; at += piece) {
+        size_t n = len - at < piece ? len - at : piece;
+        if (json_stream_feed(&p, doc + at, n) != ESP_OK) {
+            return p.error;
+        }
+    }
+    return json_stream_finish(&p);
+}
+
+static void check_parser(void)
+{
+    printf("  streaming JSON parser\n");
+    weather_t w, w2;
+    memset(&w, 0, sizeof(w));
+    check(parse_in_pieces(&s_weather_schema, &w, s_weather_json, 4096) == ESP_OK, "weather parsed");
+    check(w.temp > 11.39f && w.temp < 11.41f && w.code == 3 && w.is_day && strcmp(w.time, "2025-10-19T12:00") == 0,
+          "current values");
+    check(w.days == 3 && w.day[1].max > 9.79f && w.day[1].max < 9.81f && w.day[2].min < -1.49f && w.day[2].min > -1.51f &&
+          w.day[2].code == 71, "three days of the four, by index");
+
+    static const size_t pieces[] = { 1, 2, 3, 7, 64 };
+    bool same = true;
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        memset(&w2, 0, sizeof(w2));
+        same = same && parse_in_pieces(&s_weather_schema, &w2, s_weather_json, pieces[i]) == ESP_OK &&
+               memcmp(&w, &w2, sizeof(w)) == 0;
+    }
+    check(same, "same result fed 1, 2, 3, 7 and 64 bytes at a time");
+
+    calendar_t c;
+    memset(&c, 0, sizeof(c));
+    check(parse_in_pieces(&s_calendar_schema, &c, s_calendar_json, 5) == ESP_OK, "calendar parsed");
+    check(c.count == 4, "fifth event beyond the four kept");
+    check(strcmp(c.ev[0].summary, "Dentysta \xe2\x80\x93 wizyta") == 0, "\\u2013 decoded to UTF-8");
+    check(strcmp(c.ev[0].start, "2025-10-20T09:30:00+02:00") == 0 && strcmp(c.ev[1].day, "2025-10-22") == 0,
+          "nested start fields");
+    check(strcmp(c.ev[2].summary, "Przegl\xc4\x85\x64 samochodu \xc5\xbc") == 0,
+          "long summary cut before a character that does not fit whole");
+    check(strcmp(c.ev[3].summary, "Escapes \"\\/\n\t") == 0, "escapes");
+    check(strcmp(c.ev[0].summary, "x") != 0, "summary of an attendee not taken for the event's");
+
+    static const struct {
+        const char *doc;
+        esp_err_t error;
+    } bad[] = {
+        { "{\"current\":{\"temperature_2m\":tru}}", ESP_ERR_INVALID_RESPONSE },
+        { "{\"current\" {}}", ESP_ERR_INVALID_RESPONSE },
+        { "{\"daily\":[1,2", ESP_ERR_INVALID_RESPONSE },
+        { "{\"a\":1}}", ESP_ERR_INVALID_RESPONSE },
+        { "{\"a\":\"x\\q\"}", ESP_ERR_INVALID_RESPONSE },
+        { "{\"a\":\"x\\u12G4\"}", ESP_ERR_INVALID_RESPONSE },
+        { "{\"a\":[1,]}", ESP_ERR_INVALID_RESPONSE },
+        { "[[[[[[[[[1]]]]]]]]]", ESP_ERR_INVALID_SIZE },
+        { "{\"a\":123456789012345678901234567890123456}", ESP_ERR_INVALID_SIZE },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        char what[64];
+        snprintf(what, sizeof(what), "malformed document %zu refused", i);
+        memset(&w2, 0, sizeof(w2));
+        check(parse_in_pieces(&s_weather_schema, &w2, bad[i].doc, 3) == bad[i].error, what);
+    }
+    check(parse_in_pieces(&s_weather_schema, &w2, " 42 ", 1) == ESP_OK &&
+          parse_in_pieces(&s_weather_schema, &w2, "[]", 1) == ESP_OK, "scalar and empty documents");
+}
+
+/* Stand-in server: one connection at a time, answers by path */
+
+static struct {
+    int listen_fd;
+    uint16_t port;
+    int accepts;
+    int requests;
+    volatile bool drop_after_next;                                                                          /*!< Close the connection after the next answer, without saying so */
+} s_srv;
+
+static void write_slowly(int fd, const char *data, size_t len, size_t piece)
+{
+    for (size_t at = 0; at < len; at += piece) {
+        size_t n = len - at < piece ? len - at : piece;
+        if (send(fd, data + at, n, MSG_NOSIGNAL) < 0) {
+            return;
+        }
+        usleep(50);
+    }
+}
+
+static void header_of(const char *req, const char *name, char *out, size_t size)
+{
+    out[0] = '\0';
+    const char *at = strstr(req, name);
+    if (!at) {
+        return;
+    }
+    at += strlen(name);
+    const char *end = strstr(at, "\r\n");
+    size_t len = end ? (size_t)(end - at) : 0;
+    if (len < size) {
+        memcpy(out, at, len);
+        out[len] = '\0';
+    }
+}
+
+// false: close the connection
+static bool answer(int fd, const char *req)
+{
+    char path[64], etag[64], since[64], head[512];
+    if (sscanf(req, "GET %63s HTTP/1.1", path) != 1) {
+        return false;
+    }
+    header_of(req, "If-None-Match: ", etag, sizeof(etag));
+    header_of(req, "If-Modified-Since: ", since, sizeof(since));
+    s_srv.requests++;
+
+    if (strcmp(path, "/weather") == 0) {
+        if (strcmp(etag, WEATHER_ETAG) == 0) {
+            int n = snprintf(head, sizeof(head), "HTTP/1.1 304 Not Modified\r\nETag: " WEATHER_ETAG "\r\n\r\n");
+            write_slowly(fd, head, n, 64);
+            return true;
+        }
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nETag: " WEATHER_ETAG "\r\n"
+                         "Content-Length: %zu\r\nX-Padding: %0150d\r\n\r\n", strlen(s_weather_json), 0);
+        write_slowly(fd, head, n, 11);
+        write_slowly(fd, s_weather_json, strlen(s_weather_json), 7);
+        return true;
+    }
+    if (strcmp(path, "/calendar") == 0) {
+        if (strcmp(since, CALENDAR_DATE) == 0) {
+            write_slowly(fd, "HTTP/1.1 304 Not Modified\r\n\r\n", 29, 64);
+            return true;
+        }
+        int n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nLast-Modified: "
+                         CALENDAR_DATE "\r\n\r\n");
+        write_slowly(fd, head, n, 64);
+        size_t len = strlen(s_calendar_json);
+        size_t chunk = 1;
+        for (size_t at = 0; at < len; at += chunk, chunk = chunk % 13 + 1) {
+            size_t c = len - at < chunk ? len - at : chunk;
+            n = snprintf(head, sizeof(head), at == 0 ? "%zx;ext=1\r\n" : "%zx\r\n", c);
+            write_slowly(fd, head, n, 64);
+            write_slowly(fd, s_calendar_json + at, c, 64);
+            write_slowly(fd, "\r\n", 2, 64);
+        }
+        write_slowly(fd, "0\r\nX-Trailer: 1\r\n\r\n", 19, 64);
+        return true;
+    }
+    if (strcmp(path, "/broken") == 0) {
+        static const char body[] = "{\"current\":{\"temperature_2m\":-40,";
+        int n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%s", strlen(body), body);
+        write_slowly(fd, head, n, 64);
+        return true;
+    }
+    if (strcmp(path, "/bye") == 0) {
+        static const char bye[] = "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n{\"current\":{\"weather_code\":99}}";
+        write_slowly(fd, bye, strlen(bye), 64);
+        return false;
+    }
+    static const char missing[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nno such\r\n";
+    write_slowly(fd, missing, strlen(missing), 64);
+    return true;
+}
+
+static void *server_main(void *arg)
+{
+    while (true) {
+        int fd = accept(s_srv.listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        s_srv.accepts++;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        char req[1024];
+        size_t len = 0;
+        while (true) {
+            ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+            if (n <= 0) {
+                break;
+            }
+            len += n;
+            req[len] = '\0';
+            char *end = strstr(req, "\r\n\r\n");
+            if (!end) {
+                continue;
+            }
+            bool keep = answer(fd, req);
+            size_t used = end + 4 - req;
+            memmove(req, req + used, len - used + 1);
+            len -= used;
+            if (!keep || s_srv.drop_after_next) {
+                s_srv.drop_after_next = false;
+                break;
+            }
+        }
+        close(fd);
+    }
+}
+
+static bool server_up(pthread_t *thread)
+{
+    s_srv.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (s_srv.listen_fd < 0 || bind(s_srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(s_srv.listen_fd, 4) != 0 || getsockname(s_srv.listen_fd, (struct sockaddr *)&addr, &len) != 0) {
+        return false;
+    }
+    s_srv.port = ntohs(addr.sin_port);
+    return pthread_create(thread, NULL, server_main, NULL) == 0;
+}
+
+static void check_http(void)
+{
+    printf("  HTTP against the stand-in server\n");
+    pthread_t thread;
+    if (!server_up(&thread)) {
+        check(false, "stand-in server started");
+        return;
+    }
+    data_fetch_t client;
+    data_fetch_config_t config = { .host = "127.0.0.1", .port = s_srv.port, .timeout_ms = 2000 };
+    check(data_fetch_init(&client, &config) == ESP_OK, "client set up");
+
+    static weather_t weather, weather_scratch;
+    static calendar_t calendar, calendar_scratch;
+    data_fetch_resource_t w = { .path = "/weather", .schema = &s_weather_schema, .target = &weather,
+                                .scratch = &weather_scratch, .size = sizeof(weather) };
+    data_fetch_resource_t c = { .path = "/calendar", .schema = &s_calendar_schema, .target = &calendar,
+                                .scratch = &calendar_scratch, .size = sizeof(calendar) };
+
+    check(data_fetch_get(&client, &w) == ESP_OK && w.status == 200 && weather.code == 3 && weather.days == 3,
+          "weather fetched and parsed");
+    check(strcmp(w.etag, WEATHER_ETAG) == 0, "ETag kept");
+    check(data_fetch_get(&client, &c) == ESP_OK && c.status == 200 && calendar.count == 4 &&
+          strcmp(calendar.ev[1].summary, "Urodziny Ani") == 0, "chunked calendar fetched and parsed");
+    check(strcmp(c.last_modified, CALENDAR_DATE) == 0, "Last-Modified kept");
+
+    weather.temp = 99;
+    check(data_fetch_get(&client, &w) == ESP_OK && w.status == 304 && weather.temp == 99, "unchanged weather: 304");
+    check(data_fetch_get(&client, &c) == ESP_OK && c.status == 304, "unchanged calendar: 304");
+    check(s_srv.accepts == 1, "four requests over one connection");
+
+    /* The server drops the kept connection after an answer, as on its idle timeout */
+    s_srv.drop_after_next = true;
+    check(data_fetch_get(&client, &c) == ESP_OK && c.status == 304, "answer before the drop");
+    usleep(20000);
+    check(data_fetch_get(&client, &w) == ESP_OK && w.status == 304, "request after the drop answered");
+    check(s_srv.accepts == 2 && client.stats.stale_retries == 1, "sent again over a new connection");
+
+    check(data_fetch_get(&client, &(data_fetch_resource_t){ .path = "/missing", .schema = &s_weather_schema,
+                                                            .target = &weather_scratch, .size = sizeof(weather) })
+              == ESP_ERR_INVALID_RESPONSE, "404 is an error");
+    memset(w.etag, 0, sizeof(w.etag));
+    check(data_fetch_get(&client, &w) == ESP_OK && w.status == 200 && s_srv.accepts == 2,
+          "connection still used after the 404 body was read");
+
+    data_fetch_resource_t broken = w;
+    broken.path = "/broken";
+    weather.temp = 11;
+    check(data_fetch_get(&client, &broken) == ESP_ERR_INVALID_RESPONSE && weather.temp == 11,
+          "truncated document refused, target as it was");
+
+    data_fetch_resource_t bye = w;
+    bye.path = "/bye";
+    check(data_fetch_get(&client, &bye) == ESP_OK && weather.code == 99 && client.conn == NULL,
+          "Connection: close honoured");
+    check(data_fetch_get(&client, &c) == ESP_OK && s_srv.accepts == 3, "next request on a new connection");
+
+    data_fetch_stats_t st;
+    data_fetch_get_stats(&client, &st);
+    printf("    requests %" PRIu32 "  connects %" PRIu32 "  stale retries %" PRIu32 "  not modified %" PRIu32
+           "  errors %" PRIu32 "  body bytes %" PRIu64 "\n",
+           st.requests, st.connects, st.stale_retries, st.not_modified, st.errors, st.body_bytes);
+    printf("    state: client %zu B, parser %zu B; documents %zu and %zu B\n", sizeof(data_fetch_t),
+           sizeof(json_stream_t), strlen(s_weather_json), strlen(s_calendar_json));
+    check(st.requests == 11 && st.errors == 2, "counters");
+
+    data_fetch_close(&client);
+    shutdown(s_srv.listen_fd, SHUT_RDWR);
+    close(s_srv.listen_fd);
+    pthread_join(thread, NULL);
+}
+
+int main(void)
+{
+    printf("Data fetching\n");
+    check_parser();
+    check_http();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/*
+ * DFPlayer driver (components/dfplayer) against a model of the module on the mock UART, on the host clock:
+ *   - commands are queued without blocking and go out one at a time, command_gap_ms apart, each acknowledged
+ *   - a track makes the player busy until it is reported finished, once although the module reports it twice
+ *   - an answer with a broken checksum is counted and the command sent again; a command garbled on the line is
+ *     refused by the module with error 4 and sent again
+ *   - ACKs that never come end in a timeout event after the retries; a missing track in an error event
+ *   - status replies, noise on the line before a frame, a full queue
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "uart_mock.h"
+#include "uart_mock_models.h"
+#include "dfplayer.h"
+
+#define CHECK_PORT      UART_NUM_2
+#define CHECK_TRACK_MS  2000
+#define MAX_EVENTS      16
+
+static int s_failures;
+static uart_mock_dfplayer_t s_module;
+static dfplayer_handle_t s_player;
+static dfplayer_event_t s_events[MAX_EVENTS];
+static int s_event_count;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void on_event(const dfplayer_event_t *event, void *ctx)
+{
+    if (s_event_count < MAX_EVENTS) {
+        s_events[s_event_count] = *event;
+    }
+    s_event_count++;
+}
+
+static int events_of(dfplayer_event_type_t type)
+{
+    int n = 0;
+    for (int i = 0; i < s_event_count && i < MAX_EVENTS; i++) {
+        n += s_events[i].type == type;
+    }
+    return n;
+}
+
+static const dfplayer_event_t *last_event(void)
+{
+    return s_event_count > 0 && s_event_count <= MAX_EVENTS ? &s_events[s_event_count - 1] : NULL;
+}
+
+/**
+ * @brief Drive the driver as its task would, for ms of host time
+ */
+static void run(int ms)
+{
+    int64_t end = esp_timer_get_time() + ms * 1000LL;
+    while (esp_timer_get_time() < end) {
+        dfplayer_process(s_player, 20);
+    }
+}
+
+static void player_up(void)
+{
+    host_clock_reset();
+    uart_mock_reset();
+    uart_mock_dfplayer_init(&s_module, CHECK_PORT);
+    s_module.track_ms[1] = CHECK_TRACK_MS;
+    s_module.track_ms[2] = CHECK_TRACK_MS / 2;
+    uart_mock_attach(CHECK_PORT, &s_module.base);
+    s_event_count = 0;
+
+    dfplayer_config_t config = DFPLAYER_DEFAULT_CONFIG();
+    config.uart_port = CHECK_PORT;
+    config.task_stack = 0;
+    config.event_cb = on_event;
+    check(dfplayer_create(&config, &s_player) == ESP_OK, "driver set up");
+}
+
+static void player_down(void)
+{
+    dfplayer_stats_t st;
+    dfplayer_get_stats(s_player, &st);
+    printf("    sent %" PRIu32 "  acked %" PRIu32 "  retries %" PRIu32 "  timeouts %" PRIu32 "  errors %" PRIu32
+           "  bad frames %" PRIu32 "  dropped %" PRIu32 "  finished %" PRIu32 "\n",
+           st.sent, st.acked, st.retries, st.timeouts, st.errors, st.bad_frames, st.dropped, st.finished);
+    check(dfplayer_delete(s_player) == ESP_OK, "driver removed");
+}
+
+static void check_playback(void)
+{
+    printf("  playback\n");
+    player_up();
+    int64_t t0 = esp_timer_get_time();
+    check(dfplayer_set_volume(s_player, 20) == ESP_OK && dfplayer_play_mp3(s_player, 1) == ESP_OK, "commands queued");
+    check(esp_timer_get_time() == t0, "queuing does not block");
+    check(dfplayer_set_volume(s_player, DFPLAYER_VOLUME_MAX + 1) == ESP_ERR_INVALID_ARG, "volume above 30 refused");
+
+    run(200);
+    dfplayer_stats_t st;
+    dfplayer_get_stats(s_player, &st);
+    check(s_module.volume == 20 && s_module.state == 1 && s_module.track == 1, "volume set, track 1 playing");
+    check(st.sent == 2 && st.acked == 2, "both commands acknowledged");
+    check(s_module.log[1].at_us - s_module.log[0].at_us >= 30000, "commands at least the gap apart");
+    check(dfplayer_is_busy(s_player), "busy while the track plays");
+
+    run(CHECK_TRACK_MS);
+    dfplayer_get_stats(s_player, &st);
+    check(events_of(DFPLAYER_EVENT_FINISHED) == 1 && st.finished == 1, "finished reported once");
+    check(last_event() && last_event()->type == DFPLAYER_EVENT_FINISHED && last_event()->param == 1, "track 1 finished");
+    check(!dfplayer_is_busy(s_player), "not busy once finished");
+
+    dfplayer_query_status(s_player);
+    run(100);
+    check(last_event() && last_event()->type == DFPLAYER_EVENT_REPLY && last_event()->cmd == DFPLAYER_CMD_QUERY_STATUS &&
+          last_event()->param == 0, "status reply: stopped");
+
+    /* Stopped halfway: no finished event, not busy */
+    dfplayer_play(s_player, 2);
+    run(300);
+    check(dfplayer_is_busy(s_player), "busy again");
+    dfplayer_stop(s_player);
+    run(CHECK_TRACK_MS);
+    check(!dfplayer_is_busy(s_player) && events_of(DFPLAYER_EVENT_FINISHED) == 1, "stopped track not reported finished");
+    player_down();
+}
+
+static void check_faults(void)
+{
+    printf("  faults on the line\n");
+    player_up();
+    dfplayer_stats_t st;
+
+    s_module.corrupt_replies = 1;
+    dfplayer_set_volume(s_player, 10);
+    run(1000);
+    dfplayer_get_stats(s_player, &st);
+    check(st.bad_frames == 1 && st.retries == 1 && st.acked == 1, "broken ACK counted and the command sent again");
+    check(s_module.volume == 10 && s_event_count == 0, "volume set after the retry");
+
+    s_module.garble_commands = 1;
+    dfplayer_set_volume(s_player, 12);
+    run(1000);
+    dfplayer_get_stats(s_player, &st);
+    check(st.errors == 1 && st.retries == 2 && st.acked == 2 && s_module.volume == 12, "error 4 answered by sending again");
+
+    s_module.drop_acks = 3;
+    dfplayer_pause(s_player);
+    run(1000);
+    dfplayer_get_stats(s_player, &st);
+    check(st.timeouts == 1 && st.retries == 4, "unacknowledged command given up after 2 retries");
+    check(last_event() && last_event()->type == DFPLAYER_EVENT_TIMEOUT && last_event()->cmd == DFPLAYER_CMD_PAUSE,
+          "timeout event for the pause");
+
+    dfplayer_play_mp3(s_player, 9);
+    run(300);
+    check(last_event() && last_event()->type == DFPLAYER_EVENT_ERROR && last_event()->cmd == DFPLAYER_CMD_PLAY_MP3 &&
+          last_event()->param == DFPLAYER_ERR_NOT_FOUND, "missing track reported as error 6");
+    check(!dfplayer_is_busy(s_player), "not busy after a failed play");
+
+    static const uint8_t noise[] = { 0x00, 0xEF, 0x7E, 0x13, 0xFF };
+    uart_mock_send(CHECK_PORT, esp_timer_get_time(), noise, sizeof(noise));
+    uart_mock_dfplayer_notify(&s_module, DFPLAYER_MSG_ONLINE, 0x02);
+    run(100);
+    check(last_event() && last_event()->type == DFPLAYER_EVENT_ONLINE && last_event()->param == 0x02,
+          "frame found after noise");
+    player_down();
+}
+
+static void check_queue(void)
+{
+    printf("  full queue\n");
+    player_up();
+    int refused = 0;
+    for (int i = 0; i < 10; i++) {
+        refused += dfplayer_set_volume(s_player, i) == ESP_ERR_TIMEOUT;
+    }
+    dfplayer_stats_t st;
+    dfplayer_get_stats(s_player, &st);
+    check(refused == 2 && st.dropped == 2, "commands beyond the queue length refused and counted");
+    run(1000);
+    dfplayer_get_stats(s_player, &st);
+    check(st.acked == 8 && s_module.volume == 7, "queued commands all sent in order");
+    player_down();
+}
+
+int main(void)
+{
+    printf("DFPlayer driver on the mock UART\n");
+    check_playback();
+    check_faults();
+    check_queue();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Device discovery (components/i2c_discovery) against the models of the mock I2C bus (host/i2c_bus_mock), with NVS
+ * in memory (shim/nvs.h):
+ *   - identification: BME280 and BMP280 by chip-id, an unexpected chip-id left out, BH1750 by its power-on opcode,
+ *     SH1106 and SSD1306 by the low nibble of the status byte, whether the panel is on or off; alternate addresses
+ *     and a second bus; a full scan also reports what it cannot identify
+ *   - the cache: the next run only probes the cached addresses, a different layout_id scans again, a cached device
+ *     that no longer answers scans again and stores the new result, a bind that fails on a cached device scans
+ *     and binds in the same run without binding the other devices twice
+ * Exit status is non-zero if a check fails.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "i2c_bus.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "i2c_discovery.h"
+#include "nvs.h"
+
+#define CHECK_SDA_IO    21
+#define CHECK_SCL_IO    22
+#define CHECK_LAYOUT_ID 7
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+typedef struct {
+    i2c_mock_bme280_t bme;
+    i2c_mock_bh1750_t bh;
+    i2c_mock_oled_t oled;
+    i2c_bus_handle_t bus[2];
+    int binds[I2C_CHIP_MAX];
+    i2c_chip_t fail_chip;                                                                                   /*!< Bind of this chip fails, I2C_CHIP_UNKNOWN: none */
+} rig_t;
+
+static rig_t s_rig;
+
+static esp_err_t bind(i2c_bus_handle_t bus, const i2c_discovery_entry_t *entry, void *user_ctx)
+{
+    rig_t *g = user_ctx;
+    g->binds[entry->chip]++;
+    return entry->chip == g->fail_chip ? ESP_ERR_INVALID_RESPONSE : ESP_OK;
+}
+
+static i2c_bus_handle_t bus_up(i2c_port_t port)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CHECK_SDA_IO,
+        .scl_io_num = CHECK_SCL_IO,
+        .sda_pullup_en = true,
+        .scl_pullup_en = true,
+        .master.clk_speed = 400000,
+    };
+    return i2c_bus_create(port, &conf);
+}
+
+static void rig_up(void)
+{
+    rig_t *g = &s_rig;
+    i2c_mock_reset();
+    memset(g, 0, sizeof(*g));
+    g->bus[0] = bus_up(I2C_NUM_0);
+    g->bus[1] = bus_up(I2C_NUM_1);
+}
+
+static void rig_down(void)
+{
+    i2c_bus_delete(&s_rig.bus[0]);
+    i2c_bus_delete(&s_rig.bus[1]);
+}
+
+static i2c_discovery_config_t config(size_t bus_num, bool use_cache)
+{
+    i2c_discovery_config_t conf = {
+        .buses = { s_rig.bus[0], s_rig.bus[1] },
+        .bus_num = bus_num,
+        .use_cache = use_cache,
+        .layout_id = CHECK_LAYOUT_ID,
+        .user_ctx = &s_rig,
+    };
+    for (int chip = I2C_CHIP_UNKNOWN + 1; chip < I2C_CHIP_MAX; chip++) {
+        conf.bind[chip] = bind;
+    }
+    return conf;
+}
+
+static bool found_at(const i2c_discovery_result_t *res, i2c_chip_t chip, uint8_t bus_index, uint8_t addr)
+{
+    const i2c_discovery_entry_t *e = i2c_discovery_find(res, chip);
+    return e && e->bus_index == bus_index && e->addr == addr;
+}
+
+static void check_identify(void)
+{
+    printf("  identification\n");
+    rig_t *g = &s_rig;
+    i2c_discovery_result_t res;
+
+    /* Primary addresses: BME280, BH1750, SSD1306 */
+    rig_up();
+    i2c_mock_bme280_init(&g->bme, 0x76, 0x60);
+    i2c_mock_bh1750_init(&g->bh, 0x23);
+    i2c_mock_oled_init(&g->oled, 0x3C, false);
+    i2c_mock_attach(I2C_NUM_0, &g->bme.base);
+    i2c_mock_attach(I2C_NUM_0, &g->bh.base);
+    i2c_mock_attach(I2C_NUM_0, &g->oled.base);
+    i2c_discovery_config_t conf = config(1, false);
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.count == 3 && !res.from_cache, "three devices found");
+    check(found_at(&res, I2C_CHIP_BME280, 0, 0x76), "BME280 by chip-id 0x60");
+    check(found_at(&res, I2C_CHIP_BH1750, 0, 0x23), "BH1750 by its power-on opcode");
+    check(found_at(&res, I2C_CHIP_SSD1306, 0, 0x3C), "SSD1306 by its status byte");
+    check(g->binds[I2C_CHIP_BME280] == 1 && g->binds[I2C_CHIP_BH1750] == 1 && g->binds[I2C_CHIP_SSD1306] == 1,
+          "each device bound once");
+    bool all_bound = true;
+    for (size_t i = 0; i < res.count; i++) {
+        all_bound = all_bound && res.entries[i].bound;
+    }
+    check(all_bound, "entries marked bound");
+    rig_down();
+
+    /* Alternate addresses: BMP280, BH1750 with ADDR high, SH1106; the panel on the second bus */
+    static const uint8_t bmp_ids[] = { 0x56, 0x57, 0x58 };
+    for (size_t i = 0; i < sizeof(bmp_ids); i++) {
+        rig_up();
+        i2c_mock_bme280_init(&g->bme, 0x77, bmp_ids[i]);
+        i2c_mock_bh1750_init(&g->bh, 0x5C);
+        i2c_mock_oled_init(&g->oled, 0x3D, true);
+        i2c_mock_attach(I2C_NUM_0, &g->bme.base);
+        i2c_mock_attach(I2C_NUM_0, &g->bh.base);
+        i2c_mock_attach(I2C_NUM_1, &g->oled.base);
+        conf = config(2, false);
+        check(i2c_discovery_run(&conf, &res) == ESP_OK && res.count == 3, "three devices on two buses");
+        check(found_at(&res, I2C_CHIP_BMP280, 0, 0x77), "BMP280 by chip-id 0x56-0x58");
+        check(found_at(&res, I2C_CHIP_BH1750, 0, 0x5C), "BH1750 at 0x5C");
+        check(found_at(&res, I2C_CHIP_SH1106, 1, 0x3D), "SH1106 by its status byte, on the second bus");
+        rig_down();
+    }
+
+    /* The status byte tells the controllers apart with the panel on as well as off */
+    for (int sh1106 = 0; sh1106 <= 1; sh1106++) {
+        rig_up();
+        i2c_mock_oled_init(&g->oled, 0x3C, sh1106);
+        g->oled.display_on = true;
+        i2c_mock_attach(I2C_NUM_0, &g->oled.base);
+        conf = config(1, false);
+        i2c_discovery_run(&conf, &res);
+        check(res.count == 1 && res.entries[0].chip == (sh1106 ? I2C_CHIP_SH1106 : I2C_CHIP_SSD1306),
+              sh1106 ? "SH1106 with the panel on" : "SSD1306 with the panel on");
+        rig_down();
+    }
+
+    /* A chip-id of neither: left out of a fast scan, reported as unknown by a full scan */
+    rig_up();
+    i2c_mock_bme280_init(&g->bme, 0x76, 0x61);
+    i2c_mock_bh1750_init(&g->bh, 0x50);
+    i2c_mock_attach(I2C_NUM_0, &g->bme.base);
+    i2c_mock_attach(I2C_NUM_0, &g->bh.base);
+    conf = config(1, false);
+    i2c_discovery_run(&conf, &res);
+    check(res.count == 0, "unexpected chip-id and unknown address left out of a fast scan");
+    conf.full_scan = true;
+    i2c_discovery_run(&conf, &res);
+    check(res.count == 2 && res.entries[0].addr == 0x50 && res.entries[0].chip == I2C_CHIP_UNKNOWN &&
+          res.entries[1].addr == 0x76 && res.entries[1].chip == I2C_CHIP_UNKNOWN,
+          "full scan reports both as unknown, in address order");
+    check(g->binds[I2C_CHIP_UNKNOWN] == 0, "unknown devices not bound");
+    rig_down();
+}
+
+static void check_cache(void)
+{
+    printf("  cache\n");
+    rig_t *g = &s_rig;
+    i2c_discovery_result_t res;
+    host_nvs_erase_all();
+    rig_up();
+    i2c_mock_bme280_init(&g->bme, 0x76, 0x60);
+    i2c_mock_bh1750_init(&g->bh, 0x23);
+    i2c_mock_oled_init(&g->oled, 0x3C, false);
+    i2c_mock_attach(I2C_NUM_0, &g->bme.base);
+    i2c_mock_attach(I2C_NUM_0, &g->bh.base);
+    i2c_mock_attach(I2C_NUM_0, &g->oled.base);
+    i2c_discovery_config_t conf = config(1, true);
+
+    /* First run scans and stores, the second one only addresses the three cached devices */
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.count == 3 && !res.from_cache, "first run scans");
+    uint32_t scan_txns = i2c_mock_log_total();
+    i2c_mock_log_clear();
+    memset(g->binds, 0, sizeof(g->binds));
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.count == 3 && res.from_cache, "second run from the cache");
+    check(found_at(&res, I2C_CHIP_BME280, 0, 0x76) && found_at(&res, I2C_CHIP_BH1750, 0, 0x23) &&
+          found_at(&res, I2C_CHIP_SSD1306, 0, 0x3C), "cached devices as scanned");
+    check(i2c_mock_log_total() == 3, "one probe per cached device, nothing identified again");
+    check(g->binds[I2C_CHIP_BME280] == 1 && g->binds[I2C_CHIP_BH1750] == 1 && g->binds[I2C_CHIP_SSD1306] == 1,
+          "cached devices bound");
+    printf("    scan %u transactions, from the cache %u\n", (unsigned)scan_txns, (unsigned)i2c_mock_log_total());
+
+    /* Another layout_id: the cache is not used */
+    conf.layout_id = CHECK_LAYOUT_ID + 1;
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache && res.count == 3, "new layout_id scans");
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.from_cache, "and stores under the new layout_id");
+    conf.layout_id = CHECK_LAYOUT_ID;
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache, "the old layout_id is gone");
+
+    /* The BH1750 is unplugged: its probe is NACKed, the buses are scanned and the result without it stored */
+    i2c_mock_detach(I2C_NUM_0, 0x23);
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache && res.count == 2,
+          "NACK on a cached device rescans");
+    check(i2c_discovery_find(&res, I2C_CHIP_BH1750) == NULL, "the missing device is not in the result");
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.from_cache && res.count == 2, "the new result is cached");
+
+    /* A fault that NACKs only the cache probe, not a later scan */
+    i2c_mock_fault_t nack = { .addr = 0x76, .count = 1, .err = ESP_FAIL };
+    i2c_mock_inject(I2C_NUM_0, &nack);
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache && res.count == 2 &&
+          found_at(&res, I2C_CHIP_BME280, 0, 0x76), "one NACK rescans and finds the device again");
+    i2c_mock_clear_faults();
+
+    /* The panel is swapped for an SH1106 at the same address: the probe answers, the SSD1306 driver refuses it, and
+     * the same run scans, binds the SH1106 and stores it; the BME280 bound from the cache is not bound twice */
+    i2c_mock_detach(I2C_NUM_0, 0x3C);
+    i2c_mock_oled_init(&g->oled, 0x3C, true);
+    i2c_mock_attach(I2C_NUM_0, &g->oled.base);
+    g->fail_chip = I2C_CHIP_SSD1306;
+    memset(g->binds, 0, sizeof(g->binds));
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache && res.count == 2,
+          "failed bind rescans in the same run");
+    const i2c_discovery_entry_t *oled = i2c_discovery_find(&res, I2C_CHIP_SH1106);
+    check(oled && oled->addr == 0x3C && oled->bound && i2c_discovery_find(&res, I2C_CHIP_SSD1306) == NULL,
+          "the new panel is bound at once");
+    check(g->binds[I2C_CHIP_BME280] == 1 && g->binds[I2C_CHIP_SSD1306] == 1 && g->binds[I2C_CHIP_SH1106] == 1,
+          "each driver called once");
+    check(found_at(&res, I2C_CHIP_BME280, 0, 0x76) && i2c_discovery_find(&res, I2C_CHIP_BME280)->bound,
+          "the device bound from the cache stays bound");
+    g->fail_chip = I2C_CHIP_UNKNOWN;
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && res.from_cache && found_at(&res, I2C_CHIP_SH1106, 0, 0x3C),
+          "the rescanned result is cached");
+
+    /* Dropped by hand */
+    check(i2c_discovery_invalidate_cache() == ESP_OK, "invalidate");
+    check(i2c_discovery_run(&conf, &res) == ESP_OK && !res.from_cache, "invalidated cache scans");
+    rig_down();
+}
+
+int main(void)
+{
+    printf("I2C device discovery on the mock bus\n");
+    check_identify();
+    check_cache();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
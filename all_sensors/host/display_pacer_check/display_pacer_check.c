@@ -0,0 +1,278 @@
+/*
+ * Frame pacing (components/display_pacer) of an SSD1306 128x64 on the mock I2C bus (legacy backend), on the host
+ * clock:
+ *   - a clock line that changes once a second at 10 fps: one page per change, nothing sent in between, idle after
+ *     the configured time without changes and one slot per second from then on, back at full rate on a kick
+ *   - a full screen animation at 60 fps, which the 400 kHz bus cannot carry: the pacer settles on every 2nd slot
+ *     and frames stay on the 60 Hz grid
+ *   - a render that runs late: the missed slots are dropped, not caught up
+ *   - a grid aligned to the second boundary, at full rate and idle
+ *   - a frame restored after deep sleep: nothing sent for it, the observer told of all of it
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "display_pacer.h"
+#include "ssd1306.h"
+
+#define CHECK_SDA_IO    21
+#define CHECK_SCL_IO    22
+#define RENDER_US       300                                                         /*!< Host clock charged per render */
+#define TICK_SLACK_US   10000                                                       /*!< Waits end on a FreeRTOS tick */
+
+static int s_failures;
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+static display_pacer_t s_pacer;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void panel_up(const display_pacer_config_t *config)
+{
+    i2c_mock_reset();
+    i2c_mock_oled_init(&s_oled, I2C_ADDRESS, false);
+    i2c_mock_attach(I2C_NUM_0, &s_oled.base);
+    memset(&s_dev, 0, sizeof(s_dev));
+    i2c_master_init(&s_dev, CHECK_SDA_IO, CHECK_SCL_IO, -1);
+    ssd1306_init(&s_dev, 128, 64);
+    check(display_pacer_init(&s_pacer, &s_dev, config) == ESP_OK, "pacer set up");
+}
+
+static bool ram_matches_buffer(void)
+{
+    for (int page = 0; page < s_dev._pages; page++) {
+        if (memcmp(s_oled.ram[page], s_dev._page[page]._segs, 128) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void report(const char *name, int64_t t0)
+{
+    display_pacer_stats_t st;
+    display_pacer_get_stats(&s_pacer, &st);
+    double seconds = (esp_timer_get_time() - t0) / 1e6;
+    printf("  %-10s %5.1f s  rendered %4" PRIu32 "  sent %4" PRIu32 "  clean %4" PRIu32 "  skipped %4" PRIu32
+           "  %7" PRIu64 " bytes  render %4" PRIu32 " us  transfer %5" PRIu32 " us (max %5" PRIu32 ")  every %u. slot%s\n",
+           name, seconds, st.frames_rendered, st.frames_sent, st.frames_clean, st.frames_skipped, st.bytes_sent,
+           st.render_us, st.transfer_us, st.transfer_max_us, st.divisor, st.idle ? ", idle" : "");
+}
+
+static void check_clock(void)
+{
+    display_pacer_config_t config = {
+        .target_fps = 10,
+        .idle_fps = 1,
+        .idle_after_ms = 3000,
+        .max_divisor = 4,
+    };
+    panel_up(&config);
+    display_pacer_stats_t st;
+    int64_t t0 = esp_timer_get_time();
+    char line[17];
+
+    /* 10 s of a clock: the second changes, nothing else does */
+    for (int frame = 0; frame < 100; frame++) {
+        display_pacer_wait(&s_pacer);
+        host_clock_advance_us(RENDER_US);
+        int len = snprintf(line, sizeof(line), "12:00:%02d", frame / 10);
+        _ssd1306_text(&s_dev, 0, line, len, false);
+        display_pacer_present(&s_pacer);
+    }
+    report("clock", t0);
+    display_pacer_get_stats(&s_pacer, &st);
+    check(ram_matches_buffer(), "display RAM matches the buffer");
+    check(esp_timer_get_time() - t0 < 10000000, "10 frames a second");
+    check(st.frames_sent == 10 && st.frames_clean == 90, "a frame sent per change only");
+    check(st.bytes_sent == 8 * 128 + 9 * 128, "first frame in full, then one page per change");
+    check(st.frames_skipped == 0 && st.divisor == 1, "nothing skipped on a light load");
+
+    /* Nothing changes any more: idle after 3 s, then one slot a second */
+    t0 = esp_timer_get_time();
+    uint32_t rendered0 = st.frames_rendered;
+    while (esp_timer_get_time() - t0 < 10000000) {
+        display_pacer_wait(&s_pacer);
+        host_clock_advance_us(RENDER_US);
+        display_pacer_present(&s_pacer);
+    }
+    report("static", t0);
+    display_pacer_get_stats(&s_pacer, &st);
+    check(st.idle, "idle without changes");
+    check(st.frames_sent == 10, "nothing sent without changes");
+    check(st.frames_rendered - rendered0 <= 30 + 8, "one slot a second once idle");
+
+    /* Kick: the next wait returns at once and the full rate is back */
+    display_pacer_kick(&s_pacer);
+    int64_t t1 = esp_timer_get_time();
+    display_pacer_wait(&s_pacer);
+    check(esp_timer_get_time() == t1, "kick ends the wait at once");
+    display_pacer_get_stats(&s_pacer, &st);
+    check(!st.idle, "kick leaves idle");
+    _ssd1306_text(&s_dev, 7, "motion", 6, true);
+    display_pacer_present(&s_pacer);
+    t1 = esp_timer_get_time();
+    display_pacer_wait(&s_pacer);
+    check(esp_timer_get_time() - t1 <= 100000, "full rate after the kick");
+    display_pacer_present(&s_pacer);
+    check(ram_matches_buffer(), "display RAM matches the buffer after the kick");
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+static void check_animation(void)
+{
+    display_pacer_config_t config = {
+        .target_fps = 60,
+        .idle_fps = 1,
+        .idle_after_ms = 3000,
+        .max_divisor = 4,
+    };
+    panel_up(&config);
+    display_pacer_stats_t st;
+    int64_t t0 = esp_timer_get_time();
+    int64_t period = 1000000 / config.target_fps;
+    bool on_grid = true;
+
+    /* Every page changes every frame: about 24 ms per frame on the bus against a 16.7 ms slot */
+    for (int frame = 0; frame < 120; frame++) {
+        display_pacer_wait(&s_pacer);
+        on_grid = on_grid && (esp_timer_get_time() - t0) % period < 10000;
+        host_clock_advance_us(RENDER_US);
+        for (int page = 0; page < 8; page++) {
+            memset(s_dev._page[page]._segs, (uint8_t)(frame * 8 + page), 128);
+        }
+        display_pacer_present(&s_pacer);
+    }
+    report("animation", t0);
+    display_pacer_get_stats(&s_pacer, &st);
+    double fps = st.frames_rendered / ((esp_timer_get_time() - t0) / 1e6);
+    check(st.divisor == 2, "full frames over I2C settle on every 2nd slot at 60 fps");
+    check(fps > 28 && fps <= 31, "30 frames a second");
+    check(on_grid, "frames start within a tick of the 60 Hz grid");
+    check(ram_matches_buffer(), "display RAM matches the buffer");
+
+    /* A render that takes 100 ms: the slots in between are dropped */
+    uint32_t skipped0 = st.frames_skipped;
+    uint32_t rendered0 = st.frames_rendered;
+    display_pacer_wait(&s_pacer);
+    host_clock_advance_us(100000);
+    display_pacer_present(&s_pacer);
+    display_pacer_wait(&s_pacer);
+    display_pacer_get_stats(&s_pacer, &st);
+    check(st.frames_rendered - rendered0 == 1 && st.frames_skipped - skipped0 >= 5, "late slots dropped, not caught up");
+    display_pacer_present(&s_pacer);
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+static void check_align(void)
+{
+    display_pacer_config_t config = DISPLAY_PACER_DEFAULT_CONFIG();
+    panel_up(&config);
+    display_pacer_stats_t st;
+    int64_t boundary = esp_timer_get_time() + 1234567;
+
+    /* Full rate: a slot starts on the boundary, the 100 ms grid runs through it */
+    display_pacer_wait(&s_pacer);
+    display_pacer_present(&s_pacer);
+    display_pacer_align(&s_pacer, boundary);
+    bool on_grid = true;
+    bool hit = false;
+    for (int frame = 0; frame < 20; frame++) {
+        display_pacer_wait(&s_pacer);
+        int64_t now = esp_timer_get_time();
+        on_grid = on_grid && ((now - boundary) % 100000 + 100000) % 100000 < TICK_SLACK_US;
+        hit = hit || (now >= boundary && now - boundary < TICK_SLACK_US);
+        host_clock_advance_us(RENDER_US);
+        display_pacer_present(&s_pacer);
+    }
+    check(on_grid && hit, "slots on the boundary grid at full rate");
+
+    /* Idle: one slot a second, on the boundary */
+    while (display_pacer_get_stats(&s_pacer, &st), !st.idle) {
+        display_pacer_wait(&s_pacer);
+        display_pacer_present(&s_pacer);
+    }
+    boundary = esp_timer_get_time() + 345678;
+    display_pacer_align(&s_pacer, boundary);
+    on_grid = true;
+    for (int frame = 0; frame < 5; frame++) {
+        display_pacer_wait(&s_pacer);
+        on_grid = on_grid && ((esp_timer_get_time() - boundary) % 1000000 + 1000000) % 1000000 < TICK_SLACK_US;
+        display_pacer_present(&s_pacer);
+    }
+    check(on_grid, "idle slots on the second boundary");
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+static int s_observed_pages;
+static bool s_observed_frame;
+
+static void on_frame(void *ctx, const uint8_t shown[][128], const display_pacer_region_t *regions, int count)
+{
+    const uint8_t (*expected)[128] = ctx;
+    s_observed_pages = count;
+    s_observed_frame = true;
+    for (int i = 0; i < count; i++) {
+        s_observed_frame = s_observed_frame && regions[i].col == 0 && regions[i].len == 128 &&
+                           memcmp(shown[regions[i].page], expected[regions[i].page], 128) == 0;
+    }
+}
+
+static void check_restore(void)
+{
+    display_pacer_config_t config = DISPLAY_PACER_DEFAULT_CONFIG();
+    panel_up(&config);
+    static uint8_t frame[8][128];
+    for (int page = 0; page < 8; page++) {
+        for (int col = 0; col < 128; col++) {
+            frame[page][col] = page * 31 + col;
+        }
+    }
+
+    /* The panel kept its RAM through deep sleep, the frame comes back from RTC memory */
+    for (int page = 0; page < 8; page++) {
+        memcpy(s_oled.ram[page], frame[page], 128);
+    }
+    display_pacer_set_observer(&s_pacer, on_frame, frame);
+    display_pacer_restore(&s_pacer, (const uint8_t (*)[128])frame);
+    check(s_observed_pages == 8 && s_observed_frame, "observer told of the whole restored frame");
+    check(ram_matches_buffer(), "frame buffer holds the restored frame");
+
+    uint32_t writes = s_oled.data_bytes;
+    display_pacer_wait(&s_pacer);
+    display_pacer_present(&s_pacer);
+    check(s_oled.data_bytes == writes, "restored frame not sent again");
+
+    ssd1306_display_text(&s_dev, 2, "restored", 8, false);
+    s_observed_pages = 0;
+    display_pacer_wait(&s_pacer);
+    display_pacer_present(&s_pacer);
+    check(s_observed_pages == 1 && ram_matches_buffer(), "a change after the restore sent alone");
+    display_pacer_set_observer(&s_pacer, NULL, NULL);
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+int main(void)
+{
+    printf("Display pacing, SSD1306 128x64 over I2C at 400 kHz\n");
+    check_clock();
+    check_animation();
+    check_align();
+    check_restore();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,1153 @@
+/*
+ * Host mock of the I2C bus, see i2c_bus_mock.h.
+ *
+ * The i2c_bus.h functions build command links exactly like components/i2c_bus/i2c_bus.c and hand them to the mocked
+ * legacy driver, which walks the links against the device models. Health accounting and bus recovery use the real
+ * i2c_bus_health.c: SDA and SCL of every configured port are modelled for gpio_get_level / gpio_set_level, so the
+ * line recovery sequence clocks a stuck device free just as it would on the board.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/i2c_master.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+#include "i2c_bus_health.h"
+#include "i2c_bus_trace.h"
+#include "i2c_bus_mock.h"
+
+#define I2C_ACK_CHECK_EN 0x1
+#define I2C_BUS_TICKS_TO_WAIT (CONFIG_I2C_MS_TO_WAIT / portTICK_PERIOD_MS)
+#define I2C_MOCK_BYTE_BITS 9                                                                                /*!< 8 data bits and the ACK */
+#define I2C_MOCK_CONDITION_BITS 1                                                                           /*!< A START or STOP costs about one SCL period */
+#define I2C_MOCK_WRITE_PHASE_MAX 2048                                                                       /*!< Longest write phase passed to a model */
+
+#if CONFIG_I2C_BUS_SUPPORT_SOFTWARE
+#define I2C_MOCK_PORT_NUM I2C_NUM_SW_MAX
+#define I2C_MOCK_PORT_VALID(port) ((port) >= 0 && ((port) < I2C_NUM_MAX || ((port) >= I2C_NUM_SW_0 && (port) < I2C_NUM_SW_MAX)))
+#else
+#define I2C_MOCK_PORT_NUM I2C_NUM_MAX
+#define I2C_MOCK_PORT_VALID(port) ((port) >= 0 && (port) < I2C_NUM_MAX)
+#endif
+
+static const char *TAG = "i2c_bus_mock";
+
+#define I2C_BUS_CHECK(a, str, ret) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        return (ret); \
+    }
+
+#define I2C_BUS_INIT_CHECK(is_init, ret) if(!is_init) { \
+        ESP_LOGE(TAG,"%s:%d (%s):i2c_bus has not inited", __FILE__, __LINE__, __FUNCTION__); \
+        return (ret); \
+    }
+
+/* ------------------------------------------------------------------------------------------------ bus model */
+
+typedef struct {
+    i2c_mock_fault_t fault;
+    uint32_t seen;                                                                                          /*!< Matching transactions so far */
+    uint32_t fired;                                                                                         /*!< Transactions affected so far */
+    bool used;
+} i2c_mock_fault_slot_t;
+
+typedef struct {
+    bool configured;                                                                                        /*!< i2c_param_config called */
+    bool installed;                                                                                         /*!< Driver installed */
+    i2c_config_t conf;
+    i2c_mock_model_t *models[I2C_MOCK_MAX_MODELS];
+    i2c_mock_fault_slot_t faults[I2C_MOCK_MAX_FAULTS];
+    uint32_t hold_clocks;                                                                                   /*!< Non-zero while a device holds SDA low */
+    uint32_t scl_level;                                                                                     /*!< Levels driven through gpio_set_level */
+    uint32_t sda_level;
+    uint64_t busy_us;
+} i2c_mock_port_t;
+
+static i2c_mock_port_t s_ports[I2C_MOCK_PORT_NUM];
+
+/* ------------------------------------------------------------------------------------------------ command links */
+
+typedef enum {
+    I2C_MOCK_OP_START,
+    I2C_MOCK_OP_WRITE,
+    I2C_MOCK_OP_READ,
+    I2C_MOCK_OP_STOP,
+} i2c_mock_op_kind_t;
+
+typedef struct {
+    i2c_mock_op_kind_t kind;
+    uint8_t *data;                                                                                          /*!< Write: private copy, read: destination */
+    size_t len;
+    bool ack_check;
+} i2c_mock_op_t;
+
+typedef struct {
+    i2c_mock_op_t *ops;
+    size_t num;
+    size_t cap;
+} i2c_mock_cmd_t;
+
+static int s_cmd_alive;
+
+/* ------------------------------------------------------------------------------------------------ transaction log */
+
+static i2c_mock_txn_t s_log[I2C_MOCK_LOG_SIZE];
+static uint32_t s_log_total;
+
+/* ------------------------------------------------------------------------------------------------ i2c_bus objects */
+
+typedef struct {
+    i2c_port_t i2c_port;
+    bool is_init;
+    i2c_config_t conf_active;
+    int32_t ref_counter;
+    uint32_t recoveries;
+} i2c_bus_t;
+
+typedef struct {
+    uint8_t dev_addr;
+    i2c_config_t conf;
+    i2c_bus_t *i2c_bus;
+    i2c_bus_health_t health;
+} i2c_bus_device_t;
+
+static i2c_bus_t s_i2c_bus[I2C_MOCK_PORT_NUM];
+
+/* ------------------------------------------------------------------------------------------------ i2c_master objects */
+
+typedef struct {
+    int64_t done_us;
+    i2c_master_dev_handle_t dev;
+    i2c_master_event_t event;
+} i2c_mock_master_pending_t;
+
+struct i2c_master_bus_t {
+    bool used;
+    i2c_port_t port;
+    size_t queue_depth;
+    int64_t free_us;                                                                                        /*!< Time the last queued transaction ends */
+    i2c_mock_master_pending_t pending[I2C_MOCK_MASTER_MAX_QUEUE];                                           /*!< Queued and not completed, oldest at head */
+    int head;
+    int count;
+};
+
+struct i2c_master_dev_t {
+    bool used;
+    struct i2c_master_bus_t *bus;
+    i2c_device_config_t conf;
+    i2c_master_callback_t on_trans_done;                                                                    /*!< Set: transfers are queued */
+    void *user_ctx;
+};
+
+static struct i2c_master_bus_t s_master_buses[I2C_NUM_MAX];
+static struct i2c_master_dev_t s_master_devs[I2C_MOCK_MAX_MODELS];
+
+/**************************************** Mock control *********************************************/
+
+void i2c_mock_reset(void)
+{
+    memset(s_ports, 0, sizeof(s_ports));
+    memset(s_i2c_bus, 0, sizeof(s_i2c_bus));
+    memset(s_master_buses, 0, sizeof(s_master_buses));
+    memset(s_master_devs, 0, sizeof(s_master_devs));
+    i2c_mock_log_clear();
+    i2c_bus_trace_clear();
+    host_clock_reset();
+}
+
+static i2c_mock_model_t *i2c_mock_find(i2c_mock_port_t *p, uint8_t addr)
+{
+    for (int i = 0; i < I2C_MOCK_MAX_MODELS; i++) {
+        if (p->models[i] && p->models[i]->addr == addr) {
+            return p->models[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t i2c_mock_attach(i2c_port_t port, i2c_mock_model_t *model)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(port), "I2C port error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(model != NULL && model->addr < 0x80, "model error", ESP_ERR_INVALID_ARG);
+    i2c_mock_port_t *p = &s_ports[port];
+    I2C_BUS_CHECK(i2c_mock_find(p, model->addr) == NULL, "address already used", ESP_ERR_INVALID_STATE);
+    for (int i = 0; i < I2C_MOCK_MAX_MODELS; i++) {
+        if (p->models[i] == NULL) {
+            p->models[i] = model;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_mock_detach(i2c_port_t port, uint8_t addr)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(port), "I2C port error", ESP_ERR_INVALID_ARG);
+    i2c_mock_port_t *p = &s_ports[port];
+    for (int i = 0; i < I2C_MOCK_MAX_MODELS; i++) {
+        if (p->models[i] && p->models[i]->addr == addr) {
+            p->models[i] = NULL;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_mock_inject(i2c_port_t port, const i2c_mock_fault_t *fault)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(port), "I2C port error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(fault != NULL, "fault error", ESP_ERR_INVALID_ARG);
+    i2c_mock_port_t *p = &s_ports[port];
+    for (int i = 0; i < I2C_MOCK_MAX_FAULTS; i++) {
+        if (!p->faults[i].used) {
+            p->faults[i] = (i2c_mock_fault_slot_t) {
+                .fault = *fault, .used = true,
+            };
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void i2c_mock_clear_faults(void)
+{
+    for (int port = 0; port < I2C_MOCK_PORT_NUM; port++) {
+        memset(s_ports[port].faults, 0, sizeof(s_ports[port].faults));
+    }
+}
+
+bool i2c_mock_sda_held(i2c_port_t port)
+{
+    return I2C_MOCK_PORT_VALID(port) && s_ports[port].hold_clocks != 0;
+}
+
+uint64_t i2c_mock_busy_us(i2c_port_t port)
+{
+    return I2C_MOCK_PORT_VALID(port) ? s_ports[port].busy_us : 0;
+}
+
+size_t i2c_mock_log_count(void)
+{
+    return s_log_total < I2C_MOCK_LOG_SIZE ? s_log_total : I2C_MOCK_LOG_SIZE;
+}
+
+uint32_t i2c_mock_log_total(void)
+{
+    return s_log_total;
+}
+
+const i2c_mock_txn_t *i2c_mock_log_get(size_t index)
+{
+    size_t count = i2c_mock_log_count();
+    if (index >= count) {
+        return NULL;
+    }
+    return &s_log[(s_log_total - count + index) % I2C_MOCK_LOG_SIZE];
+}
+
+void i2c_mock_log_clear(void)
+{
+    s_log_total = 0;
+}
+
+static void i2c_mock_dump_bytes(FILE *out, const uint8_t *data, size_t len)
+{
+    size_t shown = len < I2C_MOCK_LOG_BYTES ? len : I2C_MOCK_LOG_BYTES;
+    for (size_t i = 0; i < shown; i++) {
+        fprintf(out, " %02x", data[i]);
+    }
+    if (len > shown) {
+        fprintf(out, " ...");
+    }
+}
+
+void i2c_mock_log_dump(FILE *out)
+{
+    for (size_t i = 0; i < i2c_mock_log_count(); i++) {
+        const i2c_mock_txn_t *t = i2c_mock_log_get(i);
+        i2c_mock_model_t *model = I2C_MOCK_PORT_VALID(t->port) ? i2c_mock_find(&s_ports[t->port], t->addr) : NULL;
+        fprintf(out, "%10" PRId64 " us  i2c%u 0x%02x %-8s %5" PRIu32 " us  W%-4u", t->t_us, t->port, t->addr,
+                model ? model->name : "-", t->duration_us, t->write_len);
+        i2c_mock_dump_bytes(out, t->write_data, t->write_len);
+        if (t->read_len) {
+            fprintf(out, "  R%-4u", t->read_len);
+            i2c_mock_dump_bytes(out, t->read_data, t->read_len);
+        }
+        fprintf(out, "  %s\n", esp_err_to_name(t->err));
+    }
+}
+
+int i2c_mock_cmd_links_alive(void)
+{
+    return s_cmd_alive;
+}
+
+/**************************************** Pads *********************************************/
+
+/* Overrides the weak shim versions: SCL and SDA of every configured port are wired-AND lines */
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    host_gpio_latch(gpio_num, level);
+    for (int port = 0; port < I2C_MOCK_PORT_NUM; port++) {
+        i2c_mock_port_t *p = &s_ports[port];
+        if (!p->configured) {
+            continue;
+        }
+        if (gpio_num == p->conf.scl_io_num) {
+            /* a device holding SDA shifts out one bit per clock and lets go at the end of its byte */
+            if (!p->scl_level && level && p->hold_clocks && p->hold_clocks != I2C_MOCK_SDA_NEVER_RELEASED) {
+                p->hold_clocks--;
+            }
+            p->scl_level = level ? 1 : 0;
+        }
+        if (gpio_num == p->conf.sda_io_num) {
+            p->sda_level = level ? 1 : 0;
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    for (int port = 0; port < I2C_MOCK_PORT_NUM; port++) {
+        i2c_mock_port_t *p = &s_ports[port];
+        if (!p->configured) {
+            continue;
+        }
+        if (gpio_num == p->conf.sda_io_num) {
+            return p->sda_level && p->hold_clocks == 0;
+        }
+        if (gpio_num == p->conf.scl_io_num) {
+            return p->scl_level;
+        }
+    }
+    return host_gpio_output(gpio_num);
+}
+
+/**************************************** Legacy driver *********************************************/
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(i2c_num), "i2c number error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(i2c_conf != NULL, "i2c null address error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(i2c_conf->master.clk_speed > 0, "i2c clock error", ESP_ERR_INVALID_ARG);
+    i2c_mock_port_t *p = &s_ports[i2c_num];
+    p->conf = *i2c_conf;
+    p->configured = true;
+    p->scl_level = 1;
+    p->sda_level = 1;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len, size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(i2c_num), "i2c number error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(mode == I2C_MODE_MASTER, "only master mode is mocked", ESP_ERR_NOT_SUPPORTED);
+    I2C_BUS_CHECK(!s_ports[i2c_num].installed, "i2c driver install error", ESP_FAIL);
+    s_ports[i2c_num].installed = true;
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(i2c_num), "i2c number error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(s_ports[i2c_num].installed, "i2c driver not installed", ESP_ERR_INVALID_STATE);
+    s_ports[i2c_num].installed = false;
+    return ESP_OK;
+}
+
+i2c_cmd_handle_t i2c_cmd_link_create(void)
+{
+    i2c_mock_cmd_t *cmd = calloc(1, sizeof(i2c_mock_cmd_t));
+    if (cmd) {
+        s_cmd_alive++;
+    }
+    return cmd;
+}
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+    i2c_mock_cmd_t *cmd = cmd_handle;
+    if (cmd == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < cmd->num; i++) {
+        if (cmd->ops[i].kind == I2C_MOCK_OP_WRITE) {
+            free(cmd->ops[i].data);
+        }
+    }
+    free(cmd->ops);
+    free(cmd);
+    s_cmd_alive--;
+}
+
+static esp_err_t i2c_mock_cmd_append(i2c_cmd_handle_t cmd_handle, i2c_mock_op_t op)
+{
+    i2c_mock_cmd_t *cmd = cmd_handle;
+    I2C_BUS_CHECK(cmd != NULL, "i2c command link error", ESP_ERR_INVALID_ARG);
+    if (cmd->num == cmd->cap) {
+        size_t cap = cmd->cap ? cmd->cap * 2 : 8;
+        i2c_mock_op_t *ops = realloc(cmd->ops, cap * sizeof(i2c_mock_op_t));
+        I2C_BUS_CHECK(ops != NULL, "realloc failed", ESP_ERR_NO_MEM);
+        cmd->ops = ops;
+        cmd->cap = cap;
+    }
+    cmd->ops[cmd->num++] = op;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_mock_cmd_append(cmd_handle, (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_START
+    });
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+    return i2c_mock_cmd_append(cmd_handle, (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_STOP
+    });
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, const uint8_t *data, size_t data_len, bool ack_en)
+{
+    I2C_BUS_CHECK(data != NULL || data_len == 0, "i2c data address error", ESP_ERR_INVALID_ARG);
+    if (data_len == 0) {
+        return ESP_OK;
+    }
+    uint8_t *copy = malloc(data_len);
+    I2C_BUS_CHECK(copy != NULL, "malloc failed", ESP_ERR_NO_MEM);
+    memcpy(copy, data, data_len);
+    esp_err_t ret = i2c_mock_cmd_append(cmd_handle, (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_WRITE, .data = copy, .len = data_len, .ack_check = ack_en
+    });
+    if (ret != ESP_OK) {
+        free(copy);
+    }
+    return ret;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+    return i2c_master_write(cmd_handle, &data, 1, ack_en);
+}
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+    I2C_BUS_CHECK(data != NULL, "i2c data address error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(data_len > 0, "i2c data read length error", ESP_ERR_INVALID_ARG);
+    return i2c_mock_cmd_append(cmd_handle, (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_READ, .data = data, .len = data_len
+    });
+}
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack)
+{
+    return i2c_master_read(cmd_handle, data, 1, ack);
+}
+
+/**
+ * @brief Apply the faults matching the device addressed by a transaction
+ *
+ * @return Error the transaction must fail with, ESP_OK if none
+ */
+static esp_err_t i2c_mock_fault_check(i2c_mock_port_t *p, uint8_t addr, uint64_t *extra_us)
+{
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < I2C_MOCK_MAX_FAULTS; i++) {
+        i2c_mock_fault_slot_t *f = &p->faults[i];
+        if (!f->used || (f->fault.addr != I2C_MOCK_ANY_ADDR && f->fault.addr != addr)) {
+            continue;
+        }
+        if (f->seen++ < f->fault.skip || (f->fault.count && f->fired >= f->fault.count)) {
+            continue;
+        }
+        f->fired++;
+        *extra_us += f->fault.delay_us;
+        if (f->fault.hold_sda_clocks) {
+            p->hold_clocks = f->fault.hold_sda_clocks;
+        }
+        if (ret == ESP_OK) {
+            ret = f->fault.err;
+        }
+    }
+    if (ret == ESP_OK && p->hold_clocks) {
+        ret = ESP_ERR_TIMEOUT;
+    }
+    return ret;
+}
+
+static void i2c_mock_log_bytes(uint8_t *dst, uint16_t *len, const uint8_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++, (*len)++) {
+        if (*len < I2C_MOCK_LOG_BYTES) {
+            dst[*len] = src[i];
+        }
+    }
+}
+
+/**
+ * @brief Run a command link against the models of a port, without advancing the host clock
+ *
+ * @param clk_speed SCL frequency the transaction is timed with
+ * @param start_us Time the START goes on the bus
+ * @param duration_us Time the bus is busy
+ */
+static esp_err_t i2c_mock_cmd_exec(i2c_port_t port, i2c_mock_cmd_t *cmd, TickType_t ticks_to_wait, uint32_t clk_speed,
+                                   int64_t start_us, uint32_t *duration_us)
+{
+    static uint8_t s_phase[I2C_MOCK_WRITE_PHASE_MAX];
+    i2c_mock_port_t *p = &s_ports[port];
+    i2c_mock_txn_t txn = {
+        .t_us = start_us, .port = (uint8_t)port, .addr = I2C_MOCK_ANY_ADDR,
+    };
+    uint64_t bits = 0;
+    uint64_t extra_us = 0;
+    esp_err_t ret = ESP_OK;
+    i2c_mock_model_t *model = NULL;
+    size_t phase_len = 0;
+    bool expect_addr = false;
+    bool reading = false;
+    bool checked = false;
+
+    if (!p->installed) {
+        ret = ESP_ERR_INVALID_STATE;
+        goto done;
+    }
+    if (p->hold_clocks) {
+        /* SDA low: the controller cannot generate a START and waits for the command to time out */
+        ret = ESP_ERR_TIMEOUT;
+        extra_us = (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+        goto done;
+    }
+
+    for (size_t i = 0; i < cmd->num && ret == ESP_OK; i++) {
+        i2c_mock_op_t *op = &cmd->ops[i];
+        switch (op->kind) {
+        case I2C_MOCK_OP_START:
+        case I2C_MOCK_OP_STOP:
+            if (model && !reading && phase_len && model->write(model, s_phase, phase_len) != ESP_OK) {
+                ret = ESP_FAIL;
+                break;
+            }
+            phase_len = 0;
+            bits += I2C_MOCK_CONDITION_BITS;
+            expect_addr = op->kind == I2C_MOCK_OP_START;
+            if (op->kind == I2C_MOCK_OP_STOP) {
+                model = NULL;
+            }
+            break;
+        case I2C_MOCK_OP_WRITE:
+            for (size_t j = 0; j < op->len && ret == ESP_OK; j++) {
+                bits += I2C_MOCK_BYTE_BITS;
+                if (expect_addr) {
+                    uint8_t addr = op->data[j] >> 1;
+                    expect_addr = false;
+                    reading = op->data[j] & 1;
+                    if (txn.addr == I2C_MOCK_ANY_ADDR) {
+                        txn.addr = addr;
+                    }
+                    if (!checked) {
+                        checked = true;
+                        ret = i2c_mock_fault_check(p, addr, &extra_us);
+                        if (ret == ESP_ERR_TIMEOUT && extra_us == 0) {
+                            extra_us = (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+                        }
+                        if (ret != ESP_OK) {
+                            break;
+                        }
+                    }
+                    model = i2c_mock_find(p, addr);
+                    if (model == NULL && op->ack_check) {
+                        ret = ESP_FAIL;
+                    }
+                    continue;
+                }
+                if (reading) {
+                    ret = ESP_ERR_INVALID_STATE;
+                    break;
+                }
+                i2c_mock_log_bytes(txn.write_data, &txn.write_len, &op->data[j], 1);
+                if (phase_len == sizeof(s_phase)) {
+                    ret = ESP_ERR_INVALID_SIZE;
+                    break;
+                }
+                s_phase[phase_len++] = op->data[j];
+            }
+            break;
+        case I2C_MOCK_OP_READ:
+            bits += (uint64_t)op->len * I2C_MOCK_BYTE_BITS;
+            if (expect_addr || !reading) {
+                ret = ESP_ERR_INVALID_STATE;
+                break;
+            }
+            if (model == NULL) {
+                memset(op->data, 0xFF, op->len);                                                            /*!< Nobody drives SDA, pull-ups read as ones */
+            } else if (model->read(model, op->data, op->len) != ESP_OK) {
+                ret = ESP_FAIL;
+                break;
+            }
+            i2c_mock_log_bytes(txn.read_data, &txn.read_len, op->data, op->len);
+            break;
+        }
+    }
+    if (ret == ESP_OK && model && !reading && phase_len && model->write(model, s_phase, phase_len) != ESP_OK) {
+        ret = ESP_FAIL;
+    }
+
+done:
+    txn.duration_us = (uint32_t)((bits * 1000000 + clk_speed - 1) / clk_speed + extra_us);
+    txn.err = ret;
+    p->busy_us += txn.duration_us;
+    s_log[s_log_total % I2C_MOCK_LOG_SIZE] = txn;
+    s_log_total++;
+    *duration_us = txn.duration_us;
+    return ret;
+}
+
+/**
+ * @brief Run a command link now, the caller is blocked until it ends
+ */
+static esp_err_t i2c_mock_cmd_run(i2c_port_t port, i2c_mock_cmd_t *cmd, TickType_t ticks_to_wait, uint32_t clk_speed)
+{
+    uint32_t duration_us;
+    esp_err_t ret = i2c_mock_cmd_exec(port, cmd, ticks_to_wait, clk_speed, esp_timer_get_time(), &duration_us);
+    host_clock_advance_us(duration_us);
+    return ret;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(i2c_num), "i2c number error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(cmd_handle != NULL, "i2c command link error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(s_ports[i2c_num].configured, "i2c driver not installed", ESP_ERR_INVALID_STATE);
+    return i2c_mock_cmd_run(i2c_num, cmd_handle, ticks_to_wait, s_ports[i2c_num].conf.master.clk_speed);
+}
+
+/**************************************** driver/i2c_master.h *********************************************/
+
+static bool i2c_mock_master_bus_valid(i2c_master_bus_handle_t bus)
+{
+    return bus >= s_master_buses && bus < s_master_buses + I2C_NUM_MAX && bus->used;
+}
+
+static bool i2c_mock_master_dev_valid(i2c_master_dev_handle_t dev)
+{
+    return dev >= s_master_devs && dev < s_master_devs + I2C_MOCK_MAX_MODELS && dev->used;
+}
+
+/**
+ * @brief Complete the queued transactions that have ended by now, oldest first, and call their callbacks
+ *
+ * @param wait Also wait for the oldest one if it has not ended yet
+ */
+static void i2c_mock_master_retire(struct i2c_master_bus_t *bus, bool wait)
+{
+    while (bus->count) {
+        i2c_mock_master_pending_t *t = &bus->pending[bus->head];
+        int64_t now = esp_timer_get_time();
+        if (t->done_us > now) {
+            if (!wait) {
+                break;
+            }
+            host_clock_advance_us(t->done_us - now);
+        }
+        wait = false;
+        bus->head = (bus->head + 1) % I2C_MOCK_MASTER_MAX_QUEUE;
+        bus->count--;
+        if (t->dev->used && t->dev->on_trans_done) {
+            i2c_master_event_data_t evt = { .event = t->event };
+            t->dev->on_trans_done(t->dev, &evt, t->dev->user_ctx);
+        }
+    }
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle)
+{
+    I2C_BUS_CHECK(bus_config != NULL && ret_bus_handle != NULL, "i2c bus config error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(bus_config->trans_queue_depth <= I2C_MOCK_MASTER_MAX_QUEUE, "queue depth error", ESP_ERR_INVALID_ARG);
+    i2c_port_t port = bus_config->i2c_port;
+    if (port == -1) {
+        for (port = 0; port < I2C_NUM_MAX && (s_master_buses[port].used || s_ports[port].installed); port++) {
+        }
+    }
+    I2C_BUS_CHECK(port >= 0 && port < I2C_NUM_MAX, "no free i2c port", ESP_ERR_NOT_FOUND);
+    I2C_BUS_CHECK(!s_master_buses[port].used, "i2c port already in use", ESP_ERR_INVALID_STATE);
+    /* On the chip the two drivers cannot even be linked together */
+    I2C_BUS_CHECK(!s_ports[port].installed, "i2c port used by the legacy driver", ESP_ERR_INVALID_STATE);
+
+    i2c_mock_port_t *p = &s_ports[port];
+    p->conf = (i2c_config_t) {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = bus_config->sda_io_num,
+        .scl_io_num = bus_config->scl_io_num,
+        .master.clk_speed = 100000,
+    };
+    p->configured = true;
+    p->installed = true;
+    p->scl_level = 1;
+    p->sda_level = 1;
+    s_master_buses[port] = (struct i2c_master_bus_t) {
+        .used = true, .port = port, .queue_depth = bus_config->trans_queue_depth,
+    };
+    *ret_bus_handle = &s_master_buses[port];
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(i2c_mock_master_bus_valid(bus_handle), "i2c bus handle error", ESP_ERR_INVALID_ARG);
+    for (int i = 0; i < I2C_MOCK_MAX_MODELS; i++) {
+        I2C_BUS_CHECK(!s_master_devs[i].used || s_master_devs[i].bus != bus_handle, "devices still on the bus", ESP_ERR_INVALID_STATE);
+    }
+    i2c_mock_master_retire(bus_handle, false);
+    I2C_BUS_CHECK(bus_handle->count == 0, "transactions in flight", ESP_ERR_INVALID_STATE);
+    s_ports[bus_handle->port].installed = false;
+    s_ports[bus_handle->port].configured = false;
+    bus_handle->used = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_get_bus_handle(i2c_port_t port_num, i2c_master_bus_handle_t *ret_handle)
+{
+    I2C_BUS_CHECK(port_num >= 0 && port_num < I2C_NUM_MAX && ret_handle != NULL, "i2c number error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(s_master_buses[port_num].used, "bus not initialized", ESP_ERR_INVALID_STATE);
+    *ret_handle = &s_master_buses[port_num];
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus_handle, const i2c_device_config_t *dev_config, i2c_master_dev_handle_t *ret_handle)
+{
+    I2C_BUS_CHECK(i2c_mock_master_bus_valid(bus_handle), "i2c bus handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(dev_config != NULL && ret_handle != NULL, "i2c device config error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(dev_config->dev_addr_length == I2C_ADDR_BIT_LEN_7, "only 7-bit addresses are mocked", ESP_ERR_NOT_SUPPORTED);
+    I2C_BUS_CHECK(dev_config->scl_speed_hz > 0, "i2c clock error", ESP_ERR_INVALID_ARG);
+    for (int i = 0; i < I2C_MOCK_MAX_MODELS; i++) {
+        if (!s_master_devs[i].used) {
+            s_master_devs[i] = (struct i2c_master_dev_t) {
+                .used = true, .bus = bus_handle, .conf = *dev_config,
+            };
+            *ret_handle = &s_master_devs[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle)
+{
+    I2C_BUS_CHECK(i2c_mock_master_dev_valid(handle), "i2c device handle error", ESP_ERR_INVALID_ARG);
+    i2c_mock_master_retire(handle->bus, false);
+    handle->used = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_register_event_callbacks(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_callbacks_t *cbs, void *user_data)
+{
+    I2C_BUS_CHECK(i2c_mock_master_dev_valid(i2c_dev) && cbs != NULL, "i2c device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(i2c_dev->bus->queue_depth > 0, "bus created without a transaction queue", ESP_ERR_INVALID_STATE);
+    i2c_dev->on_trans_done = cbs->on_trans_done;
+    i2c_dev->user_ctx = user_data;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_multi_buffer_transmit(i2c_master_dev_handle_t i2c_dev, i2c_master_transmit_multi_buffer_info_t *buffer_info_array, size_t array_size, int xfer_timeout_ms)
+{
+    I2C_BUS_CHECK(i2c_mock_master_dev_valid(i2c_dev), "i2c device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(buffer_info_array != NULL && array_size > 0 && array_size <= I2C_MOCK_MASTER_MAX_BUFFERS, "buffer array error", ESP_ERR_INVALID_ARG);
+    struct i2c_master_bus_t *bus = i2c_dev->bus;
+    uint8_t addr = (uint8_t)(i2c_dev->conf.device_address << 1 | I2C_MASTER_WRITE);
+    bool ack_check = !i2c_dev->conf.flags.disable_ack_check;
+    i2c_mock_op_t ops[I2C_MOCK_MASTER_MAX_BUFFERS + 3];
+    i2c_mock_cmd_t cmd = { .ops = ops };
+
+    ops[cmd.num++] = (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_START
+    };
+    ops[cmd.num++] = (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_WRITE, .data = &addr, .len = 1, .ack_check = ack_check
+    };
+    for (size_t i = 0; i < array_size; i++) {
+        I2C_BUS_CHECK(buffer_info_array[i].write_buffer != NULL || buffer_info_array[i].buffer_size == 0, "buffer error", ESP_ERR_INVALID_ARG);
+        ops[cmd.num++] = (i2c_mock_op_t) {
+            .kind = I2C_MOCK_OP_WRITE, .data = buffer_info_array[i].write_buffer, .len = buffer_info_array[i].buffer_size, .ack_check = ack_check
+        };
+    }
+    ops[cmd.num++] = (i2c_mock_op_t) {
+        .kind = I2C_MOCK_OP_STOP
+    };
+    TickType_t ticks = xfer_timeout_ms < 0 ? portMAX_DELAY : (TickType_t)(xfer_timeout_ms / portTICK_PERIOD_MS);
+    uint32_t duration_us;
+    esp_err_t ret;
+
+    if (i2c_dev->on_trans_done == NULL) {
+        /* Synchronous: wait for the bus, then for the transfer */
+        i2c_mock_master_retire(bus, false);
+        while (bus->count) {
+            i2c_mock_master_retire(bus, true);
+        }
+        ret = i2c_mock_cmd_exec(bus->port, &cmd, ticks, i2c_dev->conf.scl_speed_hz, esp_timer_get_time(), &duration_us);
+        host_clock_advance_us(duration_us);
+        return ret;
+    }
+
+    i2c_mock_master_retire(bus, false);
+    if ((size_t)bus->count == bus->queue_depth) {
+        i2c_mock_master_retire(bus, true);
+    }
+    host_clock_advance_us(I2C_MOCK_MASTER_QUEUE_US);
+    int64_t now = esp_timer_get_time();
+    int64_t start = (bus->free_us > now ? bus->free_us : now) + I2C_MOCK_MASTER_ISR_US;
+    ret = i2c_mock_cmd_exec(bus->port, &cmd, ticks, i2c_dev->conf.scl_speed_hz, start, &duration_us);
+    bus->free_us = start + duration_us;
+    bus->pending[(bus->head + bus->count) % I2C_MOCK_MASTER_MAX_QUEUE] = (i2c_mock_master_pending_t) {
+        .done_us = bus->free_us,
+        .dev = i2c_dev,
+        .event = ret == ESP_OK ? I2C_EVENT_DONE : ret == ESP_ERR_TIMEOUT ? I2C_EVENT_TIMEOUT : I2C_EVENT_NACK,
+    };
+    bus->count++;
+    /* Errors of queued transfers are only reported to the callback */
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t i2c_dev, const uint8_t *write_buffer, size_t write_size, int xfer_timeout_ms)
+{
+    i2c_master_transmit_multi_buffer_info_t buf = {
+        .write_buffer = (uint8_t *)write_buffer, .buffer_size = write_size,
+    };
+    return i2c_master_multi_buffer_transmit(i2c_dev, &buf, 1, xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_bus_wait_all_done(i2c_master_bus_handle_t bus_handle, int timeout_ms)
+{
+    I2C_BUS_CHECK(i2c_mock_master_bus_valid(bus_handle), "i2c bus handle error", ESP_ERR_INVALID_ARG);
+    while (bus_handle->count) {
+        i2c_mock_master_retire(bus_handle, true);
+    }
+    return ESP_OK;
+}
+
+/**************************************** i2c_bus.h *********************************************/
+
+static esp_err_t i2c_driver_reinit(i2c_port_t port, const i2c_config_t *conf)
+{
+    if (s_i2c_bus[port].is_init) {
+        i2c_driver_delete(port);
+        s_i2c_bus[port].is_init = false;
+    }
+    esp_err_t ret = i2c_param_config(port, conf);
+    I2C_BUS_CHECK(ret == ESP_OK, "i2c param config failed", ret);
+    ret = i2c_driver_install(port, conf->mode, 0, 0, 0);
+    I2C_BUS_CHECK(ret == ESP_OK, "i2c driver install failed", ret);
+    s_i2c_bus[port].is_init = true;
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_recover_locked(i2c_bus_t *i2c_bus)
+{
+    i2c_port_t port = i2c_bus->i2c_port;
+    i2c_config_t conf = i2c_bus->conf_active;
+    if (i2c_bus->is_init) {
+        i2c_driver_delete(port);
+        i2c_bus->is_init = false;
+    }
+    esp_err_t ret = i2c_bus_health_line_recover(conf.sda_io_num, conf.scl_io_num, conf.master.clk_speed);
+    esp_err_t reinit = i2c_driver_reinit(port, &conf);
+    i2c_bus->recoveries++;
+    ESP_LOGW(TAG, "i2c%d bus recovery %s, recoveries=%" PRIu32, port, esp_err_to_name(ret), i2c_bus->recoveries);
+    return reinit != ESP_OK ? reinit : ret;
+}
+
+static void i2c_bus_transfer_done(i2c_bus_device_t *i2c_device, esp_err_t ret, int64_t start_us)
+{
+    i2c_bus_t *i2c_bus = i2c_device->i2c_bus;
+    i2c_bus_health_class_t cls = i2c_bus_health_classify(ret, i2c_bus->conf_active.sda_io_num);
+    i2c_bus_health_record(&i2c_device->health, cls, ret, (uint32_t)(esp_timer_get_time() - start_us));
+    if (i2c_bus_health_should_recover(&i2c_device->health, cls)) {
+        ESP_LOGW(TAG, "i2c%d: %s talking to 0x%02x, %" PRIu32 " consecutive errors, recovering bus", i2c_bus->i2c_port,
+                 esp_err_to_name(ret), i2c_device->dev_addr, i2c_device->health.consecutive_errors);
+        i2c_bus_recover_locked(i2c_bus);
+    }
+}
+
+/**
+ * @brief Run a command link for a device at the device clock, record it in the trace as i2c_bus.c does and account it
+ *        in the device statistics
+ */
+static esp_err_t i2c_bus_device_run(i2c_bus_device_t *i2c_device, i2c_cmd_handle_t cmd, uint8_t trace_flags,
+                                    const uint8_t *mem, size_t mem_len, const uint8_t *wr, size_t wr_len, const uint8_t *rd, size_t rd_len)
+{
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_mock_cmd_run(i2c_device->i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, i2c_device->conf.master.clk_speed);
+    i2c_bus_trace_record(trace_flags, i2c_device->i2c_bus->i2c_port, i2c_device->dev_addr, start_us, ret, mem, mem_len, wr, wr_len, rd, rd_len);
+    i2c_bus_transfer_done(i2c_device, ret, start_us);
+    return ret;
+}
+
+i2c_bus_handle_t i2c_bus_create(i2c_port_t port, const i2c_config_t *conf)
+{
+    I2C_BUS_CHECK(I2C_MOCK_PORT_VALID(port), "I2C port error", NULL);
+    I2C_BUS_CHECK(conf != NULL, "pointer = NULL error", NULL);
+    I2C_BUS_CHECK(conf->mode == I2C_MODE_MASTER, "i2c_bus only supports master mode", NULL);
+    esp_err_t ret = i2c_driver_reinit(port, conf);
+    I2C_BUS_CHECK(ret == ESP_OK, "init error", NULL);
+    s_i2c_bus[port].conf_active = *conf;
+    s_i2c_bus[port].i2c_port = port;
+    return (i2c_bus_handle_t)&s_i2c_bus[port];
+}
+
+esp_err_t i2c_bus_delete(i2c_bus_handle_t *p_bus)
+{
+    I2C_BUS_CHECK(p_bus != NULL && *p_bus != NULL, "pointer = NULL error", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)(*p_bus);
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_FAIL);
+    if (i2c_bus->ref_counter > 0) {
+        ESP_LOGW(TAG, "i2c%d is also handled by others ref_counter=%" PRIi32 ", won't be de-inited", i2c_bus->i2c_port, i2c_bus->ref_counter);
+        return ESP_OK;
+    }
+    i2c_driver_delete(i2c_bus->i2c_port);
+    i2c_bus->is_init = false;
+    *p_bus = NULL;
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_probe_locked(i2c_bus_t *i2c_bus, uint8_t dev_addr)
+{
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
+    i2c_master_stop(cmd);
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_mock_cmd_run(i2c_bus->i2c_port, cmd, I2C_BUS_TICKS_TO_WAIT, i2c_bus->conf_active.master.clk_speed);
+    i2c_bus_trace_record(I2C_BUS_TRACE_SRC_BUS, i2c_bus->i2c_port, dev_addr, start_us, ret, NULL, 0, NULL, 0, NULL, 0);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+uint8_t i2c_bus_scan(i2c_bus_handle_t bus_handle, uint8_t *buf, uint8_t num)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Handle error", 0);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, 0);
+    uint8_t device_count = 0;
+    for (uint8_t dev_address = 1; dev_address < 127; dev_address++) {
+        if (i2c_bus_probe_locked(i2c_bus, dev_address) == ESP_OK) {
+            if (buf != NULL && device_count < num) {
+                buf[device_count] = dev_address;
+            }
+            device_count++;
+        }
+    }
+    return device_count;
+}
+
+esp_err_t i2c_bus_probe(i2c_bus_handle_t bus_handle, uint8_t dev_addr)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Handle error", ESP_ERR_INVALID_ARG);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    return i2c_bus_probe_locked(i2c_bus, dev_addr);
+}
+
+uint32_t i2c_bus_get_current_clk_speed(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", 0);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, 0);
+    return i2c_bus->conf_active.master.clk_speed;
+}
+
+uint8_t i2c_bus_get_created_device_num(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", 0);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, 0);
+    return i2c_bus->ref_counter;
+}
+
+i2c_bus_device_handle_t i2c_bus_device_create(i2c_bus_handle_t bus_handle, uint8_t dev_addr, uint32_t clk_speed)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", NULL);
+    I2C_BUS_CHECK(clk_speed <= 400000, "clk_speed must <= 400000", NULL);
+    i2c_bus_t *i2c_bus = (i2c_bus_t *)bus_handle;
+    I2C_BUS_INIT_CHECK(i2c_bus->is_init, NULL);
+    i2c_bus_device_t *i2c_device = calloc(1, sizeof(i2c_bus_device_t));
+    I2C_BUS_CHECK(i2c_device != NULL, "calloc memory failed", NULL);
+    i2c_device->dev_addr = dev_addr;
+    i2c_device->conf = i2c_bus->conf_active;
+    if (clk_speed != 0) {
+        i2c_device->conf.master.clk_speed = clk_speed;
+    }
+    i2c_device->i2c_bus = i2c_bus;
+    i2c_bus->ref_counter++;
+    return (i2c_bus_device_handle_t)i2c_device;
+}
+
+esp_err_t i2c_bus_device_delete(i2c_bus_device_handle_t *p_dev_handle)
+{
+    I2C_BUS_CHECK(p_dev_handle != NULL && *p_dev_handle != NULL, "Null Device Handle", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)(*p_dev_handle);
+    i2c_device->i2c_bus->ref_counter--;
+    free(i2c_device);
+    *p_dev_handle = NULL;
+    return ESP_OK;
+}
+
+uint8_t i2c_bus_device_get_address(i2c_bus_device_handle_t dev_handle)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", NULL_I2C_DEV_ADDR);
+    return ((i2c_bus_device_t *)dev_handle)->dev_addr;
+}
+
+/**
+ * @brief Register read with an optional 1 or 2 byte register address, built like i2c_bus_read_reg8/16 of i2c_bus.c
+ */
+static esp_err_t i2c_bus_mock_read(i2c_bus_device_handle_t dev_handle, const uint8_t *mem, size_t mem_len, size_t data_len, uint8_t *data)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(data != NULL, "data pointer error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    if (mem_len) {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, (i2c_device->dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
+        i2c_master_write(cmd, mem, mem_len, I2C_ACK_CHECK_EN);
+    }
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (i2c_device->dev_addr << 1) | I2C_MASTER_READ, I2C_ACK_CHECK_EN);
+    i2c_master_read(cmd, data, data_len, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_bus_device_run(i2c_device, cmd, I2C_BUS_TRACE_SRC_BUS, mem, mem_len, NULL, 0, data, data_len);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+static esp_err_t i2c_bus_mock_write(i2c_bus_device_handle_t dev_handle, const uint8_t *mem, size_t mem_len, size_t data_len, const uint8_t *data)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(data != NULL, "data pointer error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (i2c_device->dev_addr << 1) | I2C_MASTER_WRITE, I2C_ACK_CHECK_EN);
+    i2c_master_write(cmd, mem, mem_len, I2C_ACK_CHECK_EN);
+    i2c_master_write(cmd, data, data_len, I2C_ACK_CHECK_EN);
+    i2c_master_stop(cmd);
+    esp_err_t ret = i2c_bus_device_run(i2c_device, cmd, I2C_BUS_TRACE_SRC_BUS, mem, mem_len, data, data_len, NULL, 0);
+    i2c_cmd_link_delete(cmd);
+    return ret;
+}
+
+esp_err_t i2c_bus_read_bytes(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, uint8_t *data)
+{
+    return i2c_bus_mock_read(dev_handle, &mem_address, mem_address != NULL_I2C_MEM_ADDR, data_len, data);
+}
+
+esp_err_t i2c_bus_read_byte(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t *data)
+{
+    return i2c_bus_read_bytes(dev_handle, mem_address, 1, data);
+}
+
+esp_err_t i2c_bus_read_bit(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t bit_num, uint8_t *data)
+{
+    uint8_t byte = 0;
+    esp_err_t ret = i2c_bus_read_byte(dev_handle, mem_address, &byte);
+    *data = (byte & (1 << bit_num)) != 0;
+    return ret;
+}
+
+esp_err_t i2c_bus_read_bits(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t bit_start, uint8_t length, uint8_t *data)
+{
+    uint8_t byte = 0;
+    esp_err_t ret = i2c_bus_read_byte(dev_handle, mem_address, &byte);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t mask = ((1 << length) - 1) << (bit_start - length + 1);
+    *data = (byte & mask) >> (bit_start - length + 1);
+    return ret;
+}
+
+esp_err_t i2c_bus_write_byte(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t data)
+{
+    return i2c_bus_write_bytes(dev_handle, mem_address, 1, &data);
+}
+
+esp_err_t i2c_bus_write_bytes(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, size_t data_len, const uint8_t *data)
+{
+    return i2c_bus_mock_write(dev_handle, &mem_address, mem_address != NULL_I2C_MEM_ADDR, data_len, data);
+}
+
+esp_err_t i2c_bus_write_bit(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t bit_num, uint8_t data)
+{
+    uint8_t byte = 0;
+    esp_err_t ret = i2c_bus_read_byte(dev_handle, mem_address, &byte);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    byte = (data != 0) ? (byte | (1 << bit_num)) : (byte & ~(1 << bit_num));
+    return i2c_bus_write_byte(dev_handle, mem_address, byte);
+}
+
+esp_err_t i2c_bus_write_bits(i2c_bus_device_handle_t dev_handle, uint8_t mem_address, uint8_t bit_start, uint8_t length, uint8_t data)
+{
+    uint8_t byte = 0;
+    esp_err_t ret = i2c_bus_read_byte(dev_handle, mem_address, &byte);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t mask = ((1 << length) - 1) << (bit_start - length + 1);
+    data <<= (bit_start - length + 1);
+    byte = (byte & ~mask) | (data & mask);
+    return i2c_bus_write_byte(dev_handle, mem_address, byte);
+}
+
+esp_err_t i2c_bus_cmd_begin(i2c_bus_device_handle_t dev_handle, i2c_cmd_handle_t cmd)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(cmd != NULL, "I2C command error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    I2C_BUS_INIT_CHECK(i2c_device->i2c_bus->is_init, ESP_ERR_INVALID_STATE);
+    return i2c_bus_device_run(i2c_device, cmd, I2C_BUS_TRACE_SRC_BUS | I2C_BUS_TRACE_FLAG_OPAQUE, NULL, 0, NULL, 0, NULL, 0);
+}
+
+esp_err_t i2c_bus_write_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_address, size_t data_len, const uint8_t *data)
+{
+    uint8_t mem[2] = { mem_address >> 8, mem_address & 0xFF };
+    return i2c_bus_mock_write(dev_handle, mem, mem_address != NULL_I2C_MEM_16BIT_ADDR ? 2 : 0, data_len, data);
+}
+
+esp_err_t i2c_bus_read_reg16(i2c_bus_device_handle_t dev_handle, uint16_t mem_address, size_t data_len, uint8_t *data)
+{
+    uint8_t mem[2] = { mem_address >> 8, mem_address & 0xFF };
+    return i2c_bus_mock_read(dev_handle, mem, mem_address != NULL_I2C_MEM_16BIT_ADDR ? 2 : 0, data_len, data);
+}
+
+esp_err_t i2c_bus_device_get_stats(i2c_bus_device_handle_t dev_handle, i2c_bus_device_stats_t *stats)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    I2C_BUS_CHECK(stats != NULL, "stats pointer error", ESP_ERR_INVALID_ARG);
+    i2c_bus_device_t *i2c_device = (i2c_bus_device_t *)dev_handle;
+    i2c_bus_health_get_stats(&i2c_device->health, i2c_device->i2c_bus->recoveries, stats);
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_device_reset_stats(i2c_bus_device_handle_t dev_handle)
+{
+    I2C_BUS_CHECK(dev_handle != NULL, "device handle error", ESP_ERR_INVALID_ARG);
+    memset(&((i2c_bus_device_t *)dev_handle)->health, 0, sizeof(i2c_bus_health_t));
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_recover(i2c_bus_handle_t bus_handle)
+{
+    I2C_BUS_CHECK(bus_handle != NULL, "Null Bus Handle", ESP_ERR_INVALID_ARG);
+    return i2c_bus_recover_locked((i2c_bus_t *)bus_handle);
+}
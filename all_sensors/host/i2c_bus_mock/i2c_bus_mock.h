@@ -0,0 +1,167 @@
+/*
+ * Host mock of the I2C bus.
+ *
+ * Implements the i2c_bus.h API, the legacy driver/i2c.h master API and the write side of the driver/i2c_master.h
+ * API (both used directly by the ssd1306 component) on top of register level device models, so the drivers and the application logic run unchanged on Linux. Every
+ * transaction is timed on the host clock from its bit count and the bus frequency and recorded in a log. Faults
+ * (NACK, timeout, slow devices, SDA held low) are injected per device address. Transfers made through the i2c_bus API
+ * are also recorded in the i2c_bus trace (i2c_bus_trace.h), as on the target.
+ *
+ * driver/i2c_master.h devices with an on_trans_done callback queue their transfers as on the chip: the call returns
+ * after a fixed CPU time, the transfers run back to back on the bus and the callbacks are called, oldest first, by the
+ * next call that finds them ended. Payloads are read when a transfer is queued, not when it goes on the bus.
+ *
+ * Single threaded: there is no bus mutex.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "i2c_bus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_MOCK_ANY_ADDR 0xFF                                                                              /*!< Fault matches every device on the port */
+#define I2C_MOCK_MAX_MODELS 8                                                                               /*!< Models per port */
+#define I2C_MOCK_MAX_FAULTS 8                                                                               /*!< Active faults per port */
+#define I2C_MOCK_LOG_SIZE 4096                                                                              /*!< Transactions kept in the log, older ones are dropped */
+#define I2C_MOCK_LOG_BYTES 8                                                                                /*!< Payload bytes kept per direction and transaction */
+#define I2C_MOCK_MASTER_MAX_QUEUE 32                                                                        /*!< Largest trans_queue_depth accepted */
+#define I2C_MOCK_MASTER_MAX_BUFFERS 4                                                                       /*!< Buffers per i2c_master_multi_buffer_transmit */
+#define I2C_MOCK_MASTER_QUEUE_US 4                                                                          /*!< CPU time of queuing a transfer */
+#define I2C_MOCK_MASTER_ISR_US 8                                                                            /*!< Gap between queued transfers: ISR and FIFO refill */
+#define I2C_MOCK_SDA_NEVER_RELEASED UINT32_MAX                                                              /*!< i2c_mock_fault_t::hold_sda_clocks: recovery cannot free the bus */
+
+typedef struct i2c_mock_model i2c_mock_model_t;
+
+/**
+ * @brief Device model, embedded as the first member of the model state
+ *
+ * A transaction is split into phases at every (repeated) START. Each write phase is passed as a whole to write(),
+ * after the address byte and before the next START or STOP, so a model sees a command or a register write exactly
+ * as the device would. Reads are passed as they are clocked, possibly in several chunks.
+ */
+struct i2c_mock_model {
+    const char *name;                                                                                       /*!< Shown in the log dump */
+    uint8_t addr;                                                                                           /*!< 7-bit address the model acknowledges */
+    esp_err_t (*write)(i2c_mock_model_t *model, const uint8_t *data, size_t len);                           /*!< Write phase, ESP_FAIL to NACK it */
+    esp_err_t (*read)(i2c_mock_model_t *model, uint8_t *data, size_t len);                                  /*!< Read chunk, ESP_FAIL to NACK it */
+};
+
+/**
+ * @brief Injected fault
+ *
+ * The fault is checked when a transaction addresses the device. The first `skip` matching transactions go through,
+ * the following `count` ones (all of them if 0) are affected.
+ */
+typedef struct {
+    uint8_t addr;                                                                                           /*!< Device address or I2C_MOCK_ANY_ADDR */
+    uint32_t skip;                                                                                          /*!< Matching transactions let through first */
+    uint32_t count;                                                                                         /*!< Transactions affected, 0 = until cleared */
+    esp_err_t err;                                                                                          /*!< ESP_FAIL = address NACK, ESP_ERR_TIMEOUT, ... ESP_OK to only add the delay */
+    uint32_t delay_us;                                                                                      /*!< Added to the transaction time (clock stretching) */
+    uint32_t hold_sda_clocks;                                                                               /*!< Non-zero: SDA stays low until this many SCL clocks, ESP_ERR_TIMEOUT if err is ESP_OK */
+} i2c_mock_fault_t;
+
+/**
+ * @brief Logged transaction
+ */
+typedef struct {
+    int64_t t_us;                                                                                           /*!< Host clock at the START */
+    uint32_t duration_us;                                                                                   /*!< Time the bus was busy */
+    uint8_t port;                                                                                           /*!< I2C port */
+    uint8_t addr;                                                                                           /*!< First address on the bus, I2C_MOCK_ANY_ADDR if none */
+    uint16_t write_len;                                                                                     /*!< Payload bytes written, address bytes excluded */
+    uint16_t read_len;                                                                                      /*!< Bytes read */
+    uint8_t write_data[I2C_MOCK_LOG_BYTES];                                                                 /*!< First written bytes */
+    uint8_t read_data[I2C_MOCK_LOG_BYTES];                                                                  /*!< First read bytes */
+    esp_err_t err;                                                                                          /*!< Result returned to the driver */
+} i2c_mock_txn_t;
+
+/**
+ * @brief Detach all models, clear faults, the log, the trace and the bus counters and set the host clock back to 0.
+ *        Bus and device handles must have been deleted before.
+ */
+void i2c_mock_reset(void);
+
+/**
+ * @brief Put a device model on a port
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_INVALID_STATE Another model already uses the address
+ *     - ESP_ERR_NO_MEM I2C_MOCK_MAX_MODELS reached
+ */
+esp_err_t i2c_mock_attach(i2c_port_t port, i2c_mock_model_t *model);
+
+/**
+ * @brief Remove the model at an address, the device stops acknowledging (hot unplug)
+ */
+esp_err_t i2c_mock_detach(i2c_port_t port, uint8_t addr);
+
+/**
+ * @brief Add a fault on a port
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Parameter error
+ *     - ESP_ERR_NO_MEM I2C_MOCK_MAX_FAULTS reached
+ */
+esp_err_t i2c_mock_inject(i2c_port_t port, const i2c_mock_fault_t *fault);
+
+/**
+ * @brief Remove all faults. A device already holding SDA keeps holding it until the bus is recovered.
+ */
+void i2c_mock_clear_faults(void);
+
+/**
+ * @brief Whether a device holds SDA low on the port
+ */
+bool i2c_mock_sda_held(i2c_port_t port);
+
+/**
+ * @brief Total time the port was busy since the last reset
+ */
+uint64_t i2c_mock_busy_us(i2c_port_t port);
+
+/**
+ * @brief Number of transactions in the log
+ */
+size_t i2c_mock_log_count(void);
+
+/**
+ * @brief Number of transactions since the last clear, including those dropped from the log
+ */
+uint32_t i2c_mock_log_total(void);
+
+/**
+ * @brief Logged transaction, 0 is the oldest one kept
+ *
+ * @return Transaction or NULL if index is out of range
+ */
+const i2c_mock_txn_t *i2c_mock_log_get(size_t index);
+
+/**
+ * @brief Drop the log
+ */
+void i2c_mock_log_clear(void);
+
+/**
+ * @brief Print the log, one transaction per line
+ */
+void i2c_mock_log_dump(FILE *out);
+
+/**
+ * @brief Number of command links created and not deleted yet
+ */
+int i2c_mock_cmd_links_alive(void);
+
+#ifdef __cplusplus
+}
+#endif
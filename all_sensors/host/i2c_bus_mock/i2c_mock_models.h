@@ -0,0 +1,140 @@
+/*
+ * Register level models of the devices on the smart mirror bus, for the host mock bus (i2c_bus_mock.h).
+ *
+ * Each model embeds i2c_mock_model_t as its first member; pass &model.base to i2c_mock_attach.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "i2c_bus_mock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************** BME280 / BMP280 *********************************************/
+
+#define I2C_MOCK_BME280_CHIP_ID 0x60
+#define I2C_MOCK_BMP280_CHIP_ID 0x58
+
+/**
+ * @brief Bosch BME280 (or BMP280, without humidity)
+ *
+ * 256 byte register file with auto-increment reads and register/value pair writes. Temperature and pressure
+ * calibration is the worked example of the BMP280 datasheet (section 3.12). Measurements are latched into
+ * 0xF7..0xFE in normal mode and after a forced conversion; in sleep mode the data registers keep their last value
+ * (0x80000 after reset).
+ */
+typedef struct {
+    i2c_mock_model_t base;
+    uint8_t chip_id;
+    uint8_t regs[256];
+    uint8_t ptr;                                                                                            /*!< Register pointer */
+    int32_t adc_T;                                                                                          /*!< Raw 20-bit temperature */
+    int32_t adc_P;                                                                                          /*!< Raw 20-bit pressure */
+    int32_t adc_H;                                                                                          /*!< Raw 16-bit humidity */
+    uint32_t soft_resets;                                                                                   /*!< 0xB6 written to 0xE0 */
+} i2c_mock_bme280_t;
+
+void i2c_mock_bme280_init(i2c_mock_bme280_t *m, uint8_t addr, uint8_t chip_id);
+
+/**
+ * @brief Set the raw values the next conversion returns
+ */
+void i2c_mock_bme280_set_raw(i2c_mock_bme280_t *m, int32_t adc_T, int32_t adc_P, int32_t adc_H);
+
+/**
+ * @brief Temperature in 0.01 degC the datasheet compensation gives for the current raw value
+ */
+int32_t i2c_mock_bme280_expected_temp(const i2c_mock_bme280_t *m);
+
+/**
+ * @brief Raw temperature closest to a temperature in 0.01 degC
+ */
+int32_t i2c_mock_bme280_raw_for_temp(const i2c_mock_bme280_t *m, int32_t centi_deg);
+
+/**************************************** BH1750 *********************************************/
+
+/**
+ * @brief ROHM BH1750 ambient light sensor
+ *
+ * Opcode interface: power down/on, reset, continuous and one-time modes, measurement time register. A conversion
+ * takes 120 ms (16 ms in L-resolution) scaled by MTreg/69 of host clock time, until then reads return the previous
+ * result.
+ */
+typedef struct {
+    i2c_mock_model_t base;
+    float lux;                                                                                              /*!< Light level the next conversion measures */
+    bool powered;
+    uint8_t mode;                                                                                           /*!< Last measurement opcode, 0 if none */
+    uint8_t mtreg;                                                                                          /*!< Measurement time register, 69 after power-up */
+    uint16_t data;                                                                                          /*!< Result register */
+    int64_t ready_at_us;                                                                                    /*!< Host clock the running conversion completes at, 0 if none */
+    uint32_t conversions;                                                                                   /*!< Completed conversions */
+} i2c_mock_bh1750_t;
+
+void i2c_mock_bh1750_init(i2c_mock_bh1750_t *m, uint8_t addr);
+
+/**
+ * @brief Result register value a conversion of the given light level gives in the current mode
+ */
+uint16_t i2c_mock_bh1750_counts(const i2c_mock_bh1750_t *m, float lux);
+
+/**************************************** SSD1306 / SH1106 *********************************************/
+
+#define I2C_MOCK_OLED_MAX_COLUMNS 132
+#define I2C_MOCK_OLED_PAGES 8
+
+/**
+ * @brief SSD1306 OLED controller, or SH1106 (132 column RAM, page addressing only)
+ *
+ * Parses control bytes and the command set including arguments, keeps the display RAM and the state the driver
+ * sets up (display on, contrast, addressing mode, remap, scroll). A read returns the status byte. The same model
+ * serves the 4-wire SPI interface through i2c_mock_oled_spi_rx.
+ */
+typedef struct {
+    i2c_mock_model_t base;
+    bool sh1106;
+    int columns;                                                                                            /*!< 128 or 132 */
+    uint8_t ram[I2C_MOCK_OLED_PAGES][I2C_MOCK_OLED_MAX_COLUMNS];
+    uint8_t cmd[8];                                                                                         /*!< Command being collected */
+    int cmd_len;
+    int cmd_need;                                                                                           /*!< Bytes the command takes including the opcode */
+    int col, page;
+    int col_start, col_end;
+    int page_start, page_end;
+    uint8_t addr_mode;                                                                                      /*!< 0 horizontal, 1 vertical, 2 page */
+    bool display_on;
+    bool inverted;
+    bool entire_on;
+    bool charge_pump;
+    bool seg_remap;
+    bool com_remap;
+    bool scrolling;
+    uint8_t contrast;
+    uint8_t mux;
+    uint8_t start_line;
+    uint8_t display_offset;
+    uint8_t clock_div;                                                                                      /*!< D5: oscillator frequency and divide ratio */
+    uint32_t commands;                                                                                      /*!< Complete commands parsed */
+    uint32_t unknown_commands;
+    uint32_t data_bytes;                                                                                    /*!< Bytes written to RAM */
+} i2c_mock_oled_t;
+
+void i2c_mock_oled_init(i2c_mock_oled_t *m, uint8_t addr, bool sh1106);
+
+/**
+ * @brief Bytes received on the 4-wire SPI interface: the D/C pad selects data or command instead of a control byte.
+ *        Has the signature of spi_mock_rx_t (host/spi_bus_mock), ctx is the model.
+ */
+void i2c_mock_oled_spi_rx(void *ctx, uint32_t dc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Pixel as stored in RAM (column, row), no remap applied
+ */
+bool i2c_mock_oled_pixel(const i2c_mock_oled_t *m, int x, int y);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,133 @@
+/*
+ * BH1750 model for the host mock bus.
+ */
+#include <string.h>
+#include "esp_timer.h"
+#include "i2c_mock_models.h"
+
+#define BH1750_POWER_DOWN    0x00
+#define BH1750_POWER_ON      0x01
+#define BH1750_RESET         0x07
+#define BH1750_CONT_H        0x10
+#define BH1750_CONT_H2       0x11
+#define BH1750_CONT_L        0x13
+#define BH1750_ONCE_H        0x20
+#define BH1750_ONCE_H2       0x21
+#define BH1750_ONCE_L        0x23
+#define BH1750_MTREG_HIGH    0x40                                                                           /*!< 01000_hhh */
+#define BH1750_MTREG_LOW     0x60                                                                           /*!< 011_lllll */
+#define BH1750_MTREG_DEFAULT 69
+#define BH1750_H_TIME_US     120000
+#define BH1750_L_TIME_US     16000
+
+static bool bh1750_is_once(uint8_t mode)
+{
+    return mode == BH1750_ONCE_H || mode == BH1750_ONCE_H2 || mode == BH1750_ONCE_L;
+}
+
+static int64_t bh1750_conversion_us(const i2c_mock_bh1750_t *m)
+{
+    int64_t base = (m->mode == BH1750_CONT_L || m->mode == BH1750_ONCE_L) ? BH1750_L_TIME_US : BH1750_H_TIME_US;
+    return base * m->mtreg / BH1750_MTREG_DEFAULT;
+}
+
+uint16_t i2c_mock_bh1750_counts(const i2c_mock_bh1750_t *m, float lux)
+{
+    double counts = lux * 1.2 * m->mtreg / BH1750_MTREG_DEFAULT;
+    if (m->mode == BH1750_CONT_H2 || m->mode == BH1750_ONCE_H2) {
+        counts *= 2;                                                                                        /*!< 0.5 lx per count */
+    }
+    if (counts < 0) {
+        counts = 0;
+    }
+    if (counts > 0xFFFF) {
+        counts = 0xFFFF;
+    }
+    uint16_t c = (uint16_t)counts;
+    if (m->mode == BH1750_CONT_L || m->mode == BH1750_ONCE_L) {
+        c &= ~0x3;                                                                                          /*!< 4 lx resolution */
+    }
+    return c;
+}
+
+/**
+ * @brief Complete the running conversion if its time has come
+ */
+static void bh1750_update(i2c_mock_bh1750_t *m)
+{
+    int64_t now = esp_timer_get_time();
+    if (m->ready_at_us == 0 || now < m->ready_at_us) {
+        return;
+    }
+    m->data = i2c_mock_bh1750_counts(m, m->lux);
+    m->conversions++;
+    if (bh1750_is_once(m->mode)) {
+        m->powered = false;
+        m->ready_at_us = 0;
+    } else {
+        m->ready_at_us = now + bh1750_conversion_us(m);
+    }
+}
+
+static esp_err_t bh1750_write(i2c_mock_model_t *model, const uint8_t *data, size_t len)
+{
+    i2c_mock_bh1750_t *m = (i2c_mock_bh1750_t *)model;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t op = data[i];
+        bh1750_update(m);
+        switch (op) {
+        case BH1750_POWER_DOWN:
+            m->powered = false;
+            m->ready_at_us = 0;
+            break;
+        case BH1750_POWER_ON:
+            m->powered = true;
+            break;
+        case BH1750_RESET:
+            if (m->powered) {
+                m->data = 0;
+            }
+            break;
+        case BH1750_CONT_H:
+        case BH1750_CONT_H2:
+        case BH1750_CONT_L:
+        case BH1750_ONCE_H:
+        case BH1750_ONCE_H2:
+        case BH1750_ONCE_L:
+            m->powered = true;
+            m->mode = op;
+            m->ready_at_us = esp_timer_get_time() + bh1750_conversion_us(m);
+            break;
+        default:
+            if ((op & 0xF8) == BH1750_MTREG_HIGH) {
+                m->mtreg = (m->mtreg & 0x1F) | ((op & 0x07) << 5);
+            } else if ((op & 0xE0) == BH1750_MTREG_LOW) {
+                m->mtreg = (m->mtreg & 0xE0) | (op & 0x1F);
+            }
+            break;                                                                                          /*!< Undefined opcodes are ignored */
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t bh1750_read(i2c_mock_model_t *model, uint8_t *data, size_t len)
+{
+    i2c_mock_bh1750_t *m = (i2c_mock_bh1750_t *)model;
+    bh1750_update(m);
+    for (size_t i = 0; i < len; i++) {
+        data[i] = i == 0 ? m->data >> 8 : i == 1 ? m->data & 0xFF : 0xFF;
+    }
+    return ESP_OK;
+}
+
+void i2c_mock_bh1750_init(i2c_mock_bh1750_t *m, uint8_t addr)
+{
+    memset(m, 0, sizeof(*m));
+    m->base = (i2c_mock_model_t) {
+        .name = "BH1750",
+        .addr = addr,
+        .write = bh1750_write,
+        .read = bh1750_read,
+    };
+    m->mtreg = BH1750_MTREG_DEFAULT;
+}
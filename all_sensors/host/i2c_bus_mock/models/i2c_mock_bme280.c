@@ -0,0 +1,184 @@
+/*
+ * BME280 / BMP280 model for the host mock bus.
+ */
+#include <string.h>
+#include "i2c_mock_models.h"
+
+#define BME280_REG_CALIB00   0x88
+#define BME280_REG_CALIB25   0xA1
+#define BME280_REG_ID        0xD0
+#define BME280_REG_RESET     0xE0
+#define BME280_REG_CALIB26   0xE1
+#define BME280_REG_CTRL_HUM  0xF2
+#define BME280_REG_STATUS    0xF3
+#define BME280_REG_CTRL_MEAS 0xF4
+#define BME280_REG_CONFIG    0xF5
+#define BME280_REG_DATA      0xF7
+#define BME280_RESET_CMD     0xB6
+#define BME280_MODE_MASK     0x03
+#define BME280_MODE_NORMAL   0x03
+
+/* BMP280 datasheet, section 3.12: 25.08 degC and 100653.27 Pa for adc_T 519888 and adc_P 415148 */
+static const uint16_t s_dig_T1 = 27504;
+static const int16_t s_dig_T2 = 26435, s_dig_T3 = -1000;
+static const uint16_t s_dig_P1 = 36477;
+static const int16_t s_dig_P[8] = { -10685, 3024, 2855, 140, -7, 15500, -14600, 6000 };
+/* Typical humidity trimming of a production BME280 */
+static const uint8_t s_dig_H1 = 75, s_dig_H3 = 0;
+static const int16_t s_dig_H2 = 362, s_dig_H4 = 313, s_dig_H5 = 50;
+static const int8_t s_dig_H6 = 30;
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void bme280_reset(i2c_mock_bme280_t *m)
+{
+    memset(m->regs, 0, sizeof(m->regs));
+    m->regs[BME280_REG_ID] = m->chip_id;
+
+    uint8_t *c = &m->regs[BME280_REG_CALIB00];
+    put_le16(&c[0], s_dig_T1);
+    put_le16(&c[2], (uint16_t)s_dig_T2);
+    put_le16(&c[4], (uint16_t)s_dig_T3);
+    put_le16(&c[6], s_dig_P1);
+    for (int i = 0; i < 8; i++) {
+        put_le16(&c[8 + 2 * i], (uint16_t)s_dig_P[i]);
+    }
+    if (m->chip_id == I2C_MOCK_BME280_CHIP_ID) {
+        m->regs[BME280_REG_CALIB25] = s_dig_H1;
+        put_le16(&m->regs[BME280_REG_CALIB26], (uint16_t)s_dig_H2);
+        m->regs[0xE3] = s_dig_H3;
+        m->regs[0xE4] = (uint8_t)(s_dig_H4 >> 4);
+        m->regs[0xE5] = (uint8_t)((s_dig_H4 & 0x0F) | ((s_dig_H5 & 0x0F) << 4));
+        m->regs[0xE6] = (uint8_t)(s_dig_H5 >> 4);
+        m->regs[0xE7] = (uint8_t)s_dig_H6;
+    }
+
+    /* data registers read 0x80000 (skipped) until the first conversion */
+    m->regs[0xF7] = 0x80;
+    m->regs[0xFA] = 0x80;
+    m->regs[0xFD] = 0x80;
+    m->ptr = 0;
+}
+
+static void bme280_latch(i2c_mock_bme280_t *m)
+{
+    uint8_t *d = &m->regs[BME280_REG_DATA];
+    d[0] = (m->adc_P >> 12) & 0xFF;
+    d[1] = (m->adc_P >> 4) & 0xFF;
+    d[2] = (m->adc_P & 0x0F) << 4;
+    d[3] = (m->adc_T >> 12) & 0xFF;
+    d[4] = (m->adc_T >> 4) & 0xFF;
+    d[5] = (m->adc_T & 0x0F) << 4;
+    if (m->chip_id == I2C_MOCK_BME280_CHIP_ID) {
+        d[6] = (m->adc_H >> 8) & 0xFF;
+        d[7] = m->adc_H & 0xFF;
+    }
+}
+
+static void bme280_write_reg(i2c_mock_bme280_t *m, uint8_t reg, uint8_t val)
+{
+    switch (reg) {
+    case BME280_REG_RESET:
+        if (val == BME280_RESET_CMD) {
+            m->soft_resets++;
+            bme280_reset(m);
+        }
+        break;
+    case BME280_REG_CTRL_HUM:
+        if (m->chip_id == I2C_MOCK_BME280_CHIP_ID) {
+            m->regs[reg] = val & 0x07;
+        }
+        break;
+    case BME280_REG_CTRL_MEAS:
+        m->regs[reg] = val;
+        if ((val & BME280_MODE_MASK) != 0) {
+            bme280_latch(m);
+        }
+        if ((val & BME280_MODE_MASK) != BME280_MODE_NORMAL) {
+            m->regs[reg] &= ~BME280_MODE_MASK;                                                              /*!< Forced conversion done, back to sleep */
+        }
+        break;
+    case BME280_REG_CONFIG:
+        m->regs[reg] = val & 0xFD;
+        break;
+    default:
+        break;                                                                                              /*!< Read-only */
+    }
+}
+
+static esp_err_t bme280_write(i2c_mock_model_t *model, const uint8_t *data, size_t len)
+{
+    i2c_mock_bme280_t *m = (i2c_mock_bme280_t *)model;
+    m->ptr = data[0];
+    /* writes are register/value pairs, there is no auto-increment */
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        bme280_write_reg(m, data[i], data[i + 1]);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t bme280_read(i2c_mock_model_t *model, uint8_t *data, size_t len)
+{
+    i2c_mock_bme280_t *m = (i2c_mock_bme280_t *)model;
+    if ((m->regs[BME280_REG_CTRL_MEAS] & BME280_MODE_MASK) == BME280_MODE_NORMAL) {
+        bme280_latch(m);
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = m->regs[m->ptr++];
+    }
+    return ESP_OK;
+}
+
+void i2c_mock_bme280_init(i2c_mock_bme280_t *m, uint8_t addr, uint8_t chip_id)
+{
+    memset(m, 0, sizeof(*m));
+    m->base = (i2c_mock_model_t) {
+        .name = chip_id == I2C_MOCK_BME280_CHIP_ID ? "BME280" : "BMP280",
+        .addr = addr,
+        .write = bme280_write,
+        .read = bme280_read,
+    };
+    m->chip_id = chip_id;
+    m->adc_T = 519888;
+    m->adc_P = 415148;
+    m->adc_H = 32768;
+    bme280_reset(m);
+}
+
+void i2c_mock_bme280_set_raw(i2c_mock_bme280_t *m, int32_t adc_T, int32_t adc_P, int32_t adc_H)
+{
+    m->adc_T = adc_T;
+    m->adc_P = adc_P;
+    m->adc_H = adc_H;
+}
+
+static int32_t bme280_compensate_T(int32_t adc_T)
+{
+    int32_t var1 = ((((adc_T >> 3) - ((int32_t)s_dig_T1 << 1))) * ((int32_t)s_dig_T2)) >> 11;
+    int32_t var2 = (((((adc_T >> 4) - ((int32_t)s_dig_T1)) * ((adc_T >> 4) - ((int32_t)s_dig_T1))) >> 12) * ((int32_t)s_dig_T3)) >> 14;
+    return ((var1 + var2) * 5 + 128) >> 8;
+}
+
+int32_t i2c_mock_bme280_expected_temp(const i2c_mock_bme280_t *m)
+{
+    return bme280_compensate_T(m->adc_T);
+}
+
+int32_t i2c_mock_bme280_raw_for_temp(const i2c_mock_bme280_t *m, int32_t centi_deg)
+{
+    /* compensation is monotonic over the usable range, bisect the 20-bit raw value */
+    int32_t lo = 0, hi = (1 << 20) - 1;
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (bme280_compensate_T(mid) < centi_deg) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
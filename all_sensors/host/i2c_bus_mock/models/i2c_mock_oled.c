@@ -0,0 +1,243 @@
+/*
+ * SSD1306 / SH1106 model for the host mock bus.
+ */
+#include <string.h>
+#include "i2c_mock_models.h"
+
+#define OLED_CONTROL_CO        0x80                                                                         /*!< One byte follows, then another control byte */
+#define OLED_CONTROL_DC        0x40                                                                         /*!< Data, not command */
+#define OLED_STATUS_OFF        0x40
+#define OLED_STATUS_SSD1306    0x03
+#define OLED_STATUS_SH1106     0x08
+#define OLED_POWER_ON_PATTERN  0x5A                                                                         /*!< RAM is not cleared at power-up */
+#define OLED_ADDR_HORIZONTAL   0
+#define OLED_ADDR_VERTICAL     1
+#define OLED_ADDR_PAGE         2
+
+/**
+ * @brief Length of a command including the opcode
+ */
+static int oled_cmd_size(const i2c_mock_oled_t *m, uint8_t op)
+{
+    if (m->sh1106) {
+        switch (op) {
+        case 0x81: case 0xA8: case 0xAD: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+            return 2;
+        default:
+            return 1;                                                                                       /*!< SSD1306 only commands are taken as single bytes */
+        }
+    }
+    switch (op) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xAD: case 0xD3: case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 2;
+    case 0x21: case 0x22: case 0xA3:
+        return 3;
+    case 0x29: case 0x2A:
+        return 6;
+    case 0x26: case 0x27:
+        return 7;
+    default:
+        return 1;
+    }
+}
+
+static void oled_exec(i2c_mock_oled_t *m)
+{
+    const uint8_t *c = m->cmd;
+    uint8_t op = c[0];
+    m->commands++;
+
+    if (op <= 0x0F) {
+        m->col = (m->col & 0xF0) | op;
+        return;
+    }
+    if (op <= 0x1F) {
+        m->col = (m->col & 0x0F) | ((op & 0x0F) << 4);
+        return;
+    }
+    if (op >= 0x40 && op <= 0x7F) {
+        m->start_line = op & 0x3F;
+        return;
+    }
+    if (op >= 0xB0 && op <= 0xB7) {
+        m->page = op & 0x07;
+        return;
+    }
+    if (m->sh1106 && op >= 0x30 && op <= 0x33) {
+        return;                                                                                             /*!< Pump voltage */
+    }
+
+    switch (op) {
+    case 0x20:
+        if (!m->sh1106 && (c[1] & 0x03) != 0x03) {
+            m->addr_mode = c[1] & 0x03;
+        }
+        break;
+    case 0x21:
+        m->col_start = c[1] & 0x7F;
+        m->col_end = c[2] & 0x7F;
+        m->col = m->col_start;
+        break;
+    case 0x22:
+        m->page_start = c[1] & 0x07;
+        m->page_end = c[2] & 0x07;
+        m->page = m->page_start;
+        break;
+    case 0x26: case 0x27: case 0x29: case 0x2A: case 0xA3:
+        break;                                                                                              /*!< Scroll setup, only activation is tracked */
+    case 0x2E:
+        m->scrolling = false;
+        break;
+    case 0x2F:
+        m->scrolling = true;
+        break;
+    case 0x81:
+        m->contrast = c[1];
+        break;
+    case 0x8D:
+        m->charge_pump = (c[1] & 0x04) != 0;
+        break;
+    case 0xA0: case 0xA1:
+        m->seg_remap = op & 0x01;
+        break;
+    case 0xA4: case 0xA5:
+        m->entire_on = op & 0x01;
+        break;
+    case 0xA6: case 0xA7:
+        m->inverted = op & 0x01;
+        break;
+    case 0xA8:
+        m->mux = c[1] & 0x3F;
+        break;
+    case 0xAD:
+        if (m->sh1106) {
+            m->charge_pump = c[1] & 0x01;                                                                   /*!< SH1106 DC-DC */
+        }
+        break;                                                                                              /*!< SSD1306B internal IREF */
+    case 0xAE: case 0xAF:
+        m->display_on = op & 0x01;
+        break;
+    case 0xC0: case 0xC8:
+        m->com_remap = (op & 0x08) != 0;
+        break;
+    case 0xD3:
+        m->display_offset = c[1] & 0x3F;
+        break;
+    case 0xD5:
+        m->clock_div = c[1];
+        break;
+    case 0xD9: case 0xDA: case 0xDB: case 0xE3:
+        break;
+    default:
+        m->commands--;
+        m->unknown_commands++;
+        break;
+    }
+}
+
+static void oled_cmd_byte(i2c_mock_oled_t *m, uint8_t b)
+{
+    if (m->cmd_len == 0) {
+        m->cmd_need = oled_cmd_size(m, b);
+    }
+    m->cmd[m->cmd_len++] = b;
+    if (m->cmd_len == m->cmd_need) {
+        oled_exec(m);
+        m->cmd_len = 0;
+    }
+}
+
+static void oled_data_byte(i2c_mock_oled_t *m, uint8_t b)
+{
+    if (m->col < m->columns) {
+        m->ram[m->page][m->col] = b;
+    }
+    m->data_bytes++;
+
+    switch (m->addr_mode) {
+    case OLED_ADDR_HORIZONTAL:
+        if (++m->col > m->col_end) {
+            m->col = m->col_start;
+            m->page = m->page >= m->page_end ? m->page_start : m->page + 1;
+        }
+        break;
+    case OLED_ADDR_VERTICAL:
+        if (++m->page > m->page_end) {
+            m->page = m->page_start;
+            m->col = m->col >= m->col_end ? m->col_start : m->col + 1;
+        }
+        break;
+    default:
+        if (++m->col >= m->columns) {
+            m->col = 0;
+        }
+        break;
+    }
+}
+
+static esp_err_t oled_write(i2c_mock_model_t *model, const uint8_t *data, size_t len)
+{
+    i2c_mock_oled_t *m = (i2c_mock_oled_t *)model;
+    size_t i = 0;
+    while (i < len) {
+        uint8_t control = data[i++];
+        bool is_data = control & OLED_CONTROL_DC;
+        size_t end = (control & OLED_CONTROL_CO) ? (i < len ? i + 1 : i) : len;
+        for (; i < end; i++) {
+            if (is_data) {
+                oled_data_byte(m, data[i]);
+            } else {
+                oled_cmd_byte(m, data[i]);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t oled_read(i2c_mock_model_t *model, uint8_t *data, size_t len)
+{
+    i2c_mock_oled_t *m = (i2c_mock_oled_t *)model;
+    uint8_t status = (m->sh1106 ? OLED_STATUS_SH1106 : OLED_STATUS_SSD1306) | (m->display_on ? 0 : OLED_STATUS_OFF);
+    memset(data, status, len);
+    return ESP_OK;
+}
+
+void i2c_mock_oled_spi_rx(void *ctx, uint32_t dc, const uint8_t *data, size_t len)
+{
+    i2c_mock_oled_t *m = (i2c_mock_oled_t *)ctx;
+    for (size_t i = 0; i < len; i++) {
+        if (dc) {
+            oled_data_byte(m, data[i]);
+        } else {
+            oled_cmd_byte(m, data[i]);
+        }
+    }
+}
+
+void i2c_mock_oled_init(i2c_mock_oled_t *m, uint8_t addr, bool sh1106)
+{
+    memset(m, 0, sizeof(*m));
+    m->base = (i2c_mock_model_t) {
+        .name = sh1106 ? "SH1106" : "SSD1306",
+        .addr = addr,
+        .write = oled_write,
+        .read = oled_read,
+    };
+    m->sh1106 = sh1106;
+    m->columns = sh1106 ? 132 : 128;
+    memset(m->ram, OLED_POWER_ON_PATTERN, sizeof(m->ram));
+    m->addr_mode = OLED_ADDR_PAGE;
+    m->col_end = 127;
+    m->page_end = I2C_MOCK_OLED_PAGES - 1;
+    m->contrast = 0x7F;
+    m->mux = 63;
+    m->clock_div = 0x80;
+}
+
+bool i2c_mock_oled_pixel(const i2c_mock_oled_t *m, int x, int y)
+{
+    if (x < 0 || x >= m->columns || y < 0 || y >= I2C_MOCK_OLED_PAGES * 8) {
+        return false;
+    }
+    return (m->ram[y / 8][x] >> (y % 8)) & 1;
+}
@@ -0,0 +1,631 @@
+/*
+ * Decoder and replayer of the I2C transaction trace (components/i2c_bus/i2c_bus_trace.h).
+ *
+ * The firmware prints the trace ring buffer on the console with i2c_bus_trace_dump(); capture the monitor output to
+ * a file and:
+ *   decode   FILE              one line per transfer: time, duration, device, payload, result
+ *   timeline FILE [BIN_MS]     per device totals and bus utilisation per time bin (default 100 ms)
+ *   replay   FILE [CLK_HZ]     run the transfers again on the mock bus (host/i2c_bus_mock) against models of the
+ *                              devices at their usual addresses, with the recorded errors injected again, and report
+ *                              divergences, modelled against recorded bus time and the final OLED picture
+ *   demo     [LOOPS]           run the sensing loop on the mock bus with a few faults and print its trace, to check
+ *                              the tool end to end: i2c_trace demo > t.log && i2c_trace replay t.log
+ *
+ * Only lines containing "I2CT " are read, so the whole monitor log can be passed. If the log holds several dumps, the
+ * last complete one is used. Timestamps are unwrapped (they are the low 32 bits of esp_timer).
+ *
+ * Replay is only as good as the trace: transfers longer than I2C_BUS_TRACE_DATA_BYTES are padded with zeros and
+ * transfers made through i2c_bus_cmd_begin are skipped since their payload is not recorded.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_bus.h"
+#include "i2c_bus_mock.h"
+#include "i2c_bus_trace.h"
+#include "i2c_mock_models.h"
+#include "ssd1306.h"
+#include "sensors.h"
+
+#define TRACE_MAX_PORTS     I2C_NUM_MAX
+#define TRACE_LINE_MAX      512
+#define TRACE_DEFAULT_BIN   100
+#define TRACE_DEFAULT_CLK   400000
+#define TRACE_BAR_WIDTH     50
+#define TRACE_SHOW_DIVERGED 20
+#define DEMO_PORT           I2C_NUM_0
+#define DEMO_BME_ADDR       0x76
+#define DEMO_BH_ADDR        0x23
+#define DEMO_OLED_ADDR      0x3C
+#define DEMO_LOOP_MS        500
+
+typedef struct {
+    i2c_bus_trace_record_t rec;
+    int64_t t_us;                   /* unwrapped, relative to the first record */
+} trace_entry_t;
+
+typedef struct {
+    trace_entry_t *e;
+    size_t n;
+    uint32_t dropped;
+    int64_t now_us;                 /* esp_timer at the dump, relative to the first record */
+} trace_t;
+
+/* ------------------------------------------------------------------------------------------------ parsing */
+
+static int hex_nibble(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool hex_record(const char *s, i2c_bus_trace_record_t *rec)
+{
+    uint8_t *b = (uint8_t *)rec;
+    for (size_t i = 0; i < sizeof(*rec); i++) {
+        int hi = hex_nibble(s[2 * i]);
+        int lo = hi < 0 ? -1 : hex_nibble(s[2 * i + 1]);
+        if (lo < 0) {
+            return false;
+        }
+        b[i] = (uint8_t)(hi << 4 | lo);
+    }
+    return true;
+}
+
+/**
+ * @brief Read the last complete dump of a log
+ */
+static bool trace_load(const char *path, trace_t *t)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    memset(t, 0, sizeof(*t));
+    trace_entry_t *cur = NULL;
+    size_t cur_n = 0, cur_cap = 0;
+    bool in_dump = false, found = false;
+    uint32_t cur_dropped = 0;
+    uint32_t cur_now = 0;
+    unsigned bad = 0;
+    char line[TRACE_LINE_MAX];
+
+    while (fgets(line, sizeof(line), f)) {
+        char *p = strstr(line, I2C_BUS_TRACE_DUMP_TAG " ");
+        if (!p) {
+            continue;
+        }
+        p += sizeof(I2C_BUS_TRACE_DUMP_TAG);
+        if (strncmp(p, "BEGIN", 5) == 0) {
+            unsigned version = 0, size = 0;
+            unsigned long records = 0, dropped = 0;
+            long long now = 0;
+            if (sscanf(p, "BEGIN v%u records=%lu dropped=%lu size=%u now_us=%lld",
+                       &version, &records, &dropped, &size, &now) != 5
+                    || version != I2C_BUS_TRACE_VERSION || size != sizeof(i2c_bus_trace_record_t)) {
+                fprintf(stderr, "%s: unsupported dump header: %s", path, p);
+                in_dump = false;
+                continue;
+            }
+            in_dump = true;
+            cur_n = 0;
+            cur_dropped = (uint32_t)dropped;
+            cur_now = (uint32_t)now;
+        } else if (strncmp(p, "END", 3) == 0) {
+            if (in_dump) {
+                free(t->e);
+                t->e = cur;
+                t->n = cur_n;
+                t->dropped = cur_dropped;
+                t->now_us = cur_now;
+                cur = NULL;
+                cur_cap = 0;
+                found = true;
+            }
+            in_dump = false;
+        } else if (in_dump) {
+            i2c_bus_trace_record_t rec;
+            if (!hex_record(p, &rec)) {
+                bad++;
+                continue;
+            }
+            if (cur_n == cur_cap) {
+                cur_cap = cur_cap ? cur_cap * 2 : 256;
+                cur = realloc(cur, cur_cap * sizeof(*cur));
+            }
+            cur[cur_n++].rec = rec;
+        }
+    }
+    fclose(f);
+    free(cur);
+    if (!found) {
+        fprintf(stderr, "%s: no complete " I2C_BUS_TRACE_DUMP_TAG " dump found\n", path);
+        return false;
+    }
+    if (bad) {
+        fprintf(stderr, "%s: %u garbled lines skipped\n", path, bad);
+    }
+
+    /* Unwrap the 32-bit timestamps, records are in start order */
+    int64_t t0 = t->n ? t->e[0].rec.t_us : 0;
+    int64_t base = 0;
+    uint32_t prev = t->n ? t->e[0].rec.t_us : 0;
+    for (size_t i = 0; i < t->n; i++) {
+        uint32_t now = t->e[i].rec.t_us;
+        if (now < prev && prev - now > UINT32_MAX / 2) {
+            base += (int64_t)1 << 32;
+        }
+        prev = now;
+        t->e[i].t_us = base + now - t0;
+    }
+    uint32_t dump_at = (uint32_t)t->now_us;
+    t->now_us = base + dump_at - t0 + (dump_at < prev && prev - dump_at > UINT32_MAX / 2 ? (int64_t)1 << 32 : 0);
+    return true;
+}
+
+static const char *device_name(uint8_t addr)
+{
+    switch (addr) {
+    case 0x23: case 0x5C: return "BH1750";
+    case 0x3C: case 0x3D: return "OLED";
+    case 0x76: case 0x77: return "BME280";
+    default: return "?";
+    }
+}
+
+static const char *source_name(uint8_t flags)
+{
+    if (flags & I2C_BUS_TRACE_FLAG_OPAQUE) {
+        return "cmd";
+    }
+    return (flags & I2C_BUS_TRACE_SRC_MASK) == I2C_BUS_TRACE_SRC_DRIVER ? "drv" : "bus";
+}
+
+static void print_bytes(const uint8_t *data, size_t stored, size_t len)
+{
+    for (size_t i = 0; i < stored; i++) {
+        printf(" %02x", data[i]);
+    }
+    if (len > stored) {
+        printf(" ..+%zu", len - stored);
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------ decode */
+
+static int cmd_decode(const trace_t *t)
+{
+    printf("%zu transfers, %" PRIu32 " older ones dropped, dumped at %.3f ms\n", t->n, t->dropped, t->now_us / 1000.0);
+    printf("      t (ms)   dur  port addr dev    src   W    R  data\n");
+    for (size_t i = 0; i < t->n; i++) {
+        const i2c_bus_trace_record_t *r = &t->e[i].rec;
+        printf("%12.3f %5u%s  %3u  0x%02x %-6s %s %4u %4u ", t->e[i].t_us / 1000.0, r->duration_us,
+               r->duration_us == UINT16_MAX ? "+" : " ", r->port, r->addr, device_name(r->addr), source_name(r->flags),
+               r->write_len, r->read_len);
+        if (r->write_len) {
+            printf(" W");
+            print_bytes(r->data, r->write_stored, r->write_len);
+        }
+        size_t read_stored = I2C_BUS_TRACE_DATA_BYTES - r->write_stored;
+        if (r->read_len && r->err == ESP_OK) {
+            printf(" R");
+            print_bytes(r->data + r->write_stored, r->read_len < read_stored ? r->read_len : read_stored, r->read_len);
+        }
+        if (r->err != ESP_OK) {
+            printf("  %s", esp_err_to_name(r->err));
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------ timeline */
+
+typedef struct {
+    uint8_t port, addr;
+    uint32_t transfers, errors;
+    uint64_t written, read;
+    uint64_t busy_us;
+    uint16_t *durations;
+} device_total_t;
+
+static int cmp_u16(const void *a, const void *b)
+{
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static int cmd_timeline(const trace_t *t, int bin_ms)
+{
+    if (t->n == 0) {
+        printf("empty trace\n");
+        return 0;
+    }
+    device_total_t dev[64];
+    size_t ndev = 0;
+    uint64_t busy = 0;
+    for (size_t i = 0; i < t->n; i++) {
+        const i2c_bus_trace_record_t *r = &t->e[i].rec;
+        device_total_t *d = NULL;
+        for (size_t k = 0; k < ndev; k++) {
+            if (dev[k].port == r->port && dev[k].addr == r->addr) {
+                d = &dev[k];
+            }
+        }
+        if (!d) {
+            if (ndev == sizeof(dev) / sizeof(dev[0])) {
+                continue;
+            }
+            d = &dev[ndev++];
+            memset(d, 0, sizeof(*d));
+            d->port = r->port;
+            d->addr = r->addr;
+            d->durations = malloc(t->n * sizeof(uint16_t));
+        }
+        d->durations[d->transfers++] = r->duration_us;
+        d->errors += r->err != ESP_OK;
+        d->written += r->write_len;
+        d->read += r->read_len;
+        d->busy_us += r->duration_us;
+        busy += r->duration_us;
+    }
+
+    int64_t span = t->e[t->n - 1].t_us + t->e[t->n - 1].rec.duration_us;
+    printf("%zu transfers over %.1f ms, bus busy %.2f%%\n\n", t->n, span / 1000.0, span ? 100.0 * busy / span : 0.0);
+    printf("port addr dev     transfers  written     read  busy ms  share  errors  p50 us  max us\n");
+    for (size_t k = 0; k < ndev; k++) {
+        device_total_t *d = &dev[k];
+        qsort(d->durations, d->transfers, sizeof(uint16_t), cmp_u16);
+        printf("%4u 0x%02x %-6s %10" PRIu32 " %8" PRIu64 " %8" PRIu64 " %8.1f %5.1f%% %7" PRIu32 " %7u %7u\n",
+               d->port, d->addr, device_name(d->addr), d->transfers, d->written, d->read, d->busy_us / 1000.0,
+               busy ? 100.0 * d->busy_us / busy : 0.0, d->errors, d->durations[d->transfers / 2],
+               d->durations[d->transfers - 1]);
+        free(d->durations);
+    }
+
+    /* Busy time per bin, a transfer crossing a bin boundary is split between the bins */
+    int64_t bin_us = (int64_t)bin_ms * 1000;
+    size_t nbins = (size_t)(span / bin_us) + 1;
+    uint64_t *bins = calloc(nbins, sizeof(uint64_t));
+    uint32_t *bin_err = calloc(nbins, sizeof(uint32_t));
+    for (size_t i = 0; i < t->n; i++) {
+        int64_t s = t->e[i].t_us;
+        int64_t e = s + t->e[i].rec.duration_us;
+        bin_err[s / bin_us] += t->e[i].rec.err != ESP_OK;
+        while (s < e) {
+            int64_t edge = (s / bin_us + 1) * bin_us;
+            int64_t end = e < edge ? e : edge;
+            bins[s / bin_us] += end - s;
+            s = end;
+        }
+    }
+    printf("\n      t (ms)  busy  |%*s| errors\n", TRACE_BAR_WIDTH, "");
+    for (size_t b = 0; b < nbins; b++) {
+        double share = (double)bins[b] / bin_us;
+        int len = (int)(share * TRACE_BAR_WIDTH + 0.5);
+        printf("%12.1f %5.1f%% |", b * (double)bin_ms, 100.0 * share);
+        for (int i = 0; i < TRACE_BAR_WIDTH; i++) {
+            putchar(i < len ? '#' : ' ');
+        }
+        printf("|");
+        if (bin_err[b]) {
+            printf(" %" PRIu32, bin_err[b]);
+        }
+        printf("\n");
+    }
+    free(bins);
+    free(bin_err);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------ replay */
+
+typedef struct {
+    i2c_mock_bme280_t bme[2];
+    i2c_mock_bh1750_t bh[2];
+    i2c_mock_oled_t oled[2];
+    bool has_oled[2];
+} port_models_t;
+
+static port_models_t s_models[TRACE_MAX_PORTS];
+
+/**
+ * @brief Put a model on the bus for every known address the trace talks to
+ */
+static void replay_attach(const trace_t *t, uint32_t clk_hz, bool *port_ok)
+{
+    static const int sda[TRACE_MAX_PORTS] = { 21, 33 };
+    static const int scl[TRACE_MAX_PORTS] = { 22, 32 };
+    bool used[TRACE_MAX_PORTS][128] = { 0 };
+    for (size_t i = 0; i < t->n; i++) {
+        if (t->e[i].rec.port < TRACE_MAX_PORTS) {
+            used[t->e[i].rec.port][t->e[i].rec.addr & 0x7F] = true;
+        }
+    }
+    for (int port = 0; port < TRACE_MAX_PORTS; port++) {
+        port_models_t *m = &s_models[port];
+        port_ok[port] = false;
+        bool any = false;
+        for (int a = 0; a < 128; a++) {
+            any |= used[port][a];
+        }
+        if (!any) {
+            continue;
+        }
+        i2c_config_t conf = {
+            .mode = I2C_MODE_MASTER,
+            .sda_io_num = sda[port],
+            .scl_io_num = scl[port],
+            .sda_pullup_en = true,
+            .scl_pullup_en = true,
+            .master.clk_speed = clk_hz,
+        };
+        port_ok[port] = i2c_param_config(port, &conf) == ESP_OK
+                        && i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0) == ESP_OK;
+        for (int k = 0; k < 2; k++) {
+            uint8_t bme = 0x76 + k, bh = k ? 0x5C : 0x23, oled = 0x3C + k;
+            if (used[port][bme]) {
+                i2c_mock_bme280_init(&m->bme[k], bme, I2C_MOCK_BME280_CHIP_ID);
+                i2c_mock_attach(port, &m->bme[k].base);
+            }
+            if (used[port][bh]) {
+                i2c_mock_bh1750_init(&m->bh[k], bh);
+                i2c_mock_attach(port, &m->bh[k].base);
+            }
+            if (used[port][oled]) {
+                i2c_mock_oled_init(&m->oled[k], oled, false);
+                i2c_mock_attach(port, &m->oled[k].base);
+                m->has_oled[k] = true;
+            }
+        }
+    }
+}
+
+static void print_oled(const i2c_mock_oled_t *m, int port)
+{
+    /* Two pixel rows per character */
+    printf("\nOLED 0x%02x on port %d (display %s%s):\n", m->base.addr, port, m->display_on ? "on" : "off",
+           m->inverted ? ", inverted" : "");
+    printf("+");
+    for (int x = 0; x < 128; x++) {
+        putchar('-');
+    }
+    printf("+\n");
+    for (int y = 0; y < I2C_MOCK_OLED_PAGES * 8; y += 2) {
+        printf("|");
+        for (int x = 0; x < 128; x++) {
+            int top = i2c_mock_oled_pixel(m, x, y);
+            int bottom = i2c_mock_oled_pixel(m, x, y + 1);
+            putchar(" '.:"[top | bottom << 1]);
+        }
+        printf("|\n");
+    }
+    printf("+");
+    for (int x = 0; x < 128; x++) {
+        putchar('-');
+    }
+    printf("+\n");
+}
+
+static int cmd_replay(const trace_t *t, uint32_t clk_hz)
+{
+    static uint8_t write_buf[UINT16_MAX];
+    static uint8_t read_buf[UINT16_MAX];
+    bool port_ok[TRACE_MAX_PORTS];
+    uint32_t opaque = 0, skipped = 0, injected = 0, diverged = 0, read_differs = 0, replayed = 0, padded = 0;
+    uint64_t recorded_us = 0, modelled_us = 0;
+
+    i2c_mock_reset();
+    memset(s_models, 0, sizeof(s_models));
+    replay_attach(t, clk_hz, port_ok);
+
+    printf("replaying %zu transfers at %" PRIu32 " Hz\n", t->n, clk_hz);
+    for (size_t i = 0; i < t->n; i++) {
+        const i2c_bus_trace_record_t *r = &t->e[i].rec;
+        if (r->flags & I2C_BUS_TRACE_FLAG_OPAQUE) {
+            opaque++;
+            continue;
+        }
+        if (r->port >= TRACE_MAX_PORTS || !port_ok[r->port]) {
+            skipped++;
+            continue;
+        }
+        int64_t lag = t->e[i].t_us - esp_timer_get_time();
+        if (lag > 0) {
+            host_clock_advance_us(lag);
+        }
+
+        /* The recorded failure happens again, so the models end up in the state the devices were in */
+        if (r->err != ESP_OK) {
+            i2c_mock_fault_t f = { .addr = r->addr, .count = 1, .err = r->err };
+            i2c_mock_inject(r->port, &f);
+            injected++;
+        }
+
+        padded += r->write_len > r->write_stored;
+        memset(write_buf, 0, r->write_len);
+        memcpy(write_buf, r->data, r->write_stored);
+        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+        if (r->write_len || !r->read_len) {
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (uint8_t)(r->addr << 1 | I2C_MASTER_WRITE), true);
+            if (r->write_len) {
+                i2c_master_write(cmd, write_buf, r->write_len, true);
+            }
+        }
+        if (r->read_len) {
+            i2c_master_start(cmd);
+            i2c_master_write_byte(cmd, (uint8_t)(r->addr << 1 | I2C_MASTER_READ), true);
+            i2c_master_read(cmd, read_buf, r->read_len, I2C_MASTER_LAST_NACK);
+        }
+        i2c_master_stop(cmd);
+        uint64_t busy0 = i2c_mock_busy_us(r->port);
+        esp_err_t ret = i2c_master_cmd_begin(r->port, cmd, pdMS_TO_TICKS(1000));
+        i2c_cmd_link_delete(cmd);
+        i2c_mock_clear_faults();
+        replayed++;
+        recorded_us += r->duration_us;
+        modelled_us += i2c_mock_busy_us(r->port) - busy0;
+
+        if (ret != r->err) {
+            if (diverged++ < TRACE_SHOW_DIVERGED) {
+                printf("  %10.3f ms  0x%02x %-6s recorded %s, replay %s\n", t->e[i].t_us / 1000.0, r->addr,
+                       device_name(r->addr), esp_err_to_name(r->err), esp_err_to_name(ret));
+            }
+            continue;
+        }
+        size_t room = I2C_BUS_TRACE_DATA_BYTES - r->write_stored;
+        size_t n = r->read_len < room ? r->read_len : room;
+        if (ret == ESP_OK && memcmp(read_buf, r->data + r->write_stored, n) != 0) {
+            read_differs++;
+        }
+    }
+
+    printf("%" PRIu32 " replayed, %" PRIu32 " recorded errors injected again, %" PRIu32 " cmd_begin transfers and "
+           "%" PRIu32 " on unusable ports skipped\n", replayed, injected, opaque, skipped);
+    printf("%" PRIu32 " writes longer than %d bytes padded with zeros (command sequences may be cut short)\n", padded,
+           I2C_BUS_TRACE_DATA_BYTES);
+    printf("%" PRIu32 " results diverge from the recording, %" PRIu32 " reads return other data than the devices "
+           "did (expected, the models do not know the field values)\n", diverged, read_differs);
+    printf("bus time: recorded %.1f ms, modelled %.1f ms at %" PRIu32 " Hz", recorded_us / 1000.0,
+           modelled_us / 1000.0, clk_hz);
+    if (modelled_us) {
+        printf(", recorded/modelled %.2f", (double)recorded_us / modelled_us);
+    }
+    printf("\n");
+
+    for (int port = 0; port < TRACE_MAX_PORTS; port++) {
+        for (int k = 0; k < 2; k++) {
+            if (s_models[port].has_oled[k]) {
+                print_oled(&s_models[port].oled[k], port);
+            }
+        }
+    }
+    return diverged ? 1 : 0;
+}
+
+/* ------------------------------------------------------------------------------------------------ demo */
+
+static int cmd_demo(int loops)
+{
+    static i2c_mock_bme280_t bme;
+    static i2c_mock_bh1750_t bh;
+    static i2c_mock_oled_t oled;
+    static SSD1306_t dev;
+    sensors_t sensors = { 0 };
+    readings_t r = { 0 };
+    char buf_t[20], buf_p[30], buf_l[20];
+
+    i2c_mock_reset();
+    i2c_mock_bme280_init(&bme, DEMO_BME_ADDR, I2C_MOCK_BME280_CHIP_ID);
+    i2c_mock_bh1750_init(&bh, DEMO_BH_ADDR);
+    i2c_mock_oled_init(&oled, DEMO_OLED_ADDR, false);
+    bh.lux = 250.0f;
+    i2c_mock_attach(DEMO_PORT, &bme.base);
+    i2c_mock_attach(DEMO_PORT, &bh.base);
+    i2c_mock_attach(DEMO_PORT, &oled.base);
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = 21,
+        .scl_io_num = 22,
+        .sda_pullup_en = true,
+        .scl_pullup_en = true,
+        .master.clk_speed = TRACE_DEFAULT_CLK,
+    };
+    i2c_bus_handle_t bus = i2c_bus_create(DEMO_PORT, &conf);
+    sensors.bme_dev = i2c_bus_device_create(bus, DEMO_BME_ADDR, 0);
+    sensors.bh_dev = i2c_bus_device_create(bus, DEMO_BH_ADDR, 0);
+    i2c_device_add(&dev, DEMO_PORT, -1, DEMO_OLED_ADDR);
+    ssd1306_init(&dev, 128, 64);
+    ssd1306_clear_screen(&dev, false);
+
+    for (int i = 0; i < loops; i++) {
+        if (i == loops / 3) {
+            i2c_mock_fault_t nack = { .addr = DEMO_BME_ADDR, .count = 2, .err = ESP_FAIL };
+            i2c_mock_inject(DEMO_PORT, &nack);
+        }
+        if (i == 2 * loops / 3) {
+            i2c_mock_fault_t slow = { .addr = DEMO_BH_ADDR, .count = 3, .delay_us = 2000 };
+            i2c_mock_inject(DEMO_PORT, &slow);
+            bh.lux = 800.0f;
+        }
+        sensors_poll(&sensors, &r);
+        ssd1306_display_text(&dev, 0, "12:00:00", 8, false);
+        sensors_format_env(&r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+        ssd1306_display_text(&dev, 2, buf_t, strlen(buf_t), false);
+        ssd1306_display_text(&dev, 3, buf_p, strlen(buf_p), false);
+        sensors_format_lux(&r, buf_l, sizeof(buf_l));
+        ssd1306_display_text(&dev, 6, buf_l, strlen(buf_l), false);
+        vTaskDelay(pdMS_TO_TICKS(DEMO_LOOP_MS));
+    }
+    i2c_mock_clear_faults();
+    i2c_bus_trace_dump(stdout);
+
+    i2c_bus_device_delete(&sensors.bme_dev);
+    i2c_bus_device_delete(&sensors.bh_dev);
+    i2c_bus_delete(&bus);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------------------------------ main */
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: i2c_trace decode FILE\n"
+                    "       i2c_trace timeline FILE [BIN_MS]\n"
+                    "       i2c_trace replay FILE [CLK_HZ]\n"
+                    "       i2c_trace demo [LOOPS]\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage();
+        return 2;
+    }
+    if (strcmp(argv[1], "demo") == 0) {
+        int loops = argc > 2 ? atoi(argv[2]) : 20;
+        return cmd_demo(loops > 0 ? loops : 20);
+    }
+    if (argc < 3) {
+        usage();
+        return 2;
+    }
+
+    trace_t t;
+    if (!trace_load(argv[2], &t)) {
+        return 2;
+    }
+    int ret;
+    if (strcmp(argv[1], "decode") == 0) {
+        ret = cmd_decode(&t);
+    } else if (strcmp(argv[1], "timeline") == 0) {
+        int bin = argc > 3 ? atoi(argv[3]) : TRACE_DEFAULT_BIN;
+        ret = cmd_timeline(&t, bin > 0 ? bin : TRACE_DEFAULT_BIN);
+    } else if (strcmp(argv[1], "replay") == 0) {
+        long clk = argc > 3 ? atol(argv[3]) : TRACE_DEFAULT_CLK;
+        ret = cmd_replay(&t, clk > 0 ? (uint32_t)clk : TRACE_DEFAULT_CLK);
+    } else {
+        usage();
+        ret = 2;
+    }
+    free(t.e);
+    return ret;
+}
@@ -0,0 +1,510 @@
+/*
+ * Packer of images and animations for the SSD1306 driver (components/ssd1306/ssd1306_asset.h).
+ *
+ *   pack   [-n NAME] [-t MS] [-i] [-b OUT.bin] FRAME[:MS]...   frames to a C array on stdout, or a binary for
+ *                                                              EMBED_FILES with -b
+ *   demo                                                       pack an animated weather icon and a boot splash made
+ *                                                              here, play them on the mock bus and check every frame
+ *
+ * Frames are PBM (P1, P4) or PGM (P5, thresholded at half), at most 128x64, all of one size; export the frames of a
+ * GIF or a PNG to PBM first (e.g. ImageMagick: convert icon.gif -coalesce frame%02d.pbm). Ink, i.e. black in PBM
+ * and dark in PGM, is lit on the panel; -i lights the white instead. Every frame waits -t ms (default 100) or the MS
+ * given after its file name.
+ *
+ * The first frame is a key frame with runs and literals; the others are whichever is smaller of a key frame and a
+ * delta against the frame before, which skips what did not change. Demo exit status is non-zero if the display RAM
+ * does not match a frame or a corrupt asset is drawn; pack exits with 2 on bad arguments or input.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "ssd1306.h"
+#include "ssd1306_asset.h"
+
+#define PACK_MAX_WIDTH      128
+#define PACK_MAX_HEIGHT     64
+#define PACK_MAX_FRAMES     256
+#define PACK_FRAME_BYTES    (PACK_MAX_WIDTH * PACK_MAX_HEIGHT / 8)
+#define PACK_MAX_LEN        (SSD1306_ASSET_HEADER_LEN + PACK_MAX_FRAMES * (SSD1306_ASSET_FRAME_HEADER_LEN + PACK_FRAME_BYTES * 2))
+#define PACK_DEFAULT_DELAY  100
+#define DEMO_SDA_IO         21
+#define DEMO_SCL_IO         22
+
+typedef struct {
+    int width;
+    int height;
+    int frames;
+    uint16_t delay_ms[PACK_MAX_FRAMES];
+    uint8_t *pages[PACK_MAX_FRAMES];                                                /*!< (height + 7) / 8 * width bytes each */
+} frames_t;
+
+static int s_failures;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: oled_asset_pack pack [-n NAME] [-t MS] [-i] [-b OUT.bin] FRAME[:MS]...\n"
+                    "       oled_asset_pack demo\n");
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/**************************************** Packing *********************************************/
+
+static int run_length(const uint8_t *cur, int i, int size)
+{
+    int n = 1;
+    while (i + n < size && cur[i + n] == cur[i] && n < SSD1306_ASSET_OP_MAX) {
+        n++;
+    }
+    return n;
+}
+
+static int skip_length(const uint8_t *cur, const uint8_t *prev, int i, int size)
+{
+    int n = 0;
+    while (prev && i + n < size && cur[i + n] == prev[i + n]) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Ops of one frame, a key frame if prev is NULL. Returns the length written to out.
+ */
+static size_t pack_ops(const uint8_t *cur, const uint8_t *prev, int size, uint8_t *out)
+{
+    size_t len = 0;
+    int i = 0;
+    while (i < size) {
+        int skip = skip_length(cur, prev, i, size);
+        if (skip >= SSD1306_ASSET_OP_MAX) {
+            int n = skip / SSD1306_ASSET_OP_MAX;
+            n = n > SSD1306_ASSET_OP_MAX ? SSD1306_ASSET_OP_MAX : n;
+            out[len++] = SSD1306_ASSET_OP_SKIP_LONG | (n - 1);
+            i += n * SSD1306_ASSET_OP_MAX;
+            continue;
+        }
+        if (skip > 0) {
+            out[len++] = SSD1306_ASSET_OP_SKIP | (skip - 1);
+            i += skip;
+            continue;
+        }
+        int run = run_length(cur, i, size);
+        if (run >= 3) {
+            out[len++] = SSD1306_ASSET_OP_REPEAT | (run - 1);
+            out[len++] = cur[i];
+            i += run;
+            continue;
+        }
+        /* Literal until a run of 3 or 2 unchanged bytes would pay for themselves */
+        int n = 1;
+        while (i + n < size && n < SSD1306_ASSET_OP_MAX && run_length(cur, i + n, size) < 3 &&
+               skip_length(cur, prev, i + n, size) < 2) {
+            n++;
+        }
+        out[len++] = SSD1306_ASSET_OP_LITERAL | (n - 1);
+        memcpy(&out[len], &cur[i], n);
+        len += n;
+        i += n;
+    }
+    return len;
+}
+
+static size_t pack(const frames_t *f, uint8_t *out)
+{
+    int size = (f->height + 7) / 8 * f->width;
+    static uint8_t key[PACK_FRAME_BYTES * 2], delta[PACK_FRAME_BYTES * 2];
+    size_t len = 0;
+
+    out[len++] = 'O';
+    out[len++] = 'A';
+    out[len++] = SSD1306_ASSET_VERSION;
+    out[len++] = f->width;
+    out[len++] = f->height;
+    out[len++] = f->frames & 0xFF;
+    out[len++] = f->frames >> 8;
+    out[len++] = 0;
+    for (int i = 0; i < f->frames; i++) {
+        size_t key_len = pack_ops(f->pages[i], NULL, size, key);
+        size_t delta_len = i > 0 ? pack_ops(f->pages[i], f->pages[i - 1], size, delta) : SIZE_MAX;
+        bool is_key = key_len <= delta_len;
+        size_t ops_len = is_key ? key_len : delta_len;
+        out[len++] = is_key ? SSD1306_ASSET_FRAME_KEY : 0;
+        out[len++] = f->delay_ms[i] & 0xFF;
+        out[len++] = f->delay_ms[i] >> 8;
+        out[len++] = ops_len & 0xFF;
+        out[len++] = ops_len >> 8;
+        memcpy(&out[len], is_key ? key : delta, ops_len);
+        len += ops_len;
+    }
+    return len;
+}
+
+/**************************************** Input *********************************************/
+
+static bool pnm_token(FILE *f, char *tok, size_t len)
+{
+    int c = fgetc(f);
+    while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = fgetc(f);
+            }
+        }
+        c = fgetc(f);
+    }
+    size_t n = 0;
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' && n + 1 < len) {
+        tok[n++] = (char)c;
+        c = fgetc(f);
+    }
+    tok[n] = '\0';
+    return n > 0;
+}
+
+/**
+ * @brief One PBM or PGM frame into page bytes, ink set
+ */
+static bool frame_load(const char *path, frames_t *f, bool invert)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    char magic[4], tok[16];
+    int width = 0, height = 0, maxval = 1;
+    bool ok = pnm_token(file, magic, sizeof(magic)) &&
+              (strcmp(magic, "P1") == 0 || strcmp(magic, "P4") == 0 || strcmp(magic, "P5") == 0);
+    ok = ok && pnm_token(file, tok, sizeof(tok)) && (width = atoi(tok)) > 0;
+    ok = ok && pnm_token(file, tok, sizeof(tok)) && (height = atoi(tok)) > 0;
+    if (ok && strcmp(magic, "P5") == 0) {
+        ok = pnm_token(file, tok, sizeof(tok)) && (maxval = atoi(tok)) > 0 && maxval < 256;
+    }
+    if (!ok || width > PACK_MAX_WIDTH || height > PACK_MAX_HEIGHT) {
+        fprintf(stderr, "%s: not a PBM or 8-bit PGM of at most %dx%d\n", path, PACK_MAX_WIDTH, PACK_MAX_HEIGHT);
+        fclose(file);
+        return false;
+    }
+    if (f->frames > 0 && (width != f->width || height != f->height)) {
+        fprintf(stderr, "%s: %dx%d, the first frame is %dx%d\n", path, width, height, f->width, f->height);
+        fclose(file);
+        return false;
+    }
+    if (f->frames == PACK_MAX_FRAMES) {
+        fprintf(stderr, "%s: more than %d frames\n", path, PACK_MAX_FRAMES);
+        fclose(file);
+        return false;
+    }
+    f->width = width;
+    f->height = height;
+    uint8_t *pages = calloc((height + 7) / 8, width);
+
+    for (int y = 0; y < height && ok; y++) {
+        uint8_t row[PACK_MAX_WIDTH];
+        if (strcmp(magic, "P4") == 0) {
+            uint8_t packed[PACK_MAX_WIDTH / 8];
+            ok = fread(packed, 1, (width + 7) / 8, file) == (size_t)(width + 7) / 8;
+            for (int x = 0; x < width; x++) {
+                row[x] = (packed[x / 8] >> (7 - x % 8)) & 1;
+            }
+        } else if (strcmp(magic, "P1") == 0) {
+            for (int x = 0; x < width && ok; x++) {
+                int c;
+                do {
+                    c = fgetc(file);
+                } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+                ok = c == '0' || c == '1';
+                row[x] = c == '1';
+            }
+        } else {
+            ok = fread(row, 1, width, file) == (size_t)width;
+            for (int x = 0; x < width; x++) {
+                row[x] = row[x] * 2 < maxval;
+            }
+        }
+        for (int x = 0; x < width; x++) {
+            if (row[x] != invert) {
+                pages[y / 8 * width + x] |= 1 << (y % 8);
+            }
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s: truncated\n", path);
+        free(pages);
+        return false;
+    }
+    f->pages[f->frames++] = pages;
+    return true;
+}
+
+static void emit(const char *name, const frames_t *f, const uint8_t *data, size_t len)
+{
+    int raw = f->frames * ((f->height + 7) / 8) * f->width;
+    printf("// Generated by oled_asset_pack: %dx%d, %d frame%s, %d bytes raw, %zu packed\n", f->width, f->height,
+           f->frames, f->frames == 1 ? "" : "s", raw, len);
+    printf("#include <stdint.h>\n\n");
+    printf("static const uint8_t %s[%zu] = {", name, len);
+    for (size_t i = 0; i < len; i++) {
+        printf("%s0x%02X,", i % 16 ? " " : "\n\t", data[i]);
+    }
+    printf("\n};\n");
+}
+
+static int cmd_pack(int argc, char **argv)
+{
+    static frames_t f;
+    static uint8_t out[PACK_MAX_LEN];
+    const char *name = "asset";
+    const char *bin = NULL;
+    int delay = PACK_DEFAULT_DELAY;
+    bool invert = false;
+
+    for (int i = 0; i < argc; i++) {
+        bool has_arg = i + 1 < argc;
+        if (strcmp(argv[i], "-n") == 0 && has_arg) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && has_arg) {
+            delay = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && has_arg) {
+            bin = argv[++i];
+        } else if (strcmp(argv[i], "-i") == 0) {
+            invert = true;
+        } else if (argv[i][0] != '-') {
+            char path[256];
+            snprintf(path, sizeof(path), "%s", argv[i]);
+            char *colon = strrchr(path, ':');
+            int frame_delay = delay;
+            if (colon) {
+                *colon = '\0';
+                frame_delay = atoi(colon + 1);
+            }
+            if (!frame_load(path, &f, invert)) {
+                return 2;
+            }
+            f.delay_ms[f.frames - 1] = (uint16_t)(frame_delay < 0 ? 0 : frame_delay > UINT16_MAX ? UINT16_MAX : frame_delay);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (f.frames == 0) {
+        usage();
+        return 2;
+    }
+
+    size_t len = pack(&f, out);
+    if (bin) {
+        FILE *file = fopen(bin, "wb");
+        if (file == NULL || fwrite(out, 1, len, file) != len) {
+            perror(bin);
+            return 2;
+        }
+        fclose(file);
+        fprintf(stderr, "%s: %d frames, %zu bytes\n", bin, f.frames, len);
+    } else {
+        emit(name, &f, out, len);
+    }
+    return 0;
+}
+
+/**************************************** Demo *********************************************/
+
+static void frame_pixel(uint8_t *pages, int width, int x, int y)
+{
+    pages[y / 8 * width + x] |= 1 << (y % 8);
+}
+
+/**
+ * @brief Sun of 32x32 with eight rays turning by a few degrees per frame
+ */
+static void demo_sun(frames_t *f)
+{
+    f->width = 32;
+    f->height = 32;
+    f->frames = 12;
+    for (int i = 0; i < f->frames; i++) {
+        uint8_t *pages = calloc(4, 32);
+        for (int y = 0; y < 32; y++) {
+            for (int x = 0; x < 32; x++) {
+                int dx = x - 16, dy = y - 16;
+                if (dx * dx + dy * dy <= 36) {
+                    frame_pixel(pages, 32, x, y);
+                }
+            }
+        }
+        for (int ray = 0; ray < 8; ray++) {
+            double a = ray * M_PI / 4 + i * M_PI / 48;
+            for (double r = 9; r <= 14; r += 0.5) {
+                frame_pixel(pages, 32, 16 + (int)lround(r * cos(a)), 16 + (int)lround(r * sin(a)));
+            }
+        }
+        f->pages[i] = pages;
+        f->delay_ms[i] = 80;
+    }
+}
+
+/**
+ * @brief Boot splash of 128x64: a frame, a title and a progress bar that fills up
+ */
+static void demo_splash(frames_t *f)
+{
+    static const char title[] = "ALL SENSORS";
+    f->width = 128;
+    f->height = 64;
+    f->frames = 16;
+    for (int i = 0; i < f->frames; i++) {
+        uint8_t *pages = calloc(8, 128);
+        for (int x = 0; x < 128; x++) {
+            frame_pixel(pages, 128, x, 0);
+            frame_pixel(pages, 128, x, 63);
+        }
+        for (int y = 0; y < 64; y++) {
+            frame_pixel(pages, 128, 0, y);
+            frame_pixel(pages, 128, 127, y);
+        }
+        for (size_t c = 0; c < sizeof(title) - 1; c++) {
+            memcpy(&pages[2 * 128 + 20 + c * 8], ssd1306_glyph(title[c]), 8);
+        }
+        for (int x = 16; x < 16 + (i + 1) * 6; x++) {
+            for (int y = 44; y < 52; y++) {
+                frame_pixel(pages, 128, x, y);
+            }
+        }
+        f->pages[i] = pages;
+        f->delay_ms[i] = 50;
+    }
+}
+
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+
+/**
+ * @brief Frame at (page, seg) in display RAM, the part of it on the panel
+ */
+static bool ram_matches_frame(const frames_t *f, int frame, int page, int seg)
+{
+    for (int p = 0; p < (f->height + 7) / 8; p++) {
+        for (int x = 0; x < f->width; x++) {
+            if (page + p >= s_dev._pages || seg + x >= s_dev._width) {
+                continue;
+            }
+            uint8_t want = f->pages[frame][p * f->width + x];
+            if (s_dev._flip) {
+                want = ssd1306_rotate_byte(want);
+            }
+            int hw = s_dev._flip ? s_dev._pages - 1 - (page + p) : page + p;
+            if (s_oled.ram[hw][seg + x] != want) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void demo_play(const char *name, const frames_t *f, int page, int seg, bool flip, double max_ratio)
+{
+    static uint8_t data[PACK_MAX_LEN];
+    size_t len = pack(f, data);
+    int raw = f->frames * ((f->height + 7) / 8) * f->width;
+
+    i2c_mock_reset();
+    i2c_mock_oled_init(&s_oled, I2C_ADDRESS, false);
+    i2c_mock_attach(I2C_NUM_0, &s_oled.base);
+    memset(&s_dev, 0, sizeof(s_dev));
+    i2c_master_init(&s_dev, DEMO_SDA_IO, DEMO_SCL_IO, -1);
+    s_dev._flip = flip;
+    ssd1306_init(&s_dev, 128, 64);
+    ssd1306_clear_screen(&s_dev, false);
+
+    ssd1306_asset_t asset;
+    check(ssd1306_asset_open(&asset, data, len, page, seg) == ESP_OK, "asset opened");
+    uint32_t data0 = s_oled.data_bytes;
+    bool ok = true;
+    for (int loop = 0; loop < 2; loop++) {
+        for (int i = 0; i < f->frames; i++) {
+            ok = ok && ssd1306_asset_next(&s_dev, &asset, true) == f->delay_ms[i];
+            ok = ok && ram_matches_frame(f, i, page, seg);
+        }
+    }
+    uint32_t sent = s_oled.data_bytes - data0;
+    printf("  %-7s %3dx%-2d at page %d seg %3d%s  %2d frames  raw %5d B  packed %5zu B (%4.1f%%)  "
+           "sent %5.1f B/frame against %4d\n", name, f->width, f->height, page, seg, flip ? " flipped" : "        ",
+           f->frames, raw, len, 100.0 * len / raw, (double)sent / (2 * f->frames), raw / f->frames);
+    check(ok, "display RAM matches every frame, twice round");
+    check(len < raw * max_ratio, "packed at least as well as expected");
+
+    /* A truncated asset plays up to the cut and then reports it */
+    ssd1306_asset_open(&asset, data, len / 2, page, seg);
+    int delay = 0;
+    for (int i = 0; i < f->frames && delay >= 0; i++) {
+        delay = ssd1306_asset_next(&s_dev, &asset, true);
+    }
+    check(delay < 0, "truncated asset reported");
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+static int cmd_demo(void)
+{
+    static frames_t sun, splash;
+    demo_sun(&sun);
+    demo_splash(&splash);
+
+    printf("Packed assets on an SSD1306 128x64 over I2C\n");
+    demo_play("sun", &sun, 2, 48, false, 0.6);
+    demo_play("sun", &sun, 4, 112, false, 0.6);
+    demo_play("sun", &sun, 1, 8, true, 0.6);
+    demo_play("splash", &splash, 0, 0, false, 0.05);
+
+    /* Corrupt op counts are refused before anything is drawn */
+    static uint8_t data[PACK_MAX_LEN];
+    size_t len = pack(&sun, data);
+    data[SSD1306_ASSET_HEADER_LEN + SSD1306_ASSET_FRAME_HEADER_LEN] = SSD1306_ASSET_OP_SKIP_LONG | 0x3F;
+    i2c_mock_reset();
+    i2c_mock_oled_init(&s_oled, I2C_ADDRESS, false);
+    i2c_mock_attach(I2C_NUM_0, &s_oled.base);
+    memset(&s_dev, 0, sizeof(s_dev));
+    i2c_master_init(&s_dev, DEMO_SDA_IO, DEMO_SCL_IO, -1);
+    ssd1306_init(&s_dev, 128, 64);
+    ssd1306_clear_screen(&s_dev, false);
+    uint32_t data0 = s_oled.data_bytes;
+    check(ssd1306_asset_image(&s_dev, data, len, 0, 0) != ESP_OK && s_oled.data_bytes == data0,
+          "frame running past its image refused, nothing drawn");
+    check(ssd1306_asset_image(&s_dev, (const uint8_t *)"GIF89a", 6, 0, 0) == ESP_ERR_INVALID_ARG, "not an asset refused");
+    i2c_driver_delete(I2C_NUM_0);
+
+    for (int i = 0; i < sun.frames; i++) {
+        free(sun.pages[i]);
+    }
+    for (int i = 0; i < splash.frames; i++) {
+        free(splash.pages[i]);
+    }
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "demo") == 0) {
+        return cmd_demo();
+    }
+    if (argc >= 3 && strcmp(argv[1], "pack") == 0) {
+        return cmd_pack(argc - 2, &argv[2]);
+    }
+    usage();
+    return 2;
+}
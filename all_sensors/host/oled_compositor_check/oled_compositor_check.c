@@ -0,0 +1,179 @@
+/*
+ * One canvas over four SSD1306 panels (components/ssd1306/ssd1306_compositor.c) on the mock buses: a 2x2 wall of
+ * 128x64 panels, 256x128 pixels, with
+ *   - top left:     I2C port 0, 0x3C, legacy driver installed by i2c_master_init
+ *   - top right:    I2C port 0, 0x3D, second device on the same bus (i2c_device_add)
+ *   - bottom left:  I2C port 1, 0x3C, driver installed by the application (i2c_device_add)
+ *   - bottom right: SPI, queued transport
+ * Text and lines are drawn across the panel edges; after each flush the display RAM of every panel is compared
+ * with its region of the canvas. A flush without changes must send nothing and a single pixel one page.
+ *
+ * The host build has no tasks (CONFIG_SSD1306_COMPOSITOR_TASKS is off), so the synchronous panels are sent one
+ * after the other and the flush time printed is their sum; on the board the two I2C ports run in parallel.
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "spi_bus_mock.h"
+#include "ssd1306.h"
+#include "ssd1306_compositor.h"
+
+#define CHECK_SDA_IO    21
+#define CHECK_SCL_IO    22
+#define CHECK_SDA1_IO   25
+#define CHECK_SCL1_IO   26
+#define CHECK_MOSI_IO   23
+#define CHECK_SCLK_IO   18
+#define CHECK_CS_IO     5
+#define CHECK_DC_IO     4
+
+#define PANELS          4
+
+static int s_failures;
+static i2c_mock_oled_t s_oled[PANELS];
+static SSD1306_t s_dev[PANELS];
+static ssd1306_compositor_t s_comp;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void panels_up(void)
+{
+    i2c_mock_reset();
+    spi_mock_reset();
+    host_clock_reset();
+
+    i2c_mock_oled_init(&s_oled[0], 0x3C, false);
+    i2c_mock_oled_init(&s_oled[1], 0x3D, false);
+    i2c_mock_oled_init(&s_oled[2], 0x3C, false);
+    i2c_mock_oled_init(&s_oled[3], 0, false);
+    i2c_mock_attach(I2C_NUM_0, &s_oled[0].base);
+    i2c_mock_attach(I2C_NUM_0, &s_oled[1].base);
+    i2c_mock_attach(I2C_NUM_1, &s_oled[2].base);
+    spi_mock_attach(CHECK_CS_IO, CHECK_DC_IO, i2c_mock_oled_spi_rx, &s_oled[3]);
+
+    memset(s_dev, 0, sizeof(s_dev));
+    i2c_master_init(&s_dev[0], CHECK_SDA_IO, CHECK_SCL_IO, -1);
+    i2c_device_add(&s_dev[1], I2C_NUM_0, -1, 0x3D);
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CHECK_SDA1_IO,
+        .scl_io_num = CHECK_SCL1_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = 400000,
+    };
+    i2c_param_config(I2C_NUM_1, &conf);
+    i2c_driver_install(I2C_NUM_1, I2C_MODE_MASTER, 0, 0, 0);
+    i2c_device_add(&s_dev[2], I2C_NUM_1, -1, 0x3C);
+
+    spi_master_init(&s_dev[3], CHECK_MOSI_IO, CHECK_SCLK_IO, CHECK_CS_IO, CHECK_DC_IO, -1);
+
+    for (int i = 0; i < PANELS; i++) {
+        ssd1306_init(&s_dev[i], 128, 64);
+        ssd1306_flush(&s_dev[i]);
+        check(s_oled[i].display_on && s_oled[i].unknown_commands == 0, "init sequence accepted by the controller");
+    }
+
+    check(ssd1306_compositor_init(&s_comp, 256, 128) == ESP_OK, "canvas set up");
+    check(ssd1306_compositor_add_panel(&s_comp, &s_dev[0], 0, 0) == ESP_OK, "panel 0 added");
+    check(ssd1306_compositor_add_panel(&s_comp, &s_dev[1], 128, 0) == ESP_OK, "panel 1 added");
+    check(ssd1306_compositor_add_panel(&s_comp, &s_dev[2], 0, 64) == ESP_OK, "panel 2 added");
+    check(ssd1306_compositor_add_panel(&s_comp, &s_dev[3], 128, 64) == ESP_OK, "panel 3 added");
+    check(ssd1306_compositor_add_panel(&s_comp, &s_dev[0], 0, 4) != ESP_OK, "panel off the page grid refused");
+}
+
+static void panels_down(void)
+{
+    ssd1306_compositor_deinit(&s_comp);
+    i2c_driver_delete(I2C_NUM_0);
+    i2c_driver_delete(I2C_NUM_1);
+    spi_flush(&s_dev[3]);
+    spi_bus_remove_device(s_dev[3]._spi_device_handle);
+    heap_caps_free(s_dev[3]._spi_queue);
+}
+
+static bool ram_matches_canvas(void)
+{
+    for (int i = 0; i < PANELS; i++) {
+        ssd1306_panel_t *p = &s_comp.panels[i];
+        for (int page = 0; page < 8; page++) {
+            if (memcmp(s_oled[i].ram[page], &s_comp.fb[(p->page + page) * s_comp.width + p->x], 128) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint32_t pages_sent(void)
+{
+    uint32_t n = 0;
+    for (int i = 0; i < s_comp.panel_num; i++) {
+        n += s_comp.panels[i].pages_sent;
+    }
+    return n;
+}
+
+static int64_t timed_flush(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    ssd1306_compositor_flush(&s_comp);
+    return esp_timer_get_time() - t0;
+}
+
+int main(void)
+{
+    printf("SSD1306 compositor, 256x128 canvas on 2x2 panels (2 on I2C port 0, 1 on port 1, 1 on SPI)\n");
+    panels_up();
+
+    /* Across the vertical seam at x = 128 and the horizontal one at y = 64 */
+    ssd1306_compositor_clear(&s_comp, false);
+    ssd1306_compositor_text(&s_comp, 3, 88, "Smart mirror", false);
+    ssd1306_compositor_text(&s_comp, 8, 100, "21.5 C", true);
+    for (int x = 0; x < s_comp.width; x++) {
+        ssd1306_compositor_pixel(&s_comp, x, x / 2, false);
+    }
+    uint32_t sent0 = pages_sent();
+    int64_t full_us = timed_flush();
+    check(pages_sent() - sent0 == 32, "first flush sends every page of every panel");
+    check(ram_matches_canvas(), "display RAM matches the canvas after the first flush");
+
+    sent0 = pages_sent();
+    int64_t idle_us = timed_flush();
+    check(pages_sent() == sent0, "flush without changes sends nothing");
+
+    sent0 = pages_sent();
+    ssd1306_compositor_pixel(&s_comp, 200, 90, false);
+    int64_t pixel_us = timed_flush();
+    check(pages_sent() - sent0 == 1, "one pixel sends one page");
+    check(i2c_mock_oled_pixel(&s_oled[3], 72, 26), "pixel shown on the bottom right panel");
+    check(ram_matches_canvas(), "display RAM matches the canvas after a pixel");
+
+    sent0 = pages_sent();
+    ssd1306_compositor_text(&s_comp, 7, 120, "seam", false);
+    timed_flush();
+    check(pages_sent() - sent0 == 2, "text over the vertical seam sends one page on each side");
+    check(ram_matches_canvas(), "display RAM matches the canvas after text on a seam");
+
+    printf("  full canvas %6" PRId64 " us, no change %4" PRId64 " us, one pixel %5" PRId64 " us\n",
+           full_us, idle_us, pixel_us);
+    panels_down();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
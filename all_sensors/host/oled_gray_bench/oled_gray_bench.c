@@ -0,0 +1,256 @@
+/*
+ * Gray levels by temporal PWM (components/ssd1306/ssd1306_gray.c) on the mock buses, which bus and panel sustain
+ * which depth.
+ *
+ * Every subframe is a whole frame on the bus, and it is held for at least one scan of the panel (the oscillator is
+ * at its fastest in gray mode, see ssd1306_gray.h), so a subframe takes the longer of the two. A cycle is 3 subframes
+ * for 4 levels and 7 for 8 levels; below FLICKER_FREE_HZ cycles a second a lit area visibly flickers. For each link
+ * (legacy I2C driver at 100 kHz to 1 MHz, SPI at 1 to 10 MHz) and for a 64 and a 32 row panel the table shows the
+ * frame time on the bus, the scan time and the cycle rate of both depths.
+ *
+ * Then, over SPI and I2C, upright and flipped, the pixels of a gradient and of a 2-bit image must be lit for exactly
+ * their level in subframes out of a cycle, the oscillator must be set and restored, and a gray fadeout must end with
+ * the panel dark.
+ *
+ * Figures are host clock time with the cost constants of the mocks and the typical oscillator of the datasheet, not
+ * measurements. On the board, call ssd1306_gray_cycle_hz. Exit status is non-zero if a check fails.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "spi_bus_mock.h"
+#include "ssd1306.h"
+#include "ssd1306_gray.h"
+
+#define BENCH_PORT      I2C_NUM_0
+#define BENCH_SDA_IO    21
+#define BENCH_SCL_IO    22
+#define BENCH_MOSI_IO   23
+#define BENCH_SCLK_IO   18
+#define BENCH_CS_IO     5
+#define BENCH_DC_IO     4
+#define BENCH_CYCLES    20
+#define FLICKER_FREE_HZ 50                                                          /*!< Cycle rate from which a lit area looks steady */
+
+typedef struct {
+    const char *name;
+    bool spi;
+    int hz;
+} bench_link_t;
+
+static int s_failures;
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void panel_up(const bench_link_t *link, int height, bool flip)
+{
+    host_clock_reset();
+    memset(&s_dev, 0, sizeof(s_dev));
+    if (link->spi) {
+        spi_mock_reset();
+        i2c_mock_oled_init(&s_oled, 0, false);
+        spi_mock_attach(BENCH_CS_IO, BENCH_DC_IO, i2c_mock_oled_spi_rx, &s_oled);
+        spi_clock_speed(link->hz);
+        spi_master_init(&s_dev, BENCH_MOSI_IO, BENCH_SCLK_IO, BENCH_CS_IO, BENCH_DC_IO, -1);
+    } else {
+        i2c_mock_reset();
+        i2c_mock_oled_init(&s_oled, I2C_ADDRESS, false);
+        i2c_mock_attach(BENCH_PORT, &s_oled.base);
+        i2c_config_t conf = {
+            .mode = I2C_MODE_MASTER,
+            .sda_io_num = BENCH_SDA_IO,
+            .scl_io_num = BENCH_SCL_IO,
+            .master.clk_speed = link->hz,
+        };
+        i2c_param_config(BENCH_PORT, &conf);
+        i2c_driver_install(BENCH_PORT, I2C_MODE_MASTER, 0, 0, 0);
+        i2c_device_add(&s_dev, BENCH_PORT, -1, I2C_ADDRESS);
+    }
+    s_dev._flip = flip;
+    ssd1306_init(&s_dev, 128, height);
+    ssd1306_flush(&s_dev);
+}
+
+static void panel_down(const bench_link_t *link)
+{
+    ssd1306_flush(&s_dev);
+    if (link->spi) {
+        spi_bus_remove_device(s_dev._spi_device_handle);
+        heap_caps_free(s_dev._spi_queue);
+    } else {
+        i2c_driver_delete(BENCH_PORT);
+    }
+}
+
+/**
+ * @brief Pixel (x, y) of the picture as lit on the glass: a flipped panel has it at the other end of the RAM
+ */
+static bool lit(int x, int y)
+{
+    return i2c_mock_oled_pixel(&s_oled, x, s_dev._flip ? s_dev._height - 1 - y : y);
+}
+
+/**
+ * @brief Run one cycle and compare, for every pixel, the subframes it was lit in with want(x, y)
+ */
+static bool cycle_matches(ssd1306_gray_t *gray, int (*want)(int x, int y))
+{
+    static uint8_t on[64][128];
+    memset(on, 0, sizeof(on));
+    for (int i = 0; i < gray->cycle; i++) {
+        ssd1306_gray_step(gray);
+        ssd1306_flush(&s_dev);
+        for (int y = 0; y < s_dev._height; y++) {
+            for (int x = 0; x < s_dev._width; x++) {
+                on[y][x] += lit(x, y);
+            }
+        }
+    }
+    for (int y = 0; y < s_dev._height; y++) {
+        for (int x = 0; x < s_dev._width; x++) {
+            if (on[y][x] != want(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int gradient_level(int x, int y)
+{
+    return (x / 16 + y / 8) % 8;
+}
+
+/* 2-bit image of 16x8: four bands of 4 columns at levels 0 to 3, scaled to 3 bits as 0, 2, 5, 7 */
+static const uint8_t s_bands_planes[] = {
+    0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+static const ssd1306_gray_image_t s_bands = { .width = 16, .height = 8, .bits = 2, .planes = s_bands_planes };
+
+static int bands_level(int x, int y)
+{
+    static const int scaled[4] = { 0, 2, 5, 7 };
+    if (y >= 16 && y < 24 && x >= 40 && x < 56) {
+        return scaled[(x - 40) / 4];
+    }
+    return gradient_level(x, y);
+}
+
+static void check_levels(const bench_link_t *link, bool flip)
+{
+    printf("  %-10s %s\n", link->name, flip ? "flipped" : "upright");
+    panel_up(link, 64, flip);
+
+    ssd1306_gray_t gray;
+    check(ssd1306_gray_init(&gray, &s_dev, 3) == ESP_OK, "gray mode set up");
+    ssd1306_flush(&s_dev);
+    check(s_oled.clock_div == 0xF0, "oscillator at its fastest in gray mode");
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            ssd1306_gray_pixel(&gray, x, y, gradient_level(x, y));
+        }
+    }
+    check(cycle_matches(&gray, gradient_level), "every pixel lit for its level in subframes of a cycle");
+
+    ssd1306_gray_image(&gray, 2, 40, &s_bands);
+    check(cycle_matches(&gray, bands_level), "2-bit image scaled to 8 levels");
+
+    /* Subframes are held for a scan at least, whatever the bus */
+    int64_t t0 = esp_timer_get_time();
+    uint32_t subframes0 = gray.subframes;
+    ssd1306_gray_show(&gray, 200);
+    int64_t per_subframe = (esp_timer_get_time() - t0) / (int64_t)(gray.subframes - subframes0);
+    check(per_subframe >= ssd1306_gray_scan_us(&s_dev), "no subframe shorter than a scan");
+
+    ssd1306_gray_deinit(&gray);
+    check(s_oled.clock_div == 0x80, "oscillator restored");
+    check(lit(0, 32) && !lit(0, 0) && lit(127, 0), "back to 1 bit: upper half of the levels lit");
+
+    ssd1306_gray_fadeout(&s_dev, 2, 300);
+    bool dark = true;
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            dark = dark && !lit(x, y);
+        }
+    }
+    check(dark && s_dev._page[3]._segs[64] == 0, "gray fadeout ends dark with the buffer cleared");
+    panel_down(link);
+}
+
+/**
+ * @brief Cycles per second of a depth, and the bus time of a frame when not held for the scan
+ */
+static float cycle_hz(const bench_link_t *link, int height, int bits, int64_t *frame_us)
+{
+    ssd1306_gray_t gray;
+    panel_up(link, height, false);
+    ssd1306_gray_init(&gray, &s_dev, bits);
+    ssd1306_gray_clear(&gray, gray.levels / 2);
+    if (frame_us) {
+        gray.subframe_us = 0;
+        int64_t t0 = esp_timer_get_time();
+        for (int i = 0; i < BENCH_CYCLES; i++) {
+            ssd1306_gray_step(&gray);
+        }
+        ssd1306_flush(&s_dev);
+        *frame_us = (esp_timer_get_time() - t0) / BENCH_CYCLES;
+        gray.subframe_us = ssd1306_gray_scan_us(&s_dev);
+    }
+    float hz = ssd1306_gray_cycle_hz(&gray, BENCH_CYCLES);
+    ssd1306_gray_deinit(&gray);
+    panel_down(link);
+    return hz;
+}
+
+static void bench(const bench_link_t *link, int height)
+{
+    int64_t frame_us;
+    float hz4 = cycle_hz(link, height, 2, &frame_us);
+    float hz8 = cycle_hz(link, height, 3, NULL);
+    printf("  %-10s 128x%-3d frame %6d us  scan %5d us   4 levels %5.1f Hz %-8s  8 levels %5.1f Hz %s\n",
+           link->name, height, (int)frame_us, ssd1306_gray_scan_us(&s_dev),
+           hz4, hz4 >= FLICKER_FREE_HZ ? "steady" : "flickers", hz8, hz8 >= FLICKER_FREE_HZ ? "steady" : "flickers");
+}
+
+int main(void)
+{
+    static const bench_link_t links[] = {
+        { "I2C 100k", false, 100000 },
+        { "I2C 400k", false, 400000 },
+        { "I2C 1M", false, 1000000 },
+        { "SPI 1M", true, 1000000 },
+        { "SPI 4M", true, 4000000 },
+        { "SPI 8M", true, 8000000 },
+        { "SPI 10M", true, 10000000 },
+    };
+
+    printf("Gray levels by temporal PWM, oscillator %d kHz, steady from %d cycles/s\n", SSD1306_GRAY_FOSC_HZ / 1000, FLICKER_FREE_HZ);
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        bench(&links[i], 64);
+        bench(&links[i], 32);
+    }
+
+    printf("Levels on the glass\n");
+    check_levels(&links[5], false);
+    check_levels(&links[5], true);
+    check_levels(&links[1], false);
+    check_levels(&links[1], true);
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * Converter of gray images for the temporal PWM mode of the SSD1306 driver (components/ssd1306/ssd1306_gray.h).
+ *
+ *   oled_gray_convert [-b BITS] [-d none|bayer|blue] [-g GAMMA] [-n NAME] [-p PREVIEW.pgm] IMAGE.pgm > image.h
+ *
+ * Reads a binary PGM (P5, export from any image editor), at most 128x64, and writes a C header with the bitplanes
+ * and an ssd1306_gray_image_t NAME for ssd1306_gray_image. The panel only has 1 << BITS levels (BITS 1 to 3, default
+ * 2), the rest of the range is dithered with a threshold matrix so that no work is left for the chip:
+ *   none    plain rounding, bands on gradients
+ *   bayer   8x8 ordered dither, regular cross-hatch
+ *   blue    32x32 blue noise made by void-and-cluster at start-up, no visible pattern (default)
+ * The PWM mixes light linearly, so the image is taken out of its gamma first (-g, default 2.2, 1 for linear input).
+ * -p writes the result as a PGM at the panel's levels, to look at before flashing.
+ * Exit status is 2 on bad arguments or input.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONVERT_MAX_WIDTH   128
+#define CONVERT_MAX_HEIGHT  64
+#define CONVERT_MAX_BITS    3                                                       /*!< SSD1306_GRAY_MAX_BITS */
+#define BLUE_SIZE           32
+#define BLUE_SIGMA          1.5
+
+typedef enum {
+    DITHER_NONE,
+    DITHER_BAYER,
+    DITHER_BLUE,
+} dither_t;
+
+typedef struct {
+    int width;
+    int height;
+    uint8_t px[CONVERT_MAX_HEIGHT][CONVERT_MAX_WIDTH];
+} image_t;
+
+static float s_threshold[BLUE_SIZE][BLUE_SIZE];                                     /*!< In [0, 1), tiled over the image */
+static int s_threshold_size = 1;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: oled_gray_convert [-b BITS] [-d none|bayer|blue] [-g GAMMA] [-n NAME] [-p PREVIEW.pgm] IMAGE.pgm\n");
+}
+
+/**
+ * @brief Next token of a PGM header, skipping white space and comments
+ */
+static bool pgm_token(FILE *f, char *tok, size_t len)
+{
+    int c = fgetc(f);
+    while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = fgetc(f);
+            }
+        }
+        c = fgetc(f);
+    }
+    size_t n = 0;
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' && n + 1 < len) {
+        tok[n++] = (char)c;
+        c = fgetc(f);
+    }
+    tok[n] = '\0';
+    return n > 0;
+}
+
+static bool pgm_load(const char *path, image_t *img)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    char tok[16];
+    int maxval = 0;
+    bool ok = pgm_token(f, tok, sizeof(tok)) && strcmp(tok, "P5") == 0;
+    ok = ok && pgm_token(f, tok, sizeof(tok)) && (img->width = atoi(tok)) > 0;
+    ok = ok && pgm_token(f, tok, sizeof(tok)) && (img->height = atoi(tok)) > 0;
+    ok = ok && pgm_token(f, tok, sizeof(tok)) && (maxval = atoi(tok)) > 0 && maxval < 256;
+    if (!ok) {
+        fprintf(stderr, "%s: not a binary 8-bit PGM (P5)\n", path);
+        fclose(f);
+        return false;
+    }
+    if (img->width > CONVERT_MAX_WIDTH || img->height > CONVERT_MAX_HEIGHT) {
+        fprintf(stderr, "%s: %dx%d, the panel has %dx%d\n", path, img->width, img->height, CONVERT_MAX_WIDTH, CONVERT_MAX_HEIGHT);
+        fclose(f);
+        return false;
+    }
+    for (int y = 0; y < img->height && ok; y++) {
+        ok = fread(img->px[y], 1, img->width, f) == (size_t)img->width;
+        for (int x = 0; x < img->width; x++) {
+            img->px[y][x] = (uint8_t)(img->px[y][x] * 255 / maxval);
+        }
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "%s: truncated\n", path);
+    }
+    return ok;
+}
+
+static void bayer_make(void)
+{
+    s_threshold_size = 8;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            /* Bit interleave of x ^ y and y, reversed */
+            int v = 0;
+            for (int bit = 2; bit >= 0; bit--) {
+                v = (v << 2) | ((((x ^ y) >> (2 - bit)) & 1) << 1) | ((y >> (2 - bit)) & 1);
+            }
+            s_threshold[y][x] = (v + 0.5f) / 64;
+        }
+    }
+}
+
+/**
+ * @brief Void-and-cluster (Ulichney): rank every cell of a toroidal grid so that each prefix of the ranking is as
+ *        evenly spread as possible. Energy is a Gaussian of the wrapped distance to the set cells.
+ */
+static void blue_make(void)
+{
+    enum { N = BLUE_SIZE, CELLS = N * N };
+    static double kernel[N][N], energy[CELLS];
+    static bool set[CELLS], initial[CELLS];
+    static int rank[CELLS];
+
+    for (int dy = 0; dy < N; dy++) {
+        for (int dx = 0; dx < N; dx++) {
+            int wx = dx < N / 2 ? dx : N - dx;
+            int wy = dy < N / 2 ? dy : N - dy;
+            kernel[dy][dx] = exp(-(wx * wx + wy * wy) / (2 * BLUE_SIGMA * BLUE_SIGMA));
+        }
+    }
+
+    /* Energy kept up to date as cells are set and cleared */
+    #define TOGGLE(i, on) do {                                                              \
+        set[i] = (on);                                                                      \
+        for (int _j = 0; _j < CELLS; _j++) {                                                \
+            double _k = kernel[(_j / N - (i) / N + N) % N][(_j % N - (i) % N + N) % N];     \
+            energy[_j] += (on) ? _k : -_k;                                                  \
+        }                                                                                   \
+    } while (0)
+
+    /* Cell with the highest energy among the set ones (tightest cluster) or the lowest among the clear ones */
+    #define EXTREME(out, want_set) do {                                                     \
+        out = -1;                                                                           \
+        for (int _j = 0; _j < CELLS; _j++) {                                                \
+            if (set[_j] != (want_set)) continue;                                            \
+            if (out < 0 || ((want_set) ? energy[_j] > energy[out] : energy[_j] < energy[out])) out = _j; \
+        }                                                                                   \
+    } while (0)
+
+    /* Initial pattern: a tenth of the cells, then swap the tightest cluster into the largest void until stable */
+    memset(energy, 0, sizeof(energy));
+    memset(set, 0, sizeof(set));
+    uint32_t seed = 1;
+    int ones = 0;
+    while (ones < CELLS / 10) {
+        seed = seed * 1103515245 + 12345;
+        int i = (seed >> 8) % CELLS;
+        if (!set[i]) {
+            TOGGLE(i, true);
+            ones++;
+        }
+    }
+    for (int iter = 0; iter < CELLS; iter++) {
+        int cluster, cell;
+        EXTREME(cluster, true);
+        TOGGLE(cluster, false);
+        EXTREME(cell, false);
+        if (cell == cluster) {
+            TOGGLE(cluster, true);
+            break;
+        }
+        TOGGLE(cell, true);
+    }
+    memcpy(initial, set, sizeof(set));
+
+    /* Ranks below the initial pattern: take clusters away */
+    for (int r = ones - 1; r >= 0; r--) {
+        int cluster;
+        EXTREME(cluster, true);
+        TOGGLE(cluster, false);
+        rank[cluster] = r;
+    }
+    /* Ranks above it: fill voids, from the initial pattern again */
+    for (int i = 0; i < CELLS; i++) {
+        if (initial[i] != set[i]) {
+            TOGGLE(i, initial[i]);
+        }
+    }
+    for (int r = ones; r < CELLS; r++) {
+        int cell;
+        EXTREME(cell, false);
+        TOGGLE(cell, true);
+        rank[cell] = r;
+    }
+    #undef TOGGLE
+    #undef EXTREME
+
+    s_threshold_size = N;
+    for (int i = 0; i < CELLS; i++) {
+        s_threshold[i / N][i % N] = (rank[i] + 0.5f) / CELLS;
+    }
+}
+
+static void convert(const image_t *img, int bits, dither_t dither, double gamma, image_t *levels)
+{
+    int top = (1 << bits) - 1;
+    if (dither == DITHER_BAYER) {
+        bayer_make();
+    } else if (dither == DITHER_BLUE) {
+        blue_make();
+    } else {
+        s_threshold_size = 1;
+        s_threshold[0][0] = 0.5f;
+    }
+    levels->width = img->width;
+    levels->height = img->height;
+    for (int y = 0; y < img->height; y++) {
+        for (int x = 0; x < img->width; x++) {
+            double s = pow(img->px[y][x] / 255.0, gamma) * top;
+            int level = (int)s;
+            if (s - level > s_threshold[y % s_threshold_size][x % s_threshold_size]) {
+                level++;
+            }
+            levels->px[y][x] = (uint8_t)(level > top ? top : level);
+        }
+    }
+}
+
+static void emit(const image_t *levels, int bits, const char *name, const char *source, const char *dither)
+{
+    int pages = (levels->height + 7) / 8;
+    printf("// Generated by oled_gray_convert from %s: %dx%d, %d levels, %s dither\n", source, levels->width,
+           levels->height, 1 << bits, dither);
+    printf("#include \"ssd1306_gray.h\"\n\n");
+    printf("static const uint8_t %s_planes[] = {", name);
+    int n = 0;
+    for (int plane = 0; plane < bits; plane++) {
+        for (int page = 0; page < pages; page++) {
+            for (int x = 0; x < levels->width; x++) {
+                uint8_t b = 0;
+                for (int bit = 0; bit < 8 && page * 8 + bit < levels->height; bit++) {
+                    b |= ((levels->px[page * 8 + bit][x] >> plane) & 1) << bit;
+                }
+                printf("%s0x%02X,", n++ % 16 ? " " : "\n\t", b);
+            }
+        }
+    }
+    printf("\n};\n\n");
+    printf("static const ssd1306_gray_image_t %s = {\n", name);
+    printf("\t.width = %d,\n\t.height = %d,\n\t.bits = %d,\n\t.planes = %s_planes,\n};\n", levels->width,
+           levels->height, bits, name);
+}
+
+static bool preview(const char *path, const image_t *levels, int bits, double gamma)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    fprintf(f, "P5\n%d %d\n255\n", levels->width, levels->height);
+    for (int y = 0; y < levels->height; y++) {
+        for (int x = 0; x < levels->width; x++) {
+            fputc((int)lround(255 * pow((double)levels->px[y][x] / ((1 << bits) - 1), 1 / gamma)), f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int bits = 2;
+    dither_t dither = DITHER_BLUE;
+    const char *dither_name = "blue";
+    double gamma = 2.2;
+    const char *name = "gray_image";
+    const char *preview_path = NULL;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_arg = i + 1 < argc;
+        if (strcmp(argv[i], "-b") == 0 && has_arg) {
+            bits = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && has_arg) {
+            dither_name = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0 && has_arg) {
+            gamma = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && has_arg) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && has_arg) {
+            preview_path = argv[++i];
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (strcmp(dither_name, "none") == 0) {
+        dither = DITHER_NONE;
+    } else if (strcmp(dither_name, "bayer") == 0) {
+        dither = DITHER_BAYER;
+    } else if (strcmp(dither_name, "blue") != 0) {
+        usage();
+        return 2;
+    }
+    if (path == NULL || bits < 1 || bits > CONVERT_MAX_BITS || gamma <= 0) {
+        usage();
+        return 2;
+    }
+
+    static image_t img, levels;
+    if (!pgm_load(path, &img)) {
+        return 2;
+    }
+    convert(&img, bits, dither, gamma, &levels);
+    emit(&levels, bits, name, path, dither_name);
+    if (preview_path && !preview(preview_path, &levels, bits, gamma)) {
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Frame rate of the SSD1306 I2C backends on the mock bus (host/i2c_bus_mock): the legacy driver
+ * (components/ssd1306/ssd1306_i2c_legacy.c) against the new i2c_master driver (ssd1306_i2c_new.c), synchronous and
+ * with a transaction queue.
+ *
+ * Both backends are linked here; the new one is built with its i2c_master_init / i2c_device_add renamed to
+ * i2c_ng_master_init / i2c_ng_device_add (see host/CMakeLists.txt), on the chip only one of them is compiled.
+ * For each backend the display RAM is compared with the frame buffer after a frame and after text, which is drawn
+ * from buffers on the stack and so goes through the copy slots of the queued backend. The frame rate is
+ * bound by the 400 kHz bus either way: what the queue buys is the CPU, a frame call returns as soon as its
+ * transactions are queued, and the pages go out of the frame buffer without a copy.
+ *
+ * Figures are host clock time with the cost constants of i2c_bus_mock.h, not measurements. On the board, call
+ * ssd1306_fps_benchmark with LEGACY_DRIVER on and off. Exit status is non-zero if the display RAM does not match,
+ * the new backend loses more than 2% of the legacy frame rate or a queued frame call does not return early.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "driver/i2c_master.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "ssd1306.h"
+
+#define BENCH_PORT      I2C_NUM_0
+#define BENCH_SDA_IO    21
+#define BENCH_SCL_IO    22
+#define BENCH_FRAMES    50
+
+void i2c_ng_master_init(SSD1306_t *dev, int16_t sda, int16_t scl, int16_t reset);
+
+typedef enum {
+    BENCH_LEGACY,
+    BENCH_NEW,
+} bench_driver_t;
+
+typedef struct {
+    double fps;
+    double busy;                    /* bus utilisation */
+    int64_t call_us;                /* one frame on an idle bus: time until the call returns */
+    int64_t frame_us;               /* the same frame until it is on the display */
+} bench_result_t;
+
+static int s_failures;
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void bench_up(bench_driver_t driver, int depth)
+{
+    i2c_mock_reset();
+    i2c_mock_oled_init(&s_oled, I2C_ADDRESS, false);
+    i2c_mock_attach(BENCH_PORT, &s_oled.base);
+
+    memset(&s_dev, 0, sizeof(s_dev));
+    if (driver == BENCH_LEGACY) {
+        i2c_master_init(&s_dev, BENCH_SDA_IO, BENCH_SCL_IO, -1);
+    } else {
+        i2c_queue_depth(depth);
+        i2c_ng_master_init(&s_dev, BENCH_SDA_IO, BENCH_SCL_IO, -1);
+    }
+    ssd1306_init(&s_dev, 128, 64);
+    ssd1306_flush(&s_dev);
+    check(s_oled.display_on && s_oled.unknown_commands == 0, "init sequence accepted by the controller");
+
+    /* Something that is not symmetric under a column shift */
+    for (int page = 0; page < 8; page++) {
+        for (int seg = 0; seg < 128; seg++) {
+            s_dev._page[page]._segs[seg] = (uint8_t)(seg * 7 + page * 31);
+        }
+    }
+}
+
+static void bench_down(bench_driver_t driver)
+{
+    ssd1306_flush(&s_dev);
+    if (driver == BENCH_LEGACY) {
+        i2c_driver_delete(BENCH_PORT);
+    } else {
+        i2c_master_bus_rm_device(s_dev._i2c_dev_handle);
+        i2c_del_master_bus(s_dev._i2c_bus_handle);
+        free(s_dev._i2c_queue);
+    }
+}
+
+static bool ram_matches_buffer(void)
+{
+    for (int page = 0; page < 8; page++) {
+        if (memcmp(s_oled.ram[page], s_dev._page[page]._segs, 128) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bench_result_t bench(bench_driver_t driver, int depth, const char *name)
+{
+    bench_result_t r;
+
+    bench_up(driver, depth);
+    uint64_t busy0 = i2c_mock_busy_us(BENCH_PORT);
+    int64_t t0 = esp_timer_get_time();
+    r.fps = ssd1306_fps_benchmark(&s_dev, BENCH_FRAMES);
+    r.busy = (double)(i2c_mock_busy_us(BENCH_PORT) - busy0) / (esp_timer_get_time() - t0);
+
+    t0 = esp_timer_get_time();
+    ssd1306_show_buffer(&s_dev);
+    r.call_us = esp_timer_get_time() - t0;
+    ssd1306_flush(&s_dev);
+    r.frame_us = esp_timer_get_time() - t0;
+    check(ram_matches_buffer(), "display RAM matches the buffer after one frame");
+    ssd1306_display_text(&s_dev, 3, "i2c_master", 10, false);
+    ssd1306_display_text_x3(&s_dev, 5, "42", 2, true);
+    ssd1306_flush(&s_dev);
+    check(ram_matches_buffer(), "display RAM matches the buffer after text");
+    bench_down(driver);
+
+    printf("  %-22s %6.1f fps  %6.0f us/frame  bus %5.1f%%  one frame returns after %6" PRId64 " us, on the display after %6" PRId64 " us\n",
+           name, r.fps, 1e6 / r.fps, 100.0 * r.busy, r.call_us, r.frame_us);
+    return r;
+}
+
+int main(void)
+{
+    printf("SSD1306 128x64 over I2C at 400 kHz, %d frames, queued transfer gap %d us\n", BENCH_FRAMES, I2C_MOCK_MASTER_ISR_US);
+    bench_result_t legacy = bench(BENCH_LEGACY, 0, "legacy driver");
+    bench_result_t sync = bench(BENCH_NEW, 0, "i2c_master, no queue");
+    bench_result_t queued = bench(BENCH_NEW, 8, "i2c_master, queue 8");
+    bench_result_t deep = bench(BENCH_NEW, 16, "i2c_master, queue 16");
+
+    check(sync.fps >= legacy.fps * 0.98, "synchronous i2c_master as fast as the legacy driver");
+    check(queued.fps >= legacy.fps * 0.98 && deep.fps >= legacy.fps * 0.98, "queued i2c_master within 2% of the legacy driver");
+    check(queued.call_us < sync.call_us, "queued frame call returns before the frame is sent");
+    check(deep.call_us < 1000, "a queue of 16 takes the whole frame (8 pages, 2 transfers each) without waiting");
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
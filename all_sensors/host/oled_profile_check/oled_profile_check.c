@@ -0,0 +1,201 @@
+/*
+ * Panel profiles of the SSD1306 driver (components/ssd1306/ssd1306_profile.c) against the controller model of the
+ * mock bus, over the legacy I2C backend:
+ *   - ssd1306_128x64, ssd1306_128x32, ssd1306_72x40 on an SSD1306, sh1106_128x64 on an SH1106 (132 column RAM)
+ *   - each upright and flipped
+ * For every one the init sequence must be accepted, the buffer must land in RAM at the profile's column offset with
+ * nothing written outside the visible window, and ssd1306_show_buffer must use the profile's write pattern: one
+ * column and page range plus a data transfer per page with horizontal addressing, a position and a data transfer
+ * per page on the SH1106.
+ *
+ * Then a ticker runs on each of them: every line must cost one start line command and one page, the panel must show
+ * the buffer through the start line, and drawing while the start line is moved must still land where it is shown.
+ * Exit status is non-zero if a check fails.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "ssd1306.h"
+
+#define CHECK_SDA_IO        21
+#define CHECK_SCL_IO        22
+#define POWER_ON_PATTERN    0x5A                                                    /*!< RAM content of the model at power-up */
+
+static int s_failures;
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/**
+ * @brief Display RAM against the buffer: visible window at col_offset, everything else untouched
+ */
+static bool ram_matches_buffer(const ssd1306_profile_t *profile)
+{
+    for (int hw = 0; hw < I2C_MOCK_OLED_PAGES; hw++) {
+        int page = s_dev._flip ? s_dev._pages - hw - 1 : hw;
+        for (int col = 0; col < s_oled.columns; col++) {
+            int x = col - profile->col_offset;
+            bool visible = hw < s_dev._pages && x >= 0 && x < profile->width;
+            uint8_t want = visible ? s_dev._page[page]._segs[x] : POWER_ON_PATTERN;
+            if (s_oled.ram[hw][col] != want) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief RAM page of every buffer page as the driver maps it, compared with the buffer
+ */
+static bool ram_matches_ticker(const ssd1306_profile_t *profile)
+{
+    int offset = s_dev._startLine / 8;
+    for (int page = 0; page < s_dev._pages; page++) {
+        int hw = ((s_dev._flip ? s_dev._pages - page - 1 : page) + offset) % I2C_MOCK_OLED_PAGES;
+        if (memcmp(&s_oled.ram[hw][profile->col_offset], s_dev._page[page]._segs, profile->width) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief What the glass shows: row y is RAM row y + start line. Upright panels only.
+ */
+static bool shown_matches_buffer(const ssd1306_profile_t *profile)
+{
+    for (int y = 0; y < profile->height; y++) {
+        int row = (y + s_oled.start_line) % (I2C_MOCK_OLED_PAGES * 8);
+        for (int x = 0; x < profile->width; x++) {
+            bool want = (s_dev._page[y / 8]._segs[x] >> (y % 8)) & 1;
+            if (i2c_mock_oled_pixel(&s_oled, x + profile->col_offset, row) != want) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void check_ticker(const ssd1306_profile_t *profile)
+{
+    char line[17];
+    bool ok = true, shown = true;
+    uint32_t txns = 0;
+
+    for (int i = 0; i < 11; i++) {
+        int len = snprintf(line, sizeof(line), "news %d", i);
+        uint32_t txn0 = i2c_mock_log_total();
+        ssd1306_ticker_line(&s_dev, line, len, i % 3 == 0, -1);
+        txns += i2c_mock_log_total() - txn0;
+        ok = ok && ram_matches_ticker(profile) && s_oled.start_line == s_dev._startLine;
+        shown = shown && (s_dev._flip || shown_matches_buffer(profile));
+    }
+    check(txns == 11 * 3, "one start line command and one page per ticker line");
+    check(ok, "display RAM matches the buffer through the start line");
+    check(shown, "panel shows the buffer through the start line");
+
+    /* Rolled in a row at a time: eight start line commands, the line written before it comes into view */
+    uint32_t commands = s_oled.commands;
+    ssd1306_ticker_line(&s_dev, "smooth", 6, false, 0);
+    int rows = s_dev._pages < I2C_MOCK_OLED_PAGES ? 8 : 1;
+    check(s_oled.commands - commands == (uint32_t)rows + 3, "smooth line steps the start line a row at a time");
+    check(ram_matches_ticker(profile), "display RAM matches the buffer after a smooth line");
+
+    /* Drawing with the start line moved, across the end of the RAM */
+    for (int page = 0; page < s_dev._pages; page++) {
+        memset(s_dev._page[page]._segs, 0x11 * (page + 1), profile->width);
+    }
+    ssd1306_show_buffer(&s_dev);
+    ssd1306_display_text(&s_dev, 0, "top", 3, false);
+    check(ram_matches_ticker(profile), "display RAM matches the buffer after drawing on a moved screen");
+
+    ssd1306_ticker_stop(&s_dev);
+    check(s_oled.start_line == 0 && ram_matches_ticker(profile), "ticker stop puts the screen back at start line 0");
+}
+
+static void check_profile(const ssd1306_profile_t *profile, bool flip)
+{
+    bool sh1106 = profile == &sh1106_profile_128x64;
+    printf("  %-15s %s\n", profile->name, flip ? "flipped" : "upright");
+
+    i2c_mock_reset();
+    i2c_mock_oled_init(&s_oled, I2C_ADDRESS, sh1106);
+    i2c_mock_attach(I2C_NUM_0, &s_oled.base);
+    memset(&s_dev, 0, sizeof(s_dev));
+    i2c_master_init(&s_dev, CHECK_SDA_IO, CHECK_SCL_IO, -1);
+    s_dev._flip = flip;
+    ssd1306_init_profile(&s_dev, profile);
+
+    check(s_oled.display_on && s_oled.unknown_commands == 0, "init sequence accepted by the controller");
+    check(s_oled.mux == profile->height - 1, "multiplex ratio is the panel height");
+    check(s_oled.charge_pump, "charge pump or DC-DC on");
+    check(s_dev._width == profile->width && s_dev._pages == (profile->height + 7) / 8, "geometry taken from the profile");
+
+    /* Something that is not symmetric under a column shift */
+    for (int page = 0; page < s_dev._pages; page++) {
+        for (int seg = 0; seg < s_dev._width; seg++) {
+            s_dev._page[page]._segs[seg] = (uint8_t)(seg * 7 + page * 31 + 1);
+        }
+    }
+    uint32_t txn0 = i2c_mock_log_total();
+    ssd1306_show_buffer(&s_dev);
+    uint32_t txns = i2c_mock_log_total() - txn0;
+    uint32_t want = (profile->caps & SSD1306_PANEL_HORIZONTAL) ? s_dev._pages + 2 : 2 * s_dev._pages;
+    check(txns == want, "frame sent in the profile's write pattern");
+    check(ram_matches_buffer(profile), "display RAM matches the buffer after a frame");
+    check(s_oled.addr_mode == 2, "page addressing restored after the frame");
+
+    /* Region in the middle, then a text line, which goes through write_window */
+    for (int page = 1; page < 3; page++) {
+        memset(&s_dev._page[page]._segs[8], 0xC3, 16);
+    }
+    ssd1306_show_pages(&s_dev, 1, 2, 8, 16);
+    check(ram_matches_buffer(profile), "display RAM matches the buffer after a region");
+    ssd1306_display_text(&s_dev, s_dev._pages - 1, "profile", 7, false);
+    check(ram_matches_buffer(profile), "display RAM matches the buffer after text");
+
+    uint32_t commands = s_oled.commands;
+    ssd1306_hardware_scroll(&s_dev, SCROLL_RIGHT);
+    if (profile->caps & SSD1306_PANEL_SCROLL) {
+        check(s_oled.scrolling, "hardware scroll started");
+        ssd1306_hardware_scroll(&s_dev, SCROLL_STOP);
+    } else {
+        check(s_oled.commands == commands && s_oled.unknown_commands == 0, "no scroll commands sent to a panel without scroll");
+    }
+
+    check_ticker(profile);
+
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+int main(void)
+{
+    printf("SSD1306 panel profiles over I2C\n");
+    const ssd1306_profile_t *profiles[] = {
+        &ssd1306_profile_128x64, &ssd1306_profile_128x32, &ssd1306_profile_72x40, &sh1106_profile_128x64,
+    };
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        check_profile(profiles[i], false);
+        check_profile(profiles[i], true);
+    }
+
+    check(ssd1306_profile_find("sh1106_128x64") == &sh1106_profile_128x64, "profile found by name");
+    check(ssd1306_profile_find("st7567") == NULL, "unknown profile name refused");
+    check(ssd1306_profile_for(72, 40) == &ssd1306_profile_72x40, "ssd1306_init size maps to the 72x40 profile");
+    check(ssd1306_profile_for(96, 16) == NULL, "size without a profile refused");
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
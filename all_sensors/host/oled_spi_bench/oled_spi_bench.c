@@ -0,0 +1,195 @@
+/*
+ * Frame rate of the SSD1306 SPI backend (components/ssd1306/ssd1306_spi.c) on the mock SPI bus (host/spi_bus_mock).
+ *
+ * The real ssd1306.c and ssd1306_spi.c drive an SSD1306 model through the mocked SPI master, which runs queued
+ * transactions back to back on the bus while the caller goes on. For each SPI clock:
+ *   - queued:   ssd1306_fps_benchmark, the whole frame is queued and the CPU only waits when the queue is full
+ *   - blocking: the same frames with a wait after every transaction, as with spi_device_transmit per write
+ * and the display RAM is compared with the frame buffer after each run, which checks that D/C, set in the pre-transfer
+ * callback, matches every transaction. The frame rate is bound by the bus either way; what queuing buys is the CPU:
+ * a frame call returns as soon as its transactions are queued instead of after the last byte.
+ *
+ * A 128x32 panel is also set up over SPI and checked for the geometry and the hardware scroll commands.
+ *
+ * Figures are host clock time with the cost constants of spi_bus_mock.h, not measurements. On the board, call
+ * ssd1306_fps_benchmark. Exit status is non-zero if the display RAM does not match or queuing is not faster.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "i2c_mock_models.h"
+#include "spi_bus_mock.h"
+#include "ssd1306.h"
+
+#define BENCH_MOSI_IO   23
+#define BENCH_SCLK_IO   18
+#define BENCH_CS_IO     5
+#define BENCH_DC_IO     4
+#define BENCH_FRAMES    200
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static i2c_mock_oled_t s_oled;
+static SSD1306_t s_dev;
+
+static void bench_up(int clock_hz)
+{
+    spi_mock_reset();
+    host_clock_reset();
+    i2c_mock_oled_init(&s_oled, 0, false);
+    spi_mock_attach(BENCH_CS_IO, BENCH_DC_IO, i2c_mock_oled_spi_rx, &s_oled);
+
+    memset(&s_dev, 0, sizeof(s_dev));
+    spi_clock_speed(clock_hz);
+    spi_master_init(&s_dev, BENCH_MOSI_IO, BENCH_SCLK_IO, BENCH_CS_IO, BENCH_DC_IO, -1);
+    ssd1306_init(&s_dev, 128, 64);
+    spi_flush(&s_dev);
+    check(s_oled.display_on && s_oled.unknown_commands == 0, "init sequence accepted by the controller");
+
+    /* Something that is not symmetric under a column shift */
+    for (int page = 0; page < 8; page++) {
+        for (int seg = 0; seg < 128; seg++) {
+            s_dev._page[page]._segs[seg] = (uint8_t)(seg * 7 + page * 31);
+        }
+    }
+}
+
+static void bench_down(void)
+{
+    spi_flush(&s_dev);
+    spi_bus_remove_device(s_dev._spi_device_handle);
+    heap_caps_free(s_dev._spi_queue);
+}
+
+static bool ram_matches_buffer(void)
+{
+    for (int page = 0; page < 8; page++) {
+        if (memcmp(s_oled.ram[page], s_dev._page[page]._segs, 128) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief ssd1306_show_buffer with every transaction waited for, as the backend did with spi_device_transmit
+ */
+static void show_buffer_blocking(void)
+{
+    for (int page = 0; page < s_dev._pages; page++) {
+        uint8_t commands[3] = { 0x00, 0x10, 0xB0 | page };
+        spi_master_write_commands(&s_dev, commands, sizeof(commands));
+        spi_flush(&s_dev);
+        spi_master_write_data(&s_dev, s_dev._page[page]._segs, 128);
+        spi_flush(&s_dev);
+    }
+}
+
+typedef struct {
+    double fps;
+    double wait_us;                 /* per frame, CPU blocked on the bus */
+    double busy;                    /* bus utilisation */
+    int64_t call_us;                /* one frame on an idle bus: time until the call returns */
+} bench_result_t;
+
+static void report(int clock_hz, const char *mode, const bench_result_t *r)
+{
+    printf("  %5.1f MHz  %-8s %7.1f fps  %7.0f us/frame  bus %5.1f%%  CPU blocked %6.0f us/frame  "
+           "one frame returns after %5" PRId64 " us\n",
+           clock_hz / 1e6, mode, r->fps, 1e6 / r->fps, 100.0 * r->busy, r->wait_us, r->call_us);
+}
+
+static void bench_at(int clock_hz)
+{
+    spi_mock_stats_t st0, st1;
+    bench_result_t queued, blocking;
+
+    bench_up(clock_hz);
+    spi_mock_get_stats(s_dev._spi_device_handle, &st0);
+    int64_t t0 = esp_timer_get_time();
+    queued.fps = ssd1306_fps_benchmark(&s_dev, BENCH_FRAMES);
+    int64_t elapsed = esp_timer_get_time() - t0;
+    spi_mock_get_stats(s_dev._spi_device_handle, &st1);
+    queued.wait_us = (double)(st1.wait_us - st0.wait_us) / BENCH_FRAMES;
+    queued.busy = (double)(st1.busy_us - st0.busy_us) / elapsed;
+    t0 = esp_timer_get_time();
+    ssd1306_show_buffer(&s_dev);
+    queued.call_us = esp_timer_get_time() - t0;
+    spi_flush(&s_dev);
+    check(ram_matches_buffer(), "display RAM matches the buffer after queued frames");
+    check(st1.max_in_flight > 2, "transactions overlap");
+    bench_down();
+
+    bench_up(clock_hz);
+    spi_mock_get_stats(s_dev._spi_device_handle, &st0);
+    t0 = esp_timer_get_time();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        show_buffer_blocking();
+    }
+    elapsed = esp_timer_get_time() - t0;
+    spi_mock_get_stats(s_dev._spi_device_handle, &st1);
+    blocking.fps = BENCH_FRAMES * 1e6 / elapsed;
+    blocking.wait_us = (double)(st1.wait_us - st0.wait_us) / BENCH_FRAMES;
+    blocking.busy = (double)(st1.busy_us - st0.busy_us) / elapsed;
+    t0 = esp_timer_get_time();
+    show_buffer_blocking();
+    blocking.call_us = esp_timer_get_time() - t0;
+    check(ram_matches_buffer(), "display RAM matches the buffer after blocking frames");
+    bench_down();
+
+    report(clock_hz, "blocking", &blocking);
+    report(clock_hz, "queued", &queued);
+    check(queued.fps > blocking.fps, "queued transactions are faster than blocking ones");
+}
+
+/**
+ * @brief 128x32 panel over SPI: init sequence, page count and scroll commands
+ */
+static void check_128x32(void)
+{
+    spi_mock_reset();
+    i2c_mock_oled_init(&s_oled, 0, false);
+    spi_mock_attach(BENCH_CS_IO, BENCH_DC_IO, i2c_mock_oled_spi_rx, &s_oled);
+    memset(&s_dev, 0, sizeof(s_dev));
+    spi_master_init(&s_dev, BENCH_MOSI_IO, BENCH_SCLK_IO, BENCH_CS_IO, BENCH_DC_IO, -1);
+    ssd1306_init(&s_dev, 128, 32);
+    ssd1306_hardware_scroll(&s_dev, SCROLL_UP);
+    spi_flush(&s_dev);
+    check(s_dev._pages == 4 && s_oled.mux == 31, "128x32: 4 pages, multiplex ratio 32");
+    check(s_oled.display_on && s_oled.unknown_commands == 0, "128x32: init sequence accepted by the controller");
+    check(s_oled.scrolling, "128x32: vertical scroll started");
+    ssd1306_hardware_scroll(&s_dev, SCROLL_STOP);
+    memset(s_oled.ram, 0, sizeof(s_oled.ram));
+    ssd1306_display_text(&s_dev, 3, "32", 2, false);
+    ssd1306_display_text(&s_dev, 4, "--", 2, false);
+    spi_flush(&s_dev);
+    check(!s_oled.scrolling, "128x32: scroll stopped");
+    check(s_oled.ram[3][8] != 0 && s_oled.ram[4][8] == 0, "128x32: text on page 3 shown, page 4 ignored");
+    bench_down();
+}
+
+int main(void)
+{
+    static const int clocks[] = { 1000000, 4000000, 8000000, 10000000 };
+
+    printf("SSD1306 128x64 over SPI, %d frames, transaction gap %d us\n", BENCH_FRAMES, SPI_MOCK_ISR_US);
+    for (size_t i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++) {
+        bench_at(clocks[i]);
+    }
+    check_128x32();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,596 @@
+/*
+ * OTA updates (components/ota_update) from packed images laid out as gen_custom_ota.py lays them out, compressed with
+ * liblzma as its Python lzma module does, against a stand-in file server on 127.0.0.1 in a thread of this process:
+ *   - v1, v2 and v3 headers, with and without the app header, are parsed as the script writes them; cut, foreign or
+ *     damaged headers are told apart
+ *   - an xz image downloaded whole, fed a byte at a time and over connections cut every few KB comes out as the app
+ *     it was made from, resuming with Range requests or, from a server without ranges, by dropping what was there
+ *   - damaged data, a wrong MD5, delta images and an image too large for the partition leave the target aborted
+ *   - an image refused from its header is given up without downloading the rest
+ * Exit status is non-zero if a check fails.
+ */
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <lzma.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "esp_rom_crc.h"
+#include "esp_rom_md5.h"
+#include "ota_packed.h"
+#include "ota_stream.h"
+
+#define APP_LEN         (180 * 1024)
+#define APP_VERSION     "2.1.0"
+#define PROJECT_NAME    "bme_scanner"
+#define FILE_PATH       "/custom_ota_binaries/bme_scanner.bin.xz.packed"
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/* The app and its packed file, as "idf.py gen_compressed_ota" makes them */
+
+static uint8_t s_app[APP_LEN];
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// Image header, segment header and esp_app_desc_t where the bootloader has them, then text and noise that compress
+// about as well as code does
+static void make_app(void)
+{
+    memset(s_app, 0, OTA_PACKED_APP_HEADER_LEN);
+    s_app[0] = 0xE9;
+    s_app[1] = 4;
+    put_le32(s_app + 32, 0xABCD5432);
+    strcpy((char *)s_app + 48, APP_VERSION);
+    strcpy((char *)s_app + 80, PROJECT_NAME);
+    uint32_t seed = 1;
+    size_t at = OTA_PACKED_APP_HEADER_LEN;
+    while (at < APP_LEN) {
+        seed = seed * 1103515245 + 12345;
+        char line[48];
+        int n = snprintf(line, sizeof(line), "sensor %u reading %u\n", (seed >> 8) % 7, (seed >> 12) % 4096);
+        for (int i = 0; i < n && at < APP_LEN; i++) {
+            s_app[at++] = (seed >> 20) % 5 == 0 ? (uint8_t)(seed >> (i % 24)) : (uint8_t)line[i];
+        }
+    }
+}
+
+// lzma.open(..., format=FORMAT_XZ, check=CHECK_CRC32, filters=[LZMA2, preset 6, dict_size 64 KB])
+static size_t xz_compress(const uint8_t *in, size_t len, uint8_t *out, size_t size)
+{
+    lzma_options_lzma opt;
+    if (lzma_lzma_preset(&opt, 6)) {
+        return 0;
+    }
+    opt.dict_size = 64 * 1024;
+    lzma_filter filters[] = {
+        { .id = LZMA_FILTER_LZMA2, .options = &opt },
+        { .id = LZMA_VLI_UNKNOWN },
+    };
+    size_t pos = 0;
+    return lzma_stream_buffer_encode(filters, LZMA_CHECK_CRC32, NULL, in, len, out, &pos, size) == LZMA_OK ? pos : 0;
+}
+
+typedef struct {
+    uint8_t version;
+    uint8_t compress;
+    uint8_t delta;
+    bool app_header;
+} pack_options_t;
+
+// The packed file in out (malloc'd), its length returned
+static size_t pack(const pack_options_t *o, uint8_t **out)
+{
+    size_t size = APP_LEN + APP_LEN / 8 + 1024;
+    uint8_t *data = malloc(size);
+    size_t data_len = APP_LEN;
+    if (o->compress == OTA_PACKED_COMPRESS_XZ) {
+        data_len = xz_compress(s_app, APP_LEN, data, size);
+    } else {
+        memcpy(data, s_app, APP_LEN);
+    }
+    uint8_t md5[ESP_ROM_MD5_DIGEST_LEN];
+    md5_context_t ctx;
+    esp_rom_md5_init(&ctx);
+    esp_rom_md5_update(&ctx, data, data_len);
+    esp_rom_md5_final(md5, &ctx);
+
+    uint8_t h[OTA_PACKED_HEADER_MAX] = { 'E', 'S', 'P', 0, o->version, (uint8_t)(o->compress | o->delta << 4) };
+    size_t h_len;
+    if (o->version < 3) {
+        strcpy((char *)h + 8, APP_VERSION);
+        put_le32(h + 40, data_len);
+        memcpy(h + 44, md5, sizeof(md5));
+        h_len = o->version == 2 ? 88 : 80;
+    } else {
+        h[6] = '0';
+        put_le32(h + 16, data_len);
+        memcpy(h + 20, md5, sizeof(md5));
+        h_len = 40;
+    }
+    put_le32(h + h_len - 4, esp_rom_crc32_le(0, h, h_len - 4));
+
+    size_t prefix = o->app_header ? OTA_PACKED_APP_HEADER_LEN : 0;
+    uint8_t *file = malloc(prefix + h_len + data_len);
+    memcpy(file, s_app, prefix);
+    if (prefix) {
+        file[1] = 0; // The script clears the segment count of the copy
+    }
+    memcpy(file + prefix, h, h_len);
+    memcpy(file + prefix + h_len, data, data_len);
+    free(data);
+    *out = file;
+    return prefix + h_len + data_len;
+}
+
+/* xz through liblzma, where the firmware has xz-embedded */
+
+static esp_err_t lzma_begin(void **state)
+{
+    lzma_stream *strm = calloc(1, sizeof(lzma_stream));
+    if (!strm || lzma_stream_decoder(strm, 1 << 20, 0) != LZMA_OK) {
+        free(strm);
+        return ESP_ERR_NO_MEM;
+    }
+    *state = strm;
+    return ESP_OK;
+}
+
+static esp_err_t lzma_run(void *state, const uint8_t *in, size_t in_len, size_t *in_used, uint8_t *out,
+                          size_t out_len, size_t *out_made, bool *end)
+{
+    lzma_stream *strm = state;
+    strm->next_in = in;
+    strm->avail_in = in_len;
+    strm->next_out = out;
+    strm->avail_out = out_len;
+    lzma_ret ret = lzma_code(strm, LZMA_RUN);
+    *in_used = in_len - strm->avail_in;
+    *out_made = out_len - strm->avail_out;
+    *end = ret == LZMA_STREAM_END;
+    return ret == LZMA_OK || ret == LZMA_STREAM_END || ret == LZMA_BUF_ERROR ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+}
+
+static void lzma_end_state(void *state)
+{
+    lzma_end(state);
+    free(state);
+}
+
+static const ota_decoder_t s_lzma = { .begin = lzma_begin, .run = lzma_run, .end = lzma_end_state };
+
+/* The OTA partition: RAM with room for cap bytes */
+
+static struct {
+    uint8_t mem[APP_LEN + 4096];
+    size_t cap;
+    size_t len;
+    int begins;
+    int finishes;
+    int aborts;
+    esp_err_t accept_ret;                                                                                   /*!< What the accept callback answers */
+    ota_packed_info_t accepted;
+} s_target;
+
+static esp_err_t target_begin(void *ctx)
+{
+    s_target.begins++;
+    s_target.len = 0;
+    return ESP_OK;
+}
+
+static esp_err_t target_write(void *ctx, const void *data, size_t len)
+{
+    if (len > s_target.cap - s_target.len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(s_target.mem + s_target.len, data, len);
+    s_target.len += len;
+    return ESP_OK;
+}
+
+static esp_err_t target_finish(void *ctx)
+{
+    s_target.finishes++;
+    return ESP_OK;
+}
+
+static void target_abort(void *ctx)
+{
+    s_target.aborts++;
+}
+
+static esp_err_t image_accept(void *ctx, const ota_packed_info_t *info)
+{
+    s_target.accepted = *info;
+    return s_target.accept_ret;
+}
+
+static void target_reset(size_t cap)
+{
+    memset(&s_target, 0, sizeof(s_target));
+    s_target.cap = cap;
+}
+
+static bool target_is_app(void)
+{
+    return s_target.finishes == 1 && s_target.aborts == 0 && s_target.len == APP_LEN &&
+           memcmp(s_target.mem, s_app, APP_LEN) == 0;
+}
+
+static ota_stream_t s_stream;
+
+static void stream_init(void)
+{
+    const ota_stream_config_t conf = {
+        .xz = &s_lzma,
+        .target = { .begin = target_begin, .write = target_write, .finish = target_finish, .abort = target_abort },
+        .accept = image_accept,
+        .attempts = 12,
+        .retry_ms = 100,
+    };
+    ota_stream_init(&s_stream, &conf);
+}
+
+/* Header parsing */
+
+static void check_packed(void)
+{
+    printf("  packed headers\n");
+    for (int version = 1; version <= 3; version++) {
+        for (int with_app = 0; with_app <= (version == 3); with_app++) {
+            pack_options_t o = { .version = version, .compress = OTA_PACKED_COMPRESS_XZ, .app_header = with_app };
+            uint8_t *file;
+            size_t len = pack(&o, &file);
+            ota_packed_info_t info;
+            bool ok = ota_packed_parse(file, len, &info) == ESP_OK;
+            char what[64];
+            snprintf(what, sizeof(what), "v%d%s parsed", version, with_app ? " with app header" : "");
+            check(ok && info.version == version && info.compress == OTA_PACKED_COMPRESS_XZ && info.delta == 0 &&
+                  info.header_len + info.length == len, what);
+            snprintf(what, sizeof(what), "v%d%s app description", version, with_app ? " with app header" : "");
+            check(info.has_app_header == with_app && strcmp(info.app_version, with_app ? APP_VERSION : "") == 0 &&
+                  strcmp(info.project_name, with_app ? PROJECT_NAME : "") == 0, what);
+
+            size_t cut = info.header_len - 1;
+            check(ota_packed_parse(file, cut, &info) == ESP_ERR_NOT_FINISHED, "header one byte short");
+            file[cut] ^= 0x01;
+            check(ota_packed_parse(file, len, &info) == ESP_ERR_INVALID_CRC, "damaged header CRC");
+            free(file);
+        }
+    }
+    static const uint8_t v9[8] = { 'E', 'S', 'P', 0, 9 };
+    static const uint8_t other[8] = { 'P', 'K', 3, 4 };
+    ota_packed_info_t info;
+    check(ota_packed_parse(v9, sizeof(v9), &info) == ESP_ERR_INVALID_VERSION, "unknown header version");
+    check(ota_packed_parse(other, sizeof(other), &info) == ESP_ERR_INVALID_RESPONSE, "not a packed image");
+    check(ota_packed_parse(s_app, OTA_PACKED_APP_HEADER_LEN + 10, &info) == ESP_ERR_INVALID_RESPONSE,
+          "a plain app image is not a packed one");
+}
+
+/* Fed straight, without the network */
+
+static esp_err_t feed_in_pieces(const uint8_t *file, size_t len, size_t piece)
+{
+    for (size_t at = 0; at < len; at += piece) {
+        esp_err_t ret = ota_stream_feed(&s_stream, file + at, len - at < piece ? len - at : piece);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ota_stream_finish(&s_stream);
+}
+
+static void check_stream(void)
+{
+    printf("  stream fed in pieces\n");
+    static const pack_options_t kinds[] = {
+        { .version = 3, .compress = OTA_PACKED_COMPRESS_XZ, .app_header = true },
+        { .version = 2, .compress = OTA_PACKED_COMPRESS_XZ },
+        { .version = 1, .compress = OTA_PACKED_COMPRESS_NONE },
+    };
+    static const size_t pieces[] = { 1, 333, 4096, 65536 };
+    for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++) {
+        uint8_t *file;
+        size_t len = pack(&kinds[k], &file);
+        for (size_t p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++) {
+            target_reset(sizeof(s_target.mem));
+            stream_init();
+            char what[64];
+            snprintf(what, sizeof(what), "v%u %s in %zu byte pieces", kinds[k].version,
+                     kinds[k].compress ? "xz" : "uncompressed", pieces[p]);
+            check(feed_in_pieces(file, len, pieces[p]) == ESP_OK && target_is_app(), what);
+        }
+        if (k == 0) {
+            printf("    app %d B, packed %zu B\n", APP_LEN, len);
+        }
+        free(file);
+    }
+
+    uint8_t *file;
+    size_t len = pack(&kinds[0], &file);
+    file[len / 2] ^= 0x40;
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    esp_err_t ret = feed_in_pieces(file, len, 1000);
+    check((ret == ESP_ERR_INVALID_RESPONSE || ret == ESP_ERR_INVALID_CRC) && s_target.finishes == 0,
+          "damaged xz data refused");
+    ota_stream_abort(&s_stream);
+    check(s_target.aborts == 1 && ota_stream_feed(&s_stream, file, 1) != ESP_OK, "aborted, and it sticks");
+    free(file);
+
+    len = pack(&kinds[2], &file);
+    file[len - 1] ^= 0x01;
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(feed_in_pieces(file, len, 4096) == ESP_ERR_INVALID_CRC && s_target.finishes == 0,
+          "uncompressed data against the MD5 of the header");
+    ota_stream_abort(&s_stream);
+    free(file);
+
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    len = pack(&kinds[0], &file);
+    check(feed_in_pieces(file, len - 1, 4096) == ESP_ERR_INVALID_SIZE, "short file is incomplete");
+    ota_stream_abort(&s_stream);
+    check(s_target.aborts == 1 && s_target.finishes == 0, "incomplete image aborted");
+    free(file);
+
+    pack_options_t delta = { .version = 2, .compress = OTA_PACKED_COMPRESS_XZ, .delta = 1 };
+    len = pack(&delta, &file);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(feed_in_pieces(file, len, 4096) == ESP_ERR_NOT_SUPPORTED && s_target.begins == 0, "delta image refused");
+    free(file);
+
+    len = pack(&kinds[0], &file);
+    target_reset(APP_LEN - 4096);
+    stream_init();
+    check(feed_in_pieces(file, len, 4096) == ESP_ERR_INVALID_SIZE, "image larger than the partition");
+    ota_stream_abort(&s_stream);
+    check(s_target.aborts == 1 && s_target.finishes == 0, "oversized image aborted");
+
+    target_reset(sizeof(s_target.mem));
+    s_target.accept_ret = ESP_ERR_INVALID_VERSION;
+    stream_init();
+    check(feed_in_pieces(file, len, 4096) == ESP_ERR_INVALID_VERSION && s_target.begins == 0 &&
+          strcmp(s_target.accepted.app_version, APP_VERSION) == 0, "refused by accept before anything is written");
+    free(file);
+}
+
+/* Stand-in file server: one connection at a time, one file, Range if enabled */
+
+static struct {
+    int listen_fd;
+    uint16_t port;
+    const uint8_t *file;
+    size_t len;
+    bool ranges;                                                                                            /*!< Answer "Range: bytes=N-" with 206, else the whole file */
+    size_t cut_every;                                                                                       /*!< Close mid-body once the file position passes the next multiple, 0: never */
+    size_t cut_at;
+    int requests;
+    int range_requests;
+    size_t sent;                                                                                            /*!< Body bytes, all requests */
+} s_srv;
+
+static bool send_all(int fd, const void *data, size_t len)
+{
+    return send(fd, data, len, MSG_NOSIGNAL) == (ssize_t)len;
+}
+
+// false: close the connection
+static bool answer(int fd, const char *req)
+{
+    char path[96], head[256];
+    if (sscanf(req, "GET %95s HTTP/1.1", path) != 1) {
+        return false;
+    }
+    s_srv.requests++;
+    if (strcmp(path, FILE_PATH) != 0) {
+        static const char missing[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 9\r\n\r\nno such\r\n";
+        return send_all(fd, missing, strlen(missing));
+    }
+    size_t start = 0;
+    const char *range = strstr(req, "Range: bytes=");
+    if (range) {
+        s_srv.range_requests++;
+    }
+    int n;
+    if (range && s_srv.ranges) {
+        start = strtoul(range + 13, NULL, 10);
+        n = snprintf(head, sizeof(head), "HTTP/1.1 206 Partial Content\r\nContent-Length: %zu\r\n"
+                     "Content-Range: bytes %zu-%zu/%zu\r\n\r\n", s_srv.len - start, start, s_srv.len - 1, s_srv.len);
+    } else {
+        n = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nAccept-Ranges: %s\r\n\r\n",
+                     s_srv.len, s_srv.ranges ? "bytes" : "none");
+    }
+    if (!send_all(fd, head, n)) {
+        return false;
+    }
+    size_t end = s_srv.len;
+    if (s_srv.cut_every) {
+        // Each cut a little further into the file, wherever the answer starts
+        while (s_srv.cut_at <= start) {
+            s_srv.cut_at += s_srv.cut_every;
+        }
+        if (s_srv.cut_at < end) {
+            end = s_srv.cut_at;
+            s_srv.cut_at += s_srv.cut_every;
+        }
+    }
+    for (size_t at = start; at < end; at += 1400) {
+        size_t piece = end - at < 1400 ? end - at : 1400;
+        if (!send_all(fd, s_srv.file + at, piece)) {
+            return false;
+        }
+        s_srv.sent += piece;
+    }
+    return end == s_srv.len;
+}
+
+static void *server_main(void *arg)
+{
+    while (true) {
+        int fd = accept(s_srv.listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        char req[1024];
+        size_t len = 0;
+        while (true) {
+            ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+            if (n <= 0) {
+                break;
+            }
+            len += n;
+            req[len] = '\0';
+            char *end = strstr(req, "\r\n\r\n");
+            if (!end) {
+                continue;
+            }
+            bool keep = answer(fd, req);
+            size_t used = end + 4 - req;
+            memmove(req, req + used, len - used + 1);
+            len -= used;
+            if (!keep) {
+                break;
+            }
+        }
+        close(fd);
+    }
+}
+
+static bool server_up(pthread_t *thread)
+{
+    s_srv.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (s_srv.listen_fd < 0 || bind(s_srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(s_srv.listen_fd, 4) != 0 || getsockname(s_srv.listen_fd, (struct sockaddr *)&addr, &len) != 0) {
+        return false;
+    }
+    s_srv.port = ntohs(addr.sin_port);
+    return pthread_create(thread, NULL, server_main, NULL) == 0;
+}
+
+static void serve(const uint8_t *file, size_t len, bool ranges, size_t cut_every)
+{
+    s_srv.file = file;
+    s_srv.len = len;
+    s_srv.ranges = ranges;
+    s_srv.cut_every = cut_every;
+    s_srv.cut_at = 0;
+    s_srv.requests = s_srv.range_requests = 0;
+    s_srv.sent = 0;
+}
+
+static void check_download(void)
+{
+    printf("  downloads from the stand-in server\n");
+    pthread_t thread;
+    if (!server_up(&thread)) {
+        check(false, "stand-in server started");
+        return;
+    }
+    data_fetch_t client;
+    data_fetch_config_t config = { .host = "127.0.0.1", .port = s_srv.port, .timeout_ms = 2000 };
+    check(data_fetch_init(&client, &config) == ESP_OK, "client set up");
+
+    pack_options_t o = { .version = 3, .compress = OTA_PACKED_COMPRESS_XZ, .app_header = true };
+    uint8_t *file;
+    size_t len = pack(&o, &file);
+
+    serve(file, len, true, 0);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(ota_stream_download(&s_stream, &client, FILE_PATH) == ESP_OK && target_is_app(), "whole download");
+    check(s_stream.stats.requests == 1 && s_stream.stats.resumes == 0 && s_stream.stats.received == len &&
+          s_stream.stats.written == APP_LEN && s_srv.range_requests == 0, "one request, no Range from the start");
+
+    serve(file, len, true, 7000);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(ota_stream_download(&s_stream, &client, FILE_PATH) == ESP_OK && target_is_app(),
+          "download cut every 7000 bytes");
+    check(s_stream.stats.resumes > 0 && s_stream.stats.requests == s_stream.stats.resumes + 1 &&
+          s_srv.range_requests == (int)s_stream.stats.resumes && s_srv.sent == len, "resumed by Range, nothing twice");
+    printf("    cut every 7000 B: %" PRIu32 " requests, %zu B sent for a %zu B file\n", s_stream.stats.requests,
+           s_srv.sent, len);
+
+    serve(file, len, false, 7000);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(ota_stream_download(&s_stream, &client, FILE_PATH) == ESP_OK && target_is_app(),
+          "server without ranges, cut every 7000 bytes");
+    check(s_stream.stats.received == len && s_srv.sent > len, "the part already there dropped, not fed twice");
+
+    serve(file, len, true, 3000);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    s_stream.config.attempts = 3;
+    esp_err_t ret = ota_stream_download(&s_stream, &client, FILE_PATH);
+    check(ret != ESP_OK && s_stream.stats.requests == 3 && s_target.aborts == 1 && s_target.finishes == 0,
+          "gives up after the attempts, target aborted");
+
+    serve(file, len, true, 0);
+    target_reset(sizeof(s_target.mem));
+    s_target.accept_ret = ESP_ERR_INVALID_VERSION;
+    stream_init();
+    check(ota_stream_download(&s_stream, &client, FILE_PATH) == ESP_ERR_INVALID_VERSION && s_target.begins == 0 &&
+          s_stream.stats.requests == 1, "running version: given up after the header");
+    check(s_stream.stats.received < OTA_PACKED_PREFIX_MAX + DATA_FETCH_RX_LEN && client.conn == NULL,
+          "the rest not read, the connection dropped");
+
+    file[len - 100] ^= 0x10;
+    serve(file, len, true, 0);
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    ret = ota_stream_download(&s_stream, &client, FILE_PATH);
+    check((ret == ESP_ERR_INVALID_RESPONSE || ret == ESP_ERR_INVALID_CRC) && s_stream.stats.requests == 1 &&
+          s_target.aborts == 1 && s_target.finishes == 0, "damaged image: not fetched again, aborted");
+
+    target_reset(sizeof(s_target.mem));
+    stream_init();
+    check(ota_stream_download(&s_stream, &client, "/missing.packed") == ESP_ERR_NOT_FOUND &&
+          s_stream.stats.requests == 1 && s_target.begins == 0, "404: not found, not retried");
+    free(file);
+
+    data_fetch_close(&client);
+    shutdown(s_srv.listen_fd, SHUT_RDWR);
+    close(s_srv.listen_fd);
+    pthread_join(thread, NULL);
+}
+
+int main(void)
+{
+    printf("OTA updates\n");
+    make_app();
+    check_packed();
+    check_stream();
+    check_download();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
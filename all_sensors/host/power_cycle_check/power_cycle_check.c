@@ -0,0 +1,126 @@
+/*
+ * Wake log and current estimate of the power modes (components/power_cycle):
+ *   - the log keeps the last POWER_CYCLE_LOG_LEN wakes in order once it wraps, and counts the ones dropped
+ *   - means by wake cause, awake share and average current over the records kept, against values worked out by hand
+ *   - estimates per configuration: deep sleep below light sleep below always-on for a few motion wakes an hour,
+ *     lower the longer the sample period, and no lower than always awake once the wakes fill the hour
+ * Prints the estimate for a grid of sample periods and motion rates with the default profile.
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "power_cycle_stats.h"
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void check_log(void)
+{
+    power_cycle_log_t log = { 0 };
+    for (uint32_t i = 0; i < 30; i++) {
+        power_cycle_record_t r = { .cause = POWER_CYCLE_WAKE_TIMER, .awake_ms = i };
+        power_cycle_log_add(&log, &r);
+    }
+    check(log.count == POWER_CYCLE_LOG_LEN && log.total == 30, "24 records kept of 30");
+    check(power_cycle_log_get(&log, 0)->awake_ms == 6, "oldest kept first");
+    check(power_cycle_log_get(&log, POWER_CYCLE_LOG_LEN - 1)->awake_ms == 29, "newest last");
+    check(power_cycle_log_get(&log, POWER_CYCLE_LOG_LEN) == NULL && power_cycle_log_get(&log, -1) == NULL,
+          "nothing past the records kept");
+}
+
+static void check_summary(void)
+{
+    power_cycle_profile_t profile = POWER_CYCLE_DEFAULT_PROFILE();
+    power_cycle_log_t log = { 0 };
+    power_cycle_summary_t sum;
+    power_cycle_log_summary(&log, &profile, &sum);
+    check(sum.span_ms == 0 && sum.average_ua == 0, "empty log sums to nothing");
+
+    power_cycle_record_t timer = {
+        .cause = POWER_CYCLE_WAKE_TIMER, .slept_ms = 300000, .ready_us = 50000, .awake_ms = 200,
+    };
+    power_cycle_record_t motion = {
+        .cause = POWER_CYCLE_WAKE_MOTION, .on = POWER_CYCLE_ON_WIFI | POWER_CYCLE_ON_DISPLAY, .slept_ms = 100000,
+        .ready_us = 400000, .awake_ms = 60000,
+    };
+    power_cycle_log_add(&log, &timer);
+    power_cycle_log_add(&log, &motion);
+    timer.ready_us = 70000;
+    timer.awake_ms = 400;
+    power_cycle_log_add(&log, &timer);
+    power_cycle_log_summary(&log, &profile, &sum);
+
+    /*
+     * Charge in uA ms: timer 300000 * 150 + 180 * 40000 + 200 * 40000 = 60200000 and with 400 ms 68200000,
+     * motion 100000 * 150 + 180 * 40000 + 60000 * (60000 + 12000) = 4342200000; 4470600000 over
+     * 700000 ms asleep and 3 * 180 + 200 + 60000 + 400 ms awake, 761140 ms: 5873 uA, 300 uA of the board on top
+     */
+    check(sum.wakes[POWER_CYCLE_WAKE_TIMER] == 2 && sum.wakes[POWER_CYCLE_WAKE_MOTION] == 1, "wakes by cause");
+    check(sum.ready_us[POWER_CYCLE_WAKE_TIMER] == 60000 && sum.ready_us[POWER_CYCLE_WAKE_MOTION] == 400000,
+          "mean wake time by cause");
+    check(sum.awake_ms[POWER_CYCLE_WAKE_TIMER] == 300 && sum.awake_ms[POWER_CYCLE_WAKE_MOTION] == 60000,
+          "mean awake time by cause");
+    check(sum.slept_ms == 700000 && sum.span_ms == 761140, "time asleep and covered");
+    check(sum.awake_permille == 80, "awake share");
+    check(sum.average_ua == 6173, "average current");
+}
+
+static uint32_t deep_sleep(uint32_t period_s, uint32_t motion_per_hour)
+{
+    power_cycle_profile_t profile = POWER_CYCLE_DEFAULT_PROFILE();
+    power_cycle_scenario_t s = {
+        .mode = POWER_CYCLE_MODE_DEEP_SLEEP, .sample_period_s = period_s, .sample_awake_ms = 250,
+        .motion_per_hour = motion_per_hour, .motion_awake_s = 120,
+    };
+    return power_cycle_estimate(&profile, &s);
+}
+
+static void check_estimate(void)
+{
+    power_cycle_profile_t profile = POWER_CYCLE_DEFAULT_PROFILE();
+    power_cycle_scenario_t on = { .mode = POWER_CYCLE_MODE_ALWAYS_ON };
+    power_cycle_scenario_t light = { .mode = POWER_CYCLE_MODE_LIGHT_SLEEP, .cpu_permille = 100 };
+    uint32_t on_ua = power_cycle_estimate(&profile, &on);
+    uint32_t light_ua = power_cycle_estimate(&profile, &light);
+    check(on_ua == 72300, "always-on: board, Wi-Fi and panel");
+    check(light_ua == 21000, "light sleep: 10% of the time at the Wi-Fi current, the rest asleep");
+    check(deep_sleep(300, 4) < light_ua && light_ua < on_ua, "deep sleep below light sleep below always-on");
+    check(deep_sleep(60, 0) > deep_sleep(300, 0) && deep_sleep(300, 0) > deep_sleep(3600, 0),
+          "longer sample period, less current");
+    check(deep_sleep(300, 12) > deep_sleep(300, 4), "more motion, more current");
+    check(deep_sleep(300, 0) > profile.board_ua + profile.deep_sleep_ua, "wakes cost above the sleep current");
+
+    /* 30 motion wakes of 2 minutes fill the hour: as if always on, boots aside */
+    uint32_t busy = deep_sleep(3600, 30);
+    check(busy > on_ua - 2000 && busy <= on_ua, "wakes filling the hour cost as much as staying on");
+
+    power_cycle_scenario_t unknown = { .mode = POWER_CYCLE_MODE_COUNT };
+    check(power_cycle_estimate(&profile, &unknown) == 0, "no estimate for an unknown mode");
+
+    printf("  always-on %6" PRIu32 " uA, light sleep %6" PRIu32 " uA\n", on_ua, light_ua);
+    printf("  deep sleep   motion/h:      0       4      12\n");
+    static const uint32_t periods[] = { 60, 300, 900, 3600 };
+    for (size_t i = 0; i < sizeof(periods) / sizeof(periods[0]); i++) {
+        printf("  sample every %4" PRIu32 " s  %6" PRIu32 "  %6" PRIu32 "  %6" PRIu32 " uA\n", periods[i],
+               deep_sleep(periods[i], 0), deep_sleep(periods[i], 4), deep_sleep(periods[i], 12));
+    }
+}
+
+int main(void)
+{
+    printf("Power modes, default current profile\n");
+    check_log();
+    check_summary();
+    check_estimate();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * Rule engine (components/rules) on the host clock:
+ *   - light hovering around the alarm level starts the track once, not on every reading, and again only after the
+ *     hysteresis band has been left and the cooldown is over
+ *   - hold windows, stale readings, banners and dimming that end with their condition
+ *   - only the rules of a changed input are evaluated, nothing for an unchanged value
+ *   - rule text with syntax errors is refused with its line and leaves the running table alone; loading from a file
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "host_clock.h"
+#include "rules.h"
+
+enum { IN_LUX, IN_TEMP, IN_PIR, IN_COUNT };
+
+static const char *const s_input_names[IN_COUNT] = { "lux", "temp", "pir" };
+
+static const char s_rules[] =
+    "# alarm\n"
+    "lux > 600 hyst 50 hold 1s cooldown 30s : play 1\n"
+    "lux > 600 hyst 50 : banner 5 JASNO - GRA!\n"
+    "\n"
+    "pir > 0 hold 500ms : banner 6 WIDZE CIE!\n"
+    "lux < 5 hyst 2 hold 10s : dim 16\n";
+
+static int s_failures;
+static rules_engine_t s_engine;
+static int s_plays, s_stops;
+static const char *s_banner[8];
+static int s_contrast = 255;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void on_action(const rules_action_t *action, bool active, void *ctx)
+{
+    switch (action->type) {
+    case RULES_ACTION_PLAY:
+        active ? s_plays++ : s_stops++;
+        break;
+    case RULES_ACTION_BANNER:
+        s_banner[action->arg] = active ? action->text : NULL;
+        break;
+    case RULES_ACTION_DIM:
+        s_contrast = active ? action->arg : 255;
+        break;
+    }
+}
+
+static void engine_up(void)
+{
+    host_clock_reset();
+    s_plays = s_stops = 0;
+    memset(s_banner, 0, sizeof(s_banner));
+    s_contrast = 255;
+    check(rules_init(&s_engine, s_input_names, IN_COUNT, on_action, NULL) == ESP_OK, "engine set up");
+    int line = -1;
+    check(rules_compile(&s_engine, s_rules, &line) == ESP_OK && line == 0 && s_engine.rule_count == 4, "rules compiled");
+}
+
+/**
+ * @brief One reading every 500 ms, as the main loop
+ */
+static void reading(float lux, bool fresh)
+{
+    host_clock_advance_us(500000);
+    rules_set_input(&s_engine, IN_LUX, lux, fresh);
+    rules_tick(&s_engine);
+}
+
+static void check_hover(void)
+{
+    printf("  light around the alarm level\n");
+    engine_up();
+    static const float hover[] = { 590, 610, 620, 615, 595, 605, 580, 603, 598, 601, 570, 560, 606, 590 };
+    for (size_t i = 0; i < sizeof(hover) / sizeof(hover[0]); i++) {
+        reading(hover[i], true);
+    }
+    check(s_plays == 1 && s_stops == 0, "track started once while hovering");
+    check(s_banner[5] && strcmp(s_banner[5], "JASNO - GRA!") == 0, "banner shown");
+
+    reading(540, true);
+    check(s_stops == 1 && !s_banner[5], "track and banner end below the band");
+
+    /* Back up within the cooldown: the banner comes at once, the track waits for the cooldown */
+    for (int i = 0; i < 10; i++) {
+        reading(650, true);
+    }
+    check(s_banner[5] && s_plays == 1, "no second start inside the cooldown");
+    for (int i = 0; i < 60 && s_plays == 1; i++) {
+        reading(650, true);
+    }
+    check(s_plays == 2, "started again once the cooldown is over");
+
+    reading(700, false);
+    check(s_stops == 2 && !s_banner[5], "a stale reading ends the alarm");
+
+    rules_stats_t st;
+    rules_get_stats(&s_engine, &st);
+    printf("    updates %" PRIu32 "  evaluations %" PRIu32 "  activations %" PRIu32 "  cooldown waits %" PRIu32 "\n",
+           st.updates, st.evaluations, st.activations, st.cooldown_waits);
+    check(st.cooldown_waits == 1, "one wait for the cooldown");
+}
+
+static void check_hold(void)
+{
+    printf("  hold windows\n");
+    engine_up();
+    rules_set_input(&s_engine, IN_PIR, 1, true);
+    host_clock_advance_us(300000);
+    rules_set_input(&s_engine, IN_PIR, 0, true);
+    host_clock_advance_us(300000);
+    rules_tick(&s_engine);
+    check(!s_banner[6], "a 300 ms blip does not show the banner");
+
+    rules_set_input(&s_engine, IN_PIR, 1, true);
+    host_clock_advance_us(400000);
+    rules_tick(&s_engine);
+    check(!s_banner[6], "not before 500 ms");
+    host_clock_advance_us(100000);
+    rules_tick(&s_engine);
+    check(s_banner[6] && rules_is_active(&s_engine, 2), "banner after 500 ms without a new reading");
+    rules_set_input(&s_engine, IN_PIR, 0, true);
+    check(!s_banner[6], "banner gone with the motion");
+
+    for (int i = 0; i < 19; i++) {
+        reading(3, true);
+    }
+    check(s_contrast == 255, "not dimmed before 10 s of darkness");
+    for (int i = 0; i < 2; i++) {
+        reading(4, true);
+    }
+    check(s_contrast == 16, "dimmed in the dark");
+    reading(6.5f, true);
+    check(s_contrast == 16, "still dimmed inside the band");
+    reading(8, true);
+    check(s_contrast == 255, "full contrast again");
+}
+
+static void check_changes_only(void)
+{
+    printf("  evaluation on change\n");
+    engine_up();
+    rules_stats_t before, after;
+    rules_get_stats(&s_engine, &before);
+    for (int i = 0; i < 100; i++) {
+        rules_set_input(&s_engine, IN_TEMP, 21.5f, true);
+        rules_set_input(&s_engine, IN_PIR, 0, false);
+        rules_tick(&s_engine);
+    }
+    rules_get_stats(&s_engine, &after);
+    check(after.evaluations == before.evaluations, "no rule evaluated for inputs without rules or without changes");
+
+    reading(100, true);
+    rules_get_stats(&s_engine, &after);
+    check(after.evaluations - before.evaluations == 3, "a new light value evaluates only the three light rules");
+}
+
+static void check_compile(void)
+{
+    printf("  rule text\n");
+    engine_up();
+    reading(700, true);
+    reading(700, true);
+    reading(700, true);
+    check(s_plays == 1, "alarm running");
+
+    static const struct {
+        const char *text;
+        int line;
+    } bad[] = {
+        { "lux > 600 : play 1\nhumidity > 80 : play 2\n", 2 },
+        { "lux >= 600 : play 1\n", 1 },
+        { "\n\nlux > 600 hold 1h : play 1\n", 3 },
+        { "lux > 600 : play\n", 1 },
+        { "lux > 600 : banner 9 X\n", 1 },
+        { "lux > 600 : banner 1 FAR TOO LONG FOR A LINE\n", 1 },
+        { "lux > 600 : play 1\npir > 0 : banner 6 WIDZĘ CIĘ\n", 2 },
+        { "lux > 600 play 1\n", 1 },
+        { "pir > 0 : dim 300\n", 1 },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        int line = 0;
+        char what[96];
+        snprintf(what, sizeof(what), "error on line %d of bad text %zu", bad[i].line, i);
+        check(rules_compile(&s_engine, bad[i].text, &line) == ESP_ERR_INVALID_ARG && line == bad[i].line, what);
+    }
+    check(s_engine.rule_count == 4 && s_plays == 1 && s_stops == 0, "running table kept after errors");
+
+    char many[RULES_MAX * 24 + 32] = "";
+    for (int i = 0; i <= RULES_MAX; i++) {
+        strcat(many, "temp > 30 : dim 10\n");
+    }
+    check(rules_compile(&s_engine, many, NULL) == ESP_ERR_NO_MEM, "more than RULES_MAX rules refused");
+
+    /* A new table ends the actions of the old one and starts those whose condition already holds */
+    const char *path = "rules_check.rules";
+    FILE *f = fopen(path, "w");
+    fputs("# from a file\nlux > 300 : banner 1 OK\n", f);
+    fclose(f);
+    check(rules_load_file(&s_engine, path, NULL) == ESP_OK && s_engine.rule_count == 1, "rules loaded from a file");
+    remove(path);
+    check(s_stops == 1 && !s_banner[5], "old actions ended");
+    check(s_banner[1] && strcmp(s_banner[1], "OK") == 0, "new rule active on the current value");
+    check(rules_load_file(&s_engine, "no/such/file", NULL) == ESP_ERR_NOT_FOUND, "missing file reported");
+}
+
+int main(void)
+{
+    printf("Rule engine\n");
+    check_hover();
+    check_hold();
+    check_changes_only();
+    check_compile();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
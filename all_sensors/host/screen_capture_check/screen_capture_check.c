@@ -0,0 +1,410 @@
+/*
+ * Screen capture (components/screen_capture) against the controller model on the mock I2C bus as the panel:
+ *   - PBM and PNG of a known pattern, the PNG taken apart again: chunk CRCs, the stored deflate block, Adler-32
+ *     and every pixel; a 72x40 frame as well
+ *   - stream messages: a key and deltas applied by a receiver, malformed ones and deltas of another panel size
+ *     rejected without touching its frame
+ *   - the pacer's changed columns: a clock whose seconds change sends one character wide regions, a screen that
+ *     does not change reports nothing, and a receiver that takes a message only every few frames still ends up
+ *     with exactly what the panel RAM holds
+ * With a file name as argument the last frame of the stream is written there as a PNG.
+ * Exit status is non-zero if a check fails.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c.h"
+#include "host_clock.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "display_pacer.h"
+#include "screen_capture_codec.h"
+#include "ssd1306.h"
+
+#define CHECK_SDA_IO    21
+#define CHECK_SCL_IO    22
+#define RENDER_US       300                                                         /*!< Host clock charged per render */
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void pattern(screen_capture_frame_t *frame)
+{
+    for (int page = 0; page < frame->height / 8; page++) {
+        for (int col = 0; col < frame->width; col++) {
+            frame->pages[page][col] = (uint8_t)(col * 7 + page * 31) ^ (col & 1 ? 0xa5 : 0x00);
+        }
+    }
+}
+
+static bool same_pixels(const screen_capture_frame_t *a, const screen_capture_frame_t *b)
+{
+    if (a->width != b->width || a->height != b->height) {
+        return false;
+    }
+    for (int page = 0; page < a->height / 8; page++) {
+        if (memcmp(a->pages[page], b->pages[page], a->width) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ---- PNG reader: just enough for 1 bit grayscale in stored blocks ---- */
+
+static uint32_t be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t crc32_table(const uint8_t *data, size_t len)
+{
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+static bool read_png(const uint8_t *png, size_t len, screen_capture_frame_t *frame)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t data[2048];
+    size_t data_len = 0;
+    bool ended = false;
+    int width = 0, height = 0;
+    if (len < 8 || memcmp(png, signature, 8) != 0) {
+        return false;
+    }
+    for (size_t pos = 8; pos < len && !ended;) {
+        uint32_t chunk_len = be32(png + pos);
+        if (pos + 12 + chunk_len > len ||
+            crc32_table(png + pos + 4, 4 + chunk_len) != be32(png + pos + 8 + chunk_len)) {
+            return false;
+        }
+        const uint8_t *type = png + pos + 4, *body = png + pos + 8;
+        if (memcmp(type, "IHDR", 4) == 0) {
+            width = be32(body);
+            height = be32(body + 4);
+            if (chunk_len != 13 || body[8] != 1 || body[9] != 0 || body[10] || body[11] || body[12]) {
+                return false;
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            if (data_len + chunk_len > sizeof(data)) return false;
+            memcpy(data + data_len, body, chunk_len);
+            data_len += chunk_len;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            ended = pos + 12 == len;
+        }
+        pos += 12 + chunk_len;
+    }
+    if (!ended || screen_capture_frame_init(frame, width, height) != ESP_OK) {
+        return false;
+    }
+
+    /* zlib: header, stored blocks, Adler-32 of the rows */
+    if (data_len < 6 || (data[0] << 8 | data[1]) % 31 != 0 || (data[0] & 0x0f) != 8) {
+        return false;
+    }
+    uint8_t raw[2048];
+    size_t raw_len = 0;
+    size_t pos = 2;
+    bool last = false;
+    while (!last) {
+        if (pos + 5 > data_len || (data[pos] & 0x06) != 0) {
+            return false; // Only stored blocks are expected
+        }
+        last = data[pos] & 1;
+        uint16_t n = data[pos + 1] | data[pos + 2] << 8;
+        uint16_t nn = data[pos + 3] | data[pos + 4] << 8;
+        if ((n ^ nn) != 0xffff || pos + 5 + n > data_len || raw_len + n > sizeof(raw)) {
+            return false;
+        }
+        memcpy(raw + raw_len, data + pos + 5, n);
+        raw_len += n;
+        pos += 5 + n;
+    }
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < raw_len; i++) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    if (pos + 4 != data_len || be32(data + pos) != (b << 16 | a)) {
+        return false;
+    }
+
+    size_t row_len = 1 + (width + 7) / 8;
+    if (raw_len != row_len * height) {
+        return false;
+    }
+    for (int y = 0; y < height; y++) {
+        const uint8_t *row = raw + y * row_len;
+        if (row[0] != 0) {
+            return false;
+        }
+        for (int x = 0; x < width; x++) {
+            if (row[1 + x / 8] & (0x80 >> (x % 8))) {
+                frame->pages[y / 8][x] |= 1 << (y % 8);
+            }
+        }
+    }
+    return true;
+}
+
+static void check_images(void)
+{
+    static screen_capture_frame_t frame, back;
+    static uint8_t out[SCREEN_CAPTURE_PNG_MAX];
+
+    check(screen_capture_frame_init(&frame, 128, 60) == ESP_ERR_INVALID_ARG, "height in whole pages only");
+    check(screen_capture_frame_init(&frame, 129, 64) == ESP_ERR_INVALID_ARG, "at most 128 columns");
+
+    size_t pbm_len = 0, png_len = 0;
+    int sizes[][2] = { { 128, 64 }, { 72, 40 } };
+    for (int s = 0; s < 2; s++) {
+        screen_capture_frame_init(&frame, sizes[s][0], sizes[s][1]);
+        pattern(&frame);
+
+        size_t len = screen_capture_pbm(&frame, out, sizeof(out));
+        char header[16];
+        int header_len = snprintf(header, sizeof(header), "P4\n%d %d\n", sizes[s][0], sizes[s][1]);
+        int row_len = (sizes[s][0] + 7) / 8;
+        check(len == (size_t)header_len + row_len * sizes[s][1], "PBM length");
+        check(memcmp(out, header, header_len) == 0, "PBM header");
+        bool pixels = true;
+        for (int y = 0; y < frame.height; y++) {
+            for (int x = 0; x < frame.width; x++) {
+                bool black = out[header_len + y * row_len + x / 8] & (0x80 >> (x % 8));
+                pixels = pixels && black == !screen_capture_pixel(&frame, x, y);
+            }
+        }
+        check(pixels, "PBM pixels, lit ones white");
+        check(screen_capture_pbm(&frame, out, len - 1) == 0, "PBM that does not fit");
+
+        len = screen_capture_png(&frame, out, sizeof(out));
+        check(len > 0 && len <= SCREEN_CAPTURE_PNG_MAX, "PNG within SCREEN_CAPTURE_PNG_MAX");
+        check(read_png(out, len, &back), "PNG reads back");
+        check(same_pixels(&frame, &back), "PNG pixels, lit ones white");
+        check(screen_capture_png(&frame, out, len - 1) == 0, "PNG that does not fit");
+        if (s == 0) {
+            pbm_len = screen_capture_pbm(&frame, out, sizeof(out));
+            png_len = len;
+        }
+    }
+    printf("  images     128x64 PNG %u bytes, PBM %u bytes\n", (unsigned)png_len, (unsigned)pbm_len);
+}
+
+static void check_messages(void)
+{
+    static screen_capture_frame_t frame, rx;
+    static uint8_t msg[SCREEN_CAPTURE_DELTA_MAX];
+    screen_capture_dirty_t dirty;
+    uint16_t seq;
+    bool key;
+
+    screen_capture_frame_init(&frame, 128, 64);
+    screen_capture_frame_init(&rx, 128, 64);
+    pattern(&frame);
+    screen_capture_clear(&dirty);
+    size_t len = screen_capture_delta(&frame, &dirty, 7, true, msg, sizeof(msg));
+    check(len == SCREEN_CAPTURE_DELTA_MAX, "a key carries every page in full");
+    check(screen_capture_apply(&rx, msg, len, &seq, &key) == ESP_OK && key && seq == 7, "key applied");
+    check(same_pixels(&frame, &rx), "receiver has the frame after a key");
+
+    /* Two spans on page 2 add up to one, page 5 on its own */
+    frame.pages[2][10] ^= 0xff;
+    frame.pages[2][40] ^= 0xff;
+    frame.pages[5][127] ^= 0x01;
+    screen_capture_mark(&dirty, 2, 40, 1);
+    screen_capture_mark(&dirty, 2, 10, 1);
+    screen_capture_mark(&dirty, 5, 127, 1);
+    check(dirty.first[2] == 10 && dirty.end[2] == 41, "spans of a page merge");
+    len = screen_capture_delta(&frame, &dirty, 8, false, msg, sizeof(msg));
+    check(len == SCREEN_CAPTURE_HEADER_LEN + 3 + 31 + 3 + 1, "delta carries the marked columns only");
+    check(screen_capture_delta(&frame, &dirty, 8, false, msg, len - 1) == 0, "delta that does not fit");
+    check(screen_capture_apply(&rx, msg, len, &seq, &key) == ESP_OK && !key && seq == 8, "delta applied");
+    check(same_pixels(&frame, &rx), "receiver has the frame after a delta");
+
+    /* Malformed: the receiver's frame stays as it was */
+    static screen_capture_frame_t before;
+    before = rx;
+    uint8_t bad[SCREEN_CAPTURE_DELTA_MAX];
+    memcpy(bad, msg, len);
+    bad[0] = 0;
+    check(screen_capture_apply(&rx, bad, len, &seq, &key) == ESP_ERR_INVALID_RESPONSE, "wrong magic rejected");
+    memcpy(bad, msg, len);
+    check(screen_capture_apply(&rx, bad, len - 1, &seq, &key) == ESP_ERR_INVALID_RESPONSE, "short region rejected");
+    bad[SCREEN_CAPTURE_HEADER_LEN] = 8;
+    check(screen_capture_apply(&rx, bad, len, &seq, &key) == ESP_ERR_INVALID_RESPONSE, "page out of range rejected");
+    memcpy(bad, msg, len);
+    bad[SCREEN_CAPTURE_HEADER_LEN + 1] = 120;
+    check(screen_capture_apply(&rx, bad, len, &seq, &key) == ESP_ERR_INVALID_RESPONSE,
+          "columns past the width rejected");
+    memcpy(bad, msg, len);
+    bad[5] = 32;
+    check(screen_capture_apply(&rx, bad, len, &seq, &key) == ESP_ERR_INVALID_STATE, "delta of another size rejected");
+    check(memcmp(&before, &rx, sizeof(rx)) == 0, "frame untouched by rejected messages");
+}
+
+/* ---- Pacer on the panel model, the observer as screen_capture.c has it ---- */
+
+typedef struct {
+    screen_capture_frame_t frame;
+    screen_capture_dirty_t dirty;
+    int calls;
+    int regions;
+    int widest;
+} capture_t;
+
+static void on_frame(void *ctx, const uint8_t shown[][128], const display_pacer_region_t *regions, int count)
+{
+    capture_t *cap = ctx;
+    for (int i = 0; i < count; i++) {
+        const display_pacer_region_t *r = &regions[i];
+        memcpy(&cap->frame.pages[r->page][r->col], &shown[r->page][r->col], r->len);
+        screen_capture_mark(&cap->dirty, r->page, r->col, r->len);
+        if (r->len > cap->widest) cap->widest = r->len;
+    }
+    cap->calls++;
+    cap->regions += count;
+}
+
+static bool rx_matches_panel(const screen_capture_frame_t *rx, const i2c_mock_oled_t *oled)
+{
+    for (int y = 0; y < rx->height; y++) {
+        for (int x = 0; x < rx->width; x++) {
+            if (screen_capture_pixel(rx, x, y) != i2c_mock_oled_pixel(oled, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void check_stream(const char *png_path)
+{
+    static i2c_mock_oled_t oled;
+    static SSD1306_t dev;
+    static display_pacer_t pacer;
+    static capture_t cap;
+    static screen_capture_frame_t rx;
+    static uint8_t msg[SCREEN_CAPTURE_DELTA_MAX];
+
+    i2c_mock_reset();
+    i2c_mock_oled_init(&oled, I2C_ADDRESS, false);
+    i2c_mock_attach(I2C_NUM_0, &oled.base);
+    memset(&dev, 0, sizeof(dev));
+    i2c_master_init(&dev, CHECK_SDA_IO, CHECK_SCL_IO, -1);
+    ssd1306_init(&dev, 128, 64);
+    display_pacer_config_t config = DISPLAY_PACER_DEFAULT_CONFIG();
+    display_pacer_init(&pacer, &dev, &config);
+    memset(&cap, 0, sizeof(cap));
+    screen_capture_frame_init(&cap.frame, dev._width, dev._height);
+    display_pacer_set_observer(&pacer, on_frame, &cap);
+
+    /* First frame goes in full, the receiver starts from a key */
+    display_pacer_wait(&pacer);
+    _ssd1306_text(&dev, 0, "12:00:00", 8, false);
+    _ssd1306_text(&dev, 3, "21.5 C  45 %", 12, false);
+    display_pacer_present(&pacer);
+    check(cap.calls == 1 && cap.regions == 8 && cap.widest == 128, "first frame reported in full");
+    uint16_t seq = 0, rx_seq;
+    bool key;
+    size_t len = screen_capture_delta(&cap.frame, &cap.dirty, seq++, true, msg, sizeof(msg));
+    screen_capture_clear(&cap.dirty);
+    check(screen_capture_apply(&rx, msg, len, &rx_seq, &key) == ESP_OK, "key applied");
+    check(rx_matches_panel(&rx, &oled), "receiver matches the panel after the key");
+
+    /* A clock: one digit a second, one character wide */
+    cap.widest = 0;
+    int calls0 = cap.calls;
+    size_t stream_bytes = 0;
+    for (int frame = 1; frame <= 100; frame++) {
+        display_pacer_wait(&pacer);
+        host_clock_advance_us(RENDER_US);
+        char line[17];
+        int n = snprintf(line, sizeof(line), "12:00:%02d", frame / 10);
+        _ssd1306_text(&dev, 0, line, n, false);
+        display_pacer_present(&pacer);
+        if (screen_capture_is_dirty(&cap.dirty)) {
+            len = screen_capture_delta(&cap.frame, &cap.dirty, seq++, false, msg, sizeof(msg));
+            screen_capture_clear(&cap.dirty);
+            stream_bytes += len;
+            check(screen_capture_apply(&rx, msg, len, &rx_seq, &key) == ESP_OK && !key, "clock delta applied");
+        }
+    }
+    check(cap.calls - calls0 == 10, "one report per change");
+    check(cap.widest <= 16, "a changed digit reported one or two characters wide");
+    check(rx_matches_panel(&rx, &oled), "receiver matches the panel after the clock");
+    printf("  clock      10 changes, %u stream bytes, widest region %d columns\n", (unsigned)stream_bytes, cap.widest);
+
+    /* Nothing changes: the observer is not called, nothing to send */
+    calls0 = cap.calls;
+    for (int frame = 0; frame < 50; frame++) {
+        display_pacer_wait(&pacer);
+        host_clock_advance_us(RENDER_US);
+        display_pacer_present(&pacer);
+    }
+    check(cap.calls == calls0 && !screen_capture_is_dirty(&cap.dirty), "static screen reports nothing");
+
+    /* A slow receiver: a message every 5th frame, the changes in between add up */
+    int messages = 0;
+    for (int frame = 0; frame < 40; frame++) {
+        display_pacer_wait(&pacer);
+        host_clock_advance_us(RENDER_US);
+        int page = 1 + frame % 7;
+        for (int col = frame; col < frame + 9; col++) {
+            dev._page[page]._segs[(col * 3) % 128] ^= (uint8_t)(frame * 37 + col);
+        }
+        display_pacer_present(&pacer);
+        if (frame % 5 == 4) {
+            len = screen_capture_delta(&cap.frame, &cap.dirty, seq++, false, msg, sizeof(msg));
+            screen_capture_clear(&cap.dirty);
+            messages++;
+            check(screen_capture_apply(&rx, msg, len, &rx_seq, &key) == ESP_OK, "coalesced delta applied");
+        }
+    }
+    check(messages == 8, "eight messages for forty frames");
+    check(rx_matches_panel(&rx, &oled), "slow receiver matches the panel");
+
+    /* Observer off: frames are sent as before */
+    display_pacer_set_observer(&pacer, NULL, NULL);
+    calls0 = cap.calls;
+    display_pacer_wait(&pacer);
+    _ssd1306_text(&dev, 7, "no observer", 11, true);
+    display_pacer_present(&pacer);
+    check(cap.calls == calls0, "no reports without an observer");
+
+    if (png_path) {
+        static uint8_t png[SCREEN_CAPTURE_PNG_MAX];
+        len = screen_capture_png(&rx, png, sizeof(png));
+        FILE *f = fopen(png_path, "wb");
+        check(f && fwrite(png, 1, len, f) == len, "PNG written");
+        if (f) fclose(f);
+    }
+    i2c_driver_delete(I2C_NUM_0);
+}
+
+int main(int argc, char **argv)
+{
+    printf("Screen capture, SSD1306 128x64 over I2C\n");
+    check_images();
+    check_messages();
+    check_stream(argc > 1 ? argv[1] : NULL);
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
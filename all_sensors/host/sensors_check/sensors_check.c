@@ -0,0 +1,492 @@
+/*
+ * Host checks of the sensor drivers and the sensing loop against the mock I2C bus (host/i2c_bus_mock).
+ *
+ * The real bme280, ssd1306 (legacy I2C backend), display_pacer, rules, main/sensors.c and main/mirror_rules.c are
+ * compiled unchanged and talk to register level models of the BME280, BH1750 and SSD1306 on the mock bus:
+ *   - drivers:  data path and configuration seen by each device
+ *   - loop:     stale/valid flags, display text, the alarm banner of the default rules, recovery from NACK, unplug
+ *               and SDA held low
+ *   - fuzz:     random faults, raw values and text against the loop invariants (seed as first argument)
+ *   - profile:  bus time per loop iteration (paced frames: only changed pages are sent) and per transaction, at 100
+ *               and 400 kHz
+ *
+ * All time is host clock time (shim/host_clock.h), results do not depend on the machine except the host CPU figure.
+ * Driver logs go to stderr. Exit status is non-zero if any check fails.
+ */
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "i2c_bus.h"
+#include "i2c_bus_mock.h"
+#include "i2c_mock_models.h"
+#include "bme280.h"
+#include "display_pacer.h"
+#include "ssd1306.h"
+#include "mirror_rules.h"
+#include "sensors.h"
+
+#define CHECK_PORT      I2C_NUM_0
+#define CHECK_SDA_IO    21
+#define CHECK_SCL_IO    22
+#define CHECK_BME_ADDR  0x76
+#define CHECK_BH_ADDR   0x23
+#define CHECK_OLED_ADDR 0x3C
+#define CHECK_LOOP_MS   500
+#define FUZZ_ROUNDS     3000
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------ fixture */
+
+typedef struct {
+    i2c_mock_bme280_t bme;
+    i2c_mock_bh1750_t bh;
+    i2c_mock_oled_t oled;
+    i2c_bus_handle_t bus;
+    sensors_t sensors;
+    readings_t r;
+    SSD1306_t dev;
+    display_pacer_t pacer;
+    rules_engine_t rules;
+    const char *banner[8];                                                                                  /*!< Shown instead of the line, NULL: none */
+    uint32_t loops;
+} rig_t;
+
+static rig_t s_rig;
+
+static void rig_up(uint32_t clk_speed)
+{
+    rig_t *g = &s_rig;
+    i2c_mock_reset();
+    memset(g, 0, sizeof(*g));
+    i2c_mock_bme280_init(&g->bme, CHECK_BME_ADDR, I2C_MOCK_BME280_CHIP_ID);
+    i2c_mock_bh1750_init(&g->bh, CHECK_BH_ADDR);
+    i2c_mock_oled_init(&g->oled, CHECK_OLED_ADDR, false);
+    g->bh.lux = 250.0f;
+    i2c_mock_attach(CHECK_PORT, &g->bme.base);
+    i2c_mock_attach(CHECK_PORT, &g->bh.base);
+    i2c_mock_attach(CHECK_PORT, &g->oled.base);
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = CHECK_SDA_IO,
+        .scl_io_num = CHECK_SCL_IO,
+        .sda_pullup_en = true,
+        .scl_pullup_en = true,
+        .master.clk_speed = clk_speed,
+    };
+    g->bus = i2c_bus_create(CHECK_PORT, &conf);
+    g->sensors.bme_dev = i2c_bus_device_create(g->bus, CHECK_BME_ADDR, 0);
+    g->sensors.bh_dev = i2c_bus_device_create(g->bus, CHECK_BH_ADDR, 0);
+    i2c_device_add(&g->dev, CHECK_PORT, -1, CHECK_OLED_ADDR);
+}
+
+static void rig_down(void)
+{
+    rig_t *g = &s_rig;
+    i2c_bus_device_delete(&g->sensors.bme_dev);
+    i2c_bus_device_delete(&g->sensors.bh_dev);
+    i2c_bus_delete(&g->bus);
+    check(i2c_mock_cmd_links_alive() == 0, "every command link is deleted");
+}
+
+/* Rule actions as in app_main, without the DFPlayer */
+static void on_rule_action(const rules_action_t *action, bool active, void *ctx)
+{
+    rig_t *g = ctx;
+    if (action->type == RULES_ACTION_BANNER) {
+        g->banner[action->arg] = active ? action->text : NULL;
+    } else if (action->type == RULES_ACTION_DIM) {
+        ssd1306_contrast(&g->dev, active ? action->arg : 0xFF);
+    }
+}
+
+/**
+ * @brief Panel, frame pacing and the default rules, set up as in app_main
+ */
+static void rig_app_up(void)
+{
+    rig_t *g = &s_rig;
+    ssd1306_init(&g->dev, 128, 64);
+    display_pacer_config_t conf = DISPLAY_PACER_DEFAULT_CONFIG();
+    conf.target_fps = 1000 / CHECK_LOOP_MS;
+    check(display_pacer_init(&g->pacer, &g->dev, &conf) == ESP_OK, "pacer set up");
+    rules_init(&g->rules, mirror_rule_inputs, IN_COUNT, on_rule_action, g);
+    check(rules_compile(&g->rules, mirror_default_rules, NULL) == ESP_OK, "default rules compile");
+}
+
+/**
+ * @brief One iteration of the main loop, as in app_main without the PIR, the feeds and the DFPlayer: the clock line
+ * changes once a second, the frame is drawn into the buffer and display_pacer_present sends the changed pages
+ */
+static void rig_loop(void)
+{
+    rig_t *g = &s_rig;
+    char buf_t[20], buf_p[30], buf_l[20], buf_time[20];
+    display_pacer_wait(&g->pacer);
+    sensors_poll(&g->sensors, &g->r);
+    uint32_t seconds = g->loops++ * CHECK_LOOP_MS / 1000;
+    snprintf(buf_time, sizeof(buf_time), "12:%02u:%02u", (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60));
+    _ssd1306_clear_screen(&g->dev, false);
+    _ssd1306_text(&g->dev, 0, buf_time, strlen(buf_time), false);
+    sensors_format_env(&g->r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+    _ssd1306_text(&g->dev, 2, buf_t, strlen(buf_t), false);
+    _ssd1306_text(&g->dev, 3, buf_p, strlen(buf_p), false);
+    mirror_rules_update(&g->rules, &g->r, 0);
+    if (!g->banner[6]) {
+        sensors_format_lux(&g->r, buf_l, sizeof(buf_l));
+        _ssd1306_text(&g->dev, 6, buf_l, strlen(buf_l), false);
+    }
+    for (int line = 0; line < 8; line++) {
+        if (g->banner[line]) {
+            _ssd1306_text(&g->dev, line, g->banner[line], strlen(g->banner[line]), true);
+        }
+    }
+    display_pacer_present(&g->pacer);
+}
+
+/**
+ * @brief Display RAM holds exactly what the driver believes it sent
+ */
+static bool oled_matches_shadow(void)
+{
+    rig_t *g = &s_rig;
+    for (int page = 0; page < g->dev._pages; page++) {
+        if (memcmp(g->oled.ram[page], g->dev._page[page]._segs, 128) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool near(float a, float b, float tol)
+{
+    return fabsf(a - b) <= tol;
+}
+
+/* ------------------------------------------------------------------------------------------------ drivers */
+
+static void check_drivers(void)
+{
+    printf("drivers\n");
+    rig_t *g = &s_rig;
+    rig_up(400000);
+
+    float t = 0, p = 0, h = 0;
+    check(bme280_init(g->sensors.bme_dev) == ESP_OK, "bme280_init succeeds");
+    check(g->bme.regs[0xF4] == 0x27, "bme280 left in normal mode, x1 oversampling");
+    check(bme280_read_float_data(g->sensors.bme_dev, &t, &p, &h) == ESP_OK, "bme280 read succeeds");
+    check(near(t, 25.08f, 0.001f), "bme280 datasheet example gives 25.08 C");
+    i2c_mock_bme280_set_raw(&g->bme, i2c_mock_bme280_raw_for_temp(&g->bme, -1234), 415148, 32768);
+    check(bme280_read_float_data(g->sensors.bme_dev, &t, &p, &h) == ESP_OK && near(t, -12.34f, 0.011f),
+          "bme280 negative temperature");
+
+    i2c_mock_fault_t nack = { .addr = CHECK_BME_ADDR, .count = 1, .err = ESP_FAIL };
+    i2c_mock_inject(CHECK_PORT, &nack);
+    float before = t;
+    check(bme280_read_float_data(g->sensors.bme_dev, &t, &p, &h) == ESP_FAIL, "bme280 read reports NACK");
+    check(t == before, "bme280 leaves the outputs alone on error");
+    i2c_mock_clear_faults();
+
+    check(bh1750_start(g->sensors.bh_dev) == ESP_OK, "bh1750_start succeeds");
+    check(g->bh.powered && g->bh.mode == 0x10, "bh1750 powered in continuous H-resolution mode");
+    uint8_t d[2];
+    i2c_bus_read_bytes(g->sensors.bh_dev, NULL_I2C_MEM_ADDR, 2, d);
+    check(d[0] == 0 && d[1] == 0, "bh1750 reads 0 before the first conversion completes");
+    vTaskDelay(pdMS_TO_TICKS(130));
+    i2c_bus_read_bytes(g->sensors.bh_dev, NULL_I2C_MEM_ADDR, 2, d);
+    check(((d[0] << 8) | d[1]) == 300, "bh1750 reads 300 counts at 250 lx");
+
+    ssd1306_init(&g->dev, 128, 64);
+    check(g->oled.display_on && g->oled.charge_pump, "ssd1306 on with charge pump");
+    check(g->oled.mux == 63 && g->oled.seg_remap && g->oled.com_remap, "ssd1306 128x64 scan configuration");
+    check(g->oled.addr_mode == 2 && !g->oled.scrolling, "ssd1306 page addressing, no scroll");
+    check(g->oled.unknown_commands == 0, "ssd1306 accepts every init command");
+    check(g->oled.contrast == 0xFF, "ssd1306 contrast");
+    ssd1306_clear_screen(&g->dev, false);
+    ssd1306_display_text(&g->dev, 2, "Hello", 5, false);
+    ssd1306_display_text(&g->dev, 7, "inv", 3, true);
+    check(oled_matches_shadow(), "ssd1306 RAM matches the driver buffer after text");
+    check(g->oled.ram[2][0] == 0x7F && g->oled.ram[2][5 * 8] == 0, "ssd1306 'Hello' drawn in page 2 only");
+    ssd1306_contrast(&g->dev, 0x20);
+    check(g->oled.contrast == 0x20, "ssd1306 contrast change");
+
+    rig_down();
+}
+
+/* ------------------------------------------------------------------------------------------------ loop */
+
+static void check_loop(void)
+{
+    printf("loop\n");
+    rig_t *g = &s_rig;
+    i2c_bus_device_stats_t st;
+    char buf_t[20], buf_p[30], buf_l[20];
+
+    rig_up(400000);
+    check(bme280_init(g->sensors.bme_dev) == ESP_OK && bh1750_start(g->sensors.bh_dev) == ESP_OK, "bind");
+    g->sensors.bme_ready = g->sensors.bh_ready = true;
+    rig_app_up();
+
+    sensors_format_env(&g->r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+    sensors_format_lux(&g->r, buf_l, sizeof(buf_l));
+    check(strcmp(buf_t, "T:-- H:--") == 0 && strcmp(buf_p, "P:-- hPa") == 0 && strcmp(buf_l, "Lux: --") == 0,
+          "no reading yet shows --");
+
+    for (int i = 0; i < 3; i++) {
+        rig_loop();
+    }
+    sensors_format_env(&g->r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+    sensors_format_lux(&g->r, buf_l, sizeof(buf_l));
+    check(strcmp(buf_t, "T:25.1C H:45%") == 0, "temperature line");
+    check(strcmp(buf_p, "P:1013.2 hPa") == 0, "pressure line");
+    check(strcmp(buf_l, "Lux: 250.0") == 0, "lux line");
+    check(oled_matches_shadow(), "display RAM matches after a frame");
+
+    /* NACK: stale value kept and marked, the sensor is configured again on the next pass */
+    i2c_mock_fault_t nack = { .addr = CHECK_BME_ADDR, .count = 1, .err = ESP_FAIL };
+    i2c_mock_inject(CHECK_PORT, &nack);
+    i2c_mock_bme280_set_raw(&g->bme, i2c_mock_bme280_raw_for_temp(&g->bme, 2000), 415148, 32768);
+    rig_loop();
+    sensors_format_env(&g->r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+    check(g->r.env_stale && strcmp(buf_t, "T:25.1C H:45%?") == 0, "NACK keeps the old value with '?'");
+    check(!g->sensors.bme_ready, "NACK drops bme_ready");
+    rig_loop();
+    check(!g->r.env_stale && near(g->r.temp, 20.0f, 0.011f), "next pass reads the new value");
+    check(g->sensors.bme_ready, "bme280 configured again");
+    i2c_mock_clear_faults();
+
+    /* Alarm banner of the default rules: above LUX_ALARM_LEVEL, only on a fresh reading */
+    g->bh.lux = LUX_ALARM_LEVEL + 100.0f;
+    rig_loop();
+    check(g->banner[5] && strcmp(g->banner[5], "JASNO - GRA!") == 0, "alarm banner above the alarm level");
+    check(oled_matches_shadow() && g->oled.ram[5][0] != 0, "banner drawn inverted on the panel");
+    i2c_mock_fault_t bh_nack = { .addr = CHECK_BH_ADDR, .err = ESP_FAIL };
+    i2c_mock_inject(CHECK_PORT, &bh_nack);
+    rig_loop();
+    check(g->r.lux_stale && near(g->r.lux, LUX_ALARM_LEVEL + 100.0f, 0.1f) && !g->banner[5],
+          "stale lux ends the alarm banner");
+
+    /* Unplugged: recovery after 3, 6, 12 ... consecutive failures, not on every poll */
+    i2c_bus_device_get_stats(g->sensors.bh_dev, &st);
+    uint32_t recoveries_before = st.bus_recoveries;
+    for (int i = 0; i < 12; i++) {
+        rig_loop();
+    }
+    i2c_bus_device_get_stats(g->sensors.bh_dev, &st);
+    check(st.consecutive_errors == 13, "bh1750 failures counted (one read, then one start per pass)");
+    check(st.bus_recoveries - recoveries_before == 3, "3 recoveries for 13 NACKs (at 3, 6 and 12)");
+    check(st.nack == st.consecutive_errors && st.bus_stuck == 0, "failures classified as NACK");
+    i2c_mock_clear_faults();
+    g->bh.lux = 100.0f;
+    rig_loop();
+    vTaskDelay(pdMS_TO_TICKS(200));
+    rig_loop();
+    check(!g->r.lux_stale && near(g->r.lux, 100.0f, 0.5f), "bh1750 back after replug");
+
+    /* SDA held low by the BME280 for 5 clocks: recovered on the spot */
+    i2c_bus_device_reset_stats(g->sensors.bme_dev);
+    i2c_mock_fault_t stuck = { .addr = CHECK_BME_ADDR, .count = 1, .hold_sda_clocks = 5 };
+    i2c_mock_inject(CHECK_PORT, &stuck);
+    rig_loop();
+    i2c_bus_device_get_stats(g->sensors.bme_dev, &st);
+    check(st.bus_stuck == 1, "held SDA classified as bus stuck");
+    check(!i2c_mock_sda_held(CHECK_PORT), "line recovery clocked the device free");
+    check(g->r.lux_stale == false, "bh1750 read right after the recovery succeeds");
+    rig_loop();
+    check(!g->r.env_stale, "bme280 back on the next pass");
+    check(oled_matches_shadow(), "display RAM matches after the recovery");
+    i2c_mock_clear_faults();
+
+    /* SDA never released: everything fails, nothing crashes, the loop keeps its pace */
+    i2c_mock_fault_t dead = { .addr = CHECK_BME_ADDR, .count = 1, .hold_sda_clocks = I2C_MOCK_SDA_NEVER_RELEASED };
+    i2c_mock_inject(CHECK_PORT, &dead);
+    int64_t t0 = esp_timer_get_time();
+    rig_loop();
+    int64_t loop_us = esp_timer_get_time() - t0;
+    check(g->r.env_stale && g->r.lux_stale, "all readings stale with SDA stuck");
+    printf("    loop with SDA stuck: %.1f ms (nominal %d ms)\n", loop_us / 1000.0, CHECK_LOOP_MS);
+
+    rig_down();
+}
+
+/* ------------------------------------------------------------------------------------------------ fuzz */
+
+static uint32_t s_rng;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void check_fuzz(uint32_t seed)
+{
+    printf("fuzz, seed %" PRIu32 ", %d rounds\n", seed, FUZZ_ROUNDS);
+    static const esp_err_t errs[] = { ESP_FAIL, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_STATE, ESP_OK };
+    static const uint8_t addrs[] = { CHECK_BME_ADDR, CHECK_BH_ADDR, CHECK_OLED_ADDR, I2C_MOCK_ANY_ADDR };
+    rig_t *g = &s_rig;
+    int fail_before = s_failures;
+    int stale_rounds = 0;
+    s_rng = seed ? seed : 1;
+
+    rig_up(400000);
+    bme280_init(g->sensors.bme_dev);
+    bh1750_start(g->sensors.bh_dev);
+    g->sensors.bme_ready = g->sensors.bh_ready = true;
+    rig_app_up();
+
+    for (int round = 0; round < FUZZ_ROUNDS && s_failures - fail_before < 10; round++) {
+        bool faulty = rnd() % 4 == 0;
+        if (faulty) {
+            i2c_mock_fault_t f = {
+                .addr = addrs[rnd() % 4],
+                .skip = rnd() % 4,
+                .count = 1 + rnd() % 3,
+                .err = errs[rnd() % 4],
+                .delay_us = rnd() % 3 == 0 ? rnd() % 20000 : 0,
+                .hold_sda_clocks = rnd() % 8 == 0 ? 1 + rnd() % 9 : 0,
+            };
+            i2c_mock_inject(CHECK_PORT, &f);
+        }
+        i2c_mock_bme280_set_raw(&g->bme, rnd() & 0xFFFFF, rnd() & 0xFFFFF, rnd() & 0xFFFF);
+        g->bh.lux = (float)(rnd() % 100000) / 10.0f;
+
+        readings_t prev = g->r;
+        sensors_poll(&g->sensors, &g->r);
+        float expected = i2c_mock_bme280_expected_temp(&g->bme) / 100.0f;
+        if (!g->r.env_stale) {
+            check(near(g->r.temp, expected, 0.001f), "fresh temperature equals the model value");
+        } else {
+            check(g->r.temp == prev.temp && g->r.env_valid == prev.env_valid, "stale temperature unchanged");
+        }
+        if (g->r.lux_stale) {
+            check(g->r.lux == prev.lux, "stale lux unchanged");
+        }
+        mirror_rules_update(&g->rules, &g->r, 0);
+        check(!g->banner[5] || (!g->r.lux_stale && g->r.lux > LUX_ALARM_LEVEL - 50), "alarm banner only on fresh lux");
+        stale_rounds += g->r.env_stale || g->r.lux_stale;
+
+        char text[17];
+        int len = 1 + rnd() % 16;
+        for (int i = 0; i < len; i++) {
+            text[i] = (char)(rnd() & 0x7F);
+        }
+        int page = rnd() % 8;
+        uint32_t log_before = i2c_mock_log_total();
+        ssd1306_display_text(&g->dev, page, text, len, rnd() & 1);
+        bool display_ok = true;
+        for (uint32_t i = log_before; i < i2c_mock_log_total(); i++) {
+            const i2c_mock_txn_t *t = i2c_mock_log_get(i2c_mock_log_count() - (i2c_mock_log_total() - i));
+            display_ok &= t && t->err == ESP_OK;
+        }
+        if (display_ok) {
+            check(memcmp(g->oled.ram[page], g->dev._page[page]._segs, len * 8) == 0, "text reaches display RAM");
+        }
+        check(i2c_mock_cmd_links_alive() == 0, "no command link leaked");
+
+        if (faulty && rnd() % 2) {
+            /* liveness: once the faults are gone the loop is back within two passes */
+            i2c_mock_clear_faults();
+            vTaskDelay(pdMS_TO_TICKS(CHECK_LOOP_MS));
+            sensors_poll(&g->sensors, &g->r);
+            vTaskDelay(pdMS_TO_TICKS(CHECK_LOOP_MS));
+            sensors_poll(&g->sensors, &g->r);
+            check(!g->r.env_stale && !g->r.lux_stale, "fresh readings two passes after the faults are cleared");
+            check(!i2c_mock_sda_held(CHECK_PORT), "bus free two passes after the faults are cleared");
+        }
+        vTaskDelay(pdMS_TO_TICKS(CHECK_LOOP_MS));
+    }
+    printf("    %d rounds with a stale reading, %" PRIu32 " transactions\n", stale_rounds, i2c_mock_log_total());
+    rig_down();
+    i2c_mock_clear_faults();
+}
+
+/* ------------------------------------------------------------------------------------------------ profile */
+
+static void profile_at(uint32_t clk_speed)
+{
+    rig_t *g = &s_rig;
+    i2c_bus_device_stats_t bme_st, bh_st;
+    const int loops = 50;
+
+    rig_up(clk_speed);
+    bme280_init(g->sensors.bme_dev);
+    bh1750_start(g->sensors.bh_dev);
+    g->sensors.bme_ready = g->sensors.bh_ready = true;
+    rig_app_up();
+    rig_loop(); /* the first frame is sent in full */
+    i2c_bus_device_reset_stats(g->sensors.bme_dev);
+    i2c_bus_device_reset_stats(g->sensors.bh_dev);
+
+    uint64_t busy0 = i2c_mock_busy_us(CHECK_PORT);
+    uint32_t txn0 = i2c_mock_log_total();
+    clock_t cpu0 = clock();
+    for (int i = 0; i < loops; i++) {
+        rig_loop();
+    }
+    double cpu_us = (double)(clock() - cpu0) * 1e6 / CLOCKS_PER_SEC / loops;
+    double busy = (double)(i2c_mock_busy_us(CHECK_PORT) - busy0) / loops;
+    double txns = (double)(i2c_mock_log_total() - txn0) / loops;
+
+    uint64_t sense0 = i2c_mock_busy_us(CHECK_PORT);
+    sensors_poll(&g->sensors, &g->r);
+    uint64_t sense = i2c_mock_busy_us(CHECK_PORT) - sense0;
+    uint64_t clear0 = i2c_mock_busy_us(CHECK_PORT);
+    uint32_t clear_txn0 = i2c_mock_log_total();
+    ssd1306_clear_screen(&g->dev, false);
+    uint64_t clear = i2c_mock_busy_us(CHECK_PORT) - clear0;
+    uint32_t clear_txn = i2c_mock_log_total() - clear_txn0;
+
+    i2c_bus_device_get_stats(g->sensors.bme_dev, &bme_st);
+    i2c_bus_device_get_stats(g->sensors.bh_dev, &bh_st);
+    printf("  %3" PRIu32 " kHz  loop: %6.0f us bus in %3.0f transactions (%4.1f%% of %d ms), host CPU %5.1f us\n",
+           clk_speed / 1000, busy, txns, busy / (CHECK_LOOP_MS * 10.0), CHECK_LOOP_MS, cpu_us);
+    printf("           sensors %5" PRIu64 " us, full frame %6" PRIu64 " us in %" PRIu32 " transactions\n",
+           sense, clear, clear_txn);
+    printf("           BME280 p50 %" PRIu32 " us max %" PRIu32 " us, BH1750 p50 %" PRIu32 " us max %" PRIu32 " us\n",
+           bme_st.latency_p50_us, bme_st.latency_max_us, bh_st.latency_p50_us, bh_st.latency_max_us);
+    rig_down();
+}
+
+static void check_profile(void)
+{
+    printf("profile (bus time from bit counts, START/STOP one SCL period each)\n");
+    profile_at(100000);
+    profile_at(400000);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seed = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 12345;
+
+    check_drivers();
+    check_loop();
+    check_fuzz(seed);
+    check_profile();
+
+    if (s_failures) {
+        printf("last transactions:\n");
+        i2c_mock_log_dump(stdout);
+    }
+    printf("%s\n", s_failures ? "FAILED" : "OK");
+    return s_failures ? 1 : 0;
+}
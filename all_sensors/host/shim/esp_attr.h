@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for esp_attr.h, placement attributes have no meaning on Linux.
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
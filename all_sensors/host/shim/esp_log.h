@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
+
+#define ESP_LOG_HOST(level, letter, tag, format, ...) do {                          \
+        if (level <= CONFIG_LOG_MAXIMUM_LEVEL) {                                    \
+            fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__);       \
+        }                                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_HOST(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_HOST(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_HOST(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_HOST(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_HOST(5, "V", tag, format, ##__VA_ARGS__)
@@ -0,0 +1,19 @@
+/*
+ * Host stand-in for esp_rom_crc.h.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief CRC-32 as zlib and Python's binascii.crc32 compute it, esp_rom_crc32_le(0, ...) starts one
+ */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
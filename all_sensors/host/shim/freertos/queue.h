@@ -0,0 +1,28 @@
+/*
+ * Host stand-in for freertos/queue.h. There is one task, so nothing arrives while a receive waits: a receive on an
+ * empty queue waits out its timeout on the host clock and fails, a send to a full queue fails at once.
+ */
+#pragma once
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_queue *QueueHandle_t;
+
+#define errQUEUE_FULL ((BaseType_t)0)
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize);
+void vQueueDelete(QueueHandle_t xQueue);
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+
+#define xQueueSendToBack xQueueSend
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Host stand-in for freertos/task.h. vTaskDelay advances the host clock instead of sleeping. There is one task: a
+ * notification given to it is kept until it takes it, a take without one waits out its timeout on the host clock.
+ * xTaskCreate fails, so components fall back to being driven from the caller.
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask);
+void vTaskDelay(const TickType_t xTicksToDelay);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Virtual time of the host build.
+ *
+ * esp_timer_get_time, esp_rom_delay_us and vTaskDelay all run on this clock, so results do not depend on the speed
+ * of the machine the host tools run on. Mocks advance it to account for time spent on a bus.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Move the clock forward
+ */
+void host_clock_advance_us(int64_t us);
+
+/**
+ * @brief Set the clock back to 0
+ */
+void host_clock_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Output levels of the host pads.
+ *
+ * gpio_set_level latches the level of every pad here, so mocks can sample pins they do not own (e.g. the D/C line of
+ * an SPI panel). Mocks that override gpio_set_level/gpio_get_level for their own lines call these for the others.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Record the level an output was set to
+ */
+void host_gpio_latch(gpio_num_t gpio_num, uint32_t level);
+
+/**
+ * @brief Last level set on a pad, 0 if never set
+ */
+int host_gpio_output(gpio_num_t gpio_num);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,29 @@
+/*
+ * Host build configuration.
+ *
+ * Mirrors the options the firmware is built with (see all_sensors/sdkconfig.defaults) for the subset of components
+ * compiled on Linux. Force-included into every host translation unit.
+ */
+#pragma once
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
+#define CONFIG_FREERTOS_HZ 100
+
+#define CONFIG_I2C_MS_TO_WAIT 200
+#define CONFIG_I2C_BUS_DYNAMIC_CONFIG 1
+#define CONFIG_I2C_BUS_BACKWARD_CONFIG 1
+#define CONFIG_I2C_BUS_SUPPORT_SOFTWARE 1
+#define CONFIG_I2C_BUS_SOFTWARE_MAX_PORT 2
+#define CONFIG_I2C_BUS_SOFTWARE_STRETCH_TIMEOUT_US 1000
+#define CONFIG_I2C_BUS_REMOVE_NULL_MEM_ADDR 0
+#define CONFIG_I2C_BUS_AUTO_RECOVERY 1
+#define CONFIG_I2C_BUS_AUTO_RECOVERY_THRESHOLD 3
+#define CONFIG_I2C_BUS_TRACE 1
+#define CONFIG_I2C_BUS_TRACE_RECORDS 8192
+
+#define CONFIG_I2C_INTERFACE 1
+#define CONFIG_SSD1306_128x64 1
+#define CONFIG_OFFSETX 0
+#define CONFIG_I2C_PORT_0 1
+#define CONFIG_SPI2_HOST 1
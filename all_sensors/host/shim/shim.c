@@ -0,0 +1,505 @@
+/*
+ * Minimal host implementations of the IDF services used by the components compiled on Linux.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+#include "nvs.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_rom_crc.h"
+#include "esp_rom_md5.h"
+#include "host_clock.h"
+#include "host_gpio.h"
+
+static int64_t s_host_time_us;
+static uint8_t s_gpio_level[GPIO_NUM_MAX];
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+/* Pads are modelled by the individual simulators, configuration always succeeds */
+esp_err_t gpio_config(const gpio_config_t *pGPIOConfig)
+{
+    return pGPIOConfig ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void host_gpio_latch(gpio_num_t gpio_num, uint32_t level)
+{
+    if (GPIO_IS_VALID_GPIO(gpio_num)) {
+        s_gpio_level[gpio_num] = level ? 1 : 0;
+    }
+}
+
+int host_gpio_output(gpio_num_t gpio_num)
+{
+    return GPIO_IS_VALID_GPIO(gpio_num) ? s_gpio_level[gpio_num] : 0;
+}
+
+__attribute__((weak)) esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    host_gpio_latch(gpio_num, level);
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+__attribute__((weak)) int gpio_get_level(gpio_num_t gpio_num)
+{
+    return host_gpio_output(gpio_num);
+}
+
+__attribute__((weak)) esp_err_t gpio_reset_pin(gpio_num_t gpio_num)
+{
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+__attribute__((weak)) esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)mode;
+    return GPIO_IS_VALID_GPIO(gpio_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/* Virtual clock shared by the shim, simulators and mocks advance it to model time spent on a bus */
+void host_clock_advance_us(int64_t us)
+{
+    if (us > 0) {
+        s_host_time_us += us;
+    }
+}
+
+void host_clock_reset(void)
+{
+    s_host_time_us = 0;
+}
+
+__attribute__((weak)) int64_t esp_timer_get_time(void)
+{
+    return s_host_time_us;
+}
+
+__attribute__((weak)) void esp_rom_delay_us(uint32_t us)
+{
+    host_clock_advance_us(us);
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay)
+{
+    host_clock_advance_us((int64_t)xTicksToDelay * portTICK_PERIOD_MS * 1000);
+}
+
+static uint32_t s_notify_count;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)&s_notify_count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify)
+{
+    s_notify_count++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    uint32_t count = s_notify_count;
+    if (count == 0) {
+        if (xTicksToWait != portMAX_DELAY) {
+            vTaskDelay(xTicksToWait);
+        }
+        return 0;
+    }
+    s_notify_count = xClearCountOnExit ? 0 : count - 1;
+    return count;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *const pcName, const uint32_t usStackDepth,
+                       void *const pvParameters, UBaseType_t uxPriority, TaskHandle_t *const pxCreatedTask)
+{
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete)
+{
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask)
+{
+    return 1;
+}
+
+struct host_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+    QueueHandle_t q = calloc(1, sizeof(struct host_queue) + (size_t)uxQueueLength * uxItemSize);
+    if (q) {
+        q->length = uxQueueLength;
+        q->item_size = uxItemSize;
+    }
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t xQueue)
+{
+    free(xQueue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+    if (xQueue->count == xQueue->length) {
+        return errQUEUE_FULL;
+    }
+    UBaseType_t tail = (xQueue->head + xQueue->count) % xQueue->length;
+    memcpy(&xQueue->items[tail * xQueue->item_size], pvItemToQueue, xQueue->item_size);
+    xQueue->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+    if (xQueue->count == 0) {
+        if (xTicksToWait != portMAX_DELAY) {
+            vTaskDelay(xTicksToWait);
+        }
+        return pdFALSE;
+    }
+    memcpy(pvBuffer, &xQueue->items[xQueue->head * xQueue->item_size], xQueue->item_size);
+    xQueue->head = (xQueue->head + 1) % xQueue->length;
+    xQueue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+    return xQueue->count;
+}
+
+struct host_event_group {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    return calloc(1, sizeof(struct host_event_group));
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup)
+{
+    free(xEventGroup);
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+    xEventGroup->bits |= uxBitsToSet;
+    return xEventGroup->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+    EventBits_t bits = xEventGroup->bits;
+    xEventGroup->bits &= ~uxBitsToClear;
+    return bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+    EventBits_t bits = xEventGroup->bits;
+    EventBits_t match = bits & uxBitsToWaitFor;
+    bool done = xWaitForAllBits ? match == uxBitsToWaitFor : match != 0;
+    if (!done) {
+        if (xTicksToWait != portMAX_DELAY) {
+            vTaskDelay(xTicksToWait);
+        }
+        return bits;
+    }
+    if (xClearOnExit) {
+        xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+    return bits;
+}
+
+/* NVS: one table of keys for all namespaces, a handle is the index of its namespace plus one */
+#define HOST_NVS_NAMESPACES 8
+#define HOST_NVS_KEYS 16
+#define HOST_NVS_NAME_LEN 16 // NVS_KEY_NAME_MAX_SIZE
+
+typedef struct {
+    char name[HOST_NVS_NAME_LEN];
+} host_nvs_namespace_t;
+
+typedef struct {
+    uint32_t ns; // Handle, 0 free
+    char key[HOST_NVS_NAME_LEN];
+    size_t len;
+    uint8_t *value;
+} host_nvs_entry_t;
+
+static host_nvs_namespace_t s_nvs_namespaces[HOST_NVS_NAMESPACES];
+static host_nvs_entry_t s_nvs_entries[HOST_NVS_KEYS];
+static uint32_t s_nvs_writable; // Bit per handle opened read-write
+
+void host_nvs_erase_all(void)
+{
+    for (int i = 0; i < HOST_NVS_KEYS; i++) {
+        free(s_nvs_entries[i].value);
+    }
+    memset(s_nvs_entries, 0, sizeof(s_nvs_entries));
+    memset(s_nvs_namespaces, 0, sizeof(s_nvs_namespaces));
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (strlen(namespace_name) >= HOST_NVS_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int free_slot = -1;
+    for (int i = 0; i < HOST_NVS_NAMESPACES; i++) {
+        if (strcmp(s_nvs_namespaces[i].name, namespace_name) == 0) {
+            free_slot = i;
+            break;
+        }
+        if (free_slot < 0 && s_nvs_namespaces[i].name[0] == '\0') {
+            free_slot = i;
+        }
+    }
+    if (free_slot < 0) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (strcmp(s_nvs_namespaces[free_slot].name, namespace_name) != 0) {
+        if (open_mode == NVS_READONLY) {
+            return ESP_ERR_NVS_NOT_FOUND; // As on the chip: a namespace is created by the first read-write open
+        }
+        strcpy(s_nvs_namespaces[free_slot].name, namespace_name);
+    }
+    *out_handle = free_slot + 1;
+    if (open_mode == NVS_READWRITE) {
+        s_nvs_writable |= 1u << free_slot;
+    } else {
+        s_nvs_writable &= ~(1u << free_slot);
+    }
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return handle >= 1 && handle <= HOST_NVS_NAMESPACES ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+static host_nvs_entry_t *nvs_find(nvs_handle_t handle, const char *key)
+{
+    for (int i = 0; i < HOST_NVS_KEYS; i++) {
+        if (s_nvs_entries[i].ns == handle && strcmp(s_nvs_entries[i].key, key) == 0) {
+            return &s_nvs_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t nvs_check_write(nvs_handle_t handle, const char *key)
+{
+    if (handle < 1 || handle > HOST_NVS_NAMESPACES) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (!(s_nvs_writable & 1u << (handle - 1))) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    return strlen(key) < HOST_NVS_NAME_LEN ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    esp_err_t ret = nvs_check_write(handle, key);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    host_nvs_entry_t *e = nvs_find(handle, key);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(e->value);
+    memset(e, 0, sizeof(*e));
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    esp_err_t ret = nvs_check_write(handle, key);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    host_nvs_entry_t *e = nvs_find(handle, key);
+    if (e == NULL) {
+        e = nvs_find(0, "");
+        if (e == NULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+    }
+    uint8_t *copy = malloc(length ? length : 1);
+    if (copy == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(copy, value, length);
+    free(e->value);
+    e->ns = handle;
+    strcpy(e->key, key);
+    e->len = length;
+    e->value = copy;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    host_nvs_entry_t *e = handle ? nvs_find(handle, key) : NULL;
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        *length = e->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, e->value, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+/* Checksums the ROM has on the chip */
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+#define MD5_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void md5_block(uint32_t state[4], const uint8_t block[64])
+{
+    static const uint32_t k[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+    };
+    static const uint8_t r[16] = { 7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21 };
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = block[i * 4] | block[i * 4 + 1] << 8 | block[i * 4 + 2] << 16 | (uint32_t)block[i * 4 + 3] << 24;
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        b += MD5_ROTL(a + f + k[i] + m[g], r[i / 16 * 4 + i % 4]);
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void esp_rom_md5_init(md5_context_t *context)
+{
+    context->buf[0] = 0x67452301;
+    context->buf[1] = 0xefcdab89;
+    context->buf[2] = 0x98badcfe;
+    context->buf[3] = 0x10325476;
+    context->bits[0] = context->bits[1] = 0;
+}
+
+void esp_rom_md5_update(md5_context_t *context, const void *buf, uint32_t len)
+{
+    const uint8_t *p = buf;
+    uint32_t used = (context->bits[0] >> 3) & 63;
+    uint32_t bits = context->bits[0] + (len << 3);
+    context->bits[1] += (bits < context->bits[0]) + (len >> 29);
+    context->bits[0] = bits;
+    while (len--) {
+        context->in[used++] = *p++;
+        if (used == 64) {
+            md5_block(context->buf, context->in);
+            used = 0;
+        }
+    }
+}
+
+void esp_rom_md5_final(uint8_t *digest, md5_context_t *context)
+{
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++) {
+        length[i] = context->bits[i / 4] >> (i % 4 * 8);
+    }
+    static const uint8_t pad[64] = { 0x80 };
+    uint32_t used = (context->bits[0] >> 3) & 63;
+    esp_rom_md5_update(context, pad, used < 56 ? 56 - used : 120 - used);
+    esp_rom_md5_update(context, length, 8);
+    for (int i = 0; i < 16; i++) {
+        digest[i] = context->buf[i / 4] >> (i % 4 * 8);
+    }
+}
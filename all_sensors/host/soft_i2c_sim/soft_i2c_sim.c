@@ -0,0 +1,494 @@
+/*
+ * Host protocol simulator for the software I2C master (components/i2c_bus/i2c_bus_soft.c).
+ *
+ * The real i2c_bus_soft.c is compiled against soft_i2c_sim_port.h. SCL and SDA are modelled as wired-AND open-drain
+ * lines shared by the master and a register based slave (auto-increment register pointer, like BME280), which can
+ * optionally stretch the clock after every ACK. Every line change is timestamped on a virtual CPU cycle counter,
+ * the waveform is checked against the I2C timing rules of the selected mode and the effective bit rate is reported
+ * for each CPU frequency / SCL frequency combination.
+ *
+ * Cost model: a GPIO register write takes 1 APB cycle and a read 4 APB cycles (APB = 80 MHz on ESP32), reading the
+ * CPU cycle counter takes 1 CPU cycle.
+ *
+ * Exit status is non-zero if any transfer returns unexpected data or the waveform breaks a timing rule.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "i2c_bus_soft.h"
+#include "soft_i2c_sim_port.h"
+
+#define SIM_SCL_IO          22
+#define SIM_SDA_IO          21
+#define SIM_SLAVE_ADDR      0x76
+#define SIM_ABSENT_ADDR     0x50
+#define SIM_APB_MHZ         80
+#define SIM_BURST_LEN       32
+#define SIM_REG_START       0x10
+
+/* ------------------------------------------------------------------------------------------------ line model */
+
+typedef struct {
+    uint32_t cpu_mhz;
+    uint32_t cycles;                /* virtual CPU cycle counter */
+    uint32_t write_cost;
+    uint32_t read_cost;
+
+    uint32_t master_scl;            /* 1 = released */
+    uint32_t master_sda;
+    uint32_t slave_scl;
+    uint32_t slave_sda;
+    uint32_t slave_scl_release_at;
+    uint32_t stuck_sda;             /* 1 = a faulty device holds SDA low */
+
+    uint32_t scl;                   /* resolved line levels */
+    uint32_t sda;
+} sim_bus_t;
+
+static sim_bus_t s_bus;
+
+/* ------------------------------------------------------------------------------------------------ slave model */
+
+typedef enum {
+    SLAVE_IDLE,
+    SLAVE_ADDR,
+    SLAVE_ADDR_ACK,
+    SLAVE_RX,
+    SLAVE_RX_ACK,
+    SLAVE_TX,
+    SLAVE_TX_ACK,
+} slave_state_t;
+
+typedef struct {
+    slave_state_t state;
+    uint8_t shift;
+    uint8_t tx_byte;
+    int bit_cnt;
+    bool is_read;
+    bool ptr_pending;               /* next written byte is the register pointer */
+    bool master_nack;
+    uint8_t ptr;
+    uint8_t regs[256];
+    uint32_t stretch_cycles;        /* hold SCL low this long after every ACK clock */
+} sim_slave_t;
+
+static sim_slave_t s_slave;
+
+/* ------------------------------------------------------------------------------------------------ waveform checker */
+
+typedef struct {
+    const char *mode;
+    double t_low_us;
+    double t_high_us;
+    double t_su_dat_us;
+    double t_hd_sta_us;
+    double t_su_sta_us;
+    double t_su_sto_us;
+    double t_buf_us;
+} i2c_timing_t;
+
+static const i2c_timing_t s_standard = {"standard", 4.7, 4.0, 0.25, 4.0, 4.7, 4.0, 4.7};
+static const i2c_timing_t s_fast = {"fast", 1.3, 0.6, 0.1, 0.6, 0.6, 0.6, 1.3};
+static const i2c_timing_t s_fast_plus = {"fast+", 0.5, 0.26, 0.05, 0.26, 0.26, 0.26, 0.5};
+
+typedef struct {
+    bool enabled;
+    const i2c_timing_t *timing;
+    bool have_fall;
+    bool have_rise;
+    bool in_transfer;
+    bool after_start;               /* next SCL fall closes tHD;STA */
+    bool seen_stop;
+    uint32_t last_fall;
+    uint32_t last_rise;
+    uint32_t last_sda_edge;
+    uint32_t last_start;
+    uint32_t last_stop;
+    int pulses;                     /* SCL pulses since the last (repeated) START */
+    uint32_t scl_pulses;
+    uint32_t violations;
+} sim_checker_t;
+
+static sim_checker_t s_check;
+
+static double sim_us(uint32_t cycles)
+{
+    return (double)cycles / s_bus.cpu_mhz;
+}
+
+static void sim_violation(const char *what, double got, double min)
+{
+    if (s_check.violations < 8) {
+        printf("    VIOLATION %s: %.3f < %.3f (t=%.3f us)\n", what, got, min, sim_us(s_bus.cycles));
+    }
+    s_check.violations++;
+}
+
+static void sim_check_min(const char *what, uint32_t cycles, double min_us)
+{
+    if (s_check.enabled && sim_us(cycles) < min_us) {
+        sim_violation(what, sim_us(cycles), min_us);
+    }
+}
+
+static void sim_check_frame(const char *what)
+{
+    /* Every byte is 8 data clocks plus one ACK clock */
+    if (s_check.enabled && s_check.in_transfer && s_check.pulses % 9 != 0) {
+        sim_violation(what, s_check.pulses, 9 * (s_check.pulses / 9 + 1));
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------ slave FSM */
+
+static void slave_stretch(void)
+{
+    if (s_slave.stretch_cycles) {
+        s_bus.slave_scl = 0;
+        s_bus.slave_scl_release_at = s_bus.cycles + s_slave.stretch_cycles;
+    }
+}
+
+static void slave_load_tx(void)
+{
+    s_slave.tx_byte = s_slave.regs[s_slave.ptr++];
+    s_slave.bit_cnt = 0;
+    s_bus.slave_sda = (s_slave.tx_byte >> 7) & 1;
+    s_slave.state = SLAVE_TX;
+}
+
+static void sim_on_sda_edge(uint32_t sda)
+{
+    uint32_t now = s_bus.cycles;
+    if (!s_bus.scl) {
+        s_check.last_sda_edge = now;
+        return;
+    }
+
+    if (!sda) {
+        /* START or repeated START */
+        if (s_check.in_transfer) {
+            sim_check_frame("frame length before repeated START (pulses)");
+            sim_check_min("tSU;STA", now - s_check.last_rise, s_check.timing->t_su_sta_us);
+        } else if (s_check.seen_stop) {
+            sim_check_min("tBUF", now - s_check.last_stop, s_check.timing->t_buf_us);
+        }
+        s_check.in_transfer = true;
+        s_check.after_start = true;
+        s_check.last_start = now;
+        s_check.pulses = 0;
+
+        s_slave.state = SLAVE_ADDR;
+        s_slave.bit_cnt = 0;
+        s_slave.shift = 0;
+        s_bus.slave_sda = 1;
+    } else {
+        /* STOP */
+        sim_check_frame("frame length before STOP (pulses)");
+        if (s_check.have_rise) {
+            sim_check_min("tSU;STO", now - s_check.last_rise, s_check.timing->t_su_sto_us);
+        }
+        s_check.in_transfer = false;
+        s_check.seen_stop = true;
+        s_check.last_stop = now;
+
+        s_slave.state = SLAVE_IDLE;
+        s_bus.slave_sda = 1;
+    }
+}
+
+static void sim_on_scl_edge(uint32_t scl)
+{
+    uint32_t now = s_bus.cycles;
+    if (scl) {
+        if (s_check.have_fall && s_check.in_transfer) {
+            sim_check_min("tLOW", now - s_check.last_fall, s_check.timing->t_low_us);
+            if ((int32_t)(s_check.last_sda_edge - s_check.last_fall) >= 0) {
+                sim_check_min("tSU;DAT", now - s_check.last_sda_edge, s_check.timing->t_su_dat_us);
+            }
+        }
+        s_check.have_rise = true;
+        s_check.last_rise = now;
+
+        switch (s_slave.state) {
+        case SLAVE_ADDR:
+        case SLAVE_RX:
+            s_slave.shift = (s_slave.shift << 1) | (s_bus.sda & 1);
+            s_slave.bit_cnt++;
+            break;
+        case SLAVE_TX_ACK:
+            s_slave.master_nack = s_bus.sda;
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+
+    if (s_check.have_rise && s_check.in_transfer) {
+        if (s_check.after_start) {
+            sim_check_min("tHD;STA", now - s_check.last_start, s_check.timing->t_hd_sta_us);
+        } else {
+            sim_check_min("tHIGH", now - s_check.last_rise, s_check.timing->t_high_us);
+        }
+    }
+    /* A pulse is counted on its falling edge, the SCL rise before STOP / repeated START is not a clock */
+    if (s_check.in_transfer && !s_check.after_start) {
+        s_check.pulses++;
+        s_check.scl_pulses++;
+    }
+    s_check.after_start = false;
+    s_check.have_fall = true;
+    s_check.last_fall = now;
+
+    switch (s_slave.state) {
+    case SLAVE_ADDR:
+        if (s_slave.bit_cnt == 8) {
+            if ((s_slave.shift >> 1) == SIM_SLAVE_ADDR) {
+                s_slave.is_read = s_slave.shift & 1;
+                s_bus.slave_sda = 0;
+                s_slave.state = SLAVE_ADDR_ACK;
+            } else {
+                s_slave.state = SLAVE_IDLE;
+            }
+        }
+        break;
+    case SLAVE_ADDR_ACK:
+        if (s_slave.is_read) {
+            slave_load_tx();
+        } else {
+            s_bus.slave_sda = 1;
+            s_slave.state = SLAVE_RX;
+            s_slave.bit_cnt = 0;
+            s_slave.shift = 0;
+            s_slave.ptr_pending = true;
+        }
+        slave_stretch();
+        break;
+    case SLAVE_RX:
+        if (s_slave.bit_cnt == 8) {
+            if (s_slave.ptr_pending) {
+                s_slave.ptr = s_slave.shift;
+                s_slave.ptr_pending = false;
+            } else {
+                s_slave.regs[s_slave.ptr++] = s_slave.shift;
+            }
+            s_bus.slave_sda = 0;
+            s_slave.state = SLAVE_RX_ACK;
+        }
+        break;
+    case SLAVE_RX_ACK:
+        s_bus.slave_sda = 1;
+        s_slave.state = SLAVE_RX;
+        s_slave.bit_cnt = 0;
+        s_slave.shift = 0;
+        slave_stretch();
+        break;
+    case SLAVE_TX:
+        s_slave.bit_cnt++;
+        if (s_slave.bit_cnt < 8) {
+            s_bus.slave_sda = (s_slave.tx_byte >> (7 - s_slave.bit_cnt)) & 1;
+        } else {
+            s_bus.slave_sda = 1;
+            s_slave.state = SLAVE_TX_ACK;
+        }
+        break;
+    case SLAVE_TX_ACK:
+        if (!s_slave.master_nack) {
+            slave_load_tx();
+            slave_stretch();
+        } else {
+            s_bus.slave_sda = 1;
+            s_slave.state = SLAVE_IDLE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void sim_update(void)
+{
+    if (!s_bus.slave_scl && (int32_t)(s_bus.cycles - s_bus.slave_scl_release_at) >= 0) {
+        s_bus.slave_scl = 1;
+    }
+    for (;;) {
+        uint32_t scl = s_bus.master_scl & s_bus.slave_scl;
+        uint32_t sda = s_bus.master_sda & s_bus.slave_sda & !s_bus.stuck_sda;
+        if (sda != s_bus.sda) {
+            s_bus.sda = sda;
+            sim_on_sda_edge(sda);
+        } else if (scl != s_bus.scl) {
+            s_bus.scl = scl;
+            sim_on_scl_edge(scl);
+        } else {
+            break;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------------------------------ port */
+
+uint32_t i2c_soft_ll_get_cycles(void)
+{
+    s_bus.cycles += 1;
+    sim_update();
+    return s_bus.cycles;
+}
+
+uint32_t i2c_soft_ll_cycles_per_us(void)
+{
+    return s_bus.cpu_mhz;
+}
+
+void i2c_soft_ll_set(gpio_num_t io, uint32_t level)
+{
+    s_bus.cycles += s_bus.write_cost;
+    if (io == SIM_SCL_IO) {
+        s_bus.master_scl = level ? 1 : 0;
+    } else {
+        s_bus.master_sda = level ? 1 : 0;
+    }
+    sim_update();
+}
+
+uint32_t i2c_soft_ll_get(gpio_num_t io)
+{
+    s_bus.cycles += s_bus.read_cost;
+    sim_update();
+    return io == SIM_SCL_IO ? s_bus.scl : s_bus.sda;
+}
+
+/* ------------------------------------------------------------------------------------------------ scenarios */
+
+static uint32_t s_failures;
+
+static void sim_reset(uint32_t cpu_mhz, uint32_t clk_speed)
+{
+    memset(&s_bus, 0, sizeof(s_bus));
+    s_bus.cpu_mhz = cpu_mhz;
+    s_bus.write_cost = cpu_mhz / SIM_APB_MHZ;
+    s_bus.read_cost = 4 * cpu_mhz / SIM_APB_MHZ;
+    s_bus.master_scl = s_bus.master_sda = 1;
+    s_bus.slave_scl = s_bus.slave_sda = 1;
+    s_bus.scl = s_bus.sda = 1;
+
+    memset(&s_slave, 0, sizeof(s_slave));
+
+    memset(&s_check, 0, sizeof(s_check));
+    s_check.enabled = true;
+    s_check.timing = clk_speed <= 100000 ? &s_standard : clk_speed <= 400000 ? &s_fast : &s_fast_plus;
+}
+
+static void sim_expect(bool cond, const char *what)
+{
+    if (!cond) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void sim_idle(uint32_t us)
+{
+    uint32_t end = s_bus.cycles + us * s_bus.cpu_mhz;
+    while ((int32_t)(end - s_bus.cycles) > 0) {
+        i2c_soft_ll_get_cycles();
+    }
+}
+
+static void sim_run(uint32_t cpu_mhz, uint32_t clk_speed)
+{
+    sim_reset(cpu_mhz, clk_speed);
+
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = SIM_SDA_IO,
+        .scl_io_num = SIM_SCL_IO,
+        .sda_pullup_en = true,
+        .scl_pullup_en = true,
+        .master.clk_speed = clk_speed,
+    };
+    i2c_master_soft_bus_handle_t bus = NULL;
+    sim_expect(i2c_new_master_soft_bus(&conf, &bus) == ESP_OK, "create soft bus");
+
+    uint8_t pattern[SIM_BURST_LEN];
+    uint8_t readback[SIM_BURST_LEN];
+    for (int i = 0; i < SIM_BURST_LEN; i++) {
+        pattern[i] = (uint8_t)(0xA5 ^ (i * 37));
+    }
+
+    /* Burst write: address + register + payload */
+    uint32_t pulses0 = s_check.scl_pulses;
+    uint32_t t0 = s_bus.cycles;
+    sim_expect(i2c_master_soft_bus_write_reg8(bus, SIM_SLAVE_ADDR, SIM_REG_START, SIM_BURST_LEN, pattern) == ESP_OK, "burst write");
+    uint32_t t_write = s_bus.cycles - t0;
+    uint32_t pulses_write = s_check.scl_pulses - pulses0;
+    sim_expect(memcmp(&s_slave.regs[SIM_REG_START], pattern, SIM_BURST_LEN) == 0, "slave registers match written burst");
+
+    /* Burst read: address + register, repeated START, address + payload */
+    memset(readback, 0, sizeof(readback));
+    t0 = s_bus.cycles;
+    sim_expect(i2c_master_soft_bus_read_reg8(bus, SIM_SLAVE_ADDR, SIM_REG_START, SIM_BURST_LEN, readback) == ESP_OK, "burst read");
+    uint32_t t_read = s_bus.cycles - t0;
+    sim_expect(memcmp(readback, pattern, SIM_BURST_LEN) == 0, "burst read returns written data");
+
+    /* Probe of an absent device is NACKed and leaves the bus released */
+    sim_expect(i2c_master_soft_bus_probe(bus, SIM_ABSENT_ADDR) == ESP_ERR_NOT_FOUND, "probe absent address is NACKed");
+    sim_expect(s_bus.scl && s_bus.sda, "bus released after NACK");
+    sim_expect(i2c_master_soft_bus_probe(bus, SIM_SLAVE_ADDR) == ESP_OK, "probe present address");
+
+    /* Clock stretching of 20us after every ACK */
+    s_slave.stretch_cycles = 20 * cpu_mhz;
+    memset(readback, 0, sizeof(readback));
+    t0 = s_bus.cycles;
+    sim_expect(i2c_master_soft_bus_read_reg8(bus, SIM_SLAVE_ADDR, SIM_REG_START, SIM_BURST_LEN, readback) == ESP_OK, "stretched burst read");
+    uint32_t t_stretch = s_bus.cycles - t0;
+    sim_expect(memcmp(readback, pattern, SIM_BURST_LEN) == 0, "stretched burst read returns written data");
+    uint32_t violations = s_check.violations;
+
+    /* Stretching past the timeout aborts the transfer */
+    s_check.enabled = false;
+    s_slave.stretch_cycles = 3 * CONFIG_I2C_BUS_SOFTWARE_STRETCH_TIMEOUT_US * cpu_mhz;
+    sim_expect(i2c_master_soft_bus_read_reg8(bus, SIM_SLAVE_ADDR, SIM_REG_START, 4, readback) == ESP_ERR_TIMEOUT, "stretch timeout");
+    s_slave.stretch_cycles = 0;
+    sim_idle(3 * CONFIG_I2C_BUS_SOFTWARE_STRETCH_TIMEOUT_US);
+
+    /* SDA held low by a device: START is refused */
+    s_bus.stuck_sda = 1;
+    sim_update();
+    sim_expect(i2c_master_soft_bus_probe(bus, SIM_SLAVE_ADDR) == ESP_ERR_INVALID_STATE, "start refused while SDA is held low");
+    s_bus.stuck_sda = 0;
+    sim_update();
+
+    i2c_del_master_soft_bus(bus);
+
+    uint32_t payload_bits = 8 * SIM_BURST_LEN;
+    printf("  %3" PRIu32 " MHz  %5" PRIu32 " kHz  %-9s  SCL %7.1f kHz  write %7.1f kbit/s  read %7.1f kbit/s  stretched read %7.1f kbit/s  violations %" PRIu32 "\n",
+           cpu_mhz, clk_speed / 1000, s_check.timing->mode,
+           pulses_write * 1000.0 / sim_us(t_write),
+           payload_bits * 1000.0 / sim_us(t_write),
+           payload_bits * 1000.0 / sim_us(t_read),
+           payload_bits * 1000.0 / sim_us(t_stretch),
+           violations);
+    if (violations) {
+        s_failures++;
+    }
+}
+
+int main(void)
+{
+    static const uint32_t cpu_mhz[] = {80, 160, 240};
+    static const uint32_t clk_speed[] = {100000, 400000, 1000000};
+
+    printf("soft I2C protocol simulation, %d byte bursts, effective rates count payload bits only\n", SIM_BURST_LEN);
+    for (size_t c = 0; c < sizeof(cpu_mhz) / sizeof(cpu_mhz[0]); c++) {
+        for (size_t f = 0; f < sizeof(clk_speed) / sizeof(clk_speed[0]); f++) {
+            sim_run(cpu_mhz[c], clk_speed[f]);
+        }
+    }
+
+    printf("%s\n", s_failures ? "FAILED" : "OK");
+    return s_failures ? 1 : 0;
+}
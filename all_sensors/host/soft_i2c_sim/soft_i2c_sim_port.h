@@ -0,0 +1,23 @@
+/*
+ * Line level port of the software I2C master for the host protocol simulator.
+ *
+ * Replaces the register based primitives of i2c_bus_soft_ll.h. Every call advances a virtual CPU cycle counter by
+ * the modelled cost of the access, so the waveform produced by i2c_bus_soft.c is timed as it would be on target.
+ */
+#pragma once
+
+#include <stdint.h>
+#include "driver/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t i2c_soft_ll_get_cycles(void);
+uint32_t i2c_soft_ll_cycles_per_us(void);
+void i2c_soft_ll_set(gpio_num_t io, uint32_t level);
+uint32_t i2c_soft_ll_get(gpio_num_t io);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,258 @@
+/*
+ * Host mock of the SPI master driver, see spi_bus_mock.h.
+ *
+ * Time is kept in nanoseconds per host so short transactions at high clocks do not round to zero; the host clock
+ * (microseconds) is only advanced for CPU time and for waits.
+ */
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "host_clock.h"
+#include "spi_bus_mock.h"
+
+#define SPI_MOCK_HOST_NUM 3
+
+static const char *TAG = "spi_bus_mock";
+
+#define SPI_MOCK_CHECK(a, str, ret) if(!(a)) { \
+        ESP_LOGE(TAG,"%s:%d (%s):%s", __FILE__, __LINE__, __FUNCTION__, str); \
+        return (ret); \
+    }
+
+typedef struct {
+    spi_transaction_t *trans;
+    int64_t done_ns;
+} spi_mock_pending_t;
+
+struct spi_device_t {
+    bool used;
+    spi_host_device_t host;
+    spi_device_interface_config_t conf;
+    spi_mock_pending_t pending[SPI_MOCK_MAX_QUEUE];                                                         /*!< Queued and not collected, oldest at head */
+    int head;
+    int count;
+    uint32_t last_dc;
+    spi_mock_stats_t stats;
+};
+
+typedef struct {
+    bool initialized;
+    int64_t free_ns;                                                                                        /*!< Time the last queued transaction ends */
+} spi_mock_host_t;
+
+typedef struct {
+    int cs_io;
+    int dc_io;
+    spi_mock_rx_t rx;
+    void *ctx;
+} spi_mock_receiver_t;
+
+static spi_mock_host_t s_hosts[SPI_MOCK_HOST_NUM];
+static struct spi_device_t s_devices[SPI_MOCK_MAX_DEVICES];
+static spi_mock_receiver_t s_receivers[SPI_MOCK_MAX_DEVICES];
+static int s_receiver_num;
+
+static int64_t spi_mock_now_ns(void)
+{
+    return esp_timer_get_time() * 1000;
+}
+
+/**
+ * @brief Advance the host clock to a time in ns, rounded up to the next microsecond
+ */
+static uint64_t spi_mock_wait_until(int64_t t_ns)
+{
+    int64_t now = spi_mock_now_ns();
+    if (t_ns <= now) {
+        return 0;
+    }
+    int64_t us = (t_ns - now + 999) / 1000;
+    host_clock_advance_us(us);
+    return (uint64_t)us;
+}
+
+static bool spi_mock_handle_valid(spi_device_handle_t handle)
+{
+    return handle >= s_devices && handle < s_devices + SPI_MOCK_MAX_DEVICES && handle->used;
+}
+
+void spi_mock_reset(void)
+{
+    memset(s_hosts, 0, sizeof(s_hosts));
+    memset(s_devices, 0, sizeof(s_devices));
+    memset(s_receivers, 0, sizeof(s_receivers));
+    s_receiver_num = 0;
+}
+
+esp_err_t spi_mock_attach(int cs_io, int dc_io, spi_mock_rx_t rx, void *ctx)
+{
+    SPI_MOCK_CHECK(rx != NULL, "receiver error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(s_receiver_num < SPI_MOCK_MAX_DEVICES, "too many receivers", ESP_ERR_NO_MEM);
+    s_receivers[s_receiver_num++] = (spi_mock_receiver_t) {
+        .cs_io = cs_io, .dc_io = dc_io, .rx = rx, .ctx = ctx,
+    };
+    return ESP_OK;
+}
+
+esp_err_t spi_mock_get_stats(spi_device_handle_t handle, spi_mock_stats_t *stats)
+{
+    SPI_MOCK_CHECK(spi_mock_handle_valid(handle) && stats != NULL, "handle error", ESP_ERR_INVALID_ARG);
+    *stats = handle->stats;
+    return ESP_OK;
+}
+
+/**************************************** Driver *********************************************/
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+    SPI_MOCK_CHECK(host_id > SPI1_HOST && host_id < SPI_MOCK_HOST_NUM, "invalid host", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(bus_config != NULL, "bus config error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(!s_hosts[host_id].initialized, "host already in use", ESP_ERR_INVALID_STATE);
+    s_hosts[host_id] = (spi_mock_host_t) {
+        .initialized = true,
+    };
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    SPI_MOCK_CHECK(host_id > SPI1_HOST && host_id < SPI_MOCK_HOST_NUM, "invalid host", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(s_hosts[host_id].initialized, "host not in use", ESP_ERR_INVALID_STATE);
+    for (int i = 0; i < SPI_MOCK_MAX_DEVICES; i++) {
+        SPI_MOCK_CHECK(!s_devices[i].used || s_devices[i].host != host_id, "devices still attached", ESP_ERR_INVALID_STATE);
+    }
+    s_hosts[host_id].initialized = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    SPI_MOCK_CHECK(host_id > SPI1_HOST && host_id < SPI_MOCK_HOST_NUM, "invalid host", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(s_hosts[host_id].initialized, "host not initialized", ESP_ERR_INVALID_STATE);
+    SPI_MOCK_CHECK(dev_config != NULL && handle != NULL, "device config error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(dev_config->clock_speed_hz > 0, "clock error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(dev_config->queue_size > 0 && dev_config->queue_size <= SPI_MOCK_MAX_QUEUE, "queue size error", ESP_ERR_INVALID_ARG);
+    for (int i = 0; i < SPI_MOCK_MAX_DEVICES; i++) {
+        struct spi_device_t *dev = &s_devices[i];
+        if (!dev->used) {
+            memset(dev, 0, sizeof(*dev));
+            dev->used = true;
+            dev->host = host_id;
+            dev->conf = *dev_config;
+            *handle = dev;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    SPI_MOCK_CHECK(spi_mock_handle_valid(handle), "handle error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(handle->count == 0, "transactions not collected", ESP_ERR_INVALID_STATE);
+    handle->used = false;
+    return ESP_OK;
+}
+
+/**
+ * @brief Put a transaction on the bus after the ones already queued and deliver its payload
+ */
+static void spi_mock_run(spi_device_handle_t handle, spi_transaction_t *trans, int64_t gap_ns, int64_t *done_ns)
+{
+    spi_mock_host_t *host = &s_hosts[handle->host];
+    int64_t now = spi_mock_now_ns();
+    int64_t start = (host->free_ns > now ? host->free_ns : now) + gap_ns;
+    int64_t bits = (int64_t)trans->length;
+    int64_t end = start + (bits * 1000000000LL + handle->conf.clock_speed_hz - 1) / handle->conf.clock_speed_hz;
+    host->free_ns = end;
+
+    if (handle->conf.pre_cb) {
+        handle->conf.pre_cb(trans);
+    }
+    for (int i = 0; i < s_receiver_num; i++) {
+        spi_mock_receiver_t *r = &s_receivers[i];
+        if (r->cs_io != handle->conf.spics_io_num) {
+            continue;
+        }
+        uint32_t dc = r->dc_io >= 0 ? (uint32_t)gpio_get_level(r->dc_io) : 0;
+        if (handle->stats.transactions && dc != handle->last_dc) {
+            handle->stats.dc_changes++;
+        }
+        handle->last_dc = dc;
+        if (trans->tx_buffer && trans->length) {
+            r->rx(r->ctx, dc, trans->tx_buffer, (trans->length + 7) / 8);
+        }
+    }
+    if (handle->conf.post_cb) {
+        handle->conf.post_cb(trans);
+    }
+
+    handle->stats.transactions++;
+    handle->stats.bytes += (trans->length + 7) / 8;
+    handle->stats.busy_us += (uint64_t)(end - start) / 1000;
+    *done_ns = end;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc, TickType_t ticks_to_wait)
+{
+    SPI_MOCK_CHECK(spi_mock_handle_valid(handle), "handle error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(trans_desc != NULL, "transaction error", ESP_ERR_INVALID_ARG);
+    if (handle->count == handle->conf.queue_size) {
+        /* The driver would block until the ISR takes a transaction, which never happens if the results are not collected */
+        ESP_LOGE(TAG, "queue full (%d transactions not collected)", handle->count);
+        host_clock_advance_us(ticks_to_wait == portMAX_DELAY ? 0 : (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000);
+        return ESP_ERR_TIMEOUT;
+    }
+    host_clock_advance_us(SPI_MOCK_QUEUE_US);
+    spi_mock_pending_t *p = &handle->pending[(handle->head + handle->count) % SPI_MOCK_MAX_QUEUE];
+    p->trans = trans_desc;
+    spi_mock_run(handle, trans_desc, SPI_MOCK_ISR_US * 1000, &p->done_ns);
+    handle->count++;
+    if ((uint32_t)handle->count > handle->stats.max_in_flight) {
+        handle->stats.max_in_flight = handle->count;
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc, TickType_t ticks_to_wait)
+{
+    SPI_MOCK_CHECK(spi_mock_handle_valid(handle), "handle error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(trans_desc != NULL, "transaction error", ESP_ERR_INVALID_ARG);
+    if (handle->count == 0) {
+        host_clock_advance_us(ticks_to_wait == portMAX_DELAY ? 0 : (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000);
+        return ESP_ERR_TIMEOUT;
+    }
+    spi_mock_pending_t *p = &handle->pending[handle->head];
+    handle->stats.wait_us += spi_mock_wait_until(p->done_ns);
+    host_clock_advance_us(SPI_MOCK_RESULT_US);
+    *trans_desc = p->trans;
+    handle->head = (handle->head + 1) % SPI_MOCK_MAX_QUEUE;
+    handle->count--;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    spi_transaction_t *done;
+    esp_err_t ret = spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    /* Like the driver: results come back in order, a queued transaction of the caller would be returned here */
+    ret = spi_device_get_trans_result(handle, &done, portMAX_DELAY);
+    SPI_MOCK_CHECK(ret != ESP_OK || done == trans_desc, "transmit with other transactions in flight", ESP_ERR_INVALID_STATE);
+    return ret;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    SPI_MOCK_CHECK(spi_mock_handle_valid(handle), "handle error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(trans_desc != NULL, "transaction error", ESP_ERR_INVALID_ARG);
+    SPI_MOCK_CHECK(handle->count == 0, "polling transmit with transactions in flight", ESP_ERR_INVALID_STATE);
+    int64_t done_ns;
+    spi_mock_run(handle, trans_desc, 0, &done_ns);
+    /* The CPU spins until the end, that time is not a wait the caller could use */
+    spi_mock_wait_until(done_ns);
+    return ESP_OK;
+}
@@ -0,0 +1,82 @@
+/*
+ * Host mock of the SPI master driver.
+ *
+ * Implements driver/spi_master.h with the timing of a DMA transfer engine on the host clock: queued transactions run
+ * back to back on the bus while the caller goes on, each one after a fixed hand-over time of the driver ISR, and
+ * spi_device_get_trans_result blocks (advances the clock) until the oldest one is done. The pre and post transfer
+ * callbacks run in order when a transaction starts, the D/C pad is sampled after the pre callback and the payload is
+ * passed to the receiver attached to the chip select pad.
+ *
+ * Single threaded. Transactions are processed when they are queued, so a D/C level set by hand while a queued
+ * transaction is still in flight is not detected.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_MOCK_MAX_DEVICES 4                                                                              /*!< Devices over all hosts */
+#define SPI_MOCK_MAX_QUEUE 64                                                                               /*!< Largest queue_size accepted */
+#define SPI_MOCK_QUEUE_US 3                                                                                 /*!< CPU time of spi_device_queue_trans */
+#define SPI_MOCK_RESULT_US 2                                                                                /*!< CPU time of spi_device_get_trans_result */
+#define SPI_MOCK_ISR_US 10                                                                                  /*!< Gap between queued transactions: ISR, pre callback, DMA set-up */
+
+/**
+ * @brief Receiver of the bytes clocked out to a device
+ *
+ * @param ctx Pointer given to spi_mock_attach
+ * @param dc Level of the D/C pad when the transaction started
+ * @param data Payload
+ * @param len Payload length in bytes
+ */
+typedef void (*spi_mock_rx_t)(void *ctx, uint32_t dc, const uint8_t *data, size_t len);
+
+/**
+ * @brief Counters of a device since it was added
+ */
+typedef struct {
+    uint32_t transactions;
+    uint64_t bytes;
+    uint64_t busy_us;                                                                                       /*!< Time the bus was clocking for the device */
+    uint64_t wait_us;                                                                                       /*!< Time the caller was blocked waiting for results */
+    uint32_t max_in_flight;                                                                                 /*!< Most transactions queued and not collected at once */
+    uint32_t dc_changes;                                                                                    /*!< Transactions with another D/C level than the previous one */
+} spi_mock_stats_t;
+
+/**
+ * @brief Free all hosts and devices and detach all receivers. Handles become invalid.
+ */
+void spi_mock_reset(void);
+
+/**
+ * @brief Connect a receiver to the device selected by a chip select pad
+ *
+ * @param cs_io Chip select pad the device is added with
+ * @param dc_io D/C pad sampled at the start of every transaction, -1 if none
+ * @param rx Receiver
+ * @param ctx Passed to rx
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_NO_MEM SPI_MOCK_MAX_DEVICES receivers attached
+ */
+esp_err_t spi_mock_attach(int cs_io, int dc_io, spi_mock_rx_t rx, void *ctx);
+
+/**
+ * @brief Counters of a device
+ *
+ * @return
+ *     - ESP_OK Success
+ *     - ESP_ERR_INVALID_ARG Unknown handle
+ */
+esp_err_t spi_mock_get_stats(spi_device_handle_t handle, spi_mock_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
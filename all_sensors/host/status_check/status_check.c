@@ -0,0 +1,257 @@
+/*
+ * Status endpoint documents (components/status_server/status_metrics.c):
+ *   - one-minute rollups: 5 min and 1 h windows over two simulated hours of samples, gaps and buckets an hour old
+ *   - the JSON document read back with the streaming parser of components/data_fetch, escapes included
+ *   - the Prometheus text: every sample under one TYPE line of its name, numbers that parse, unread sensors left out
+ *   - a buffer too small for the document: cut, terminated, and the needed length reported
+ * Exit status is non-zero if a check fails.
+ */
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_stream.h"
+#include "status_metrics.h"
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) < 1e-3f;
+}
+
+static void check_rollup(void)
+{
+    printf("  rollups\n");
+    static status_rollup_t r;
+    status_window_t w;
+
+    status_rollup_window(&r, 0, 300, &w);
+    check(w.count == 0, "empty before the first sample");
+
+    // One sample every 10 s for 2 hours, value = minute number
+    for (uint32_t t = 0; t < 7200; t += 10) {
+        status_rollup_add(&r, t, t / 60);
+    }
+    uint32_t now = 7199;
+    status_rollup_window(&r, now, 300, &w);
+    check(w.count == 30 && near(w.min, 115) && near(w.max, 119) && near(w.avg, 117), "5 min: minutes 115..119");
+    status_rollup_window(&r, now, 3600, &w);
+    check(w.count == 360 && near(w.min, 60) && near(w.max, 119) && near(w.avg, 89.5f), "1 h: minutes 60..119");
+    status_rollup_window(&r, now, 24 * 3600, &w);
+    check(w.count == 360, "longer windows than the history hold an hour");
+
+    // Ten minutes without samples: those minutes count as empty, not as the hour-old buckets in their slots
+    now = 7200 + 600;
+    status_rollup_window(&r, now, 300, &w);
+    check(w.count == 0, "5 min of silence: no samples");
+    status_rollup_window(&r, now, 3600, &w);
+    check(w.count == 294 && near(w.min, 71), "1 h after a gap: minutes 71..130, samples up to 119 only");
+    status_rollup_add(&r, now, -5.5f);
+    status_rollup_add(&r, now + 1, 2.5f);
+    status_rollup_window(&r, now + 1, 300, &w);
+    check(w.count == 2 && near(w.min, -5.5f) && near(w.max, 2.5f) && near(w.avg, -1.5f), "bucket reused after an hour");
+
+    status_rollup_window(&r, 30, 3600, &w);
+    check(w.count == 0, "window before the buckets' minutes: none match");
+}
+
+/* A snapshot as main builds it */
+
+static status_rollup_t s_temp_rollup;
+
+static void build(status_snapshot_t *snap)
+{
+    for (uint32_t t = 3000; t < 3600; t += 2) {
+        status_rollup_add(&s_temp_rollup, t, 20.0f + (t % 60) / 60.0f);
+    }
+    status_snapshot_reset(snap, 3599);
+    status_snapshot_reading(snap, "temperature", "celsius", 21.25f, true, false, &s_temp_rollup);
+    status_snapshot_reading(snap, "humidity", "percent", 40, true, true, NULL);
+    status_snapshot_reading(snap, "lux", "lux", 0, false, false, NULL);
+    status_snapshot_metric(snap, "i2c_transfers_total", "I2C transfers", STATUS_METRIC_COUNTER, "device", "bme280",
+                           123456789012.0);
+    status_snapshot_metric(snap, "i2c_transfers_total", "I2C transfers", STATUS_METRIC_COUNTER, "device", "bh1750", 7);
+    status_snapshot_metric(snap, "frame_render_us", "Render time of the last frame", STATUS_METRIC_GAUGE, NULL, NULL,
+                           812);
+    status_snapshot_metric(snap, "task_stack_free_bytes", "Least free stack", STATUS_METRIC_GAUGE, "task", "odd\"na\\me",
+                           1536);
+    status_snapshot_metric(snap, "task_stack_free_bytes", "Least free stack", STATUS_METRIC_GAUGE, "task",
+                           "a_task_name_longer_than_15", 2048);
+}
+
+typedef struct {
+    float temp;
+    float temp_avg_5m;
+    float temp_max_1h;
+    int32_t temp_samples_1h;
+    bool hum_stale;
+    bool lux_valid;
+    float lux_value;
+    int32_t uptime;
+    uint8_t metrics;
+    struct {
+        char name[32];
+        char device[16];
+        char task[16];
+        float value;
+    } metric[8];
+} status_doc_t;
+
+static const json_field_t s_doc_fields[] = {
+    JSON_FIELD(JSON_FIELD_FLOAT, "readings.temperature.value", status_doc_t, temp),
+    JSON_FIELD(JSON_FIELD_FLOAT, "readings.temperature.5m.avg", status_doc_t, temp_avg_5m),
+    JSON_FIELD(JSON_FIELD_FLOAT, "readings.temperature.1h.max", status_doc_t, temp_max_1h),
+    JSON_FIELD(JSON_FIELD_INT, "readings.temperature.1h.samples", status_doc_t, temp_samples_1h),
+    JSON_FIELD(JSON_FIELD_BOOL, "readings.humidity.stale", status_doc_t, hum_stale),
+    JSON_FIELD(JSON_FIELD_BOOL, "readings.lux.valid", status_doc_t, lux_valid),
+    JSON_FIELD(JSON_FIELD_FLOAT, "readings.lux.value", status_doc_t, lux_value),
+    JSON_FIELD(JSON_FIELD_INT, "uptime_s", status_doc_t, uptime),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "metrics[].name", status_doc_t, metric, name),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "metrics[].device", status_doc_t, metric, device),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "metrics[].task", status_doc_t, metric, task),
+    JSON_ITEM_FIELD(JSON_FIELD_FLOAT, "metrics[].value", status_doc_t, metric, value),
+};
+
+static const json_schema_t s_doc_schema = {
+    .fields = s_doc_fields,
+    .field_count = sizeof(s_doc_fields) / sizeof(s_doc_fields[0]),
+    .items_offset = offsetof(status_doc_t, metric),
+    .item_size = sizeof(((status_doc_t *)0)->metric[0]),
+    .max_items = 8,
+    .count_offset = offsetof(status_doc_t, metrics),
+};
+
+static void check_json(const status_snapshot_t *snap)
+{
+    printf("  JSON\n");
+    static char buf[4096];
+    size_t len = status_format_json(snap, buf, sizeof(buf));
+    check(len < sizeof(buf) && strlen(buf) == len, "formatted whole");
+
+    status_doc_t doc;
+    memset(&doc, 0, sizeof(doc));
+    doc.lux_value = -1;
+    json_stream_t p;
+    json_stream_init(&p, &s_doc_schema, &doc);
+    json_stream_feed(&p, buf, len);
+    check(json_stream_finish(&p) == ESP_OK, "parses");
+    check(near(doc.temp, 21.25f) && doc.uptime == 3599, "values");
+    check(near(doc.temp_avg_5m, 20.0f + 29 / 60.0f) && near(doc.temp_max_1h, 20.0f + 58 / 60.0f) &&
+          doc.temp_samples_1h == 300, "windows");
+    check(doc.hum_stale && !doc.lux_valid && doc.lux_value == -1, "stale flag, unread sensor as null");
+    check(doc.metrics == 5 && strcmp(doc.metric[1].device, "bh1750") == 0 && doc.metric[0].value > 1.2e11f,
+          "metrics with labels, large counters whole");
+    check(strcmp(doc.metric[3].task, "odd\"na\\me") == 0, "label escaped and read back");
+    check(strcmp(doc.metric[4].task, "a_task_name_lon") == 0, "label cut to STATUS_LABEL_LEN");
+    check(strstr(buf, "123456789012") != NULL, "counter digits not lost to %g");
+}
+
+static bool prometheus_name_char(char c, bool first)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || (!first && c >= '0' && c <= '9');
+}
+
+static void check_prometheus(const status_snapshot_t *snap)
+{
+    printf("  Prometheus text\n");
+    static char buf[8192];
+    size_t len = status_format_prometheus(snap, buf, sizeof(buf));
+    check(len < sizeof(buf) && buf[len - 1] == '\n', "formatted whole, ends with a new line");
+
+    // Names with a TYPE line, each once; every sample under the TYPE of its name
+    char typed[32][48];
+    int typed_count = 0;
+    bool lines_ok = true, once = true, under_type = true;
+    int samples = 0;
+    for (char *line = strtok(buf, "\n"); line; line = strtok(NULL, "\n")) {
+        if (strncmp(line, "# HELP ", 7) == 0) {
+            continue;
+        }
+        if (strncmp(line, "# TYPE ", 7) == 0) {
+            char name[48], type[16];
+            if (sscanf(line + 7, "%47s %15s", name, type) != 2 ||
+                (strcmp(type, "gauge") != 0 && strcmp(type, "counter") != 0)) {
+                lines_ok = false;
+                continue;
+            }
+            for (int i = 0; i < typed_count; i++) {
+                once = once && strcmp(typed[i], name) != 0;
+            }
+            if (typed_count < 32) {
+                strcpy(typed[typed_count++], name);
+            }
+            continue;
+        }
+        size_t n = 0;
+        while (prometheus_name_char(line[n], n == 0)) {
+            n++;
+        }
+        under_type = under_type && typed_count > 0 && strncmp(typed[typed_count - 1], line, n) == 0 &&
+                     typed[typed_count - 1][n] == '\0';
+        const char *value = strrchr(line, ' ');
+        char *end;
+        if (n == 0 || !value || (strtod(value + 1, &end), *end != '\0')) {
+            lines_ok = false;
+        }
+        samples++;
+    }
+    check(lines_ok, "every line a comment or a sample with a number");
+    check(once, "one TYPE per name");
+    check(under_type, "samples under the TYPE of their name");
+
+    len = status_format_prometheus(snap, buf, sizeof(buf));
+    check(strstr(buf, "mirror_reading{sensor=\"temperature\",unit=\"celsius\"} 21.25\n") != NULL, "reading sample");
+    check(strstr(buf, "mirror_reading_stale{sensor=\"humidity\"} 1\n") != NULL, "stale sample");
+    check(strstr(buf, "sensor=\"lux\"") == NULL, "unread sensor left out");
+    check(strstr(buf, "mirror_reading_samples{sensor=\"temperature\",window=\"5m\"} 150\n") != NULL, "window sample");
+    check(strstr(buf, "mirror_task_stack_free_bytes{task=\"odd\\\"na\\\\me\"} 1536\n") != NULL, "label escaped");
+    check(strstr(buf, "# TYPE mirror_i2c_transfers_total counter\n") != NULL, "counter type");
+    printf("    %d samples, %zu B of text\n", samples, len);
+}
+
+static void check_truncation(const status_snapshot_t *snap)
+{
+    printf("  small buffers\n");
+    char whole[4096], cut[100];
+    size_t need = status_format_json(snap, whole, sizeof(whole));
+    memset(cut, 'x', sizeof(cut));
+    check(status_format_json(snap, cut, sizeof(cut)) == need && strlen(cut) == sizeof(cut) - 1 &&
+          strncmp(cut, whole, sizeof(cut) - 1) == 0, "JSON cut, terminated, needed length reported");
+    size_t need_text = status_format_prometheus(snap, NULL, 0);
+    static char text[8192];
+    check(need_text == status_format_prometheus(snap, text, sizeof(text)), "length without a buffer");
+
+    status_snapshot_t *full = calloc(1, sizeof(*full));
+    status_snapshot_reset(full, 1);
+    int added = 0;
+    for (int i = 0; i < STATUS_MAX_METRICS + 5; i++) {
+        added += status_snapshot_metric(full, "m", "help", STATUS_METRIC_GAUGE, NULL, NULL, i);
+    }
+    check(added == STATUS_MAX_METRICS && full->dropped == 5, "metrics beyond the snapshot counted as dropped");
+    free(full);
+}
+
+int main(void)
+{
+    printf("Status documents\n");
+    check_rollup();
+    static status_snapshot_t snap;
+    build(&snap);
+    check_json(&snap);
+    check_prometheus(&snap);
+    check_truncation(&snap);
+    printf("    snapshot %zu B, rollup %zu B per reading\n", sizeof(status_snapshot_t), sizeof(status_rollup_t));
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
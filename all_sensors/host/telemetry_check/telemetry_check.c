@@ -0,0 +1,846 @@
+/*
+ * Telemetry (components/telemetry) on a RAM model of NOR flash and against a stand-in MQTT broker on 127.0.0.1, in a
+ * thread of this process:
+ *   - batch payloads read back by a CBOR decoder give the samples within the resolution of each channel, null for
+ *     missing readings; a row that does not fit leaves the batch valid
+ *   - the flash ring never sets a bit without an erase, finds its records again after a restart, erases the sectors
+ *     evenly, makes room by dropping the oldest records and skips records cut by a reset while written
+ *   - batches made while the link or the broker is down are kept in flash and delivered in order once it is back,
+ *     also after a restart; a connection lost with batches in flight loses none of them
+ *   - the session: client id, the retained will and "online", DISCONNECT on a clean stop
+ * Exit status is non-zero if a check fails.
+ */
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "telemetry_batch.h"
+#include "telemetry_publisher.h"
+#include "telemetry_ring.h"
+
+#define DEVICE_ID       "mirror-a1b2c3"
+#define TOPIC           "mirrors/" DEVICE_ID "/telemetry"
+#define STATUS_TOPIC    "mirrors/" DEVICE_ID "/status"
+
+#define SECTOR          4096
+#define SECTORS         8
+#define SAMPLE_PERIOD_S 10
+#define MAX_ROWS        128
+#define MAX_RECEIVED    1024
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/* NOR flash in RAM: an erase sets a sector to 0xFF, a write can only clear bits */
+
+static struct {
+    uint8_t mem[SECTOR * SECTORS];
+    uint32_t erases[SECTORS];
+    int bit_sets;                                                                                           /*!< Writes that would have needed a 0 turned into a 1 */
+    long write_budget;                                                                                      /*!< Bytes written before a simulated reset cuts the write, < 0: no reset */
+} s_flash;
+
+static esp_err_t flash_read(void *ctx, uint32_t offset, void *buf, size_t len)
+{
+    if (offset + len > sizeof(s_flash.mem)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(buf, s_flash.mem + offset, len);
+    return ESP_OK;
+}
+
+static esp_err_t flash_write(void *ctx, uint32_t offset, const void *buf, size_t len)
+{
+    if (offset + len > sizeof(s_flash.mem)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t *p = buf;
+    for (size_t i = 0; i < len; i++) {
+        if (s_flash.write_budget == 0) {
+            return ESP_FAIL;
+        }
+        if (s_flash.write_budget > 0) {
+            s_flash.write_budget--;
+        }
+        if (p[i] & ~s_flash.mem[offset + i]) {
+            s_flash.bit_sets++;
+        }
+        s_flash.mem[offset + i] &= p[i];
+    }
+    return ESP_OK;
+}
+
+static esp_err_t flash_erase(void *ctx, uint32_t offset, size_t len)
+{
+    if (offset % SECTOR || len % SECTOR || offset + len > sizeof(s_flash.mem)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(s_flash.mem + offset, 0xFF, len);
+    for (uint32_t s = offset / SECTOR; s < (offset + len) / SECTOR; s++) {
+        s_flash.erases[s]++;
+    }
+    return ESP_OK;
+}
+
+static const telemetry_flash_t s_flash_ops = {
+    .read = flash_read,
+    .write = flash_write,
+    .erase = flash_erase,
+    .size = sizeof(s_flash.mem),
+    .sector_size = SECTOR,
+};
+
+static void flash_reset(void)
+{
+    memset(&s_flash, 0, sizeof(s_flash));
+    memset(s_flash.mem, 0xFF, sizeof(s_flash.mem));
+    s_flash.write_budget = -1;
+}
+
+/* Samples of a quiet room, with gaps */
+
+static telemetry_sample_t make_sample(uint32_t i, uint32_t t0)
+{
+    telemetry_sample_t s = {
+        .time = t0 + i * SAMPLE_PERIOD_S,
+        .value = { 21.0f + sinf(i / 20.0f), 45.0f + (i % 30) / 10.0f, 1013.2f - (i % 50) / 10.0f,
+                   i % 90 < 45 ? 120.0f + i % 3 : 0.0f },
+        .valid = 0x0F,
+    };
+    if (i % 7 == 3) {
+        s.valid &= ~(1 << TELEMETRY_LUX);
+    }
+    if (i % 23 == 5) {
+        s.value[TELEMETRY_TEMP] = NAN;
+    }
+    return s;
+}
+
+/* CBOR reader for the batch layout */
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool err;
+} reader_t;
+
+#define INDEFINITE UINT64_MAX
+
+// Major type, or -1; arg: the value, length or count, INDEFINITE for (_ ; simple values in arg for type 7
+static int read_head(reader_t *r, uint64_t *arg)
+{
+    if (r->p >= r->end) {
+        r->err = true;
+        return -1;
+    }
+    uint8_t ib = *r->p++;
+    int major = ib >> 5, ai = ib & 31;
+    if (ai < 24) {
+        *arg = ai;
+    } else if (ai >= 24 && ai <= 27) {
+        int n = 1 << (ai - 24);
+        if (r->end - r->p < n) {
+            r->err = true;
+            return -1;
+        }
+        *arg = 0;
+        while (n--) {
+            *arg = *arg << 8 | *r->p++;
+        }
+    } else if (ai == 31) {
+        *arg = INDEFINITE;
+    } else {
+        r->err = true;
+        return -1;
+    }
+    return major;
+}
+
+static bool read_int(reader_t *r, int64_t *v)
+{
+    uint64_t arg;
+    int major = read_head(r, &arg);
+    if (major == 0) {
+        *v = arg;
+    } else if (major == 1) {
+        *v = -1 - (int64_t)arg;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool read_text(reader_t *r, char *out, size_t size)
+{
+    uint64_t len;
+    if (read_head(r, &len) != 3 || len >= size || (uint64_t)(r->end - r->p) < len) {
+        return false;
+    }
+    memcpy(out, r->p, len);
+    out[len] = '\0';
+    r->p += len;
+    return true;
+}
+
+typedef struct {
+    char id[32];
+    uint32_t t0;
+    int rows;
+    telemetry_sample_t s[MAX_ROWS];
+} decoded_t;
+
+static bool decode_batch(const uint8_t *buf, size_t len, decoded_t *out)
+{
+    static const char *const names[TELEMETRY_CHANNELS] = { "temp", "hum", "press", "lux" };
+    reader_t r = { .p = buf, .end = buf + len };
+    uint64_t arg;
+    uint32_t scale[TELEMETRY_CHANNELS] = { 0 };
+    memset(out, 0, sizeof(*out));
+    if (read_head(&r, &arg) != 5 || arg != 6) {
+        return false;
+    }
+    for (int pair = 0; pair < 6; pair++) {
+        char key[8];
+        int64_t v;
+        if (!read_text(&r, key, sizeof(key))) {
+            return false;
+        }
+        if (strcmp(key, "v") == 0) {
+            if (!read_int(&r, &v) || v != 1) {
+                return false;
+            }
+        } else if (strcmp(key, "id") == 0) {
+            if (!read_text(&r, out->id, sizeof(out->id))) {
+                return false;
+            }
+        } else if (strcmp(key, "t") == 0) {
+            if (!read_int(&r, &v)) {
+                return false;
+            }
+            out->t0 = v;
+        } else if (strcmp(key, "k") == 0 || strcmp(key, "q") == 0) {
+            bool k = key[0] == 'k';
+            if (read_head(&r, &arg) != 4 || arg != TELEMETRY_CHANNELS) {
+                return false;
+            }
+            for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+                char name[8];
+                if (k ? !read_text(&r, name, sizeof(name)) || strcmp(name, names[ch]) != 0
+                      : !read_int(&r, &v) || v <= 0) {
+                    return false;
+                }
+                if (!k) {
+                    scale[ch] = v;
+                }
+            }
+        } else if (strcmp(key, "r") == 0) {
+            if (read_head(&r, &arg) != 4 || arg != INDEFINITE) {
+                return false;
+            }
+            uint32_t time = out->t0;
+            int64_t q[TELEMETRY_CHANNELS] = { 0 };
+            while (r.p < r.end && *r.p != 0xFF) {
+                if (out->rows == MAX_ROWS || read_head(&r, &arg) != 4 || arg != 1 + TELEMETRY_CHANNELS ||
+                    !read_int(&r, &v)) {
+                    return false;
+                }
+                telemetry_sample_t *s = &out->s[out->rows++];
+                time += v;
+                s->time = time;
+                for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+                    if (r.p < r.end && *r.p == 0xF6) {
+                        r.p++;
+                        continue;
+                    }
+                    if (!read_int(&r, &v) || !scale[ch]) {
+                        return false;
+                    }
+                    q[ch] += v;
+                    s->value[ch] = (float)q[ch] / scale[ch];
+                    s->valid |= 1 << ch;
+                }
+            }
+            if (r.p++ >= r.end) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return !r.err && r.p == r.end;
+}
+
+static bool same_sample(const telemetry_sample_t *got, const telemetry_sample_t *want)
+{
+    static const float step[TELEMETRY_CHANNELS] = { 0.01f, 0.1f, 0.1f, 1.0f };
+    if (got->time != want->time) {
+        return false;
+    }
+    for (int ch = 0; ch < TELEMETRY_CHANNELS; ch++) {
+        bool valid = want->valid & 1 << ch && isfinite(want->value[ch]);
+        if (valid != !!(got->valid & 1 << ch) ||
+            (valid && fabsf(got->value[ch] - want->value[ch]) > step[ch] / 2 + 1e-3f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_batch(void)
+{
+    printf("  Batch payloads\n");
+    static uint8_t buf[TELEMETRY_BATCH_LEN];
+    static decoded_t d;
+    telemetry_batch_t b;
+    const uint32_t t0 = 1760860800;
+    telemetry_batch_begin(&b, buf, sizeof(buf), DEVICE_ID, t0);
+    int added = 0;
+    while (added < MAX_ROWS) {
+        telemetry_sample_t s = make_sample(added, t0);
+        if (!telemetry_batch_add(&b, &s)) {
+            break;
+        }
+        added++;
+    }
+    size_t len = telemetry_batch_finish(&b);
+    check(added > 20 && added < MAX_ROWS && b.rows == added, "a full buffer refuses the row");
+    check(len > 0 && len <= sizeof(buf) && decode_batch(buf, len, &d), "full batch decodes");
+    check(strcmp(d.id, DEVICE_ID) == 0 && d.t0 == t0 && d.rows == added, "id, start time and rows");
+    bool same = true;
+    for (int i = 0; i < d.rows; i++) {
+        telemetry_sample_t s = make_sample(i, t0);
+        same = same && same_sample(&d.s[i], &s);
+    }
+    check(same, "samples within resolution, null where missing");
+
+    // Same readings as plain JSON, for scale
+    char json[160];
+    telemetry_sample_t s = make_sample(1, t0);
+    int json_row = snprintf(json, sizeof(json), "{\"t\":%" PRIu32 ",\"temp\":%.2f,\"hum\":%.1f,\"press\":%.1f,"
+                            "\"lux\":%.0f},", s.time, s.value[0], s.value[1], s.value[2], s.value[3]);
+    printf("    %d rows in %zu B, %.1f B per row; JSON object per reading: %d B\n", added, len,
+           (double)len / added, json_row);
+
+    // A quiet minute costs seven bytes
+    telemetry_batch_begin(&b, buf, sizeof(buf), DEVICE_ID, t0);
+    telemetry_sample_t quiet = make_sample(0, t0);
+    quiet.value[TELEMETRY_TEMP] = 21.0f;
+    telemetry_batch_add(&b, &quiet);
+    size_t before = b.cbor.len;
+    quiet.time += 60;
+    telemetry_batch_add(&b, &quiet);
+    check(b.cbor.len - before == 7, "unchanged row a minute later is 7 B");
+    len = telemetry_batch_finish(&b);
+    check(decode_batch(buf, len, &d) && d.rows == 2 && same_sample(&d.s[1], &quiet), "two-row batch decodes");
+
+    // Not even the header fits
+    telemetry_batch_begin(&b, buf, 24, DEVICE_ID, t0);
+    check(!telemetry_batch_add(&b, &quiet) && telemetry_batch_finish(&b) == 0, "too small a buffer gives nothing");
+}
+
+/* Ring */
+
+static uint32_t record_len(uint32_t seq)
+{
+    return 40 + seq * 37 % 300;
+}
+
+static void fill_record(uint8_t *buf, uint32_t seq)
+{
+    for (uint32_t i = 0; i < record_len(seq); i++) {
+        buf[i] = (uint8_t)(seq * 31 + i);
+    }
+}
+
+static bool record_ok(const uint8_t *buf, size_t len, uint32_t seq)
+{
+    uint8_t want[512];
+    fill_record(want, seq);
+    return len == record_len(seq) && memcmp(buf, want, len) == 0;
+}
+
+// Unsent records from the tail: count, and whether they are whole and in order from first_seq
+static int read_all(telemetry_ring_t *ring, uint32_t *first_seq, bool *ok)
+{
+    uint8_t buf[512];
+    uint32_t pos = ring->tail, seq, next, prev = 0;
+    size_t len;
+    int count = 0;
+    *ok = true;
+    while (telemetry_ring_read(ring, &pos, buf, sizeof(buf), &len, &seq, &next) == ESP_OK) {
+        if (count == 0) {
+            *first_seq = seq;
+        } else if (seq != prev + 1) {
+            *ok = false;
+        }
+        *ok = *ok && record_ok(buf, len, seq);
+        prev = seq;
+        pos = next;
+        count++;
+    }
+    return count;
+}
+
+static void check_ring(void)
+{
+    printf("  Flash ring\n");
+    telemetry_ring_t ring;
+    uint8_t buf[512];
+    uint32_t first = 0;
+    bool ok;
+
+    flash_reset();
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.pending == 0 && ring.head == 0,
+          "blank flash opens empty");
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        fill_record(buf, seq);
+        telemetry_ring_append(&ring, buf, record_len(seq));
+    }
+    check(ring.pending == 10 && read_all(&ring, &first, &ok) == 10 && first == 0 && ok, "ten records read back");
+
+    // Sent out of order: the tail stays on the oldest unsent one
+    uint32_t pos = ring.tail, seq, next, pos0, seq0;
+    size_t len;
+    telemetry_ring_read(&ring, &pos, buf, sizeof(buf), &len, &seq, &next);
+    pos0 = pos;
+    seq0 = seq;
+    pos = next;
+    telemetry_ring_read(&ring, &pos, buf, sizeof(buf), &len, &seq, &next);
+    check(telemetry_ring_mark_sent(&ring, pos, seq) == ESP_OK && ring.tail == pos0, "second sent, tail kept");
+    check(telemetry_ring_mark_sent(&ring, pos0, seq0) == ESP_OK && ring.pending == 8, "first sent");
+    check(telemetry_ring_mark_sent(&ring, pos0, seq0) == ESP_ERR_NOT_FOUND, "sent twice refused");
+    check(read_all(&ring, &first, &ok) == 8 && first == 2 && ok, "read from the third");
+
+    // Restart
+    uint32_t head = ring.head, tail = ring.tail;
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.pending == 8 && ring.head == head &&
+          ring.tail == tail && ring.next_seq == 10, "found again after a restart");
+
+    // Many passes over the area with nothing sent: the oldest make room
+    for (uint32_t s = 10; s < 400; s++) {
+        fill_record(buf, s);
+        telemetry_ring_append(&ring, buf, record_len(s));
+    }
+    int count = read_all(&ring, &first, &ok);
+    check(ok && first + count == 400 && count == (int)ring.pending, "the newest kept, whole and in order");
+    check(ring.stats.dropped + ring.pending == 398, "each record either kept or counted as dropped");
+    uint32_t min = UINT32_MAX, max = 0;
+    for (int s = 0; s < SECTORS; s++) {
+        min = s_flash.erases[s] < min ? s_flash.erases[s] : min;
+        max = s_flash.erases[s] > max ? s_flash.erases[s] : max;
+    }
+    printf("    %u records kept of 400, %u dropped; erases per sector %u..%u\n", (unsigned)ring.pending,
+           (unsigned)ring.stats.dropped, (unsigned)min, (unsigned)max);
+    check(max - min <= 1, "sectors erased evenly");
+
+    // Everything sent: the ring is empty and stays so after a restart
+    pos = ring.tail;
+    while (telemetry_ring_read(&ring, &pos, buf, sizeof(buf), &len, &seq, &next) == ESP_OK) {
+        telemetry_ring_mark_sent(&ring, pos, seq);
+        pos = next;
+    }
+    check(ring.pending == 0 && ring.tail == ring.head, "all sent");
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.pending == 0 && ring.next_seq == 400,
+          "empty after a restart");
+
+    // A reset in the payload: no header, the rest of the sector is given up
+    fill_record(buf, 400);
+    telemetry_ring_append(&ring, buf, record_len(400));
+    s_flash.write_budget = 20;
+    fill_record(buf, 401);
+    check(telemetry_ring_append(&ring, buf, record_len(401)) != ESP_OK, "write cut in the payload");
+    s_flash.write_budget = -1;
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.pending == 1 && ring.stats.corrupt == 0 &&
+          ring.head % SECTOR == 0, "cut payload skipped, next sector used");
+    fill_record(buf, 401);
+    telemetry_ring_append(&ring, buf, record_len(401));
+    check(read_all(&ring, &first, &ok) == 2 && first == 400 && ok, "writing goes on after it");
+
+    // A reset in the header: a record whose CRC does not match
+    s_flash.write_budget = record_len(402) + 10;
+    fill_record(buf, 402);
+    check(telemetry_ring_append(&ring, buf, record_len(402)) != ESP_OK, "write cut in the header");
+    s_flash.write_budget = -1;
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.stats.corrupt == 1 && ring.pending == 2,
+          "cut header found broken");
+    check(telemetry_ring_open(&ring, &s_flash_ops) == ESP_OK && ring.stats.corrupt == 1 && ring.pending == 2,
+          "and stays out of the way");
+    fill_record(buf, 402);
+    telemetry_ring_append(&ring, buf, record_len(402));
+    check(read_all(&ring, &first, &ok) == 3 && first == 400 && ok, "records around it whole");
+
+    check(telemetry_ring_append(&ring, buf, SECTOR) == ESP_ERR_INVALID_SIZE, "record longer than a sector refused");
+    check(s_flash.bit_sets == 0, "no bit set without an erase");
+}
+
+/* Stand-in broker: one connection at a time, acknowledges QoS 1 */
+
+static struct {
+    int listen_fd;
+    int client_fd;
+    uint16_t port;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    int accepts;
+    int disconnects;                                                                                        /*!< DISCONNECT packets */
+    int pings;
+    char client_id[32];
+    char will_topic[64];
+    char will_message[16];
+    uint8_t will_flags;
+    bool online;                                                                                            /*!< Retained "online" on the status topic */
+    volatile int close_after;                                                                               /*!< Take the n-th next publish and close the connection without acknowledging it, 0: never */
+    int received;
+    uint16_t lens[MAX_RECEIVED];
+    uint8_t payloads[MAX_RECEIVED][TELEMETRY_BATCH_LEN];
+} s_brk;
+
+static bool recv_exact(int fd, void *buf, size_t len)
+{
+    uint8_t *p = buf;
+    while (len) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static size_t get_string(const uint8_t *p, char *out, size_t size)
+{
+    size_t len = p[0] << 8 | p[1];
+    size_t n = len < size ? len : size - 1;
+    memcpy(out, p + 2, n);
+    out[n] = '\0';
+    return 2 + len;
+}
+
+// false: close the connection
+static bool broker_packet(int fd, uint8_t type, uint8_t *body, size_t len)
+{
+    switch (type & 0xF0) {
+    case 0x10: { // CONNECT
+        uint8_t flags = body[7];
+        size_t at = 10;
+        pthread_mutex_lock(&s_brk.lock);
+        at += get_string(body + at, s_brk.client_id, sizeof(s_brk.client_id));
+        s_brk.will_flags = flags & 0x3C;
+        if (flags & 0x04) {
+            at += get_string(body + at, s_brk.will_topic, sizeof(s_brk.will_topic));
+            at += get_string(body + at, s_brk.will_message, sizeof(s_brk.will_message));
+        }
+        pthread_mutex_unlock(&s_brk.lock);
+        static const uint8_t connack[] = { 0x20, 2, 0, 0 };
+        return body[6] == 4 && send(fd, connack, sizeof(connack), MSG_NOSIGNAL) == sizeof(connack);
+    }
+    case 0x30: { // PUBLISH
+        char topic[64];
+        size_t at = get_string(body, topic, sizeof(topic));
+        int qos = type >> 1 & 3;
+        uint16_t id = 0;
+        if (qos) {
+            id = body[at] << 8 | body[at + 1];
+            at += 2;
+        }
+        pthread_mutex_lock(&s_brk.lock);
+        if (strcmp(topic, TOPIC) == 0 && s_brk.received < MAX_RECEIVED && len - at <= TELEMETRY_BATCH_LEN) {
+            s_brk.lens[s_brk.received] = len - at;
+            memcpy(s_brk.payloads[s_brk.received++], body + at, len - at);
+        } else if (strcmp(topic, STATUS_TOPIC) == 0) {
+            s_brk.online = (type & 1) && len - at == 6 && memcmp(body + at, "online", 6) == 0;
+        }
+        pthread_mutex_unlock(&s_brk.lock);
+        if (s_brk.close_after && --s_brk.close_after == 0) {
+            return false;
+        }
+        uint8_t puback[] = { 0x40, 2, id >> 8, id & 0xFF };
+        return !qos || send(fd, puback, sizeof(puback), MSG_NOSIGNAL) == sizeof(puback);
+    }
+    case 0xC0: { // PINGREQ
+        static const uint8_t pingresp[] = { 0xD0, 0 };
+        s_brk.pings++;
+        return send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL) == sizeof(pingresp);
+    }
+    case 0xE0: // DISCONNECT
+        s_brk.disconnects++;
+        return false;
+    default:
+        return false;
+    }
+}
+
+static void *broker_main(void *arg)
+{
+    static uint8_t body[TELEMETRY_BATCH_LEN + 256];
+    while (true) {
+        int fd = accept(s_brk.listen_fd, NULL, NULL);
+        if (fd < 0) {
+            return NULL;
+        }
+        s_brk.client_fd = fd;
+        s_brk.accepts++;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        while (true) {
+            uint8_t type, byte;
+            size_t len = 0;
+            if (!recv_exact(fd, &type, 1)) {
+                break;
+            }
+            int shift = 0;
+            do {
+                if (!recv_exact(fd, &byte, 1)) {
+                    break;
+                }
+                len |= (size_t)(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            if (len > sizeof(body) || !recv_exact(fd, body, len) || !broker_packet(fd, type, body, len)) {
+                break;
+            }
+        }
+        s_brk.client_fd = -1;
+        close(fd);
+    }
+}
+
+static bool broker_up(uint16_t port)
+{
+    s_brk.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(s_brk.listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port),
+                                .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (s_brk.listen_fd < 0 || bind(s_brk.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(s_brk.listen_fd, 4) != 0 || getsockname(s_brk.listen_fd, (struct sockaddr *)&addr, &len) != 0) {
+        return false;
+    }
+    s_brk.port = ntohs(addr.sin_port);
+    s_brk.client_fd = -1;
+    return pthread_create(&s_brk.thread, NULL, broker_main, NULL) == 0;
+}
+
+static void broker_down(void)
+{
+    shutdown(s_brk.listen_fd, SHUT_RDWR);
+    close(s_brk.listen_fd);
+    int fd = s_brk.client_fd;
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    pthread_join(s_brk.thread, NULL);
+}
+
+/* Publisher */
+
+static uint32_t s_sample_index;
+static int64_t s_now_us;
+static const uint32_t s_t0 = 1760860800;
+static bool s_delivered[32768];                                                                             /*!< By sample index: received by the broker */
+static int s_duplicates;
+
+static uint32_t test_random(void)
+{
+    return (uint32_t)rand();
+}
+
+// Samples for the given seconds, the publisher serviced after each
+static void run(telemetry_publisher_t *pub, uint32_t seconds, bool link_up)
+{
+    for (uint32_t t = 0; t < seconds; t += SAMPLE_PERIOD_S) {
+        telemetry_sample_t s = make_sample(s_sample_index++, s_t0);
+        s_now_us = (int64_t)(s.time - s_t0) * 1000000;
+        telemetry_publisher_add(pub, &s);
+        telemetry_publisher_service(pub, s_now_us, link_up);
+    }
+}
+
+// Service only, until nothing is pending or the time is up
+static void drain(telemetry_publisher_t *pub, uint32_t seconds)
+{
+    for (uint32_t t = 0; t < seconds && pub->ring.pending; t++) {
+        s_now_us += 1000000;
+        telemetry_publisher_service(pub, s_now_us, true);
+    }
+}
+
+// Decode what the broker got since last time: whole, new batches in order, duplicates counted
+static bool take_received(int *from, int *batches)
+{
+    static decoded_t d;
+    static uint32_t last_t0;
+    bool ok = true;
+    pthread_mutex_lock(&s_brk.lock);
+    for (; *from < s_brk.received; (*from)++) {
+        if (!decode_batch(s_brk.payloads[*from], s_brk.lens[*from], &d) || strcmp(d.id, DEVICE_ID) != 0) {
+            ok = false;
+            continue;
+        }
+        // Sent again after a lost acknowledgement, or the next one
+        bool again = d.rows && s_delivered[(d.s[0].time - s_t0) / SAMPLE_PERIOD_S];
+        if (!again && d.t0 < last_t0) {
+            ok = false;
+        }
+        last_t0 = again ? last_t0 : d.t0;
+        for (int i = 0; i < d.rows; i++) {
+            uint32_t index = (d.s[i].time - s_t0) / SAMPLE_PERIOD_S;
+            telemetry_sample_t want = make_sample(index, s_t0);
+            if (index >= sizeof(s_delivered) || !same_sample(&d.s[i], &want)) {
+                ok = false;
+                continue;
+            }
+            s_duplicates += s_delivered[index];
+            s_delivered[index] = true;
+        }
+        (*batches)++;
+    }
+    pthread_mutex_unlock(&s_brk.lock);
+    return ok;
+}
+
+static bool delivered_range(uint32_t from, uint32_t to)
+{
+    for (uint32_t i = from; i < to; i++) {
+        if (!s_delivered[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void check_publisher(void)
+{
+    printf("  Publisher against the stand-in broker\n");
+    pthread_mutex_init(&s_brk.lock, NULL);
+    if (!broker_up(0)) {
+        check(false, "stand-in broker started");
+        return;
+    }
+    flash_reset();
+    static telemetry_publisher_t pub;
+    telemetry_publisher_config_t config = {
+        .device_id = DEVICE_ID,
+        .topic = TOPIC,
+        .status_topic = STATUS_TOPIC,
+        .batch_interval_s = 60,
+        .window = 4,
+        .retry_min_ms = 2000,
+        .retry_max_ms = 30000,
+        .random = test_random,
+        .mqtt = { .host = "127.0.0.1", .port = s_brk.port, .timeout_ms = 300, .keepalive_s = 60 },
+    };
+    check(telemetry_publisher_init(&pub, &config, &s_flash_ops) == ESP_OK, "publisher set up");
+    int from = 0, batches = 0;
+
+    // Online: each batch out within the service after it closes
+    run(&pub, 600, true);
+    check(take_received(&from, &batches) && batches == 9 && pub.ring.pending == 0, "nine batches in ten minutes");
+    check(delivered_range(0, 54), "their samples delivered");
+    check(strcmp(s_brk.client_id, DEVICE_ID) == 0 && strcmp(s_brk.will_topic, STATUS_TOPIC) == 0 &&
+          strcmp(s_brk.will_message, "offline") == 0 && s_brk.will_flags == (0x04 | 0x08 | 0x20) && s_brk.online,
+          "client id, retained QoS 1 will, retained online");
+
+    // Idle connection: kept alive by pings
+    int pings = s_brk.pings;
+    s_now_us += 31000000;
+    telemetry_publisher_service(&pub, s_now_us, true);
+    check(s_brk.pings == pings + 1 && s_brk.accepts == 1, "ping after half the keepalive");
+
+    // Wi-Fi down for two hours: batches only go to flash
+    uint32_t outage_start = s_sample_index;
+    run(&pub, 7200, false);
+    check(take_received(&from, &batches) && pub.ring.pending == 120, "two hours kept in flash");
+    check(s_brk.received == from && from == 9, "nothing sent while down");
+    drain(&pub, 120);
+    check(take_received(&from, &batches) && pub.ring.pending == 0, "backlog delivered oldest first");
+    check(delivered_range(outage_start, s_sample_index - 6), "no sample of the outage lost");
+
+    // Connection dropped with batches in flight: sent again, none lost
+    run(&pub, 3000, false);
+    s_brk.close_after = 3;
+    drain(&pub, 120);
+    check(take_received(&from, &batches) && pub.ring.pending == 0 && s_brk.accepts == 4, "reconnected after the drop");
+    check(delivered_range(0, s_sample_index - 6), "every batch delivered");
+    printf("    %d batches received, %d samples twice (in flight when the connection dropped)\n", batches,
+           s_duplicates);
+    check(s_duplicates > 0 && s_duplicates <= 4 * 6, "at most the window sent twice");
+
+    // Broker down: retries spaced out by the backoff
+    broker_down();
+    uint32_t failures = pub.stats.connect_failures;
+    uint32_t broker_outage = s_sample_index;
+    run(&pub, 1800, true);
+    uint32_t attempts = pub.stats.connect_failures - failures;
+    printf("    %u connection attempts while the broker was down for 30 min\n", (unsigned)attempts);
+    check(attempts >= 1800 / 30 - 5 && attempts <= 1800 / 15 + 5, "backoff between attempts");
+    check(broker_up(s_brk.port), "broker back on the same port");
+    drain(&pub, 60);
+    check(take_received(&from, &batches) && pub.ring.pending == 0, "backlog delivered after the broker came back");
+    check(delivered_range(broker_outage, s_sample_index - 6), "nothing of the broker outage lost");
+
+    // Restart with batches in flash, and the open one flushed
+    uint32_t closed = pub.stats.batches;
+    run(&pub, 1200, false);
+    telemetry_publisher_flush(&pub);
+    uint32_t pending = pub.ring.pending;
+    check(pending == pub.stats.batches - closed && pending >= 20, "twenty minutes kept, the open batch flushed");
+    check(telemetry_publisher_init(&pub, &config, &s_flash_ops) == ESP_OK && pub.ring.pending == pending,
+          "batches found again after a restart");
+    drain(&pub, 60);
+    check(take_received(&from, &batches) && pub.ring.pending == 0 && delivered_range(0, s_sample_index),
+          "delivered after the restart, open batch included");
+
+    // Out of flash: the newest kept
+    run(&pub, 180000, false);
+    telemetry_publisher_flush(&pub);
+    telemetry_publisher_stats_t st;
+    telemetry_publisher_get_stats(&pub, &st);
+    check(st.ring.dropped > 0 && st.pending + st.ring.dropped == st.batches, "oldest dropped when the flash is full");
+    int before = batches;
+    drain(&pub, 600);
+    check(take_received(&from, &batches) && batches - before == (int)st.pending && pub.ring.pending == 0,
+          "the rest delivered");
+    check(delivered_range(s_sample_index - 6 * (st.pending - 1), s_sample_index), "the newest of them complete");
+
+    telemetry_publisher_stop(&pub);
+    usleep(20000);
+    check(s_brk.disconnects == 1, "DISCONNECT on stop");
+    check(s_flash.bit_sets == 0, "no bit set without an erase");
+    telemetry_publisher_get_stats(&pub, &st);
+    printf("    published %" PRIu32 "  acked %" PRIu32 "  connects %" PRIu32 "  connect failures %" PRIu32
+           "  ack timeouts %" PRIu32 "  dropped %" PRIu32 "\n", st.published, st.acked, st.connects,
+           st.connect_failures, st.ack_timeouts, st.ring.dropped);
+    printf("    state: publisher %zu B (batch and send buffers %d B each), for a ring of %d KB\n",
+           sizeof(telemetry_publisher_t), TELEMETRY_BATCH_LEN, SECTOR * SECTORS / 1024);
+    broker_down();
+}
+
+int main(void)
+{
+    printf("Telemetry\n");
+    check_batch();
+    check_ring();
+    check_publisher();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
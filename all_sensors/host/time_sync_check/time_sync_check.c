@@ -0,0 +1,150 @@
+/*
+ * Drift estimate of the time subsystem (components/time_sync/time_sync_drift.c) against a simulated crystal:
+ *   - the first sync and large jumps set the clock, small offsets are slewed
+ *   - hourly syncs with network jitter bring the estimate of a 37 ppm crystal within a few ppm, and with the
+ *     correction applied in between the clock stays within milliseconds over an hour instead of drifting by 130 ms
+ *   - syncs closer than the shortest span are folded into the next measurement, not measured on their own
+ *   - a crystal that changes with temperature is followed
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "time_sync_drift.h"
+
+#define EPOCH_US        (1760000000LL * 1000000)                                   /*!< Oct 2025 */
+#define HOUR_US         (3600LL * 1000000)
+#define CORRECT_US      (10LL * 1000000)                                            /*!< Correction period, as TIME_SYNC_DEFAULT_CONFIG */
+#define JITTER_US       3000                                                        /*!< Network delay asymmetry, +- */
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+/**
+ * @brief True time and a local clock that gains drift_ppb, corrected the way time_sync.c does it
+ */
+typedef struct {
+    int64_t true_us;
+    int64_t local_us;
+    int64_t fraction_ns;                                                            /*!< Gain below 1 us, not shown yet */
+    int32_t drift_ppb;
+    time_sync_drift_t est;
+} sim_t;
+
+static void sim_run(sim_t *s, int64_t us)
+{
+    for (int64_t t = 0; t < us; t += CORRECT_US) {
+        int64_t step = us - t < CORRECT_US ? us - t : CORRECT_US;
+        s->true_us += step;
+        int64_t ns = s->fraction_ns + (int64_t)s->drift_ppb * step / 1000000;
+        s->local_us += step + ns / 1000;
+        s->fraction_ns = ns % 1000;
+        if (step == CORRECT_US) {
+            s->local_us += time_sync_drift_correction_us(&s->est, CORRECT_US);
+        }
+    }
+}
+
+static int64_t jitter(void)
+{
+    return rand() % (2 * JITTER_US + 1) - JITTER_US;
+}
+
+/**
+ * @brief Sync, with the server time off by the network jitter; returns whether it slewed
+ */
+static bool sim_sync(sim_t *s)
+{
+    int64_t server = s->true_us + jitter();
+    bool slew = time_sync_drift_update(&s->est, server, s->local_us);
+    s->local_us = server;                                                           /* slewed or set, it ends there */
+    return slew;
+}
+
+static void check_steps(void)
+{
+    printf("  setting and slewing\n");
+    sim_t s = { .true_us = EPOCH_US, .local_us = 0, .drift_ppb = 0 };
+    check(!sim_sync(&s), "first sync sets the clock");
+    sim_run(&s, HOUR_US);
+    check(sim_sync(&s), "small offset slewed");
+    s.local_us += 2000000;
+    sim_run(&s, HOUR_US);
+    check(!sim_sync(&s) && s.est.measurements == 1, "2 s jump set, not taken for drift");
+    check(s.est.syncs == 3, "syncs counted");
+}
+
+static void check_convergence(void)
+{
+    printf("  37 ppm crystal, hourly syncs, +-%d us jitter\n", JITTER_US);
+    sim_t s = { .true_us = EPOCH_US, .local_us = EPOCH_US - 123456, .drift_ppb = 37000 };
+    sim_sync(&s);
+    for (int hour = 1; hour <= 8; hour++) {
+        sim_run(&s, HOUR_US);
+        int64_t before = s.local_us - s.true_us;
+        sim_sync(&s);
+        printf("    hour %d: off by %6" PRId64 " us before the sync, estimate %6" PRId32 " ppb\n", hour, before, s.est.drift_ppb);
+    }
+    check(llabs(s.est.drift_ppb - 37000) < 3000, "estimate within 3 ppm");
+
+    int64_t worst = 0;
+    for (int i = 0; i < 360; i++) {
+        sim_run(&s, CORRECT_US);
+        int64_t err = llabs(s.local_us - s.true_us);
+        if (err > worst) worst = err;
+    }
+    printf("    corrected: at most %" PRId64 " us off over an hour, uncorrected %" PRId64 " us\n", worst,
+           (int64_t)37000 * 3600 / 1000);
+    check(worst < 15000, "corrected clock within 15 ms over an hour");
+}
+
+static void check_short_spans(void)
+{
+    printf("  syncs a minute apart\n");
+    sim_t s = { .true_us = EPOCH_US, .local_us = EPOCH_US, .drift_ppb = -20000 };
+    sim_sync(&s);
+    for (int i = 0; i < 9; i++) {
+        sim_run(&s, 60LL * 1000000);
+        check(sim_sync(&s), "slewed");
+    }
+    check(s.est.measurements == 0, "no measurement from spans under 10 min");
+    sim_run(&s, 60LL * 1000000);
+    sim_sync(&s);
+    /* 12 ms of drift against the jitter of two syncs over 600 s: 10 ppm at worst */
+    check(s.est.measurements == 1 && llabs(s.est.drift_ppb + 20000) < 2 * JITTER_US * 1000000LL / 600,
+          "the whole 10 min span measured, offsets slewed inside it included");
+}
+
+static void check_temperature(void)
+{
+    printf("  crystal from 10 to 40 ppm over a day\n");
+    sim_t s = { .true_us = EPOCH_US, .local_us = EPOCH_US, .drift_ppb = 10000 };
+    sim_sync(&s);
+    for (int hour = 0; hour < 24; hour++) {
+        s.drift_ppb = 10000 + 30000 * hour / 23;
+        sim_run(&s, HOUR_US);
+        sim_sync(&s);
+    }
+    check(llabs(s.est.drift_ppb - 40000) < 4000, "estimate follows the crystal");
+}
+
+int main(void)
+{
+    srand(1);
+    printf("Clock drift estimate\n");
+    check_steps();
+    check_convergence();
+    check_short_spans();
+    check_temperature();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
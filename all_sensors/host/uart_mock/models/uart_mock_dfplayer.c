@@ -0,0 +1,152 @@
+/*
+ * DFPlayer Mini model, see uart_mock_models.h.
+ */
+#include <string.h>
+
+#include "esp_timer.h"
+#include "uart_mock_models.h"
+
+#define DF_LEN 10
+
+enum { DF_STOPPED, DF_PLAYING, DF_PAUSED };
+
+static uint16_t df_checksum(const uint8_t *frame)
+{
+    uint16_t sum = 0;
+    for (int i = 1; i < 7; i++) {
+        sum += frame[i];
+    }
+    return (uint16_t)-sum;
+}
+
+static void df_send(uart_mock_dfplayer_t *m, int64_t at_us, uint8_t cmd, uint16_t param)
+{
+    uint8_t frame[DF_LEN] = { 0x7E, 0xFF, 0x06, cmd, 0x00, param >> 8, param & 0xFF, 0, 0, 0xEF };
+    uint16_t checksum = df_checksum(frame);
+    frame[7] = checksum >> 8;
+    frame[8] = checksum & 0xFF;
+    if (m->corrupt_replies > 0) {
+        m->corrupt_replies--;
+        frame[8] ^= 0x5A;
+    }
+    uart_mock_send(m->port, at_us, frame, sizeof(frame));
+}
+
+static void df_ack(uart_mock_dfplayer_t *m, int64_t at_us, bool feedback)
+{
+    if (!feedback) {
+        return;
+    }
+    if (m->drop_acks > 0) {
+        m->drop_acks--;
+        return;
+    }
+    df_send(m, at_us, 0x41, 0);
+}
+
+static void df_play(uart_mock_dfplayer_t *m, int64_t at_us, uint16_t track, bool feedback)
+{
+    if (track >= UART_MOCK_DFPLAYER_TRACKS || m->track_ms[track] == 0) {
+        df_send(m, at_us, 0x40, 0x06);
+        return;
+    }
+    df_ack(m, at_us, feedback);
+    m->state = DF_PLAYING;
+    m->track = track;
+    m->end_us = at_us + m->track_ms[track] * 1000LL;
+}
+
+static void df_command(uart_mock_dfplayer_t *m, int64_t at_us, uint8_t cmd, bool feedback, uint16_t param)
+{
+    int64_t reply_us = at_us + UART_MOCK_DFPLAYER_REPLY_US;
+    switch (cmd) {
+    case 0x03:
+    case 0x12:
+        df_play(m, reply_us, param, feedback);
+        return;
+    case 0x06:
+        m->volume = param > 30 ? 30 : param;
+        break;
+    case 0x0D:
+        if (m->state == DF_PAUSED) {
+            m->state = DF_PLAYING;
+            m->end_us = reply_us + m->left_us;
+        }
+        break;
+    case 0x0E:
+        if (m->state == DF_PLAYING) {
+            m->state = DF_PAUSED;
+            m->left_us = m->end_us > reply_us ? m->end_us - reply_us : 0;
+        }
+        break;
+    case 0x16:
+        m->state = DF_STOPPED;
+        break;
+    case 0x42:
+        df_ack(m, reply_us, feedback);
+        df_send(m, reply_us, 0x42, m->state);
+        return;
+    default:
+        break;
+    }
+    df_ack(m, reply_us, feedback);
+}
+
+static void df_rx(uart_mock_peer_t *peer, int64_t at_us, const uint8_t *data, size_t len)
+{
+    uart_mock_dfplayer_t *m = (uart_mock_dfplayer_t *)peer;
+    for (size_t i = 0; i < len; i++) {
+        if (m->rx_len == 0 && data[i] != 0x7E) {
+            continue;
+        }
+        m->rx[m->rx_len++] = data[i];
+        if (m->rx_len < DF_LEN) {
+            continue;
+        }
+        m->rx_len = 0;
+        bool valid = m->rx[1] == 0xFF && m->rx[2] == 0x06 && m->rx[9] == 0xEF &&
+                     ((m->rx[7] << 8) | m->rx[8]) == df_checksum(m->rx);
+        if (m->garble_commands > 0) {
+            m->garble_commands--;
+            valid = false;
+        }
+        if (!valid) {
+            m->bad_commands++;
+            df_send(m, at_us + UART_MOCK_DFPLAYER_REPLY_US, 0x40, 0x04);
+            continue;
+        }
+        uint16_t param = (m->rx[5] << 8) | m->rx[6];
+        if (m->commands < UART_MOCK_DFPLAYER_LOG) {
+            m->log[m->commands].at_us = at_us;
+            m->log[m->commands].cmd = m->rx[3];
+            m->log[m->commands].param = param;
+        }
+        m->commands++;
+        df_command(m, at_us, m->rx[3], m->rx[4] & 0x01, param);
+    }
+}
+
+static void df_advance(uart_mock_peer_t *peer, int64_t until_us)
+{
+    uart_mock_dfplayer_t *m = (uart_mock_dfplayer_t *)peer;
+    if (m->state == DF_PLAYING && m->end_us <= until_us) {
+        m->state = DF_STOPPED;
+        df_send(m, m->end_us, 0x3D, m->track);
+        df_send(m, m->end_us, 0x3D, m->track);
+    }
+}
+
+void uart_mock_dfplayer_init(uart_mock_dfplayer_t *m, uart_port_t port)
+{
+    memset(m, 0, sizeof(*m));
+    m->base.name = "dfplayer";
+    m->base.rx = df_rx;
+    m->base.advance = df_advance;
+    m->port = port;
+    m->volume = 25;
+}
+
+void uart_mock_dfplayer_notify(uart_mock_dfplayer_t *m, uint8_t cmd, uint16_t param)
+{
+    df_send(m, esp_timer_get_time(), cmd, param);
+}
@@ -0,0 +1,209 @@
+/*
+ * Host mock of the UART driver, see uart_mock.h.
+ */
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "host_clock.h"
+#include "uart_mock.h"
+
+#define UART_MOCK_BITS_PER_BYTE 10                                                                          /* start, 8 data, stop */
+#define UART_MOCK_DEFAULT_BAUD 115200
+
+typedef struct {
+    uint8_t data;
+    int64_t at_us;                                                                                          /* Arrives at the chip */
+} uart_mock_byte_t;
+
+typedef struct {
+    uart_mock_peer_t *peer;
+    bool installed;
+    int baud;
+    int64_t tx_free_us;                                                                                     /* Transmitter done with what was written */
+    uart_mock_byte_t fifo[UART_MOCK_RX_FIFO];
+    size_t head;
+    size_t count;
+} uart_mock_port_t;
+
+static uart_mock_port_t s_ports[UART_NUM_MAX];
+
+static uart_mock_port_t *port_get(uart_port_t uart_num)
+{
+    return (uart_num >= 0 && uart_num < UART_NUM_MAX) ? &s_ports[uart_num] : NULL;
+}
+
+void uart_mock_reset(void)
+{
+    memset(s_ports, 0, sizeof(s_ports));
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+        s_ports[i].baud = UART_MOCK_DEFAULT_BAUD;
+    }
+}
+
+void uart_mock_attach(uart_port_t port, uart_mock_peer_t *peer)
+{
+    port_get(port)->peer = peer;
+}
+
+int64_t uart_mock_byte_us(uart_port_t port)
+{
+    return 1000000LL * UART_MOCK_BITS_PER_BYTE / port_get(port)->baud;
+}
+
+void uart_mock_send(uart_port_t port, int64_t at_us, const uint8_t *data, size_t len)
+{
+    uart_mock_port_t *p = port_get(port);
+    int64_t byte_us = uart_mock_byte_us(port);
+    int64_t t = at_us;
+    if (p->count > 0 && p->fifo[(p->head + p->count - 1) % UART_MOCK_RX_FIFO].at_us > t) {
+        t = p->fifo[(p->head + p->count - 1) % UART_MOCK_RX_FIFO].at_us;
+    }
+    for (size_t i = 0; i < len && p->count < UART_MOCK_RX_FIFO; i++) {
+        t += byte_us;
+        uart_mock_byte_t *b = &p->fifo[(p->head + p->count) % UART_MOCK_RX_FIFO];
+        b->data = data[i];
+        b->at_us = t;
+        p->count++;
+    }
+}
+
+static void peer_advance(uart_mock_port_t *p, int64_t until_us)
+{
+    if (p->peer && p->peer->advance) {
+        p->peer->advance(p->peer, until_us);
+    }
+}
+
+static size_t arrived(const uart_mock_port_t *p, int64_t now)
+{
+    size_t n = 0;
+    while (n < p->count && p->fifo[(p->head + n) % UART_MOCK_RX_FIFO].at_us <= now) {
+        n++;
+    }
+    return n;
+}
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+                              void *uart_queue, int intr_alloc_flags)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || rx_buffer_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (p->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->installed = true;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    p->installed = false;
+    p->count = 0;
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || uart_config->baud_rate <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    p->baud = uart_config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+    return port_get(uart_num) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+/* Without a TX ring buffer the call returns once the bytes are in the hardware FIFO, before they are on the line */
+int uart_write_bytes(uart_port_t uart_num, const void *src, size_t size)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return -1;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t start = p->tx_free_us > now ? p->tx_free_us : now;
+    p->tx_free_us = start + (int64_t)size * uart_mock_byte_us(uart_num);
+    if (p->peer) {
+        p->peer->rx(p->peer, p->tx_free_us, src, size);
+    }
+    return (int)size;
+}
+
+int uart_read_bytes(uart_port_t uart_num, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return -1;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t deadline = ticks_to_wait == portMAX_DELAY ? INT64_MAX : now + (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+    uint8_t *out = buf;
+    uint32_t n = 0;
+    while (n < length) {
+        peer_advance(p, deadline == INT64_MAX ? now : deadline);
+        if (p->count == 0 || p->fifo[p->head].at_us > deadline) {
+            if (deadline != INT64_MAX && deadline > now) {
+                host_clock_advance_us(deadline - now);
+            }
+            break;
+        }
+        int64_t at = p->fifo[p->head].at_us;
+        if (at > now) {
+            host_clock_advance_us(at - now);
+            now = at;
+        }
+        out[n++] = p->fifo[p->head].data;
+        p->head = (p->head + 1) % UART_MOCK_RX_FIFO;
+        p->count--;
+    }
+    return (int)n;
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return ESP_FAIL;
+    }
+    int64_t now = esp_timer_get_time();
+    peer_advance(p, now);
+    *size = arrived(p, now);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return ESP_FAIL;
+    }
+    int64_t now = esp_timer_get_time();
+    size_t n = arrived(p, now);
+    p->head = (p->head + n) % UART_MOCK_RX_FIFO;
+    p->count -= n;
+    return ESP_OK;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t uart_num, TickType_t ticks_to_wait)
+{
+    uart_mock_port_t *p = port_get(uart_num);
+    if (!p || !p->installed) {
+        return ESP_FAIL;
+    }
+    int64_t now = esp_timer_get_time();
+    if (p->tx_free_us > now) {
+        host_clock_advance_us(p->tx_free_us - now);
+    }
+    return ESP_OK;
+}
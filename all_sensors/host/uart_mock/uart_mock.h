@@ -0,0 +1,56 @@
+/*
+ * Host mock of the UART driver.
+ *
+ * Implements the driver/uart.h calls used by the components on top of peer models, one per port, so the drivers run
+ * unchanged on Linux. Bytes are timed on the host clock from the baud rate (10 bits per byte): what the chip writes
+ * reaches the peer once it has been shifted out, what the peer sends arrives byte by byte, and uart_read_bytes moves
+ * the clock on until the bytes it waits for have arrived or its timeout has passed.
+ *
+ * Single threaded: a read does not return early because something else happened meanwhile.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_MOCK_RX_FIFO 1024                                                                              /*!< Bytes towards the chip not yet read, more are dropped */
+
+typedef struct uart_mock_peer uart_mock_peer_t;
+
+/**
+ * @brief Device on the other end of a port, embedded as the first member of the model state
+ */
+struct uart_mock_peer {
+    const char *name;
+    void (*rx)(uart_mock_peer_t *peer, int64_t at_us, const uint8_t *data, size_t len);                     /*!< Bytes written by the chip, complete at at_us */
+    void (*advance)(uart_mock_peer_t *peer, int64_t until_us);                                              /*!< Optional: send what falls due until until_us */
+};
+
+/**
+ * @brief Detach all peers, empty the FIFOs and forget the driver state
+ */
+void uart_mock_reset(void);
+
+/**
+ * @brief Connect a peer to a port
+ */
+void uart_mock_attach(uart_port_t port, uart_mock_peer_t *peer);
+
+/**
+ * @brief Send bytes to the chip from a peer: the first starts at at_us, or when the previous byte has arrived
+ */
+void uart_mock_send(uart_port_t port, int64_t at_us, const uint8_t *data, size_t len);
+
+/**
+ * @brief Time of one byte at the configured baud rate
+ */
+int64_t uart_mock_byte_us(uart_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
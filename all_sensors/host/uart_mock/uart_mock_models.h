@@ -0,0 +1,62 @@
+/*
+ * Models of the serial devices of the smart mirror, for the host UART mock (uart_mock.h).
+ *
+ * Each model embeds uart_mock_peer_t as its first member; pass &model.base to uart_mock_attach.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "uart_mock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**************************************** DFPlayer Mini *********************************************/
+
+#define UART_MOCK_DFPLAYER_TRACKS 16
+#define UART_MOCK_DFPLAYER_REPLY_US 10000                                                                   /*!< From the end of a command to the start of the answer */
+#define UART_MOCK_DFPLAYER_LOG 32
+
+/**
+ * @brief DFPlayer Mini serial protocol
+ *
+ * Checks the checksum of every command and answers error 4 to a bad one. With the feedback bit set a command is
+ * acknowledged, except a play of a track that does not exist, which is answered with error 6. A track plays for its
+ * length and is then reported finished twice, back to back, as the module does. 0x42 is answered with the play
+ * state after the ACK. Faults: ACKs left out, answers sent with a broken checksum, commands garbled on the line.
+ */
+typedef struct {
+    uart_mock_peer_t base;
+    uart_port_t port;
+    uint32_t track_ms[UART_MOCK_DFPLAYER_TRACKS];                                                           /*!< Length of each track, 0: no such track */
+    uint8_t volume;
+    uint8_t state;                                                                                          /*!< 0 stopped, 1 playing, 2 paused */
+    uint16_t track;
+    int64_t end_us;                                                                                         /*!< Playing: when the track ends */
+    int64_t left_us;                                                                                        /*!< Paused: what is left of the track */
+    uint8_t rx[10];
+    size_t rx_len;
+    uint32_t drop_acks;                                                                                     /*!< Fault: leave out this many ACKs */
+    uint32_t corrupt_replies;                                                                               /*!< Fault: break the checksum of this many answers */
+    uint32_t garble_commands;                                                                               /*!< Fault: this many commands arrive corrupted */
+    uint32_t commands;                                                                                      /*!< Valid commands received */
+    uint32_t bad_commands;
+    struct {
+        int64_t at_us;
+        uint8_t cmd;
+        uint16_t param;
+    } log[UART_MOCK_DFPLAYER_LOG];                                                                          /*!< First commands received */
+} uart_mock_dfplayer_t;
+
+void uart_mock_dfplayer_init(uart_mock_dfplayer_t *m, uart_port_t port);
+
+/**
+ * @brief Send a message to the chip now, as if the module sent it on its own (e.g. 0x3F after power up)
+ */
+void uart_mock_dfplayer_notify(uart_mock_dfplayer_t *m, uint8_t cmd, uint16_t param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Pure parts of the Wi-Fi manager (components/wifi_manager):
+ *   - reconnection delays double from the minimum up to the maximum, with the random half inside its bounds, and
+ *     start from the minimum again after a connection
+ *   - an access point down for 10 minutes: attempts with backoff against the prototype's reconnect on every
+ *     disconnection, and how long after it is back the station finds it
+ *   - the provisioning form: escapes, field order, missing and oversized fields; credentials the driver accepts
+ * Exit status is non-zero if a check fails.
+ */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi_manager_backoff.h"
+#include "wifi_manager_form.h"
+
+#define MIN_MS          1000                                                        /*!< As WIFI_MANAGER_DEFAULT_CONFIG */
+#define MAX_MS          60000
+#define ATTEMPT_MS      3000                                                        /*!< Scan and association attempt that finds no AP */
+
+static int s_failures;
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) {
+        printf("    FAIL: %s\n", what);
+        s_failures++;
+    }
+}
+
+static void check_delays(void)
+{
+    printf("  delays\n");
+    wifi_manager_backoff_t b;
+    wifi_manager_backoff_init(&b, MIN_MS, MAX_MS);
+    bool bounded = true;
+    uint32_t expected = MIN_MS;
+    printf("   ");
+    for (int i = 0; i < 12; i++) {
+        uint32_t d = wifi_manager_backoff_next(&b, (uint32_t)rand());
+        printf(" %" PRIu32, d);
+        bounded = bounded && d >= expected - expected / 2 && d <= expected;
+        expected = expected * 2 > MAX_MS ? MAX_MS : expected * 2;
+    }
+    printf(" ms\n");
+    check(bounded, "delay between half and all of min * 2^failures, capped at the maximum");
+
+    b.failures = 1000;
+    uint32_t d = wifi_manager_backoff_next(&b, 0);
+    check(d >= MAX_MS / 2 && d <= MAX_MS, "no overflow after many failures");
+    wifi_manager_backoff_reset(&b);
+    d = wifi_manager_backoff_next(&b, 0);
+    check(d >= MIN_MS / 2 && d <= MIN_MS, "from the minimum again after a connection");
+
+    wifi_manager_backoff_init(&b, 0, 0);
+    check(wifi_manager_backoff_next(&b, 7) >= 1, "never a zero delay");
+}
+
+static void check_outage(void)
+{
+    printf("  access point down for 10 minutes\n");
+    const int64_t down_ms = 10 * 60 * 1000;
+    wifi_manager_backoff_t b;
+    wifi_manager_backoff_init(&b, MIN_MS, MAX_MS);
+    int64_t t = 0;
+    int attempts = 0;
+    while (t < down_ms) {
+        t += ATTEMPT_MS;
+        attempts++;
+        if (t < down_ms) {
+            t += wifi_manager_backoff_next(&b, (uint32_t)rand());
+        }
+    }
+    int64_t found_after = t - down_ms;
+    int tight = down_ms / ATTEMPT_MS;
+    printf("    %d attempts with backoff, %d reconnecting at once; connected %" PRId64 " ms after the AP is back\n",
+           attempts, tight, found_after);
+    check(attempts < tight / 8, "far fewer attempts than reconnecting on every disconnection");
+    check(found_after <= MAX_MS + ATTEMPT_MS, "back within one maximum delay");
+}
+
+static void check_form(void)
+{
+    printf("  provisioning form\n");
+    char ssid[WIFI_MANAGER_SSID_LEN + 1];
+    char pass[WIFI_MANAGER_PASSWORD_LEN + 1];
+    check(wifi_manager_form_field("ssid=Dom+2&pass=a%21b%2Bc%26d", "ssid", ssid, sizeof(ssid)) && strcmp(ssid, "Dom 2") == 0,
+          "plus decoded as space");
+    check(wifi_manager_form_field("ssid=Dom+2&pass=a%21b%2Bc%26d", "pass", pass, sizeof(pass)) && strcmp(pass, "a!b+c&d") == 0,
+          "percent escapes decoded");
+    check(wifi_manager_form_field("pass=x&ssid=y", "ssid", ssid, sizeof(ssid)) && strcmp(ssid, "y") == 0, "any order");
+    check(wifi_manager_form_field("ssid=&pass=", "pass", pass, sizeof(pass)) && pass[0] == '\0', "empty value");
+    check(!wifi_manager_form_field("myssid=a&pass=b", "ssid", ssid, sizeof(ssid)), "name matched whole, not as a suffix");
+    check(!wifi_manager_form_field("ssidx=a", "ssid", ssid, sizeof(ssid)), "name matched whole, not as a prefix");
+    check(!wifi_manager_form_field("pass=b", "ssid", ssid, sizeof(ssid)), "missing field");
+    check(!wifi_manager_form_field("ssid=a%2", "ssid", ssid, sizeof(ssid)), "truncated escape refused");
+    check(!wifi_manager_form_field("ssid=a%zz", "ssid", ssid, sizeof(ssid)), "bad escape refused");
+    check(!wifi_manager_form_field("ssid=0123456789012345678901234567890123", "ssid", ssid, sizeof(ssid)),
+          "value longer than the buffer refused");
+
+    /* The longest credentials with every byte escaped, as a browser sends them, fit the body buffer */
+    static const char symbols[] = "!#$%&'()*+,/:;=?@[]\"<>\\^`{|}~ ";
+    char long_ssid[WIFI_MANAGER_SSID_LEN + 1], long_pass[WIFI_MANAGER_PASSWORD_LEN];
+    char body[512];
+    for (size_t i = 0; i < sizeof(long_ssid) - 1; i++) {
+        long_ssid[i] = symbols[(i * 7) % (sizeof(symbols) - 1)];
+    }
+    for (size_t i = 0; i < sizeof(long_pass) - 1; i++) {
+        long_pass[i] = symbols[i % (sizeof(symbols) - 1)];
+    }
+    long_ssid[sizeof(long_ssid) - 1] = long_pass[sizeof(long_pass) - 1] = '\0';
+    size_t len = snprintf(body, sizeof(body), "ssid=");
+    for (size_t i = 0; long_ssid[i]; i++) {
+        len += snprintf(body + len, sizeof(body) - len, "%%%02X", (unsigned char)long_ssid[i]);
+    }
+    len += snprintf(body + len, sizeof(body) - len, "&pass=");
+    for (size_t i = 0; long_pass[i]; i++) {
+        len += snprintf(body + len, sizeof(body) - len, "%%%02X", (unsigned char)long_pass[i]);
+    }
+    check(len == 5 + 3 * 32 + 6 + 3 * 63 && len < WIFI_MANAGER_FORM_MAX,
+          "fully escaped 32 byte SSID and 63 character passphrase fit");
+    check(wifi_manager_form_field(body, "ssid", ssid, sizeof(ssid)) && strcmp(ssid, long_ssid) == 0 &&
+          wifi_manager_form_field(body, "pass", pass, sizeof(pass)) && strcmp(pass, long_pass) == 0 &&
+          wifi_manager_credentials_valid(ssid, pass), "fully escaped credentials decoded and accepted");
+
+    check(wifi_manager_credentials_valid("Dom", ""), "open network");
+    check(wifi_manager_credentials_valid("Dom", "12345678"), "8 character passphrase");
+    check(!wifi_manager_credentials_valid("Dom", "1234567"), "7 character passphrase refused");
+    check(!wifi_manager_credentials_valid("", "12345678"), "empty SSID refused");
+    check(wifi_manager_credentials_valid("Dom", "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"),
+          "64 digit hex key");
+    check(!wifi_manager_credentials_valid("Dom", "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdeg"),
+          "64 characters that are not hex refused");
+}
+
+int main(void)
+{
+    srand(1);
+    printf("Wi-Fi manager\n");
+    check_delays();
+    check_outage();
+    check_form();
+    printf(s_failures ? "%d checks failed\n" : "all checks passed\n", s_failures);
+    return s_failures ? 1 : 0;
+}
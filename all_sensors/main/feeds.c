@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "data_fetch.h"
+#include "time_sync.h"
+#include "wifi_manager.h"
+#include "feeds.h"
+
+#define WEATHER_HOST "api.open-meteo.com"
+#define WEATHER_PATH "/v1/forecast?latitude=52.23&longitude=21.01&current=temperature_2m,weather_code" \
+                     "&daily=temperature_2m_max,temperature_2m_min,weather_code&timezone=Europe%2FWarsaw&forecast_days=3"
+#define WEATHER_EVERY_US (10 * 60 * 1000000LL)
+#define CALENDAR_EVERY_US (5 * 60 * 1000000LL)
+#define RETRY_EVERY_US (60 * 1000000LL) // po błędzie szybciej niż w zwykłym rytmie
+#define FEEDS_NVS_NAMESPACE "feeds"
+#define CAL_PATH_LEN 256
+#define FEEDS_TASK_STACK 8192 // esp_tls z weryfikacją certyfikatu
+
+static const char *TAG = "FEEDS";
+
+static const json_field_t weather_fields[] = {
+    JSON_FIELD(JSON_FIELD_FLOAT, "current.temperature_2m", feeds_weather_t, temp),
+    JSON_FIELD(JSON_FIELD_INT, "current.weather_code", feeds_weather_t, code),
+    JSON_ITEM_FIELD(JSON_FIELD_FLOAT, "daily.temperature_2m_max[]", feeds_weather_t, day, max),
+    JSON_ITEM_FIELD(JSON_FIELD_FLOAT, "daily.temperature_2m_min[]", feeds_weather_t, day, min),
+    JSON_ITEM_FIELD(JSON_FIELD_INT, "daily.weather_code[]", feeds_weather_t, day, code),
+};
+
+static const json_schema_t weather_schema = {
+    .fields = weather_fields,
+    .field_count = sizeof(weather_fields) / sizeof(weather_fields[0]),
+    .items_offset = offsetof(feeds_weather_t, day),
+    .item_size = sizeof(((feeds_weather_t *)0)->day[0]),
+    .max_items = FEEDS_DAYS,
+    .count_offset = offsetof(feeds_weather_t, days),
+};
+
+static const json_field_t calendar_fields[] = {
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].summary", feeds_calendar_t, ev, summary),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].start.dateTime", feeds_calendar_t, ev, start),
+    JSON_ITEM_FIELD(JSON_FIELD_STRING, "items[].start.date", feeds_calendar_t, ev, day),
+};
+
+static const json_schema_t calendar_schema = {
+    .fields = calendar_fields,
+    .field_count = sizeof(calendar_fields) / sizeof(calendar_fields[0]),
+    .items_offset = offsetof(feeds_calendar_t, ev),
+    .item_size = sizeof(((feeds_calendar_t *)0)->ev[0]),
+    .max_items = FEEDS_EVENTS,
+    .count_offset = offsetof(feeds_calendar_t, count),
+};
+
+// Klienci z otwartym połączeniem między pobraniami; odpowiedzi parsowane w locie do struktur poniżej,
+// całe dokumenty nigdzie nie leżą
+static data_fetch_t weather_client, calendar_client;
+static feeds_weather_t weather, weather_scratch;
+static feeds_calendar_t calendar, calendar_scratch;
+static char cal_host[64], cal_path[CAL_PATH_LEN];
+
+static SemaphoreHandle_t lock;
+static feeds_t shared; // kopia dla pętli ekranu, pod lock
+
+static void publish(void) {
+    xSemaphoreTake(lock, portMAX_DELAY);
+    shared.weather = weather;
+    shared.calendar = calendar;
+    xSemaphoreGive(lock);
+}
+
+static bool fetch_weather(data_fetch_resource_t *res) {
+    esp_err_t ret = data_fetch_get(&weather_client, res);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "pogoda: %s", esp_err_to_name(ret));
+        return false;
+    }
+    if (res->status == 200) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        shared.weather_valid = true;
+        xSemaphoreGive(lock);
+    }
+    return true;
+}
+
+// timeMin zaokrąglony do godziny - ta sama ścieżka przez godzinę, więc niezmieniony kalendarz kosztuje 304
+static bool fetch_calendar(data_fetch_resource_t *res, char *path, size_t len) {
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    char time_min[24];
+    strftime(time_min, sizeof(time_min), "%Y-%m-%dT%H:00:00Z", &utc);
+    if (snprintf(path, len, "%s&timeMin=%s", cal_path, time_min) >= (int)len) {
+        ESP_LOGW(TAG, "kalendarz: za długa ścieżka");
+        return false;
+    }
+    esp_err_t ret = data_fetch_get(&calendar_client, res);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "kalendarz: %s", esp_err_to_name(ret));
+        return false;
+    }
+    if (res->status == 200) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        shared.calendar_valid = true;
+        xSemaphoreGive(lock);
+    }
+    return true;
+}
+
+static void feeds_task(void *arg) {
+    static char path[CAL_PATH_LEN + 32];
+    data_fetch_resource_t weather_res = {
+        .path = WEATHER_PATH, .schema = &weather_schema,
+        .target = &weather, .scratch = &weather_scratch, .size = sizeof(weather),
+    };
+    data_fetch_resource_t calendar_res = {
+        .path = path, .schema = &calendar_schema,
+        .target = &calendar, .scratch = &calendar_scratch, .size = sizeof(calendar),
+    };
+    int64_t next_weather = 0, next_calendar = 0;
+
+    while (1) {
+        wifi_manager_wait_connected(portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        if (now >= next_weather) {
+            next_weather = now + (fetch_weather(&weather_res) ? WEATHER_EVERY_US : RETRY_EVERY_US);
+        }
+        // Kalendarz pyta o wydarzenia od teraz - bez zegara nie ma o co pytać
+        if (cal_host[0] && time_sync_is_valid() && now >= next_calendar) {
+            next_calendar = now + (fetch_calendar(&calendar_res, path, sizeof(path)) ? CALENDAR_EVERY_US : RETRY_EVERY_US);
+        }
+        publish();
+        vTaskDelay(pdMS_TO_TICKS(5000));
+    }
+}
+
+static void load_calendar_config(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(FEEDS_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return;
+    size_t host_len = sizeof(cal_host), path_len = sizeof(cal_path);
+    if (nvs_get_str(nvs, "cal_host", cal_host, &host_len) != ESP_OK ||
+        nvs_get_str(nvs, "cal_path", cal_path, &path_len) != ESP_OK) {
+        cal_host[0] = '\0';
+    }
+    nvs_close(nvs);
+}
+
+esp_err_t feeds_start(void) {
+    lock = xSemaphoreCreateMutex();
+    if (!lock) return ESP_ERR_NO_MEM;
+
+    // Pogoda po zwykłym HTTP - publiczne dane, bez kosztu TLS na każde pobranie
+    data_fetch_config_t weather_conf = { .host = WEATHER_HOST, .port = 80 };
+    esp_err_t ret = data_fetch_init(&weather_client, &weather_conf);
+    if (ret != ESP_OK) return ret;
+
+    load_calendar_config();
+    if (cal_host[0]) {
+        data_fetch_config_t cal_conf = { .host = cal_host, .port = 443, .transport = &data_fetch_transport_tls };
+        ret = data_fetch_init(&calendar_client, &cal_conf);
+        if (ret != ESP_OK) return ret;
+    } else {
+        ESP_LOGI(TAG, "brak cal_host/cal_path w NVS \"%s\", bez kalendarza", FEEDS_NVS_NAMESPACE);
+    }
+
+    // Rdzeń 0, razem z Wi-Fi i lwIP - pętla ekranu na rdzeniu 1 nie czeka na sieć
+    if (xTaskCreatePinnedToCore(feeds_task, "feeds", FEEDS_TASK_STACK, NULL, tskIDLE_PRIORITY + 1, NULL, 0) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void feeds_get(feeds_t *out) {
+    if (!lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = shared;
+    xSemaphoreGive(lock);
+}
+
+// Kody pogody WMO, skrótem - ekran ma 16 znaków
+static const char *weather_name(int32_t code) {
+    if (code == 0) return "pogoda";
+    if (code <= 3) return "chmury";
+    if (code <= 48) return "mgla";
+    if (code <= 67) return "deszcz";
+    if (code <= 77) return "snieg";
+    if (code <= 82) return "ulewa";
+    if (code <= 86) return "sniezy";
+    return "burza";
+}
+
+void feeds_format_weather(const feeds_t *f, char *buf, size_t len) {
+    if (!f->weather_valid) {
+        snprintf(buf, len, "Pogoda: --");
+    } else if (f->weather.days > 0) {
+        snprintf(buf, len, "%.0fC %s %.0f/%.0f", f->weather.temp, weather_name(f->weather.code),
+                 f->weather.day[0].max, f->weather.day[0].min);
+    } else {
+        snprintf(buf, len, "%.0fC %s", f->weather.temp, weather_name(f->weather.code));
+    }
+}
+
+// Czcionka ekranu ma tylko ASCII: polskie litery bez ogonków, inne znaki spoza ASCII jako '?'
+static void ascii_fold(const char *in, char *out, size_t len) {
+    static const char *const from[] = { "ą", "ć", "ę", "ł", "ń", "ó", "ś", "ź", "ż", "Ą", "Ć", "Ę", "Ł", "Ń", "Ó", "Ś", "Ź", "Ż" };
+    static const char to[] = "acelnoszzACELNOSZZ";
+    size_t n = 0;
+    while (*in && n + 1 < len) {
+        uint8_t c = *in;
+        if (c < 0x80) {
+            out[n++] = *in++;
+            continue;
+        }
+        char sub = '?';
+        for (size_t i = 0; i < sizeof(from) / sizeof(from[0]); i++) {
+            if (strncmp(in, from[i], 2) == 0) sub = to[i];
+        }
+        out[n++] = sub;
+        in++;
+        while ((*in & 0xC0) == 0x80) in++;
+    }
+    out[n] = '\0';
+}
+
+void feeds_format_event(const feeds_t *f, char *buf, size_t len) {
+    if (!f->calendar_valid || f->calendar.count == 0) {
+        snprintf(buf, len, "%s", f->calendar_valid ? "Brak wydarzen" : "");
+        return;
+    }
+    // "2025-10-20T09:30:00+02:00" -> "20.10 09:30", a całodniowe "2025-10-22" -> "22.10"
+    const char *start = f->calendar.ev[0].start;
+    const char *day = start[0] ? start : f->calendar.ev[0].day;
+    char when[12] = "";
+    if (strlen(day) >= 10) {
+        if (start[0] && strlen(start) >= 16) snprintf(when, sizeof(when), "%.2s.%.2s %.5s", day + 8, day + 5, start + 11);
+        else snprintf(when, sizeof(when), "%.2s.%.2s", day + 8, day + 5);
+    }
+    char summary[sizeof(f->calendar.ev[0].summary)];
+    ascii_fold(f->calendar.ev[0].summary, summary, sizeof(summary));
+    snprintf(buf, len, "%s %s", when, summary);
+}
+
+static void log_client(const char *name, const data_fetch_t *client) {
+    data_fetch_stats_t st;
+    data_fetch_get_stats(client, &st);
+    ESP_LOGI(TAG, "%s: zapytań %lu, połączeń %lu, ponowień %lu, 304 %lu, błędów %lu, %llu B treści",
+             name, (unsigned long)st.requests, (unsigned long)st.connects, (unsigned long)st.stale_retries,
+             (unsigned long)st.not_modified, (unsigned long)st.errors, (unsigned long long)st.body_bytes);
+}
+
+void feeds_log_stats(void) {
+    log_client("pogoda", &weather_client);
+    if (cal_host[0]) log_client("kalendarz", &calendar_client);
+}
@@ -0,0 +1,51 @@
+#ifndef FEEDS_H
+#define FEEDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define FEEDS_DAYS 3
+#define FEEDS_EVENTS 4
+
+// Pogoda z open-meteo: bieżąca i na najbliższe dni
+typedef struct {
+    float temp;
+    int32_t code; // kod pogody WMO
+    uint8_t days;
+    struct {
+        float max, min;
+        int32_t code;
+    } day[FEEDS_DAYS];
+} feeds_weather_t;
+
+// Najbliższe wydarzenia kalendarza w kształcie odpowiedzi Google Calendar (events.list)
+typedef struct {
+    uint8_t count;
+    struct {
+        char summary[40];
+        char start[26]; // "2025-10-20T09:30:00+02:00"
+        char day[11];   // "2025-10-22" - wydarzenie całodniowe
+    } ev[FEEDS_EVENTS];
+} feeds_calendar_t;
+
+// Kopia do rysowania; valid = było choć jedno poprawne pobranie
+typedef struct {
+    feeds_weather_t weather;
+    feeds_calendar_t calendar;
+    bool weather_valid, calendar_valid;
+} feeds_t;
+
+// Zadanie pobierające w tle, czeka na Wi-Fi; kalendarz tylko gdy w NVS "feeds" są cal_host i cal_path
+esp_err_t feeds_start(void);
+
+void feeds_get(feeds_t *out);
+
+// Teksty na ekran, do 16 znaków: "--" = jeszcze nic nie pobrano
+void feeds_format_weather(const feeds_t *f, char *buf, size_t len);
+void feeds_format_event(const feeds_t *f, char *buf, size_t len);
+
+void feeds_log_stats(void);
+
+#endif
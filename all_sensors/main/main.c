@@ -4,106 +4,415 @@
 #include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2c.h"
 #include "driver/gpio.h"
-#include "driver/uart.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "i2c_bus.h"
+#if CONFIG_I2C_BUS_TRACE
+#include "i2c_bus_trace.h"
+#endif
+#include "i2c_discovery.h"
 #include "ssd1306.h"
+#include "display_pacer.h"
+#include "dfplayer.h"
+#include "rules.h"
+#include "time_sync.h"
+#include "wifi_manager.h"
 #include "bme280.h"
+#include "sensors.h"
+#include "feeds.h"
+#include "status_server.h"
+#include "mirror_status.h"
+#include "mirror_telemetry.h"
+#include "mirror_ota.h"
+#include "ota_update.h"
+#include "screen_capture.h"
+#include "mirror_power.h"
+#include "mirror_rules.h"
 
 #define I2C_PORT I2C_NUM_0
+#define I2C_SDA_PIN 21
+#define I2C_SCL_PIN 22
+#define I2C_FREQ_HZ 400000
 #define PIR_PIN 27
-#define BH1750_ADDR 0x23
-#define BME280_ADDR 0x76 
+#define OLED_DEFAULT_ADDR 0x3C // gdy wykrywanie nie znajdzie wyświetlacza
+#define I2C_LAYOUT_ID 1 // zmienić przy zmianie okablowania - unieważnia cache wykrywania w NVS
 #define TXD_PIN 17
 #define RXD_PIN 16
+#define RULES_NVS_NAMESPACE "rules"
+#define RULES_NVS_KEY "text" // reguły z NVS zastępują domyślne, bez wgrywania firmware
+#define STATS_EVERY_LOOPS 120 // co ~60 s
+#define STATUS_EVERY_LOOPS 10 // zrzut dla /status i /metrics co ~5 s
+#define TELEMETRY_EVERY_LOOPS 20 // próbka telemetrii co ~10 s, paczki co 5 min
+#define DISPLAY_FPS 2 // zegar na ekranie zmienia się co sekundę, 2 klatki na sekundę wystarczą
+#define DISPLAY_NVS_NAMESPACE "display"
+#define DISPLAY_NVS_PROFILE "profile" // nazwa profilu panelu, np. "ssd1306_72x40" - ma pierwszeństwo przed wykrywaniem
 
-void send_dfplayer_cmd(uint8_t cmd, uint16_t dat) {
-    uint8_t msg[10] = {0x7E, 0xFF, 0x06, cmd, 0x00, (uint8_t)(dat >> 8), (uint8_t)(dat & 0xFF), 0x00, 0x00, 0xEF};
-    uint16_t checksum = 0;
-    for (int i = 1; i < 7; i++) checksum += msg[i];
-    checksum = -checksum;
-    msg[7] = (uint8_t)(checksum >> 8);
-    msg[8] = (uint8_t)(checksum & 0xFF);
-    uart_write_bytes(UART_NUM_2, (const char*)msg, 10);
+static const char *TAG = "MIRROR";
+
+// Stan akcji reguł, zmieniany tylko w wywołaniach reguł z pętli głównej
+typedef struct {
+    SSD1306_t *dev;
+    dfplayer_handle_t player;
+    const char *banner[8]; // napis na linii, NULL = zwykła treść
+} app_actions_t;
+
+// Urządzenia podpięte przez wykrywanie I2C
+typedef struct {
+    sensors_t sensors;
+    uint8_t oled_addr;
+    i2c_chip_t oled_chip;
+} app_devices_t;
+
+static esp_err_t bind_bme280(i2c_bus_handle_t bus, const i2c_discovery_entry_t *e, void *ctx) {
+    app_devices_t *devs = ctx;
+    i2c_bus_device_handle_t dev = i2c_bus_device_create(bus, e->addr, 0);
+    if (dev == NULL) return ESP_ERR_NO_MEM;
+    // BMP280 ma ten sam układ kalibracji temperatury, lokalny sterownik obsługuje oba
+    esp_err_t ret = bme280_init(dev);
+    if (ret != ESP_OK) {
+        i2c_bus_device_delete(&dev);
+        return ret;
+    }
+    devs->sensors.bme_dev = dev;
+    devs->sensors.bme_ready = true;
+    return ESP_OK;
 }
 
-void init_uart() {
-    uart_config_t uart_config = {
-        .baud_rate = 9600,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+static esp_err_t bind_bh1750(i2c_bus_handle_t bus, const i2c_discovery_entry_t *e, void *ctx) {
+    app_devices_t *devs = ctx;
+    i2c_bus_device_handle_t dev = i2c_bus_device_create(bus, e->addr, 0);
+    if (dev == NULL) return ESP_ERR_NO_MEM;
+    esp_err_t ret = bh1750_start(dev);
+    if (ret != ESP_OK) {
+        i2c_bus_device_delete(&dev);
+        return ret;
+    }
+    devs->sensors.bh_dev = dev;
+    devs->sensors.bh_ready = true;
+    return ESP_OK;
+}
+
+static esp_err_t bind_oled(i2c_bus_handle_t bus, const i2c_discovery_entry_t *e, void *ctx) {
+    app_devices_t *devs = ctx;
+    devs->oled_addr = e->addr;
+    devs->oled_chip = e->chip;
+    return ESP_OK;
+}
+
+// Wykrywanie urządzeń - przy ciepłym starcie wynik z NVS, bez skanowania
+static void discover_devices(i2c_bus_handle_t bus, app_devices_t *devs) {
+    i2c_discovery_config_t disc_conf = {
+        .buses = { bus },
+        .bus_num = 1,
+        .use_cache = true,
+        .layout_id = I2C_LAYOUT_ID,
+        .bind = {
+            [I2C_CHIP_BME280] = bind_bme280,
+            [I2C_CHIP_BMP280] = bind_bme280,
+            [I2C_CHIP_BH1750] = bind_bh1750,
+            [I2C_CHIP_SSD1306] = bind_oled,
+            [I2C_CHIP_SH1106] = bind_oled,
+        },
+        .user_ctx = devs,
     };
-    uart_param_config(UART_NUM_2, &uart_config);
-    uart_set_pin(UART_NUM_2, TXD_PIN, RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    uart_driver_install(UART_NUM_2, 1024, 0, 0, NULL, 0);
+    i2c_discovery_result_t found;
+    i2c_discovery_run(&disc_conf, &found);
+}
+
+static void log_i2c_stats(const char *name, i2c_bus_device_handle_t dev) {
+    i2c_bus_device_stats_t st;
+    if (i2c_bus_device_get_stats(dev, &st) != ESP_OK) return;
+    ESP_LOGI(TAG, "%s: %lu transferów, NACK %lu, timeout %lu, SDA low %lu, naprawy %lu, p50 %lu us, p99 %lu us, max %lu us",
+             name, (unsigned long)st.transfers, (unsigned long)st.nack, (unsigned long)st.timeout,
+             (unsigned long)st.bus_stuck, (unsigned long)st.bus_recoveries, (unsigned long)st.latency_p50_us,
+             (unsigned long)st.latency_p99_us, (unsigned long)st.latency_max_us);
+}
+
+static void on_rule_action(const rules_action_t *action, bool active, void *ctx) {
+    app_actions_t *app = ctx;
+    switch (action->type) {
+    case RULES_ACTION_PLAY:
+        if (!app->player) break;
+        if (active) dfplayer_play_mp3(app->player, action->arg);
+        else dfplayer_stop(app->player);
+        break;
+    case RULES_ACTION_BANNER:
+        app->banner[action->arg] = active ? action->text : NULL;
+        break;
+    case RULES_ACTION_DIM:
+        ssd1306_contrast(app->dev, active ? action->arg : 0xFF);
+        break;
+    }
+}
+
+static void log_dfplayer_stats(dfplayer_handle_t player) {
+    dfplayer_stats_t st;
+    dfplayer_get_stats(player, &st);
+    ESP_LOGI(TAG, "DFPlayer: komend %lu, ACK %lu, powtórzeń %lu, timeout %lu, błędów %lu, złych ramek %lu, odrzuconych %lu, utworów %lu",
+             (unsigned long)st.sent, (unsigned long)st.acked, (unsigned long)st.retries, (unsigned long)st.timeouts,
+             (unsigned long)st.errors, (unsigned long)st.bad_frames, (unsigned long)st.dropped, (unsigned long)st.finished);
+}
+
+static void log_time_stats(void) {
+    time_sync_drift_t st;
+    time_sync_get_stats(&st);
+    ESP_LOGI(TAG, "Czas: synchronizacji %lu, pomiarów dryfu %lu, dryf %ld ppb, ostatnie przesunięcie %lld us",
+             (unsigned long)st.syncs, (unsigned long)st.measurements, (long)st.drift_ppb, (long long)st.last_offset_us);
+}
+
+static void log_wifi_stats(void) {
+    wifi_manager_stats_t st;
+    wifi_manager_get_stats(&st);
+    ESP_LOGI(TAG, "Wi-Fi: stan %d, połączeń %lu, zerwań %lu, prób %lu, ostatni powód %u, RSSI %d dBm%s",
+             st.state, (unsigned long)st.connects, (unsigned long)st.disconnects, (unsigned long)st.attempts,
+             st.last_reason, st.rssi, st.provisioning ? ", AP konfiguracji aktywny" : "");
+}
+
+static void log_pacer_stats(const display_pacer_t *pacer) {
+    display_pacer_stats_t st;
+    display_pacer_get_stats(pacer, &st);
+    ESP_LOGI(TAG, "OLED: klatek %lu, wysłanych %lu, bez zmian %lu, pominiętych %lu, %llu B, render %lu us, transfer %lu us (max %lu us), co %u. slot",
+             (unsigned long)st.frames_rendered, (unsigned long)st.frames_sent, (unsigned long)st.frames_clean,
+             (unsigned long)st.frames_skipped, (unsigned long long)st.bytes_sent, (unsigned long)st.render_us,
+             (unsigned long)st.transfer_us, (unsigned long)st.transfer_max_us, st.divisor);
+}
+
+// Profil panelu: wpis w NVS, a bez niego układ wykryty na magistrali
+static const ssd1306_profile_t *oled_profile(i2c_chip_t chip) {
+    nvs_handle_t nvs;
+    if (nvs_open(DISPLAY_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        char name[32];
+        size_t len = sizeof(name);
+        esp_err_t ret = nvs_get_str(nvs, DISPLAY_NVS_PROFILE, name, &len);
+        nvs_close(nvs);
+        const ssd1306_profile_t *profile = ret == ESP_OK ? ssd1306_profile_find(name) : NULL;
+        if (profile) return profile;
+    }
+    return chip == I2C_CHIP_SH1106 ? &sh1106_profile_128x64 : &ssd1306_profile_128x64;
 }
 
 void app_main(void) {
-    init_uart();
-    vTaskDelay(pdMS_TO_TICKS(500));
-    send_dfplayer_cmd(0x06, 20); 
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // 1. Magistrala I2C - wspólna dla OLED, BME280 i BH1750
+    i2c_config_t i2c_conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_SDA_PIN,
+        .scl_io_num = I2C_SCL_PIN,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = I2C_FREQ_HZ,
+    };
+    i2c_bus_handle_t bus = i2c_bus_create(I2C_PORT, &i2c_conf);
+
+    // 2. NVS - konfiguracja modułów i wynik wykrywania urządzeń
+    esp_err_t nvs_ret = nvs_flash_init();
+    if (nvs_ret == ESP_ERR_NVS_NO_FREE_PAGES || nvs_ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        nvs_ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(nvs_ret);
+
+    // Tryb zasilania z NVS "power"; w deep sleep budzi timer na próbkę albo ruch na PIR
+    power_cycle_wake_t wake = mirror_power_init(PIR_PIN);
+    app_devices_t devs = { .oled_addr = OLED_DEFAULT_ADDR, .oled_chip = I2C_CHIP_SSD1306 };
+    readings_t r = {0};
+    mirror_power_restore_readings(&r);
+    if (wake == POWER_CYCLE_WAKE_TIMER) {
+        // Pobudka od timera: próbka do historii i z powrotem do snu - bez Wi-Fi, ekranu i odtwarzacza
+        discover_devices(bus, &devs);
+        sensors_poll(&devs.sensors, &r);
+        mirror_status_sample(&r, power_cycle_now_us() / 1000000);
+        power_cycle_set_on(0);
+        power_cycle_ready();
+        mirror_power_sleep(&r, NULL);
+    }
 
-    // 1. OLED i I2C
+    // Odtwarzacz - komendy idą przez kolejkę, własne zadanie czeka na ACK, nic tu nie blokuje
+    dfplayer_config_t player_conf = DFPLAYER_DEFAULT_CONFIG();
+    player_conf.uart_port = UART_NUM_2;
+    player_conf.tx_io = TXD_PIN;
+    player_conf.rx_io = RXD_PIN;
+    dfplayer_handle_t player = NULL;
+    if (dfplayer_create(&player_conf, &player) == ESP_OK) {
+        dfplayer_set_volume(player, 20);
+    } else {
+        ESP_LOGE(TAG, "DFPlayer nie wystartował, alarm bez dźwięku");
+    }
+
+    // Czas z SNTP po uzyskaniu adresu przez stację, strefa Europe/Warsaw, korekta dryfu kwarcu między synchronizacjami
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    time_sync_config_t time_conf = TIME_SYNC_DEFAULT_CONFIG();
+    ESP_ERROR_CHECK(time_sync_init(&time_conf));
+
+    // Wi-Fi - dane sieci z NVS, bez nich AP konfiguracji z formularzem na http://192.168.4.1/;
+    // ponowne łączenie z rosnącymi odstępami, pętla ekranu nie czeka na sieć
+    wifi_manager_config_t wifi_conf = WIFI_MANAGER_DEFAULT_CONFIG();
+    // W light sleep radio budzi się co listen_interval beaconów, nie na każdy
+    if (power_cycle_mode() == POWER_CYCLE_MODE_LIGHT_SLEEP) wifi_conf.power_save = WIFI_PS_MAX_MODEM;
+    esp_err_t wifi_ret = wifi_manager_start(&wifi_conf);
+    if (wifi_ret != ESP_OK) {
+        ESP_LOGE(TAG, "Wi-Fi nie wystartowało (%s), praca bez sieci", esp_err_to_name(wifi_ret));
+    } else {
+        // Pogoda i kalendarz w tle, po stałym połączeniu; ekran pokazuje ostatnią pobraną kopię
+        esp_err_t feeds_ret = feeds_start();
+        if (feeds_ret != ESP_OK) ESP_LOGE(TAG, "pobieranie pogody nie wystartowało (%s)", esp_err_to_name(feeds_ret));
+        // Odczyty i liczniki po HTTP na porcie 8080 (80 zajmuje formularz konfiguracji Wi-Fi), JSON i Prometheus
+        status_server_config_t status_conf = STATUS_SERVER_DEFAULT_CONFIG();
+        esp_err_t status_ret = status_server_start(&status_conf);
+        if (status_ret != ESP_OK) ESP_LOGE(TAG, "serwer statusu nie wystartował (%s)", esp_err_to_name(status_ret));
+        // Odczyty do brokera MQTT w paczkach; bez połączenia paczki czekają w partycji "telemetry"
+        esp_err_t telemetry_ret = mirror_telemetry_start();
+        if (telemetry_ret != ESP_OK && telemetry_ret != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "telemetria nie wystartowała (%s)", esp_err_to_name(telemetry_ret));
+        }
+        // Nowy firmware z serwera HTTP, pobierany i rozpakowywany w tle do drugiej partycji OTA
+        esp_err_t ota_ret = mirror_ota_start();
+        if (ota_ret != ESP_OK && ota_ret != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "aktualizacje nie wystartowały (%s)", esp_err_to_name(ota_ret));
+        }
+    }
+
+    power_cycle_set_on(POWER_CYCLE_ON_DISPLAY | (wifi_ret == ESP_OK ? POWER_CYCLE_ON_WIFI : 0));
+
+    discover_devices(bus, &devs);
+
+    // OLED korzysta ze sterownika zainstalowanego przez i2c_bus; po deep sleep panel trzyma ostatni obraz w swojej
+    // RAM - inicjalizacja go włącza, bez czyszczenia ekran jest od razu
     SSD1306_t dev;
-    i2c_master_init(&dev, 21, 22, -1); 
-    dev._address = 0x3C; 
-    ssd1306_init(&dev, 128, 64);
-    ssd1306_clear_screen(&dev, false);
+    i2c_device_add(&dev, I2C_PORT, -1, devs.oled_addr);
+    ssd1306_init_profile(&dev, oled_profile(devs.oled_chip));
+    if (wake == POWER_CYCLE_WAKE_POWER_ON) ssd1306_clear_screen(&dev, false);
 
-    // 2. BME280 - TERAZ POPRAWIONE
-    bme280_init(I2C_PORT, BME280_ADDR); 
+    // Ekran rysowany w bufor w rytmie DISPLAY_FPS, na panel idą tylko zmienione strony
+    static display_pacer_t pacer;
+    display_pacer_config_t pacer_conf = DISPLAY_PACER_DEFAULT_CONFIG();
+    pacer_conf.target_fps = DISPLAY_FPS;
+    display_pacer_init(&pacer, &dev, &pacer_conf);
+    // Podgląd ekranu na porcie serwera statusu: /screen.png, /screen.pbm i strumień zmian ws://.../screen
+    esp_err_t screen_ret = screen_capture_start(&pacer);
+    if (screen_ret != ESP_OK && screen_ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "podgląd ekranu nie wystartował (%s)", esp_err_to_name(screen_ret));
+    }
+    // Obraz sprzed snu z pamięci RTC jako już wysłany - pierwsza klatka wysyła tylko zmiany
+    if (wake != POWER_CYCLE_WAKE_POWER_ON && !mirror_power_restore_screen(&pacer)) ssd1306_clear_screen(&dev, false);
 
-    // 3. PIR i BH1750
+    // 3. PIR
     gpio_reset_pin(PIR_PIN);
     gpio_set_direction(PIR_PIN, GPIO_MODE_INPUT);
-    uint8_t cmd_on = 0x01, cmd_meas = 0x10;
-    i2c_master_write_to_device(I2C_PORT, BH1750_ADDR, &cmd_on, 1, 100);
-    i2c_master_write_to_device(I2C_PORT, BH1750_ADDR, &cmd_meas, 1, 100);
 
-    char buf_t[20], buf_p[30], buf_l[20], buf_time[20];
+    // 4. Reguły - z NVS, a przy braku lub błędzie domyślne
+    static rules_engine_t rules;
+    static app_actions_t actions;
+    actions.dev = &dev;
+    actions.player = player;
+    rules_init(&rules, mirror_rule_inputs, IN_COUNT, on_rule_action, &actions);
+    int err_line = 0;
+    esp_err_t rules_ret = rules_load_nvs(&rules, RULES_NVS_NAMESPACE, RULES_NVS_KEY, &err_line);
+    if (rules_ret != ESP_OK) {
+        if (rules_ret != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "reguły z NVS odrzucone (%s, linia %d), używam domyślnych", esp_err_to_name(rules_ret), err_line);
+        }
+        ESP_ERROR_CHECK(rules_compile(&rules, mirror_default_rules, NULL));
+    }
+
+    char buf_t[20], buf_p[30], buf_l[20], buf_time[20], buf_w[24], buf_ev[24];
+    feeds_t feeds;
+    uint32_t loops = 0;
+    uint32_t time_syncs = UINT32_MAX;
+#if CONFIG_I2C_BUS_TRACE
+    bool was_stale = false;
+#endif
 
     while (1) {
-        // Czas
-        time_t now;
-        struct tm ti;
-        time(&now);
-        localtime_r(&now, &ti);
-        strftime(buf_time, sizeof(buf_time), "%H:%M:%S", &ti);
-
-        // Odczyty
-        float temp = 0, hum = 0, press = 0, lux = 0;
-        bme280_read_float_data(I2C_PORT, BME280_ADDR, &temp, &press, &hum);
-        
-        uint8_t d[2];
-        if (i2c_master_read_from_device(I2C_PORT, BH1750_ADDR, d, 2, 100) == ESP_OK) {
-            lux = ((d[0] << 8) | d[1]) / 1.2;
-        }
+        display_pacer_wait(&pacer);
 
-        // Ekran
-        ssd1306_clear_screen(&dev, false);
-        ssd1306_display_text(&dev, 0, buf_time, strlen(buf_time), false);
-        
-        snprintf(buf_t, sizeof(buf_t), "T:%.1fC H:%.0f%%", temp, hum);
-        ssd1306_display_text(&dev, 2, buf_t, strlen(buf_t), false);
-        
-        snprintf(buf_p, sizeof(buf_p), "P:%.1f hPa", press/100.0);
-        ssd1306_display_text(&dev, 3, buf_p, strlen(buf_p), false);
-
-        if (lux > 600.0) {
-            ssd1306_display_text(&dev, 5, "JASNO - GRA!", 12, true);
-            send_dfplayer_cmd(0x12, 1); 
-            vTaskDelay(pdMS_TO_TICKS(10000));
-            send_dfplayer_cmd(0x0E, 0);
-        } else if (gpio_get_level(PIR_PIN)) {
-            ssd1306_display_text(&dev, 6, "WIDZE CIE!", 10, true);
+        // Czas - do pierwszej synchronizacji nie ma czego pokazać
+        if (time_sync_is_valid()) {
+            time_t now;
+            struct tm ti;
+            time(&now);
+            localtime_r(&now, &ti);
+            strftime(buf_time, sizeof(buf_time), "%H:%M:%S", &ti);
         } else {
-            snprintf(buf_l, sizeof(buf_l), "Lux: %.1f", lux);
-            ssd1306_display_text(&dev, 6, buf_l, strlen(buf_l), false);
+            strcpy(buf_time, "--:--:--");
+        }
+
+        // Klatki na granicy sekundy - nowa sekunda na ekranie zaraz po zmianie, nie pół klatki później;
+        // ponownie po każdej synchronizacji i co STATS_EVERY_LOOPS, bo zegar ścienny przesuwa się względem esp_timer
+        time_sync_drift_t ts;
+        time_sync_get_stats(&ts);
+        if (ts.syncs != time_syncs || loops % STATS_EVERY_LOOPS == 0) {
+            time_syncs = ts.syncs;
+            if (time_sync_is_valid()) display_pacer_align(&pacer, esp_timer_get_time() + time_sync_us_to_next_second());
+        }
+
+        // Odczyty - przy błędzie zostaje ostatnia dobra wartość z flagą stale
+        sensors_poll(&devs.sensors, &r);
+        uint32_t uptime_s = power_cycle_now_us() / 1000000; // od włączenia, razem z deep sleep
+        mirror_status_sample(&r, uptime_s);
+
+#if CONFIG_I2C_BUS_TRACE
+        // Pierwszy nieudany odczyt - zrzut ostatnich transakcji I2C na konsolę (dekoduje host/i2c_trace)
+        bool stale = r.env_stale || r.lux_stale;
+        if (stale && !was_stale) {
+            ESP_LOGW(TAG, "odczyt nieudany, zrzut śladu I2C");
+            i2c_bus_trace_dump(stdout);
+        }
+        was_stale = stale;
+#endif
+
+        // Zrzut formatowany tu tylko co STATUS_EVERY_LOOPS, odpowiedzi wysyła zadanie serwera na rdzeniu 0
+        if (loops % STATUS_EVERY_LOOPS == 0) mirror_status_publish(&r, &devs.sensors, &pacer, uptime_s);
+        if (loops % TELEMETRY_EVERY_LOOPS == 0) mirror_telemetry_sample(&r);
+
+        if (++loops % STATS_EVERY_LOOPS == 0) {
+            // Minuta pracy pętli po aktualizacji - nowa wersja zostaje, bez tego reset wraca do poprzedniej;
+            // wcześniejszy sen potwierdza ją w mirror_power_sleep
+            if (loops == STATS_EVERY_LOOPS) ota_update_confirm();
+            if (devs.sensors.bme_dev) log_i2c_stats("BME280", devs.sensors.bme_dev);
+            if (devs.sensors.bh_dev) log_i2c_stats("BH1750", devs.sensors.bh_dev);
+            log_pacer_stats(&pacer);
+            log_time_stats();
+            log_wifi_stats();
+            feeds_log_stats();
+            mirror_telemetry_log_stats();
+            mirror_ota_log_stats();
+            mirror_power_log_stats();
+            if (player) log_dfplayer_stats(player);
+        }
+
+        // Ekran - tylko w buforze, wysyła display_pacer_present
+        _ssd1306_clear_screen(&dev, false);
+        _ssd1306_text(&dev, 0, buf_time, strlen(buf_time), false);
+
+        // '?' = wartość nieaktualna (ostatni odczyt się nie udał), "--" = brak odczytu
+        sensors_format_env(&r, buf_t, sizeof(buf_t), buf_p, sizeof(buf_p));
+        _ssd1306_text(&dev, 2, buf_t, strlen(buf_t), false);
+        _ssd1306_text(&dev, 3, buf_p, strlen(buf_p), false);
+
+        feeds_get(&feeds);
+        feeds_format_weather(&feeds, buf_w, sizeof(buf_w));
+        feeds_format_event(&feeds, buf_ev, sizeof(buf_ev));
+        _ssd1306_text(&dev, 4, buf_w, strlen(buf_w), false);
+        _ssd1306_text(&dev, 7, buf_ev, strlen(buf_ev), false);
+
+        int pir = gpio_get_level(PIR_PIN);
+        mirror_rules_update(&rules, &r, pir);
+
+        if (!actions.banner[6]) {
+            sensors_format_lux(&r, buf_l, sizeof(buf_l));
+            _ssd1306_text(&dev, 6, buf_l, strlen(buf_l), false);
+        }
+        for (int line = 0; line < 8; line++) {
+            if (actions.banner[line]) _ssd1306_text(&dev, line, actions.banner[line], strlen(actions.banner[line]), true);
         }
+        display_pacer_present(&pacer);
+        power_cycle_ready();
 
-        vTaskDelay(pdMS_TO_TICKS(500));
+        // Deep sleep po idle sekundach bez ruchu; następna klatka dopiero po pobudce
+        mirror_power_tick(pir, &r, &pacer);
     }
 }
\ No newline at end of file
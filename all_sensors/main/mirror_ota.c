@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include "esp_log.h"
+#include "nvs.h"
+#include "ota_update.h"
+#include "mirror_ota.h"
+
+#define OTA_NVS_NAMESPACE "ota"
+// Plik z "idf.py gen_compressed_ota", np. serwowany przez "python3 -m http.server 8000" w katalogu build
+#define OTA_DEFAULT_PATH "/custom_ota_binaries/bme_scanner.bin.xz.packed"
+
+static const char *TAG = "OTA";
+
+// Konfiguracja trzymana przez wskaźniki - napisy muszą żyć do końca
+static char host[64], path[96];
+static bool started;
+
+static bool load_config(uint16_t *port) {
+    nvs_handle_t nvs;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+    size_t host_len = sizeof(host), path_len = sizeof(path);
+    if (nvs_get_str(nvs, "host", host, &host_len) != ESP_OK) host[0] = '\0';
+    if (nvs_get_str(nvs, "path", path, &path_len) != ESP_OK) snprintf(path, sizeof(path), "%s", OTA_DEFAULT_PATH);
+    nvs_get_u16(nvs, "port", port); // bez wpisu zostaje domyślny
+    nvs_close(nvs);
+    return host[0] != '\0';
+}
+
+esp_err_t mirror_ota_start(void) {
+    ota_update_config_t conf = OTA_UPDATE_DEFAULT_CONFIG();
+    if (!load_config(&conf.port)) {
+        ESP_LOGI(TAG, "brak host w NVS \"%s\", aktualizacje wyłączone", OTA_NVS_NAMESPACE);
+        return ESP_ERR_NOT_FOUND;
+    }
+    conf.host = host;
+    conf.path = path;
+    esp_err_t ret = ota_update_start(&conf);
+    started = ret == ESP_OK;
+    return ret;
+}
+
+void mirror_ota_log_stats(void) {
+    if (!started) return;
+    ota_update_stats_t st;
+    ota_update_get_stats(&st);
+    ESP_LOGI(TAG, "sprawdzeń %lu, aktualnych %lu, nieudanych %lu (ostatni błąd %s), ostatnio zapytań %lu, "
+             "wznowień %lu, pobranych %lu B, zapisanych %lu B",
+             (unsigned long)st.checks, (unsigned long)st.up_to_date, (unsigned long)st.failures,
+             esp_err_to_name(st.last_error), (unsigned long)st.last.requests, (unsigned long)st.last.resumes,
+             (unsigned long)st.last.received, (unsigned long)st.last.written);
+}
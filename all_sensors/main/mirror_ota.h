@@ -0,0 +1,12 @@
+#ifndef MIRROR_OTA_H
+#define MIRROR_OTA_H
+
+#include "esp_err.h"
+
+// Aktualizacje firmware z serwera HTTP, gdy w NVS "ota" jest host (opcjonalnie port, path);
+// ESP_ERR_NOT_FOUND = brak konfiguracji, aktualizacje wyłączone
+esp_err_t mirror_ota_start(void);
+
+void mirror_ota_log_stats(void);
+
+#endif
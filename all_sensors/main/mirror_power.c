@@ -0,0 +1,128 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "ota_update.h"
+#include "ssd1306.h"
+#include "telemetry.h"
+#include "wifi_manager.h"
+#include "mirror_power.h"
+
+#define POWER_NVS_NAMESPACE "power"
+#define FLUSH_WAIT_MS 200 // zadanie telemetrii zapisuje otwartą paczkę do flash przed snem
+#define LIGHT_SLEEP_CPU_PERMILLE 100 // do szacunku: klatka 2 razy na sekundę i beacony Wi-Fi, reszta w light sleep
+
+static const char *TAG = "POWER";
+
+static const char *const mode_names[POWER_CYCLE_MODE_COUNT] = { "zawsze włączone", "light sleep", "deep sleep" };
+static const char *const wake_names[POWER_CYCLE_WAKE_COUNT] = { "włączenie", "timer", "ruch", "inne" };
+
+// Przeżywają deep sleep, po włączeniu i resecie wracają do zer z obrazu
+RTC_DATA_ATTR static readings_t saved_readings;
+RTC_DATA_ATTR static bool readings_valid;
+RTC_DATA_ATTR static uint8_t saved_screen[8][128]; // panel trzyma ten obraz w swojej RAM, wyłączony komendą 0xAE
+RTC_DATA_ATTR static bool screen_valid;
+
+static int pir_pin = -1;
+static uint32_t sample_period_s; // do szacunku deep sleep
+
+static void load_config(power_cycle_config_t *conf) {
+    nvs_handle_t nvs;
+    if (nvs_open(POWER_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return;
+    uint8_t mode;
+    uint16_t period, idle;
+    if (nvs_get_u8(nvs, "mode", &mode) == ESP_OK && mode < POWER_CYCLE_MODE_COUNT) conf->mode = mode;
+    if (nvs_get_u16(nvs, "period", &period) == ESP_OK && period > 0) conf->sample_period_s = period;
+    if (nvs_get_u16(nvs, "idle", &idle) == ESP_OK) conf->idle_s = idle;
+    nvs_close(nvs);
+}
+
+power_cycle_wake_t mirror_power_init(int wake_pin) {
+    power_cycle_config_t conf = POWER_CYCLE_DEFAULT_CONFIG();
+    conf.wake_gpio = wake_pin;
+    load_config(&conf);
+    pir_pin = wake_pin;
+    sample_period_s = conf.sample_period_s;
+    power_cycle_wake_t wake;
+    esp_err_t ret = power_cycle_init(&conf, &wake);
+    if (ret != ESP_OK) ESP_LOGW(TAG, "tryb %s niedostępny (%s)", mode_names[conf.mode], esp_err_to_name(ret));
+    ESP_LOGI(TAG, "tryb %s, pobudka: %s", mode_names[power_cycle_mode()], wake_names[wake]);
+    return wake;
+}
+
+bool mirror_power_restore_readings(readings_t *r) {
+    if (!readings_valid) return false;
+    *r = saved_readings;
+    return true;
+}
+
+bool mirror_power_restore_screen(display_pacer_t *pacer) {
+    if (!screen_valid) return false;
+    display_pacer_restore(pacer, (const uint8_t (*)[128])saved_screen);
+    return true;
+}
+
+void mirror_power_sleep(const readings_t *r, display_pacer_t *pacer) {
+    // Sen przychodzi po udanym cyklu pętli, czasem przed minutą z app_main - bez potwierdzenia
+    // pobudka z deep sleep to reset i bootloader wróciłby do poprzedniej wersji
+    ota_update_confirm();
+    saved_readings = *r;
+    readings_valid = true;
+    if (pacer) {
+        // Panel zostaje zasilony i wyłączony - po ruchu wystarczy go włączyć, bez wysyłania obrazu
+        screen_valid = pacer->synced;
+        memcpy(saved_screen, pacer->shown, sizeof(saved_screen));
+        ssd1306_display_power(pacer->dev, false);
+        telemetry_flush();
+        vTaskDelay(pdMS_TO_TICKS(FLUSH_WAIT_MS));
+    }
+    power_cycle_sleep();
+}
+
+void mirror_power_tick(bool motion, const readings_t *r, display_pacer_t *pacer) {
+    if (motion) power_cycle_activity();
+    if (!power_cycle_idle()) return;
+    // PIR w stanie wysokim obudziłby od razu, AP konfiguracji czeka na formularz
+    if (pir_pin >= 0 && gpio_get_level(pir_pin)) return;
+    wifi_manager_stats_t wifi;
+    wifi_manager_get_stats(&wifi);
+    if (wifi.provisioning) return;
+    mirror_power_sleep(r, pacer);
+}
+
+void mirror_power_log_stats(void) {
+    power_cycle_log_t log;
+    power_cycle_summary_t sum;
+    power_cycle_get_summary(&log, &sum);
+    for (int c = 0; c < POWER_CYCLE_WAKE_COUNT; c++) {
+        if (!sum.wakes[c]) continue;
+        ESP_LOGI(TAG, "pobudki %s: %lu, gotowe po %lu us, czuwanie %lu ms", wake_names[c], (unsigned long)sum.wakes[c],
+                 (unsigned long)sum.ready_us[c], (unsigned long)sum.awake_ms[c]);
+    }
+    if (log.count) {
+        ESP_LOGI(TAG, "ostatnie %u z %lu pobudek: %llu s, czuwanie %lu‰, średnio %lu uA", log.count,
+                 (unsigned long)log.total, (unsigned long long)(sum.span_ms / 1000), (unsigned long)sum.awake_permille,
+                 (unsigned long)sum.average_ua);
+    }
+
+    // Szacunek każdego trybu; deep sleep z czasami zmierzonymi w logu, bez nich z domyślnymi
+    uint64_t span_ms = sum.span_ms ? sum.span_ms : 3600000;
+    power_cycle_scenario_t scenarios[POWER_CYCLE_MODE_COUNT] = {
+        { .mode = POWER_CYCLE_MODE_ALWAYS_ON },
+        { .mode = POWER_CYCLE_MODE_LIGHT_SLEEP, .cpu_permille = LIGHT_SLEEP_CPU_PERMILLE },
+        {
+            .mode = POWER_CYCLE_MODE_DEEP_SLEEP,
+            .sample_period_s = sample_period_s,
+            .sample_awake_ms = sum.wakes[POWER_CYCLE_WAKE_TIMER] ? sum.awake_ms[POWER_CYCLE_WAKE_TIMER] : 300,
+            .motion_per_hour = sum.wakes[POWER_CYCLE_WAKE_MOTION] * 3600000ULL / span_ms,
+            .motion_awake_s = sum.wakes[POWER_CYCLE_WAKE_MOTION] ? sum.awake_ms[POWER_CYCLE_WAKE_MOTION] / 1000 : 120,
+        },
+    };
+    for (int m = 0; m < POWER_CYCLE_MODE_COUNT; m++) {
+        ESP_LOGI(TAG, "szacunek %s%s: %lu uA", mode_names[m], m == (int)power_cycle_mode() ? " (bieżący)" : "",
+                 (unsigned long)power_cycle_estimate(power_cycle_profile(), &scenarios[m]));
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef MIRROR_POWER_H
+#define MIRROR_POWER_H
+
+#include <stdbool.h>
+#include "display_pacer.h"
+#include "power_cycle.h"
+#include "sensors.h"
+
+// Tryb zasilania z NVS "power": mode (0 zawsze włączone, 1 light sleep, 2 deep sleep), period - pobudki na próbkę
+// w deep sleep [s], idle - czas bez ruchu do zaśnięcia [s]. W deep sleep budzi też PIR na wake_pin.
+power_cycle_wake_t mirror_power_init(int wake_pin);
+
+// Odczyty i ekran sprzed deep sleep z pamięci RTC; false = start od zera (włączenie, reset, inny tryb)
+bool mirror_power_restore_readings(readings_t *r);
+bool mirror_power_restore_screen(display_pacer_t *pacer);
+
+// Potwierdzenie nowej wersji OTA, odczyty do pamięci RTC i deep sleep do następnej próbki lub ruchu; nie wraca
+void mirror_power_sleep(const readings_t *r, display_pacer_t *pacer);
+
+// Co obieg pętli: ruch przedłuża czuwanie, po idle sekundach bez ruchu deep sleep (nie przy AP konfiguracji)
+void mirror_power_tick(bool motion, const readings_t *r, display_pacer_t *pacer);
+
+// Ostatnie pobudki i szacowany średni prąd każdego trybu przy zmierzonych czasach
+void mirror_power_log_stats(void);
+
+#endif
@@ -0,0 +1,23 @@
+#include "mirror_rules.h"
+
+#define STR_(x) #x
+#define STR(x) STR_(x)
+
+const char *const mirror_rule_inputs[IN_COUNT] = { "lux", "temp", "hum", "press", "pir" };
+
+// Domyślne zachowanie: muzyka i napis powyżej LUX_ALARM_LEVEL, z histerezą, żeby światło
+// w okolicy progu nie włączało muzyki co obieg pętli; napis przy ruchu; przygaszenie w ciemności
+const char mirror_default_rules[] =
+    "lux > " STR(LUX_ALARM_LEVEL) " hyst 50 hold 1s cooldown 60s : play 1\n"
+    "lux > " STR(LUX_ALARM_LEVEL) " hyst 50 : banner 5 JASNO - GRA!\n"
+    "pir > 0 : banner 6 WIDZE CIE!\n"
+    "lux < 5 hyst 3 hold 30s : dim 16\n";
+
+void mirror_rules_update(rules_engine_t *rules, const readings_t *r, int pir) {
+    rules_set_input(rules, IN_LUX, r->lux, r->lux_valid && !r->lux_stale);
+    rules_set_input(rules, IN_TEMP, r->temp, r->env_valid && !r->env_stale);
+    rules_set_input(rules, IN_HUM, r->hum, r->env_valid && !r->env_stale);
+    rules_set_input(rules, IN_PRESS, r->press, r->env_valid && !r->env_stale);
+    rules_set_input(rules, IN_PIR, pir, true);
+    rules_tick(rules);
+}
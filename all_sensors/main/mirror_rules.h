@@ -0,0 +1,20 @@
+#ifndef MIRROR_RULES_H
+#define MIRROR_RULES_H
+
+#include "rules.h"
+#include "sensors.h"
+
+#define LUX_ALARM_LEVEL 600 // lx - powyżej gra muzyka i jest napis (próg domyślnych reguł)
+
+// Wejścia reguł, kolejność jak w mirror_rule_inputs
+enum { IN_LUX, IN_TEMP, IN_HUM, IN_PRESS, IN_PIR, IN_COUNT };
+extern const char *const mirror_rule_inputs[IN_COUNT];
+
+// Reguły, gdy w NVS nie ma własnych
+extern const char mirror_default_rules[];
+
+// Odczyty i PIR na wejścia reguł, potem reguły czekające na hold lub cooldown; stara wartość nie może niczego
+// uruchomić, reguły liczą się tylko dla zmienionych wejść
+void mirror_rules_update(rules_engine_t *rules, const readings_t *r, int pir);
+
+#endif
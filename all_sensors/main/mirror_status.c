@@ -0,0 +1,88 @@
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "status_server.h"
+#include "telemetry.h"
+#include "wifi_manager.h"
+#include "mirror_status.h"
+
+static const char *TAG = "STATUS";
+
+enum { H_TEMP, H_HUM, H_PRESS, H_LUX, H_COUNT };
+// 4,8 KB w pamięci RTC - godzina historii przeżywa deep sleep, próbki z pobudek timera trafiają do niej
+RTC_DATA_ATTR static status_rollup_t history[H_COUNT];
+static status_snapshot_t snap; // 4 KB - poza stosem pętli ekranu
+
+void mirror_status_sample(const readings_t *r, uint32_t now_s) {
+    if (r->env_valid && !r->env_stale) {
+        status_rollup_add(&history[H_TEMP], now_s, r->temp);
+        status_rollup_add(&history[H_HUM], now_s, r->hum);
+        status_rollup_add(&history[H_PRESS], now_s, r->press / 100.0f);
+    }
+    if (r->lux_valid && !r->lux_stale) status_rollup_add(&history[H_LUX], now_s, r->lux);
+}
+
+// Metryki o tej samej nazwie muszą iść po kolei - najpierw pole, potem urządzenia
+static void add_i2c_metrics(const sensors_t *s) {
+    struct { const char *name; i2c_bus_device_handle_t dev; } devs[] = { { "bme280", s->bme_dev }, { "bh1750", s->bh_dev } };
+    i2c_bus_device_stats_t st[2];
+    bool have[2];
+    for (int d = 0; d < 2; d++) have[d] = devs[d].dev && i2c_bus_device_get_stats(devs[d].dev, &st[d]) == ESP_OK;
+
+#define I2C_METRIC(name_, help_, type_, field_)                                                           \
+    for (int d = 0; d < 2; d++) {                                                                         \
+        if (have[d]) status_snapshot_metric(&snap, name_, help_, type_, "device", devs[d].name, st[d].field_); \
+    }
+    I2C_METRIC("i2c_transfers_total", "I2C transfers attempted", STATUS_METRIC_COUNTER, transfers)
+    I2C_METRIC("i2c_nack_total", "I2C transfers not acknowledged", STATUS_METRIC_COUNTER, nack)
+    I2C_METRIC("i2c_timeout_total", "I2C transfers timed out", STATUS_METRIC_COUNTER, timeout)
+    I2C_METRIC("i2c_bus_stuck_total", "I2C transfers failed with SDA held low", STATUS_METRIC_COUNTER, bus_stuck)
+    I2C_METRIC("i2c_recoveries_total", "I2C bus recoveries", STATUS_METRIC_COUNTER, bus_recoveries)
+    I2C_METRIC("i2c_latency_p99_us", "99th percentile I2C transfer latency", STATUS_METRIC_GAUGE, latency_p99_us)
+    I2C_METRIC("i2c_latency_max_us", "Longest I2C transfer", STATUS_METRIC_GAUGE, latency_max_us)
+#undef I2C_METRIC
+}
+
+static void add_display_metrics(const display_pacer_t *pacer) {
+    display_pacer_stats_t st;
+    display_pacer_get_stats(pacer, &st);
+    status_snapshot_metric(&snap, "frames_rendered_total", "Frames rendered", STATUS_METRIC_COUNTER, NULL, NULL, st.frames_rendered);
+    status_snapshot_metric(&snap, "frames_sent_total", "Frames with pages sent to the panel", STATUS_METRIC_COUNTER, NULL, NULL, st.frames_sent);
+    status_snapshot_metric(&snap, "frames_skipped_total", "Frame slots dropped", STATUS_METRIC_COUNTER, NULL, NULL, st.frames_skipped);
+    status_snapshot_metric(&snap, "frame_overruns_total", "Frames longer than their slot", STATUS_METRIC_COUNTER, NULL, NULL, st.overruns);
+    status_snapshot_metric(&snap, "frame_render_us", "Render time, moving average", STATUS_METRIC_GAUGE, NULL, NULL, st.render_us);
+    status_snapshot_metric(&snap, "frame_transfer_us", "Panel transfer time, moving average", STATUS_METRIC_GAUGE, NULL, NULL, st.transfer_us);
+    status_snapshot_metric(&snap, "frame_transfer_max_us", "Longest panel transfer", STATUS_METRIC_GAUGE, NULL, NULL, st.transfer_max_us);
+}
+
+static void add_wifi_metrics(void) {
+    wifi_manager_stats_t st;
+    wifi_manager_get_stats(&st);
+    status_snapshot_metric(&snap, "wifi_connected", "1 with an address", STATUS_METRIC_GAUGE, NULL, NULL, st.state == WIFI_MANAGER_STATE_CONNECTED);
+    status_snapshot_metric(&snap, "wifi_rssi_dbm", "Signal of the access point", STATUS_METRIC_GAUGE, NULL, NULL, st.rssi);
+    status_snapshot_metric(&snap, "wifi_disconnects_total", "Links lost", STATUS_METRIC_COUNTER, NULL, NULL, st.disconnects);
+}
+
+static void add_telemetry_metrics(void) {
+    telemetry_stats_t st;
+    telemetry_get_stats(&st);
+    status_snapshot_metric(&snap, "telemetry_pending_batches", "Batches in flash not yet acknowledged by the broker", STATUS_METRIC_GAUGE, NULL, NULL, st.publisher.pending);
+    status_snapshot_metric(&snap, "telemetry_acked_total", "Batches acknowledged by the broker", STATUS_METRIC_COUNTER, NULL, NULL, st.publisher.acked);
+    status_snapshot_metric(&snap, "telemetry_dropped_total", "Batches erased unsent, flash full", STATUS_METRIC_COUNTER, NULL, NULL, st.publisher.ring.dropped);
+    status_snapshot_metric(&snap, "telemetry_queue_drops_total", "Samples dropped, publishing task behind", STATUS_METRIC_COUNTER, NULL, NULL, st.queue_drops);
+}
+
+void mirror_status_publish(const readings_t *r, const sensors_t *s, const display_pacer_t *pacer, uint32_t now_s) {
+    status_snapshot_reset(&snap, now_s);
+    status_snapshot_reading(&snap, "temperature", "celsius", r->temp, r->env_valid, r->env_stale, &history[H_TEMP]);
+    status_snapshot_reading(&snap, "humidity", "percent", r->hum, r->env_valid, r->env_stale, &history[H_HUM]);
+    status_snapshot_reading(&snap, "pressure", "hpa", r->press / 100.0f, r->env_valid, r->env_stale, &history[H_PRESS]);
+    status_snapshot_reading(&snap, "illuminance", "lux", r->lux, r->lux_valid, r->lux_stale, &history[H_LUX]);
+    add_i2c_metrics(s);
+    add_display_metrics(pacer);
+    add_wifi_metrics();
+    add_telemetry_metrics();
+    status_server_add_system_metrics(&snap);
+
+    esp_err_t ret = status_server_publish(&snap);
+    if (ret == ESP_ERR_INVALID_SIZE) ESP_LOGW(TAG, "zrzut nie mieści się w buforach, zostaje poprzedni");
+}
@@ -0,0 +1,15 @@
+#ifndef MIRROR_STATUS_H
+#define MIRROR_STATUS_H
+
+#include <stdint.h>
+#include "display_pacer.h"
+#include "sensors.h"
+
+// Odczyty do historii (minutowe kubełki z ostatniej godziny); tylko świeże, stara wartość nie zaniża średniej
+void mirror_status_sample(const readings_t *r, uint32_t now_s);
+
+// Zrzut odczytów, historii i liczników do buforów serwera /status i /metrics - żądania HTTP czytają gotowy tekst,
+// pętla ekranu na nie nie czeka
+void mirror_status_publish(const readings_t *r, const sensors_t *s, const display_pacer_t *pacer, uint32_t now_s);
+
+#endif
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "nvs.h"
+#include "telemetry.h"
+#include "time_sync.h"
+#include "mirror_telemetry.h"
+
+#define TELEMETRY_NVS_NAMESPACE "telemetry"
+
+static const char *TAG = "TELEMETRY";
+
+// Konfiguracja trzymana przez wskaźniki - napisy muszą żyć do końca
+static char device_id[20], topic[64], status_topic[64];
+static char host[64], user[32], pass[64];
+static bool started;
+
+static bool load_config(uint16_t *port) {
+    nvs_handle_t nvs;
+    if (nvs_open(TELEMETRY_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return false;
+    size_t host_len = sizeof(host), user_len = sizeof(user), pass_len = sizeof(pass);
+    if (nvs_get_str(nvs, "host", host, &host_len) != ESP_OK) host[0] = '\0';
+    if (nvs_get_str(nvs, "user", user, &user_len) != ESP_OK) user[0] = '\0';
+    if (nvs_get_str(nvs, "pass", pass, &pass_len) != ESP_OK) pass[0] = '\0';
+    nvs_get_u16(nvs, "port", port); // bez wpisu zostaje domyślny
+    nvs_close(nvs);
+    return host[0] != '\0';
+}
+
+esp_err_t mirror_telemetry_start(void) {
+    telemetry_config_t conf = TELEMETRY_DEFAULT_CONFIG();
+    if (!load_config(&conf.publisher.mqtt.port)) {
+        ESP_LOGI(TAG, "brak host w NVS \"%s\", telemetria wyłączona", TELEMETRY_NVS_NAMESPACE);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Identyfikator z adresu MAC - ten sam po każdym starcie, różny dla każdego lustra w sieci
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(device_id, sizeof(device_id), "mirror-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    snprintf(topic, sizeof(topic), "mirrors/%s/telemetry", device_id);
+    snprintf(status_topic, sizeof(status_topic), "mirrors/%s/status", device_id);
+
+    conf.publisher.device_id = device_id;
+    conf.publisher.topic = topic;
+    conf.publisher.status_topic = status_topic;
+    conf.publisher.mqtt.host = host;
+    conf.publisher.mqtt.username = user[0] ? user : NULL;
+    conf.publisher.mqtt.password = pass[0] ? pass : NULL;
+    esp_err_t ret = telemetry_start(&conf);
+    started = ret == ESP_OK;
+    return ret;
+}
+
+void mirror_telemetry_sample(const readings_t *r) {
+    if (!started || !time_sync_is_valid()) return;
+    telemetry_sample_t s = {
+        .time = (uint32_t)time(NULL),
+        .value = { r->temp, r->hum, r->press / 100.0f, r->lux },
+    };
+    if (r->env_valid && !r->env_stale) s.valid |= 1 << TELEMETRY_TEMP | 1 << TELEMETRY_HUM | 1 << TELEMETRY_PRESS;
+    if (r->lux_valid && !r->lux_stale) s.valid |= 1 << TELEMETRY_LUX;
+    telemetry_submit(&s);
+}
+
+void mirror_telemetry_log_stats(void) {
+    if (!started) return;
+    telemetry_stats_t st;
+    telemetry_get_stats(&st);
+    const telemetry_publisher_stats_t *p = &st.publisher;
+    ESP_LOGI(TAG, "paczek %lu, czeka %lu, wysłanych %lu, potwierdzonych %lu, połączeń %lu (nieudanych %lu), "
+             "utraconych z pełnej pamięci %lu, próbek odrzuconych z kolejki %lu, kasowań sektorów %lu",
+             (unsigned long)p->batches, (unsigned long)p->pending, (unsigned long)p->published, (unsigned long)p->acked,
+             (unsigned long)p->connects, (unsigned long)p->connect_failures, (unsigned long)p->ring.dropped,
+             (unsigned long)st.queue_drops, (unsigned long)p->ring.erases);
+}
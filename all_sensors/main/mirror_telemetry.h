@@ -0,0 +1,16 @@
+#ifndef MIRROR_TELEMETRY_H
+#define MIRROR_TELEMETRY_H
+
+#include "esp_err.h"
+#include "sensors.h"
+
+// Wysyłka odczytów do brokera MQTT, gdy w NVS "telemetry" jest host (opcjonalnie port, user, pass);
+// ESP_ERR_NOT_FOUND = brak konfiguracji, telemetria wyłączona
+esp_err_t mirror_telemetry_start(void);
+
+// Próbka do paczki, tylko ze świeżych odczytów i po synchronizacji czasu; nie czeka, przy pełnej kolejce przepada
+void mirror_telemetry_sample(const readings_t *r);
+
+void mirror_telemetry_log_stats(void);
+
+#endif
@@ -0,0 +1,52 @@
+#include <stdio.h>
+#include "sensors.h"
+#include "bme280.h"
+
+esp_err_t bh1750_start(i2c_bus_device_handle_t dev) {
+    // Power on + pomiar ciągły w wysokiej rozdzielczości, bez adresu rejestru
+    esp_err_t ret = i2c_bus_write_byte(dev, NULL_I2C_MEM_ADDR, 0x01);
+    if (ret != ESP_OK) return ret;
+    return i2c_bus_write_byte(dev, NULL_I2C_MEM_ADDR, 0x10);
+}
+
+void sensors_poll(sensors_t *s, readings_t *r) {
+    if (s->bme_dev && !s->bme_ready) s->bme_ready = bme280_init(s->bme_dev) == ESP_OK;
+    float temp, hum, press;
+    if (s->bme_ready && bme280_read_float_data(s->bme_dev, &temp, &press, &hum) == ESP_OK) {
+        r->temp = temp; r->hum = hum; r->press = press;
+        r->env_valid = true;
+        r->env_stale = false;
+    } else {
+        r->env_stale = true;
+        s->bme_ready = false;
+    }
+
+    if (s->bh_dev && !s->bh_ready) s->bh_ready = bh1750_start(s->bh_dev) == ESP_OK;
+    uint8_t d[2];
+    if (s->bh_ready && i2c_bus_read_bytes(s->bh_dev, NULL_I2C_MEM_ADDR, 2, d) == ESP_OK) {
+        r->lux = ((d[0] << 8) | d[1]) / 1.2;
+        r->lux_valid = true;
+        r->lux_stale = false;
+    } else {
+        r->lux_stale = true;
+        s->bh_ready = false;
+    }
+}
+
+void sensors_format_env(const readings_t *r, char *buf_t, size_t len_t, char *buf_p, size_t len_p) {
+    if (r->env_valid) {
+        snprintf(buf_t, len_t, "T:%.1fC H:%.0f%%%s", r->temp, r->hum, r->env_stale ? "?" : "");
+        snprintf(buf_p, len_p, "P:%.1f hPa%s", r->press/100.0, r->env_stale ? "?" : "");
+    } else {
+        snprintf(buf_t, len_t, "T:-- H:--");
+        snprintf(buf_p, len_p, "P:-- hPa");
+    }
+}
+
+void sensors_format_lux(const readings_t *r, char *buf, size_t len) {
+    if (r->lux_valid) {
+        snprintf(buf, len, "Lux: %.1f%s", r->lux, r->lux_stale ? "?" : "");
+    } else {
+        snprintf(buf, len, "Lux: --");
+    }
+}
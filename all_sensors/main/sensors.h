@@ -0,0 +1,33 @@
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "i2c_bus.h"
+
+// Ostatnie poprawne odczyty. valid = był choć jeden poprawny odczyt,
+// stale = ostatni odczyt się nie udał i pokazujemy starą wartość
+typedef struct {
+    float temp, hum, press, lux;
+    bool env_valid, env_stale;
+    bool lux_valid, lux_stale;
+} readings_t;
+
+// Czujniki podpięte przez wykrywanie I2C; NULL = nie znaleziono.
+// ready = czujnik skonfigurowany, po błędzie konfigurujemy go ponownie
+typedef struct {
+    i2c_bus_device_handle_t bme_dev;
+    i2c_bus_device_handle_t bh_dev;
+    bool bme_ready, bh_ready;
+} sensors_t;
+
+esp_err_t bh1750_start(i2c_bus_device_handle_t dev);
+
+// Jeden obieg pętli pomiarowej - przy błędzie zostaje ostatnia dobra wartość z flagą stale
+void sensors_poll(sensors_t *s, readings_t *r);
+
+// Teksty na ekran: '?' = wartość nieaktualna, "--" = brak odczytu
+void sensors_format_env(const readings_t *r, char *buf_t, size_t len_t, char *buf_p, size_t len_p);
+void sensors_format_lux(const readings_t *r, char *buf, size_t len);
+
+#endif